@@ -66,10 +66,16 @@ auto custom_to_string(const std::optional<topic_data_pair>& x) {
 
 namespace py = pybind11;
 
+// Releases the GIL while the wrapped C++ function runs. We use this guard for
+// all calls that may block, so other Python threads can run in the meantime.
+// Any code running under this guard must not touch Python objects.
+using release_gil = py::call_guard<py::gil_scoped_release>;
+
 extern void init_zeek(py::module& m);
 extern void init_data(py::module& m);
 extern void init_enums(py::module& m);
 extern void init_store(py::module& m);
+extern void init_variant(py::module& m);
 
 PYBIND11_MAKE_OPAQUE(broker::set)
 PYBIND11_MAKE_OPAQUE(broker::table)
@@ -85,6 +91,20 @@ broker::endpoint_id node_from_str(const std::string& node_str) {
   return node;
 }
 
+// Returns the topic and a view into the data of `msg`. Unlike the regular
+// `get` functions, this skips converting the content to `broker::data`.
+py::tuple to_view(const broker::data_message& msg) {
+  return py::make_tuple(std::string{broker::get_topic(msg)},
+                        broker::get_data(msg));
+}
+
+py::list to_views(const std::vector<broker::data_message>& msgs) {
+  py::list result;
+  for (const auto& msg : msgs)
+    result.append(to_view(msg));
+  return result;
+}
+
 } // namespace
 
 PYBIND11_MODULE(_broker, m) {
@@ -95,6 +115,7 @@ PYBIND11_MODULE(_broker, m) {
   init_enums(m);
   init_data(m);
   init_store(m);
+  init_variant(m);
 
   auto version = m.def_submodule("Version", "Version constants");
   version.attr("MAJOR") =
@@ -174,10 +195,14 @@ PYBIND11_MODULE(_broker, m) {
     .def("capacity", &broker::publisher::capacity)
     .def("fd", &broker::publisher::fd)
     .def("drop_all_on_destruction", &broker::publisher::drop_all_on_destruction)
-    .def("publish", (void(broker::publisher::*)(const broker::data&))
-                      & broker::publisher::publish)
-    .def("publish_batch", [](broker::publisher& p,
-                             std::vector<broker::data> xs) { p.publish(xs); })
+    .def("publish",
+         (void(broker::publisher::*)(const broker::data&))
+           & broker::publisher::publish,
+         release_gil())
+    .def(
+      "publish_batch",
+      [](broker::publisher& p, std::vector<broker::data> xs) { p.publish(xs); },
+      release_gil())
     .def("reset", &broker::publisher::reset);
 
   using topic_data_pair = std::pair<broker::topic, broker::data>;
@@ -199,7 +224,8 @@ PYBIND11_MODULE(_broker, m) {
            auto res = ep.get();
            return std::make_pair(broker::topic{broker::get_topic(res)},
                                  broker::get_data(res).to_data());
-         })
+         },
+         release_gil())
 
     .def("get",
          [](broker::subscriber& ep,
@@ -211,7 +237,8 @@ PYBIND11_MODULE(_broker, m) {
              rval->second = broker::get_data(*res).to_data();
            }
            return rval;
-         })
+         },
+         release_gil())
 
     .def("get",
          [](broker::subscriber& ep,
@@ -223,7 +250,8 @@ PYBIND11_MODULE(_broker, m) {
              rval.emplace_back(broker::topic{broker::get_topic(e)},
                                broker::get_data(e).to_data());
            return rval;
-         })
+         },
+         release_gil())
 
     .def("get",
          [](broker::subscriber& ep, size_t num,
@@ -235,7 +263,8 @@ PYBIND11_MODULE(_broker, m) {
              rval.emplace_back(broker::topic{broker::get_topic(e)},
                                broker::get_data(e).to_data());
            return rval;
-         })
+         },
+         release_gil())
 
     .def("poll",
          [](broker::subscriber& ep) -> std::vector<topic_data_pair> {
@@ -246,6 +275,75 @@ PYBIND11_MODULE(_broker, m) {
              rval.emplace_back(broker::topic{broker::get_topic(e)},
                                broker::get_data(e).to_data());
            return rval;
+         },
+         release_gil())
+    .def("poll",
+         [](broker::subscriber& ep,
+            size_t max) -> std::vector<topic_data_pair> {
+           std::vector<topic_data_pair> rval;
+           ep.consume(max, [&rval](const broker::data_message& e) {
+             rval.emplace_back(broker::topic{broker::get_topic(e)},
+                               broker::get_data(e).to_data());
+           });
+           return rval;
+         },
+         release_gil())
+    .def("consume",
+         [](broker::subscriber& ep, size_t max,
+            std::function<void(broker::topic, broker::data)> f) -> size_t {
+           return ep.consume(max, [&f](const broker::data_message& e) {
+             f(broker::topic{broker::get_topic(e)},
+               broker::get_data(e).to_data());
+           });
+         })
+    // The view functions release the GIL only while waiting, because creating
+    // the Python objects for the result requires holding the GIL.
+    .def("get_view",
+         [](broker::subscriber& ep) {
+           broker::data_message res;
+           {
+             py::gil_scoped_release guard;
+             res = ep.get();
+           }
+           return to_view(res);
+         })
+    .def("get_view",
+         [](broker::subscriber& ep, double secs) -> py::object {
+           std::optional<broker::data_message> res;
+           {
+             py::gil_scoped_release guard;
+             res = ep.get(broker::to_duration(secs));
+           }
+           if (!res)
+             return py::none();
+           return to_view(*res);
+         })
+    .def("get_view",
+         [](broker::subscriber& ep, size_t num) {
+           std::vector<broker::data_message> res;
+           {
+             py::gil_scoped_release guard;
+             res = ep.get(num);
+           }
+           return to_views(res);
+         })
+    .def("get_view",
+         [](broker::subscriber& ep, size_t num, double secs) {
+           std::vector<broker::data_message> res;
+           {
+             py::gil_scoped_release guard;
+             res = ep.get(num, broker::to_duration(secs));
+           }
+           return to_views(res);
+         })
+    .def("poll_views",
+         [](broker::subscriber& ep) {
+           std::vector<broker::data_message> res;
+           {
+             py::gil_scoped_release guard;
+             res = ep.poll();
+           }
+           return to_views(res);
          })
     .def("available", &broker::subscriber::available)
     .def("fd", &broker::subscriber::fd)
@@ -273,22 +371,26 @@ PYBIND11_MODULE(_broker, m) {
   status_subscriber
     .def("get",
          (broker::status_subscriber::value_type(broker::status_subscriber::*)())
-           & broker::status_subscriber::get)
+           & broker::status_subscriber::get,
+         release_gil())
     .def("get",
          [](broker::status_subscriber& ep, double secs)
            -> std::optional<broker::status_subscriber::value_type> {
            return ep.get(broker::to_duration(secs));
-         })
+         },
+         release_gil())
     .def("get",
          [](broker::status_subscriber& ep,
             size_t num) -> std::vector<broker::status_subscriber::value_type> {
            return ep.get(num);
-         })
+         },
+         release_gil())
     .def("get",
          [](broker::status_subscriber& ep, size_t num,
             double secs) -> std::vector<broker::status_subscriber::value_type> {
            return ep.get(num, broker::to_duration(secs));
-         })
+         },
+         release_gil())
     .def("poll",
          [](broker::status_subscriber& ep)
            -> std::vector<broker::status_subscriber::value_type> {
@@ -326,6 +428,7 @@ PYBIND11_MODULE(_broker, m) {
                    &broker::broker_options::disable_forwarding)
     .def_readwrite("ignore_broker_conf",
                    &broker::broker_options::ignore_broker_conf)
+    .def_readwrite("lightweight", &broker::broker_options::lightweight)
     .def_readwrite("use_real_time", &broker::broker_options::use_real_time);
 
   // We need a configuration class here that's separate from
@@ -373,25 +476,30 @@ PYBIND11_MODULE(_broker, m) {
          [](const broker::endpoint& e) { return to_string(e.node_id()); })
     .def("node_id",
          [](const broker::endpoint& e) { return to_string(e.node_id()); })
-    .def("listen", [](broker::endpoint& ep, std::string& addr,
-                      uint16_t port) { return ep.listen(addr, port); })
+    .def(
+      "listen",
+      [](broker::endpoint& ep, std::string& addr, uint16_t port) {
+        return ep.listen(addr, port);
+      },
+      release_gil())
     .def(
       "peer",
       [](broker::endpoint& ep, std::string& addr, uint16_t port,
          double retry) -> bool {
         return ep.peer(addr, port, std::chrono::seconds((int) retry));
       },
-      py::arg("addr"), py::arg("port"), py::arg("retry") = 10.0)
+      py::arg("addr"), py::arg("port"), py::arg("retry") = 10.0, release_gil())
     .def(
       "peer_nosync",
       [](broker::endpoint& ep, std::string& addr, uint16_t port, double retry) {
         ep.peer_nosync(addr, port, std::chrono::seconds((int) retry));
       },
       py::arg("addr"), py::arg("port"), py::arg("retry") = 10.0)
-    .def("unpeer", &broker::endpoint::unpeer)
+    .def("unpeer", &broker::endpoint::unpeer, release_gil())
     .def("unpeer_nosync", &broker::endpoint::unpeer_nosync)
-    .def("peers", &broker::endpoint::peers)
-    .def("peer_subscriptions", &broker::endpoint::peer_subscriptions)
+    .def("peers", &broker::endpoint::peers, release_gil())
+    .def("peer_subscriptions", &broker::endpoint::peer_subscriptions,
+         release_gil())
     .def("forward", &broker::endpoint::forward)
     .def("publish",
          (void(broker::endpoint::*)(broker::topic, const broker::data&))
@@ -400,36 +508,54 @@ PYBIND11_MODULE(_broker, m) {
          (void(broker::endpoint::*)(const broker::endpoint_info&, broker::topic,
                                     const broker::data&))
            & broker::endpoint::publish)
-    .def("publish_batch",
-         [](broker::endpoint& ep, std::vector<topic_data_pair> batch) {
-           for (auto& item : batch)
-             ep.publish(std::move(item.first), item.second);
-         })
-    .def("make_publisher", &broker::endpoint::make_publisher)
+    .def(
+      "publish_batch",
+      [](broker::endpoint& ep, std::vector<topic_data_pair> batch) {
+        for (auto& item : batch)
+          ep.publish(std::move(item.first), item.second);
+      },
+      release_gil())
+    .def("make_publisher", &broker::endpoint::make_publisher, release_gil())
     .def("make_subscriber", &broker::endpoint::make_subscriber,
-         py::arg("topics"), py::arg("max_qsize") = 20)
+         py::arg("topics"), py::arg("max_qsize") = 20, release_gil())
     .def(
       "make_status_subscriber",
       [](broker::endpoint& ep, bool receive_statuses) {
         return ep.make_status_subscriber(receive_statuses);
       },
-      py::arg("receive_statuses") = false)
-    .def("shutdown", &broker::endpoint::shutdown)
-    .def("attach_master",
-         [](broker::endpoint& ep, const std::string& name, broker::backend type,
-            const broker::backend_options& opts)
-           -> broker::expected<broker::store> {
-           return ep.attach_master(name, type, opts);
-         })
-    .def("attach_clone",
-         [](broker::endpoint& ep, const std::string& name)
-           -> broker::expected<broker::store> { return ep.attach_clone(name); })
-    .def("await_peer",
-         [](broker::endpoint& ep, const std::string& node_str) {
-           return ep.await_peer(node_from_str(node_str));
-         })
+      py::arg("receive_statuses") = false, release_gil())
+    .def("shutdown", &broker::endpoint::shutdown, release_gil())
+    .def(
+      "attach_master",
+      [](broker::endpoint& ep, const std::string& name, broker::backend type,
+         const broker::backend_options& opts)
+        -> broker::expected<broker::store> {
+        return ep.attach_master(name, type, opts);
+      },
+      release_gil())
+    .def(
+      "attach_clone",
+      [](broker::endpoint& ep, const std::string& name)
+        -> broker::expected<broker::store> { return ep.attach_clone(name); },
+      release_gil())
+    .def(
+      "attach_partial_clone",
+      [](broker::endpoint& ep, const std::string& name,
+         const std::string& key_prefix) -> broker::expected<broker::store> {
+        return ep.attach_partial_clone(name, key_prefix);
+      },
+      release_gil())
+    .def(
+      "await_peer",
+      [](broker::endpoint& ep, const std::string& node_str) {
+        auto node = node_from_str(node_str);
+        py::gil_scoped_release guard;
+        return ep.await_peer(node);
+      })
     .def("await_peer", [](broker::endpoint& ep, const std::string& node_str,
                           broker::timespan timeout) {
-      return ep.await_peer(node_from_str(node_str), timeout);
+      auto node = node_from_str(node_str);
+      py::gil_scoped_release guard;
+      return ep.await_peer(node, timeout);
     });
 }
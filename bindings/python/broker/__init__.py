@@ -60,6 +60,7 @@ PeerStatus = _broker.PeerStatus
 PeerFlags = _broker.PeerFlags
 Frontend = _broker.Frontend
 Backend = _broker.Backend
+ValueQuery = _broker.ValueQuery
 NetworkInfo = _broker.NetworkInfo
 EndpointInfo = _broker.EndpointInfo
 PeerInfo = _broker.PeerInfo
@@ -90,6 +91,7 @@ Table = _broker.Table
 Timespan = _broker.Timespan
 Timestamp = _broker.Timestamp
 Vector = _broker.Vector
+Variant = _broker.Variant
 
 def _make_topic(t):
     return (Topic(t) if not isinstance(t, Topic) else t)
@@ -145,10 +147,17 @@ class Subscriber:
 
         assert False
 
-    def poll(self):
-        msgs = self._subscriber.poll()
+    def poll(self, num=None):
+        if num is None:
+            msgs = self._subscriber.poll()
+        else:
+            msgs = self._subscriber.poll(num)
         return [(d[0].string(), Data.to_py(d[1])) for d in msgs]
 
+    def consume(self, num, callback):
+        return self._subscriber.consume(
+            num, lambda t, d: callback(t.string(), Data.to_py(d)))
+
     def available(self):
         return self._subscriber.available()
 
@@ -191,6 +200,29 @@ class SafeSubscriber(Subscriber):
 
         assert False
 
+class ViewSubscriber(Subscriber):
+    """Subscriber subclass that returns views into received messages.
+
+    Regular subscribers convert each message to a Python value right away,
+    which copies the entire content even if the caller only reads a few
+    fields. A ViewSubscriber instead returns View objects for containers that
+    resolve indexing, iteration and len() on demand. All other values convert
+    to the same Python types that Subscriber returns."""
+
+    def get(self, *args, **kwargs):
+        msg = self._subscriber.get_view(*args, **kwargs)
+
+        if msg is None:
+            return None
+
+        if isinstance(msg, tuple):
+            return (msg[0], View._wrap(msg[1]))
+
+        return [(t, View._wrap(v)) for (t, v) in msg]
+
+    def poll(self):
+        return [(t, View._wrap(v)) for (t, v) in self._subscriber.poll_views()]
+
 class StatusSubscriber():
     def __init__(self, internal_subscriber):
         self._subscriber = internal_subscriber
@@ -320,12 +352,25 @@ class Store:
         value = self._store.get(key)
         return Data.to_py(value.get()) if value.is_valid() else None
 
+    def get_many(self, keys):
+        keys = _broker.Vector([Data.from_py(key) for key in keys])
+        values = self._store.get_many(keys)
+        return Data.to_py(values.get()) if values.is_valid() else None
+
     def get_index_from_value(self, key, index):
         key = Data.from_py(key)
         index = Data.from_py(index)
         value = self._store.get_index_from_value(key, index)
         return Data.to_py(value.get()) if value.is_valid() else None
 
+    def query_value(self, key, op, arg=None):
+        """Evaluates a ValueQuery on the value at key inside the store and
+        returns only the result, e.g., the size of a set."""
+        key = Data.from_py(key)
+        arg = Data.from_py(arg)
+        value = self._store.query_value(key, op, arg)
+        return Data.to_py(value.get()) if value.is_valid() else None
+
     def keys(self):
         keys = self._store.keys()
 
@@ -334,6 +379,16 @@ class Store:
 
         return Data.to_py(keys.get()) if keys.is_valid() else None
 
+    def range(self, first, last=None, limit=0):
+        first = Data.from_py(first)
+        last = Data.from_py(last)
+        keys = self._store.range(first, last, limit)
+        return Data.to_py(keys.get()) if keys.is_valid() else None
+
+    def keys_with_prefix(self, prefix, limit=0):
+        keys = self._store.keys_with_prefix(prefix, limit)
+        return Data.to_py(keys.get()) if keys.is_valid() else None
+
     def put(self, key, value, expiry=None):
         key = Data.from_py(key)
         value = Data.from_py(value)
@@ -426,6 +481,11 @@ class Endpoint(_broker.Endpoint):
         represent them. When in doubt, use make_safe_subscriber()."""
         return self.make_subscriber(topics=topics, qsize=qsize, subscriber_class=SafeSubscriber)
 
+    def make_view_subscriber(self, topics, qsize = 20):
+        """A variant of make_subscriber that returns a ViewSubscriber instance.
+        Use this for large messages when processing only parts of them."""
+        return self.make_subscriber(topics=topics, qsize=qsize, subscriber_class=ViewSubscriber)
+
     def make_status_subscriber(self, receive_statuses=False):
         s = _broker.Endpoint.make_status_subscriber(self, receive_statuses)
         return StatusSubscriber(s)
@@ -462,8 +522,13 @@ class Endpoint(_broker.Endpoint):
         result._parent = self
         return result
 
-    def attach_clone(self, name):
-        s = _broker.Endpoint.attach_clone(self, name)
+    def attach_clone(self, name, key_prefix=None):
+        """Attaches a clone of the store name. With key_prefix, the clone only
+        keeps string keys that start with this prefix."""
+        if key_prefix:
+            s = _broker.Endpoint.attach_partial_clone(self, name, key_prefix)
+        else:
+            s = _broker.Endpoint.attach_clone(self, name)
         if not s.is_valid():
             return None
         result = Store(s.get())
@@ -654,6 +719,64 @@ class ImmutableData(Data):
             # Fall back on the Data class for types we handle identically.
             return Data.to_py(d)
 
+class View:
+    """A read-only view into a container of a received message.
+
+    Views access the content of the message in place and convert only the
+    values that the caller actually reads. Nested containers are again views.
+    Call to_py() to convert the entire container to regular Python values.
+    Views keep the received message alive, so they remain valid after the
+    subscriber returns the next message."""
+
+    __slots__ = ('_v',)
+
+    def __init__(self, v):
+        self._v = v
+
+    @staticmethod
+    def _wrap(v):
+        if v.get_type() in (Data.Type.Set, Data.Type.Table, Data.Type.Vector):
+            return View(v)
+        # The Variant API mirrors Data for all other types.
+        return Data.to_py(v)
+
+    def get_type(self):
+        return self._v.get_type()
+
+    def __len__(self):
+        return len(self._v)
+
+    def __iter__(self):
+        return (View._wrap(x) for x in self._v)
+
+    def __contains__(self, key):
+        if isinstance(key, str) and self.get_type() != Data.Type.Vector:
+            return key in self._v
+        return any(Data.to_py(x.to_data()) == key for x in self._v)
+
+    def __getitem__(self, key):
+        return View._wrap(self.view(key))
+
+    def view(self, key):
+        """Returns the unconverted element at key as Variant. For strings,
+        memoryview(view.view(key)) then grants access to the raw bytes
+        without copying them."""
+        if isinstance(key, (int, str)):
+            return self._v[key]
+        for (k, v) in self._v.items():
+            if Data.to_py(k.to_data()) == key:
+                return v
+        raise KeyError(key)
+
+    def items(self):
+        return [(View._wrap(k), View._wrap(v)) for (k, v) in self._v.items()]
+
+    def to_py(self):
+        return Data.to_py(self._v.to_data())
+
+    def __repr__(self):
+        return str(self._v)
+
 ####### TODO: Updated to new Broker API until here.
 
 # # TODO: complete interface
@@ -0,0 +1,132 @@
+"""asyncio integration for subscribers and stores.
+
+Wraps regular Subscriber and Store objects with coroutine versions of their
+blocking calls, so a single event loop can serve many subscriptions:
+
+    async def main():
+        with broker.Endpoint() as ep, ep.make_subscriber("/topic") as sub:
+            async for topic, data in broker.aio.AsyncSubscriber(sub):
+                ...
+
+Subscribers signal new messages through their file descriptor (see
+Subscriber.fd), which requires an event loop that supports add_reader. This is
+the default on all platforms except Windows.
+"""
+
+import asyncio
+
+__all__ = ['AsyncSubscriber', 'AsyncStore']
+
+class AsyncSubscriber:
+    """Wraps a Subscriber (or one of its subclasses) for use with asyncio.
+    Messages have the same format as for the wrapped subscriber."""
+
+    def __init__(self, subscriber):
+        self._subscriber = subscriber
+
+    async def get(self):
+        """Waits for the next message and returns it."""
+        while True:
+            # Zero timeout: returns immediately if no message is available.
+            msg = self._subscriber.get(0.0)
+            if msg is not None:
+                return msg
+            await self._wait()
+
+    async def get_many(self, num):
+        """Waits for at least one message and returns a list with up to num
+        messages."""
+        while True:
+            msgs = self._subscriber.get(num, 0.0)
+            if msgs:
+                return msgs
+            await self._wait()
+
+    def __aiter__(self):
+        return self
+
+    async def __anext__(self):
+        return await self.get()
+
+    async def _wait(self):
+        # The file descriptor stays readable for as long as the subscriber has
+        # messages. Hence, we only register it while waiting.
+        loop = asyncio.get_running_loop()
+        ready = loop.create_future()
+        fd = self._subscriber.fd()
+        loop.add_reader(fd, lambda: ready.done() or ready.set_result(None))
+        try:
+            await ready
+        finally:
+            loop.remove_reader(fd)
+
+class AsyncStore:
+    """Wraps a Store for use with asyncio.
+
+    Lookups run on the default executor of the event loop. Concurrent calls to
+    get() in the same iteration of the event loop share one get_many() request
+    to the store, which saves a round trip per key when many tasks read from
+    the same store."""
+
+    def __init__(self, store):
+        self._store = store
+        # Keys and futures of the next get_many request.
+        self._pending = None
+
+    async def get(self, key):
+        """Returns the value for key or None."""
+        try:
+            hash(key)
+        except TypeError:
+            # Unhashable keys can't be looked up in the result of get_many.
+            return await self._run(self._store.get, key)
+        loop = asyncio.get_running_loop()
+        if self._pending is None:
+            self._pending = []
+            loop.call_soon(self._flush)
+        result = loop.create_future()
+        self._pending.append((key, result))
+        return await result
+
+    async def get_many(self, keys):
+        """Returns a dict with the values of all existing keys."""
+        return await self._run(self._store.get_many, keys)
+
+    async def exists(self, key):
+        return await self._run(self._store.exists, key)
+
+    async def keys(self):
+        return await self._run(self._store.keys)
+
+    async def put(self, key, value, expiry=None):
+        # Writes never block, so there is no need to leave the event loop.
+        return self._store.put(key, value, expiry)
+
+    async def erase(self, key):
+        return self._store.erase(key)
+
+    async def await_idle(self, timeout=None):
+        return await self._run(self._store.await_idle, timeout)
+
+    async def _run(self, fn, *args):
+        # The bindings release the GIL in blocking store calls, so the event
+        # loop keeps running while the executor waits for the store.
+        loop = asyncio.get_running_loop()
+        return await loop.run_in_executor(None, fn, *args)
+
+    def _flush(self):
+        pending, self._pending = self._pending, None
+        keys = list({key for (key, _) in pending})
+        async def fetch():
+            try:
+                values = await self._run(self._store.get_many, keys)
+            except Exception as e:
+                for (_, result) in pending:
+                    if not result.done():
+                        result.set_exception(e)
+                return
+            values = values or {}
+            for (key, result) in pending:
+                if not result.done():
+                    result.set_result(values.get(key))
+        asyncio.ensure_future(fetch())
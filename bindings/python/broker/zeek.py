@@ -57,3 +57,22 @@ class Event(_broker.zeek.Event):
 class SafeEvent(Event):
     def args(self):
         return [broker.ImmutableData.to_py(a) for a in _broker.zeek.Event.args(self)]
+
+def log_write_columns(msgs):
+    """Converts received log writes for the same stream and writer to columns.
+
+    Takes the data of messages received from a ViewSubscriber, i.e., View or
+    Variant objects for LogWrite or LogWriteBatch messages. Returns a dict with
+    the keys stream_id, writer_id, size, path and serial_data. The last two
+    are (values, offsets) tuples in the buffer layout of Arrow's large_binary
+    type, so they convert to Arrow arrays without copying, e.g.:
+
+        values, offsets = cols['serial_data']
+        pyarrow.Array.from_buffers(pyarrow.large_binary(), cols['size'],
+                                   [None, pyarrow.py_buffer(offsets),
+                                    pyarrow.py_buffer(values)])
+
+    Similarly, numpy.frombuffer(offsets, dtype=numpy.int64) returns the
+    offsets as NumPy array."""
+    return _broker.zeek.log_write_columns(
+        [m._v if isinstance(m, broker.View) else m for m in msgs])
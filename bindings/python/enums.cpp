@@ -17,6 +17,7 @@
 #include "broker/peer_flags.hh"
 #include "broker/peer_status.hh"
 #include "broker/status.hh"
+#include "broker/value_query.hh"
 
 namespace py = pybind11;
 
@@ -72,5 +73,12 @@ void init_enums(py::module& m) {
   py::enum_<broker::backend>(m, "Backend")
     .value("Memory", broker::backend::memory)
     .value("SQLite", broker::backend::sqlite)
+    .value("MMap", broker::backend::mmap)
     .export_values();
+
+  py::enum_<broker::value_query>(m, "ValueQuery")
+    .value("Size", broker::value_query::size)
+    .value("Contains", broker::value_query::contains)
+    .value("Slice", broker::value_query::slice)
+    .value("Top", broker::value_query::top);
 }
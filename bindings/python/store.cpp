@@ -17,6 +17,10 @@
 namespace py = pybind11;
 using namespace pybind11::literals;
 
+// Queries and waits block until the master responds. Hence, we release the GIL
+// for these calls.
+using release_gil = py::call_guard<py::gil_scoped_release>;
+
 void init_store(py::module& m) {
   py::class_<std::optional<broker::timespan>>(m, "OptionalTimespan")
     .def(py::init<>())
@@ -41,17 +45,26 @@ void init_store(py::module& m) {
 
   py::class_<broker::store> store(m, "Store");
   store.def("name", &broker::store::name)
-    .def("exists", (broker::expected<broker::data>(broker::store::*)(
-                     broker::data d) const)
-                     & broker::store::exists)
-    .def("get", (broker::expected<broker::data>(broker::store::*)(
-                  broker::data d) const)
-                  & broker::store::get)
+    .def("exists",
+         (broker::expected<broker::data>(broker::store::*)(broker::data d)
+            const)
+           & broker::store::exists,
+         release_gil())
+    .def("get",
+         (broker::expected<broker::data>(broker::store::*)(broker::data d)
+            const)
+           & broker::store::get,
+         release_gil())
+    .def("get_many", &broker::store::get_many, release_gil())
     .def("get_index_from_value",
          (broker::expected<broker::data>(
            broker::store::*)(broker::data d, broker::data index) const)
-           & broker::store::get_index_from_value)
-    .def("keys", &broker::store::keys)
+           & broker::store::get_index_from_value,
+         release_gil())
+    .def("query_value", &broker::store::query_value, release_gil())
+    .def("keys", &broker::store::keys, release_gil())
+    .def("range", &broker::store::range, release_gil())
+    .def("keys_with_prefix", &broker::store::keys_with_prefix, release_gil())
     .def("put", &broker::store::put)
     .def("put_unique", &broker::store::put_unique)
     .def("erase", &broker::store::erase)
@@ -70,11 +83,15 @@ void init_store(py::module& m) {
     .def("remove_from", &broker::store::remove_from)
     .def("push", &broker::store::push)
     .def("pop", &broker::store::pop)
-    .def("await_idle", [](broker::store& st) { return st.await_idle(); })
-    .def("await_idle",
-         [](broker::store& st, broker::timespan timeout) {
-           return st.await_idle(timeout);
-         })
+    .def(
+      "await_idle", [](broker::store& st) { return st.await_idle(); },
+      release_gil())
+    .def(
+      "await_idle",
+      [](broker::store& st, broker::timespan timeout) {
+        return st.await_idle(timeout);
+      },
+      release_gil())
     .def("reset", &broker::store::reset);
 
   // Don't need.
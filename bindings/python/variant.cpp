@@ -0,0 +1,241 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#ifdef __GNUC__
+#  pragma GCC diagnostic push
+#  pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+#include <pybind11/pybind11.h>
+#ifdef __GNUC__
+#  pragma GCC diagnostic pop
+#endif
+
+#include "broker/convert.hh"
+#include "broker/data.hh"
+#include "broker/enum_value.hh"
+#include "broker/variant.hh"
+#include "broker/variant_data.hh"
+#include "broker/variant_list.hh"
+#include "broker/variant_set.hh"
+#include "broker/variant_table.hh"
+
+namespace py = pybind11;
+
+namespace {
+
+// Each variant keeps the envelope of its message alive. Hence, Python objects
+// wrapping a variant may outlive the message they came from.
+
+[[noreturn]] void throw_type_error(const broker::variant& x,
+                                   const char* expected) {
+  std::string msg = "expected ";
+  msg += expected;
+  msg += ", got ";
+  msg += x.get_type_name();
+  throw py::type_error(msg);
+}
+
+size_t len(const broker::variant& x) {
+  switch (x.get_tag()) {
+    case broker::variant_tag::list:
+      return x.to_list().size();
+    case broker::variant_tag::set:
+      return x.to_set().size();
+    case broker::variant_tag::table:
+      return x.to_table().size();
+    default:
+      throw_type_error(x, "a container");
+  }
+}
+
+broker::variant at(const broker::variant& x, py::ssize_t index) {
+  if (!x.is_list())
+    throw_type_error(x, "a vector");
+  auto xs = x.to_list();
+  auto size = static_cast<py::ssize_t>(xs.size());
+  if (index < 0)
+    index += size;
+  if (index < 0 || index >= size)
+    throw py::index_error("vector index out of range");
+  return xs[static_cast<size_t>(index)];
+}
+
+template <class Key>
+broker::variant lookup(const broker::variant& x, const Key& key) {
+  if (!x.is_table())
+    throw_type_error(x, "a table");
+  auto tbl = x.to_table();
+  if (auto i = tbl.find(key); i != tbl.end())
+    return i.value();
+  throw py::key_error("key not found");
+}
+
+broker::variant lookup(const broker::variant& x, const std::string& key) {
+  if (!x.is_table())
+    throw_type_error(x, "a table");
+  // Note: the lookup returns a nil view for missing keys. Hence, we can't
+  // distinguish a missing key from a key that maps to nil.
+  auto result = x.to_table()[std::string_view{key}];
+  if (result.is_none())
+    throw py::key_error(key);
+  return result;
+}
+
+bool contains(const broker::variant& x, const broker::variant_data& key) {
+  if (x.is_set()) {
+    auto* xs = x.to_set().raw();
+    return xs->find(key) != xs->end();
+  }
+  if (x.is_table()) {
+    auto* xs = x.to_table().raw();
+    return xs->find(key) != xs->end();
+  }
+  throw_type_error(x, "a set or table");
+}
+
+} // namespace
+
+void init_variant(py::module& m) {
+  py::class_<broker::variant> variant_type{m, "Variant", py::buffer_protocol()};
+  variant_type
+    .def("get_type", &broker::variant::get_tag)
+    .def("to_data", &broker::variant::to_data)
+    .def("as_address",
+         [](const broker::variant& x) {
+           if (!x.is_address())
+             throw_type_error(x, "an address");
+           return x.to_address();
+         })
+    .def("as_boolean",
+         [](const broker::variant& x) {
+           if (!x.is_boolean())
+             throw_type_error(x, "a boolean");
+           return x.to_boolean();
+         })
+    .def("as_count",
+         [](const broker::variant& x) {
+           if (!x.is_count())
+             throw_type_error(x, "a count");
+           return x.to_count();
+         })
+    .def("as_enum_value",
+         [](const broker::variant& x) {
+           if (!x.is_enum_value())
+             throw_type_error(x, "an enum value");
+           return broker::enum_value{std::string{x.to_enum_value().name}};
+         })
+    .def("as_integer",
+         [](const broker::variant& x) {
+           if (!x.is_integer())
+             throw_type_error(x, "an integer");
+           return x.to_integer();
+         })
+    .def("as_port",
+         [](const broker::variant& x) {
+           if (!x.is_port())
+             throw_type_error(x, "a port");
+           return x.to_port();
+         })
+    .def("as_real",
+         [](const broker::variant& x) {
+           if (!x.is_real())
+             throw_type_error(x, "a real");
+           return x.to_real();
+         })
+    .def("as_string",
+         [](const broker::variant& x) {
+           if (!x.is_string())
+             throw_type_error(x, "a string");
+           auto str = x.to_string();
+           return py::bytes(str.data(), str.size());
+         })
+    .def("as_subnet",
+         [](const broker::variant& x) {
+           if (!x.is_subnet())
+             throw_type_error(x, "a subnet");
+           return x.to_subnet();
+         })
+    .def("as_timespan",
+         [](const broker::variant& x) {
+           if (!x.is_timespan())
+             throw_type_error(x, "a timespan");
+           double s;
+           broker::convert(x.to_timespan(), s);
+           return s;
+         })
+    .def("as_timestamp",
+         [](const broker::variant& x) {
+           if (!x.is_timestamp())
+             throw_type_error(x, "a timestamp");
+           double s;
+           broker::convert(x.to_timestamp(), s);
+           return s;
+         })
+    .def("__len__", len)
+    .def("__getitem__", at)
+    .def("__getitem__",
+         [](const broker::variant& x, const std::string& key) {
+           return lookup(x, key);
+         })
+    .def("__getitem__",
+         [](const broker::variant& x, const broker::variant& key) {
+           return lookup(x, key);
+         })
+    .def("__contains__",
+         [](const broker::variant& x, const broker::variant& key) {
+           return contains(x, *key.raw());
+         })
+    .def("__contains__",
+         [](const broker::variant& x, const std::string& key) {
+           return contains(x, broker::variant_data{std::string_view{key}});
+         })
+    .def(
+      "__iter__",
+      [](const broker::variant& x) -> py::iterator {
+        // Note: iterating a table yields its keys, like a Python dict.
+        switch (x.get_tag()) {
+          case broker::variant_tag::list: {
+            auto xs = x.to_list();
+            return py::make_iterator(xs.begin(), xs.end());
+          }
+          case broker::variant_tag::set: {
+            auto xs = x.to_set();
+            return py::make_iterator(xs.begin(), xs.end());
+          }
+          case broker::variant_tag::table: {
+            auto xs = x.to_table();
+            return py::make_key_iterator(xs.begin(), xs.end());
+          }
+          default:
+            throw_type_error(x, "a container");
+        }
+      },
+      py::keep_alive<0, 1>())
+    .def("items",
+         [](const broker::variant& x) {
+           if (!x.is_table())
+             throw_type_error(x, "a table");
+           py::list result;
+           for (const auto& [key, value] : x.to_table())
+             result.append(py::make_tuple(key, value));
+           return result;
+         })
+    .def("__str__",
+         [](const broker::variant& x) {
+           std::string str;
+           broker::convert(x, str);
+           return str;
+         })
+    .def_buffer([](const broker::variant& x) -> py::buffer_info {
+      // Exposes the bytes of a string without copying them. The buffer points
+      // into the envelope of the message, which outlives the buffer because
+      // the memoryview keeps a reference to the Python object.
+      if (!x.is_string())
+        throw_type_error(x, "a string");
+      auto str = x.to_string();
+      return py::buffer_info(const_cast<char*>(str.data()), 1,
+                             py::format_descriptor<uint8_t>::format(), 1,
+                             {str.size()}, {1}, true);
+    });
+}
@@ -1,7 +1,10 @@
 
+#include <cstdint>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #ifdef __GNUC__
 #  pragma GCC diagnostic push
@@ -14,11 +17,85 @@
 #endif
 
 #include "broker/data.hh"
+#include "broker/variant.hh"
 #include "broker/zeek.hh"
 
 namespace py = pybind11;
 using namespace pybind11::literals;
 
+namespace {
+
+// Stores strings in the layout of Arrow's large binary type: a single buffer
+// with all values plus n + 1 offsets into that buffer.
+struct binary_column {
+  std::string values;
+  std::vector<int64_t> offsets{0};
+
+  void add(std::string_view x) {
+    values.append(x);
+    offsets.push_back(static_cast<int64_t>(values.size()));
+  }
+
+  py::tuple to_py() const {
+    auto* raw_offsets = reinterpret_cast<const char*>(offsets.data());
+    return py::make_tuple(py::bytes(values),
+                          py::bytes(raw_offsets,
+                                    offsets.size() * sizeof(int64_t)));
+  }
+};
+
+// The columns of a sequence of log writes for the same stream and writer.
+struct log_columns {
+  std::string stream_id;
+  std::string writer_id;
+  binary_column paths;
+  binary_column serial_data;
+  size_t size = 0;
+
+  void set_ids(broker::enum_value_view stream, broker::enum_value_view writer) {
+    if (size == 0) {
+      stream_id = stream.name;
+      writer_id = writer.name;
+    } else if (stream.name != stream_id || writer.name != writer_id) {
+      throw std::invalid_argument("log writes for different streams");
+    }
+  }
+
+  void append(const broker::variant& msg) {
+    using broker::zeek::Message;
+    switch (Message::type(msg)) {
+      case Message::Type::LogWrite: {
+        broker::zeek::LogWrite write{msg};
+        if (!write.valid())
+          throw std::invalid_argument("invalid LogWrite data");
+        set_ids(write.stream_id(), write.writer_id());
+        paths.add(write.path_str());
+        serial_data.add(write.serial_data_str());
+        ++size;
+        break;
+      }
+      case Message::Type::LogWriteBatch: {
+        broker::zeek::LogWriteBatch batch{msg};
+        if (!batch.valid())
+          throw std::invalid_argument("invalid LogWriteBatch data");
+        if (batch.empty())
+          break;
+        set_ids(batch.stream_id(), batch.writer_id());
+        for (auto str : batch.paths().strings())
+          paths.add(str);
+        for (auto str : batch.serial_data().strings())
+          serial_data.add(str);
+        size += batch.size();
+        break;
+      }
+      default:
+        throw std::invalid_argument("expected a LogWrite or LogWriteBatch");
+    }
+  }
+};
+
+} // namespace
+
 void init_zeek(py::module& m) {
   py::class_<broker::zeek::Message>(m, "Message")
     .def("as_data", [](const broker::zeek::Message& msg) {
@@ -87,4 +164,32 @@ void init_zeek(py::module& m) {
       convert(args, result);
       return result;
     });
+  m.def(
+    "log_write_columns",
+    [](const py::list& msgs) {
+      std::vector<broker::variant> xs;
+      xs.reserve(msgs.size());
+      for (auto msg : msgs)
+        xs.emplace_back(msg.cast<broker::variant>());
+      // Collecting the columns only touches the received messages, so other
+      // Python threads may run in the meantime.
+      log_columns cols;
+      {
+        py::gil_scoped_release guard;
+        cols.paths.offsets.reserve(xs.size() + 1);
+        cols.serial_data.offsets.reserve(xs.size() + 1);
+        for (const auto& x : xs)
+          cols.append(x);
+      }
+      py::dict result;
+      result["stream_id"] = cols.stream_id;
+      result["writer_id"] = cols.writer_id;
+      result["size"] = cols.size;
+      result["path"] = cols.paths.to_py();
+      result["serial_data"] = cols.serial_data.to_py();
+      return result;
+    },
+    "Converts log writes to columns in the layout of Arrow's large binary "
+    "type, i.e., as tuples with a buffer for the values and a buffer with "
+    "n + 1 64-bit offsets");
 }
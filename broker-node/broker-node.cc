@@ -1,15 +1,26 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cerrno>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <exception>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <map>
 #include <mutex>
+#include <optional>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -22,11 +33,13 @@
 #include <caf/init_global_meta_objects.hpp>
 #include <caf/scoped_actor.hpp>
 #include <caf/send.hpp>
+#include <caf/settings.hpp>
 #include <caf/term.hpp>
 #include <caf/type_id.hpp>
 #include <caf/uri.hpp>
 
 #include "broker/builder.hh"
+#include "broker/config.hh"
 #include "broker/configuration.hh"
 #include "broker/convert.hh"
 #include "broker/data.hh"
@@ -43,6 +56,11 @@
 #include "broker/variant.hh"
 #include "broker/variant_list.hh"
 
+#ifndef BROKER_WINDOWS
+#  include <sys/resource.h>
+#  include <sys/time.h>
+#endif
+
 using namespace std::literals;
 
 using std::string;
@@ -142,7 +160,10 @@ void extend_config(broker::configuration& broker_cfg) {
     .add<bool>("rate,r", "print rate once per second ('relay' mode only)")
     .add<string>("name,N", "set node name in verbose output")
     .add<string_list>("topics,t", "topics for sending/receiving messages")
-    .add<std::string>("mode,m", "'relay' (default), 'ping', or 'pong'")
+    .add<std::string>("mode,m",
+                      "'relay' (default), 'ping', 'pong', or 'bench'")
+    .add<string>("topology", "topology file for 'bench' mode (starts all "
+                             "nodes of the topology if no name is given)")
     .add<size_t>("payload-size,s",
                  "additional number of bytes for the ping message")
     .add<timespan>("rendezvous-retry",
@@ -320,6 +341,308 @@ void pong_mode(broker::endpoint& ep, topic_list topics) {
   }
 }
 
+// -- benchmark mode -----------------------------------------------------------
+
+/// Configures a publisher in benchmark mode.
+struct publisher_config {
+  topic dst;
+
+  /// Messages per second. A value of 0 publishes as fast as possible.
+  size_t rate = 0;
+
+  size_t payload_size = 0;
+};
+
+/// Configures the benchmark mode. Nodes pick up their configuration from a
+/// topology file (see `load_topology`).
+struct bench_config {
+  std::vector<publisher_config> publishers;
+  topic_list subscriptions;
+  timespan warmup = std::chrono::seconds(1);
+  timespan duration = std::chrono::seconds(10);
+};
+
+bench_config bench;
+
+/// Prefix for the summary line that nodes in benchmark mode print when done.
+constexpr std::string_view stats_prefix = "stats";
+
+broker::list_builder make_bench_msg(size_t payload_size) {
+  return broker::list_builder{}
+    .add("bench"sv)
+    .add(broker::now())
+    .add(std::string(payload_size, 'x'));
+}
+
+bool is_bench_msg(const broker::variant& x) {
+  auto&& xs = x.to_list();
+  return xs.size() == 3 && xs[0].to_string() == "bench" && xs[1].is_timestamp()
+         && xs[2].is_string();
+}
+
+/// Returns user and system CPU time of this process.
+timespan cpu_time() {
+#ifndef BROKER_WINDOWS
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return timespan{0};
+  auto to_timespan = [](const timeval& tv) {
+    return std::chrono::duration_cast<timespan>(
+      std::chrono::seconds(tv.tv_sec) + std::chrono::microseconds(tv.tv_usec));
+  };
+  return to_timespan(usage.ru_utime) + to_timespan(usage.ru_stime);
+#else
+  return timespan{0};
+#endif
+}
+
+void bench_mode(broker::endpoint& ep, topic_list) {
+  std::optional<broker::subscriber> in;
+  if (!bench.subscriptions.empty())
+    in.emplace(ep.make_subscriber(bench.subscriptions));
+  // Give subscriptions some time to propagate through the network.
+  verbose::println("warm up for ", bench.warmup);
+  std::this_thread::sleep_for(bench.warmup);
+  verbose::println("run benchmark for ", bench.duration);
+  std::atomic<bool> done{false};
+  std::atomic<size_t> sent{0};
+  std::vector<std::thread> threads;
+  for (auto& cfg : bench.publishers) {
+    threads.emplace_back([&ep, &done, &sent, cfg] {
+      auto out = ep.make_publisher(cfg.dst);
+      auto interval = timespan{0};
+      if (cfg.rate > 0)
+        interval = timespan{std::chrono::seconds(1)}
+                   / static_cast<int64_t>(cfg.rate);
+      auto next = std::chrono::steady_clock::now();
+      while (!done) {
+        if (cfg.rate > 0) {
+          next += interval;
+          std::this_thread::sleep_until(next);
+        }
+        // Blocks when the core applies back-pressure.
+        out.publish(make_bench_msg(cfg.payload_size));
+        ++sent;
+      }
+    });
+  }
+  auto cpu_start = cpu_time();
+  auto start = std::chrono::system_clock::now();
+  auto deadline = start + bench.duration;
+  size_t received = 0;
+  std::vector<timespan> latencies;
+  if (in) {
+    while (auto maybe_msg = in->get(deadline)) {
+      auto val = get_data(*maybe_msg);
+      if (!is_bench_msg(val))
+        continue;
+      ++received;
+      auto sent_at = val.to_list().at(1).to_timestamp();
+      latencies.emplace_back(broker::now() - sent_at);
+    }
+  } else {
+    std::this_thread::sleep_until(deadline);
+  }
+  done = true;
+  for (auto& hdl : threads)
+    hdl.join();
+  auto cpu = cpu_time() - cpu_start;
+  auto elapsed = std::chrono::system_clock::now() - start;
+  // Print a summary line that the coordinator can parse.
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) -> count {
+    if (latencies.empty())
+      return 0;
+    auto index = static_cast<size_t>(p * (latencies.size() - 1));
+    return static_cast<count>(latencies[index].count());
+  };
+  using fractional_seconds = std::chrono::duration<double>;
+  auto secs = std::chrono::duration_cast<fractional_seconds>(elapsed).count();
+  auto cpu_secs = std::chrono::duration_cast<fractional_seconds>(cpu).count();
+  out::println(stats_prefix, " name=", node_name, " sent=", sent.load(),
+               " received=", received, " seconds=", secs,
+               " p50=", percentile(0.5), " p90=", percentile(0.9),
+               " p99=", percentile(0.99), " max=", percentile(1.0),
+               " cpu=", cpu_secs);
+}
+
+// -- topology support ---------------------------------------------------------
+
+/// Stores the parameters of a single node in a topology file.
+struct topology_node {
+  std::optional<uint16_t> port;
+  std::vector<broker::network_info> peers;
+  topic_list topics;
+};
+
+/// Reads the configuration for node `name` from a topology file. Topology files
+/// use CAF's config syntax and list all nodes under `nodes`, e.g.:
+///
+/// ~~~
+/// warmup = 1s
+/// duration = 10s
+/// nodes {
+///   manager {
+///     port = 9001
+///     subscribe = ["/bench/logs"]
+///   }
+///   worker-1 {
+///     peers = ["manager"]
+///     publish {
+///       logs { topic = "/bench/logs", rate = 1000, payload-size = 100 }
+///     }
+///   }
+/// }
+/// ~~~
+///
+/// Nodes may set `host` (default: localhost) for peers on other machines.
+expected<topology_node> load_topology(const caf::settings& topo,
+                                      const string& name) {
+  auto nodes = get_if<settings>(&topo, "nodes");
+  if (!nodes)
+    return make_error(sec::invalid_argument, "topology has no nodes");
+  auto node = get_if<settings>(nodes, name);
+  if (!node)
+    return make_error(sec::invalid_argument, "no such node: " + name);
+  topology_node result;
+  if (auto port = get_as<uint16_t>(*node, "port"))
+    result.port = *port;
+  for (const auto& peer : get_or(*node, "peers", string_list{})) {
+    auto peer_node = get_if<settings>(nodes, peer);
+    if (!peer_node)
+      return make_error(sec::invalid_argument, "no such peer: " + peer);
+    auto peer_port = get_as<uint16_t>(*peer_node, "port");
+    if (!peer_port)
+      return make_error(sec::invalid_argument, "peer has no port: " + peer);
+    result.peers.emplace_back(get_or(*peer_node, "host", "localhost"),
+                              *peer_port, broker::timeout::seconds(1));
+  }
+  bench.warmup = get_or(topo, "warmup", bench.warmup);
+  bench.duration = get_or(topo, "duration", bench.duration);
+  for (const auto& str : get_or(*node, "subscribe", string_list{}))
+    bench.subscriptions.emplace_back(str);
+  if (auto pubs = get_if<settings>(node, "publish")) {
+    for (const auto& kvp : *pubs) {
+      auto pub = get_if<settings>(&kvp.second);
+      auto dst = pub ? get_if<string>(pub, "topic") : nullptr;
+      if (!dst)
+        return make_error(sec::invalid_argument,
+                          "publisher without topic: " + kvp.first);
+      publisher_config cfg;
+      cfg.dst = topic{*dst};
+      cfg.rate = get_or(*pub, "rate", size_t{0});
+      cfg.payload_size = get_or(*pub, "payload-size", default_payload_size);
+      bench.publishers.emplace_back(std::move(cfg));
+    }
+  }
+  // Make sure the node forwards all topics it publishes or subscribes to.
+  result.topics = bench.subscriptions;
+  for (const auto& pub : bench.publishers)
+    result.topics.emplace_back(pub.dst);
+  return result;
+}
+
+/// Starts one broker-node process per node in the topology, waits for all of
+/// them to finish their benchmark and prints a summary.
+int coordinate(const char* program, const string& topology_file,
+               const caf::settings& topo) {
+#ifdef BROKER_WINDOWS
+  err::println("the coordinator is not supported on Windows");
+  return EXIT_FAILURE;
+#else
+  auto nodes = get_if<settings>(&topo, "nodes");
+  if (!nodes || nodes->empty()) {
+    err::println("topology has no nodes");
+    return EXIT_FAILURE;
+  }
+  auto quote = [](const string& str) {
+    string result = "'";
+    for (auto ch : str) {
+      if (ch == '\'')
+        result += "'\\''";
+      else
+        result += ch;
+    }
+    result += '\'';
+    return result;
+  };
+  // Start all nodes first. They run in parallel while we read their output.
+  std::vector<std::pair<string, FILE*>> children;
+  for (const auto& kvp : *nodes) {
+    auto cmd = quote(program) + " --topology=" + quote(topology_file)
+               + " --name=" + quote(kvp.first);
+    if (verbose::enabled())
+      cmd += " --verbose";
+    verbose::println("start node ", kvp.first);
+    if (auto fd = popen(cmd.c_str(), "r")) {
+      children.emplace_back(kvp.first, fd);
+    } else {
+      err::println("unable to start node ", kvp.first);
+      for (auto& child : children)
+        pclose(child.second);
+      return EXIT_FAILURE;
+    }
+  }
+  // Collect the summary lines.
+  std::map<string, std::map<string, string>> results;
+  for (auto& [name, fd] : children) {
+    std::array<char, 1024> buf;
+    while (fgets(buf.data(), static_cast<int>(buf.size()), fd)) {
+      string line = buf.data();
+      if (line.compare(0, stats_prefix.size(), stats_prefix) != 0) {
+        // Forward verbose output of the node.
+        out::println(name, ": ", line.substr(0, line.find('\n')));
+        continue;
+      }
+      auto& fields = results[name];
+      std::istringstream in{line.substr(stats_prefix.size())};
+      string field;
+      while (in >> field)
+        if (auto sep = field.find('='); sep != string::npos)
+          fields[field.substr(0, sep)] = field.substr(sep + 1);
+    }
+    if (pclose(fd) != 0)
+      err::println("node ", name, " terminated with an error");
+  }
+  // Print the summary.
+  auto to_double = [](const std::map<string, string>& fields,
+                      const string& key) {
+    auto i = fields.find(key);
+    return i != fields.end() ? std::strtod(i->second.c_str(), nullptr) : 0.0;
+  };
+  auto print_row = [](const auto&... xs) {
+    std::ostringstream row;
+    ((row << std::setw(14) << xs), ...);
+    out::println(row.str());
+  };
+  print_row("node", "sent/s", "received/s", "p50 (ms)", "p99 (ms)",
+            "max (ms)", "cpu (%)");
+  double total_sent = 0;
+  double total_received = 0;
+  for (const auto& [name, fields] : results) {
+    auto secs = to_double(fields, "seconds");
+    if (secs <= 0)
+      secs = 1;
+    auto sent = to_double(fields, "sent") / secs;
+    auto received = to_double(fields, "received") / secs;
+    total_sent += sent;
+    total_received += received;
+    auto ms = [&](const string& key) { return to_double(fields, key) / 1e6; };
+    print_row(name, std::lround(sent), std::lround(received), ms("p50"),
+              ms("p99"), ms("max"),
+              std::lround(to_double(fields, "cpu") / secs * 100));
+  }
+  print_row("total", std::lround(total_sent), std::lround(total_received), "",
+            "", "", "");
+  if (results.size() != nodes->size()) {
+    err::println("only ", results.size(), " of ", nodes->size(),
+                 " nodes reported statistics");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+#endif
+}
+
 } // namespace
 
 // Converts plain port numbers and Zeek-style "<num>/<proto>" notation into a
@@ -349,6 +672,28 @@ int main(int argc, char** argv) try {
   }
   if (cfg.cli_helptext_printed())
     return EXIT_SUCCESS;
+  // Load the topology file if present. Without a node name, this process
+  // becomes the coordinator for all nodes in the topology.
+  std::optional<topology_node> topo_node;
+  if (auto topology_file = get_as<string>(cfg, "topology")) {
+    auto topo = actor_system_config::parse_config_file(topology_file->c_str());
+    if (!topo) {
+      err::println("unable to parse topology file: ", to_string(topo.error()));
+      return EXIT_FAILURE;
+    }
+    auto name = get_as<string>(cfg, "name");
+    if (!name) {
+      auto& native_cfg = broker::internal::configuration_access(&cfg).cfg();
+      verbose::enabled(caf::get_or(native_cfg, "verbose", false));
+      return coordinate(argv[0], *topology_file, *topo);
+    }
+    if (auto res = load_topology(*topo, *name)) {
+      topo_node = std::move(*res);
+    } else {
+      err::println("invalid topology: ", to_string(res.error()));
+      return EXIT_FAILURE;
+    }
+  }
   // Pick up BROKER_PORT environment variable.
   if (auto env = getenv("BROKER_PORT")) {
     cfg.set("global.port", string{env});
@@ -364,13 +709,15 @@ int main(int argc, char** argv) try {
     eid = broker::endpoint_id::random();
   }
   broker::endpoint ep{std::move(cfg), eid};
-  // Get mode.
-  auto mode = get_or(ep, "mode", "relay");
+  // Get mode. Nodes of a topology always run in benchmark mode.
+  auto mode = topo_node ? "bench"s : get_or(ep, "mode", "relay");
   // Get process name, using the mode name as fallback.
   node_name = get_or(ep, "name", mode);
   // Get topics (mandatory) and make sure this endpoint at least forwards them.
   topic_list topics;
-  { // Lifetime scope of temporary variables.
+  if (topo_node) {
+    topics = topo_node->topics;
+  } else { // Lifetime scope of temporary variables.
     auto topic_names = get_or(ep, "topics", string_list{});
     if (topic_names.empty()) {
       err::println("no topics specified");
@@ -392,7 +739,10 @@ int main(int argc, char** argv) try {
                  });
   }
   // Publish endpoint at demanded port.
-  if (auto port = get_as<broker::port>(ep, "port")) {
+  if (topo_node && topo_node->port) {
+    verbose::println("listen for peers on port ", *topo_node->port);
+    ep.listen({}, *topo_node->port);
+  } else if (auto port = get_as<broker::port>(ep, "port")) {
     verbose::println("listen for peers on port ", port->number());
     ep.listen({}, port->number());
   }
@@ -404,6 +754,8 @@ int main(int argc, char** argv) try {
     f = ping_mode;
   } else if (mode == "pong") {
     f = pong_mode;
+  } else if (mode == "bench") {
+    f = bench_mode;
   } else {
     err::println("invalid mode: ", mode);
     return EXIT_FAILURE;
@@ -430,28 +782,32 @@ int main(int argc, char** argv) try {
     }
   }
   // Connect to peers.
-  auto peers = get_or(ep, "peers", uri_list{});
-  for (auto& peer : peers) {
-    if (auto info = broker::to<broker::network_info>(peer)) {
-      verbose::println("connect to ", info->address, " on port ", info->port,
-                       " ...");
-      if (!ep.peer(*info))
-        err::println("unable to connect to <", peer, '>');
-    } else {
-      err::println("unrecognized scheme (expected tcp) or no authority in: <",
-                   peer, '>');
+  std::vector<broker::network_info> peers;
+  if (topo_node) {
+    peers = topo_node->peers;
+  } else {
+    for (auto& peer : get_or(ep, "peers", uri_list{})) {
+      if (auto info = broker::to<broker::network_info>(peer)) {
+        peers.emplace_back(std::move(*info));
+      } else {
+        err::println("unrecognized scheme (expected tcp) or no authority in: <",
+                     peer, '>');
+      }
     }
   }
+  for (auto& info : peers) {
+    verbose::println("connect to ", info.address, " on port ", info.port,
+                     " ...");
+    if (!ep.peer(info))
+      err::println("unable to connect to ", info.address, " on port ",
+                   info.port);
+  }
   f(ep, std::move(topics));
   // Disconnect from peers.
-  for (auto& peer : peers) {
-    auto& auth = peer.authority();
-    if (peer.scheme() == "tcp" && !auth.empty()) {
-      auto host = caf::deep_to_string(auth.host);
-      auto port = auth.port;
-      verbose::println("diconnect from ", host, " on port ", port, " ...");
-      ep.unpeer_nosync(host, port);
-    }
+  for (auto& info : peers) {
+    verbose::println("diconnect from ", info.address, " on port ", info.port,
+                     " ...");
+    ep.unpeer_nosync(info.address, info.port);
   }
   // Stop utility actors.
   anon_send_exit(verbose_logger, exit_reason::user_shutdown);
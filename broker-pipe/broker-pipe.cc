@@ -5,12 +5,14 @@
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <exception>
 #include <future>
 #include <iostream>
 #include <iterator>
 #include <limits>
 #include <mutex>
+#include <new>
 #include <stdexcept>
 #include <string>
 #include <thread>
@@ -31,9 +33,35 @@
 #include "broker/topic.hh"
 
 #ifndef BROKER_WINDOWS
+#  include <sys/resource.h>
 #  include <sys/select.h>
 #endif // BROKER_WINDOWS
 
+// -- allocation counting ------------------------------------------------------
+
+namespace {
+
+/// Counts all calls to `operator new` in this process, including the
+/// allocations of Broker and CAF.
+std::atomic<size_t> alloc_count{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  if (auto ptr = malloc(size > 0 ? size : 1))
+    return ptr;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
 namespace atom = broker::internal::atom;
 
 using broker::data;
@@ -65,6 +93,9 @@ struct parameters {
   uint64_t message_cap = std::numeric_limits<uint64_t>::max();
 };
 
+/// Configures how many messages the batched implementations process at once.
+uint64_t batch_size = 128;
+
 // Adds custom configuration options to the config object.
 void extend_config(parameters& param, broker::configuration& cfg) {
   cfg.add_option(&rate, "rate,r",
@@ -78,7 +109,10 @@ void extend_config(parameters& param, broker::configuration& cfg) {
                  "topic for sending/receiving messages");
   cfg.add_option(&param.mode, "mode,m", "set mode ('publish' or 'subscribe')");
   cfg.add_option(&param.impl, "impl,i",
-                 "set mode implementation ('blocking', 'select', or 'stream')");
+                 "set mode implementation ('blocking', 'select', 'stream', or "
+                 "'batched')");
+  cfg.add_option(&batch_size, "batch-size,b",
+                 "maximum number of messages per call in 'batched' mode");
   cfg.add_option(&param.message_cap, "message-cap,c",
                  "set a maximum for received/sent messages");
 }
@@ -197,6 +231,80 @@ void subscribe_mode_stream(broker::endpoint& ep, const std::string& topic_str,
     });
   ep.wait_for(worker);
 }
+
+// Publishes up to `batch_size` lines per call, reusing the same buffer.
+void publish_mode_batched(broker::endpoint& ep, const std::string& topic_str,
+                          size_t cap) {
+  auto out = ep.make_publisher(topic_str);
+  std::vector<data> buf;
+  buf.reserve(batch_size);
+  std::string line;
+  size_t i = 0;
+  while (i < cap) {
+    auto num = std::min<size_t>(cap - i, batch_size);
+    buf.clear();
+    while (buf.size() < num && std::getline(std::cin, line))
+      buf.emplace_back(std::move(line));
+    if (!buf.empty())
+      out.publish(buf);
+    i += buf.size();
+    msg_count += buf.size();
+    if (buf.size() < num)
+      return; // Reached end of STDIO.
+  }
+}
+
+// Receives up to `batch_size` messages per call, reusing the same buffer.
+void subscribe_mode_batched(broker::endpoint& ep, const std::string& topic_str,
+                            size_t cap) {
+  auto in = ep.make_subscriber({topic_str});
+  std::vector<data_message> buf;
+  buf.reserve(batch_size);
+  size_t i = 0;
+  while (i < cap) {
+    if (in.poll(buf, std::min<size_t>(cap - i, batch_size)) == 0) {
+      // Block until at least one message arrives.
+      buf.emplace_back(in.get());
+    }
+    if (!rate)
+      for (const auto& msg : buf)
+        print_line(std::cout, to_string(msg));
+    i += buf.size();
+    msg_count += buf.size();
+  }
+}
+
+/// Captures the counters for computing the per-message overhead.
+struct overhead_snapshot {
+  size_t allocations = 0;
+  long context_switches = 0;
+
+  static overhead_snapshot now() {
+    overhead_snapshot result;
+    result.allocations = alloc_count.load();
+#ifndef BROKER_WINDOWS
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+      result.context_switches = usage.ru_nvcsw + usage.ru_nivcsw;
+#endif
+    return result;
+  }
+};
+
+void print_overhead(const overhead_snapshot& before,
+                    const overhead_snapshot& after) {
+  size_t n = msg_count;
+  if (n == 0)
+    return;
+  auto per_msg = [n](double x) { return std::to_string(x / n); };
+  auto allocs = static_cast<double>(after.allocations - before.allocations);
+  auto switches = static_cast<double>(after.context_switches
+                                      - before.context_switches);
+  print_line(std::cerr, "*** " + std::to_string(n) + " messages, "
+                          + per_msg(allocs) + " allocations/msg, "
+                          + per_msg(switches) + " context switches/msg");
+}
+
 void split(std::vector<std::string>& result, std::string_view str,
            std::string_view delims, bool keep_all = true) {
   size_t pos = 0;
@@ -291,16 +399,24 @@ int main(int argc, char** argv) try {
   }
   using mode_fun = void (*)(broker::endpoint&, const std::string&, size_t);
   mode_fun fs[] = {publish_mode_blocking,   publish_mode_select,
-                   subscribe_mode_blocking, subscribe_mode_select,
-                   subscribe_mode_stream,   dummy_mode};
+                   publish_mode_batched,    subscribe_mode_blocking,
+                   subscribe_mode_select,   subscribe_mode_stream,
+                   subscribe_mode_batched,  dummy_mode};
   std::pair<std::string, std::string> as[] = {
-    {"publish", "blocking"}, {"publish", "select"},   {"subscribe", "blocking"},
-    {"subscribe", "select"}, {"subscribe", "stream"},
+    {"publish", "blocking"},  {"publish", "select"},   {"publish", "batched"},
+    {"subscribe", "blocking"}, {"subscribe", "select"}, {"subscribe", "stream"},
+    {"subscribe", "batched"},
   };
   auto b = std::begin(as);
   auto i = std::find(b, std::end(as), std::make_pair(params.mode, params.impl));
   auto f = fs[std::distance(b, i)];
+  if (params.impl == "batched" && batch_size == 0) {
+    std::cerr << "*** batch-size must be greater than 0\n";
+    return EXIT_FAILURE;
+  }
+  auto before = overhead_snapshot::now();
   f(ep, params.topic, params.message_cap);
+  print_overhead(before, overhead_snapshot::now());
 } catch (std::exception& ex) {
   std::cerr << "*** exception: " << ex.what() << "\n";
   return EXIT_FAILURE;
@@ -0,0 +1,312 @@
+// Replays capture files of the flight recorder (see
+// `broker.flight-recorder.directory`) into a live endpoint, either at a fixed
+// rate or as fast as possible.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <caf/error.hpp>
+
+#include "broker/config.hh"
+#include "broker/configuration.hh"
+#include "broker/endpoint.hh"
+#include "broker/expected.hh"
+#include "broker/internal/flight_recorder.hh"
+#include "broker/internal/type_id.hh"
+#include "broker/message.hh"
+#include "broker/time.hh"
+
+using namespace std::literals;
+
+using broker::data_message;
+using broker::node_message;
+using broker::internal::flight_recorder;
+
+namespace {
+
+std::mutex cout_mtx;
+
+using guard_type = std::unique_lock<std::mutex>;
+
+void print_line(std::ostream& out, const std::string& line) {
+  guard_type guard{cout_mtx};
+  out << line << std::endl;
+}
+
+struct parameters {
+  std::vector<std::string> files;
+  std::vector<std::string> peers;
+  uint64_t local_port = 0;
+  double rate = 0.0;
+  uint64_t publishers = 1;
+  uint64_t batch_size = 64;
+  uint64_t message_cap = std::numeric_limits<uint64_t>::max();
+};
+
+// Adds custom configuration options to the config object.
+void extend_config(parameters& param, broker::configuration& cfg) {
+  cfg.add_option(&param.files, "files,f",
+                 "capture files of the flight recorder, replayed in order");
+  cfg.add_option(&param.peers, "peers,p",
+                 "list of peers we connect to on startup (host:port notation)");
+  cfg.add_option(&param.local_port, "local-port,l",
+                 "local port for publishing this endpoint at (ignored if 0)");
+  cfg.add_option(&param.rate, "rate,r",
+                 "number of messages per second over all publishers (0 = "
+                 "maximum rate)");
+  cfg.add_option(&param.publishers, "publishers,n",
+                 "number of threads that publish in parallel");
+  cfg.add_option(&param.batch_size, "batch-size,b",
+                 "maximum number of messages per call to publish");
+  cfg.add_option(&param.message_cap, "message-cap,c",
+                 "set a maximum for sent messages per publisher");
+}
+
+/// Approximates the distribution of delays with power-of-two buckets.
+class delay_histogram {
+public:
+  void add(std::chrono::microseconds x) {
+    auto val = static_cast<uint64_t>(std::max(x.count(), int64_t{0}));
+    size_t index = 0;
+    while (val > 0 && index + 1 < buckets_.size()) {
+      val >>= 1;
+      ++index;
+    }
+    ++buckets_[index];
+    ++total_;
+  }
+
+  void merge(const delay_histogram& other) {
+    for (size_t i = 0; i < buckets_.size(); ++i)
+      buckets_[i] += other.buckets_[i];
+    total_ += other.total_;
+  }
+
+  /// Returns the upper bound of the bucket that contains the percentile `p`.
+  std::chrono::microseconds percentile(double p) const {
+    auto threshold = static_cast<uint64_t>(p * static_cast<double>(total_));
+    uint64_t sum = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+      sum += buckets_[i];
+      if (sum > threshold || sum == total_)
+        return std::chrono::microseconds{i == 0 ? 0 : (int64_t{1} << i) - 1};
+    }
+    return std::chrono::microseconds{0};
+  }
+
+private:
+  std::array<uint64_t, 40> buckets_{};
+  uint64_t total_ = 0;
+};
+
+struct replay_stats {
+  std::atomic<size_t> published{0};
+  std::atomic<size_t> skipped{0};
+  std::mutex mtx;
+  delay_histogram delays;
+};
+
+/// Publishes the data messages of one share of the recording. Publisher `id`
+/// out of `n` replays every n-th message.
+class replayer {
+public:
+  using clock_type = std::chrono::steady_clock;
+
+  replayer(broker::endpoint& ep, const parameters& params, size_t id,
+           clock_type::time_point start, replay_stats& stats)
+    : ep_(ep), params_(params), id_(id), start_(start), stats_(stats) {
+    buf_.reserve(params.batch_size);
+  }
+
+  void run(const std::vector<node_message>& xs) {
+    for (auto index = id_; index < xs.size(); index += params_.publishers)
+      if (!publish(xs[index], index))
+        break;
+    flush();
+    guard_type guard{stats_.mtx};
+    stats_.delays.merge(delays_);
+  }
+
+private:
+  /// Publishes the message at `index` of the recording.
+  /// @returns `false` if the publisher reached its message cap.
+  bool publish(const node_message& x, size_t index) {
+    if (get_type(x) != broker::envelope_type::data) {
+      // Commands only make sense to the data stores of the original nodes.
+      ++stats_.skipped;
+      return true;
+    }
+    if (params_.rate > 0) {
+      // Capture files have no timestamps. Hence, we spread the messages evenly
+      // at the requested rate.
+      auto offset = std::chrono::duration<double>(static_cast<double>(index)
+                                                  / params_.rate);
+      auto due = start_
+                 + std::chrono::duration_cast<clock_type::duration>(offset);
+      auto now = clock_type::now();
+      if (due > now) {
+        flush();
+        std::this_thread::sleep_until(due);
+        now = clock_type::now();
+      }
+      using std::chrono::microseconds;
+      delays_.add(std::chrono::duration_cast<microseconds>(now - due));
+    }
+    buf_.emplace_back(x->as_data());
+    if (buf_.size() >= params_.batch_size)
+      flush();
+    return ++sent_ < params_.message_cap;
+  }
+
+  void flush() {
+    if (buf_.empty())
+      return;
+    stats_.published += buf_.size();
+    ep_.publish(std::move(buf_));
+    buf_.clear();
+  }
+
+  broker::endpoint& ep_;
+  const parameters& params_;
+  size_t id_;
+  clock_type::time_point start_;
+  replay_stats& stats_;
+  std::vector<data_message> buf_;
+  uint64_t sent_ = 0;
+  delay_histogram delays_;
+};
+
+void split(std::vector<std::string>& result, std::string_view str,
+           std::string_view delims) {
+  size_t pos = 0;
+  size_t prev = 0;
+  while ((pos = str.find_first_of(delims, prev)) != std::string::npos) {
+    result.emplace_back(str.substr(prev, pos - prev));
+    prev = pos + 1;
+  }
+  result.emplace_back(str.substr(prev));
+}
+
+std::string to_ms_string(std::chrono::microseconds x) {
+  return std::to_string(static_cast<double>(x.count()) / 1000.0) + "ms";
+}
+
+} // namespace
+
+int main(int argc, char** argv) try {
+  broker::endpoint::system_guard sys_guard;
+  // Parse CLI parameters using our config.
+  parameters params;
+  broker::configuration cfg{broker::skip_init};
+  extend_config(params, cfg);
+  try {
+    cfg.init(argc, argv);
+  } catch (std::exception& ex) {
+    std::cerr << "*** error while reading config: " << ex.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (cfg.cli_helptext_printed()) {
+    return EXIT_SUCCESS;
+  } else if (!cfg.remainder().empty()) {
+    std::cerr << "*** too many arguments\n\n";
+    return EXIT_FAILURE;
+  } else if (params.files.empty()) {
+    std::cerr << "*** no capture files given (see --files)\n\n";
+    return EXIT_FAILURE;
+  } else if (params.publishers == 0 || params.batch_size == 0) {
+    std::cerr << "*** publishers and batch-size must be greater than 0\n\n";
+    return EXIT_FAILURE;
+  }
+  // Load the recording before connecting to anyone.
+  std::vector<node_message> recording;
+  for (const auto& fname : params.files) {
+    auto xs = flight_recorder::load(fname);
+    if (!xs) {
+      std::cerr << "*** unable to load " << fname << ": "
+                << to_string(xs.error()) << std::endl;
+      return EXIT_FAILURE;
+    }
+    recording.insert(recording.end(), std::make_move_iterator(xs->begin()),
+                     std::make_move_iterator(xs->end()));
+  }
+  broker::endpoint ep{std::move(cfg)};
+  // Publish endpoint at demanded port.
+  if (params.local_port != 0)
+    ep.listen({}, params.local_port);
+  // Connect to the requested peers.
+  for (auto& p : params.peers) {
+    std::vector<std::string> fields;
+    split(fields, p, ":");
+    if (fields.size() != 2) {
+      std::cerr << "*** invalid peer: " << p << std::endl;
+      return EXIT_FAILURE;
+    }
+    uint16_t port;
+    try {
+      port = static_cast<uint16_t>(std::stoi(fields.back()));
+    } catch (std::exception&) {
+      std::cerr << "*** invalid port: " << fields.back() << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (!ep.peer(fields.front(), port)) {
+      std::cerr << "*** unable to peer with " << p << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  // Replay the recording and print the throughput once per second.
+  replay_stats stats;
+  std::atomic<bool> done{false};
+  auto rate_printer = std::thread{[&stats, &done] {
+    size_t prev = 0;
+    while (!done) {
+      std::this_thread::sleep_for(1s);
+      size_t current = stats.published;
+      print_line(std::cout, std::to_string(current - prev) + " msg/s");
+      prev = current;
+    }
+  }};
+  auto start = replayer::clock_type::now();
+  std::vector<std::thread> threads;
+  for (size_t id = 0; id < params.publishers; ++id)
+    threads.emplace_back([&, id] {
+      replayer worker{ep, params, id, start, stats};
+      worker.run(recording);
+    });
+  for (auto& hdl : threads)
+    hdl.join();
+  auto runtime = replayer::clock_type::now() - start;
+  done = true;
+  rate_printer.join();
+  // Print a summary.
+  using fractional_seconds = std::chrono::duration<double>;
+  auto secs = std::chrono::duration_cast<fractional_seconds>(runtime).count();
+  size_t published = stats.published;
+  std::cout << "*** published " << published << " messages in " << secs
+            << "s (" << static_cast<double>(published) / secs << " msg/s), "
+            << "skipped " << stats.skipped << " commands\n";
+  if (params.rate > 0) {
+    std::cout << "*** delay behind schedule: p50 "
+              << to_ms_string(stats.delays.percentile(0.5)) << ", p90 "
+              << to_ms_string(stats.delays.percentile(0.9)) << ", p99 "
+              << to_ms_string(stats.delays.percentile(0.99)) << ", max "
+              << to_ms_string(stats.delays.percentile(1.0)) << '\n';
+  }
+  return EXIT_SUCCESS;
+} catch (std::exception& ex) {
+  std::cerr << "*** exception: " << ex.what() << "\n";
+  return EXIT_FAILURE;
+}
@@ -1,21 +1,32 @@
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <random>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <type_traits>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include "broker/builder.hh"
 #include "broker/configuration.hh"
 #include "broker/convert.hh"
 #include "broker/data.hh"
+#include "broker/data_envelope.hh"
 #include "broker/endpoint.hh"
 #include "broker/publisher.hh"
 #include "broker/status.hh"
@@ -25,6 +36,7 @@
 
 #ifndef BROKER_WINDOWS
 #  include <fcntl.h>
+#  include <netdb.h>
 #  include <sys/socket.h>
 #  include <sys/types.h>
 #  include <unistd.h>
@@ -46,6 +58,12 @@ double rate_increase_interval = 0;
 double rate_increase_amount = 0;
 uint64_t max_received = 0;
 uint64_t max_in_flight = 0;
+uint64_t num_connections = 1;
+uint64_t num_publishers = 1;
+uint64_t num_topics = 1;
+double topic_skew = 0;
+bool use_web_socket = false;
+uint64_t web_socket_port = 0;
 bool server = false;
 bool verbose = false;
 
@@ -74,7 +92,8 @@ double current_time() {
 }
 
 static std::string random_string(int n) {
-  static unsigned int i = 0;
+  // Publishers run in parallel. Hence, each thread has its own counter.
+  thread_local unsigned int i = 0;
   const char charset[] = "0123456789"
                          "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
                          "abcdefghijklmnopqrstuvwxyz";
@@ -89,7 +108,7 @@ static std::string random_string(int n) {
 }
 
 static uint64_t random_count() {
-  static uint64_t i = 0;
+  thread_local uint64_t i = 0;
   return ++i;
 }
 
@@ -158,147 +177,429 @@ list_builder createEventArgs() {
   }
 }
 
-constexpr count ProtocolVersion = 1;
+/// Picks topics for the publishers. The weight of the topic with rank i is
+/// 1 / (i + 1)^skew, i.e., a skew of 0 results in a uniform distribution and
+/// greater values concentrate the traffic on the first topics (Zipf).
+class topic_distribution {
+public:
+  topic_distribution(size_t num_topics, double skew) {
+    if (num_topics <= 1) {
+      names_.emplace_back("/benchmark/events");
+      cdf_.emplace_back(1.0);
+      return;
+    }
+    auto sum = 0.0;
+    for (size_t i = 0; i < num_topics; ++i) {
+      names_.emplace_back("/benchmark/events/" + std::to_string(i));
+      sum += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+      cdf_.emplace_back(sum);
+    }
+  }
 
-constexpr count MessageTypeEvent = 1;
+  template <class RandomEngine>
+  const std::string& sample(RandomEngine& engine) const {
+    if (names_.size() == 1)
+      return names_.front();
+    std::uniform_real_distribution<double> dist{0.0, cdf_.back()};
+    auto i = std::upper_bound(cdf_.begin(), cdf_.end(), dist(engine));
+    auto index = std::min(static_cast<size_t>(i - cdf_.begin()),
+                          names_.size() - 1);
+    return names_[index];
+  }
 
-data_message make_event(std::string_view topic_str, std::string_view name) {
-  return list_builder{}
-    .add(ProtocolVersion)
-    .add(MessageTypeEvent)
-    .add_list(name, createEventArgs())
-    .build_envelope(topic_str);
-}
+private:
+  std::vector<std::string> names_;
+  std::vector<double> cdf_;
+};
 
-void send_batch(endpoint& ep, publisher& p) {
+/// Creates a Zeek event or, for batch sizes greater than 1, a batch of Zeek
+/// events. Each event carries its creation time in the metadata, which allows
+/// the server to compute the latency.
+data_message make_message(std::string_view topic_str, int64_t n) {
   auto name = "event_" + std::to_string(event_type);
-  list_builder batch;
-  for (int i = 0; i < batch_size; i++) {
-    batch.add_list(ProtocolVersion, MessageTypeEvent,
-                   list_builder{}.add(name).add(createEventArgs()));
+  if (n <= 1) {
+    zeek::Event ev{name, createEventArgs(), now()};
+    return data_envelope::make(topic_str, ev.raw());
   }
-  total_sent += batch_size;
-  p.publish(std::move(batch));
+  zeek::BatchBuilder builder;
+  for (int64_t i = 0; i < n; ++i)
+    builder.add(zeek::Event{name, createEventArgs(), now()});
+  return data_envelope::make(topic_str, builder.build().raw());
 }
 
-const vector* inner_vector(const vector& vec) {
-  for (auto& x : vec)
-    if (auto ptr = get_if<vector>(&x))
-      return inner_vector(*ptr);
-  return &vec;
-}
+/// A minimal WebSocket client that sends JSON messages to Broker, i.e., that
+/// mimics a client such as a Python script using the WebSocket API.
+class web_socket_client {
+public:
+  web_socket_client() : engine_(std::random_device{}()) {
+    // nop
+  }
 
-struct source_state {
-  static inline const char* name = "broker.benchmark.source";
-};
+  web_socket_client(const web_socket_client&) = delete;
 
-void client_loop(endpoint& ep, bool verbose, status_subscriber& ss);
+  web_socket_client& operator=(const web_socket_client&) = delete;
 
-void client_mode(endpoint& ep, bool verbose, const std::string& host,
-                 int port) {
-  // Make sure to receive status updates.
-  auto ss = ep.make_status_subscriber(true);
-  // Publish events to /benchmark/events.
-  // Connect to remote peer.
-  VERBOSE_OUT << "*** init peering: host = " << host << ", port = " << port
-              << '\n';
-  auto res = ep.peer(host, port, timeout::seconds(1));
-  if (!res) {
-    std::cerr << "unable to peer to " << host << " on port " << port << '\n';
-    return;
+  ~web_socket_client() {
+#ifndef BROKER_WINDOWS
+    if (fd_ != -1)
+      close(fd_);
+#endif
+  }
+
+  /// Connects to Broker at `host:port` and performs the WebSocket handshake
+  /// as well as Broker's handshake without subscribing to any topic.
+  bool connect(const std::string& host, uint16_t port) {
+#ifdef BROKER_WINDOWS
+    std::cerr << "*** WebSocket clients are not supported on Windows\n";
+    return false;
+#else
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addrs = nullptr;
+    auto port_str = std::to_string(port);
+    if (getaddrinfo(host.c_str(), port_str.c_str(), &hints, &addrs) != 0)
+      return false;
+    for (auto addr = addrs; addr != nullptr; addr = addr->ai_next) {
+      fd_ = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+      if (fd_ == -1)
+        continue;
+      if (::connect(fd_, addr->ai_addr, addr->ai_addrlen) == 0)
+        break;
+      close(fd_);
+      fd_ = -1;
+    }
+    freeaddrinfo(addrs);
+    if (fd_ == -1)
+      return false;
+    // Upgrade the connection. The server does not check the key, so we use
+    // the sample nonce from RFC 6455.
+    auto request = "GET /v1/messages/json HTTP/1.1\r\n"
+                   "Host: "
+                   + host + ":" + port_str
+                   + "\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                     "Sec-WebSocket-Version: 13\r\n\r\n";
+    if (!write_all(request.data(), request.size()))
+      return false;
+    std::string response;
+    while (response.find("\r\n\r\n") == std::string::npos) {
+      char ch;
+      if (recv(fd_, &ch, 1, 0) != 1)
+        return false;
+      response += ch;
+    }
+    if (response.compare(0, 12, "HTTP/1.1 101") != 0) {
+      std::cerr << "*** WebSocket handshake failed: "
+                << response.substr(0, response.find('\r')) << '\n';
+      return false;
+    }
+    // Broker expects the list of subscriptions first and responds with an
+    // ACK message.
+    if (!send_text("[]"))
+      return false;
+    std::string ack;
+    if (!read_frame(ack) || ack.find("\"ack\"") == std::string::npos) {
+      std::cerr << "*** Broker handshake failed: " << ack << '\n';
+      return false;
+    }
+    return true;
+#endif
   }
-  VERBOSE_OUT << "*** endpoint is now peering to remote\n";
-  client_loop(ep, verbose, ss);
-}
 
-void client_loop(endpoint& ep, bool verbose, status_subscriber& ss) {
+  /// Sends `payload` in a single text frame.
+  bool send_text(std::string_view payload) {
+    std::unique_lock guard{mtx_};
+    buf_.clear();
+    buf_.push_back(static_cast<char>(0x81)); // FIN + text frame.
+    auto len = static_cast<uint64_t>(payload.size());
+    if (len < 126) {
+      buf_.push_back(static_cast<char>(0x80 | len));
+    } else if (len <= 0xFFFF) {
+      buf_.push_back(static_cast<char>(0x80 | 126));
+      for (int shift = 8; shift >= 0; shift -= 8)
+        buf_.push_back(static_cast<char>((len >> shift) & 0xFF));
+    } else {
+      buf_.push_back(static_cast<char>(0x80 | 127));
+      for (int shift = 56; shift >= 0; shift -= 8)
+        buf_.push_back(static_cast<char>((len >> shift) & 0xFF));
+    }
+    // Clients must mask all frames.
+    std::array<char, 4> mask;
+    for (auto& x : mask)
+      x = static_cast<char>(engine_() & 0xFF);
+    buf_.insert(buf_.end(), mask.begin(), mask.end());
+    for (size_t i = 0; i < payload.size(); ++i)
+      buf_.push_back(static_cast<char>(payload[i] ^ mask[i % 4]));
+    return write_all(buf_.data(), buf_.size());
+  }
+
+private:
+  bool write_all(const char* data, size_t size) {
+#ifdef BROKER_WINDOWS
+    return false;
+#else
+    while (size > 0) {
+      auto res = send(fd_, data, size, 0);
+      if (res <= 0)
+        return false;
+      data += res;
+      size -= static_cast<size_t>(res);
+    }
+    return true;
+#endif
+  }
+
+  bool read_all(char* data, size_t size) {
+#ifdef BROKER_WINDOWS
+    return false;
+#else
+    while (size > 0) {
+      auto res = recv(fd_, data, size, 0);
+      if (res <= 0)
+        return false;
+      data += res;
+      size -= static_cast<size_t>(res);
+    }
+    return true;
+#endif
+  }
+
+  /// Reads a single, unmasked frame from the server.
+  bool read_frame(std::string& payload) {
+    unsigned char hdr[2];
+    if (!read_all(reinterpret_cast<char*>(hdr), 2))
+      return false;
+    uint64_t len = hdr[1] & 0x7F;
+    if (len >= 126) {
+      unsigned char ext[8];
+      auto ext_size = len == 126 ? size_t{2} : size_t{8};
+      if (!read_all(reinterpret_cast<char*>(ext), ext_size))
+        return false;
+      len = 0;
+      for (size_t i = 0; i < ext_size; ++i)
+        len = (len << 8) | ext[i];
+    }
+    payload.resize(len);
+    return read_all(payload.data(), payload.size());
+  }
+
+  int fd_ = -1;
+  std::mutex mtx_;
+  std::minstd_rand engine_;
+  std::vector<char> buf_;
+};
+
+/// A connection of the load generator, either a peering of a separate endpoint
+/// or a WebSocket client.
+struct connection {
+  std::unique_ptr<endpoint> ep;
+  std::unique_ptr<status_subscriber> ss;
+  std::unique_ptr<web_socket_client> ws;
+  std::atomic<size_t> sent{0};
+  size_t last_sent = 0;
+};
+
+/// Publishes batches at the configured rate (or as fast as possible if the
+/// rate is 0) on randomly selected topics.
+void publisher_loop(connection& conn, const topic_distribution& topics) {
+  std::minstd_rand engine{std::random_device{}()};
+  auto size = batch_size;
+  auto ship = [&] {
+    auto msg = make_message(topics.sample(engine), size);
+    if (conn.ws) {
+      if (!conn.ws->send_text(msg->to_json())) {
+        std::cerr << "*** lost WebSocket connection\n";
+        exit(EXIT_FAILURE);
+      }
+    } else {
+      conn.ep->publish(std::move(msg));
+    }
+    conn.sent += static_cast<size_t>(size);
+  };
   if (batch_rate == 0) {
-    ep.publish_all(
+    if (conn.ws) {
+      // The blocking socket provides back-pressure.
+      for (;;)
+        ship();
+    }
+    // Let the endpoint pull messages as fast as the core consumes them.
+    conn.ep->publish_all(
       [] {
         // Init: nop.
       },
-      [](std::deque<data_message>& out, size_t hint) {
+      [&conn, &topics, engine, size](std::deque<data_message>& out,
+                                     size_t hint) mutable {
         // Pull: generate random events.
-        for (size_t i = 0; i < hint; ++i) {
-          auto name = "event_" + std::to_string(event_type);
-          out.emplace_back(make_event("/benchmark/events", name));
-          // std::cout<<"OUT: "<<out.back()->value()<<std::endl;
-        }
+        for (size_t i = 0; i < hint; ++i)
+          out.emplace_back(make_message(topics.sample(engine), size));
+        conn.sent += hint * static_cast<size_t>(size);
       },
       [] {
         // AtEnd: always false since we can produce random data forever.
         return false;
       });
-    for (;;) {
-      // Print status events.
-      auto ev = ss.get();
-      if (verbose)
-        std::visit([](auto& x) { std::cout << to_string(x) << std::endl; }, ev);
-    }
+    return;
   }
-  // Publish one message per interval.
+  // Publish one batch per interval.
   using std::chrono::duration_cast;
   using fractional_second = std::chrono::duration<double>;
-  auto p = ep.make_publisher("/benchmark/events");
   fractional_second fractional_inc_interval{rate_increase_interval};
   auto inc_interval = duration_cast<timespan>(fractional_inc_interval);
   timestamp timeout = std::chrono::system_clock::now();
   auto interval = duration_cast<timespan>(1s);
   interval /= batch_rate;
-  auto interval_timeout = timeout + interval;
+  auto interval_timeout = timeout + inc_interval;
   for (;;) {
     // Sleep until next timeout.
     timeout += interval;
     std::this_thread::sleep_until(timeout);
-    // Ship some data.
-    if (p.free_capacity() > 1) {
-      send_batch(ep, p);
-    } else {
-      std::cout << "*** skip batch: publisher queue full" << '\n';
-    }
+    ship();
     // Increase batch size when reaching interval_timeout.
     if (rate_increase_interval > 0 && rate_increase_amount > 0) {
       auto now = std::chrono::system_clock::now();
       if (now >= interval_timeout) {
-        batch_size += rate_increase_amount;
-        interval_timeout += interval;
+        size += static_cast<int64_t>(rate_increase_amount);
+        interval_timeout += inc_interval;
       }
     }
-    // Print status events.
-    auto status_events = ss.poll();
-    if (verbose)
-      for (auto& ev : status_events)
-        std::visit([](auto& x) { std::cout << to_string(x) << std::endl; }, ev);
   }
 }
 
+void client_mode(configuration& cfg, const std::string& host, uint16_t port) {
+  topic_distribution topics{num_topics, topic_skew};
+  std::vector<std::unique_ptr<connection>> conns;
+  for (uint64_t i = 0; i < num_connections; ++i) {
+    auto& conn = *conns.emplace_back(std::make_unique<connection>());
+    VERBOSE_OUT << "*** init connection " << i << ": host = " << host
+                << ", port = " << port << '\n';
+    if (use_web_socket) {
+      conn.ws = std::make_unique<web_socket_client>();
+      if (!conn.ws->connect(host, port)) {
+        std::cerr << "unable to connect to " << host << " on port " << port
+                  << '\n';
+        return;
+      }
+      continue;
+    }
+    // Each peering requires its own endpoint.
+    if (i == 0)
+      conn.ep = std::make_unique<endpoint>(std::move(cfg));
+    else
+      conn.ep = std::make_unique<endpoint>(configuration{
+        conns.front()->ep->options()});
+    conn.ss = std::make_unique<status_subscriber>(
+      conn.ep->make_status_subscriber(true));
+    if (!conn.ep->peer(host, port, timeout::seconds(1))) {
+      std::cerr << "unable to peer to " << host << " on port " << port << '\n';
+      return;
+    }
+  }
+  VERBOSE_OUT << "*** established " << conns.size() << " connections\n";
+  std::vector<std::thread> threads;
+  for (auto& conn : conns)
+    for (uint64_t i = 0; i < num_publishers; ++i)
+      threads.emplace_back(
+        [ptr = conn.get(), &topics] { publisher_loop(*ptr, topics); });
+  // Print the throughput of each connection once per second.
+  timestamp timeout = std::chrono::system_clock::now();
+  for (;;) {
+    timeout += 1s;
+    std::this_thread::sleep_until(timeout);
+    if (!verbose)
+      continue;
+    size_t total = 0;
+    for (size_t i = 0; i < conns.size(); ++i) {
+      auto& conn = *conns[i];
+      size_t sent = conn.sent;
+      auto rate = sent - conn.last_sent;
+      conn.last_sent = sent;
+      total += rate;
+      if (conns.size() > 1)
+        std::cout << "connection " << i << ": " << rate << " events/s\n";
+      if (conn.ss)
+        for (auto& ev : conn.ss->poll())
+          std::visit([](auto& x) { std::cout << to_string(x) << '\n'; }, ev);
+    }
+    std::cout << "rate: " << total << " events/s" << std::endl;
+  }
+}
+
+/// Collects per-sender throughput and the latency of events that carry a
+/// timestamp in their metadata.
+struct server_stats {
+  std::mutex mtx;
+  std::map<endpoint_id, size_t> received;
+  std::vector<timespan> latencies;
+
+  void add(const data_message& msg) {
+    auto ts = now();
+    size_t n = 0;
+    std::vector<timespan> samples;
+    auto add_event = [&](const zeek::Event& ev) {
+      ++n;
+      if (auto sent = ev.ts())
+        samples.emplace_back(ts - *sent);
+    };
+    switch (zeek::Message::type(msg)) {
+      case zeek::Message::Type::Event:
+        add_event(zeek::Event{msg});
+        break;
+      case zeek::Message::Type::Batch:
+        // Count each element in a batch as one event.
+        zeek::Batch{msg}.for_each([&](const auto& x) {
+          if constexpr (std::is_same_v<std::decay_t<decltype(x)>, zeek::Event>)
+            add_event(x);
+          else
+            ++n;
+        });
+        break;
+      default:
+        n = 1;
+    }
+    num_events += n;
+    std::unique_lock guard{mtx};
+    received[msg->sender()] += n;
+    latencies.insert(latencies.end(), samples.begin(), samples.end());
+  }
+};
+
+/// Returns the value at percentile `p` of the sorted range `xs`.
+timespan percentile(const std::vector<timespan>& xs, double p) {
+  auto index = static_cast<size_t>(p * static_cast<double>(xs.size() - 1));
+  return xs[index];
+}
+
+std::string to_ms_string(timespan x) {
+  using fractional_ms = std::chrono::duration<double, std::milli>;
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(3)
+      << std::chrono::duration_cast<fractional_ms>(x).count() << "ms";
+  return out.str();
+}
+
 void server_loop(endpoint& ep, bool verbose, status_subscriber& ss,
-                 std::atomic<bool>& terminate);
+                 std::atomic<bool>& terminate, server_stats& stats);
 
 // This mode mimics what benchmark.bro does.
 void server_mode(endpoint& ep, bool verbose, const std::string& iface,
                  int port) {
   // Make sure to receive status updates.
   auto ss = ep.make_status_subscriber(true);
-  // Subscribe to /benchmark/events.
+  // Subscribe to /benchmark/events, which also includes the topics of
+  // clients that spread their traffic across multiple topics.
+  server_stats stats;
   ep.subscribe(
     {"/benchmark/events"},
     [] {
       // Init: nop.
     },
-    [](const data_message& msg) {
-      // std::cout<<"MESSAGE: "<<msg->value()<<std::endl;
-      //  OnNext: increase the global num_events counter.
-      //  FIXME:
-      //  auto msg = move_data(x);
-      //  // Count number of events (counts each element in a batch as one
-      //  event). if (zeek::Message::type(msg) == zeek::Message::Type::Batch) {
-      //    zeek::Batch batch(std::move(msg));
-      //    num_events += batch.batch().size();
-      //  } else {
-      //    ++num_events;
-      //  }
-      ++num_events;
+    [&stats](const data_message& msg) {
+      // OnNext: update the counters and collect the latency.
+      stats.add(msg);
     },
     [](const error&) {
       // Cleanup: nop.
@@ -325,11 +626,24 @@ void server_mode(endpoint& ep, bool verbose, const std::string& iface,
   } else if (verbose) {
     std::cout << "*** listening on " << actual_port << '\n';
   }
-  server_loop(ep, verbose, ss, terminate);
+  // Start listening for WebSocket clients.
+  if (web_socket_port != 0) {
+    auto actual_ws_port = ep.web_socket_listen(
+      iface, static_cast<uint16_t>(web_socket_port));
+    if (actual_ws_port == 0) {
+      std::cerr << "*** failed to listen on WebSocket port " << web_socket_port
+                << '\n';
+      return;
+    } else if (verbose) {
+      std::cout << "*** listening for WebSocket clients on " << actual_ws_port
+                << '\n';
+    }
+  }
+  server_loop(ep, verbose, ss, terminate, stats);
 }
 
 void server_loop(endpoint& ep, bool verbose, status_subscriber& ss,
-                 std::atomic<bool>& terminate) {
+                 std::atomic<bool>& terminate, server_stats& stats) {
   // Collects stats once per second until receiving stop message.
   using std::chrono::duration_cast;
   timestamp timeout = std::chrono::system_clock::now();
@@ -340,8 +654,28 @@ void server_loop(endpoint& ep, bool verbose, status_subscriber& ss,
     std::this_thread::sleep_until(timeout);
     // Generate and publish zeek event.
     timestamp now = std::chrono::system_clock::now();
-    if (verbose)
-      std::cout << "rate: " << reset_num_events() << " events/s" << std::endl;
+    std::map<endpoint_id, size_t> received;
+    std::vector<timespan> latencies;
+    {
+      std::unique_lock guard{stats.mtx};
+      received.swap(stats.received);
+      latencies.swap(stats.latencies);
+    }
+    if (verbose) {
+      std::cout << "rate: " << reset_num_events() << " events/s";
+      if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << ", latency: p50 "
+                  << to_ms_string(percentile(latencies, 0.5)) << ", p90 "
+                  << to_ms_string(percentile(latencies, 0.9))
+                  << ", p99 " << to_ms_string(percentile(latencies, 0.99))
+                  << ", max " << to_ms_string(latencies.back());
+      }
+      std::cout << std::endl;
+      if (received.size() > 1)
+        for (auto& [sender, n] : received)
+          std::cout << "  " << to_string(sender) << ": " << n << " events/s\n";
+    }
     // Advance time and print status events.
     last_time = now;
     auto status_events = ss.poll();
@@ -365,6 +699,18 @@ void add_options(configuration& cfg) {
                  "stop benchmark after given count");
   cfg.add_option(&max_in_flight, "max-in-flight,f",
                  "report when exceeding this count");
+  cfg.add_option(&num_connections, "connections,n",
+                 "number of connections to the server (default: 1)");
+  cfg.add_option(&num_publishers, "publishers,p",
+                 "publishers per connection (default: 1)");
+  cfg.add_option(&num_topics, "topics",
+                 "number of topics for spreading the traffic (default: 1)");
+  cfg.add_option(&topic_skew, "topic-skew",
+                 "Zipf exponent for picking topics (default: 0 = uniform)");
+  cfg.add_option(&use_web_socket, "web-socket",
+                 "connect via WebSocket instead of peering");
+  cfg.add_option(&web_socket_port, "web-socket-port",
+                 "port for WebSocket clients in server mode (0 = disabled)");
   cfg.add_option(&server, "server", "run in server mode");
   cfg.add_option(&verbose, "verbose", "enable status output");
 }
@@ -419,14 +765,24 @@ int main(int argc, char** argv) {
     usage(cfg, argv[0]);
     return EXIT_FAILURE;
   }
+  if (web_socket_port > std::numeric_limits<uint16_t>::max()) {
+    std::cerr << "*** invalid WebSocket port\n\n";
+    usage(cfg, argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (num_connections == 0 || num_publishers == 0 || num_topics == 0) {
+    std::cerr << "*** connections, publishers and topics must be > 0\n\n";
+    usage(cfg, argv[0]);
+    return EXIT_FAILURE;
+  }
   // Run benchmark.
-  endpoint ep(std::move(cfg));
   if (server) {
     VERBOSE_OUT << "*** run in server mode\n";
+    endpoint ep(std::move(cfg));
     server_mode(ep, verbose, host, port);
   } else {
     VERBOSE_OUT << "*** run in client mode\n";
-    client_mode(ep, verbose, host, port);
+    client_mode(cfg, host, port);
   }
   return EXIT_SUCCESS;
 }
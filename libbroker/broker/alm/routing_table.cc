@@ -11,6 +11,13 @@ const std::vector<endpoint_id>* shortest_path(const routing_table& tbl,
     return nullptr;
 }
 
+const endpoint_id* next_hop(const routing_table& tbl, const endpoint_id& peer) {
+  if (auto path = shortest_path(tbl, peer))
+    return std::addressof(path->front());
+  else
+    return nullptr;
+}
+
 bool is_direct_connection(const routing_table_row& row) {
   return !row.versioned_paths.empty()
          && row.versioned_paths.front().first.size() == 1;
@@ -8,6 +8,7 @@
 #include <tuple>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "broker/detail/algorithms.hh"
 #include "broker/detail/assert.hh"
@@ -67,14 +68,6 @@ public:
   /// Stores all paths leading to this peer, using a vector timestamp for
   /// versioning (stores only the latest version). Sorted by path length.
   std::vector<versioned_path_type> versioned_paths;
-
-  routing_table_row() {
-    versioned_paths.reserve(32);
-  }
-  routing_table_row(routing_table_row&&) = default;
-  routing_table_row(const routing_table_row&) = default;
-  routing_table_row& operator=(routing_table_row&&) = default;
-  routing_table_row& operator=(const routing_table_row&) = default;
 };
 
 template <class Inspector>
@@ -91,6 +84,11 @@ using routing_table = std::unordered_map<endpoint_id, routing_table_row>;
 const std::vector<endpoint_id>* shortest_path(const routing_table& tbl,
                                               const endpoint_id& peer);
 
+/// Returns the direct peer on the shortest path to `peer` or `nullptr` if the
+/// destination is unreachable. Since each row keeps its paths sorted by
+/// length, this lookup is a single hash table access.
+const endpoint_id* next_hop(const routing_table& tbl, const endpoint_id& peer);
+
 /// Checks whether the routing table `tbl` contains a path to the `peer`.
 inline bool reachable(const routing_table& tbl, const endpoint_id& peer) {
   return tbl.count(peer) != 0;
@@ -102,8 +100,8 @@ bool is_direct_connection(const routing_table_row& row);
 /// Returns whether `tbl` contains a direct connection to `peer`.
 inline bool is_direct_connection(const routing_table& tbl,
                                  const endpoint_id& peer) {
-  if (auto path = shortest_path(tbl, peer))
-    return path->size() == 1;
+  if (auto i = tbl.find(peer); i != tbl.end())
+    return is_direct_connection(i->second);
   else
     return false;
 }
@@ -121,33 +119,38 @@ inline std::optional<size_t> distance_to(const routing_table& tbl,
 /// Erases all state for `whom` and also removes all paths that include `whom`.
 /// Other peers can become unreachable as a result. In this case, the algorithm
 /// calls `on_remove` and recurses for all unreachable peers.
+/// @note Removes all peers that become unreachable at once, i.e., scans the
+///       table once per level of the cascade instead of once per peer.
 template <class OnRemovePeer>
 void erase(routing_table& tbl, const endpoint_id& whom,
            OnRemovePeer on_remove) {
+  std::vector<endpoint_id> removed{whom};
   std::vector<endpoint_id> unreachable_peers;
-  auto impl = [&](const endpoint_id& peer) {
+  tbl.erase(whom);
+  while (!removed.empty()) {
+    auto is_removed = [&removed](const endpoint_id& hop) {
+      return std::find(removed.begin(), removed.end(), hop) != removed.end();
+    };
     auto stale = [&](const auto& vpath) {
-      return std::find(vpath.first.begin(), vpath.first.end(), peer)
-             != vpath.first.end();
+      return std::any_of(vpath.first.begin(), vpath.first.end(), is_removed);
     };
-    tbl.erase(peer);
-    for (auto& [id, row] : tbl) {
-      auto& paths = row.versioned_paths;
+    for (auto i = tbl.begin(); i != tbl.end();) {
+      auto& paths = i->second.versioned_paths;
       auto sep = std::remove_if(paths.begin(), paths.end(), stale);
       if (sep != paths.end()) {
         paths.erase(sep, paths.end());
-        if (paths.empty())
-          unreachable_peers.emplace_back(id);
+        if (paths.empty()) {
+          unreachable_peers.emplace_back(i->first);
+          i = tbl.erase(i);
+          continue;
+        }
       }
+      ++i;
     }
-  };
-  impl(whom);
-  while (!unreachable_peers.empty()) {
-    // Our lambda modifies unreachable_peers, so we can't use iterators here.
-    endpoint_id peer = unreachable_peers.back();
-    unreachable_peers.pop_back();
-    impl(peer);
-    on_remove(peer);
+    for (const auto& peer : unreachable_peers)
+      on_remove(peer);
+    removed.swap(unreachable_peers);
+    unreachable_peers.clear();
   }
 }
 
@@ -93,6 +93,19 @@ TEST(erase removes all paths that to and from a peer) {
   }
 }
 
+TEST(erase reports all peers that become unreachable) {
+  std::vector<endpoint_id> unreachables;
+  auto callback = [&](const endpoint_id& x) { unreachables.emplace_back(x); };
+  erase(tbl, J, callback);
+  CHECK(unreachables.empty());
+  erase(tbl, B, callback);
+  std::sort(unreachables.begin(), unreachables.end());
+  auto expected = ls(D, E, I);
+  std::sort(expected.begin(), expected.end());
+  CHECK_EQUAL(unreachables, expected);
+  CHECK(tbl.empty());
+}
+
 TEST(erase_direct drops the direct path but peers can remain reachable) {
   MESSAGE("before calling erase_direct(B), we reach B in one hop");
   {
@@ -109,6 +122,18 @@ TEST(erase_direct drops the direct path but peers can remain reachable) {
   }
 }
 
+TEST(next_hop returns the first hop on the shortest path) {
+  CHECK_EQUAL(*alm::next_hop(tbl, B), B);
+  CHECK_EQUAL(*alm::next_hop(tbl, D), B);
+  CHECK_EQUAL(*alm::next_hop(tbl, I), J);
+  CHECK_EQUAL(alm::next_hop(tbl, A), nullptr);
+  CHECK(is_direct_connection(tbl, J));
+  CHECK(!is_direct_connection(tbl, I));
+  MESSAGE("after removing J, we reach I through B");
+  erase(tbl, J, nop);
+  CHECK_EQUAL(*alm::next_hop(tbl, I), B);
+}
+
 TEST(peers may revoke paths) {
   using alm::revoked;
   auto path = ls(A, B, C, D);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <string_view>
 
 namespace broker {
 
@@ -8,14 +9,29 @@ namespace broker {
 enum class backend : uint8_t {
   memory, ///< An in-memory backend based on a simple hash table.
   sqlite, ///< A SQLite3 backend.
+  mmap,   ///< A memory-mapped, append-only log with an in-memory index.
 };
 
+/// @relates backend
+constexpr std::string_view to_string(backend x) noexcept {
+  switch (x) {
+    case backend::memory:
+      return "memory";
+    case backend::sqlite:
+      return "sqlite";
+    case backend::mmap:
+      return "mmap";
+    default:
+      return "???";
+  }
+}
+
 /// @relates backend
 template <class Inspector>
 bool inspect(Inspector& f, backend& x) {
   auto get = [&] { return static_cast<uint8_t>(x); };
   auto set = [&](uint8_t val) {
-    if (val <= static_cast<uint8_t>(backend::sqlite)) {
+    if (val <= static_cast<uint8_t>(backend::mmap)) {
       x = static_cast<backend>(val);
       return true;
     } else {
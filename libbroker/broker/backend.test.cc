@@ -22,6 +22,7 @@
 #include "broker/detail/filesystem.hh"
 #include "broker/detail/make_backend.hh"
 #include "broker/detail/memory_backend.hh"
+#include "broker/detail/mmap_backend.hh"
 #include "broker/detail/sqlite_backend.hh"
 #include "broker/error.hh"
 #include "broker/expected.hh"
@@ -43,10 +44,14 @@ public:
   meta_backend(backend_options opts) {
     backends_.push_back(detail::make_backend(backend::memory, opts));
     auto& path = broker::get<std::string>(opts["path"]);
-    // Make sure both backends have their own filesystem storage to work with.
-    path += ".sqlite";
+    auto base = path;
+    // Make sure all backends have their own filesystem storage to work with.
+    path = base + ".sqlite";
     paths_.push_back(path);
     backends_.push_back(detail::make_backend(backend::sqlite, opts));
+    path = base + ".mmap";
+    paths_.push_back(path);
+    backends_.push_back(detail::make_backend(backend::mmap, opts));
   }
 
   ~meta_backend() {
@@ -102,11 +107,31 @@ public:
     });
   }
 
+  expected<data> get_many(const std::vector<data>& keys) const override {
+    return perform<data>([&](detail::abstract_backend& backend) {
+      return backend.get_many(keys);
+    });
+  }
+
   expected<data> keys() const override {
     return perform<data>(
       [&](detail::abstract_backend& backend) { return backend.keys(); });
   }
 
+  expected<data> range(const data& first, const data& last,
+                       size_t limit) const override {
+    return perform<data>([&](detail::abstract_backend& backend) {
+      return backend.range(first, last, limit);
+    });
+  }
+
+  expected<data> keys_with_prefix(const std::string& prefix,
+                                  size_t limit) const override {
+    return perform<data>([&](detail::abstract_backend& backend) {
+      return backend.keys_with_prefix(prefix, limit);
+    });
+  }
+
   expected<bool> exists(const data& key) const override {
     return perform<bool>(
       [&](detail::abstract_backend& backend) { return backend.exists(key); });
@@ -122,11 +147,40 @@ public:
       [](detail::abstract_backend& backend) { return backend.snapshot(); });
   }
 
+  expected<void> for_each(const detail::entry_visitor& f) const override {
+    using snapshot_t = broker::snapshot;
+    auto ss = perform<snapshot_t>(
+      [](detail::abstract_backend& backend) -> expected<snapshot_t> {
+        snapshot_t result;
+        auto res = backend.for_each([&](const data& key, const data& value) {
+          result.emplace(key, value);
+          return true;
+        });
+        if (!res)
+          return res.error();
+        return result;
+      });
+    if (!ss)
+      return ss.error();
+    for (const auto& [key, value] : *ss)
+      if (!f(key, value))
+        break;
+    return {};
+  }
+
   expected<broker::detail::expirables> expiries() const override {
     return perform<broker::detail::expirables>(
       [](detail::abstract_backend& backend) { return backend.expiries(); });
   }
 
+  expected<broker::detail::expirables>
+  expiries_between(timestamp first, timestamp last) const override {
+    return perform<broker::detail::expirables>(
+      [&](detail::abstract_backend& backend) {
+        return backend.expiries_between(first, last);
+      });
+  }
+
 private:
   template <class T, class F>
   expected<T> perform(F f) {
@@ -261,6 +315,39 @@ TEST(clear / keys) {
   CHECK_EQUAL(*size, 0u);
 }
 
+TEST(range / keys_with_prefix) {
+  for (auto key : {"a", "ab", "abc", "b", "ba", "c"})
+    RUN(backend->put(key, 1));
+  RUN(backend->put(42, 1));
+  auto keys = [](std::initializer_list<data> xs) { return data{vector{xs}}; };
+  CHECK_EQUAL(RUN(backend->range("ab", "ba", 0)), keys({"ab", "abc", "b"}));
+  CHECK_EQUAL(RUN(backend->range("ab", data{}, 2)), keys({"ab", "abc"}));
+  CHECK_EQUAL(RUN(backend->range("abc", data{}, 2)), keys({"abc", "b"}));
+  CHECK_EQUAL(RUN(backend->range(data{}, "a", 0)), keys({42}));
+  CHECK_EQUAL(RUN(backend->keys_with_prefix("a", 0)), keys({"a", "ab", "abc"}));
+  CHECK_EQUAL(RUN(backend->keys_with_prefix("b", 1)), keys({"b"}));
+  CHECK_EQUAL(RUN(backend->keys_with_prefix("x", 0)), keys({}));
+}
+
+TEST(get_many) {
+  for (auto key : {"a", "b", "c"})
+    RUN(backend->put(key, key));
+  RUN(backend->put(42, 23));
+  CHECK_EQUAL(RUN(backend->get_many({})), data{table{}});
+  CHECK_EQUAL(RUN(backend->get_many({"a", "x", 42, "c", "a"})),
+              data{table{{"a", "a"}, {42, 23}, {"c", "c"}}});
+  std::vector<data> many;
+  for (integer i = 0; i < 1500; ++i) {
+    RUN(backend->put(i, i * 2));
+    many.emplace_back(i);
+  }
+  auto xs = RUN(backend->get_many(many));
+  if (auto* tbl = get_if<table>(xs); CHECK(tbl != nullptr)) {
+    CHECK_EQUAL(tbl->size(), 1500u);
+    CHECK_EQUAL(tbl->at(data{integer{1499}}), data{integer{2998}});
+  }
+}
+
 TEST(expiration with expiry) {
   using namespace std::chrono;
   auto put = backend->put("foo", "bar", broker::now() + milliseconds(1000));
@@ -289,6 +376,22 @@ TEST(expiration without expiry) {
   REQUIRE(!*expire); // no expiry with key associated
 }
 
+TEST(expiries_between selects keys by expiration time) {
+  using namespace std::chrono;
+  auto t0 = broker::now();
+  RUN(backend->put("a", 1, t0 + seconds{3}));
+  RUN(backend->put("b", 2, t0 + seconds{1}));
+  RUN(backend->put("c", 3, t0 + seconds{2}));
+  RUN(backend->put("d", 4));
+  auto xs = RUN(backend->expiries_between(t0 + seconds{1}, t0 + seconds{3}));
+  REQUIRE_EQUAL(xs.size(), 2u);
+  CHECK_EQUAL(xs[0].first, data{"b"});
+  CHECK_EQUAL(xs[1].first, data{"c"});
+  CHECK_EQUAL(RUN(backend->expiries_between(t0, t0 + seconds{10})).size(), 3u);
+  CHECK(RUN(backend->expiries_between(t0 + seconds{4}, t0 + seconds{10}))
+          .empty());
+}
+
 TEST(size / snapshot) {
   using namespace std::chrono;
   auto put = backend->put("foo", "bar");
@@ -306,4 +409,163 @@ TEST(size / snapshot) {
   CHECK_EQUAL(ss->count("foo"), 1u);
 }
 
+TEST(for_each visits all entries) {
+  for (integer i = 0; i < 10; ++i)
+    RUN(backend->put(i, i * i));
+  broker::snapshot visited;
+  RUN(backend->for_each([&visited](const data& key, const data& value) {
+    visited.emplace(key, value);
+    return true;
+  }));
+  CHECK(visited == RUN(backend->snapshot()));
+  size_t calls = 0;
+  RUN(backend->for_each([&calls](const data&, const data&) {
+    return ++calls < 3;
+  }));
+  CHECK_EQUAL(calls, 3u);
+}
+
+TEST(sqlite transactions roll back on abort) {
+  auto path = detail::make_temp_file_name();
+  auto opts = backend_options{{"path", path}};
+  auto db = detail::make_backend(backend::sqlite, opts);
+  REQUIRE(db != nullptr);
+  RUN(db->put("a", 1));
+  RUN(db->begin_transaction());
+  RUN(db->erase("a"));
+  RUN(db->put("b", 2));
+  CHECK_EQUAL(RUN(db->exists("a")), false);
+  RUN(db->abort_transaction());
+  CHECK_EQUAL(RUN(db->size()), 1u);
+  CHECK_EQUAL(RUN(db->get("a")), data{1});
+  CHECK_EQUAL(RUN(db->exists("b")), false);
+}
+
+TEST(sqlite group commits survive reopening the database) {
+  auto path = detail::make_temp_file_name();
+  auto opts = backend_options{{"path", path}, {"group_commit", count{2}}};
+  {
+    auto db = detail::make_backend(backend::sqlite, opts);
+    REQUIRE(db != nullptr);
+    RUN(db->put("a", 1));
+    RUN(db->put("b", 2));
+    RUN(db->put("c", 3));
+    RUN(db->begin_transaction());
+    RUN(db->erase("a"));
+    RUN(db->put("d", 4));
+    RUN(db->commit_transaction());
+    RUN(db->put("e", 5));
+    RUN(db->flush());
+  }
+  {
+    auto db = detail::make_backend(backend::sqlite, opts);
+    REQUIRE(db != nullptr);
+    CHECK_EQUAL(RUN(db->size()), 4u);
+    CHECK_EQUAL(RUN(db->exists("a")), false);
+    CHECK_EQUAL(RUN(db->get("e")), data{5});
+  }
+  detail::remove_all(path);
+}
+
+TEST(sqlite read caches reflect all modifications) {
+  auto path = detail::make_temp_file_name();
+  auto opts = backend_options{{"path", path},
+                              {"read_cache_size", count{2}},
+                              {"mmap_size", count{1 << 20}},
+                              {"page_cache_size", count{1024}}};
+  auto db = detail::make_backend(backend::sqlite, opts);
+  REQUIRE(db != nullptr);
+  RUN(db->put("a", 1));
+  RUN(db->put("b", 2));
+  CHECK_EQUAL(RUN(db->get("a")), data{1});
+  RUN(db->put("a", 3));
+  CHECK_EQUAL(RUN(db->get("a")), data{3});
+  RUN(db->add("a", 1, data::type::integer));
+  CHECK_EQUAL(RUN(db->get("a")), data{4});
+  RUN(db->subtract("a", 2));
+  CHECK_EQUAL(RUN(db->get("a")), data{2});
+  CHECK_EQUAL(RUN(db->get_many({"a", "b"})), data{table{{"a", 2}, {"b", 2}}});
+  RUN(db->erase("a"));
+  CHECK_EQUAL(error_of(db->get("a")), ec::no_such_key);
+  CHECK_EQUAL(RUN(db->get("b")), data{2});
+  RUN(db->clear());
+  CHECK_EQUAL(error_of(db->get("b")), ec::no_such_key);
+  db.reset();
+  detail::remove_all(path);
+}
+
+TEST(sqlite backends keep their content after releasing memory) {
+  auto path = detail::make_temp_file_name();
+  auto opts = backend_options{{"path", path}, {"read_cache_size", count{2}}};
+  auto db = detail::make_backend(backend::sqlite, opts);
+  REQUIRE(db != nullptr);
+  RUN(db->put("a", 1));
+  CHECK_EQUAL(RUN(db->get("a")), data{1});
+  db->release_memory();
+  CHECK_EQUAL(RUN(db->get("a")), data{1});
+  RUN(db->put("a", 2));
+  CHECK_EQUAL(RUN(db->get("a")), data{2});
+  db.reset();
+  detail::remove_all(path);
+}
+
+TEST(sqlite incremental vacuum releases free pages on flush) {
+  auto path = detail::make_temp_file_name();
+  auto opts = backend_options{{"path", path},
+                              {"incremental_vacuum", count{10000}}};
+  {
+    detail::sqlite_backend db{opts};
+    REQUIRE(!db.init_failed());
+    std::vector<std::string> mode;
+    db.exec_pragma("auto_vacuum", "", &mode);
+    CHECK_EQUAL(mode, std::vector<std::string>{"2"});
+    for (integer i = 0; i < 500; ++i)
+      RUN(db.put(i, std::string(1000, 'x')));
+    RUN(db.clear());
+    std::vector<std::string> free_pages;
+    db.exec_pragma("freelist_count", "", &free_pages);
+    REQUIRE_EQUAL(free_pages.size(), 1u);
+    CHECK_NOT_EQUAL(free_pages[0], "0");
+    RUN(db.flush());
+    free_pages.clear();
+    db.exec_pragma("freelist_count", "", &free_pages);
+    CHECK_EQUAL(free_pages, std::vector<std::string>{"0"});
+  }
+  detail::remove_all(path);
+}
+
+TEST(mmap logs survive reopening and compaction) {
+  auto path = detail::make_temp_file_name();
+  auto opts = backend_options{{"path", path},
+                              {"compaction_threshold", count{0}}};
+  {
+    auto db = detail::make_backend(backend::mmap, opts);
+    REQUIRE(db != nullptr);
+    RUN(db->put("a", 1));
+    RUN(db->put("b", 2));
+    RUN(db->put("a", 3));
+    RUN(db->put("c", 4, broker::now() + std::chrono::seconds{10}));
+    RUN(db->erase("b"));
+  }
+  {
+    auto db = detail::make_backend(backend::mmap, opts);
+    REQUIRE(db != nullptr);
+    CHECK_EQUAL(RUN(db->size()), 2u);
+    CHECK_EQUAL(RUN(db->get("a")), data{3});
+    CHECK_EQUAL(RUN(db->exists("b")), false);
+    CHECK_EQUAL(RUN(db->expiries()).size(), 1u);
+    RUN(db->flush()); // Compacts the log.
+    RUN(db->put("d", 5));
+  }
+  {
+    auto db = detail::make_backend(backend::mmap, opts);
+    REQUIRE(db != nullptr);
+    CHECK_EQUAL(RUN(db->size()), 3u);
+    CHECK_EQUAL(RUN(db->get("a")), data{3});
+    CHECK_EQUAL(RUN(db->get("c")), data{4});
+    CHECK_EQUAL(RUN(db->get("d")), data{5});
+  }
+  detail::remove_all(path);
+}
+
 FIXTURE_SCOPE_END()
@@ -124,8 +124,12 @@ std::string_view id_strings[] = {
 
 } // namespace
 
-base_fixture::base_fixture()
-  : ep(make_config()),
+base_fixture::base_fixture() : base_fixture(make_config()) {
+  // nop
+}
+
+base_fixture::base_fixture(configuration cfg)
+  : ep(std::move(cfg)),
     sys(internal::endpoint_access{&ep}.sys()),
     self(sys),
     sched(dynamic_cast<scheduler_type&>(sys.scheduler())) {
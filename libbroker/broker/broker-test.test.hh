@@ -191,6 +191,10 @@ public:
 
   base_fixture();
 
+  /// Hosts an endpoint with a custom configuration. Tests usually adjust the
+  /// result of `make_config`.
+  explicit base_fixture(broker::configuration cfg);
+
   virtual ~base_fixture();
 
   broker::endpoint ep;
@@ -12,6 +12,7 @@
 #include "broker/time.hh"
 #include "broker/variant_data.hh"
 
+#include <algorithm>
 #include <cstddef>
 #include <iterator>
 #include <string_view>
@@ -75,6 +76,44 @@ struct builder_access {
     return builder;
   }
 
+  /// Returns the number of bytes that `add` writes for `value` or 0 if
+  /// computing the size would require encoding the value. The result serves
+  /// as hint for reserving buffer space.
+  /// @pre `value` is the result of calling `promote`.
+  template <class T>
+  static size_t size_hint(const T& value) {
+    namespace bin_v1 = format::bin::v1;
+    if constexpr (is_builder<T>) {
+      auto [first, last] = value.encoded_values();
+      return 1 + bin_v1::varbyte_size(value.num_values())
+             + static_cast<size_t>(last - first);
+    } else if constexpr (detail::is_tuple<T>) {
+      return std::apply([](const auto&... xs) { return list_size_hint(xs...); },
+                        value);
+    } else if constexpr (variant_data::is_primitive<T>) {
+      return 1 + bin_v1::encoded_size(value);
+    } else {
+      return 0;
+    }
+  }
+
+  /// Returns the number of bytes for encoding `xs...` as a nested sequence.
+  /// @pre all `xs` are results of calling `promote`.
+  template <class... Ts>
+  static size_t list_size_hint(const Ts&... xs) {
+    return 1 + format::bin::v1::varbyte_size(sizeof...(Ts))
+           + (size_t{0} + ... + size_hint(xs));
+  }
+
+  /// Makes sure that `buf` can store `num_bytes` additional bytes without
+  /// re-allocating. Grows the buffer at least by factor two to keep appends
+  /// amortized constant.
+  static void reserve(builder_buffer& buf, size_t num_bytes) {
+    auto required = buf.size() + num_bytes;
+    if (required > buf.capacity())
+      buf.reserve(std::max(required, buf.capacity() * 2));
+  }
+
   template <class Builder>
   static data_envelope_ptr build(Builder& src, std::string_view topic_str);
 };
@@ -140,6 +179,7 @@ public:
   /// Adds all elements as a nested vector.
   template <class... Ts>
   set_builder& add_list(Ts&&... xs) & {
+    reserve(detail::builder_access::list_size_hint(detail::promote<Ts>(xs)...));
     start_inline_vector(sizeof...(xs));
     (detail::builder_access::add(*this, detail::promote<Ts>(xs)), ...);
     return *this;
@@ -154,6 +194,7 @@ public:
   /// @pre The elements must be unique.
   template <class... Ts>
   set_builder& add_set(Ts&&... xs) & {
+    reserve(detail::builder_access::list_size_hint(detail::promote<Ts>(xs)...));
     start_inline_set(sizeof...(xs));
     (detail::builder_access::add(*this, detail::promote<Ts>(xs)), ...);
     return *this;
@@ -166,6 +207,11 @@ public:
 
   // -- modifiers --------------------------------------------------------------
 
+  /// Reserves space for `num_bytes` additional bytes of encoded values.
+  void reserve(size_t num_bytes) {
+    detail::builder_access::reserve(bytes_, num_bytes);
+  }
+
   /// Writes meta data to the internal buffer and returns the bytes that the
   /// builder would use when calling `build`.
   std::pair<const std::byte*, size_t> bytes();
@@ -261,6 +307,11 @@ public:
 
   // -- modifiers --------------------------------------------------------------
 
+  /// Reserves space for `num_bytes` additional bytes of encoded values.
+  void reserve(size_t num_bytes) {
+    detail::builder_access::reserve(bytes_, num_bytes);
+  }
+
   /// Writes meta data to the internal buffer and returns the bytes that the
   /// builder would use when calling `build`.
   std::pair<const std::byte*, size_t> bytes();
@@ -347,6 +398,7 @@ public:
   /// Adds all elements as a nested vector.
   template <class... Ts>
   list_builder& add_list(Ts&&... xs) & {
+    reserve(detail::builder_access::list_size_hint(detail::promote<Ts>(xs)...));
     start_inline_vector(sizeof...(xs));
     (add_inline_vector_item(std::forward<Ts>(xs)), ...);
     return *this;
@@ -361,6 +413,7 @@ public:
   /// @pre The elements must be unique.
   template <class... Ts>
   list_builder& add_set(Ts&&... xs) & {
+    reserve(detail::builder_access::list_size_hint(detail::promote<Ts>(xs)...));
     start_inline_set(sizeof...(xs));
     (detail::builder_access::add(*this, detail::promote<Ts>(xs)), ...);
     return *this;
@@ -373,6 +426,11 @@ public:
 
   // -- modifiers --------------------------------------------------------------
 
+  /// Reserves space for `num_bytes` additional bytes of encoded values.
+  void reserve(size_t num_bytes) {
+    detail::builder_access::reserve(bytes_, num_bytes);
+  }
+
   /// Writes meta data to the internal buffer and returns the bytes that the
   /// builder would use when calling `build`.
   std::pair<const std::byte*, size_t> bytes();
@@ -332,4 +332,22 @@ TEST(build nested lists) {
   CHECK_EQUAL(xs[4].to_list().at(2).to_integer(), 12);
 }
 
+TEST(size hints match the encoded size of primitive types) {
+  using detail::builder_access;
+  auto hint = builder_access::list_size_hint(
+    nil, true, count{42}, integer{-42}, 2.5, "hello"sv, localhost, localnet,
+    port{80, port::protocol::tcp}, tstamp, tspan, enum_value_view{"foo"});
+  list_builder builder;
+  builder.add_list(nil, true, 42u, -42, 2.5, "hello"sv, localhost, localnet,
+                   port{80, port::protocol::tcp}, tstamp, tspan,
+                   enum_value{"foo"});
+  auto [first, last] = builder.encoded_values();
+  CHECK_EQUAL(hint, static_cast<size_t>(last - first));
+  list_builder outer;
+  outer.add(builder);
+  auto [outer_first, outer_last] = outer.encoded_values();
+  CHECK_EQUAL(builder_access::size_hint(builder),
+              static_cast<size_t>(outer_last - outer_first));
+}
+
 CAF_TEST_FIXTURE_SCOPE_END()
@@ -3,6 +3,7 @@
 #include "broker/endpoint_id.hh"
 #include "broker/error.hh"
 #include "broker/expected.hh"
+#include "broker/internal/logger.hh"
 #include "broker/internal/type_id.hh"
 #include "broker/internal_command.hh"
 #include "broker/topic.hh"
@@ -12,6 +13,8 @@
 #include <caf/byte_buffer.hpp>
 #include <caf/deep_to_string.hpp>
 
+#include <mutex>
+
 using namespace std::literals;
 
 namespace broker {
@@ -37,9 +40,11 @@ using command_envelope_decorator_ptr =
 } // namespace
 
 envelope_ptr command_envelope::with(endpoint_id new_sender,
-                                    endpoint_id new_receiver) const {
+                                    endpoint_id new_receiver,
+                                    uint16_t new_ttl) const {
   return command_envelope_decorator_ptr::make(intrusive_ptr{new_ref, this},
-                                              new_sender, new_receiver);
+                                              new_sender, new_receiver,
+                                              new_ttl);
 }
 
 std::string command_envelope::stringify() const {
@@ -65,16 +70,12 @@ public:
       receiver_(receiver),
       topic_(std::move(topic_str)),
       value_(std::move(cmd)) {
-    caf::binary_serializer sink{nullptr, buf_};
-    if (!sink.apply(value_))
-      throw std::logic_error("failed to serialize command");
+    // nop
   }
 
   default_command_envelope(std::string&& topic_str, internal_command&& cmd)
     : topic_(topic_str), value_(std::move(cmd)) {
-    caf::binary_serializer sink{nullptr, buf_};
-    if (!sink.apply(value_))
-      throw std::logic_error("failed to serialize command");
+    // nop
   }
 
   endpoint_id sender() const noexcept override {
@@ -94,6 +95,16 @@ public:
   }
 
   std::pair<const std::byte*, size_t> raw_bytes() const noexcept override {
+    // Commands between a master and its local clones never leave the process.
+    // Hence, we only serialize the command once someone asks for its bytes,
+    // e.g., when sending it to a peer.
+    std::call_once(serialized_, [this] {
+      caf::binary_serializer sink{nullptr, buf_};
+      if (!sink.apply(value_)) {
+        BROKER_ERROR("failed to serialize command:" << sink.get_error());
+        buf_.clear();
+      }
+    });
     return {reinterpret_cast<const std::byte*>(buf_.data()), buf_.size()};
   }
 
@@ -102,7 +113,8 @@ private:
   endpoint_id receiver_;
   std::string topic_;
   internal_command value_;
-  caf::byte_buffer buf_;
+  mutable std::once_flag serialized_;
+  mutable caf::byte_buffer buf_;
 };
 
 using default_command_envelope_ptr = intrusive_ptr<default_command_envelope>;
@@ -153,17 +165,14 @@ private:
   internal_command value_;
 };
 
-using deserialized_command_envelope_ptr =
-  intrusive_ptr<deserialized_command_envelope>;
-
 } // namespace
 
 expected<envelope_ptr> command_envelope::deserialize(
   const endpoint_id& sender, const endpoint_id& receiver, uint16_t ttl,
   std::string_view topic_str, const std::byte* payload, size_t payload_size) {
-  auto result = deserialized_command_envelope_ptr::make(sender, receiver, ttl,
-                                                        topic_str, payload,
-                                                        payload_size);
+  using impl = deserialized_command_envelope;
+  auto result = impl::make<impl>(sender, receiver, ttl, topic_str, payload,
+                                 payload_size, 0);
   if (auto err = result->parse())
     return err;
   return {std::move(result)};
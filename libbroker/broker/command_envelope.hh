@@ -9,8 +9,10 @@ class command_envelope : public envelope {
 public:
   envelope_type type() const noexcept final;
 
-  envelope_ptr with(endpoint_id new_sender,
-                    endpoint_id new_receiver) const final;
+  using envelope::with;
+
+  envelope_ptr with(endpoint_id new_sender, endpoint_id new_receiver,
+                    uint16_t new_ttl) const final;
 
   std::string stringify() const override;
 
@@ -26,6 +26,7 @@
 #include "broker/internal/core_actor.hh"
 #include "broker/internal/native.hh"
 #include "broker/internal/retry_state.hh"
+#include "broker/internal/store_batch.hh"
 #include "broker/internal/type_id.hh"
 #include "broker/internal_command.hh"
 #include "broker/lamport_timestamp.hh"
@@ -113,6 +114,60 @@ struct configuration::impl : public caf::actor_system_config {
       .add(options.disable_forwarding, "disable-forwarding",
            "disables forwarding of incoming data to peers")
       .add(options.ttl, "ttl", "drop messages after traversing TTL hops")
+      .add(options.connector_threads, "connector-threads",
+           "number of threads for resolving and connecting to peers (0 = "
+           "connect on the connector thread)")
+      .add(options.max_retry_interval, "max-retry-interval",
+           "upper bound for doubling the retry interval with random jitter "
+           "after each failed connection attempt (0 = fixed interval)")
+      .add(options.max_pending_handshakes, "max-pending-handshakes",
+           "maximum number of concurrent incoming handshakes (0 = unlimited)")
+      .add(options.lightweight, "lightweight",
+           "starts the connector and the metric exporter on first use and "
+           "runs a minimal scheduler")
+      .add<bool>("routing-update-deltas",
+                 "sends incremental subscription changes to peers (requires "
+                 "that all peers support routing update deltas)")
+      .add<caf::timespan>("routing-update-interval",
+                          "time window for merging subscription changes into "
+                          "a single routing update per peer (0 = disabled)")
+      .add<bool>("batch-core-metrics",
+                 "updates message metrics of the core and of its peers once "
+                 "per scheduling step instead of once per message")
+      .add<size_t>("core-dispatchers",
+                   "number of actors that deliver data messages to local "
+                   "subscribers on behalf of the core (0 = disabled)")
+      .add<size_t>("duplicate-cache-size",
+                   "number of recently seen messages for dropping copies that "
+                   "arrive via redundant paths (0 = disabled)")
+      .add<size_t>("peer-buffer-size",
+                   "number of messages buffered for each peer that falls "
+                   "behind (0 = disabled, slow peers apply back-pressure)")
+      .add<size_t>("memory-budget",
+                   "maximum number of bytes in peer buffers before shedding "
+                   "data messages (0 = unlimited)")
+      .add<size_t>("huge-page-pool",
+                   "maximum number of bytes that message arenas reserve in "
+                   "2MB huge pages for recycling their blocks (0 = disabled)")
+      .add<string_list>("max-age",
+                        "maximum age of data messages in the format "
+                        "'<prefix>=<number><unit>' with unit 'ms', 's', 'min' "
+                        "or 'h', after which queues drop them")
+      .add<size_t>("async-publish-credit",
+                   "maximum number of messages that endpoint::publish may "
+                   "queue at the core (0 = unlimited)")
+      .add<string>("async-publish-policy",
+                   "what endpoint::publish does when running out of credit: "
+                   "'block' or 'drop'")
+      .add<string>("peer-overflow-policy",
+                   "what to do when a peer buffer overflows: 'drop-newest', "
+                   "'drop-oldest' or 'disconnect'")
+      .add<size_t>("peer-priority-window",
+                   "number of messages pulled ahead for each peer to let "
+                   "control messages overtake data (0 = disabled)")
+      .add<caf::timespan>("peer-probe-interval",
+                          "interval for measuring the round-trip time to each "
+                          "peer (0 = disabled)")
       .add<string>("recording-directory",
                    "path for storing recorded meta information")
       .add<size_t>(
@@ -120,6 +175,77 @@ struct configuration::impl : public caf::actor_system_config {
         "maximum number of entries when recording published messages")
       .add<size_t>("max-pending-inputs-per-source",
                    "maximum number of items we buffer per peer or publisher");
+    opt_group{custom_options_, "broker.affinity"}
+      .add<std::vector<size_t>>("core", "CPUs for the thread of the core actor "
+                                        "(empty = no pinning)")
+      .add<std::vector<size_t>>("connector",
+                                "CPUs for the connector thread (empty = no "
+                                "pinning)")
+      .add<std::vector<size_t>>("network",
+                                "CPUs for the thread that runs the network "
+                                "I/O of peers (empty = no pinning)");
+    opt_group{custom_options_, "broker.auto-batch"}
+      .add<size_t>("max-size", "maximum number of Zeek messages per topic "
+                               "that the core packs into one batch (0 = "
+                               "disabled)")
+      .add<caf::timespan>("linger", "maximum time a Zeek message waits for "
+                                    "its batch to fill up");
+    opt_group{custom_options_, "broker.flight-recorder"}
+      .add<string>("directory", "path for continuously capturing data and "
+                                "command messages (empty = disabled)")
+      .add<size_t>("queue-size", "maximum number of messages waiting for the "
+                                 "writer before dropping new messages")
+      .add<size_t>("max-file-size",
+                   "size in bytes at which the recorder starts a new file")
+      .add<size_t>("max-files", "maximum number of files to keep on disk "
+                                "(0 = unlimited)");
+    opt_group{custom_options_, "broker.network"}
+      .add(options.network.send_buffer_size, "send-buffer-size",
+           "size of the send buffer for peer sockets in bytes (0 = OS "
+           "default)")
+      .add(options.network.receive_buffer_size, "receive-buffer-size",
+           "size of the receive buffer for peer sockets in bytes (0 = OS "
+           "default)")
+      .add(options.network.tcp_nodelay, "tcp-nodelay",
+           "disables Nagle's algorithm on peer sockets")
+      .add(options.network.tcp_notsent_lowat, "tcp-notsent-lowat",
+           "maximum number of unsent bytes in the kernel before a peer "
+           "socket becomes writable (0 = OS default)")
+      .add(options.network.busy_poll, "busy-poll",
+           "microseconds to busy-poll peer sockets when reading (0 = "
+           "disabled)");
+    opt_group{custom_options_, "broker.publisher"} //
+      .add<size_t>("wakeup-threshold",
+                   "minimum demand that wakes up a blocked publisher (capped "
+                   "at the capacity of its buffer)");
+    opt_group{custom_options_, "broker.qos"} //
+      .add<string_list>("classes",
+                        "QoS classes for data messages in the format "
+                        "'<prefix>=<priority>[:<rate>[:<burst>]]' with "
+                        "priority 'bulk', 'normal' or 'critical' and rate in "
+                        "messages per second");
+    opt_group{custom_options_, "broker.subscriber"}
+      .add<size_t>("max-queue-size",
+                   "upper bound for growing subscriber queues under sustained "
+                   "load (0 = fixed queue size)")
+      .add<size_t>("wakeup-batch",
+                   "number of messages that wake up a subscriber at once "
+                   "(requires wakeup-delay)")
+      .add<caf::timespan>("wakeup-delay",
+                          "maximum time a message waits for reaching "
+                          "wakeup-batch (0 = disabled)");
+    opt_group{custom_options_, "broker.topic-log"}
+      .add<string>("directory", "path for retaining data messages for replay "
+                                "(empty = disabled)")
+      .add<string_list>("topics", "topic prefixes that the log retains")
+      .add<size_t>("segment-size", "size of each segment file in bytes")
+      .add<size_t>("max-size", "maximum number of bytes to keep on disk")
+      .add<caf::timespan>("max-age", "maximum time to keep messages (0 = "
+                                     "unlimited)");
+    opt_group{custom_options_, "broker.tracing"}
+      .add<bool>("enabled", "records hot-path trace events right from the "
+                            "start (requires a build with tracing support)")
+      .add<size_t>("buffer-size", "maximum number of trace events per thread");
     opt_group{custom_options_, "broker.web-socket"} //
       .add<string>("address", "bind address for the WebSocket server socket")
       .add<port>("port", "port for incoming WebSocket connections");
@@ -129,16 +255,33 @@ struct configuration::impl : public caf::actor_system_config {
       .add<string>(
         "endpoint-name",
         "name for this endpoint in metrics (when exporting: suffix of "
-        "the topic by default)");
+        "the topic by default)")
+      .add<size_t>("latency-sample-rate",
+                   "samples one out of N data messages for measuring the time "
+                   "messages spend in the core (0 = disabled)")
+      .add<size_t>("topic-depth",
+                   "number of topic levels for counting traffic per topic "
+                   "prefix (0 = disabled)")
+      .add<size_t>("max-topic-prefixes",
+                   "maximum number of topic prefixes for counting traffic")
+      .add<caf::timespan>("status-max-age",
+                          "maximum age of the status snapshot that the HTTP "
+                          "endpoint serves from its cache (0 = disabled)");
     opt_group{custom_options_, "broker.metrics.export"}
       .add<string>("topic", "if set, causes Broker to publish its metrics "
                             "periodically on the given topic")
       .add<caf::timespan>("interval",
                           "time between publishing metrics on the topic")
+      .add<caf::timespan>("full-refresh-interval",
+                          "if set, publishes only changed metrics and all "
+                          "metrics once per full refresh interval")
       .add<string_list>("prefixes",
                         "selects metric prefixes to publish on the topic");
     opt_group{custom_options_, "broker.metrics.import"} //
-      .add<string_list>("topics", "topics for collecting remote metrics from");
+      .add<string_list>("topics", "topics for collecting remote metrics from")
+      .add<std::vector<double>>("quantiles",
+                                "if set, reports these quantiles for "
+                                "histograms merged across all endpoints");
     opt_group{custom_options_, "broker.ssl"} //
       .add(ssl_options->certificate, "certificate",
            "path to the PEM-formatted certificate file")
@@ -149,7 +292,10 @@ struct configuration::impl : public caf::actor_system_config {
       .add(ssl_options->capath, "capath",
            "path to an OpenSSL-style directory of trusted certificates")
       .add(ssl_options->cafile, "cafile",
-           "path to a file of concatenated PEM-formatted certificates");
+           "path to a file of concatenated PEM-formatted certificates")
+      .add(ssl_options->enable_ktls, "enable-ktls",
+           "offloads encryption to the kernel if supported by OpenSSL "
+           "and the OS");
     // Ensure that we're only talking to compatible Broker instances.
     string_list ids{"broker.v" + std::to_string(version::protocol)};
     // Override CAF defaults.
@@ -324,6 +470,10 @@ void configuration::impl::init(int argc, char** argv) {
       throw std::runtime_error(what);
     }
   }
+  // Lightweight endpoints only override thread counts the user didn't set.
+  if (options.lightweight
+      && caf::get_if(&content, "caf.scheduler.max-threads") == nullptr)
+    set("caf.scheduler.max-threads", defaults::lightweight_scheduler_threads);
 }
 
 void configuration::init(int argc, char** argv) {
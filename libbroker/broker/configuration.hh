@@ -22,6 +22,30 @@ struct skip_init_t {};
 
 constexpr skip_init_t skip_init = skip_init_t{};
 
+/// Bundles tuning parameters that Broker applies to each peer socket.
+struct socket_options {
+  /// Size of the send buffer in bytes (SO_SNDBUF). A value of 0 keeps the
+  /// default of the operating system.
+  size_t send_buffer_size = defaults::network::send_buffer_size;
+
+  /// Size of the receive buffer in bytes (SO_RCVBUF). A value of 0 keeps the
+  /// default of the operating system.
+  size_t receive_buffer_size = defaults::network::receive_buffer_size;
+
+  /// Disables Nagle's algorithm if true (TCP_NODELAY).
+  bool tcp_nodelay = defaults::network::tcp_nodelay;
+
+  /// Limits how many unsent bytes the kernel buffers before reporting the
+  /// socket as writable (TCP_NOTSENT_LOWAT). A value of 0 keeps the default of
+  /// the operating system. Ignored on platforms without this option.
+  size_t tcp_notsent_lowat = defaults::network::tcp_notsent_lowat;
+
+  /// Microseconds the kernel busy-polls the socket when reading
+  /// (SO_BUSY_POLL). A value of 0 disables busy polling. Ignored on platforms
+  /// without this option.
+  size_t busy_poll = defaults::network::busy_poll;
+};
+
 /// Wraps low-level Broker system parameters.
 struct broker_options {
   /// If true, peer connections won't use SSL.
@@ -46,6 +70,27 @@ struct broker_options {
   /// How many hops we forward at the most before dropping a message.
   uint16_t ttl = defaults::ttl;
 
+  /// How many threads establish outgoing connections in the background.
+  size_t connector_threads = defaults::connector_threads;
+
+  /// Upper bound for the exponential backoff of connection retries. Setting
+  /// this to 0 disables the backoff and the jitter.
+  timespan max_retry_interval = defaults::max_retry_interval;
+
+  /// How many incoming handshakes the connector runs at the same time. Further
+  /// connections get closed right away and their peers try again later.
+  size_t max_pending_handshakes = defaults::max_pending_handshakes;
+
+  /// If true, the endpoint starts the connector on the first call to `listen`
+  /// or `peer` and the metric exporter on first use. Also, the CAF scheduler
+  /// runs with `defaults::lightweight_scheduler_threads` threads unless the
+  /// configuration sets `caf.scheduler.max-threads`. Meant for short-lived
+  /// tools and unit tests.
+  bool lightweight = false;
+
+  /// Tuning parameters for peer sockets.
+  socket_options network;
+
   broker_options() = default;
 
   broker_options(const broker_options&) = default;
@@ -61,6 +106,10 @@ struct openssl_options {
   std::string capath;
   std::string cafile;
 
+  /// Asks OpenSSL to hand bulk encryption to the kernel (kTLS) if supported by
+  /// the OpenSSL version, the kernel and the negotiated cipher.
+  bool enable_ktls = false;
+
   bool authentication_enabled() const noexcept;
 };
 
@@ -0,0 +1,270 @@
+#pragma once
+
+// C++20 coroutine support for applications. Broker itself builds as C++17.
+// Hence, this header is header-only and only available to applications that
+// compile with coroutine support.
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#  define BROKER_HAS_COROUTINES
+
+#  include "broker/data.hh"
+#  include "broker/endpoint.hh"
+#  include "broker/expected.hh"
+#  include "broker/message.hh"
+#  include "broker/store.hh"
+#  include "broker/subscriber.hh"
+#  include "broker/timeout.hh"
+
+#  include <chrono>
+#  include <coroutine>
+#  include <cstddef>
+#  include <cstdint>
+#  include <exception>
+#  include <functional>
+#  include <future>
+#  include <map>
+#  include <memory>
+#  include <optional>
+#  include <string>
+#  include <thread>
+#  include <utility>
+#  include <vector>
+
+namespace broker::coro {
+
+/// Resumes coroutines on behalf of an @ref event_loop, e.g., to move the
+/// continuation of a coroutine to a thread pool.
+class executor {
+public:
+  virtual ~executor() = default;
+
+  /// Schedules `hdl` for resumption.
+  virtual void post(std::coroutine_handle<> hdl) = 0;
+};
+
+/// A fire-and-forget coroutine type. The coroutine starts immediately and
+/// destroys itself when reaching the end of its body.
+struct task {
+  struct promise_type {
+    task get_return_object() noexcept {
+      return {};
+    }
+
+    std::suspend_never initial_suspend() noexcept {
+      return {};
+    }
+
+    std::suspend_never final_suspend() noexcept {
+      return {};
+    }
+
+    void return_void() noexcept {
+      // nop
+    }
+
+    void unhandled_exception() noexcept {
+      std::terminate();
+    }
+  };
+};
+
+class event_loop;
+
+/// An awaitable operation that completes once `ready` succeeds. Awaiting the
+/// operation suspends the coroutine until the @ref event_loop observes the
+/// result in `poll`.
+template <class T>
+class operation {
+public:
+  using ready_fn = std::function<bool(std::optional<T>&)>;
+
+  operation(event_loop* loop, ready_fn ready)
+    : loop_(loop), ready_(std::move(ready)) {
+    // nop
+  }
+
+  operation(const operation&) = delete;
+
+  operation& operator=(const operation&) = delete;
+
+  bool await_ready() {
+    return ready_(result_);
+  }
+
+  void await_suspend(std::coroutine_handle<> hdl);
+
+  T await_resume() {
+    return std::move(*result_);
+  }
+
+private:
+  event_loop* loop_;
+  ready_fn ready_;
+  std::optional<T> result_;
+};
+
+/// Drives coroutines that wait for store responses, subscribers or peerings.
+/// A single thread calling `poll` or `run` may serve thousands of concurrent
+/// requests, since suspended coroutines only occupy their frame.
+/// @note The event loop is not thread-safe. All coroutines that use the same
+///       loop must run (and resume) on the thread that calls `poll`, except
+///       when resuming through an @ref executor that serializes access.
+class event_loop {
+public:
+  template <class>
+  friend class operation;
+
+  /// @param exec Resumes coroutines instead of `poll` if not `nullptr`.
+  explicit event_loop(executor* exec = nullptr) noexcept : exec_(exec) {
+    // nop
+  }
+
+  event_loop(const event_loop&) = delete;
+
+  event_loop& operator=(const event_loop&) = delete;
+
+  // -- awaitables -------------------------------------------------------------
+
+  /// Peers with a remote endpoint.
+  /// @returns an awaitable that produces `true` on success.
+  operation<bool> peer(endpoint& ep, std::string address, uint16_t port,
+                       timeout::seconds retry = timeout::seconds(10)) {
+    auto fut = std::make_shared<std::future<bool>>(
+      ep.peer_async(std::move(address), port, retry));
+    return {this, [fut](std::optional<bool>& result) {
+              using namespace std::chrono_literals;
+              if (fut->wait_for(0s) != std::future_status::ready)
+                return false;
+              result = fut->get();
+              return true;
+            }};
+  }
+
+  /// Retrieves a value from the store.
+  operation<expected<data>> get(store::proxy& p, data key) {
+    return await_response(p, p.get(std::move(key)));
+  }
+
+  /// Inserts a value if the key does not already exist.
+  operation<expected<data>> put_unique(store::proxy& p, data key, data value,
+                                       std::optional<timespan> expiry = {}) {
+    return await_response(p, p.put_unique(std::move(key), std::move(value),
+                                          expiry));
+  }
+
+  /// Checks whether a key exists in the store.
+  operation<expected<data>> exists(store::proxy& p, data key) {
+    return await_response(p, p.exists(std::move(key)));
+  }
+
+  /// Retrieves all keys of the store.
+  operation<expected<data>> keys(store::proxy& p) {
+    return await_response(p, p.keys());
+  }
+
+  /// Receives the next message from `sub`.
+  operation<data_message> receive(subscriber& sub) {
+    return {this, [s = &sub](std::optional<data_message>& result) {
+              if (s->available() == 0)
+                return false;
+              result = s->get();
+              return true;
+            }};
+  }
+
+  // -- event processing -------------------------------------------------------
+
+  /// Checks whether no coroutine waits on this loop.
+  bool idle() const noexcept {
+    return pending_.empty();
+  }
+
+  /// Resumes all coroutines whose operation completed without blocking.
+  /// @returns the number of resumed coroutines.
+  size_t poll() {
+    // Move all available responses from the mailboxes to our response map.
+    for (auto& [ptr, num] : proxies_) {
+      ptr->flush();
+      if (ptr->buffered() == 0 && ptr->mailbox().size() == 0)
+        continue;
+      for (auto& resp : ptr->receive_many())
+        responses_.insert_or_assign(std::pair{ptr, resp.id},
+                                    std::move(resp.answer));
+    }
+    // Resuming a coroutine may add new pending operations. Hence, we collect
+    // all ready handles first.
+    std::vector<std::coroutine_handle<>> ready;
+    auto i = pending_.begin();
+    while (i != pending_.end()) {
+      if (i->ready()) {
+        ready.push_back(i->hdl);
+        i = pending_.erase(i);
+      } else {
+        ++i;
+      }
+    }
+    for (auto hdl : ready) {
+      if (exec_)
+        exec_->post(hdl);
+      else
+        hdl.resume();
+    }
+    return ready.size();
+  }
+
+  /// Calls `poll` until no coroutine waits on this loop, sleeping for
+  /// `interval` whenever no operation completed.
+  void run(timespan interval = std::chrono::milliseconds(1)) {
+    while (!idle())
+      if (poll() == 0)
+        std::this_thread::sleep_for(interval);
+  }
+
+private:
+  using response_key = std::pair<store::proxy*, request_id>;
+
+  struct pending_op {
+    std::coroutine_handle<> hdl;
+    std::function<bool()> ready;
+  };
+
+  operation<expected<data>> await_response(store::proxy& p, request_id id) {
+    ++proxies_[&p];
+    return {this, [this, ptr = &p, id](std::optional<expected<data>>& result) {
+              auto i = responses_.find(response_key{ptr, id});
+              if (i == responses_.end())
+                return false;
+              result = std::move(i->second);
+              responses_.erase(i);
+              if (auto j = proxies_.find(ptr); --j->second == 0)
+                proxies_.erase(j);
+              return true;
+            }};
+  }
+
+  void add(std::coroutine_handle<> hdl, std::function<bool()> ready) {
+    pending_.push_back(pending_op{hdl, std::move(ready)});
+  }
+
+  /// Resumes coroutines if not `nullptr`.
+  executor* exec_;
+
+  /// Stores all suspended coroutines.
+  std::vector<pending_op> pending_;
+
+  /// Counts the outstanding requests per proxy.
+  std::map<store::proxy*, size_t> proxies_;
+
+  /// Stores responses until their coroutine picks them up.
+  std::map<response_key, expected<data>> responses_;
+};
+
+template <class T>
+void operation<T>::await_suspend(std::coroutine_handle<> hdl) {
+  loop_->add(hdl, [this] { return ready_(result_); });
+}
+
+} // namespace broker::coro
+
+#endif // defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
@@ -1,5 +1,8 @@
 #include "broker/data.hh"
 
+#include <cstring>
+#include <string_view>
+
 #include <caf/hash/fnv.hpp>
 #include <caf/node_id.hpp>
 
@@ -212,4 +215,240 @@ size_t fnv_hash(const broker::table& x) {
   return caf::hash::fnv<size_t>::compute(x);
 }
 
+namespace {
+
+template <class T>
+int compare_values(const T& x, const T& y) noexcept {
+  if (x < y)
+    return -1;
+  return y < x ? 1 : 0;
+}
+
+int compare_values(const data& x, const data& y) noexcept {
+  return compare(x, y);
+}
+
+int compare_values(const std::string& x, const std::string& y) noexcept {
+  auto res = x.compare(y);
+  return res < 0 ? -1 : (res > 0 ? 1 : 0);
+}
+
+int compare_values(const table::value_type& x,
+                   const table::value_type& y) noexcept {
+  if (auto res = compare(x.first, y.first); res != 0)
+    return res;
+  return compare(x.second, y.second);
+}
+
+// Compares two containers lexicographically.
+template <class Container>
+int compare_sequences(const Container& xs, const Container& ys) noexcept {
+  auto i = xs.begin();
+  auto j = ys.begin();
+  for (; i != xs.end() && j != ys.end(); ++i, ++j)
+    if (auto res = compare_values(*i, *j); res != 0)
+      return res;
+  if (i != xs.end())
+    return 1;
+  return j != ys.end() ? -1 : 0;
+}
+
+} // namespace
+
+int compare(const data& x, const data& y) noexcept {
+  const auto& xv = x.get_data();
+  const auto& yv = y.get_data();
+  // Same as for std::variant: values with a lower index come first.
+  if (xv.index() != yv.index())
+    return xv.index() < yv.index() ? -1 : 1;
+  return std::visit(
+    [&yv](const auto& lhs) -> int {
+      using value_type = std::decay_t<decltype(lhs)>;
+      const auto& rhs = *std::get_if<value_type>(&yv);
+      if constexpr (std::is_same_v<value_type, set>
+                           || std::is_same_v<value_type, table>
+                           || std::is_same_v<value_type, vector>) {
+        return compare_sequences(lhs, rhs);
+      } else {
+        return compare_values(lhs, rhs);
+      }
+    },
+    xv);
+}
+
+namespace {
+
+/// Hashes values in 64-bit words, using the mixing steps of the 64-bit
+/// variant of MurmurHash3.
+class data_hasher {
+public:
+  void add(uint64_t x) noexcept {
+    x *= k1;
+    x = rotl(x, 31);
+    x *= k2;
+    h_ ^= x;
+    h_ = rotl(h_, 27) * 5 + 0x52dce729;
+  }
+
+  void add(std::string_view str) noexcept {
+    add(static_cast<uint64_t>(str.size()));
+    add_bytes(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+  }
+
+  void add_bytes(const uint8_t* bytes, size_t size) noexcept {
+    // Note: assembling the words from single bytes produces the same result
+    //       on all platforms. Compilers turn this into a single load on
+    //       little-endian machines.
+    auto load = [](const uint8_t* pos, size_t n) {
+      uint64_t result = 0;
+      for (size_t i = 0; i < n; ++i)
+        result |= uint64_t{pos[i]} << (8 * i);
+      return result;
+    };
+    for (; size >= 8; bytes += 8, size -= 8)
+      add(load(bytes, 8));
+    if (size > 0)
+      add(load(bytes, size));
+  }
+
+  void add(const data& x) noexcept {
+    const auto& val = x.get_data();
+    add(static_cast<uint64_t>(val.index()));
+    std::visit([this](const auto& y) { add_value(y); }, val);
+  }
+
+  void add(const table::value_type& x) noexcept {
+    add(x.first);
+    add(x.second);
+  }
+
+  template <class Container>
+  void add_sequence(const Container& xs) noexcept {
+    add(static_cast<uint64_t>(xs.size()));
+    for (const auto& x : xs)
+      add(x);
+  }
+
+  size_t result() const noexcept {
+    // Finalization step of MurmurHash3.
+    auto h = h_;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+  }
+
+private:
+  static constexpr uint64_t k1 = 0x87c37b91114253d5ULL;
+
+  static constexpr uint64_t k2 = 0x4cf5ad432745937fULL;
+
+  static uint64_t rotl(uint64_t x, int r) noexcept {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  void add_value(none) noexcept {
+    // nop
+  }
+
+  void add_value(boolean x) noexcept {
+    add(x ? uint64_t{1} : uint64_t{0});
+  }
+
+  void add_value(count x) noexcept {
+    add(x);
+  }
+
+  void add_value(integer x) noexcept {
+    add(static_cast<uint64_t>(x));
+  }
+
+  void add_value(real x) noexcept {
+    // Note: 0.0 and -0.0 compare equal, so they must have the same hash.
+    if (x == 0)
+      x = 0;
+    uint64_t bits = 0;
+    memcpy(&bits, &x, sizeof(bits));
+    add(bits);
+  }
+
+  void add_value(const std::string& x) noexcept {
+    add(std::string_view{x});
+  }
+
+  void add_value(const address& x) noexcept {
+    add_bytes(x.bytes().data(), x.bytes().size());
+  }
+
+  void add_value(const subnet& x) noexcept {
+    add_value(x.network());
+    add(static_cast<uint64_t>(x.length()));
+  }
+
+  void add_value(const port& x) noexcept {
+    add((static_cast<uint64_t>(x.number()) << 8)
+        | static_cast<uint64_t>(x.type()));
+  }
+
+  void add_value(timestamp x) noexcept {
+    add(static_cast<uint64_t>(x.time_since_epoch().count()));
+  }
+
+  void add_value(timespan x) noexcept {
+    add(static_cast<uint64_t>(x.count()));
+  }
+
+  void add_value(const enum_value& x) noexcept {
+    add(std::string_view{x.name});
+  }
+
+  void add_value(const set& xs) noexcept {
+    add_sequence(xs);
+  }
+
+  void add_value(const table& xs) noexcept {
+    add_sequence(xs);
+  }
+
+  void add_value(const vector& xs) noexcept {
+    add_sequence(xs);
+  }
+
+  uint64_t h_ = 0;
+};
+
+template <class T>
+size_t data_hash_impl(const T& x) noexcept {
+  data_hasher f;
+  if constexpr (std::is_same_v<T, data> || std::is_same_v<T, table::value_type>)
+    f.add(x);
+  else
+    f.add_sequence(x);
+  return f.result();
+}
+
+} // namespace
+
+size_t data_hash(const broker::data& x) noexcept {
+  return data_hash_impl(x);
+}
+
+size_t data_hash(const broker::set& x) noexcept {
+  return data_hash_impl(x);
+}
+
+size_t data_hash(const broker::vector& x) noexcept {
+  return data_hash_impl(x);
+}
+
+size_t data_hash(const broker::table::value_type& x) noexcept {
+  return data_hash_impl(x);
+}
+
+size_t data_hash(const broker::table& x) noexcept {
+  return data_hash_impl(x);
+}
+
 } // namespace broker::detail
@@ -485,20 +485,30 @@ bool convert(const endpoint_id& node, data& x);
 /// @relates data
 std::string to_string(const expected<data>& x);
 
+namespace detail {
+
+/// Compares `x` and `y` in a single pass, i.e., without comparing nested
+/// elements twice as the relational operators of the STL containers do.
+/// @returns a negative value if `x < y`, zero if `x == y` and a positive value
+///          if `x > y`.
+int compare(const data& x, const data& y) noexcept;
+
+} // namespace detail
+
 inline bool operator<(const data& x, const data& y) {
-  return x.get_data() < y.get_data();
+  return detail::compare(x, y) < 0;
 }
 
 inline bool operator<=(const data& x, const data& y) {
-  return x.get_data() <= y.get_data();
+  return detail::compare(x, y) <= 0;
 }
 
 inline bool operator>(const data& x, const data& y) {
-  return x.get_data() > y.get_data();
+  return detail::compare(x, y) > 0;
 }
 
 inline bool operator>=(const data& x, const data& y) {
-  return x.get_data() >= y.get_data();
+  return detail::compare(x, y) >= 0;
 }
 
 inline bool operator==(const data& x, const data& y) {
@@ -622,6 +632,23 @@ size_t fnv_hash(const broker::table::value_type& x);
 
 size_t fnv_hash(const broker::table& x);
 
+/// Computes a hash value for `x`. Processes 8 bytes per step, which makes this
+/// considerably faster than `fnv_hash` for strings and containers. The result
+/// is the same on all platforms.
+size_t data_hash(const broker::data& x) noexcept;
+
+/// @copydoc data_hash
+size_t data_hash(const broker::set& x) noexcept;
+
+/// @copydoc data_hash
+size_t data_hash(const broker::vector& x) noexcept;
+
+/// @copydoc data_hash
+size_t data_hash(const broker::table::value_type& x) noexcept;
+
+/// @copydoc data_hash
+size_t data_hash(const broker::table& x) noexcept;
+
 } // namespace broker::detail
 
 // --- implementations of std::hash --------------------------------------------
@@ -631,35 +658,35 @@ namespace std {
 template <>
 struct hash<broker::data> {
   size_t operator()(const broker::data& x) const {
-    return broker::detail::fnv_hash(x);
+    return broker::detail::data_hash(x);
   }
 };
 
 template <>
 struct hash<broker::set> {
   size_t operator()(const broker::set& x) const {
-    return broker::detail::fnv_hash(x);
+    return broker::detail::data_hash(x);
   }
 };
 
 template <>
 struct hash<broker::vector> {
   size_t operator()(const broker::vector& x) const {
-    return broker::detail::fnv_hash(x);
+    return broker::detail::data_hash(x);
   }
 };
 
 template <>
 struct hash<broker::table::value_type> {
   size_t operator()(const broker::table::value_type& x) const {
-    return broker::detail::fnv_hash(x);
+    return broker::detail::data_hash(x);
   }
 };
 
 template <>
 struct hash<broker::table> {
   size_t operator()(const broker::table& x) const {
-    return broker::detail::fnv_hash(x);
+    return broker::detail::data_hash(x);
   }
 };
 
@@ -116,6 +116,48 @@ TEST(data - relational operators) {
   CHECK_EQUAL(data{1.111}, data{1.111});
 }
 
+TEST(data - ordering agrees with std::variant) {
+  using namespace std::literals;
+  std::vector<data> xs{data{},
+                       data{true},
+                       data{1u},
+                       data{-1},
+                       data{2.5},
+                       data{""s},
+                       data{"abc"s},
+                       data{"abd"s},
+                       data{vector{}},
+                       data{vector{1, "a"s}},
+                       data{vector{1, "b"s}},
+                       data{vector{1, "a"s, 2}},
+                       data{set{1, 2}},
+                       data{set{1, 3}},
+                       data{table{{1, "a"s}}},
+                       data{table{{1, "b"s}}},
+                       data{table{{2, "a"s}}}};
+  for (const auto& x : xs) {
+    for (const auto& y : xs) {
+      CHECK_EQUAL(x < y, x.get_data() < y.get_data());
+      CHECK_EQUAL(x <= y, x.get_data() <= y.get_data());
+      CHECK_EQUAL(x > y, x.get_data() > y.get_data());
+      CHECK_EQUAL(x >= y, x.get_data() >= y.get_data());
+    }
+  }
+}
+
+TEST(data - hashing) {
+  using namespace std::literals;
+  std::hash<data> h;
+  CHECK_EQUAL(h(data{"abc"s}), h(data{"abc"s}));
+  CHECK_EQUAL(h(data{vector{1, "a"s}}), h(data{vector{1, "a"s}}));
+  CHECK_EQUAL(h(data{0.0}), h(data{-0.0}));
+  CHECK_NOT_EQUAL(h(data{"abc"s}), h(data{"abd"s}));
+  CHECK_NOT_EQUAL(h(data{1}), h(data{1u}));
+  CHECK_NOT_EQUAL(h(data{"0123456789"s}), h(data{"0123456788"s}));
+  CHECK_NOT_EQUAL(h(data{vector{1, 2}}), h(data{vector{2, 1}}));
+  CHECK_NOT_EQUAL(h(data{set{}}), h(data{vector{}}));
+}
+
 TEST(data - vector) {
   vector v{42, 43, 44};
   REQUIRE_EQUAL(v.size(), 3u);
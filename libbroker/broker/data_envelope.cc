@@ -1,15 +1,23 @@
 #include "broker/data_envelope.hh"
 
+#include "broker/defaults.hh"
 #include "broker/detail/monotonic_buffer_resource.hh"
 #include "broker/endpoint_id.hh"
 #include "broker/error.hh"
 #include "broker/expected.hh"
 #include "broker/format/bin.hh"
+#include "broker/format/json.hh"
 #include "broker/internal/json.hh"
 #include "broker/internal/native.hh"
 #include "broker/internal/type_id.hh"
 #include "broker/topic.hh"
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+
 #include <caf/binary_serializer.hpp>
 #include <caf/byte_buffer.hpp>
 #include <caf/expected.hpp>
@@ -25,13 +33,45 @@ using mbr_allocator = broker::detail::monotonic_buffer_resource::allocator<T>;
 
 using const_byte_pointer = const std::byte*;
 
+/// Upper bound for the capacity of the thread-local scratch buffer in
+/// `data_envelope::make`.
+constexpr size_t max_scratch_buffer_size = 64 * 1024;
+
 } // namespace
 
 namespace broker {
 
 namespace {
 
-/// A @ref data_envelope for deserialized data.
+/// Creates the root object in `buf` and parses `bytes` into it by calling
+/// `parse(root, first, last)`.
+template <class Parse>
+variant_data* parse_root(detail::monotonic_buffer_resource& buf,
+                         std::pair<const std::byte*, size_t> bytes, error& err,
+                         Parse parse) {
+  auto [first, size] = bytes;
+  if (first == nullptr || size == 0) {
+    err = make_error(ec::deserialization_failed, "cannot parse null data");
+    return nullptr;
+  }
+  // Create the root object.
+  variant_data* root;
+  {
+    mbr_allocator<variant_data> allocator{&buf};
+    root = new (allocator.allocate(1)) variant_data();
+  }
+  // Parse the data. This is a shallow parse, which is why we need to copy the
+  // bytes into the buffer resource first.
+  auto last = first + size;
+  auto [ok, pos] = parse(*root, first, last);
+  if (ok && pos == last)
+    return root;
+  err = make_error(ec::deserialization_failed, "failed to parse data");
+  return nullptr;
+}
+
+/// A @ref data_envelope for deserialized data. Decodes nested lists only when
+/// accessed, since many consumers only look at the first few fields.
 class deserialized_data_envelope
   : public envelope::deserialized<data_envelope> {
 public:
@@ -49,109 +89,84 @@ public:
 
   error parse() {
     error result;
-    root_ = do_parse(this->buf(), result);
+    root_ = parse_root(this->buf(), this->raw_bytes(), result,
+                       [this](variant_data& root, const std::byte* first,
+                              const std::byte* last) {
+                         return root.parse_lazy(ctx_, first, last);
+                       });
     return result;
   }
 
 private:
   variant_data* root_ = nullptr;
+  variant_data::lazy_context ctx_{&this->buf()};
 };
 
-using deserialized_data_envelope_ptr =
-  intrusive_ptr<deserialized_data_envelope>;
+/// Estimates how many bytes `parse_shallow` allocates for the variant tree of
+/// a payload with `size` bytes. Trees that exceed the estimate spill into
+/// additional memory blocks.
+constexpr size_t arena_size_hint(size_t size) noexcept {
+  constexpr size_t max_hint = 16 * 1024;
+  return std::min(size * 4 + 256, max_hint);
+}
+
+/// Creates a data envelope in a single allocation and parses its payload.
+/// Stores parser errors in `err`.
+intrusive_ptr<deserialized_data_envelope>
+make_deserialized(const endpoint_id& sender, const endpoint_id& receiver,
+                  uint16_t ttl, std::string_view topic_str,
+                  const std::byte* payload, size_t payload_size, error& err) {
+  using impl = deserialized_data_envelope;
+  auto result = impl::make<impl>(sender, receiver, ttl, topic_str, payload,
+                                 payload_size, arena_size_hint(payload_size));
+  err = result->parse();
+  return result;
+}
 
 } // namespace
 
 expected<data_envelope_ptr> data_envelope::deserialize(
   const endpoint_id& sender, const endpoint_id& receiver, uint16_t ttl,
   std::string_view topic_str, const std::byte* payload, size_t payload_size) {
-  auto result = deserialized_data_envelope_ptr::make(sender, receiver, ttl,
-                                                     topic_str, payload,
-                                                     payload_size);
-  if (auto err = result->parse())
+  error err;
+  auto result = make_deserialized(sender, receiver, ttl, topic_str, payload,
+                                  payload_size, err);
+  if (err)
     return err;
   return {std::move(result)};
 }
 
+data_envelope::~data_envelope() {
+  delete json_.load(std::memory_order_relaxed);
+}
+
+std::string_view data_envelope::to_json() const {
+  if (auto ptr = json_.load(std::memory_order_acquire))
+    return *ptr;
+  auto str = std::make_unique<std::string>();
+  format::json::v1::encode(data_envelope_ptr{new_ref, this},
+                           std::back_inserter(*str));
+  // Note: concurrent calls may render the JSON twice. Only the first result
+  // makes it into the cache, all other threads discard their copy.
+  const std::string* expected = nullptr;
+  if (json_.compare_exchange_strong(expected, str.get(),
+                                    std::memory_order_acq_rel,
+                                    std::memory_order_acquire))
+    return *str.release();
+  return *expected;
+}
+
 variant_data* data_envelope::do_parse(detail::monotonic_buffer_resource& buf,
                                       error& err) {
-  auto [bytes, size] = raw_bytes();
-  if (bytes == nullptr || size == 0) {
-    err = make_error(ec::deserialization_failed, "cannot parse null data");
-    return nullptr;
-  }
-  // Create the root object.
-  variant_data* root;
-  {
-    mbr_allocator<variant_data> allocator{&buf};
-    root = new (allocator.allocate(1)) variant_data();
-  }
-  // Parse the data. This is a shallow parse, which is why we need to copy the
-  // bytes into the buffer resource first.
-  auto end = bytes + size;
-  auto [ok, pos] = root->parse_shallow(buf, bytes, end);
-  if (ok && pos == end)
-    return root;
-  err = make_error(ec::deserialization_failed, "failed to parse data");
-  return nullptr;
+  return parse_root(buf, raw_bytes(), err,
+                    [&buf](variant_data& root, const std::byte* first,
+                           const std::byte* last) {
+                      return root.parse_shallow(buf, first, last);
+                    });
 }
 
 namespace {
 
-/// The default implementation for @ref data_envelope that wraps a byte buffer
-/// and a topic.
-class default_data_envelope : public data_envelope {
-public:
-  default_data_envelope(endpoint_id sender, endpoint_id receiver,
-                        std::string topic_str, caf::byte_buffer bytes)
-    : sender_(sender),
-      receiver_(receiver),
-      topic_(std::move(topic_str)),
-      bytes_(std::move(bytes)) {
-    // nop
-  }
-
-  endpoint_id sender() const noexcept override {
-    return sender_;
-  }
-
-  endpoint_id receiver() const noexcept override {
-    return receiver_;
-  }
-
-  variant value() const noexcept override {
-    return {root_, {new_ref, this}};
-  }
-
-  std::string_view topic() const noexcept override {
-    return topic_;
-  }
-
-  bool is_root(const variant_data* val) const noexcept override {
-    return val == root_;
-  }
-
-  std::pair<const std::byte*, size_t> raw_bytes() const noexcept override {
-    return {reinterpret_cast<const std::byte*>(bytes_.data()), bytes_.size()};
-  }
-
-  error parse() {
-    error result;
-    root_ = do_parse(buf_, result);
-    return result;
-  }
-
-private:
-  endpoint_id sender_;
-  endpoint_id receiver_;
-  variant_data* root_ = nullptr;
-  std::string topic_;
-  caf::byte_buffer bytes_;
-  detail::monotonic_buffer_resource buf_;
-};
-
-using default_data_envelope_ptr = intrusive_ptr<default_data_envelope>;
-
 /// Decorates another data envelope to override sender and receiver.
 class data_envelope_decorator : public envelope::decorator<data_envelope> {
 public:
@@ -173,9 +188,10 @@ using data_envelope_decorator_ptr = intrusive_ptr<data_envelope_decorator>;
 } // namespace
 
 envelope_ptr data_envelope::with(endpoint_id new_sender,
-                                 endpoint_id new_receiver) const {
+                                 endpoint_id new_receiver,
+                                 uint16_t new_ttl) const {
   return data_envelope_decorator_ptr::make(intrusive_ptr{new_ref, this},
-                                           new_sender, new_receiver);
+                                           new_sender, new_receiver, new_ttl);
 }
 
 std::string data_envelope::stringify() const {
@@ -194,22 +210,26 @@ data_envelope_ptr data_envelope::make(broker::topic t, const data& d) {
 data_envelope_ptr data_envelope::make(const endpoint_id& sender,
                                       const endpoint_id& receiver,
                                       broker::topic t, const data& d) {
-  caf::byte_buffer buf;
-  buf.reserve(512);
+  // Serialize into a scratch buffer first to learn the payload size. This
+  // allows us to allocate the envelope with its payload in one go.
+  thread_local caf::byte_buffer buf;
+  buf.clear();
   format::bin::v1::encode(d, std::back_inserter(buf));
-  auto res = default_data_envelope_ptr::make(sender, receiver,
-                                             std::move(t).move_string(),
-                                             std::move(buf));
+  error err;
+  auto res = make_deserialized(sender, receiver, defaults::ttl, t.string(),
+                               reinterpret_cast<const std::byte*>(buf.data()),
+                               buf.size(), err);
 #ifndef NDEBUG
-  if (auto err = res->parse()) {
+  if (err) {
     auto errstr = to_string(err);
     fprintf(stderr, "broker::envelope::make generated malformed data: %s\n",
             errstr.c_str());
     abort();
   }
-#else
-  std::ignore = res->parse();
 #endif
+  // Do not hold on to large chunks of memory after encoding large values.
+  if (buf.capacity() > max_scratch_buffer_size)
+    caf::byte_buffer{}.swap(buf);
   return res;
 }
 
@@ -238,12 +258,40 @@ public:
   std::pair<const std::byte*, size_t> raw_bytes() const noexcept override {
     if (val_.is_root())
       return val_.shared_envelope()->raw_bytes();
-    return {nullptr, 0};
+    // Elements of a batch are lazy lists that point into the bytes of the
+    // batch. In this case, we can forward the encoded element as-is.
+    if (auto bytes = lazy_bytes(); bytes.first != nullptr)
+      return bytes;
+    // Otherwise, we serialize the value once someone asks for its bytes, e.g.,
+    // when sending it to a peer.
+    std::call_once(serialized_, [this] {
+      format::bin::v1::encode(val_, std::back_inserter(buf_));
+    });
+    return {reinterpret_cast<const std::byte*>(buf_.data()), buf_.size()};
   }
 
 private:
+  /// Returns the encoded bytes of `val_` in the bytes of its envelope if
+  /// `val_` is a lazy list or `{nullptr, 0}` otherwise.
+  std::pair<const std::byte*, size_t> lazy_bytes() const noexcept {
+    auto* lazy = val_.raw()->lazy;
+    if (lazy == nullptr)
+      return {nullptr, 0};
+    // The tag and the size of the list precede its elements.
+    std::byte header[16];
+    header[0] = static_cast<std::byte>(variant_tag::list);
+    auto header_end = format::bin::v1::write_varbyte(lazy->size, header + 1);
+    auto header_size = static_cast<size_t>(header_end - header);
+    auto first = lazy->first - header_size;
+    if (std::memcmp(first, header, header_size) != 0)
+      return {nullptr, 0};
+    return {first, static_cast<size_t>(lazy->last - first)};
+  }
+
   std::string topic_;
   variant val_;
+  mutable std::once_flag serialized_;
+  mutable caf::byte_buffer buf_;
 };
 
 using data_envelope_wrapper_ptr = intrusive_ptr<data_envelope_wrapper>;
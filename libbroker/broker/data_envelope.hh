@@ -2,15 +2,23 @@
 
 #include "broker/envelope.hh"
 
+#include <atomic>
+#include <string>
+#include <string_view>
+
 namespace broker {
 
 /// Wraps a value of type @ref variant and associates it with a @ref topic.
 class data_envelope : public envelope {
 public:
+  ~data_envelope() override;
+
   envelope_type type() const noexcept final;
 
-  envelope_ptr with(endpoint_id new_sender,
-                    endpoint_id new_receiver) const final;
+  using envelope::with;
+
+  envelope_ptr with(endpoint_id new_sender, endpoint_id new_receiver,
+                    uint16_t new_ttl) const final;
 
   std::string stringify() const override;
 
@@ -21,6 +29,13 @@ public:
   /// Checks whether `val` is the root value.
   virtual bool is_root(const variant_data* val) const noexcept = 0;
 
+  /// Returns the JSON representation of this envelope as rendered by
+  /// `format::json::v1::encode`. The envelope renders the JSON on first access
+  /// and caches it afterwards. Hence, all WebSocket clients that receive the
+  /// same envelope share a single rendering.
+  /// @note the result remains valid for the lifetime of this envelope.
+  std::string_view to_json() const;
+
   /// Creates a new data envelope from the given @ref topic and @ref data.
   static data_envelope_ptr make(broker::topic t, const data& d);
 
@@ -45,6 +60,10 @@ public:
 protected:
   /// Parses the data returned from @ref raw_bytes.
   variant_data* do_parse(detail::monotonic_buffer_resource& buf, error& err);
+
+private:
+  /// Caches the result of `to_json()`. A null pointer means "not rendered yet".
+  mutable std::atomic<const std::string*> json_{nullptr};
 };
 
 /// A shared pointer to a @ref data_envelope.
@@ -12,6 +12,77 @@ namespace broker::defaults {
 
 constexpr uint16_t ttl = 16;
 
+/// Configures whether endpoints send incremental routing updates by default.
+constexpr bool routing_update_deltas = false;
+
+/// Configures how long endpoints collect subscription changes before sending a
+/// single routing update to their peers. A value of 0 sends each change
+/// immediately.
+constexpr timespan routing_update_interval = timespan{0};
+
+/// Configures whether the core updates its message metrics once per batch.
+constexpr bool batch_core_metrics = false;
+
+/// Configures how many dispatchers deliver data messages to local subscribers.
+/// A value of 0 lets the core deliver all messages itself.
+constexpr size_t core_dispatchers = 0;
+
+/// Configures how many message fingerprints the core keeps for dropping copies
+/// of messages that arrive via redundant paths. A value of 0 disables
+/// duplicate suppression.
+constexpr size_t duplicate_cache_size = 0;
+
+/// Configures how many threads the connector uses for resolving host names and
+/// connecting to peers. A value of 0 lets the connector thread connect by
+/// itself. Each thread blocks for up to one second per unreachable peer, so the
+/// default allows several connection attempts to run in parallel.
+constexpr size_t connector_threads = 4;
+
+/// Configures the upper bound when doubling the retry interval after each
+/// failed connection attempt. A value of 0 disables the exponential backoff,
+/// i.e., the connector always waits for the retry interval of the peer.
+constexpr timespan max_retry_interval = timespan{0};
+
+/// Configures how many incoming handshakes the connector runs concurrently. A
+/// value of 0 disables the limit.
+constexpr size_t max_pending_handshakes = 0;
+
+/// Configures how many threads the CAF scheduler of a lightweight endpoint
+/// uses unless `caf.scheduler.max-threads` says otherwise.
+constexpr size_t lightweight_scheduler_threads = 1;
+
+/// Configures how many messages `endpoint::publish` may send to the core
+/// before the core processed them. A value of 0 disables the limit.
+constexpr size_t async_publish_credit = 0;
+
+/// Configures what `endpoint::publish` does when running out of credit.
+constexpr std::string_view async_publish_policy = "block";
+
+/// Configures how many bytes the core may hold in the buffers of all peers
+/// before shedding data messages. A value of 0 disables the limit.
+constexpr size_t memory_budget = 0;
+
+/// Configures how many bytes message arenas may reserve in 2MB huge pages for
+/// recycling their memory blocks. A value of 0 disables the huge page pool.
+constexpr size_t huge_page_pool = 0;
+
+/// Configures how many messages the core buffers for each peer that falls
+/// behind. A value of 0 disables the buffer and lets slow peers slow down the
+/// core via back-pressure.
+constexpr size_t peer_buffer_size = 0;
+
+/// Configures what the core does when the buffer for a peer overflows.
+constexpr std::string_view peer_overflow_policy = "disconnect";
+
+/// Configures how many messages the core pulls ahead for each peer in order to
+/// let control messages overtake pending data messages. A value of 0 disables
+/// priority lanes.
+constexpr size_t peer_priority_window = 0;
+
+/// Configures how often the core sends a latency probe to each peer. A value
+/// of 0 disables the probes.
+constexpr timespan peer_probe_interval = timespan{0};
+
 constexpr std::string_view recording_directory = "";
 
 constexpr size_t output_generator_file_cap = std::numeric_limits<size_t>::max();
@@ -22,18 +93,177 @@ constexpr timespan await_peer_timeout = std::chrono::seconds{10};
 /// Configures the default timeout for unpeering from another node.
 constexpr timespan unpeer_timeout = std::chrono::seconds{3};
 
+/// Configures how long the core waits for buffered messages to reach its peers
+/// on shutdown when draining peers.
+constexpr timespan drain_timeout = std::chrono::seconds{5};
+
+/// Configures how often the core checks whether its buffers are empty while
+/// draining peers.
+constexpr timespan drain_poll_interval = std::chrono::milliseconds{10};
+
 } // namespace broker::defaults
 
+namespace broker::defaults::tracing {
+
+/// Configures whether the tracer records events right from the start. Requires
+/// a build with `BROKER_ENABLE_TRACING`.
+constexpr bool enabled = false;
+
+/// Configures how many events the tracer keeps per thread before overriding
+/// the oldest events.
+constexpr size_t buffer_size = 8192;
+
+} // namespace broker::defaults::tracing
+
+namespace broker::defaults::web_socket {
+
+/// Configures how long a message may wait for its batch to fill up when
+/// WebSocket clients enable batching.
+constexpr timespan batch_timeout = std::chrono::milliseconds{1};
+
+} // namespace broker::defaults::web_socket
+
+namespace broker::defaults::auto_batch {
+
+/// Configures how many Zeek messages the core packs into a single batch for
+/// each topic. A value of 0 disables automatic batching.
+constexpr size_t max_size = 0;
+
+/// Configures how long a Zeek message may wait for its batch to fill up.
+constexpr timespan linger = std::chrono::milliseconds{1};
+
+} // namespace broker::defaults::auto_batch
+
+namespace broker::defaults::flight_recorder {
+
+/// Configures the directory for continuously capturing traffic. An empty
+/// string disables the flight recorder.
+constexpr std::string_view directory = "";
+
+/// Configures how many messages may wait for the writer thread before the
+/// flight recorder starts dropping messages.
+constexpr size_t queue_size = 8192;
+
+/// Configures the size in bytes at which the flight recorder starts a new file.
+constexpr size_t max_file_size = 64 * 1024 * 1024;
+
+/// Configures how many files the flight recorder keeps on disk. A value of 0
+/// keeps all files.
+constexpr size_t max_files = 8;
+
+} // namespace broker::defaults::flight_recorder
+
+namespace broker::defaults::topic_log {
+
+/// Configures the directory for retaining messages for replay. An empty string
+/// disables the topic log.
+constexpr std::string_view directory = "";
+
+/// Configures the size of each segment file in bytes.
+constexpr size_t segment_size = 64 * 1024 * 1024;
+
+/// Configures how many bytes the topic log keeps on disk.
+constexpr size_t max_size = 1024 * 1024 * 1024;
+
+/// Configures how long the topic log keeps messages. A value of 0 disables
+/// time-based retention.
+constexpr timespan max_age = timespan{0};
+
+/// Configures how many messages `endpoint::replay` reads at most by default.
+constexpr size_t replay_batch_size = 1024;
+
+} // namespace broker::defaults::topic_log
+
+namespace broker::defaults::network {
+
+/// Configures the size of the send buffer for peer sockets. A value of 0 keeps
+/// the default of the operating system.
+constexpr size_t send_buffer_size = 0;
+
+/// Configures the size of the receive buffer for peer sockets. A value of 0
+/// keeps the default of the operating system.
+constexpr size_t receive_buffer_size = 0;
+
+/// Configures whether peer sockets disable Nagle's algorithm.
+constexpr bool tcp_nodelay = false;
+
+/// Configures how many unsent bytes peer sockets may hold before reporting
+/// that they are writable (TCP_NOTSENT_LOWAT). A value of 0 keeps the default
+/// of the operating system.
+constexpr size_t tcp_notsent_lowat = 0;
+
+/// Configures how many microseconds the kernel busy-polls peer sockets when
+/// reading (SO_BUSY_POLL). A value of 0 disables busy polling.
+constexpr size_t busy_poll = 0;
+
+} // namespace broker::defaults::network
+
 namespace broker::defaults::subscriber {
 
 static constexpr size_t queue_size = 64;
 
+/// Configures the maximum size for subscriber queues. Subscribers whose queue
+/// size is below this value grow their queue under sustained load and shrink
+/// it again once the load drops. A value of 0 disables adaptive sizing.
+static constexpr size_t max_queue_size = 0;
+
+/// Configures after how many consecutive reads from a full queue a subscriber
+/// doubles the size of its queue.
+static constexpr size_t grow_threshold = 2;
+
+/// Configures after how many consecutive reads from a mostly empty queue a
+/// subscriber halves the size of its queue.
+static constexpr size_t shrink_threshold = 64;
+
+/// Configures how many messages the core may hold back for a subscriber to
+/// wake it up only once for all of them. A value of 1 disables coalescing.
+static constexpr size_t wakeup_batch = 1;
+
+/// Configures how long the core may hold back a message for a subscriber
+/// before waking it up. A value of 0 disables coalescing.
+static constexpr timespan wakeup_delay = timespan{0};
+
 } // namespace broker::defaults::subscriber
 
+namespace broker::defaults::publisher {
+
+/// Configures how much demand a publisher collects before signaling that it
+/// may write again. A value of 1 signals as soon as any demand arrives.
+static constexpr size_t wakeup_threshold = 1;
+
+} // namespace broker::defaults::publisher
+
+namespace broker::defaults::shared_publisher {
+
+/// Number of messages that producers may enqueue in a shared publisher before
+/// waiting for the core.
+static constexpr size_t ring_size = 1024;
+
+} // namespace broker::defaults::shared_publisher
+
+namespace broker::defaults::publish_all {
+
+/// Number of messages that `publish_all` requests at once from a driver that
+/// writes directly into a buffer.
+static constexpr size_t chunk_size = 1024;
+
+} // namespace broker::defaults::publish_all
+
 namespace broker::defaults::store {
 
 constexpr timespan tick_interval = std::chrono::milliseconds{100};
 
+/// Configures how many ticks idle store actors may skip at once. Store actors
+/// without pending work only wake up once per `idle_ticks` tick intervals and
+/// then catch up on the skipped ticks, unless a message arrives earlier. A
+/// value of 1 disables skipping ticks.
+constexpr size_t idle_ticks = 5; // same as heartbeat_interval
+
+/// Configures after how much time without any work store actors hibernate,
+/// i.e., release memory that they only need while active. Hibernating stores
+/// still send their heartbeats. The default (0) disables hibernation.
+constexpr timespan hibernate_after = timespan{0};
+
 /// Configures the maximum delay for GET requests while waiting for the master.
 constexpr timespan max_get_delay = std::chrono::seconds{5};
 
@@ -51,6 +281,91 @@ constexpr uint16_t connection_timeout = 100; // 10s
 /// Configures the default timeout of @ref peer::await_idle.
 constexpr timespan await_idle_timeout = std::chrono::seconds{15};
 
+/// Configures how many entries a master puts into a single message when
+/// sending its snapshot to a new clone. The default (0) sends the entire
+/// snapshot in a single message.
+constexpr size_t snapshot_chunk_size = 0;
+
+/// Configures how many of its most recent updates a master keeps for clones
+/// that reconnect after losing their channel. The default (0) disables the
+/// replay log, i.e., such clones must request a full snapshot.
+constexpr size_t replay_log_size = 0;
+
+/// Configures whether clones publish an immutable copy of their content that
+/// `store::get` and `store::exists` read directly instead of sending a request
+/// to the clone actor.
+constexpr bool local_reads = false;
+
+/// Configures whether masters and clones merge redundant modifications of the
+/// same key before sending them, e.g., by only sending the last `put` of a key
+/// within a tick.
+constexpr bool coalesce_updates = false;
+
+/// Configures how many updates a master may send to its clones before
+/// receiving an ACK. Masters adapt their sending window within this limit to
+/// the latency of incoming ACKs. The default (0) disables flow control.
+constexpr size_t max_window = 0;
+
+/// Configures how long clones serve their own `put` and `erase` operations
+/// from a local overlay before the master confirms them. Reads on the clone
+/// see these writes immediately, and the master's update replaces them. The
+/// default (0) forwards all writes to the master without applying them
+/// locally.
+constexpr timespan optimistic_writes = timespan{0};
+
+/// Configures after how many processed updates clones send an ACK to their
+/// master in addition to the periodic ACKs. The default (0) only sends
+/// periodic ACKs.
+constexpr size_t ack_batch_size = 0;
+
+/// Configures how many clones must request the same update within a tick
+/// before the master broadcasts the update once instead of retransmitting it
+/// to each clone individually. The default (0) answers each request
+/// immediately.
+constexpr size_t retransmit_broadcast_threshold = 0;
+
+/// Configures whether store actors collect their events for one tick and
+/// publish them as a single `batch` message.
+constexpr bool batch_events = false;
+
+/// Configures whether store actors skip generating events while no local
+/// subscriber listens to the store events topic.
+constexpr bool on_demand_events = false;
+
+/// Configures how many keys a master expires per tick at most. Keys that are
+/// due but exceed this limit expire on one of the next ticks. The default (0)
+/// expires all due keys immediately.
+constexpr size_t max_expirations_per_tick = 0;
+
+/// Configures whether masters sample how long operations on their backend
+/// take. Disabled by default, because sampling adds two clock reads to each
+/// operation.
+constexpr bool backend_metrics = false;
+
+/// Configures how far ahead masters load expiration times from their backend.
+/// With a positive interval, the master no longer reads the expiration times
+/// of all keys when starting up. Instead, it loads the keys that expire within
+/// the next interval on each tick. The default (0) loads all expiration times
+/// at startup.
+constexpr timespan expiry_load_interval = timespan{0};
+
+/// Configures a directory for clones to persist their content. A clone that
+/// finds a checkpoint in this directory when starting serves reads from the
+/// checkpoint immediately and resumes its channel to the master instead of
+/// requesting a full snapshot. The default (empty) disables checkpoints.
+constexpr std::string_view clone_checkpoint_directory = "";
+
+/// Configures how often clones write their checkpoint at most.
+constexpr timespan clone_checkpoint_interval = std::chrono::seconds{10};
+
+/// Configures whether masters and clones run on a dedicated thread each
+/// instead of sharing the scheduler with the core and other actors.
+constexpr bool detached = false;
+
+/// Configures whether masters with a persistent backend write to it from a
+/// dedicated I/O thread instead of blocking on each modification.
+constexpr bool async_backend = false;
+
 } // namespace broker::defaults::store
 
 namespace broker::defaults::path_revocations {
@@ -65,4 +380,28 @@ namespace broker::defaults::metrics {
 
 constexpr timespan export_interval = std::chrono::seconds{1};
 
+/// Configures how often exporters publish all metrics when publishing only
+/// changed metrics in between. A value of 0 publishes all metrics on each
+/// interval.
+constexpr timespan full_refresh_interval = timespan{0};
+
+/// Configures how many data messages the core receives per sample for the
+/// message latency histograms. A value of 0 disables the sampling.
+constexpr size_t latency_sample_rate = 0;
+
+/// Configures how many topic levels make up a prefix for the per-topic traffic
+/// statistics. A value of 0 disables the statistics.
+constexpr size_t topic_depth = 0;
+
+/// Configures the maximum number of distinct topic prefixes in the per-topic
+/// traffic statistics.
+constexpr size_t max_topic_prefixes = 100;
+
+/// Configures how many topic prefixes the status snapshot reports.
+constexpr size_t top_topic_prefixes = 10;
+
+/// Configures how long the HTTP endpoint serves a cached status snapshot
+/// before asking the core for a new one. A value of 0 disables the cache.
+constexpr timespan status_max_age = std::chrono::seconds{1};
+
 } // namespace broker::defaults::metrics
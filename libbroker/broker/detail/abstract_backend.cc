@@ -1,5 +1,8 @@
 #include "broker/detail/abstract_backend.hh"
 #include "broker/detail/appliers.hh"
+#include "broker/detail/key_collector.hh"
+
+#include <algorithm>
 
 namespace broker::detail {
 
@@ -29,6 +32,96 @@ expected<void> abstract_backend::subtract(const data& key, const data& value,
     return result;
 }
 
+expected<void> abstract_backend::begin_transaction() {
+  return {};
+}
+
+expected<void> abstract_backend::commit_transaction() {
+  return {};
+}
+
+expected<void> abstract_backend::abort_transaction() {
+  return {};
+}
+
+void sort_by_expiry(expirables& xs) {
+  auto less = [](const expirable& x, const expirable& y) {
+    return x.second < y.second || (x.second == y.second && x.first < y.first);
+  };
+  std::sort(xs.begin(), xs.end(), less);
+}
+
+expected<void> abstract_backend::flush() {
+  return {};
+}
+
+void abstract_backend::release_memory() {
+  // nop
+}
+
+namespace {
+
+template <class Filter>
+expected<data> select_keys(const abstract_backend& backend, Filter filter,
+                           size_t limit) {
+  auto xs = backend.keys();
+  if (!xs)
+    return xs;
+  auto collector = make_key_collector(std::move(filter), limit);
+  if (auto* keys = get_if<set>(*xs))
+    for (const auto& key : *keys)
+      collector.add(key);
+  return std::move(collector).result();
+}
+
+} // namespace
+
+expected<data>
+abstract_backend::get_many(const std::vector<data>& keys) const {
+  table result;
+  for (const auto& key : keys) {
+    auto value = get(key);
+    if (value)
+      result.insert_or_assign(key, std::move(*value));
+    else if (value.error() != ec::no_such_key)
+      return value.error();
+  }
+  return data{std::move(result)};
+}
+
+expected<data> abstract_backend::range(const data& first, const data& last,
+                                       size_t limit) const {
+  return select_keys(*this, key_range_filter(first, last), limit);
+}
+
+expected<data> abstract_backend::keys_with_prefix(const std::string& prefix,
+                                                  size_t limit) const {
+  return select_keys(*this, key_prefix_filter(prefix), limit);
+}
+
+expected<void> abstract_backend::for_each(const entry_visitor& f) const {
+  auto ss = snapshot();
+  if (!ss)
+    return ss.error();
+  for (const auto& [key, value] : *ss)
+    if (!f(key, value))
+      break;
+  return {};
+}
+
+expected<expirables> abstract_backend::expiries_between(timestamp first,
+                                                        timestamp last) const {
+  auto xs = expiries();
+  if (!xs)
+    return xs;
+  expirables result;
+  for (auto& x : *xs)
+    if (!(x.second < first) && x.second < last)
+      result.emplace_back(std::move(x));
+  sort_by_expiry(result);
+  return result;
+}
+
 expected<data> abstract_backend::get(const data& key, const data& value) const {
   if (auto k = get(key))
     return visit(retriever{value}, *k);
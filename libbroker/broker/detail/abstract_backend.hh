@@ -5,13 +5,22 @@
 #include "broker/snapshot.hh"
 
 #include <deque>
+#include <functional>
 #include <optional>
+#include <vector>
 
 namespace broker::detail {
 
 using expirable = std::pair<broker::data, timestamp>;
 using expirables = std::deque<expirable>;
 
+/// Sorts `xs` by ascending expiration time, breaking ties by key.
+void sort_by_expiry(expirables& xs);
+
+/// Receives the key-value pairs of a backend one at a time. Returning `false`
+/// stops the iteration.
+using entry_visitor = std::function<bool(const data& key, const data& value)>;
+
 /// Abstract base class for a key-value storage backend.
 class abstract_backend {
 public:
@@ -68,6 +77,32 @@ public:
   /// time lies in the future.
   virtual expected<bool> expire(const data& key, timestamp current_time) = 0;
 
+  // --- transactions ---------------------------------------------------------
+
+  /// Groups all following modifications into a single transaction until
+  /// calling `commit_transaction`. The default implementation does nothing,
+  /// i.e., the backend applies each modification individually.
+  /// @returns `nil` on success.
+  virtual expected<void> begin_transaction();
+
+  /// Commits all modifications since calling `begin_transaction`.
+  /// @returns `nil` on success.
+  virtual expected<void> commit_transaction();
+
+  /// Discards all modifications since calling `begin_transaction`. The default
+  /// implementation does nothing, since it applies modifications immediately.
+  /// @returns `nil` on success.
+  virtual expected<void> abort_transaction();
+
+  /// Makes all previous modifications durable if the backend defers writing
+  /// them. The default implementation does nothing.
+  /// @returns `nil` on success.
+  virtual expected<void> flush();
+
+  /// Releases memory that the backend only uses for caching, e.g., when the
+  /// store becomes idle. The default implementation does nothing.
+  virtual void release_memory();
+
   // --- inspectors -----------------------------------------------------------
 
   /// Retrieves the value associated with a given key.
@@ -81,6 +116,12 @@ public:
   /// @returns The *aspect* of the value at *key*.
   virtual expected<data> get(const data& key, const data& value) const;
 
+  /// Retrieves the values for multiple keys at once.
+  /// @param keys The keys to lookup.
+  /// @returns A table that maps each key in *keys* that exists to its value.
+  /// @note The default implementation calls `get` for each key.
+  virtual expected<data> get_many(const std::vector<data>& keys) const;
+
   /// Checks if a key exists.
   /// @param key The key to check.
   /// @returns `true` if the *key* exists and `false` if it doesn't.
@@ -95,12 +136,46 @@ public:
   /// @returns The set of current keys.
   virtual expected<data> keys() const = 0;
 
+  /// Retrieves keys in ascending order, starting at the first key that is not
+  /// less than `first` and stopping before `last`.
+  /// @param first The lower bound (inclusive).
+  /// @param last The upper bound (exclusive) or a default-constructed `data`
+  ///             for no upper bound.
+  /// @param limit The maximum number of keys or 0 for no limit.
+  /// @returns A vector with the selected keys.
+  /// @note The default implementation filters the result of `keys`.
+  virtual expected<data> range(const data& first, const data& last,
+                               size_t limit) const;
+
+  /// Retrieves string keys that begin with `prefix` in ascending order.
+  /// @param prefix The common prefix of all selected keys.
+  /// @param limit The maximum number of keys or 0 for no limit.
+  /// @returns A vector with the selected keys.
+  /// @note The default implementation filters the result of `keys`.
+  virtual expected<data> keys_with_prefix(const std::string& prefix,
+                                          size_t limit) const;
+
   /// Retrieves all key-value pairs.
   /// @returns A snapshot of the store that includes its content.
   virtual expected<broker::snapshot> snapshot() const = 0;
 
+  /// Visits all key-value pairs in unspecified order without materializing
+  /// the full content of the store.
+  /// @param f The visitor for the entries. Must not modify the backend.
+  /// @returns `nil` on success.
+  /// @note The default implementation visits the result of `snapshot`.
+  virtual expected<void> for_each(const entry_visitor& f) const;
+
   /// @returns the set of all keys that have expiry times.
   virtual expected<expirables> expiries() const = 0;
+
+  /// Retrieves all keys that expire at or after `first` and before `last`.
+  /// Allows callers to load expiration times incrementally instead of reading
+  /// them for the entire store at once.
+  /// @returns The selected keys, sorted by `sort_by_expiry`.
+  /// @note The default implementation filters the result of `expiries`.
+  virtual expected<expirables> expiries_between(timestamp first,
+                                                timestamp last) const;
 };
 
 } // namespace broker::detail
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+
+namespace broker::detail {
+
+template <class>
+struct is_back_insert_iterator_oracle : std::false_type {};
+
+template <class Container>
+struct is_back_insert_iterator_oracle<std::back_insert_iterator<Container>>
+  : std::true_type {};
+
+/// Evaluates to `true` if `T` is a `std::back_insert_iterator`.
+template <class T>
+inline constexpr bool is_back_insert_iterator =
+  is_back_insert_iterator_oracle<T>::value;
+
+/// Grants access to the container of a `std::back_insert_iterator`.
+template <class Container>
+struct back_insert_access : std::back_insert_iterator<Container> {
+  static Container& container_of(std::back_insert_iterator<Container>& iter) {
+    return *(iter.*(&back_insert_access::container));
+  }
+};
+
+/// Copies `[first, last)` to `out`. Appends the range in one step when writing
+/// to a `std::back_insert_iterator`, which grows the container at most once and
+/// allows it to copy trivial types with `memcpy` instead of calling `push_back`
+/// per element.
+template <class InputIterator, class OutIter>
+OutIter append_range(InputIterator first, InputIterator last, OutIter out) {
+  if constexpr (is_back_insert_iterator<OutIter>) {
+    using container_type = typename OutIter::container_type;
+    auto& buf = back_insert_access<container_type>::container_of(out);
+    buf.insert(buf.end(), first, last);
+    return out;
+  } else {
+    return std::copy(first, last, out);
+  }
+}
+
+} // namespace broker::detail
@@ -5,9 +5,15 @@
 #include "broker/expected.hh"
 #include "broker/status.hh"
 #include "broker/time.hh"
+#include "broker/value_query.hh"
 
 #include "broker/detail/type_traits.hh"
 
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <vector>
+
 namespace broker::detail {
 
 template <class T>
@@ -162,4 +168,110 @@ struct retriever {
   const data& aspect;
 };
 
+/// Evaluates a @ref value_query on a stored value.
+struct evaluator {
+  using result_type = expected<data>;
+
+  static std::optional<count> to_index(const data& x) {
+    if (auto i = get_if<count>(&x))
+      return *i;
+    if (auto j = get_if<integer>(&x); j && *j >= 0)
+      return static_cast<count>(*j);
+    return std::nullopt;
+  }
+
+  template <class T>
+  result_type operator()(const T&) const {
+    return ec::type_clash;
+  }
+
+  result_type operator()(const std::string& str) const {
+    if (op == value_query::size)
+      return count{str.size()};
+    return ec::type_clash;
+  }
+
+  template <class Contains>
+  result_type contains_all(Contains&& contains) const {
+    auto xs = get_if<vector>(&arg);
+    if (!xs)
+      return ec::type_clash;
+    vector result;
+    result.reserve(xs->size());
+    for (const auto& x : *xs)
+      result.emplace_back(contains(x));
+    return data{std::move(result)};
+  }
+
+  result_type operator()(const vector& v) const {
+    switch (op) {
+      case value_query::size:
+        return count{v.size()};
+      case value_query::contains:
+        return contains_all([&v](const data& x) {
+          return std::find(v.begin(), v.end(), x) != v.end();
+        });
+      case value_query::slice: {
+        auto range = get_if<vector>(&arg);
+        if (!range || range->size() != 2)
+          return ec::type_clash;
+        auto first = to_index((*range)[0]);
+        auto last = to_index((*range)[1]);
+        if (!first || !last)
+          return ec::type_clash;
+        auto n = static_cast<count>(v.size());
+        auto lower = std::min(*first, n);
+        auto upper = std::max(lower, std::min(*last, n));
+        return data{vector(v.begin() + lower, v.begin() + upper)};
+      }
+      default:
+        return ec::type_clash;
+    }
+  }
+
+  result_type operator()(const set& s) const {
+    switch (op) {
+      case value_query::size:
+        return count{s.size()};
+      case value_query::contains:
+        return contains_all([&s](const data& x) { return s.count(x) == 1; });
+      default:
+        return ec::type_clash;
+    }
+  }
+
+  result_type operator()(const table& t) const {
+    switch (op) {
+      case value_query::size:
+        return count{t.size()};
+      case value_query::contains:
+        return contains_all([&t](const data& x) { return t.count(x) == 1; });
+      case value_query::top: {
+        auto n = to_index(arg);
+        if (!n)
+          return ec::type_clash;
+        // Sort pointers to the entries instead of copying the whole table.
+        std::vector<const table::value_type*> entries;
+        entries.reserve(t.size());
+        for (const auto& kvp : t)
+          entries.emplace_back(&kvp);
+        auto middle = entries.begin() + std::min(*n, count{entries.size()});
+        std::partial_sort(entries.begin(), middle, entries.end(),
+                          [](auto x, auto y) { return y->second < x->second; });
+        vector result;
+        result.reserve(static_cast<size_t>(middle - entries.begin()));
+        for (auto i = entries.begin(); i != middle; ++i)
+          result.emplace_back(vector{(*i)->first, (*i)->second});
+        return data{std::move(result)};
+      }
+      default:
+        return ec::type_clash;
+    }
+  }
+
+  value_query op;
+
+  const data& arg;
+};
+
 } // namespace broker::detail
@@ -0,0 +1,65 @@
+#include "broker/detail/duplicate_filter.hh"
+
+#include <functional>
+
+namespace broker::detail {
+
+namespace {
+
+uint64_t hash_str(std::string_view str) noexcept {
+  return static_cast<uint64_t>(std::hash<std::string_view>{}(str));
+}
+
+// Mixes `value` into `seed` (see boost::hash_combine).
+uint64_t hash_combine(uint64_t seed, uint64_t value) noexcept {
+  return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+} // namespace
+
+duplicate_filter::duplicate_filter(size_t capacity) : ring_(capacity) {
+  last_hops_.reserve(capacity);
+}
+
+bool duplicate_filter::admit(uint64_t fingerprint,
+                             const endpoint_id& last_hop) {
+  if (ring_.empty())
+    return true;
+  if (auto i = last_hops_.find(fingerprint); i != last_hops_.end())
+    return i->second == last_hop;
+  insert(fingerprint, last_hop);
+  return true;
+}
+
+void duplicate_filter::remember(uint64_t fingerprint,
+                                const endpoint_id& last_hop) {
+  if (ring_.empty() || last_hops_.count(fingerprint) > 0)
+    return;
+  insert(fingerprint, last_hop);
+}
+
+void duplicate_filter::insert(uint64_t fingerprint,
+                              const endpoint_id& last_hop) {
+  // Evict the oldest fingerprint once the ring is full.
+  if (last_hops_.size() == ring_.size())
+    last_hops_.erase(ring_[pos_]);
+  ring_[pos_] = fingerprint;
+  pos_ = (pos_ + 1) % ring_.size();
+  last_hops_.emplace(fingerprint, last_hop);
+}
+
+uint64_t duplicate_filter::fingerprint(envelope_type type,
+                                       std::string_view topic,
+                                       const std::byte* payload,
+                                       size_t payload_size) noexcept {
+  // Hashing topic and payload separately keeps both parts unambiguous. The
+  // standard hash processes whole words at a time, which keeps this cheap
+  // even for large payloads.
+  auto hash = static_cast<uint64_t>(type);
+  hash = hash_combine(hash, hash_str(topic));
+  auto payload_str = std::string_view{reinterpret_cast<const char*>(payload),
+                                      payload_size};
+  return hash_combine(hash, hash_str(payload_str));
+}
+
+} // namespace broker::detail
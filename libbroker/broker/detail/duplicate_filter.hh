@@ -0,0 +1,89 @@
+#pragma once
+
+#include "broker/endpoint_id.hh"
+#include "broker/envelope.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace broker::detail {
+
+/// Remembers the fingerprints of recently received messages in order to drop
+/// copies that arrive over redundant paths in meshed topologies. In a
+/// loop-free topology, all messages from one origin arrive via the same
+/// neighbor. Hence, the filter only considers a message a duplicate if its
+/// fingerprint was seen before from a *different* neighbor. Legitimately
+/// repeated messages always pass.
+///
+/// Envelopes carry no origin or sequence number. Hence, identical messages
+/// from different publishers have the same fingerprint. The core therefore
+/// only filters messages that a neighbor forwarded on behalf of another node
+/// and merely calls `remember` for messages that a neighbor published itself.
+class duplicate_filter {
+public:
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// Creates a filter that remembers up to `capacity` fingerprints.
+  explicit duplicate_filter(size_t capacity);
+
+  duplicate_filter(const duplicate_filter&) = delete;
+
+  duplicate_filter& operator=(const duplicate_filter&) = delete;
+
+  // -- properties -------------------------------------------------------------
+
+  /// Returns the maximum number of fingerprints in the filter.
+  size_t capacity() const noexcept {
+    return ring_.size();
+  }
+
+  /// Returns the number of fingerprints in the filter.
+  size_t size() const noexcept {
+    return last_hops_.size();
+  }
+
+  // -- filtering --------------------------------------------------------------
+
+  /// Checks whether the message with given fingerprint is a copy of a message
+  /// that arrived via another neighbor and records `last_hop` otherwise.
+  /// @returns `true` if the message is new or a repetition from the same
+  ///          neighbor, `false` if the message is a duplicate.
+  bool admit(uint64_t fingerprint, const endpoint_id& last_hop);
+
+  /// Records `last_hop` for the fingerprint unless the filter already knows
+  /// it. Unlike `admit`, never classifies the message as a duplicate.
+  void remember(uint64_t fingerprint, const endpoint_id& last_hop);
+
+  // -- utility ----------------------------------------------------------------
+
+  /// Computes a fingerprint from the type, topic and payload of a message.
+  /// Sender, receiver and TTL are not part of the fingerprint, because they
+  /// change while the message travels through the network.
+  static uint64_t fingerprint(envelope_type type, std::string_view topic,
+                              const std::byte* payload,
+                              size_t payload_size) noexcept;
+
+  /// @copydoc fingerprint
+  static uint64_t fingerprint(const envelope& msg) noexcept {
+    auto [payload, payload_size] = msg.raw_bytes();
+    return fingerprint(msg.type(), msg.topic(), payload, payload_size);
+  }
+
+private:
+  /// Adds a new fingerprint, evicting the oldest one if necessary.
+  void insert(uint64_t fingerprint, const endpoint_id& last_hop);
+
+  /// Maps fingerprints to the neighbor that delivered the message first.
+  std::unordered_map<uint64_t, endpoint_id> last_hops_;
+
+  /// Stores fingerprints in insertion order for evicting the oldest entry.
+  std::vector<uint64_t> ring_;
+
+  /// Points to the next slot in `ring_`.
+  size_t pos_ = 0;
+};
+
+} // namespace broker::detail
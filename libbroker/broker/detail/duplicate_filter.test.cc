@@ -0,0 +1,81 @@
+#include "broker/detail/duplicate_filter.hh"
+
+#include "broker/broker-test.test.hh"
+
+using namespace broker;
+
+namespace {
+
+struct fixture {
+  fixture() : uut(3) {
+    a = endpoint_id::random(1);
+    b = endpoint_id::random(2);
+  }
+
+  detail::duplicate_filter uut;
+  endpoint_id a;
+  endpoint_id b;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(duplicate_filter_tests, fixture)
+
+TEST(copies from other neighbors are duplicates) {
+  CHECK(uut.admit(1, a));
+  CHECK(!uut.admit(1, b));
+  CHECK(uut.admit(2, b));
+  CHECK_EQUAL(uut.size(), 2u);
+}
+
+TEST(repetitions from the same neighbor pass) {
+  CHECK(uut.admit(1, a));
+  CHECK(uut.admit(1, a));
+  CHECK_EQUAL(uut.size(), 1u);
+}
+
+TEST(remembered fingerprints only affect later copies) {
+  uut.remember(1, a);
+  uut.remember(1, b);
+  CHECK_EQUAL(uut.size(), 1u);
+  CHECK(uut.admit(1, a));
+  CHECK(!uut.admit(1, b));
+}
+
+TEST(the filter forgets the oldest fingerprints first) {
+  CHECK(uut.admit(1, a));
+  CHECK(uut.admit(2, a));
+  CHECK(uut.admit(3, a));
+  CHECK(uut.admit(4, a));
+  CHECK_EQUAL(uut.size(), 3u);
+  CHECK(uut.admit(1, b));
+  CHECK(!uut.admit(4, b));
+}
+
+TEST(a filter without capacity admits everything) {
+  detail::duplicate_filter none{0};
+  CHECK(none.admit(1, a));
+  CHECK(none.admit(1, b));
+  CHECK_EQUAL(none.size(), 0u);
+}
+
+TEST(fingerprints include topic and payload) {
+  using detail::duplicate_filter;
+  auto payload = std::byte{42};
+  auto fp = duplicate_filter::fingerprint(envelope_type::data, "/foo",
+                                          &payload, 1);
+  auto same = duplicate_filter::fingerprint(envelope_type::data, "/foo",
+                                            &payload, 1);
+  auto other_topic = duplicate_filter::fingerprint(envelope_type::data, "/bar",
+                                                   &payload, 1);
+  auto other_payload = duplicate_filter::fingerprint(envelope_type::data,
+                                                     "/foo", &payload, 0);
+  auto other_type = duplicate_filter::fingerprint(envelope_type::command,
+                                                  "/foo", &payload, 1);
+  CHECK_EQUAL(fp, same);
+  CHECK_NOT_EQUAL(fp, other_topic);
+  CHECK_NOT_EQUAL(fp, other_payload);
+  CHECK_NOT_EQUAL(fp, other_type);
+}
+
+FIXTURE_SCOPE_END()
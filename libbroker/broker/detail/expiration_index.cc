@@ -0,0 +1,33 @@
+#include "broker/detail/expiration_index.hh"
+
+namespace broker::detail {
+
+std::optional<timestamp> expiration_index::find(const data& key) const {
+  if (auto i = slots_.find(key); i != slots_.end())
+    return i->second->first;
+  return std::nullopt;
+}
+
+void expiration_index::set(const data& key, timestamp expiry) {
+  auto h = slot_map::hash_code(key);
+  if (auto i = slots_.find(key, h); i != slots_.end()) {
+    by_time_.erase(i->second);
+    i->second = by_time_.emplace(expiry, key);
+  } else {
+    slots_.try_emplace_hashed(h, key, by_time_.emplace(expiry, key));
+  }
+}
+
+void expiration_index::erase(const data& key) {
+  if (auto i = slots_.find(key); i != slots_.end()) {
+    by_time_.erase(i->second);
+    slots_.erase(i);
+  }
+}
+
+void expiration_index::clear() {
+  slots_.clear();
+  by_time_.clear();
+}
+
+} // namespace broker::detail
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "broker/data.hh"
+#include "broker/detail/flat_hash_map.hh"
+#include "broker/time.hh"
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <utility>
+
+namespace broker::detail {
+
+/// Keeps track of the expiration times for keys of a data store. The index
+/// sorts its entries by expiration time. Hence, finding all expired keys only
+/// touches entries that are actually due instead of scanning all keys.
+class expiration_index {
+public:
+  // -- constructors, destructors, and assignment operators --------------------
+
+  expiration_index() = default;
+
+  expiration_index(const expiration_index&) = delete;
+
+  expiration_index& operator=(const expiration_index&) = delete;
+
+  // -- properties -------------------------------------------------------------
+
+  /// Returns the number of keys in the index.
+  size_t size() const noexcept {
+    return slots_.size();
+  }
+
+  /// Returns whether the index contains no keys.
+  bool empty() const noexcept {
+    return slots_.empty();
+  }
+
+  /// Returns the expiration time for `key` if present.
+  std::optional<timestamp> find(const data& key) const;
+
+  /// Returns the earliest expiration time in the index if present.
+  std::optional<timestamp> next_expiry() const {
+    if (by_time_.empty())
+      return std::nullopt;
+    return by_time_.begin()->first;
+  }
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Sets the expiration time for `key`, replacing any previous value.
+  void set(const data& key, timestamp expiry);
+
+  /// Removes `key` from the index.
+  void erase(const data& key);
+
+  /// Removes all keys from the index.
+  void clear();
+
+  /// Removes all keys that expire before `now` from the index and calls `fn`
+  /// for each key in the order of their expiration time. The index no longer
+  /// contains the key when calling `fn`. Hence, `fn` may safely modify the
+  /// index.
+  /// @param limit The maximum number of keys to remove. A value of 0 removes
+  ///              all due keys. Passing a limit allows callers to spread bursts
+  ///              of expirations over multiple calls, since remaining keys
+  ///              stay in the index until the next call.
+  /// @returns The number of removed keys.
+  template <class F>
+  size_t expire(timestamp now, F fn, size_t limit = 0) {
+    size_t n = 0;
+    while (!by_time_.empty() && by_time_.begin()->first < now
+           && (limit == 0 || n < limit)) {
+      auto i = by_time_.begin();
+      auto key = std::move(i->second);
+      by_time_.erase(i);
+      slots_.erase(key);
+      fn(key);
+      ++n;
+    }
+    return n;
+  }
+
+private:
+  using time_map = std::multimap<timestamp, data>;
+
+  /// Orders all keys by their expiration time.
+  time_map by_time_;
+
+  using slot_map = flat_hash_map<data, time_map::iterator>;
+
+  /// Maps each key to its slot in `by_time_`.
+  slot_map slots_;
+};
+
+} // namespace broker::detail
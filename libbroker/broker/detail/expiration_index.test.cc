@@ -0,0 +1,68 @@
+#include "broker/detail/expiration_index.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <vector>
+
+using namespace broker;
+using namespace std::literals;
+
+namespace {
+
+struct fixture {
+  timestamp t0;
+
+  detail::expiration_index uut;
+
+  std::vector<data> expire(timestamp now, size_t limit = 0) {
+    std::vector<data> result;
+    uut.expire(
+      now, [&result](const data& key) { result.emplace_back(key); }, limit);
+    return result;
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(expiration_index_tests, fixture)
+
+TEST(expire visits due keys in order of their expiration time) {
+  uut.set(data{"c"}, t0 + 3s);
+  uut.set(data{"a"}, t0 + 1s);
+  uut.set(data{"b"}, t0 + 2s);
+  CHECK_EQUAL(uut.size(), 3u);
+  CHECK_EQUAL(expire(t0), std::vector<data>{});
+  CHECK_EQUAL(expire(t0 + 2500ms), (std::vector<data>{data{"a"}, data{"b"}}));
+  CHECK_EQUAL(uut.size(), 1u);
+  CHECK_EQUAL(expire(t0 + 3500ms), std::vector<data>{data{"c"}});
+  CHECK(uut.empty());
+}
+
+TEST(set replaces previous expiration times) {
+  uut.set(data{"a"}, t0 + 1s);
+  uut.set(data{"a"}, t0 + 5s);
+  CHECK_EQUAL(uut.size(), 1u);
+  CHECK(uut.find(data{"a"}) == t0 + 5s);
+  CHECK_EQUAL(expire(t0 + 2s), std::vector<data>{});
+  CHECK_EQUAL(expire(t0 + 6s), std::vector<data>{data{"a"}});
+}
+
+TEST(erased keys never expire) {
+  uut.set(data{"a"}, t0 + 1s);
+  uut.set(data{"b"}, t0 + 1s);
+  uut.erase(data{"a"});
+  CHECK(!uut.find(data{"a"}));
+  CHECK_EQUAL(expire(t0 + 2s), std::vector<data>{data{"b"}});
+}
+
+TEST(limits spread expirations over multiple calls) {
+  uut.set(data{"a"}, t0 + 1s);
+  uut.set(data{"b"}, t0 + 2s);
+  uut.set(data{"c"}, t0 + 3s);
+  CHECK_EQUAL(expire(t0 + 5s, 2), (std::vector<data>{data{"a"}, data{"b"}}));
+  CHECK_EQUAL(uut.size(), 1u);
+  CHECK_EQUAL(expire(t0 + 5s, 2), std::vector<data>{data{"c"}});
+  CHECK(uut.empty());
+}
+
+FIXTURE_SCOPE_END()
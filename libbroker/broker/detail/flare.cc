@@ -3,6 +3,7 @@
 #include <cerrno>
 
 #include <algorithm>
+#include <cstring>
 #include <exception>
 
 #include <caf/error.hpp>
@@ -43,6 +44,10 @@ bool try_again_later() {
 #  include <poll.h>
 #  include <unistd.h>
 
+#  ifdef BROKER_LINUX
+#    include <sys/eventfd.h>
+#  endif
+
 #  define PIPE_WRITE ::write
 
 #  define PIPE_READ ::read
@@ -76,6 +81,82 @@ struct stack_buffer {
 
 } // namespace
 
+#ifdef BROKER_LINUX
+
+// On Linux, an eventfd replaces the pipe. The kernel keeps a 64-bit counter
+// instead of a byte stream, which allows us to fire and to extinguish the flare
+// with a single system call regardless of the number of events.
+
+flare::flare() {
+  auto fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (fd < 0) {
+    BROKER_ERROR("failed to create eventfd: " << strerror(errno));
+    abort();
+  }
+  fds_[0] = fd;
+  fds_[1] = fd;
+}
+
+flare::~flare() {
+  ::close(fds_[0]);
+}
+
+native_socket flare::fd() const {
+  return fds_[0];
+}
+
+void flare::fire(size_t num) {
+  if (num == 0)
+    return;
+  auto value = static_cast<uint64_t>(num);
+  for (;;) {
+    auto n = ::write(fds_[1], &value, sizeof(value));
+    if (n == sizeof(value))
+      return;
+    if (n < 0 && errno == EINTR)
+      continue;
+    BROKER_ERROR("unable to write flare eventfd!");
+    std::terminate();
+  }
+}
+
+namespace {
+
+/// Reads and resets the counter of the eventfd.
+uint64_t read_eventfd(native_socket fd) {
+  uint64_t value = 0;
+  for (;;) {
+    auto n = ::read(fd, &value, sizeof(value));
+    if (n == sizeof(value))
+      return value;
+    if (n < 0 && try_again_later())
+      return 0; // Counter is zero.
+    if (n < 0 && errno != EINTR) {
+      BROKER_ERROR("unable to read flare eventfd!");
+      std::terminate();
+    }
+  }
+}
+
+} // namespace
+
+size_t flare::extinguish() {
+  return static_cast<size_t>(read_eventfd(fds_[0]));
+}
+
+bool flare::extinguish_one() {
+  // Reading resets the counter. Hence, we need to put back all but one event.
+  // Concurrent calls to `fire` only add to the counter, so nothing gets lost.
+  auto value = read_eventfd(fds_[0]);
+  if (value == 0)
+    return false;
+  if (value > 1)
+    fire(static_cast<size_t>(value - 1));
+  return true;
+}
+
+#else // BROKER_LINUX
+
 flare::flare() {
   auto maybe_fds = caf::net::make_pipe();
   if (!maybe_fds) {
@@ -144,6 +225,8 @@ bool flare::extinguish_one() {
   }
 }
 
+#endif // BROKER_LINUX
+
 void flare::await_one() {
   BROKER_TRACE("");
   pollfd p = {fds_[0], POLLIN, 0};
@@ -14,11 +14,13 @@ namespace broker::detail {
 /// signal availability of a resource across threads, both access to that
 /// resource and the use of the fire/extinguish functions must be performed in
 /// a thread-safe manner in order for that to work correctly.
+/// @note On Linux, the flare uses an eventfd instead of a pipe and the
+///       "bytes" in the documentation below refer to the counter value.
 class flare {
 public:
   using timeout_type = clock::time_point;
 
-  /// Constructs a flare by opening a UNIX pipe.
+  /// Constructs a flare by opening a UNIX pipe (or an eventfd on Linux).
   flare();
 
   /// Destructs the flare, closing the UNIX pipe's file descriptors.
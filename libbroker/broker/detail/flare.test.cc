@@ -0,0 +1,47 @@
+#include "broker/detail/flare.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <chrono>
+
+using namespace broker;
+
+using namespace std::literals;
+
+namespace {
+
+bool readable(detail::flare& fx) {
+  return fx.await_one(std::chrono::system_clock::now() + 10ms);
+}
+
+} // namespace
+
+TEST(a flare signals readiness until it is extinguished) {
+  detail::flare fx;
+  CHECK(!readable(fx));
+  fx.fire();
+  CHECK(readable(fx));
+  CHECK_EQUAL(fx.extinguish(), 1u);
+  CHECK(!readable(fx));
+  CHECK_EQUAL(fx.extinguish(), 0u);
+}
+
+TEST(extinguish_one consumes a single event) {
+  detail::flare fx;
+  fx.fire(3);
+  CHECK(fx.extinguish_one());
+  CHECK(fx.extinguish_one());
+  CHECK(readable(fx));
+  CHECK(fx.extinguish_one());
+  CHECK(!readable(fx));
+  CHECK(!fx.extinguish_one());
+}
+
+TEST(await_one returns once the flare fires) {
+  detail::flare fx;
+  CHECK(!fx.await_one(std::chrono::system_clock::now() + 10ms));
+  fx.fire();
+  CHECK(fx.await_one(std::chrono::system_clock::now() + 10ms));
+  fx.await_one();
+  CHECK(readable(fx));
+}
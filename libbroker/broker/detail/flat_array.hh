@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace broker::detail {
+
+/// A read-only view to a contiguous sequence of objects that reside in a
+/// @ref monotonic_buffer_resource. The owner of the memory resource also owns
+/// the elements. Hence, the array never destroys its elements.
+template <class T>
+class flat_array {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using value_type = T;
+
+  using size_type = size_t;
+
+  using const_iterator = const T*;
+
+  using iterator = const_iterator;
+
+  using const_reference = const T&;
+
+  using reference = const_reference;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  flat_array() noexcept = default;
+
+  flat_array(T* first, size_t size) noexcept : data_(first), size_(size) {
+    // nop
+  }
+
+  // -- properties -------------------------------------------------------------
+
+  bool empty() const noexcept {
+    return size_ == 0;
+  }
+
+  size_t size() const noexcept {
+    return size_;
+  }
+
+  const T* data() const noexcept {
+    return data_;
+  }
+
+  // -- iterator access --------------------------------------------------------
+
+  const_iterator begin() const noexcept {
+    return data_;
+  }
+
+  const_iterator end() const noexcept {
+    return data_ + size_;
+  }
+
+  const_iterator cbegin() const noexcept {
+    return begin();
+  }
+
+  const_iterator cend() const noexcept {
+    return end();
+  }
+
+  // -- element access ---------------------------------------------------------
+
+  const T& operator[](size_t index) const noexcept {
+    return data_[index];
+  }
+
+  const T& front() const noexcept {
+    return data_[0];
+  }
+
+  const T& back() const noexcept {
+    return data_[size_ - 1];
+  }
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Replaces the content of this array.
+  /// @pre `first` points to `size` initialized objects.
+  void assign(T* first, size_t size) noexcept {
+    data_ = first;
+    size_ = size;
+  }
+
+private:
+  T* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+/// Compares two arrays lexicographically.
+template <class T>
+bool operator<(const flat_array<T>& lhs, const flat_array<T>& rhs) {
+  return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(),
+                                      rhs.end());
+}
+
+} // namespace broker::detail
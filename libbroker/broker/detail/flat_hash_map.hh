@@ -0,0 +1,485 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace broker::detail {
+
+/// A hash map with open addressing that keeps all entries in a single array.
+/// The map uses Robin Hood hashing with backward-shift deletion, i.e., it
+/// stores no per-entry nodes or pointers. Compared to `std::unordered_map`,
+/// this cuts the memory overhead per entry to a 32-bit probe distance and a
+/// 32-bit hash code. The map computes the hash code of each key only once,
+/// i.e., rehashing never calls `Hash` and lookups only compare keys with
+/// matching hash codes. Callers that look up the same key repeatedly may
+/// compute its hash code once via `hash_code` and pass it to the overloads
+/// that accept a precomputed hash code.
+/// @warning Every insertion may invalidate all iterators and references. Users
+///          must not modify the key of an entry through an iterator.
+template <class Key, class T, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>>
+class flat_hash_map {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using key_type = Key;
+
+  using mapped_type = T;
+
+  using value_type = std::pair<Key, T>;
+
+  using size_type = size_t;
+
+  using hasher = Hash;
+
+  using key_equal = KeyEqual;
+
+  /// A 32-bit hash code, obtained by mixing the result of `Hash`.
+  using hash_code_type = uint32_t;
+
+  template <bool IsConst>
+  class iterator_base {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+
+    using value_type = flat_hash_map::value_type;
+
+    using difference_type = ptrdiff_t;
+
+    using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+
+    using reference = std::conditional_t<IsConst, const value_type&,
+                                         value_type&>;
+
+    using map_pointer = std::conditional_t<IsConst, const flat_hash_map*,
+                                           flat_hash_map*>;
+
+    iterator_base() noexcept = default;
+
+    iterator_base(map_pointer map, size_t pos) noexcept
+      : map_(map), pos_(pos) {
+      // nop
+    }
+
+    template <bool C = IsConst, class = std::enable_if_t<C>>
+    iterator_base(const iterator_base<false>& other) noexcept
+      : map_(other.map_), pos_(other.pos_) {
+      // nop
+    }
+
+    reference operator*() const noexcept {
+      return map_->values_[pos_];
+    }
+
+    pointer operator->() const noexcept {
+      return map_->values_ + pos_;
+    }
+
+    iterator_base& operator++() noexcept {
+      pos_ = map_->next_occupied(pos_ + 1);
+      return *this;
+    }
+
+    iterator_base operator++(int) noexcept {
+      auto result = *this;
+      ++*this;
+      return result;
+    }
+
+    friend bool operator==(const iterator_base& x,
+                           const iterator_base& y) noexcept {
+      return x.pos_ == y.pos_;
+    }
+
+    friend bool operator!=(const iterator_base& x,
+                           const iterator_base& y) noexcept {
+      return x.pos_ != y.pos_;
+    }
+
+  private:
+    friend class flat_hash_map;
+
+    template <bool>
+    friend class iterator_base;
+
+    map_pointer map_ = nullptr;
+
+    size_t pos_ = 0;
+  };
+
+  using iterator = iterator_base<false>;
+
+  using const_iterator = iterator_base<true>;
+
+  // -- constants --------------------------------------------------------------
+
+  /// The smallest number of slots after allocating the first entry.
+  static constexpr size_t min_capacity = 8;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  flat_hash_map() noexcept = default;
+
+  template <class InputIterator>
+  flat_hash_map(InputIterator first, InputIterator last) {
+    for (; first != last; ++first)
+      emplace(first->first, first->second);
+  }
+
+  flat_hash_map(const flat_hash_map& other) {
+    if (other.size_ == 0)
+      return;
+    allocate(other.capacity_);
+    for (size_t pos = 0; pos < capacity_; ++pos) {
+      if (other.meta_[pos].dist != 0) {
+        new (values_ + pos) value_type(other.values_[pos]);
+        meta_[pos] = other.meta_[pos];
+        ++size_;
+      }
+    }
+  }
+
+  flat_hash_map(flat_hash_map&& other) noexcept {
+    swap(other);
+  }
+
+  flat_hash_map& operator=(const flat_hash_map& other) {
+    if (this != &other) {
+      flat_hash_map tmp{other};
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  flat_hash_map& operator=(flat_hash_map&& other) noexcept {
+    flat_hash_map tmp{std::move(other)};
+    swap(tmp);
+    return *this;
+  }
+
+  ~flat_hash_map() {
+    clear();
+    deallocate();
+  }
+
+  // -- properties -------------------------------------------------------------
+
+  bool empty() const noexcept {
+    return size_ == 0;
+  }
+
+  size_t size() const noexcept {
+    return size_;
+  }
+
+  /// Returns the number of slots in the table.
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  // -- iterator access --------------------------------------------------------
+
+  iterator begin() noexcept {
+    return {this, next_occupied(0)};
+  }
+
+  iterator end() noexcept {
+    return {this, capacity_};
+  }
+
+  const_iterator begin() const noexcept {
+    return {this, next_occupied(0)};
+  }
+
+  const_iterator end() const noexcept {
+    return {this, capacity_};
+  }
+
+  const_iterator cbegin() const noexcept {
+    return begin();
+  }
+
+  const_iterator cend() const noexcept {
+    return end();
+  }
+
+  // -- lookup -----------------------------------------------------------------
+
+  /// Computes the hash code for `key`.
+  static hash_code_type hash_code(const Key& key) noexcept {
+    // Multiplying with the golden ratio spreads poor hash values (e.g., the
+    // identity for integers) over all bits.
+    auto h = static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull;
+    return static_cast<hash_code_type>(h >> 32);
+  }
+
+  iterator find(const Key& key) noexcept {
+    return find(key, hash_code(key));
+  }
+
+  /// @pre `h == hash_code(key)`
+  iterator find(const Key& key, hash_code_type h) noexcept {
+    return {this, find_pos(key, h)};
+  }
+
+  const_iterator find(const Key& key) const noexcept {
+    return find(key, hash_code(key));
+  }
+
+  /// @pre `h == hash_code(key)`
+  const_iterator find(const Key& key, hash_code_type h) const noexcept {
+    return {this, find_pos(key, h)};
+  }
+
+  size_t count(const Key& key) const noexcept {
+    return contains(key) ? 1 : 0;
+  }
+
+  bool contains(const Key& key) const noexcept {
+    return find_pos(key, hash_code(key)) != capacity_;
+  }
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Inserts a new entry unless the map already contains `key`.
+  template <class K, class... Ts>
+  std::pair<iterator, bool> try_emplace(K&& key, Ts&&... xs) {
+    auto h = hash_code(key);
+    return try_emplace_hashed(h, std::forward<K>(key), std::forward<Ts>(xs)...);
+  }
+
+  /// Inserts a new entry unless the map already contains `key`.
+  /// @pre `h == hash_code(key)`
+  template <class K, class... Ts>
+  std::pair<iterator, bool> try_emplace_hashed(hash_code_type h, K&& key,
+                                               Ts&&... xs) {
+    if (auto pos = find_pos(key, h); pos != capacity_)
+      return {iterator{this, pos}, false};
+    grow_if_needed();
+    auto pos = insert_unique(
+      value_type{std::piecewise_construct,
+                 std::forward_as_tuple(std::forward<K>(key)),
+                 std::forward_as_tuple(std::forward<Ts>(xs)...)},
+      h);
+    return {iterator{this, pos}, true};
+  }
+
+  /// Inserts a new entry unless the map already contains `key`.
+  template <class K, class V>
+  std::pair<iterator, bool> emplace(K&& key, V&& value) {
+    return try_emplace(std::forward<K>(key), std::forward<V>(value));
+  }
+
+  std::pair<iterator, bool> insert(value_type x) {
+    return try_emplace(std::move(x.first), std::move(x.second));
+  }
+
+  T& operator[](const Key& key) {
+    return try_emplace(key).first->second;
+  }
+
+  T& operator[](Key&& key) {
+    return try_emplace(std::move(key)).first->second;
+  }
+
+  /// Removes the entry at `pos`. Other than `std::unordered_map::erase`, this
+  /// function returns nothing, because shifting back subsequent entries may
+  /// move an already visited entry to `pos`.
+  void erase(const_iterator pos) noexcept {
+    erase_at(pos.pos_);
+  }
+
+  /// @copydoc erase(const_iterator)
+  void erase(iterator pos) noexcept {
+    erase_at(pos.pos_);
+  }
+
+  size_t erase(const Key& key) noexcept {
+    if (auto pos = find_pos(key, hash_code(key)); pos != capacity_) {
+      erase_at(pos);
+      return 1;
+    }
+    return 0;
+  }
+
+  /// Removes all entries but keeps the allocated slots.
+  void clear() noexcept {
+    for (size_t pos = 0; pos < capacity_ && size_ > 0; ++pos) {
+      if (meta_[pos].dist != 0) {
+        values_[pos].~value_type();
+        meta_[pos].dist = 0;
+        --size_;
+      }
+    }
+  }
+
+  /// Makes sure the map can store at least `n` entries without rehashing.
+  void reserve(size_t n) {
+    auto new_capacity = capacity_ == 0 ? min_capacity : capacity_;
+    while (n > max_size_for(new_capacity))
+      new_capacity *= 2;
+    if (new_capacity != capacity_)
+      rehash(new_capacity);
+  }
+
+  void swap(flat_hash_map& other) noexcept {
+    using std::swap;
+    swap(values_, other.values_);
+    swap(meta_, other.meta_);
+    swap(capacity_, other.capacity_);
+    swap(shift_, other.shift_);
+    swap(size_, other.size_);
+  }
+
+private:
+  // -- utility functions ------------------------------------------------------
+
+  /// Returns how many entries fit into `n` slots at a load factor of 7/8.
+  static constexpr size_t max_size_for(size_t n) noexcept {
+    return n - n / 8;
+  }
+
+  /// Bookkeeping for a single slot.
+  struct slot_meta {
+    /// Stores the distance to the preferred slot of the entry plus one. A zero
+    /// marks empty slots.
+    uint32_t dist;
+
+    /// Stores the hash code of the key.
+    hash_code_type hash;
+  };
+
+  /// Maps a hash code to its preferred slot.
+  size_t home(hash_code_type h) const noexcept {
+    return static_cast<size_t>(h >> shift_);
+  }
+
+  size_t next(size_t pos) const noexcept {
+    return (pos + 1) & (capacity_ - 1);
+  }
+
+  size_t next_occupied(size_t pos) const noexcept {
+    while (pos < capacity_ && meta_[pos].dist == 0)
+      ++pos;
+    return pos;
+  }
+
+  /// Returns the slot of `key` or `capacity_` if the map has no such key.
+  size_t find_pos(const Key& key, hash_code_type h) const noexcept {
+    if (size_ == 0)
+      return capacity_;
+    auto pos = home(h);
+    // Robin Hood hashing guarantees that `key` cannot appear after an entry
+    // that is closer to its preferred slot.
+    for (uint32_t dist = 1; dist <= meta_[pos].dist; ++dist) {
+      if (meta_[pos].dist == dist && meta_[pos].hash == h
+          && KeyEqual{}(values_[pos].first, key))
+        return pos;
+      pos = next(pos);
+    }
+    return capacity_;
+  }
+
+  void grow_if_needed() {
+    if (capacity_ == 0)
+      rehash(min_capacity);
+    else if (size_ + 1 > max_size_for(capacity_))
+      rehash(capacity_ * 2);
+  }
+
+  /// Inserts `x` and returns its final slot.
+  /// @pre the map has no entry with the same key and at least one free slot.
+  size_t insert_unique(value_type&& x, hash_code_type h) {
+    auto result = capacity_;
+    auto pos = home(h);
+    uint32_t dist = 1;
+    for (;;) {
+      if (meta_[pos].dist == 0) {
+        new (values_ + pos) value_type(std::move(x));
+        meta_[pos] = slot_meta{dist, h};
+        ++size_;
+        return result == capacity_ ? pos : result;
+      }
+      if (meta_[pos].dist < dist) {
+        // Take the slot from the "richer" entry and keep looking for a slot
+        // for the displaced entry.
+        using std::swap;
+        swap(x, values_[pos]);
+        swap(dist, meta_[pos].dist);
+        swap(h, meta_[pos].hash);
+        if (result == capacity_)
+          result = pos;
+      }
+      pos = next(pos);
+      ++dist;
+    }
+  }
+
+  void erase_at(size_t pos) noexcept {
+    values_[pos].~value_type();
+    meta_[pos].dist = 0;
+    --size_;
+    // Shift back all subsequent entries that are not in their preferred slot.
+    for (auto succ = next(pos); meta_[succ].dist > 1; succ = next(succ)) {
+      new (values_ + pos) value_type(std::move(values_[succ]));
+      values_[succ].~value_type();
+      meta_[pos] = slot_meta{meta_[succ].dist - 1, meta_[succ].hash};
+      meta_[succ].dist = 0;
+      pos = succ;
+    }
+  }
+
+  void allocate(size_t n) {
+    values_ = std::allocator<value_type>{}.allocate(n);
+    meta_ = new slot_meta[n]();
+    capacity_ = n;
+    shift_ = 32;
+    for (auto i = n; i > 1; i /= 2)
+      --shift_;
+  }
+
+  void deallocate() noexcept {
+    if (capacity_ > 0) {
+      std::allocator<value_type>{}.deallocate(values_, capacity_);
+      delete[] meta_;
+      values_ = nullptr;
+      meta_ = nullptr;
+      capacity_ = 0;
+    }
+  }
+
+  void rehash(size_t new_capacity) {
+    flat_hash_map tmp;
+    tmp.allocate(new_capacity);
+    for (size_t pos = 0; pos < capacity_; ++pos)
+      if (meta_[pos].dist != 0)
+        tmp.insert_unique(std::move(values_[pos]), meta_[pos].hash);
+    swap(tmp);
+  }
+
+  // -- member variables -------------------------------------------------------
+
+  /// Stores the entries. Only slots with a non-zero distance hold an object.
+  value_type* values_ = nullptr;
+
+  /// Stores the bookkeeping for each slot.
+  slot_meta* meta_ = nullptr;
+
+  /// Stores the number of slots. Always zero or a power of two of at most
+  /// 2^32, because `home` derives the slot from the 32-bit hash code.
+  size_t capacity_ = 0;
+
+  /// Shift for mapping a hash code to a slot.
+  int shift_ = 32;
+
+  /// Stores the number of entries.
+  size_t size_ = 0;
+};
+
+} // namespace broker::detail
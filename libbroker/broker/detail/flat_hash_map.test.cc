@@ -0,0 +1,97 @@
+#include "broker/detail/flat_hash_map.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include "broker/data.hh"
+
+#include <unordered_map>
+
+using namespace broker;
+
+namespace {
+
+using map_type = detail::flat_hash_map<data, data>;
+
+struct fixture {
+  map_type uut;
+
+  // Collects the content of `uut` into a map with reference semantics.
+  std::unordered_map<data, data> content() const {
+    return {uut.begin(), uut.end()};
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(flat_hash_map_tests, fixture)
+
+TEST(default constructed maps are empty) {
+  CHECK(uut.empty());
+  CHECK_EQUAL(uut.size(), 0u);
+  CHECK_EQUAL(uut.capacity(), 0u);
+  CHECK(uut.begin() == uut.end());
+  CHECK(uut.find(data{"a"}) == uut.end());
+  CHECK_EQUAL(uut.erase(data{"a"}), 0u);
+}
+
+TEST(emplace inserts new keys only) {
+  CHECK(uut.emplace(data{"a"}, data{1}).second);
+  CHECK(uut.emplace(data{"b"}, data{2}).second);
+  CHECK(!uut.emplace(data{"a"}, data{3}).second);
+  CHECK_EQUAL(uut.size(), 2u);
+  CHECK_EQUAL(uut.find(data{"a"})->second, data{1});
+  uut[data{"a"}] = data{4};
+  CHECK_EQUAL(uut.find(data{"a"})->second, data{4});
+  CHECK_EQUAL(uut[data{"c"}], data{});
+  CHECK_EQUAL(uut.size(), 3u);
+}
+
+TEST(the map grows and shrinks consistently) {
+  std::unordered_map<data, data> expected;
+  for (integer i = 0; i < 1000; ++i) {
+    uut.emplace(data{i * 1024}, data{i});
+    expected.emplace(data{i * 1024}, data{i});
+  }
+  CHECK_EQUAL(uut.size(), 1000u);
+  CHECK(content() == expected);
+  for (integer i = 0; i < 1000; i += 2) {
+    CHECK_EQUAL(uut.erase(data{i * 1024}), 1u);
+    expected.erase(data{i * 1024});
+  }
+  CHECK_EQUAL(uut.size(), 500u);
+  CHECK(content() == expected);
+  for (integer i = 0; i < 1000; ++i)
+    CHECK_EQUAL(uut.count(data{i * 1024}), i % 2 == 0 ? 0u : 1u);
+}
+
+TEST(lookups accept precomputed hash codes) {
+  auto key = data{vector{data{1}, data{"two"}, data{3.0}}};
+  auto h = map_type::hash_code(key);
+  CHECK_EQUAL(h, map_type::hash_code(data{key}));
+  CHECK(uut.find(key, h) == uut.end());
+  CHECK(uut.try_emplace_hashed(h, key, data{1}).second);
+  CHECK(!uut.try_emplace_hashed(h, key, data{2}).second);
+  auto i = uut.find(key, h);
+  if (CHECK(i != uut.end()))
+    CHECK_EQUAL(i->second, data{1});
+}
+
+TEST(copies are independent) {
+  uut.emplace(data{"a"}, data{1});
+  auto cpy = uut;
+  cpy.erase(cpy.find(data{"a"}));
+  CHECK(cpy.empty());
+  CHECK_EQUAL(uut.size(), 1u);
+}
+
+TEST(clear keeps the capacity) {
+  uut.reserve(100);
+  auto cap = uut.capacity();
+  CHECK_GREATER_EQUAL(cap, 100u);
+  uut.emplace(data{"a"}, data{1});
+  uut.clear();
+  CHECK(uut.empty());
+  CHECK_EQUAL(uut.capacity(), cap);
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "broker/data.hh"
+
+namespace broker::detail {
+
+/// Selects the smallest keys that pass a filter from a sequence of keys in
+/// arbitrary order. The collector never holds more than `limit` keys at a
+/// time. Hence, backends can answer range queries on large stores without
+/// materializing the full key set.
+template <class Filter>
+class key_collector {
+public:
+  /// @param filter Decides whether to consider a key.
+  /// @param limit The maximum number of keys in the result. A value of 0
+  ///              selects all matching keys.
+  key_collector(Filter filter, size_t limit)
+    : filter_(std::move(filter)), limit_(limit) {
+    // nop
+  }
+
+  /// Considers `key` for the result.
+  void add(const data& key) {
+    if (!filter_(key))
+      return;
+    if (limit_ == 0 || keys_.size() < limit_) {
+      keys_.insert(key);
+    } else if (key < *keys_.rbegin() && keys_.count(key) == 0) {
+      keys_.erase(std::prev(keys_.end()));
+      keys_.insert(key);
+    }
+  }
+
+  /// Returns all selected keys in ascending order.
+  data result() && {
+    vector xs;
+    xs.reserve(keys_.size());
+    while (!keys_.empty())
+      xs.emplace_back(std::move(keys_.extract(keys_.begin()).value()));
+    return data{std::move(xs)};
+  }
+
+private:
+  Filter filter_;
+  size_t limit_;
+  std::set<data> keys_;
+};
+
+/// Selects keys `k` with `first <= k < last`. A default-constructed `last`
+/// selects all keys that are not less than `first`.
+inline auto key_range_filter(data first, data last) {
+  return [first{std::move(first)}, last{std::move(last)}](const data& key) {
+    return !(key < first) && (is<none>(last) || key < last);
+  };
+}
+
+/// Selects string keys that begin with `prefix`.
+inline auto key_prefix_filter(std::string prefix) {
+  return [prefix{std::move(prefix)}](const data& key) {
+    auto* str = get_if<std::string>(key);
+    return str != nullptr && str->compare(0, prefix.size(), prefix) == 0;
+  };
+}
+
+/// Convenience function for creating a @ref key_collector.
+template <class Filter>
+auto make_key_collector(Filter filter, size_t limit) {
+  return key_collector<Filter>{std::move(filter), limit};
+}
+
+} // namespace broker::detail
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace broker::detail {
+
+/// A fixed-capacity map that evicts its least recently used entry when
+/// inserting into a full cache.
+template <class Key, class T>
+class lru_cache {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using value_type = std::pair<Key, T>;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// @param capacity The maximum number of entries. A capacity of 0 disables
+  ///                 the cache, i.e., it never stores any entry.
+  explicit lru_cache(size_t capacity = 0) : capacity_(capacity) {
+    // nop
+  }
+
+  // -- properties -------------------------------------------------------------
+
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  /// Sets a new capacity, evicting entries if necessary.
+  void capacity(size_t value) {
+    capacity_ = value;
+    while (entries_.size() > capacity_)
+      evict();
+  }
+
+  size_t size() const noexcept {
+    return entries_.size();
+  }
+
+  bool empty() const noexcept {
+    return entries_.empty();
+  }
+
+  // -- lookups ----------------------------------------------------------------
+
+  /// Returns a pointer to the value for `key` or `nullptr` if the cache has no
+  /// entry for `key`. Marks the entry as most recently used on a hit.
+  const T* get(const Key& key) {
+    auto i = index_.find(key);
+    if (i == index_.end())
+      return nullptr;
+    entries_.splice(entries_.begin(), entries_, i->second);
+    return &i->second->second;
+  }
+
+  /// Checks whether the cache has an entry for `key` without touching it.
+  bool contains(const Key& key) const {
+    return index_.count(key) != 0;
+  }
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Inserts or overrides the entry for `key` and marks it as most recently
+  /// used.
+  void put(const Key& key, T value) {
+    if (capacity_ == 0)
+      return;
+    if (auto i = index_.find(key); i != index_.end()) {
+      i->second->second = std::move(value);
+      entries_.splice(entries_.begin(), entries_, i->second);
+      return;
+    }
+    if (entries_.size() == capacity_)
+      evict();
+    entries_.emplace_front(key, std::move(value));
+    index_.emplace(key, entries_.begin());
+  }
+
+  /// Removes the entry for `key` if present.
+  void erase(const Key& key) {
+    if (auto i = index_.find(key); i != index_.end()) {
+      entries_.erase(i->second);
+      index_.erase(i);
+    }
+  }
+
+  void clear() {
+    index_.clear();
+    entries_.clear();
+  }
+
+private:
+  using list_type = std::list<value_type>;
+
+  void evict() {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+
+  size_t capacity_;
+
+  /// Stores all entries, ordered from most to least recently used.
+  list_type entries_;
+
+  /// Maps keys to their position in `entries_`.
+  std::unordered_map<Key, typename list_type::iterator> index_;
+};
+
+} // namespace broker::detail
@@ -0,0 +1,70 @@
+#include "broker/detail/lru_cache.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <string>
+
+using namespace broker;
+
+namespace {
+
+using cache_type = detail::lru_cache<std::string, int>;
+
+struct fixture {
+  cache_type uut{3};
+};
+
+} // namespace
+
+FIXTURE_SCOPE(lru_cache_tests, fixture)
+
+TEST(caches with capacity 0 never store entries) {
+  cache_type cache;
+  cache.put("a", 1);
+  CHECK(cache.empty());
+  CHECK(cache.get("a") == nullptr);
+}
+
+TEST(get returns the most recent value) {
+  uut.put("a", 1);
+  uut.put("b", 2);
+  uut.put("a", 3);
+  CHECK_EQUAL(uut.size(), 2u);
+  if (auto val = uut.get("a"); CHECK(val != nullptr))
+    CHECK_EQUAL(*val, 3);
+  if (auto val = uut.get("b"); CHECK(val != nullptr))
+    CHECK_EQUAL(*val, 2);
+  CHECK(uut.get("c") == nullptr);
+}
+
+TEST(full caches evict the least recently used entry) {
+  uut.put("a", 1);
+  uut.put("b", 2);
+  uut.put("c", 3);
+  CHECK(uut.get("a") != nullptr);
+  uut.put("d", 4);
+  CHECK_EQUAL(uut.size(), 3u);
+  CHECK(!uut.contains("b"));
+  CHECK(uut.contains("a"));
+  CHECK(uut.contains("c"));
+  CHECK(uut.contains("d"));
+  MESSAGE("shrinking the capacity evicts entries in the same order");
+  uut.capacity(1);
+  CHECK_EQUAL(uut.size(), 1u);
+  CHECK(uut.contains("d"));
+}
+
+TEST(erase and clear remove entries) {
+  uut.put("a", 1);
+  uut.put("b", 2);
+  uut.erase("a");
+  uut.erase("x");
+  CHECK_EQUAL(uut.size(), 1u);
+  CHECK(!uut.contains("a"));
+  uut.clear();
+  CHECK(uut.empty());
+  uut.put("c", 3);
+  CHECK(uut.contains("c"));
+}
+
+FIXTURE_SCOPE_END()
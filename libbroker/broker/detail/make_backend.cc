@@ -3,6 +3,7 @@
 #include "broker/detail/die.hh"
 #include "broker/detail/make_backend.hh"
 #include "broker/detail/memory_backend.hh"
+#include "broker/detail/mmap_backend.hh"
 #include "broker/detail/sqlite_backend.hh"
 
 namespace broker::detail {
@@ -18,6 +19,12 @@ std::unique_ptr<detail::abstract_backend> make_backend(backend type,
         return nullptr;
       return rval;
     }
+    case backend::mmap: {
+      auto rval = std::make_unique<mmap_backend>(std::move(opts));
+      if (rval->init_failed())
+        return nullptr;
+      return rval;
+    }
   }
 
   die("invalid backend type");
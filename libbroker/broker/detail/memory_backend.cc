@@ -3,6 +3,7 @@
 #include <utility>
 
 #include "broker/detail/appliers.hh"
+#include "broker/detail/key_collector.hh"
 #include "broker/detail/memory_backend.hh"
 
 namespace broker::detail {
@@ -14,23 +15,24 @@ memory_backend::memory_backend(backend_options opts)
 
 expected<void> memory_backend::put(const data& key, data value,
                                    std::optional<timestamp> expiry) {
-  store_[key] = {std::move(value), expiry};
+  store_[key] = entry{std::move(value), expiry};
   return {};
 }
 
 expected<void> memory_backend::add(const data& key, const data& value,
                                    data::type init_type,
                                    std::optional<timestamp> expiry) {
-  auto i = store_.find(key);
+  auto h = store_.hash_code(key);
+  auto i = store_.find(key, h);
   if (i == store_.end()) {
     if (init_type == data::type::none)
       return ec::type_clash;
-    auto new_val = std::make_pair(data::from_type(init_type), expiry);
-    i = store_.emplace(key, std::move(new_val)).first;
+    auto new_val = entry{data::from_type(init_type), expiry};
+    i = store_.try_emplace_hashed(h, key, std::move(new_val)).first;
   }
-  auto result = visit(adder{value}, i->second.first);
+  auto result = visit(adder{value}, i->second.value);
   if (result)
-    i->second.second = expiry;
+    i->second.expiry(expiry);
   return result;
 }
 
@@ -39,9 +41,9 @@ expected<void> memory_backend::subtract(const data& key, const data& value,
   auto i = store_.find(key);
   if (i == store_.end())
     return ec::no_such_key;
-  auto result = visit(remover{value}, i->second.first);
+  auto result = visit(remover{value}, i->second.value);
   if (result)
-    i->second.second = expiry;
+    i->second.expiry(expiry);
   return result;
 }
 
@@ -59,7 +61,7 @@ expected<bool> memory_backend::expire(const data& key, timestamp ts) {
   auto i = store_.find(key);
   if (i == store_.end())
     return false;
-  if (!i->second.second || ts < i->second.second)
+  if (auto expiry = i->second.expiry(); !expiry || ts < *expiry)
     return false;
   store_.erase(i);
   return true;
@@ -69,7 +71,7 @@ expected<data> memory_backend::get(const data& key) const {
   auto i = store_.find(key);
   if (i == store_.end())
     return ec::no_such_key;
-  return i->second.first;
+  return i->second.value;
 }
 
 expected<data> memory_backend::keys() const {
@@ -79,6 +81,22 @@ expected<data> memory_backend::keys() const {
   return {std::move(keys)};
 }
 
+expected<data> memory_backend::range(const data& first, const data& last,
+                                     size_t limit) const {
+  auto collector = make_key_collector(key_range_filter(first, last), limit);
+  for (const auto& kvp : store_)
+    collector.add(kvp.first);
+  return std::move(collector).result();
+}
+
+expected<data> memory_backend::keys_with_prefix(const std::string& prefix,
+                                                size_t limit) const {
+  auto collector = make_key_collector(key_prefix_filter(prefix), limit);
+  for (const auto& kvp : store_)
+    collector.add(kvp.first);
+  return std::move(collector).result();
+}
+
 expected<data> memory_backend::get(const data& key, const data& value) const {
   auto i = store_.find(key);
   if (i == store_.end())
@@ -86,7 +104,7 @@ expected<data> memory_backend::get(const data& key, const data& value) const {
   // We do not use the default implementation because operating directly on the
   // stored data element is more efficient in case the visitation returns an
   // error.
-  return visit(retriever{value}, i->second.first);
+  return visit(retriever{value}, i->second.value);
 }
 
 expected<bool> memory_backend::exists(const data& key) const {
@@ -99,17 +117,25 @@ expected<uint64_t> memory_backend::size() const {
 
 expected<snapshot> memory_backend::snapshot() const {
   broker::snapshot ss;
+  ss.reserve(store_.size());
   for (auto& p : store_)
-    ss.emplace(p.first, p.second.first);
+    ss.emplace(p.first, p.second.value);
   return {std::move(ss)};
 }
 
+expected<void> memory_backend::for_each(const entry_visitor& f) const {
+  for (const auto& kvp : store_)
+    if (!f(kvp.first, kvp.second.value))
+      break;
+  return {};
+}
+
 expected<expirables> memory_backend::expiries() const {
   expirables rval;
 
   for (auto& p : store_) {
-    if (p.second.second)
-      rval.emplace_back(expirable(p.first, *p.second.second));
+    if (auto expiry = p.second.expiry())
+      rval.emplace_back(expirable(p.first, *expiry));
   }
 
   return {std::move(rval)};
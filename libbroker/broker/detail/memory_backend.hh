@@ -1,11 +1,12 @@
 #pragma once
 
 #include <optional>
-#include <unordered_map>
+#include <utility>
 
 #include "broker/backend_options.hh"
 
 #include "broker/detail/abstract_backend.hh"
+#include "broker/detail/flat_hash_map.hh"
 
 namespace broker::detail {
 
@@ -41,14 +42,50 @@ public:
 
   expected<data> keys() const override;
 
+  expected<data> range(const data& first, const data& last,
+                       size_t limit) const override;
+
+  expected<data> keys_with_prefix(const std::string& prefix,
+                                  size_t limit) const override;
+
   expected<broker::snapshot> snapshot() const override;
 
+  expected<void> for_each(const entry_visitor& f) const override;
+
   expected<expirables> expiries() const override;
 
 private:
+  /// A value in the store plus its optional expiration time. Stores
+  /// `timestamp::max()` for values without expiration instead of using an
+  /// `std::optional`, which would add 8 bytes of padding to each slot.
+  struct entry {
+    static constexpr timestamp never = timestamp::max();
+
+    entry() = default;
+
+    entry(data value, std::optional<timestamp> expiry)
+      : value(std::move(value)), expires(expiry.value_or(never)) {
+      // nop
+    }
+
+    std::optional<timestamp> expiry() const noexcept {
+      if (expires == never)
+        return std::nullopt;
+      return expires;
+    }
+
+    void expiry(std::optional<timestamp> x) noexcept {
+      expires = x.value_or(never);
+    }
+
+    data value;
+    timestamp expires = never;
+  };
+
+  static_assert(sizeof(entry) == sizeof(data) + sizeof(timestamp));
+
   backend_options options_;
-  std::unordered_map<data, std::pair<data, std::optional<timestamp>>> store_;
-  std::unordered_map<data, timestamp> expirations_;
+  flat_hash_map<data, entry> store_;
 };
 
 } // namespace broker::detail
@@ -0,0 +1,650 @@
+#include "broker/detail/mmap_backend.hh"
+
+#include "broker/internal/logger.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <caf/binary_deserializer.hpp>
+
+#include "broker/config.hh"
+#include "broker/detail/appliers.hh"
+#include "broker/detail/filesystem.hh"
+#include "broker/detail/key_collector.hh"
+#include "broker/error.hh"
+#include "broker/format/bin.hh"
+#include "broker/internal/type_id.hh"
+
+#ifndef BROKER_WINDOWS
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace broker::detail {
+
+namespace {
+
+// Identifies log files of this backend. Starts each log file.
+constexpr char magic[] = {'B', 'R', 'O', 'K', 'E', 'R', 'L', '1'};
+
+constexpr size_t file_header_size = sizeof(magic);
+
+// Layout of a record: type (1 byte), key size (4 bytes), value size (4 bytes),
+// expiry (8 bytes), key and value. All integers use the byte order of the
+// host.
+constexpr size_t record_header_size = 17;
+
+// Minimum number of bytes when growing the log file.
+constexpr size_t min_growth = 1024 * 1024;
+
+// Default value for the option `compaction_threshold`.
+constexpr uint64_t default_compaction_threshold = 64 * 1024 * 1024;
+
+// Encodes the absence of an expiry in a record.
+constexpr int64_t no_expiry = std::numeric_limits<int64_t>::min();
+
+enum class record_type : uint8_t {
+  /// Marks the end of the log.
+  end = 0,
+  /// Stores a new value for a key.
+  put = 1,
+  /// Removes a key.
+  erase = 2,
+  /// Removes all keys.
+  clear = 3,
+};
+
+std::vector<caf::byte> to_blob(const data& x) {
+  std::vector<caf::byte> buf;
+  buf.reserve(128); // Pre-allocate some space.
+  format::bin::v1::encode(x, std::back_inserter(buf));
+  return buf;
+}
+
+expected<data> from_blob(const void* buf, size_t size) {
+  caf::binary_deserializer sink{nullptr, buf, size};
+  data result;
+  if (sink.apply(result))
+    return {std::move(result)};
+  else
+    return {ec::invalid_data};
+}
+
+// Locates a record in the log.
+struct slot {
+  size_t offset;
+  uint32_t key_size;
+  uint32_t value_size;
+  std::optional<timestamp> expiry;
+
+  size_t record_size() const noexcept {
+    return record_header_size + key_size + value_size;
+  }
+};
+
+// Provides access to a file via mmap. Keeps a zero byte after the last record
+// to mark the end of the log.
+class mapped_file {
+public:
+  mapped_file() = default;
+
+  mapped_file(const mapped_file&) = delete;
+
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  ~mapped_file() {
+    close();
+  }
+
+  bool is_open() const noexcept {
+    return buf_ != nullptr;
+  }
+
+  std::byte* data() noexcept {
+    return buf_;
+  }
+
+  size_t size() const noexcept {
+    return size_;
+  }
+
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  void size(size_t new_size) noexcept {
+    size_ = new_size;
+  }
+
+  void swap(mapped_file& other) noexcept {
+    std::swap(fd_, other.fd_);
+    std::swap(buf_, other.buf_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+  }
+
+#ifndef BROKER_WINDOWS
+
+  bool open(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+      BROKER_ERROR("failed to open log file:" << path << ":"
+                                              << strerror(errno));
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+      BROKER_ERROR("failed to stat log file:" << path << ":"
+                                              << strerror(errno));
+      close();
+      return false;
+    }
+    auto file_size = static_cast<size_t>(st.st_size);
+    if (file_size == 0) {
+      if (!map(min_growth)) {
+        close();
+        return false;
+      }
+      memcpy(buf_, magic, file_header_size);
+      buf_[file_header_size] = std::byte{0};
+    } else if (file_size <= file_header_size || !map(file_size)
+               || memcmp(buf_, magic, file_header_size) != 0) {
+      BROKER_ERROR("not a valid log file:" << path);
+      close();
+      return false;
+    }
+    size_ = file_header_size;
+    return true;
+  }
+
+  void close() {
+    if (buf_ != nullptr) {
+      munmap(buf_, capacity_);
+      buf_ = nullptr;
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+    size_ = 0;
+    capacity_ = 0;
+  }
+
+  bool sync() {
+    if (msync(buf_, capacity_, MS_SYNC) != 0) {
+      BROKER_ERROR("failed to sync log file:" << strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  /// Makes sure that there is room for `n` more bytes plus the end marker.
+  bool reserve(size_t n) {
+    if (size_ + n < capacity_)
+      return true;
+    auto new_capacity = std::max(capacity_ * 2, size_ + n + min_growth);
+    munmap(buf_, capacity_);
+    buf_ = nullptr;
+    return map(new_capacity);
+  }
+
+#else // BROKER_WINDOWS
+
+  bool open(const std::string& path) {
+    BROKER_ERROR("memory-mapped backend not available on Windows:" << path);
+    return false;
+  }
+
+  void close() {
+    // nop
+  }
+
+  bool sync() {
+    return false;
+  }
+
+  bool reserve(size_t) {
+    return false;
+  }
+
+#endif // BROKER_WINDOWS
+
+  /// Appends a record and returns its offset or 0 on error.
+  size_t append(record_type type, const std::vector<caf::byte>& key,
+                const std::vector<caf::byte>& value,
+                std::optional<timestamp> expiry) {
+    constexpr size_t max_size = std::numeric_limits<uint32_t>::max();
+    if (key.size() > max_size || value.size() > max_size)
+      return 0;
+    auto key_size = static_cast<uint32_t>(key.size());
+    auto value_size = static_cast<uint32_t>(value.size());
+    auto ts = expiry ? expiry->time_since_epoch().count() : no_expiry;
+    auto record_size = record_header_size + key_size + value_size;
+    if (!reserve(record_size))
+      return 0;
+    auto offset = size_;
+    auto* ptr = buf_ + offset;
+    memcpy(ptr + 1, &key_size, 4);
+    memcpy(ptr + 5, &value_size, 4);
+    memcpy(ptr + 9, &ts, 8);
+    if (key_size > 0)
+      memcpy(ptr + record_header_size, key.data(), key_size);
+    if (value_size > 0)
+      memcpy(ptr + record_header_size + key_size, value.data(), value_size);
+    size_ += record_size;
+    buf_[size_] = std::byte{0};
+    // Write the type last to make the record visible only once complete.
+    *ptr = static_cast<std::byte>(type);
+    return offset;
+  }
+
+  /// Appends a copy of an existing record and returns its offset or 0 on
+  /// error.
+  size_t append_raw(const std::byte* record, size_t record_size) {
+    if (!reserve(record_size))
+      return 0;
+    auto offset = size_;
+    memcpy(buf_ + offset, record, record_size);
+    size_ += record_size;
+    buf_[size_] = std::byte{0};
+    return offset;
+  }
+
+private:
+#ifndef BROKER_WINDOWS
+  bool map(size_t new_capacity) {
+    if (ftruncate(fd_, static_cast<off_t>(new_capacity)) != 0) {
+      BROKER_ERROR("failed to resize log file:" << strerror(errno));
+      return false;
+    }
+    auto* ptr = mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd_, 0);
+    if (ptr == MAP_FAILED) {
+      BROKER_ERROR("failed to map log file:" << strerror(errno));
+      return false;
+    }
+    buf_ = static_cast<std::byte*>(ptr);
+    capacity_ = new_capacity;
+    return true;
+  }
+#endif // BROKER_WINDOWS
+
+  int fd_ = -1;
+  std::byte* buf_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+};
+
+} // namespace
+
+struct mmap_backend::impl {
+  impl(backend_options opts) {
+    auto i = opts.find("compaction_threshold");
+    if (i != opts.end()) {
+      if (auto value = get_if<broker::count>(&i->second)) {
+        compaction_threshold = *value;
+      } else {
+        BROKER_ERROR("mmap backend option 'compaction_threshold' not a count");
+        return;
+      }
+    }
+    i = opts.find("path");
+    if (i == opts.end()) {
+      BROKER_ERROR("mmap backend options are missing required 'path' string");
+      return;
+    }
+    if (auto str = get_if<std::string>(&i->second)) {
+      path = *str;
+    } else {
+      BROKER_ERROR("mmap backend option 'path' is not a string");
+      return;
+    }
+    auto dir = detail::dirname(path);
+    if (!dir.empty() && !detail::is_directory(dir) && !detail::mkdirs(dir)) {
+      BROKER_ERROR("failed to create directory for log file: " << dir);
+      return;
+    }
+    if (!file.open(path))
+      BROKER_ERROR("unable to open log file " << path);
+  }
+
+  ~impl() {
+    if (file.is_open())
+      file.sync();
+  }
+
+  // Scans the log on first access to fill the index.
+  bool ensure_index() {
+    if (!file.is_open())
+      return false;
+    if (!indexed) {
+      rebuild_index();
+      indexed = true;
+    }
+    return true;
+  }
+
+  void rebuild_index() {
+    BROKER_TRACE(BROKER_ARG(path));
+    auto* buf = file.data();
+    auto pos = file_header_size;
+    while (pos + record_header_size < file.capacity()) {
+      auto type = static_cast<record_type>(buf[pos]);
+      if (type == record_type::end)
+        break;
+      slot x;
+      x.offset = pos;
+      memcpy(&x.key_size, buf + pos + 1, 4);
+      memcpy(&x.value_size, buf + pos + 5, 4);
+      int64_t ts;
+      memcpy(&ts, buf + pos + 9, 8);
+      if (ts != no_expiry)
+        x.expiry = timestamp{timespan{ts}};
+      if (pos + x.record_size() >= file.capacity()) {
+        BROKER_WARNING("log file" << path << "ends with a truncated record");
+        break;
+      }
+      if (type == record_type::clear) {
+        index.clear();
+        garbage = pos + x.record_size() - file_header_size;
+        pos += x.record_size();
+        continue;
+      }
+      auto key = from_blob(buf + pos + record_header_size, x.key_size);
+      if (!key) {
+        BROKER_WARNING("log file" << path << "contains an invalid key");
+        break;
+      }
+      switch (type) {
+        case record_type::put: {
+          auto [i, added] = index.try_emplace(std::move(*key), x);
+          if (!added) {
+            garbage += i->second.record_size();
+            i->second = x;
+          }
+          break;
+        }
+        case record_type::erase: {
+          if (auto i = index.find(*key); i != index.end()) {
+            garbage += i->second.record_size();
+            index.erase(i);
+          }
+          garbage += x.record_size();
+          break;
+        }
+        default:
+          BROKER_WARNING("log file" << path << "contains an invalid record");
+          file.size(pos);
+          return;
+      }
+      pos += x.record_size();
+    }
+    file.size(pos);
+    file.data()[pos] = std::byte{0};
+  }
+
+  bool append_put(const data& key, const data& value,
+                  std::optional<timestamp> expiry) {
+    auto key_blob = to_blob(key);
+    auto value_blob = to_blob(value);
+    auto offset = file.append(record_type::put, key_blob, value_blob, expiry);
+    if (offset == 0)
+      return false;
+    slot x{offset, static_cast<uint32_t>(key_blob.size()),
+           static_cast<uint32_t>(value_blob.size()), expiry};
+    auto [i, added] = index.try_emplace(key, x);
+    if (!added) {
+      garbage += i->second.record_size();
+      i->second = x;
+    }
+    return true;
+  }
+
+  bool append_erase(std::unordered_map<data, slot>::iterator i) {
+    auto offset = file.append(record_type::erase, to_blob(i->first), {},
+                              std::nullopt);
+    if (offset == 0)
+      return false;
+    garbage += i->second.record_size() + file.size() - offset;
+    index.erase(i);
+    return true;
+  }
+
+  expected<data> value_of(const slot& x) {
+    auto* ptr = file.data() + x.offset + record_header_size + x.key_size;
+    return from_blob(ptr, x.value_size);
+  }
+
+  std::string path;
+  mapped_file file;
+  std::unordered_map<data, slot> index;
+  bool indexed = false;
+  // Number of bytes in records that no longer contribute to the content.
+  uint64_t garbage = 0;
+  uint64_t compaction_threshold = default_compaction_threshold;
+};
+
+mmap_backend::mmap_backend(backend_options opts)
+  : impl_{std::make_unique<impl>(std::move(opts))} {}
+
+mmap_backend::~mmap_backend() {}
+
+bool mmap_backend::init_failed() const {
+  return !impl_->file.is_open();
+}
+
+expected<void> mmap_backend::put(const data& key, data value,
+                                 std::optional<timestamp> expiry) {
+  if (!impl_->ensure_index() || !impl_->append_put(key, value, expiry))
+    return ec::backend_failure;
+  return {};
+}
+
+expected<void> mmap_backend::add(const data& key, const data& value,
+                                 data::type init_type,
+                                 std::optional<timestamp> expiry) {
+  auto v = get(key);
+  data vv;
+  if (!v) {
+    if (v.error() != ec::no_such_key)
+      return v.error();
+    vv = data::from_type(init_type);
+  } else {
+    vv = std::move(*v);
+  }
+  auto result = visit(adder{value}, vv);
+  if (!result)
+    return result;
+  return put(key, std::move(vv), expiry);
+}
+
+expected<void> mmap_backend::subtract(const data& key, const data& value,
+                                      std::optional<timestamp> expiry) {
+  auto v = get(key);
+  if (!v)
+    return v.error();
+  auto result = visit(remover{value}, *v);
+  if (!result)
+    return result;
+  return put(key, std::move(*v), expiry);
+}
+
+expected<void> mmap_backend::erase(const data& key) {
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  if (auto i = impl_->index.find(key);
+      i != impl_->index.end() && !impl_->append_erase(i))
+    return ec::backend_failure;
+  return {};
+}
+
+expected<void> mmap_backend::clear() {
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  if (impl_->file.append(record_type::clear, {}, {}, std::nullopt) == 0)
+    return ec::backend_failure;
+  impl_->index.clear();
+  impl_->garbage = impl_->file.size() - file_header_size;
+  return {};
+}
+
+expected<bool> mmap_backend::expire(const data& key, timestamp ts) {
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  auto i = impl_->index.find(key);
+  if (i == impl_->index.end())
+    return false;
+  if (!i->second.expiry || ts < *i->second.expiry)
+    return false;
+  if (!impl_->append_erase(i))
+    return ec::backend_failure;
+  return true;
+}
+
+expected<void> mmap_backend::flush() {
+  if (!impl_->file.is_open() || !impl_->file.sync())
+    return ec::backend_failure;
+  if (impl_->garbage >= impl_->compaction_threshold
+      && impl_->garbage * 2 >= impl_->file.size())
+    return compact();
+  return {};
+}
+
+expected<void> mmap_backend::compact() {
+  BROKER_TRACE("");
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  auto tmp_path = impl_->path + ".compact";
+  if (detail::exists(tmp_path))
+    detail::remove(tmp_path);
+  mapped_file tmp;
+  if (!tmp.open(tmp_path))
+    return ec::backend_failure;
+  // Copy all live records to the new file.
+  std::vector<size_t> offsets;
+  offsets.reserve(impl_->index.size());
+  for (auto& kvp : impl_->index) {
+    auto offset = tmp.append_raw(impl_->file.data() + kvp.second.offset,
+                                 kvp.second.record_size());
+    if (offset == 0) {
+      tmp.close();
+      detail::remove(tmp_path);
+      return ec::backend_failure;
+    }
+    offsets.push_back(offset);
+  }
+  if (!tmp.sync()
+      || std::rename(tmp_path.c_str(), impl_->path.c_str()) != 0) {
+    BROKER_ERROR("failed to replace log file" << impl_->path);
+    tmp.close();
+    detail::remove(tmp_path);
+    return ec::backend_failure;
+  }
+  // Switch to the new file.
+  auto offset = offsets.begin();
+  for (auto& kvp : impl_->index)
+    kvp.second.offset = *offset++;
+  impl_->file.swap(tmp);
+  impl_->garbage = 0;
+  BROKER_INFO("compacted log file" << impl_->path);
+  return {};
+}
+
+expected<data> mmap_backend::get(const data& key) const {
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  auto i = impl_->index.find(key);
+  if (i == impl_->index.end())
+    return ec::no_such_key;
+  return impl_->value_of(i->second);
+}
+
+expected<bool> mmap_backend::exists(const data& key) const {
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  return impl_->index.count(key) == 1;
+}
+
+expected<uint64_t> mmap_backend::size() const {
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  return impl_->index.size();
+}
+
+expected<data> mmap_backend::keys() const {
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  set result;
+  for (const auto& kvp : impl_->index)
+    result.insert(kvp.first);
+  return {std::move(result)};
+}
+
+expected<data> mmap_backend::range(const data& first, const data& last,
+                                   size_t limit) const {
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  auto collector = make_key_collector(key_range_filter(first, last), limit);
+  for (const auto& kvp : impl_->index)
+    collector.add(kvp.first);
+  return std::move(collector).result();
+}
+
+expected<data> mmap_backend::keys_with_prefix(const std::string& prefix,
+                                              size_t limit) const {
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  auto collector = make_key_collector(key_prefix_filter(prefix), limit);
+  for (const auto& kvp : impl_->index)
+    collector.add(kvp.first);
+  return std::move(collector).result();
+}
+
+expected<snapshot> mmap_backend::snapshot() const {
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  broker::snapshot result;
+  for (const auto& kvp : impl_->index) {
+    auto value = impl_->value_of(kvp.second);
+    if (!value)
+      return value.error();
+    result.emplace(kvp.first, std::move(*value));
+  }
+  return {std::move(result)};
+}
+
+expected<void> mmap_backend::for_each(const entry_visitor& f) const {
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  for (const auto& kvp : impl_->index) {
+    auto value = impl_->value_of(kvp.second);
+    if (!value)
+      return value.error();
+    if (!f(kvp.first, *value))
+      break;
+  }
+  return {};
+}
+
+expected<expirables> mmap_backend::expiries() const {
+  if (!impl_->ensure_index())
+    return ec::backend_failure;
+  expirables result;
+  for (const auto& kvp : impl_->index)
+    if (kvp.second.expiry)
+      result.emplace_back(kvp.first, *kvp.second.expiry);
+  return {std::move(result)};
+}
+
+} // namespace broker::detail
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+
+#include "broker/backend_options.hh"
+#include "broker/detail/abstract_backend.hh"
+#include "broker/expected.hh"
+
+namespace broker::detail {
+
+/// A persistent storage backend that appends all modifications to a
+/// memory-mapped log file. The backend keeps an in-memory index that maps each
+/// key to the location of its value in the log. Values remain on disk and the
+/// backend decodes them on access.
+class mmap_backend : public abstract_backend {
+public:
+  /// Constructs a memory-mapped backend.
+  /// @param opts The options to create/open a log file.
+  /// Required parameters:
+  ///   - `path`: a `std::string` representing the location of the log file on
+  ///             the filesystem.
+  /// Optional parameters:
+  ///   - `compaction_threshold`: a `broker::count` for the minimum number of
+  ///                             bytes in stale records before `flush`
+  ///                             compacts the log. The backend only compacts
+  ///                             the log if stale records also make up at
+  ///                             least half of the file. Defaults to 64 MiB.
+  /// @note The backend rebuilds its index lazily on first access by scanning
+  ///       the log. Modifications become durable when calling `flush`. Before
+  ///       that, the operating system may lose them on a system crash (but not
+  ///       on a crash of the process).
+  mmap_backend(backend_options opts = backend_options{});
+
+  ~mmap_backend() override;
+
+  bool init_failed() const;
+
+  expected<void> put(const data& key, data value,
+                     std::optional<timestamp> expiry) override;
+
+  expected<void> add(const data& key, const data& value, data::type init_type,
+                     std::optional<timestamp> expiry) override;
+
+  expected<void> subtract(const data& key, const data& value,
+                          std::optional<timestamp> expiry) override;
+
+  expected<void> erase(const data& key) override;
+
+  expected<void> clear() override;
+
+  expected<bool> expire(const data& key, timestamp current_time) override;
+
+  expected<void> flush() override;
+
+  expected<data> get(const data& key) const override;
+
+  expected<bool> exists(const data& key) const override;
+
+  expected<uint64_t> size() const override;
+
+  expected<data> keys() const override;
+
+  expected<data> range(const data& first, const data& last,
+                       size_t limit) const override;
+
+  expected<data> keys_with_prefix(const std::string& prefix,
+                                  size_t limit) const override;
+
+  expected<broker::snapshot> snapshot() const override;
+
+  expected<void> for_each(const entry_visitor& f) const override;
+
+  expected<expirables> expiries() const override;
+
+  /// Rewrites the log to contain only live records.
+  /// @returns `nil` on success.
+  expected<void> compact();
+
+private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
+} // namespace broker::detail
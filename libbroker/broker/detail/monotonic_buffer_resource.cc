@@ -1,8 +1,18 @@
 #include "broker/detail/monotonic_buffer_resource.hh"
 
+#include "broker/config.hh"
+
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
+#include <mutex>
+#include <new>
+
+#ifndef BROKER_WINDOWS
+#  include <sys/mman.h>
+#endif
 
 namespace broker::detail {
 
@@ -13,41 +23,259 @@ namespace {
 // simpler implementation.
 constexpr size_t block_size = 1024;
 
+// Size of a huge page on x86-64 and AArch64 (with 4k base pages).
+constexpr size_t region_size = 2 * 1024 * 1024;
+
+std::atomic<size_t> region_limit;
+
+std::atomic<size_t> region_reserved;
+
+// Maps a region of `region_size` bytes, preferably backed by a huge page.
+// Falls back to asking for transparent huge pages if the system has no huge
+// pages reserved.
+void* map_region() noexcept {
+#ifndef BROKER_WINDOWS
+  constexpr auto prot = PROT_READ | PROT_WRITE;
+  constexpr auto flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#  ifdef MAP_HUGETLB
+  if (auto ptr = mmap(nullptr, region_size, prot, flags | MAP_HUGETLB, -1, 0);
+      ptr != MAP_FAILED)
+    return ptr;
+#  endif
+  // Over-allocate to align the region to the huge page size.
+  auto ptr = mmap(nullptr, 2 * region_size, prot, flags, -1, 0);
+  if (ptr == MAP_FAILED)
+    return nullptr;
+  auto addr = reinterpret_cast<uintptr_t>(ptr);
+  auto first = (addr + region_size - 1) & ~(region_size - 1);
+  if (auto head = first - addr; head > 0)
+    munmap(ptr, head);
+  if (auto tail = addr + 2 * region_size - (first + region_size); tail > 0)
+    munmap(reinterpret_cast<void*>(first + region_size), tail);
+#  ifdef MADV_HUGEPAGE
+  madvise(reinterpret_cast<void*>(first), region_size, MADV_HUGEPAGE);
+#  endif
+  return reinterpret_cast<void*>(first);
+#else
+  return nullptr;
+#endif
+}
+
+void unmap_region(void* ptr) noexcept {
+#ifndef BROKER_WINDOWS
+  munmap(ptr, region_size);
+#endif
+}
+
+} // namespace
+
+// Splits a huge page region into blocks of `block_size` bytes. The thread that
+// mapped the region owns it and allocates from it. Any thread may return
+// blocks to the region. Once the owning thread exits, the last returned block
+// unmaps the region.
+struct huge_page_region {
+  // Overlays the `next` member of the block header for free blocks.
+  struct free_block {
+    free_block* next;
+  };
+
+  explicit huge_page_region(std::byte* base) noexcept : base(base) {
+    for (auto pos = region_size; pos >= block_size; pos -= block_size) {
+      auto node = reinterpret_cast<free_block*>(base + pos - block_size);
+      node->next = free_list;
+      free_list = node;
+    }
+  }
+
+  // Returns a free block or `nullptr`.
+  void* take() noexcept {
+    std::unique_lock guard{mtx};
+    auto result = free_list;
+    if (result != nullptr) {
+      free_list = result->next;
+      ++in_use;
+    }
+    return result;
+  }
+
+  // Returns a block to the free list. Releases the region if the owning
+  // thread has exited and no block remains in use.
+  void put(void* ptr) noexcept {
+    auto node = reinterpret_cast<free_block*>(ptr);
+    std::unique_lock guard{mtx};
+    node->next = free_list;
+    free_list = node;
+    if (--in_use == 0 && orphaned) {
+      guard.unlock();
+      release();
+    }
+  }
+
+  // Called by the owning thread on exit.
+  void orphan() noexcept {
+    std::unique_lock guard{mtx};
+    orphaned = true;
+    if (in_use == 0) {
+      guard.unlock();
+      release();
+    }
+  }
+
+  void release() noexcept {
+    unmap_region(base);
+    region_reserved.fetch_sub(region_size, std::memory_order_relaxed);
+    delete this;
+  }
+
+  std::byte* base;
+
+  std::mutex mtx;
+
+  free_block* free_list = nullptr;
+
+  size_t in_use = 0;
+
+  bool orphaned = false;
+
+  // Links the regions of the owning thread.
+  huge_page_region* next_owned = nullptr;
+};
+
+namespace {
+
+// Caches blocks of `block_size` bytes for re-use by the resources of the same
+// thread. Envelopes create and destroy a resource per message, so recycling
+// their blocks keeps the global allocator out of the hot path.
+class block_pool {
+public:
+  static constexpr size_t max_size = 64;
+
+  ~block_pool() {
+    for (size_t i = 0; i < size_; ++i)
+      free(blocks_[i]);
+    size_ = 0;
+    // Resources on other threads may still use blocks of our regions. In this
+    // case, the last block that goes back to a region releases it.
+    while (regions_ != nullptr) {
+      auto reg = regions_;
+      regions_ = reg->next_owned;
+      reg->orphan();
+    }
+    closed_ = true;
+  }
+
+  // Returns a cached block or `nullptr`. Sets `region` to the huge page region
+  // of the block or to `nullptr` if the caller must `free` the block.
+  void* take(huge_page_region*& region) noexcept {
+    region = nullptr;
+    if (closed_)
+      return nullptr;
+    for (auto reg = regions_; reg != nullptr; reg = reg->next_owned) {
+      if (auto result = reg->take()) {
+        region = reg;
+        return result;
+      }
+    }
+    if (size_ > 0)
+      return blocks_[--size_];
+    if (auto reg = reserve_region()) {
+      region = reg;
+      return reg->take();
+    }
+    return nullptr;
+  }
+
+  bool put(void* ptr) noexcept {
+    // Resources may outlive the pool during thread shutdown.
+    if (closed_ || size_ == max_size)
+      return false;
+    blocks_[size_++] = ptr;
+    return true;
+  }
+
+private:
+  // Maps a new huge page region if the limit allows it.
+  huge_page_region* reserve_region() noexcept {
+    auto limit = region_limit.load(std::memory_order_relaxed);
+    if (limit < region_size)
+      return nullptr;
+    auto cur = region_reserved.load(std::memory_order_relaxed);
+    do {
+      if (cur + region_size > limit)
+        return nullptr;
+    } while (!region_reserved.compare_exchange_weak(cur, cur + region_size,
+                                                    std::memory_order_relaxed));
+    auto base = static_cast<std::byte*>(map_region());
+    auto reg = base != nullptr ? new (std::nothrow) huge_page_region(base)
+                               : nullptr;
+    if (reg == nullptr) {
+      if (base != nullptr)
+        unmap_region(base);
+      region_reserved.fetch_sub(region_size, std::memory_order_relaxed);
+      return nullptr;
+    }
+    reg->next_owned = regions_;
+    regions_ = reg;
+    return reg;
+  }
+
+  void* blocks_[max_size];
+  size_t size_ = 0;
+  huge_page_region* regions_ = nullptr;
+  bool closed_ = false;
+};
+
+thread_local block_pool pool;
+
 } // namespace
 
+void monotonic_buffer_resource::huge_page_pool(size_t bytes) noexcept {
+  region_limit.store(bytes, std::memory_order_relaxed);
+}
+
+size_t monotonic_buffer_resource::huge_page_pool_reserved() noexcept {
+  return region_reserved.load(std::memory_order_relaxed);
+}
+
 void* monotonic_buffer_resource::allocate(size_t num_bytes, size_t alignment) {
-  auto res = std::align(alignment, num_bytes, current_->bytes, remaining_);
+  auto res = std::align(alignment, num_bytes, pos_, remaining_);
   if (res == nullptr) {
-    allocate_block(current_, num_bytes);
-    res = std::align(alignment, num_bytes, current_->bytes, remaining_);
+    allocate_block(num_bytes + alignment);
+    res = std::align(alignment, num_bytes, pos_, remaining_);
     if (res == nullptr)
       throw std::bad_alloc();
   }
-  current_->bytes = static_cast<std::byte*>(res) + num_bytes;
+  pos_ = static_cast<std::byte*>(res) + num_bytes;
   remaining_ -= num_bytes;
   return res;
 }
 
-void monotonic_buffer_resource::allocate_block(block* prev_block,
-                                               size_t min_size) {
-  auto size = std::max(block_size,
-                       min_size + sizeof(block) + sizeof(max_align_t));
-  if (auto vptr = malloc(size)) {
-    current_ = static_cast<block*>(vptr);
-    current_->next = prev_block;
-    current_->bytes = static_cast<std::byte*>(vptr) + sizeof(block);
-    remaining_ = size - sizeof(block);
-  } else {
+void monotonic_buffer_resource::allocate_block(size_t min_size) {
+  auto size = std::max(block_size, min_size + sizeof(block));
+  huge_page_region* region = nullptr;
+  auto vptr = size == block_size ? pool.take(region) : nullptr;
+  if (vptr == nullptr)
+    vptr = malloc(size);
+  if (vptr == nullptr)
     throw std::bad_alloc();
-  }
+  auto blk = static_cast<block*>(vptr);
+  blk->next = blocks_;
+  blk->size = size;
+  blk->region = region;
+  blocks_ = blk;
+  pos_ = static_cast<std::byte*>(vptr) + sizeof(block);
+  remaining_ = size - sizeof(block);
 }
 
 void monotonic_buffer_resource::destroy() noexcept {
-  auto blk = current_;
+  auto blk = blocks_;
   while (blk != nullptr) {
     auto prev = blk;
     blk = blk->next;
-    free(prev);
+    if (prev->region != nullptr)
+      prev->region->put(prev);
+    else if (prev->size != block_size || !pool.put(prev))
+      free(prev);
   }
 }
 
@@ -6,12 +6,20 @@
 
 namespace broker::detail {
 
+struct huge_page_region;
+
 // Drop-in replacement for std::pmr::monotonic_buffer_resource.
 // TODO: drop this class once the PMR API is available on supported platforms.
 class monotonic_buffer_resource {
 public:
-  monotonic_buffer_resource() {
-    allocate_block(nullptr, 0);
+  monotonic_buffer_resource() noexcept = default;
+
+  /// Creates a resource that serves allocations from `buffer` first and only
+  /// allocates additional blocks once `buffer` is exhausted.
+  /// @pre `buffer` outlives the resource.
+  monotonic_buffer_resource(void* buffer, size_t buffer_size) noexcept
+    : pos_(buffer), remaining_(buffer_size) {
+    // nop
   }
 
   monotonic_buffer_resource(const monotonic_buffer_resource&) = delete;
@@ -85,18 +93,38 @@ public:
     monotonic_buffer_resource* mbr_;
   };
 
+  // -- huge page pool ---------------------------------------------------------
+
+  /// Allows the resources of all threads to reserve up to `bytes` in regions
+  /// of 2MB huge pages for their blocks. Resources recycle these blocks by
+  /// returning them to their region, even when releasing them on another
+  /// thread. A region goes back to the system after its owning thread exited
+  /// and all of its blocks returned. The default (0) allocates all blocks via
+  /// `malloc`.
+  static void huge_page_pool(size_t bytes) noexcept;
+
+  /// Returns how many bytes the resources have reserved in huge pages.
+  static size_t huge_page_pool_reserved() noexcept;
+
 private:
   struct block {
     block* next;
-    void* bytes;
+    size_t size;
+    huge_page_region* region; // Owning region or `nullptr` for `malloc`.
   };
 
-  void allocate_block(block* prev_block, size_t min_size);
+  void allocate_block(size_t min_size);
 
   void destroy() noexcept;
 
+  /// Points to the next free byte in the current block or initial buffer.
+  void* pos_ = nullptr;
+
+  /// Stores how many bytes are left at `pos_`.
   size_t remaining_ = 0;
-  block* current_;
+
+  /// Points to the most recently allocated block.
+  block* blocks_ = nullptr;
 };
 
 // Non-standard convenience function to avoid having to implement a drop-in
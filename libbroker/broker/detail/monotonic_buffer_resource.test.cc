@@ -0,0 +1,63 @@
+#include "broker/detail/monotonic_buffer_resource.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace broker;
+
+using detail::monotonic_buffer_resource;
+
+TEST(resources serve allocations from their initial buffer first) {
+  alignas(max_align_t) std::byte buf[64];
+  monotonic_buffer_resource uut{buf, sizeof(buf)};
+  auto ptr = static_cast<std::byte*>(uut.allocate(16));
+  CHECK(ptr >= buf && ptr + 16 <= buf + sizeof(buf));
+  // Exceeding the buffer switches to blocks on the heap.
+  auto ptr2 = static_cast<std::byte*>(uut.allocate(128));
+  CHECK(ptr2 < buf || ptr2 >= buf + sizeof(buf));
+}
+
+TEST(resources recycle blocks from the huge page pool) {
+  // Two regions at most. Note that the pool is process-wide.
+  monotonic_buffer_resource::huge_page_pool(4 * 1024 * 1024);
+  std::vector<std::string> values;
+  for (int round = 0; round < 50; ++round) {
+    monotonic_buffer_resource uut;
+    for (int i = 0; i < 1000; ++i) {
+      auto ptr = static_cast<char*>(uut.allocate(100, 1));
+      memset(ptr, 'a' + round % 26, 100);
+      if (i == 999)
+        values.emplace_back(ptr, 100);
+    }
+  }
+  // Each round needs about 100KB. Without recycling, the rounds would exhaust
+  // the limit of the pool.
+  CHECK_LESS_EQUAL(monotonic_buffer_resource::huge_page_pool_reserved(),
+                   2u * 1024 * 1024);
+  REQUIRE_EQUAL(values.size(), 50u);
+  CHECK_EQUAL(values[49], std::string(100, 'a' + 49 % 26));
+  monotonic_buffer_resource::huge_page_pool(0);
+}
+
+TEST(threads release their huge page regions on exit) {
+  monotonic_buffer_resource::huge_page_pool(4 * 1024 * 1024);
+  auto reserved = monotonic_buffer_resource::huge_page_pool_reserved();
+  std::unique_ptr<monotonic_buffer_resource> uut;
+  std::thread{[&uut] {
+    uut = std::make_unique<monotonic_buffer_resource>();
+    for (int i = 0; i < 100; ++i)
+      memset(uut->allocate(100, 1), 'a', 100);
+  }}.join();
+  // The resource keeps the region of the exited thread alive until it
+  // returns its blocks on this thread.
+  CHECK_LESS_EQUAL(monotonic_buffer_resource::huge_page_pool_reserved(),
+                   reserved + 2 * 1024 * 1024);
+  uut.reset();
+  CHECK_EQUAL(monotonic_buffer_resource::huge_page_pool_reserved(), reserved);
+  monotonic_buffer_resource::huge_page_pool(0);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace broker::detail {
+
+/// A bounded, lock-free ring buffer for multiple producers and a single
+/// consumer. Each cell carries a sequence number that tells producers and the
+/// consumer whether the cell is free or holds a value (Vyukov's bounded queue).
+/// Producers only contend on the tail index and never block each other.
+/// @note The consumer role may move between threads, as long as the threads
+///       synchronize the handover, e.g., via a mutex or an atomic flag.
+template <class T>
+class mpsc_ring {
+public:
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// @param capacity The minimum capacity. The ring rounds it up to the next
+  ///                 power of two.
+  explicit mpsc_ring(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity)
+      size <<= 1;
+    mask_ = size - 1;
+    cells_.reset(new cell[size]);
+    for (size_t index = 0; index < size; ++index)
+      cells_[index].seq.store(index, std::memory_order_relaxed);
+  }
+
+  mpsc_ring(const mpsc_ring&) = delete;
+
+  mpsc_ring& operator=(const mpsc_ring&) = delete;
+
+  // -- properties -------------------------------------------------------------
+
+  size_t capacity() const noexcept {
+    return mask_ + 1;
+  }
+
+  /// Returns whether the consumer may pop a value.
+  /// @note Only the consumer gets a reliable answer.
+  bool has_next() const noexcept {
+    auto pos = head_.load(std::memory_order_relaxed);
+    auto seq = cells_[pos & mask_].seq.load(std::memory_order_acquire);
+    return seq == pos + 1;
+  }
+
+  // -- producer interface -----------------------------------------------------
+
+  /// Tries to append `x` to the ring.
+  /// @returns `false` if the ring is full, `true` otherwise.
+  template <class U>
+  bool try_push(U&& x) {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto& c = cells_[pos & mask_];
+      auto seq = c.seq.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          c.value = std::forward<U>(x);
+          c.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // -- consumer interface -----------------------------------------------------
+
+  /// Tries to move the oldest value of the ring to `x`. Returns `false` if the
+  /// ring is empty or if the producer of the oldest value did not finish
+  /// writing it yet.
+  bool try_pop(T& x) {
+    auto pos = head_.load(std::memory_order_relaxed);
+    auto& c = cells_[pos & mask_];
+    if (c.seq.load(std::memory_order_acquire) != pos + 1)
+      return false;
+    x = std::move(c.value);
+    c.value = T{};
+    c.seq.store(pos + mask_ + 1, std::memory_order_release);
+    head_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+private:
+  struct cell {
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  size_t mask_;
+
+  std::unique_ptr<cell[]> cells_;
+
+  /// Position of the next value for the consumer.
+  alignas(64) std::atomic<size_t> head_{0};
+
+  /// Position of the next free cell for the producers.
+  alignas(64) std::atomic<size_t> tail_{0};
+};
+
+} // namespace broker::detail
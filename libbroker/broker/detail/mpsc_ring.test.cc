@@ -0,0 +1,65 @@
+#include "broker/detail/mpsc_ring.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <thread>
+#include <vector>
+
+using namespace broker;
+
+using ring_type = detail::mpsc_ring<int>;
+
+TEST(the ring rounds its capacity up to a power of two) {
+  CHECK_EQUAL(ring_type{1}.capacity(), 2u);
+  CHECK_EQUAL(ring_type{8}.capacity(), 8u);
+  CHECK_EQUAL(ring_type{100}.capacity(), 128u);
+}
+
+TEST(the ring is a bounded FIFO queue) {
+  ring_type ring{4};
+  int x = 0;
+  CHECK(!ring.has_next());
+  CHECK(!ring.try_pop(x));
+  for (int i = 1; i <= 4; ++i)
+    CHECK(ring.try_push(i));
+  CHECK(!ring.try_push(5));
+  CHECK(ring.has_next());
+  for (int i = 1; i <= 4; ++i) {
+    CHECK(ring.try_pop(x));
+    CHECK_EQUAL(x, i);
+  }
+  CHECK(!ring.try_pop(x));
+  MESSAGE("the ring reuses its cells after a wrap-around");
+  CHECK(ring.try_push(6));
+  CHECK(ring.try_pop(x));
+  CHECK_EQUAL(x, 6);
+}
+
+TEST(multiple producers never lose values) {
+  constexpr int num_producers = 4;
+  constexpr int values_per_producer = 10'000;
+  ring_type ring{64};
+  std::vector<std::thread> producers;
+  for (int id = 0; id < num_producers; ++id)
+    producers.emplace_back([&ring, id] {
+      for (int i = 0; i < values_per_producer; ++i)
+        while (!ring.try_push(id * values_per_producer + i))
+          std::this_thread::yield();
+    });
+  std::vector<int> last(num_producers, -1);
+  int received = 0;
+  bool in_order = true;
+  while (received < num_producers * values_per_producer) {
+    int x = 0;
+    if (ring.try_pop(x)) {
+      auto id = x / values_per_producer;
+      in_order = in_order && x % values_per_producer == last[id] + 1;
+      last[id] = x % values_per_producer;
+      ++received;
+    }
+  }
+  for (auto& hdl : producers)
+    hdl.join();
+  CHECK(in_order);
+  CHECK(!ring.has_next());
+}
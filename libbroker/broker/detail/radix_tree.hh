@@ -46,6 +46,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #ifdef BROKER_USE_SSE2
 #  include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#  include <arm_neon.h>
 #endif
 
 #include <caf/deserializer.hpp>
@@ -251,6 +253,15 @@ public:
    */
   std::deque<iterator> prefix_of(const key_type& data) const;
 
+  /**
+   * Calls `f` with each entry that has a key that is a prefix of the argument.
+   * Unlike `prefix_of`, this function does not allocate any memory.
+   */
+  template <class F>
+  void for_each_prefix_of(const key_type& data, F&& f) const {
+    visit_prefix_leaves(data, [&f](leaf* l) { f(std::as_const(l->kv)); });
+  }
+
   bool operator==(const radix_tree& rhs) const;
 
   bool operator!=(const radix_tree& rhs) const {
@@ -388,7 +399,10 @@ private:
 
   void recursive_add_leaves(node* n, std::deque<iterator>& leaves) const;
 
-  node* add_prefix_leaf(node* n, std::deque<iterator>& leaves) const;
+  static leaf* prefix_leaf(node* n);
+
+  template <class F>
+  void visit_prefix_leaves(const key_type& data, F&& f) const;
 
   size_type num_entries;
   node* root;
@@ -536,16 +550,28 @@ radix_tree<T, N>::prefixed_by(const key_type& prefix) const {
 template <typename T, std::size_t N>
 std::deque<typename radix_tree<T, N>::iterator>
 radix_tree<T, N>::prefix_of(const key_type& data) const {
-  node* n = root;
   std::deque<iterator> rval;
-  int depth = 0;
+  visit_prefix_leaves(data, [this, &rval](leaf* l) {
+    rval.push_back({root, reinterpret_cast<node*>(l)});
+  });
+  return rval;
+}
+
+template <typename T, std::size_t N>
+template <class F>
+void radix_tree<T, N>::visit_prefix_leaves(const key_type& data,
+                                           F&& f) const {
+  node* n = root;
+  size_t depth = 0;
 
   while (n) {
     if (n->type == node::tag::leaf) {
-      if (prefix_matches(data, reinterpret_cast<leaf*>(n)->key()))
-        rval.push_back({root, n});
+      auto l = reinterpret_cast<leaf*>(n);
 
-      return rval;
+      if (prefix_matches(data, l->key()))
+        f(l);
+
+      return;
     }
 
     if (n->partial_len) {
@@ -553,12 +579,22 @@ radix_tree<T, N>::prefix_of(const key_type& data) const {
 
       if (prefix_len != std::min(N, static_cast<size_t>(n->partial_len)))
         // Prefix mismatch.
-        return rval;
+        return;
 
       depth += n->partial_len;
+
+      // The prefix check is optimistic for partials longer than N. Hence, we
+      // may have skipped past the end of the key.
+      if (depth > data.size())
+        return;
     }
 
-    auto leaf = add_prefix_leaf(n, rval);
+    // Leaves in the "null" slot have a key that ends at this node. Since the
+    // prefix check above may be optimistic, we need to compare the full key.
+    auto l = prefix_leaf(n);
+
+    if (l && prefix_matches(data, l->key()))
+      f(l);
 
     auto child = find_child(n, data[depth]).first;
 
@@ -567,13 +603,11 @@ radix_tree<T, N>::prefix_of(const key_type& data) const {
     else
       n = nullptr;
 
-    if (n == leaf)
+    if (l && n == reinterpret_cast<node*>(l))
       break;
 
     ++depth;
   }
-
-  return rval;
 }
 
 template <typename T, std::size_t N>
@@ -662,6 +696,19 @@ radix_tree<T, N>::find_child(node* n, unsigned char c) {
         auto i = __builtin_ctz(bitfield);
         return {&p->children[i], i};
       }
+#elif defined(__ARM_NEON)
+      // Compare the key to all 16 stored keys. NEON has no movemask, so we
+      // narrow each 16-bit lane to 8 bits, which leaves 4 bits per key.
+      uint8x16_t cmp = vceqq_u8(vdupq_n_u8(c), vld1q_u8(p->keys.data()));
+      uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4);
+      uint64_t bitfield = vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+      // Use a mask to ignore children that don't exist
+      if (n->num_children < 16)
+        bitfield &= (uint64_t{1} << (n->num_children * 4)) - 1;
+      if (bitfield) {
+        auto i = __builtin_ctzll(bitfield) / 4;
+        return {&p->children[i], static_cast<uint16_t>(i)};
+      }
 #else
       for (int i = 0; i < n->num_children; ++i)
         if (p->keys[i] == c)
@@ -972,45 +1019,38 @@ void radix_tree<T, N>::recursive_add_leaves(
 }
 
 template <typename T, std::size_t N>
-typename radix_tree<T, N>::node*
-radix_tree<T, N>::add_prefix_leaf(node* n, std::deque<iterator>& leaves) const {
+typename radix_tree<T, N>::leaf* radix_tree<T, N>::prefix_leaf(node* n) {
+  node* child = nullptr;
+
   switch (n->type) {
     case node::tag::leaf:
       return nullptr;
     case node::tag::node4: {
       auto p = reinterpret_cast<node4*>(n);
-      if (n->num_children && p->keys[0] == 0
-          && p->children[0]->type == node::tag::leaf) {
-        leaves.push_back({root, p->children[0]});
-        return p->children[0];
-      }
+      if (n->num_children && p->keys[0] == 0)
+        child = p->children[0];
     } break;
     case node::tag::node16: {
       auto p = reinterpret_cast<node16*>(n);
-      if (n->num_children && p->keys[0] == 0
-          && p->children[0]->type == node::tag::leaf) {
-        leaves.push_back({root, p->children[0]});
-        return p->children[0];
-      }
+      if (n->num_children && p->keys[0] == 0)
+        child = p->children[0];
     } break;
     case node::tag::node48: {
       auto p = reinterpret_cast<node48*>(n);
-      if (p->keys[0] && p->children[p->keys[0] - 1]->type == node::tag::leaf) {
-        leaves.push_back({root, p->children[p->keys[0] - 1]});
-        return p->children[p->keys[0] - 1];
-      }
+      if (p->keys[0])
+        child = p->children[p->keys[0] - 1];
     } break;
     case node::tag::node256: {
       auto p = reinterpret_cast<node256*>(n);
-      if (p->children[0] && p->children[0]->type == node::tag::leaf) {
-        leaves.push_back({root, p->children[0]});
-        return p->children[0];
-      }
+      child = p->children[0];
     } break;
     default:
       abort();
   }
 
+  if (child && child->type == node::tag::leaf)
+    return reinterpret_cast<leaf*>(child);
+
   return nullptr;
 }
 
@@ -6,4 +6,13 @@ sink_driver::~sink_driver() {
   // nop
 }
 
+void sink_driver::on_next_batch(span<const data_message> msgs) {
+  for (const auto& msg : msgs)
+    on_next(msg);
+}
+
+bool sink_driver::batched() const noexcept {
+  return false;
+}
+
 } // namespace broker::detail
@@ -3,6 +3,7 @@
 #include "broker/detail/type_traits.hh"
 #include "broker/error.hh"
 #include "broker/message.hh"
+#include "broker/span.hh"
 
 #include <memory>
 
@@ -30,30 +31,49 @@ struct sink_driver_init_trait<void(State&)> {
 template <class F>
 struct sink_driver_on_next_trait {
   static_assert(always_false_v<F>,
-                "OnNext must have signature 'void (data_message)' "
-                "or 'void (State&, data_message)'");
+                "OnNext must have signature 'void (data_message)', "
+                "'void (span<const data_message>)', "
+                "'void (State&, data_message)' "
+                "or 'void (State&, span<const data_message>)'");
 };
 
 template <>
 struct sink_driver_on_next_trait<void(data_message)> {
   using state_type = void;
+  static constexpr bool batched = false;
 };
 
 template <>
 struct sink_driver_on_next_trait<void(const data_message&)> {
   using state_type = void;
+  static constexpr bool batched = false;
+};
+
+template <>
+struct sink_driver_on_next_trait<void(span<const data_message>)> {
+  using state_type = void;
+  static constexpr bool batched = true;
 };
 
 template <class State>
 struct sink_driver_on_next_trait<void(State&, data_message)> {
   static_assert(!std::is_const_v<State>);
   using state_type = State;
+  static constexpr bool batched = false;
 };
 
 template <class State>
 struct sink_driver_on_next_trait<void(State&, const data_message&)> {
   static_assert(!std::is_const_v<State>);
   using state_type = State;
+  static constexpr bool batched = false;
+};
+
+template <class State>
+struct sink_driver_on_next_trait<void(State&, span<const data_message>)> {
+  static_assert(!std::is_const_v<State>);
+  using state_type = State;
+  static constexpr bool batched = true;
 };
 
 template <class F>
@@ -83,6 +103,14 @@ public:
 
   virtual void on_next(const data_message& msg) = 0;
 
+  /// Delivers all messages that became available at once. The default
+  /// implementation calls `on_next` for each message.
+  virtual void on_next_batch(span<const data_message> msgs);
+
+  /// Returns whether the driver prefers receiving messages via
+  /// `on_next_batch`.
+  virtual bool batched() const noexcept;
+
   virtual void on_cleanup(const error& what) = 0;
 };
 
@@ -122,10 +150,28 @@ public:
   }
 
   void on_next(const data_message& msg) override {
-    if (!completed_)
+    if (completed_)
+      return;
+    if constexpr (on_next_trait::batched)
+      on_next_(state_, span<const data_message>{&msg, 1});
+    else
       on_next_(state_, msg);
   }
 
+  void on_next_batch(span<const data_message> msgs) override {
+    if (completed_)
+      return;
+    if constexpr (on_next_trait::batched)
+      on_next_(state_, msgs);
+    else
+      for (const auto& msg : msgs)
+        on_next_(state_, msg);
+  }
+
+  bool batched() const noexcept override {
+    return on_next_trait::batched;
+  }
+
   void on_cleanup(const error& what) override {
     if (!completed_) {
       cleanup_(state_, what);
@@ -177,10 +223,28 @@ public:
   }
 
   void on_next(const data_message& msg) override {
-    if (!completed_)
+    if (completed_)
+      return;
+    if constexpr (on_next_trait::batched)
+      on_next_(span<const data_message>{&msg, 1});
+    else
       on_next_(msg);
   }
 
+  void on_next_batch(span<const data_message> msgs) override {
+    if (completed_)
+      return;
+    if constexpr (on_next_trait::batched)
+      on_next_(msgs);
+    else
+      for (const auto& msg : msgs)
+        on_next_(msg);
+  }
+
+  bool batched() const noexcept override {
+    return on_next_trait::batched;
+  }
+
   void on_cleanup(const error& what) override {
     if (!completed_) {
       cleanup_(what);
@@ -1,9 +1,23 @@
 #include "broker/detail/source_driver.hh"
 
+#include <algorithm>
+
 namespace broker::detail {
 
 source_driver::~source_driver() {
   // nop
 }
 
+size_t source_driver::pull(span<data_message> buf) {
+  std::deque<data_message> tmp;
+  pull(tmp, buf.size());
+  auto n = std::min(tmp.size(), buf.size());
+  std::move(tmp.begin(), tmp.begin() + n, buf.begin());
+  return n;
+}
+
+bool source_driver::vectorized() const noexcept {
+  return false;
+}
+
 } // namespace broker::detail
@@ -3,8 +3,12 @@
 #include "broker/detail/type_traits.hh"
 #include "broker/error.hh"
 #include "broker/message.hh"
+#include "broker/span.hh"
 
+#include <algorithm>
 #include <deque>
+#include <iterator>
+#include <vector>
 
 namespace broker::detail {
 
@@ -31,13 +35,22 @@ template <class F>
 struct source_driver_pull_trait {
   static_assert(always_false_v<F>,
                 "Pull must have signature "
-                "'void (std::deque<data_message>&, size_t)' or "
-                "'void (State&, std::deque<data_message>&, size_t)'");
+                "'void (std::deque<data_message>&, size_t)', "
+                "'size_t (span<data_message>)', "
+                "'void (State&, std::deque<data_message>&, size_t)' or "
+                "'size_t (State&, span<data_message>)'");
 };
 
 template <>
 struct source_driver_pull_trait<void(std::deque<data_message>&, size_t)> {
   using state_type = void;
+  static constexpr bool vectorized = false;
+};
+
+template <>
+struct source_driver_pull_trait<size_t(span<data_message>)> {
+  using state_type = void;
+  static constexpr bool vectorized = true;
 };
 
 template <class State>
@@ -45,6 +58,14 @@ struct source_driver_pull_trait<void(State&, std::deque<data_message>&,
                                      size_t)> {
   static_assert(!std::is_const_v<State>);
   using state_type = State;
+  static constexpr bool vectorized = false;
+};
+
+template <class State>
+struct source_driver_pull_trait<size_t(State&, span<data_message>)> {
+  static_assert(!std::is_const_v<State>);
+  using state_type = State;
+  static constexpr bool vectorized = true;
 };
 
 template <class F>
@@ -73,6 +94,14 @@ public:
 
   virtual void pull(std::deque<data_message>&, size_t) = 0;
 
+  /// Fills `buf` with up to `buf.size()` messages and returns how many
+  /// messages the driver has written. The default implementation calls the
+  /// other overload and copies the messages.
+  virtual size_t pull(span<data_message> buf);
+
+  /// Returns whether the driver writes directly into the buffer of `pull`.
+  virtual bool vectorized() const noexcept;
+
   virtual bool at_end() = 0;
 };
 
@@ -113,7 +142,24 @@ public:
   }
 
   void pull(std::deque<data_message>& buf, size_t hint) override {
-    pull_(state_, buf, hint);
+    if constexpr (pull_trait::vectorized) {
+      std::vector<data_message> tmp(hint);
+      auto n = pull_(state_, span<data_message>{tmp});
+      std::move(tmp.begin(), tmp.begin() + n, std::back_inserter(buf));
+    } else {
+      pull_(state_, buf, hint);
+    }
+  }
+
+  size_t pull(span<data_message> buf) override {
+    if constexpr (pull_trait::vectorized)
+      return pull_(state_, buf);
+    else
+      return source_driver::pull(buf);
+  }
+
+  bool vectorized() const noexcept override {
+    return pull_trait::vectorized;
   }
 
   bool at_end() override {
@@ -162,7 +208,24 @@ public:
   }
 
   void pull(std::deque<data_message>& buf, size_t hint) override {
-    pull_(buf, hint);
+    if constexpr (pull_trait::vectorized) {
+      std::vector<data_message> tmp(hint);
+      auto n = pull_(span<data_message>{tmp});
+      std::move(tmp.begin(), tmp.begin() + n, std::back_inserter(buf));
+    } else {
+      pull_(buf, hint);
+    }
+  }
+
+  size_t pull(span<data_message> buf) override {
+    if constexpr (pull_trait::vectorized)
+      return pull_(buf);
+    else
+      return source_driver::pull(buf);
+  }
+
+  bool vectorized() const noexcept override {
+    return pull_trait::vectorized;
   }
 
   bool at_end() override {
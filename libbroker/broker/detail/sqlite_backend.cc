@@ -1,5 +1,6 @@
 #include "broker/internal/logger.hh"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdio> // std::snprintf
 #include <optional>
@@ -16,6 +17,8 @@
 #include "broker/detail/appliers.hh"
 #include "broker/detail/assert.hh"
 #include "broker/detail/filesystem.hh"
+#include "broker/detail/key_collector.hh"
+#include "broker/detail/lru_cache.hh"
 #include "broker/detail/sqlite_backend.hh"
 #include "broker/error.hh"
 #include "broker/expected.hh"
@@ -114,6 +117,57 @@ struct sqlite_backend::impl {
       }
     }
 
+    i = options.find("group_commit");
+    if (i != options.end()) {
+      if (auto value = get_if<broker::count>(&i->second)) {
+        group_commit = *value;
+      } else {
+        BROKER_ERROR("SQLite backend option 'group_commit' not a count");
+        return;
+      }
+    }
+
+    i = options.find("read_cache_size");
+    if (i != options.end()) {
+      if (auto value = get_if<broker::count>(&i->second)) {
+        cache.capacity(*value);
+      } else {
+        BROKER_ERROR("SQLite backend option 'read_cache_size' not a count");
+        return;
+      }
+    }
+
+    i = options.find("mmap_size");
+    if (i != options.end()) {
+      if (auto value = get_if<broker::count>(&i->second)) {
+        pragma_mmap_size = std::to_string(*value);
+      } else {
+        BROKER_ERROR("SQLite backend option 'mmap_size' not a count");
+        return;
+      }
+    }
+
+    i = options.find("page_cache_size");
+    if (i != options.end()) {
+      if (auto value = get_if<broker::count>(&i->second)) {
+        // Negative values tell SQLite to interpret the size in KiB.
+        pragma_cache_size = "-" + std::to_string(*value);
+      } else {
+        BROKER_ERROR("SQLite backend option 'page_cache_size' not a count");
+        return;
+      }
+    }
+
+    i = options.find("incremental_vacuum");
+    if (i != options.end()) {
+      if (auto value = get_if<broker::count>(&i->second)) {
+        incremental_vacuum = *value;
+      } else {
+        BROKER_ERROR("SQLite backend option 'incremental_vacuum' not a count");
+        return;
+      }
+    }
+
     i = options.find("path");
     if (i == options.end()) {
       BROKER_ERROR("SQLite backend options are missing required 'path' string");
@@ -130,6 +184,8 @@ struct sqlite_backend::impl {
   ~impl() {
     if (!db)
       return;
+    // Make sure we don't lose any pending modifications.
+    commit_group();
     // Deallocate prepared statements.
     for (auto stmt : finalize)
       sqlite3_finalize(stmt);
@@ -214,6 +270,34 @@ struct sqlite_backend::impl {
         && !exec_pragma("journal_mode", pragma_journal_mode))
       return false;
 
+    if (!pragma_mmap_size.empty()
+        && !exec_pragma("mmap_size", pragma_mmap_size))
+      return false;
+
+    if (!pragma_cache_size.empty()
+        && !exec_pragma("cache_size", pragma_cache_size))
+      return false;
+
+    // Switching an existing database to incremental auto-vacuum only takes
+    // effect after rebuilding it once. For new databases, the VACUUM is a nop.
+    if (incremental_vacuum > 0) {
+      std::vector<std::string> mode;
+      if (!exec_pragma("auto_vacuum", "", &mode))
+        return false;
+      if (mode.size() != 1 || mode[0] != "2") {
+        if (!exec_pragma("auto_vacuum", "INCREMENTAL"))
+          return false;
+        result = sqlite3_exec(db, "vacuum;", nullptr, nullptr, nullptr);
+        if (result != SQLITE_OK) {
+          BROKER_ERROR("failed to enable incremental auto-vacuum"
+                       << sqlite3_errmsg(db));
+          sqlite3_close(db);
+          db = nullptr;
+          return false;
+        }
+      }
+    }
+
     // Create table for store meta data.
     result = sqlite3_exec(db,
                           "create table if not exists "
@@ -236,6 +320,20 @@ struct sqlite_backend::impl {
       db = nullptr;
       return false;
     }
+    // Index keys with an expiration time. Only a fraction of the keys usually
+    // expires, so a partial index keeps the write overhead for all other keys
+    // at zero while allowing the master to load its expiries without scanning
+    // the entire table.
+    result = sqlite3_exec(db,
+                          "create index if not exists store_expiry "
+                          "on store(expiry) where expiry is not null;",
+                          nullptr, nullptr, nullptr);
+    if (result != SQLITE_OK) {
+      BROKER_ERROR("failed to create expiry index" << sqlite3_errmsg(db));
+      sqlite3_close(db);
+      db = nullptr;
+      return false;
+    }
     // Store Broker version in meta table.
     char tmp[128];
     std::snprintf(tmp, sizeof(tmp),
@@ -310,6 +408,8 @@ struct sqlite_backend::impl {
       {&size, "select count(*) from store;"},
       {&snapshot, "select key, value from store;"},
       {&expiries, "select key, expiry from store where expiry is not null;"},
+      {&expiries_between,
+       "select key, expiry from store where expiry >= ? and expiry < ?;"},
       {&clear, "delete from store;"},
       {&keys, "select key from store;"},
     };
@@ -327,6 +427,57 @@ struct sqlite_backend::impl {
     return true;
   }
 
+  // Opens the transaction for group commits if necessary.
+  bool begin_group() {
+    if (group_commit == 0 || in_group)
+      return true;
+    auto result = sqlite3_exec(db, "begin transaction;", nullptr, nullptr,
+                               nullptr);
+    if (result != SQLITE_OK) {
+      BROKER_ERROR("failed to begin transaction:" << sqlite3_errmsg(db));
+      return false;
+    }
+    in_group = true;
+    return true;
+  }
+
+  // Commits the transaction for group commits if it reached its size limit.
+  bool end_write() {
+    if (!in_group)
+      return true;
+    if (++pending < group_commit || in_explicit)
+      return true;
+    return commit_group();
+  }
+
+  // Commits the transaction for group commits if one is open.
+  bool commit_group() {
+    if (!in_group)
+      return true;
+    in_group = false;
+    pending = 0;
+    auto result = sqlite3_exec(db, "commit;", nullptr, nullptr, nullptr);
+    if (result != SQLITE_OK) {
+      BROKER_ERROR("failed to commit transaction:" << sqlite3_errmsg(db));
+      return false;
+    }
+    return true;
+  }
+
+  // Returns up to `incremental_vacuum` free pages to the file system.
+  bool run_incremental_vacuum() {
+    if (incremental_vacuum == 0 || in_group)
+      return true;
+    auto query = "PRAGMA incremental_vacuum("
+                 + std::to_string(incremental_vacuum) + ");";
+    auto result = sqlite3_exec(db, query.c_str(), nullptr, nullptr, nullptr);
+    if (result != SQLITE_OK) {
+      BROKER_ERROR("failed to run incremental vacuum:" << sqlite3_errmsg(db));
+      return false;
+    }
+    return true;
+  }
+
   bool modify(const data& key, const data& value,
               std::optional<timestamp> expiry) {
     auto key_blob = to_blob(key);
@@ -373,13 +524,28 @@ struct sqlite_backend::impl {
   sqlite3_stmt* size = nullptr;
   sqlite3_stmt* snapshot = nullptr;
   sqlite3_stmt* expiries = nullptr;
+  sqlite3_stmt* expiries_between = nullptr;
   sqlite3_stmt* clear = nullptr;
   sqlite3_stmt* keys = nullptr;
   std::vector<sqlite3_stmt*> finalize;
   std::string pragma_synchronous;
   std::string pragma_journal_mode;
+  std::string pragma_mmap_size;
+  std::string pragma_cache_size;
+  // Caches deserialized values of recently read keys (disabled by default).
+  lru_cache<data, data> cache;
   bool delete_corrupt = false;
   bool integrity_check = false;
+  // Maximum number of modifications per transaction (0 = disabled).
+  uint64_t group_commit = 0;
+  // Number of modifications in the currently open transaction.
+  uint64_t pending = 0;
+  // Stores whether we have an open transaction for group commits.
+  bool in_group = false;
+  // Stores whether a caller has grouped modifications explicitly.
+  bool in_explicit = false;
+  // Maximum number of free pages to release per flush (0 = disabled).
+  uint64_t incremental_vacuum = 0;
 };
 
 sqlite_backend::sqlite_backend(backend_options opts)
@@ -400,7 +566,7 @@ bool sqlite_backend::exec_pragma(std::string_view name, std::string_view value,
 
 expected<void> sqlite_backend::put(const data& key, data value,
                                    std::optional<timestamp> expiry) {
-  if (!impl_->db)
+  if (!impl_->db || !impl_->begin_group())
     return ec::backend_failure;
   auto guard = make_statement_guard(impl_->replace);
   // Bind key.
@@ -423,8 +589,10 @@ expected<void> sqlite_backend::put(const data& key, data value,
   if (result != SQLITE_OK)
     return ec::backend_failure;
   // Execute statement.
-  if (sqlite3_step(impl_->replace) != SQLITE_DONE)
+  if (sqlite3_step(impl_->replace) != SQLITE_DONE || !impl_->end_write())
     return ec::backend_failure;
+  if (impl_->cache.contains(key))
+    impl_->cache.put(key, std::move(value));
   return {};
 }
 
@@ -454,13 +622,16 @@ expected<void> sqlite_backend::subtract(const data& key, const data& value,
   auto result = visit(remover{value}, *v);
   if (!result)
     return result;
-  if (!impl_->modify(key, *v, expiry))
+  if (!impl_->begin_group() || !impl_->modify(key, *v, expiry)
+      || !impl_->end_write())
     return ec::backend_failure;
+  if (impl_->cache.contains(key))
+    impl_->cache.put(key, std::move(*v));
   return {};
 }
 
 expected<void> sqlite_backend::erase(const data& key) {
-  if (!impl_->db)
+  if (!impl_->db || !impl_->begin_group())
     return ec::backend_failure;
   auto guard = make_statement_guard(impl_->erase);
   auto key_blob = to_blob(key);
@@ -469,25 +640,27 @@ expected<void> sqlite_backend::erase(const data& key) {
   if (result != SQLITE_OK)
     return ec::backend_failure;
   result = sqlite3_step(impl_->erase);
-  if (result != SQLITE_DONE)
+  if (result != SQLITE_DONE || !impl_->end_write())
     return ec::backend_failure;
+  impl_->cache.erase(key);
   // if (sqlite3_changes(impl_->db) == 0)
   //   return ec::no_such_key;
   return {};
 }
 
 expected<void> sqlite_backend::clear() {
-  if (!impl_->db)
+  if (!impl_->db || !impl_->begin_group())
     return ec::backend_failure;
   auto guard = make_statement_guard(impl_->clear);
   auto result = sqlite3_step(impl_->clear);
-  if (result != SQLITE_DONE)
+  if (result != SQLITE_DONE || !impl_->end_write())
     return ec::backend_failure;
+  impl_->cache.clear();
   return {};
 }
 
 expected<bool> sqlite_backend::expire(const data& key, timestamp ts) {
-  if (!impl_->db)
+  if (!impl_->db || !impl_->begin_group())
     return ec::backend_failure;
   auto guard = make_statement_guard(impl_->expire);
   // Bind key.
@@ -504,12 +677,92 @@ expected<bool> sqlite_backend::expire(const data& key, timestamp ts) {
   result = sqlite3_step(impl_->expire);
   if (result != SQLITE_DONE)
     return ec::backend_failure;
-  return sqlite3_changes(impl_->db) == 1;
+  auto changed = sqlite3_changes(impl_->db) == 1;
+  if (!impl_->end_write())
+    return ec::backend_failure;
+  if (changed)
+    impl_->cache.erase(key);
+  return changed;
+}
+
+expected<void> sqlite_backend::begin_transaction() {
+  if (!impl_->db)
+    return ec::backend_failure;
+  if (impl_->group_commit > 0) {
+    // Let the group transaction include all modifications of the caller.
+    if (!impl_->begin_group())
+      return ec::backend_failure;
+    impl_->in_explicit = true;
+    return {};
+  }
+  auto result = sqlite3_exec(impl_->db, "begin transaction;", nullptr, nullptr,
+                             nullptr);
+  if (result != SQLITE_OK) {
+    BROKER_ERROR("failed to begin transaction:" << sqlite3_errmsg(impl_->db));
+    return ec::backend_failure;
+  }
+  return {};
+}
+
+expected<void> sqlite_backend::commit_transaction() {
+  if (!impl_->db)
+    return ec::backend_failure;
+  if (impl_->group_commit > 0) {
+    impl_->in_explicit = false;
+    if (impl_->pending >= impl_->group_commit && !impl_->commit_group())
+      return ec::backend_failure;
+    return {};
+  }
+  auto result = sqlite3_exec(impl_->db, "commit;", nullptr, nullptr, nullptr);
+  if (result != SQLITE_OK) {
+    BROKER_ERROR("failed to commit transaction:" << sqlite3_errmsg(impl_->db));
+    return ec::backend_failure;
+  }
+  return {};
+}
+
+expected<void> sqlite_backend::abort_transaction() {
+  if (!impl_->db)
+    return ec::backend_failure;
+  impl_->cache.clear();
+  if (impl_->group_commit > 0) {
+    // Rolling back also discards the group, since it includes all
+    // modifications of the caller.
+    impl_->in_explicit = false;
+    if (!impl_->in_group)
+      return {};
+    impl_->in_group = false;
+    impl_->pending = 0;
+  }
+  auto result = sqlite3_exec(impl_->db, "rollback;", nullptr, nullptr,
+                             nullptr);
+  if (result != SQLITE_OK) {
+    BROKER_ERROR("failed to roll back transaction:"
+                 << sqlite3_errmsg(impl_->db));
+    return ec::backend_failure;
+  }
+  return {};
+}
+
+expected<void> sqlite_backend::flush() {
+  if (!impl_->db)
+    return ec::backend_failure;
+  if (!impl_->commit_group() || !impl_->run_incremental_vacuum())
+    return ec::backend_failure;
+  return {};
+}
+
+void sqlite_backend::release_memory() {
+  impl_->cache.clear();
+  if (impl_->db)
+    sqlite3_db_release_memory(impl_->db);
 }
 
 expected<data> sqlite_backend::get(const data& key) const {
   if (!impl_->db)
     return ec::backend_failure;
+  if (auto cached = impl_->cache.get(key))
+    return *cached;
   auto guard = make_statement_guard(impl_->lookup);
   auto key_blob = to_blob(key);
   auto result = sqlite3_bind_blob64(impl_->lookup, 1, key_blob.data(),
@@ -521,8 +774,70 @@ expected<data> sqlite_backend::get(const data& key) const {
     return ec::no_such_key;
   if (result != SQLITE_ROW)
     return ec::backend_failure;
-  return from_blob(sqlite3_column_blob(impl_->lookup, 0),
-                   sqlite3_column_bytes(impl_->lookup, 0));
+  auto value = from_blob(sqlite3_column_blob(impl_->lookup, 0),
+                         sqlite3_column_bytes(impl_->lookup, 0));
+  if (value)
+    impl_->cache.put(key, *value);
+  return value;
+}
+
+expected<data>
+sqlite_backend::get_many(const std::vector<data>& keys) const {
+  if (!impl_->db)
+    return ec::backend_failure;
+  // Stay well below SQLITE_MAX_VARIABLE_NUMBER, which defaults to 999 in
+  // older SQLite versions.
+  constexpr size_t max_chunk_size = 500;
+  table result;
+  // Serve cached values first and only query the database for the rest.
+  std::vector<const data*> misses;
+  misses.reserve(keys.size());
+  for (const auto& key : keys) {
+    if (auto cached = impl_->cache.get(key))
+      result.insert_or_assign(key, *cached);
+    else
+      misses.emplace_back(&key);
+  }
+  std::vector<std::vector<caf::byte>> key_blobs;
+  std::string sql;
+  for (size_t offset = 0; offset < misses.size(); offset += max_chunk_size) {
+    auto n = std::min(max_chunk_size, misses.size() - offset);
+    sql = "select key, value from store where key in (?";
+    for (size_t i = 1; i < n; ++i)
+      sql += ",?";
+    sql += ");";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(impl_->db, sql.c_str(), -1, &stmt, nullptr)
+        != SQLITE_OK) {
+      BROKER_ERROR("failed to prepare statement:" << sql);
+      return ec::backend_failure;
+    }
+    auto guard = caf::detail::make_scope_guard([=] { sqlite3_finalize(stmt); });
+    key_blobs.clear();
+    key_blobs.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+      auto& blob = key_blobs.emplace_back(to_blob(*misses[offset + i]));
+      if (sqlite3_bind_blob64(stmt, static_cast<int>(i + 1), blob.data(),
+                              blob.size(), SQLITE_STATIC)
+          != SQLITE_OK)
+        return ec::backend_failure;
+    }
+    auto res = SQLITE_DONE;
+    while ((res = sqlite3_step(stmt)) == SQLITE_ROW) {
+      auto key = from_blob(sqlite3_column_blob(stmt, 0),
+                           sqlite3_column_bytes(stmt, 0));
+      if (!key)
+        return {key.error()};
+      auto value = from_blob(sqlite3_column_blob(stmt, 1),
+                             sqlite3_column_bytes(stmt, 1));
+      if (!value)
+        return {value.error()};
+      result.insert_or_assign(std::move(*key), std::move(*value));
+    }
+    if (res != SQLITE_DONE)
+      return ec::backend_failure;
+  }
+  return {std::move(result)};
 }
 
 expected<data> sqlite_backend::keys() const {
@@ -543,6 +858,41 @@ expected<data> sqlite_backend::keys() const {
   return ec::backend_failure;
 }
 
+namespace {
+
+// Streams all keys of the database into `collector`.
+template <class Impl, class Collector>
+expected<data> collect_keys(Impl& impl, Collector& collector) {
+  if (!impl.db)
+    return ec::backend_failure;
+  auto guard = make_statement_guard(impl.keys);
+  auto result = SQLITE_DONE;
+  while ((result = sqlite3_step(impl.keys)) == SQLITE_ROW) {
+    if (auto key = from_blob(sqlite3_column_blob(impl.keys, 0),
+                             sqlite3_column_bytes(impl.keys, 0)))
+      collector.add(*key);
+    else
+      return {key.error()};
+  }
+  if (result == SQLITE_DONE)
+    return std::move(collector).result();
+  return ec::backend_failure;
+}
+
+} // namespace
+
+expected<data> sqlite_backend::range(const data& first, const data& last,
+                                     size_t limit) const {
+  auto collector = make_key_collector(key_range_filter(first, last), limit);
+  return collect_keys(*impl_, collector);
+}
+
+expected<data> sqlite_backend::keys_with_prefix(const std::string& prefix,
+                                                size_t limit) const {
+  auto collector = make_key_collector(key_prefix_filter(prefix), limit);
+  return collect_keys(*impl_, collector);
+}
+
 expected<bool> sqlite_backend::exists(const data& key) const {
   if (!impl_->db)
     return ec::backend_failure;
@@ -594,6 +944,28 @@ expected<snapshot> sqlite_backend::snapshot() const {
   return ec::backend_failure;
 }
 
+expected<void> sqlite_backend::for_each(const entry_visitor& f) const {
+  if (!impl_->db)
+    return ec::backend_failure;
+  auto guard = make_statement_guard(impl_->snapshot);
+  auto result = SQLITE_DONE;
+  while ((result = sqlite3_step(impl_->snapshot)) == SQLITE_ROW) {
+    auto key = from_blob(sqlite3_column_blob(impl_->snapshot, 0),
+                         sqlite3_column_bytes(impl_->snapshot, 0));
+    if (!key)
+      return key.error();
+    auto value = from_blob(sqlite3_column_blob(impl_->snapshot, 1),
+                           sqlite3_column_bytes(impl_->snapshot, 1));
+    if (!value)
+      return value.error();
+    if (!f(*key, *value))
+      return {};
+  }
+  if (result == SQLITE_DONE)
+    return {};
+  return ec::backend_failure;
+}
+
 expected<expirables> sqlite_backend::expiries() const {
   if (!impl_->db)
     return ec::backend_failure;
@@ -621,4 +993,31 @@ expected<expirables> sqlite_backend::expiries() const {
   return ec::backend_failure;
 }
 
+expected<expirables> sqlite_backend::expiries_between(timestamp first,
+                                                      timestamp last) const {
+  if (!impl_->db)
+    return ec::backend_failure;
+  auto stmt = impl_->expiries_between;
+  auto guard = make_statement_guard(stmt);
+  auto result = sqlite3_bind_int64(stmt, 1, first.time_since_epoch().count());
+  if (result != SQLITE_OK)
+    return ec::backend_failure;
+  result = sqlite3_bind_int64(stmt, 2, last.time_since_epoch().count());
+  if (result != SQLITE_OK)
+    return ec::backend_failure;
+  expirables rval;
+  while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+    auto key = from_blob(sqlite3_column_blob(stmt, 0),
+                         sqlite3_column_bytes(stmt, 0));
+    if (!key)
+      return {key.error()};
+    auto expiry = timestamp(timespan(sqlite3_column_int64(stmt, 1)));
+    rval.emplace_back(std::move(*key), expiry);
+  }
+  if (result != SQLITE_DONE)
+    return ec::backend_failure;
+  sort_by_expiry(rval);
+  return {std::move(rval)};
+}
+
 } // namespace broker::detail
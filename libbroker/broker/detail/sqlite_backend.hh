@@ -27,6 +27,12 @@ public:
   ///                     fails is acceptable.
   ///   - `integrity_check`: a `broker::boolean` toggling PRAGMA integrity_check
   ///                        execution during initialization.
+  ///   - `group_commit`: a `broker::count` for grouping up to this many
+  ///                     modifications into a single transaction. The backend
+  ///                     commits a transaction when reaching the limit or on
+  ///                     `flush`. Hence, a crash may lose all modifications
+  ///                     since the last commit. Defaults to 0, i.e., each
+  ///                     modification is a transaction of its own.
   sqlite_backend(backend_options opts = backend_options{});
 
   ~sqlite_backend() override;
@@ -48,6 +54,16 @@ public:
 
   expected<bool> expire(const data& key, timestamp current_time) override;
 
+  expected<void> begin_transaction() override;
+
+  expected<void> commit_transaction() override;
+
+  expected<void> abort_transaction() override;
+
+  expected<void> flush() override;
+
+  void release_memory() override;
+
   expected<data> get(const data& key) const override;
 
   expected<bool> exists(const data& key) const override;
@@ -56,10 +72,23 @@ public:
 
   expected<data> keys() const override;
 
+  expected<data> get_many(const std::vector<data>& keys) const override;
+
+  expected<data> range(const data& first, const data& last,
+                       size_t limit) const override;
+
+  expected<data> keys_with_prefix(const std::string& prefix,
+                                  size_t limit) const override;
+
   expected<broker::snapshot> snapshot() const override;
 
+  expected<void> for_each(const entry_visitor& f) const override;
+
   expected<expirables> expiries() const override;
 
+  expected<expirables> expiries_between(timestamp first,
+                                        timestamp last) const override;
+
   /// Run PRAGAMA command with an optional value.
   /// @param name The name of the PRAGMA to run.
   /// @param value An optional value for the PRAGMA.
@@ -2,11 +2,30 @@
 
 #include <memory>
 
+#include "broker/snapshot.hh"
+
 namespace broker::detail {
 
 class store_state {
 public:
   virtual ~store_state();
+
+  /// Returns the most recent content that a clone published for local reads
+  /// or `nullptr` if the clone does not publish its content (or has no master
+  /// at the moment).
+  std::shared_ptr<const snapshot> local_view() const {
+    return std::atomic_load(&local_view_);
+  }
+
+  /// Replaces the content for local reads. Called by the clone actor.
+  void local_view(std::shared_ptr<const snapshot> ptr) {
+    std::atomic_store(&local_view_, std::move(ptr));
+  }
+
+private:
+  /// Immutable copy of the clone content. Readers and the clone actor swap the
+  /// pointer atomically, i.e., readers never observe partial updates.
+  std::shared_ptr<const snapshot> local_view_;
 };
 
 using shared_store_state_ptr = std::shared_ptr<store_state>;
@@ -0,0 +1,208 @@
+#include "broker/detail/subscription_index.hh"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace broker::detail {
+
+namespace {
+
+const filter_type empty_filter;
+
+/// Upper bound for cached lookup results. We simply drop the cache when
+/// reaching this limit.
+constexpr size_t max_cache_size = 4096;
+
+} // namespace
+
+// -- properties ---------------------------------------------------------------
+
+const filter_type&
+subscription_index::filter(handle_type hdl) const noexcept {
+  if (contains(hdl))
+    return filters_[hdl];
+  return empty_filter;
+}
+
+// -- modifiers ----------------------------------------------------------------
+
+subscription_index::handle_type
+subscription_index::add(const filter_type& filter) {
+  handle_type hdl;
+  if (!free_list_.empty()) {
+    hdl = free_list_.back();
+    free_list_.pop_back();
+    active_[hdl] = true;
+  } else {
+    hdl = static_cast<handle_type>(active_.size());
+    active_.push_back(true);
+    filters_.emplace_back();
+    matchers_.emplace_back();
+    has_patterns_.push_back(false);
+  }
+  ++size_;
+  cache_.clear();
+  filters_[hdl] = filter;
+  insert_entries(hdl, filter);
+  refresh_matcher(hdl);
+  return hdl;
+}
+
+void subscription_index::update(handle_type hdl, const filter_type& filter) {
+  if (!contains(hdl))
+    return;
+  cache_.clear();
+  erase_entries(hdl, filters_[hdl], empty_filter);
+  filters_[hdl] = filter;
+  insert_entries(hdl, filter);
+  refresh_matcher(hdl);
+}
+
+void subscription_index::update(handle_type hdl, const filter_delta& delta) {
+  if (!contains(hdl))
+    return;
+  if (delta.is_snapshot()) {
+    update(hdl, delta.added);
+    return;
+  }
+  cache_.clear();
+  filter_apply(filters_[hdl], delta);
+  erase_entries(hdl, delta.removed, filters_[hdl]);
+  insert_entries(hdl, delta.added);
+  refresh_matcher(hdl);
+}
+
+void subscription_index::erase(handle_type hdl) {
+  if (!contains(hdl))
+    return;
+  cache_.clear();
+  erase_entries(hdl, filters_[hdl], empty_filter);
+  filters_[hdl].clear();
+  refresh_matcher(hdl);
+  active_[hdl] = false;
+  free_list_.push_back(hdl);
+  --size_;
+}
+
+std::string_view subscription_index::key_of(const topic& x) noexcept {
+  return topic_matcher::literal_prefix(x.string());
+}
+
+void subscription_index::insert_entries(handle_type hdl,
+                                        const filter_type& filter) {
+  for (const auto& x : filter) {
+    auto& hdls = tree_[key(key_of(x))];
+    auto i = std::lower_bound(hdls.begin(), hdls.end(), hdl);
+    if (i == hdls.end() || *i != hdl)
+      hdls.insert(i, hdl);
+  }
+}
+
+void subscription_index::erase_entries(handle_type hdl,
+                                       const filter_type& filter,
+                                       const filter_type& remaining) {
+  // Patterns share the key of their literal prefix. Hence, we must keep the
+  // entry for a key if one of the remaining topics still maps to it.
+  std::unordered_set<std::string_view> keep;
+  if (!filter.empty())
+    for (const auto& x : remaining)
+      keep.emplace(key_of(x));
+  for (const auto& x : filter) {
+    auto k = key_of(x);
+    if (keep.count(k) > 0)
+      continue;
+    auto i = tree_.find(key(k));
+    if (i == tree_.end())
+      continue;
+    auto& hdls = i->second;
+    auto j = std::lower_bound(hdls.begin(), hdls.end(), hdl);
+    if (j != hdls.end() && *j == hdl)
+      hdls.erase(j);
+    if (hdls.empty())
+      tree_.erase(key(k));
+  }
+}
+
+void subscription_index::refresh_matcher(handle_type hdl) {
+  const auto& filter = filters_[hdl];
+  auto has_patterns = std::any_of(filter.begin(), filter.end(),
+                                  [](const topic& x) {
+                                    return topic_matcher::is_pattern(
+                                      x.string());
+                                  });
+  if (has_patterns_[hdl] != has_patterns) {
+    has_patterns_[hdl] = has_patterns;
+    if (has_patterns)
+      ++num_pattern_handles_;
+    else
+      --num_pattern_handles_;
+  }
+  matchers_[hdl] = has_patterns ? topic_matcher{filter} : topic_matcher{};
+}
+
+// -- lookups ------------------------------------------------------------------
+
+void subscription_index::match(std::string_view topic,
+                               handle_list& result) const {
+  result.clear();
+  size_t num_lists = 0;
+  tree_.for_each_prefix_of(key(topic), [&](const auto& kvp) {
+    const auto& hdls = kvp.second;
+    result.insert(result.end(), hdls.begin(), hdls.end());
+    ++num_lists;
+  });
+  // Each list is sorted and unique. Hence, we only need to normalize the result
+  // when merging more than one list.
+  if (num_lists > 1) {
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+  }
+  // The tree only knows the literal prefixes of patterns. Hence, we need to
+  // double-check subscribers with patterns in their filter.
+  if (num_pattern_handles_ > 0) {
+    auto mismatch = [this, topic](handle_type hdl) {
+      return !verify(hdl, topic);
+    };
+    result.erase(std::remove_if(result.begin(), result.end(), mismatch),
+                 result.end());
+  }
+}
+
+const subscription_index::handle_list&
+subscription_index::match_cached(std::string_view topic) {
+  if (auto i = cache_.find(key(topic)); i != cache_.end())
+    return i->second;
+  if (cache_.size() >= max_cache_size)
+    cache_.clear();
+  auto& result = cache_[std::string{topic}];
+  match(topic, result);
+  return result;
+}
+
+bool subscription_index::has_match(std::string_view topic) const {
+  auto result = false;
+  tree_.for_each_prefix_of(key(topic), [this, topic, &result](const auto& kvp) {
+    if (result)
+      return;
+    for (auto hdl : kvp.second) {
+      if (verify(hdl, topic)) {
+        result = true;
+        return;
+      }
+    }
+  });
+  return result;
+}
+
+bool subscription_index::matches(handle_type hdl,
+                                 std::string_view topic) const {
+  auto result = false;
+  tree_.for_each_prefix_of(key(topic), [hdl, &result](const auto& kvp) {
+    const auto& hdls = kvp.second;
+    if (std::binary_search(hdls.begin(), hdls.end(), hdl))
+      result = true;
+  });
+  return result && verify(hdl, topic);
+}
+
+} // namespace broker::detail
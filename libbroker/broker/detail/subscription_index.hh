@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "broker/detail/radix_tree.hh"
+#include "broker/detail/topic_matcher.hh"
+#include "broker/filter_type.hh"
+
+namespace broker::detail {
+
+/// Maps topic prefixes to the set of subscribers that are interested in them.
+/// Instead of scanning one `filter_type` per subscriber, a single walk through
+/// the radix tree yields all subscribers for a topic. Filters may contain
+/// patterns (see @ref topic_matcher), which the index stores under their
+/// literal prefix and verifies on lookup.
+class subscription_index {
+public:
+  // -- member types -----------------------------------------------------------
+
+  /// Opaque handle for a subscriber. Handles are small integers and the index
+  /// re-uses handles of erased subscribers.
+  using handle_type = uint32_t;
+
+  /// A sorted list of subscriber handles.
+  using handle_list = std::vector<handle_type>;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  subscription_index() = default;
+
+  subscription_index(const subscription_index&) = delete;
+
+  subscription_index& operator=(const subscription_index&) = delete;
+
+  // -- properties -------------------------------------------------------------
+
+  /// Returns the number of subscribers in the index.
+  size_t size() const noexcept {
+    return size_;
+  }
+
+  /// Returns whether the index contains no subscribers.
+  bool empty() const noexcept {
+    return size_ == 0;
+  }
+
+  /// Returns whether `hdl` refers to a subscriber in the index.
+  bool contains(handle_type hdl) const noexcept {
+    return hdl < active_.size() && active_[hdl];
+  }
+
+  /// Returns the filter of `hdl` or an empty filter if `hdl` is unknown.
+  const filter_type& filter(handle_type hdl) const noexcept;
+
+  /// Returns one past the largest handle currently in use.
+  handle_type max_handle() const noexcept {
+    return static_cast<handle_type>(active_.size());
+  }
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Adds a new subscriber with given filter to the index.
+  /// @returns the handle for the new subscriber.
+  handle_type add(const filter_type& filter);
+
+  /// Replaces the filter of the subscriber `hdl`.
+  /// @pre `contains(hdl)`
+  void update(handle_type hdl, const filter_type& filter);
+
+  /// Applies an incremental change to the filter of the subscriber `hdl`. Only
+  /// touches the entries for the topics in `delta`, unless `delta` is a full
+  /// snapshot.
+  /// @pre `contains(hdl)`
+  void update(handle_type hdl, const filter_delta& delta);
+
+  /// Removes the subscriber `hdl` from the index.
+  void erase(handle_type hdl);
+
+  // -- lookups ----------------------------------------------------------------
+
+  /// Stores the handles of all subscribers that have at least one prefix of
+  /// `topic` in their filter to `result`. The handles are sorted and unique.
+  void match(std::string_view topic, handle_list& result) const;
+
+  /// Convenience function for calling `match` with a new list.
+  handle_list match(std::string_view topic) const {
+    handle_list result;
+    match(topic, result);
+    return result;
+  }
+
+  /// Like `match`, but caches the result for `topic` until the next change to
+  /// the index. The cache holds up to a fixed number of topics.
+  const handle_list& match_cached(std::string_view topic);
+
+  /// Returns whether at least one subscriber has a prefix of `topic` in its
+  /// filter.
+  bool has_match(std::string_view topic) const;
+
+  /// Returns whether the subscriber `hdl` has a prefix of `topic` in its
+  /// filter.
+  bool matches(handle_type hdl, std::string_view topic) const;
+
+private:
+  /// Returns the key in the tree for a filter entry, i.e., the literal prefix
+  /// for patterns and the entry itself for regular topics.
+  static std::string_view key_of(const topic& x) noexcept;
+
+  void insert_entries(handle_type hdl, const filter_type& filter);
+
+  /// Removes the entries of `hdl` for the topics in `filter`, except for keys
+  /// that are still required by a topic in `remaining`.
+  void erase_entries(handle_type hdl, const filter_type& filter,
+                     const filter_type& remaining);
+
+  /// Re-compiles the matcher for `hdl` after changing its filter.
+  void refresh_matcher(handle_type hdl);
+
+  /// Checks whether `topic` matches the patterns of `hdl`. Always returns
+  /// `true` for subscribers without patterns.
+  bool verify(handle_type hdl, std::string_view topic) const noexcept {
+    return !has_patterns_[hdl] || matchers_[hdl](topic);
+  }
+
+  /// Converts `str` to the key type of the tree.
+  const std::string& key(std::string_view str) const {
+    key_buf_.assign(str.data(), str.size());
+    return key_buf_;
+  }
+
+  /// Maps subscribed prefixes to the sorted handles of their subscribers.
+  radix_tree<handle_list> tree_;
+
+  /// Stores the filter for each handle.
+  std::vector<filter_type> filters_;
+
+  /// Stores whether a handle is currently in use.
+  std::vector<bool> active_;
+
+  /// Stores compiled matchers for filters with patterns.
+  std::vector<topic_matcher> matchers_;
+
+  /// Stores whether the filter of a handle contains patterns.
+  std::vector<bool> has_patterns_;
+
+  /// Stores how many handles have patterns in their filter.
+  size_t num_pattern_handles_ = 0;
+
+  /// Stores handles of erased subscribers for re-use.
+  handle_list free_list_;
+
+  /// Stores the number of subscribers.
+  size_t size_ = 0;
+
+  /// Caches the results of `match_cached` by topic.
+  std::unordered_map<std::string, handle_list> cache_;
+
+  /// Re-used buffer for converting a topic to the key type of the tree.
+  mutable std::string key_buf_;
+};
+
+} // namespace broker::detail
@@ -0,0 +1,126 @@
+#include "broker/detail/subscription_index.hh"
+
+#include "broker/broker-test.test.hh"
+
+using namespace broker;
+
+namespace {
+
+using handle_list = detail::subscription_index::handle_list;
+
+struct fixture {
+  detail::subscription_index uut;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(subscription_index_tests, fixture)
+
+TEST(an empty index has no matches) {
+  CHECK(uut.empty());
+  CHECK(uut.match("/foo/bar").empty());
+  CHECK(!uut.has_match("/foo/bar"));
+}
+
+TEST(the index returns all subscribers with a matching prefix) {
+  auto a = uut.add(filter_type{"/foo", "/bar"});
+  auto b = uut.add(filter_type{"/foo/bar", "/baz"});
+  auto c = uut.add(filter_type{"/zeek"});
+  CHECK_EQUAL(uut.size(), 3u);
+  CHECK_EQUAL(uut.match("/foo/bar/baz"), handle_list({a, b}));
+  CHECK_EQUAL(uut.match("/foo/baz"), handle_list({a}));
+  CHECK_EQUAL(uut.match("/baz"), handle_list({b}));
+  CHECK_EQUAL(uut.match("/zeek/event"), handle_list({c}));
+  CHECK(uut.match("/fo").empty());
+  CHECK(uut.matches(a, "/bar"));
+  CHECK(!uut.matches(b, "/bar"));
+  CHECK(uut.has_match("/zeek"));
+  CHECK(!uut.has_match("/zee"));
+}
+
+TEST(long common prefixes only match on the full key) {
+  auto a = uut.add(filter_type{"zeek/event/long"});
+  uut.add(filter_type{"zeek/event/long/prefix/a"});
+  uut.add(filter_type{"zeek/event/long/prefix/b"});
+  CHECK(uut.match("zeek/event/lonx").empty());
+  CHECK_EQUAL(uut.match("zeek/event/long/prefix/c"), handle_list({a}));
+}
+
+TEST(updating a filter replaces all previous entries) {
+  auto a = uut.add(filter_type{"/foo", "/bar"});
+  auto b = uut.add(filter_type{"/foo"});
+  uut.update(a, filter_type{"/bar/baz"});
+  CHECK_EQUAL(uut.match("/foo"), handle_list({b}));
+  CHECK(uut.match("/bar").empty());
+  CHECK_EQUAL(uut.match("/bar/baz"), handle_list({a}));
+  CHECK_EQUAL(uut.filter(a), filter_type{"/bar/baz"});
+}
+
+TEST(applying a delta only changes the affected entries) {
+  auto a = uut.add(filter_type{"/bar", "/foo"});
+  auto b = uut.add(filter_type{"/foo"});
+  auto delta = filter_delta{lamport_timestamp{1}, lamport_timestamp{2},
+                            filter_type{"/baz"}, filter_type{"/foo"}};
+  uut.update(a, delta);
+  CHECK_EQUAL(uut.match("/foo"), handle_list({b}));
+  CHECK_EQUAL(uut.match("/bar"), handle_list({a}));
+  CHECK_EQUAL(uut.match("/baz"), handle_list({a}));
+  auto expected = filter_type{"/bar", "/baz"};
+  CHECK_EQUAL(uut.filter(a), expected);
+  uut.update(a, filter_delta::make_snapshot(lamport_timestamp{3},
+                                            filter_type{"/zeek"}));
+  CHECK(uut.match("/bar").empty());
+  CHECK_EQUAL(uut.match("/zeek"), handle_list({a}));
+}
+
+TEST(erased handles no longer match and get re-used) {
+  auto a = uut.add(filter_type{"/foo"});
+  auto b = uut.add(filter_type{"/foo"});
+  uut.erase(a);
+  CHECK(!uut.contains(a));
+  CHECK(uut.filter(a).empty());
+  CHECK_EQUAL(uut.match("/foo"), handle_list({b}));
+  auto c = uut.add(filter_type{"/bar"});
+  CHECK_EQUAL(c, a);
+  CHECK_EQUAL(uut.match("/foo"), handle_list({b}));
+  CHECK_EQUAL(uut.match("/bar"), handle_list({c}));
+  CHECK_EQUAL(uut.size(), 2u);
+}
+
+TEST(patterns only match topics with matching segments) {
+  auto a = uut.add(filter_type{"zeek/*/logs"});
+  auto b = uut.add(filter_type{"zeek/"});
+  CHECK_EQUAL(uut.match("zeek/worker-1/logs"), handle_list({a, b}));
+  CHECK_EQUAL(uut.match("zeek/worker-1/events"), handle_list({b}));
+  CHECK(uut.matches(a, "zeek/worker-1/logs/conn"));
+  CHECK(!uut.matches(a, "zeek/worker-1/events"));
+  uut.erase(b);
+  CHECK(!uut.has_match("zeek/worker-1/events"));
+  CHECK(uut.has_match("zeek/worker-1/logs"));
+}
+
+TEST(removing one of several patterns keeps the shared prefix) {
+  auto a = uut.add(filter_type{"zeek/*/events", "zeek/*/logs"});
+  auto delta = filter_delta{lamport_timestamp{1}, lamport_timestamp{2},
+                            filter_type{}, filter_type{"zeek/*/events"}};
+  uut.update(a, delta);
+  CHECK_EQUAL(uut.match("zeek/x/logs"), handle_list({a}));
+  CHECK(uut.match("zeek/x/events").empty());
+}
+
+TEST(cached lookups reflect changes to the index) {
+  auto a = uut.add(filter_type{"/foo"});
+  CHECK_EQUAL(uut.match_cached("/foo/bar"), handle_list({a}));
+  auto b = uut.add(filter_type{"/foo/bar"});
+  CHECK_EQUAL(uut.match_cached("/foo/bar"), handle_list({a, b}));
+  uut.erase(a);
+  CHECK_EQUAL(uut.match_cached("/foo/bar"), handle_list({b}));
+}
+
+TEST(an empty topic in the filter matches everything) {
+  auto a = uut.add(filter_type{""});
+  CHECK_EQUAL(uut.match("/foo"), handle_list({a}));
+  CHECK_EQUAL(uut.match(""), handle_list({a}));
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,35 @@
+#include "broker/detail/thread_affinity.hh"
+
+#include "broker/config.hh"
+
+#ifdef BROKER_LINUX
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+
+namespace broker::detail {
+
+#ifdef BROKER_LINUX
+
+bool set_thread_affinity(const std::vector<size_t>& cpus) {
+  if (cpus.empty())
+    return true;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    if (cpu >= CPU_SETSIZE)
+      return false;
+    CPU_SET(cpu, &set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+#else
+
+bool set_thread_affinity(const std::vector<size_t>& cpus) {
+  return cpus.empty();
+}
+
+#endif
+
+} // namespace broker::detail
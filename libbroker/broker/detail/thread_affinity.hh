@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace broker::detail {
+
+/// Restricts the calling thread to the CPUs in `cpus`. An empty list leaves
+/// the thread unchanged.
+/// @returns `true` on success, `false` if the platform does not support
+///          pinning threads or if the operating system rejected the CPU set.
+bool set_thread_affinity(const std::vector<size_t>& cpus);
+
+} // namespace broker::detail
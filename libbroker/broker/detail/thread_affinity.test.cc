@@ -0,0 +1,44 @@
+#include "broker/detail/thread_affinity.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include "broker/config.hh"
+
+#include <thread>
+
+#ifdef BROKER_LINUX
+#  include <sched.h>
+#endif
+
+using namespace broker;
+
+TEST(an empty CPU set leaves the thread unchanged) {
+  CHECK(detail::set_thread_affinity({}));
+}
+
+#ifdef BROKER_LINUX
+
+TEST(threads may pin themselves to a CPU) {
+  // Note: the test framework isn't thread-safe, so we only check the results
+  //       after joining the thread.
+  int before = -1;
+  int after = -1;
+  bool pinned = false;
+  std::thread t{[&] {
+    before = sched_getcpu();
+    if (before >= 0) {
+      pinned = detail::set_thread_affinity({static_cast<size_t>(before)});
+      after = sched_getcpu();
+    }
+  }};
+  t.join();
+  REQUIRE_GREATER_EQUAL(before, 0);
+  CHECK(pinned);
+  CHECK_EQUAL(after, before);
+}
+
+TEST(pinning fails for CPUs beyond the supported range) {
+  CHECK(!detail::set_thread_affinity({size_t{CPU_SETSIZE}}));
+}
+
+#endif
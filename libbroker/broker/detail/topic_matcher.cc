@@ -0,0 +1,132 @@
+#include "broker/detail/topic_matcher.hh"
+
+#include <algorithm>
+
+namespace broker::detail {
+
+namespace {
+
+// Iterates the segments of a topic without allocating memory.
+struct segment_cursor {
+  std::string_view rest;
+  bool at_end = false;
+
+  segment_cursor next(std::string_view& segment) const noexcept {
+    if (auto pos = rest.find(topic::sep); pos != std::string_view::npos) {
+      segment = rest.substr(0, pos);
+      return {rest.substr(pos + 1), false};
+    }
+    segment = rest;
+    return {std::string_view{}, true};
+  }
+};
+
+bool match_segments(segment_cursor pattern, segment_cursor pos) noexcept {
+  if (pattern.at_end)
+    return true;
+  std::string_view expected;
+  auto next_pattern = pattern.next(expected);
+  if (expected == topic_matcher::multi_wildcard) {
+    for (;;) {
+      if (match_segments(next_pattern, pos))
+        return true;
+      if (pos.at_end)
+        return false;
+      std::string_view unused;
+      pos = pos.next(unused);
+    }
+  }
+  if (pos.at_end)
+    return false;
+  std::string_view segment;
+  auto next = pos.next(segment);
+  if (expected == topic_matcher::single_wildcard)
+    return match_segments(next_pattern, next);
+  auto matched = next_pattern.at_end ? topic::is_prefix(segment, expected)
+                                     : segment == expected;
+  return matched && match_segments(next_pattern, next);
+}
+
+bool is_wildcard(std::string_view segment) noexcept {
+  return segment == topic_matcher::single_wildcard
+         || segment == topic_matcher::multi_wildcard;
+}
+
+template <class F>
+void for_each_segment(std::string_view str, F f) {
+  segment_cursor pos{str, false};
+  while (!pos.at_end) {
+    std::string_view segment;
+    auto next = pos.next(segment);
+    if (!f(segment))
+      return;
+    pos = next;
+  }
+}
+
+} // namespace
+
+topic_matcher::topic_matcher(const filter_type& filter) {
+  for (const auto& entry : filter) {
+    const auto& str = entry.string();
+    if (is_pattern(str))
+      patterns_.emplace_back(str);
+    else
+      prefixes_.emplace_back(str);
+  }
+}
+
+bool topic_matcher::operator()(std::string_view str) const noexcept {
+  for (const auto& prefix : prefixes_)
+    if (topic::is_prefix(str, prefix))
+      return true;
+  for (const auto& pattern : patterns_)
+    if (match_segments(segment_cursor{pattern}, segment_cursor{str}))
+      return true;
+  return false;
+}
+
+bool topic_matcher::is_pattern(std::string_view entry) noexcept {
+  // Quick check to avoid splitting regular topics.
+  if (entry.find('*') == std::string_view::npos)
+    return false;
+  auto result = false;
+  for_each_segment(entry, [&result](std::string_view segment) {
+    result = is_wildcard(segment);
+    return !result;
+  });
+  return result;
+}
+
+std::string_view
+topic_matcher::literal_prefix(std::string_view entry) noexcept {
+  size_t offset = 0;
+  auto found = false;
+  for_each_segment(entry, [&](std::string_view segment) {
+    if (is_wildcard(segment)) {
+      found = true;
+      return false;
+    }
+    offset += segment.size() + 1;
+    return true;
+  });
+  if (!found)
+    return entry;
+  return entry.substr(0, offset);
+}
+
+bool topic_matcher::matches(std::string_view entry,
+                            std::string_view str) noexcept {
+  if (!is_pattern(entry))
+    return topic::is_prefix(str, entry);
+  return match_segments(segment_cursor{entry}, segment_cursor{str});
+}
+
+bool topic_matcher::matches(const filter_type& filter,
+                            std::string_view str) noexcept {
+  return std::any_of(filter.begin(), filter.end(), [str](const topic& x) {
+    return matches(std::string_view{x.string()}, str);
+  });
+}
+
+} // namespace broker::detail
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "broker/filter_type.hh"
+#include "broker/topic.hh"
+
+namespace broker::detail {
+
+/// Matches topics against a filter with optional wildcard segments. An entry
+/// without wildcards is a regular prefix match. Otherwise, the entry is a
+/// pattern of segments separated by `topic::sep` and:
+/// - a segment `*` matches exactly one segment of the topic;
+/// - a segment `**` matches any number of segments, including none;
+/// - any other segment must equal the corresponding segment of the topic,
+///    except for the last segment, which only needs to be a prefix (in line
+///    with regular prefix matching).
+/// A topic may have more segments than the pattern. For example, `zeek/*/logs`
+/// matches `zeek/worker-1/logs` and `zeek/worker-1/logs/conn`.
+///
+/// Constructing a matcher from a filter sorts the entries into plain prefixes
+/// and patterns once. Matching never allocates memory.
+class topic_matcher {
+public:
+  // -- constants --------------------------------------------------------------
+
+  /// Matches exactly one segment.
+  static constexpr std::string_view single_wildcard = "*";
+
+  /// Matches any number of segments.
+  static constexpr std::string_view multi_wildcard = "**";
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  topic_matcher() = default;
+
+  explicit topic_matcher(const filter_type& filter);
+
+  topic_matcher(const topic_matcher&) = default;
+
+  topic_matcher(topic_matcher&&) noexcept = default;
+
+  topic_matcher& operator=(const topic_matcher&) = default;
+
+  topic_matcher& operator=(topic_matcher&&) noexcept = default;
+
+  // -- matching ---------------------------------------------------------------
+
+  /// Returns whether `str` matches at least one entry of the filter.
+  bool operator()(std::string_view str) const noexcept;
+
+  bool operator()(const char* str) const noexcept {
+    return (*this)(std::string_view{str});
+  }
+
+  bool operator()(const topic& x) const noexcept {
+    return (*this)(std::string_view{x.string()});
+  }
+
+  template <class T, class = std::enable_if_t<
+                       !std::is_convertible_v<const T&, std::string_view>>>
+  bool operator()(const T& x) const noexcept {
+    return (*this)(get_topic(x));
+  }
+
+  // -- utility functions ------------------------------------------------------
+
+  /// Returns whether `entry` contains at least one wildcard segment.
+  static bool is_pattern(std::string_view entry) noexcept;
+
+  /// Returns the part of `entry` before its first wildcard segment. Peers only
+  /// support prefix matching. Hence, we subscribe to the literal prefix of a
+  /// pattern at our peers and filter locally.
+  static std::string_view literal_prefix(std::string_view entry) noexcept;
+
+  /// Returns whether `str` matches `entry`.
+  static bool matches(std::string_view entry, std::string_view str) noexcept;
+
+  /// Returns whether `str` matches at least one entry in `filter`. Prefer a
+  /// matcher object when evaluating the same filter repeatedly.
+  static bool matches(const filter_type& filter, std::string_view str) noexcept;
+
+  /// Convenience function for calling `matches` with the topic of `x`.
+  template <class T, class = std::enable_if_t<
+                       !std::is_convertible_v<const T&, std::string_view>>>
+  static bool matches(const filter_type& filter, const T& x) noexcept {
+    return matches(filter, get_topic(x));
+  }
+
+private:
+  /// Entries without wildcards.
+  std::vector<std::string> prefixes_;
+
+  /// Entries with wildcards.
+  std::vector<std::string> patterns_;
+};
+
+} // namespace broker::detail
@@ -0,0 +1,54 @@
+#include "broker/detail/topic_matcher.hh"
+
+#include "broker/broker-test.test.hh"
+
+using namespace broker;
+
+using detail::topic_matcher;
+
+TEST(entries without wildcards are prefix matches) {
+  topic_matcher uut{filter_type{"zeek/events", "/foo"}};
+  CHECK(uut("zeek/events"));
+  CHECK(uut("zeek/events/foo"));
+  CHECK(uut("/foo/bar"));
+  CHECK(!uut("zeek/logs"));
+  CHECK(!topic_matcher::is_pattern("zeek/events"));
+  CHECK(!topic_matcher::is_pattern("zeek/ev*"));
+}
+
+TEST(single wildcards match exactly one segment) {
+  topic_matcher uut{filter_type{"zeek/*/logs"}};
+  CHECK(uut("zeek/worker-1/logs"));
+  CHECK(uut("zeek/worker-1/logs/conn"));
+  CHECK(!uut("zeek/logs"));
+  CHECK(!uut("zeek/worker-1/events"));
+  CHECK(!uut("zeek/a/b/logs"));
+}
+
+TEST(multi wildcards match any number of segments) {
+  topic_matcher uut{filter_type{"zeek/**/logs"}};
+  CHECK(uut("zeek/logs"));
+  CHECK(uut("zeek/a/logs"));
+  CHECK(uut("zeek/a/b/c/logs/conn"));
+  CHECK(!uut("zeek/a/b/events"));
+  CHECK(!uut("bro/a/logs"));
+}
+
+TEST(the last literal segment of a pattern is a prefix match) {
+  CHECK(topic_matcher::matches("zeek/*/lo", "zeek/a/logs"));
+  CHECK(!topic_matcher::matches("zeek/*/lo/x", "zeek/a/logs/x"));
+}
+
+TEST(literal prefixes stop at the first wildcard) {
+  CHECK_EQUAL(topic_matcher::literal_prefix("zeek/*/logs"), "zeek/");
+  CHECK_EQUAL(topic_matcher::literal_prefix("/zeek/**"), "/zeek/");
+  CHECK_EQUAL(topic_matcher::literal_prefix("**"), "");
+  CHECK_EQUAL(topic_matcher::literal_prefix("zeek/logs"), "zeek/logs");
+}
+
+TEST(filters can mix patterns and prefixes) {
+  auto filter = filter_type{"zeek/*/logs", "/foo"};
+  CHECK(topic_matcher::matches(filter, "zeek/a/logs"));
+  CHECK(topic_matcher::matches(filter, "/foo/bar"));
+  CHECK(!topic_matcher::matches(filter, "zeek/a/events"));
+}
@@ -4,6 +4,8 @@
 #include "broker/defaults.hh"
 #include "broker/detail/die.hh"
 #include "broker/detail/filesystem.hh"
+#include "broker/detail/thread_affinity.hh"
+#include "broker/format/bin.hh"
 #include "broker/internal/configuration_access.hh"
 #include "broker/internal/core_actor.hh"
 #include "broker/internal/endpoint_access.hh"
@@ -12,6 +14,8 @@
 #include "broker/internal/logger.hh"
 #include "broker/internal/metric_exporter.hh"
 #include "broker/internal/prometheus.hh"
+#include "broker/internal/publish_credit.hh"
+#include "broker/internal/topic_log.hh"
 #include "broker/internal/type_id.hh"
 #include "broker/internal/web_socket.hh"
 #include "broker/port.hh"
@@ -56,8 +60,10 @@
 #include "broker/subscriber.hh"
 #include "broker/timeout.hh"
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <thread>
 
 #ifdef BROKER_WINDOWS
@@ -359,19 +365,19 @@ using string_list = std::vector<std::string>;
 
 void endpoint::metrics_exporter_t::set_interval(caf::timespan new_interval) {
   if (new_interval.count() > 0)
-    caf::anon_send(native(parent_->telemetry_exporter_), atom::put_v,
+    caf::anon_send(native(parent_->metric_exporter()), atom::put_v,
                    new_interval);
 }
 
 void endpoint::metrics_exporter_t::set_target(topic new_target) {
   if (!new_target.empty())
-    caf::anon_send(native(parent_->telemetry_exporter_), atom::put_v,
+    caf::anon_send(native(parent_->metric_exporter()), atom::put_v,
                    std::move(new_target));
 }
 
 void endpoint::metrics_exporter_t::set_id(std::string new_id) {
   if (!new_id.empty())
-    caf::anon_send(native(parent_->telemetry_exporter_), atom::put_v,
+    caf::anon_send(native(parent_->metric_exporter()), atom::put_v,
                    std::move(new_id));
 }
 
@@ -382,7 +388,7 @@ void endpoint::metrics_exporter_t::set_prefixes(string_list new_prefixes) {
   filter_type boxed;
   for (auto& str : new_prefixes)
     boxed.emplace_back(std::move(str));
-  caf::anon_send(native(parent_->telemetry_exporter_), atom::put_v,
+  caf::anon_send(native(parent_->metric_exporter()), atom::put_v,
                  std::move(boxed));
 }
 
@@ -390,7 +396,7 @@ void endpoint::metrics_exporter_t::set_import_topics(string_list new_topics) {
   filter_type filter;
   for (auto& str : new_topics)
     filter.emplace_back(std::move(str));
-  caf::anon_send(native(parent_->telemetry_exporter_), atom::join_v,
+  caf::anon_send(native(parent_->metric_exporter()), atom::join_v,
                  std::move(filter));
 }
 
@@ -401,8 +407,6 @@ namespace {
 struct connector_task : public endpoint::background_task {
 public:
   connector_task() = default;
-  connector_task(connector_task&&) = default;
-  connector_task& operator=(connector_task&&) = default;
 
   connector_task(const connector_task&) = delete;
   connector_task& operator=(const connector_task&) = delete;
@@ -410,25 +414,44 @@ public:
   ~connector_task() override {
     if (connector_) {
       connector_->async_shutdown();
-      thread_.join();
+      if (thread_.joinable())
+        thread_.join();
     }
   }
 
+  /// Creates the connector. Its thread only starts with `launch`, but the
+  /// connector buffers all requests in its pipe until then.
   internal::connector_ptr start(caf::actor_system& sys, endpoint_id this_peer,
                                 const broker_options& broker_cfg,
-                                openssl_options_ptr ssl_cfg) {
+                                openssl_options_ptr ssl_cfg,
+                                std::vector<size_t> cpus) {
+    sys_ = &sys;
+    cpus_ = std::move(cpus);
     connector_ = std::make_shared<internal::connector>(this_peer, broker_cfg,
                                                        std::move(ssl_cfg));
-    thread_ = std::thread{[ptr{connector_}, sys_ptr{&sys}] {
-      CAF_SET_LOGGER_SYS(sys_ptr);
-      ptr->run();
-    }};
     return connector_;
   }
 
+  /// Starts the thread of the connector. Calling this function more than once
+  /// has no effect.
+  void launch() {
+    std::call_once(launched_, [this] {
+      // Note: naming the thread allows tools to attribute CPU time to it.
+      auto run = [ptr{connector_}, cpus{cpus_}] {
+        if (!detail::set_thread_affinity(cpus))
+          BROKER_WARNING("failed to pin the connector to the configured CPUs");
+        ptr->run();
+      };
+      thread_ = sys_->launch_thread("broker.conn", std::move(run));
+    });
+  }
+
 private:
+  caf::actor_system* sys_ = nullptr;
+  std::vector<size_t> cpus_;
   std::shared_ptr<internal::connector> connector_;
   std::thread thread_;
+  std::once_flag launched_;
 };
 
 } // namespace
@@ -533,7 +556,13 @@ endpoint::endpoint(configuration config, endpoint_id id) : id_(id) {
   internal::connector_ptr conn_ptr;
   if (!caf::get_or(cfg, "broker.disable-connector", false)) {
     auto conn_task = std::make_unique<connector_task>();
-    conn_ptr = conn_task->start(sys, id_, broker_cfg, ssl_cfg);
+    auto cpus = caf::get_or(cfg, "broker.affinity.connector",
+                            std::vector<size_t>{});
+    conn_ptr = conn_task->start(sys, id_, broker_cfg, ssl_cfg, std::move(cpus));
+    if (broker_cfg.lightweight)
+      launch_connector_ = [ptr = conn_task.get()] { ptr->launch(); };
+    else
+      conn_task->launch();
     background_tasks_.emplace_back(std::move(conn_task));
   } else {
     BROKER_DEBUG("run without a connector (assuming test mode)");
@@ -558,15 +587,56 @@ endpoint::endpoint(configuration config, endpoint_id id) : id_(id) {
   caf::actor core;
   using core_t = internal::core_actor;
   domain_options adaptation{opts.disable_forwarding};
-  if (auto sp = caf::get_as<std::string>(cfg, "caf.scheduler.policy");
-      sp && *sp == "testing") {
+  auto sp = caf::get_as<std::string>(cfg, "caf.scheduler.policy");
+  auto is_testing = sp && *sp == "testing";
+  if (auto n = caf::get_or(cfg, "broker.async-publish-credit",
+                           defaults::async_publish_credit);
+      n > 0) {
+    using credit_t = internal::publish_credit;
+    auto mode = credit_t::policy::block;
+    auto str = caf::get_or(cfg, "broker.async-publish-policy",
+                           std::string{defaults::async_publish_policy});
+    if (!from_string(str, mode))
+      BROKER_ERROR("invalid async-publish-policy, falling back to 'block'");
+    publish_credit_ = std::make_shared<credit_t>(n, mode);
+  }
+  if (auto dir = caf::get_or(cfg, "broker.topic-log.directory",
+                             caf::string_view{defaults::topic_log::directory});
+      !dir.empty()) {
+    namespace tl = defaults::topic_log;
+    filter_type topics;
+    for (auto& str : caf::get_or(cfg, "broker.topic-log.topics",
+                                 std::vector<std::string>{}))
+      topics.emplace_back(std::move(str));
+    topic_log_ = std::make_shared<internal::topic_log>(
+      std::move(dir), std::move(topics),
+      caf::get_or(cfg, "broker.topic-log.segment-size", tl::segment_size),
+      caf::get_or(cfg, "broker.topic-log.max-size", tl::max_size),
+      caf::get_or(cfg, "broker.topic-log.max-age", tl::max_age));
+    if (!topic_log_->open()) {
+      BROKER_WARNING("failed to open the topic log in"
+                     << topic_log_->directory());
+      topic_log_ = nullptr;
+    }
+  }
+  if (is_testing) {
     core = sys.spawn<core_t>(id_, filter_type{}, clock_.get(), &adaptation,
-                             std::move(conn_ptr));
+                             std::move(conn_ptr), publish_credit_, topic_log_);
   } else {
     core = sys.spawn<core_t, caf::detached>(id_, filter_type{}, clock_.get(),
-                                            &adaptation, std::move(conn_ptr));
+                                            &adaptation, std::move(conn_ptr),
+                                            publish_credit_, topic_log_);
   }
   core_ = facade(core);
+  // Pin the multiplexer thread that runs the peer connections if configured.
+  if (auto cpus = caf::get_as<std::vector<size_t>>(cfg,
+                                                   "broker.affinity.network");
+      cpus && !is_testing) {
+    sys.network_manager().mpx().schedule_fn([cpus = std::move(*cpus)] {
+      if (!detail::set_thread_affinity(cpus))
+        BROKER_WARNING("failed to pin the network I/O to the configured CPUs");
+    });
+  }
   // Spin up a Prometheus actor if configured or an exporter.
   if (auto port = caf::get_as<broker::port>(cfg, "broker.metrics.port")) {
     auto ptask = std::make_unique<prometheus_http_task>(sys);
@@ -580,11 +650,9 @@ endpoint::endpoint(configuration config, endpoint_id id) : id_(id) {
     } else {
       BROKER_ERROR("failed to expose metrics:" << actual_port.error());
     }
-  } else {
-    using exporter_t = internal::metric_exporter_actor;
-    auto params = internal::metric_exporter_params::from(cfg);
-    auto hdl = sys.spawn<exporter_t>(native(core_), std::move(params));
-    telemetry_exporter_ = facade(hdl);
+  } else if (!opts.lightweight
+             || internal::metric_exporter_params::from(cfg).valid()) {
+    metric_exporter();
   }
   // Spin up a WebSocket server when requested.
   if (auto port = caf::get_as<broker::port>(cfg, "broker.web-socket.port"))
@@ -596,6 +664,17 @@ endpoint::~endpoint() {
   shutdown();
 }
 
+const worker& endpoint::metric_exporter() {
+  std::lock_guard guard{telemetry_exporter_mtx_};
+  if (!telemetry_exporter_) {
+    using exporter_t = internal::metric_exporter_actor;
+    auto params = internal::metric_exporter_params::from(nat_cfg(ctx_->cfg));
+    auto hdl = ctx_->sys.spawn<exporter_t>(native(core_), std::move(params));
+    telemetry_exporter_ = facade(hdl);
+  }
+  return telemetry_exporter_;
+}
+
 void endpoint::shutdown() {
   // Destroying a destroyed endpoint is a no-op.
   if (!ctx_)
@@ -639,14 +718,17 @@ void endpoint::shutdown() {
         self->wait_for(native(hdl));
       workers_.clear();
     }
-    BROKER_DEBUG("stop the telemetry exporter");
-    self->send_exit(native(telemetry_exporter_),
-                    caf::exit_reason::user_shutdown);
-    if (sched)
-      sched->run();
-    self->wait_for(native(telemetry_exporter_));
-    telemetry_exporter_ = nullptr;
+    if (telemetry_exporter_) {
+      BROKER_DEBUG("stop the telemetry exporter");
+      self->send_exit(native(telemetry_exporter_),
+                      caf::exit_reason::user_shutdown);
+      if (sched)
+        sched->run();
+      self->wait_for(native(telemetry_exporter_));
+      telemetry_exporter_ = nullptr;
+    }
   }
+  launch_connector_ = nullptr;
   BROKER_DEBUG("stop" << background_tasks_.size() << "background tasks");
   background_tasks_.clear();
   ctx_.reset();
@@ -656,6 +738,8 @@ void endpoint::shutdown() {
 uint16_t endpoint::listen(const std::string& address, uint16_t port,
                           error* err_ptr, bool reuse_addr) {
   BROKER_TRACE(BROKER_ARG(address) << BROKER_ARG(port));
+  if (launch_connector_)
+    launch_connector_();
   BROKER_INFO("try listening on"
               << (address + ":" + std::to_string(port))
               << (ctx_->cfg.options().disable_ssl ? "(no SSL)" : "(SSL)"));
@@ -682,6 +766,8 @@ uint16_t endpoint::listen(const std::string& address, uint16_t port,
 bool endpoint::peer(const std::string& address, uint16_t port,
                     timeout::seconds retry) {
   BROKER_TRACE(BROKER_ARG(address) << BROKER_ARG(port) << BROKER_ARG(retry));
+  if (launch_connector_)
+    launch_connector_();
   BROKER_INFO("starting to peer with" << (address + ":" + std::to_string(port))
                                       << "retry:" << to_string(retry)
                                       << "[synchronous]");
@@ -704,6 +790,8 @@ bool endpoint::peer(const std::string& address, uint16_t port,
 void endpoint::peer_nosync(const std::string& address, uint16_t port,
                            timeout::seconds retry) {
   BROKER_TRACE(BROKER_ARG(address) << BROKER_ARG(port));
+  if (launch_connector_)
+    launch_connector_();
   BROKER_INFO("starting to peer with" << (address + ":" + std::to_string(port))
                                       << "retry:" << to_string(retry)
                                       << "[asynchronous]");
@@ -714,6 +802,8 @@ void endpoint::peer_nosync(const std::string& address, uint16_t port,
 std::future<bool> endpoint::peer_async(std::string host, uint16_t port,
                                        timeout::seconds retry) {
   BROKER_TRACE(BROKER_ARG(host) << BROKER_ARG(port));
+  if (launch_connector_)
+    launch_connector_();
   auto prom = std::make_shared<std::promise<bool>>();
   auto res = prom->get_future();
   auto on_val = [prom](atom::peer, atom::ok, endpoint_id) mutable {
@@ -774,14 +864,16 @@ uint16_t endpoint::web_socket_listen(const std::string& address, uint16_t port,
     auto addr =
       network_info{caf::get_or(hdr, "web-socket.remote-address", "unknown"),
                    caf::get_or(hdr, "web-socket.remote-port", uint16_t{0}), 0s};
-    BROKER_INFO("new JSON client with address" << addr << "and user agent"
-                                               << user_agent);
+    auto binary = caf::get_or(hdr, "web-socket.path", "") == "/v1/messages/bin";
+    BROKER_INFO("new" << (binary ? "binary" : "JSON") << "client with address"
+                      << addr << "and user agent" << user_agent);
     using impl_t = internal::json_client_actor;
-    sp->spawn<impl_t>(id, core, addr, std::move(pull), std::move(push));
+    sp->spawn<impl_t>(id, core, addr, std::move(pull), std::move(push), binary);
   };
   auto ssl_cfg = ctx_->cfg.openssl_options();
   auto res = internal::web_socket::launch(ctx_->sys, ssl_cfg, address, port,
                                           reuse_addr, "/v1/messages/json",
+                                          "/v1/messages/bin",
                                           std::move(on_connect));
   if (res) {
     return *res;
@@ -812,29 +904,39 @@ void endpoint::forward(std::vector<topic> ts) {
 
 void endpoint::publish(topic t, const data& d) {
   BROKER_INFO("publishing" << d << "at" << t);
+  if (!acquire_publish_credit())
+    return;
   caf::anon_send(native(core_), atom::publish_v,
                  make_data_message(std::move(t), d));
 }
 
 void endpoint::publish(topic t, variant d) {
   BROKER_INFO("publishing" << d << "at" << t);
+  if (!acquire_publish_credit())
+    return;
   caf::anon_send(native(core_), atom::publish_v,
                  make_data_message(std::move(t), std::move(d)));
 }
 
 void endpoint::publish(std::string_view t, const zeek::Message& d) {
   BROKER_INFO("publishing" << d << "at" << t);
+  if (!acquire_publish_credit())
+    return;
   caf::anon_send(native(core_), atom::publish_v, make_data_message(t, d.raw()));
 }
 
 void endpoint::publish(const endpoint_info& dst, topic t, const data& d) {
   BROKER_INFO("publishing" << d << "at" << t << "to" << dst.node);
+  if (!acquire_publish_credit())
+    return;
   caf::anon_send(native(core_), atom::publish_v,
                  make_data_message(std::move(t), d), dst);
 }
 
 void endpoint::publish(const endpoint_info& dst, topic t, const variant& d) {
   BROKER_INFO("publishing" << d << "at" << t << "to" << dst.node);
+  if (!acquire_publish_credit())
+    return;
   caf::anon_send(native(core_), atom::publish_v,
                  make_data_message(std::move(t), d), dst);
 }
@@ -842,12 +944,16 @@ void endpoint::publish(const endpoint_info& dst, topic t, const variant& d) {
 void endpoint::publish(const endpoint_info& dst, std::string_view t,
                        const zeek::Message& d) {
   BROKER_INFO("publishing" << d << "at" << t << "to" << dst.node);
+  if (!acquire_publish_credit())
+    return;
   caf::anon_send(native(core_), atom::publish_v, make_data_message(t, d.raw()),
                  dst);
 }
 
 void endpoint::publish(data_message x) {
   BROKER_INFO("publishing" << x);
+  if (!acquire_publish_credit())
+    return;
   caf::anon_send(native(core_), atom::publish_v, std::move(x));
 }
 
@@ -857,10 +963,35 @@ void endpoint::publish(std::vector<data_message> xs) {
     publish(std::move(x));
 }
 
+bool endpoint::publish_encoded(std::vector<std::byte> batch) {
+  BROKER_INFO("publishing a batch of" << batch.size() << "bytes");
+  auto first = batch.data();
+  auto last = first + batch.size();
+  auto nop = [](std::string_view, const std::byte*, size_t) {};
+  if (!format::bin::v1::decode_records(first, last, nop)) {
+    BROKER_ERROR("cannot publish a batch with truncated records");
+    return false;
+  }
+  auto ptr = std::make_shared<const std::vector<std::byte>>(std::move(batch));
+  if (!acquire_publish_credit())
+    return false;
+  caf::anon_send(native(core_), atom::publish_v,
+                 internal::encoded_batch_ptr{std::move(ptr)});
+  return true;
+}
+
+bool endpoint::acquire_publish_credit() {
+  return !publish_credit_ || publish_credit_->acquire();
+}
+
 publisher endpoint::make_publisher(topic ts) {
   return publisher::make(*this, std::move(ts));
 }
 
+shared_publisher endpoint::make_shared_publisher(topic ts, size_t ring_size) {
+  return shared_publisher::make(*this, std::move(ts), ring_size);
+}
+
 status_subscriber endpoint::make_status_subscriber(bool receive_statuses,
                                                    size_t queue_size) {
   return status_subscriber::make(*this, receive_statuses, queue_size);
@@ -870,6 +1001,23 @@ subscriber endpoint::make_subscriber(filter_type filter, size_t queue_size) {
   return subscriber::make(*this, std::move(filter), queue_size);
 }
 
+subscriber_group
+endpoint::make_subscriber_group(std::vector<filter_type> filters,
+                                size_t queue_size) {
+  return subscriber_group::make(*this, std::move(filters), queue_size);
+}
+
+size_t endpoint::replay(const filter_type& filter, uint64_t& offset,
+                        std::vector<data_message>& out, size_t max) {
+  if (!topic_log_ || max == 0)
+    return 0;
+  return topic_log_->replay(filter, offset, out, max);
+}
+
+uint64_t endpoint::topic_log_offset() const {
+  return topic_log_ ? topic_log_->next_offset() : uint64_t{0};
+}
+
 namespace {
 
 struct worker_state {
@@ -878,6 +1026,52 @@ struct worker_state {
 
 using worker_actor = caf::stateful_actor<worker_state>;
 
+// Subscribes `sink` to the messages from `res` on `self`.
+void consume(worker_actor* self, internal::data_consumer_res res,
+             const detail::sink_driver_ptr& sink) {
+  if (sink->batched()) {
+    // The consumer pulls all available items from the buffer in one go and
+    // emits them one by one. We collect them and deliver the whole burst to
+    // the sink in an action that runs right after the current one.
+    auto buf = std::make_shared<std::vector<data_message>>();
+    auto flush = [sink, buf] {
+      if (!buf->empty()) {
+        sink->on_next_batch(*buf);
+        buf->clear();
+      }
+    };
+    self //
+      ->make_observable()
+      .from_resource(std::move(res))
+      .subscribe(caf::flow::make_observer(
+        [self, buf, flush](const data_message& msg) {
+          if (buf->empty())
+            self->delay_fn(flush);
+          buf->push_back(msg);
+        },
+        [sink, flush](const caf::error& err) {
+          flush();
+          sink->on_cleanup(facade(err));
+        },
+        [sink, flush] {
+          flush();
+          error no_error;
+          sink->on_cleanup(no_error);
+        }));
+  } else {
+    self //
+      ->make_observable()
+      .from_resource(std::move(res))
+      .subscribe(caf::flow::make_observer(
+        [sink](const data_message& msg) { sink->on_next(msg); },
+        [sink](const caf::error& err) { sink->on_cleanup(facade(err)); },
+        [sink] {
+          error no_error;
+          sink->on_cleanup(no_error);
+        }));
+  }
+}
+
 } // namespace
 
 worker endpoint::do_subscribe(filter_type&& filter,
@@ -891,16 +1085,7 @@ worker endpoint::do_subscribe(filter_type&& filter,
   // Subscribe a new worker to the consumer end.
   auto [obs, launch_obs] = ctx_->sys.spawn_inactive<worker_actor>();
   sink->init();
-  obs //
-    ->make_observable()
-    .from_resource(con_res)
-    .subscribe(caf::flow::make_observer(
-      [sink](const data_message& msg) { sink->on_next(msg); },
-      [sink](const caf::error& err) { sink->on_cleanup(facade(err)); },
-      [sink] {
-        error no_error;
-        sink->on_cleanup(no_error);
-      }));
+  consume(obs, con_res, sink);
   auto worker = caf::actor{obs};
   launch_obs();
   // Hand the producer end to the core.
@@ -910,6 +1095,50 @@ worker endpoint::do_subscribe(filter_type&& filter,
   return workers_.back();
 }
 
+worker
+endpoint::do_subscribe_parallel(filter_type&& filter, partition_fn&& key,
+                                std::vector<detail::sink_driver_ptr> sinks) {
+  BROKER_ASSERT(!sinks.empty());
+  using caf::async::make_spsc_buffer_resource;
+  using tagged_message = std::pair<size_t, data_message>;
+  auto resources = make_spsc_buffer_resource<data_message>();
+  auto& [con_res, prod_res] = resources;
+  // The dispatcher computes the partition for each message once and then
+  // forwards it to the worker for that partition. Since all workers share the
+  // input, a slow worker eventually throttles the others.
+  auto [dispatcher, launch_dispatcher] =
+    ctx_->sys.spawn_inactive<worker_actor>();
+  auto num_workers = sinks.size();
+  auto inputs = dispatcher //
+                  ->make_observable()
+                  .from_resource(con_res)
+                  .map([key = std::move(key),
+                        num_workers](const data_message& msg) {
+                    return tagged_message{key(msg) % num_workers, msg};
+                  })
+                  .share();
+  for (size_t index = 0; index < num_workers; ++index) {
+    auto partition = make_spsc_buffer_resource<data_message>();
+    auto& [part_con_res, part_prod_res] = partition;
+    inputs
+      .filter([index](const tagged_message& x) { return x.first == index; })
+      .map([](const tagged_message& x) { return x.second; })
+      .subscribe(part_prod_res);
+    auto [obs, launch_obs] = ctx_->sys.spawn_inactive<worker_actor>();
+    sinks[index]->init();
+    consume(obs, part_con_res, sinks[index]);
+    launch_obs();
+  }
+  auto worker = caf::actor{dispatcher};
+  launch_dispatcher();
+  // Hand the producer end to the core.
+  caf::anon_send(native(core()), std::move(filter), std::move(prod_res));
+  // Only the dispatcher becomes a worker of the endpoint. Stopping it closes
+  // the inputs of all partitions, which in turn stops their workers.
+  workers_.emplace_back(facade(worker));
+  return workers_.back();
+}
+
 namespace {
 
 // Implements the Pullable concept from CAF.
@@ -936,11 +1165,21 @@ public:
       return;
     }
     // Pull from the driver and propagate values down the pipeline.
-    buf_.clear();
-    driver_->pull(buf_, n);
-    for (auto& msg : buf_)
-      if (!step.on_next(msg, steps...))
-        return;
+    if (driver_->vectorized()) {
+      // Hand out a pre-sized buffer for the driver to fill in place.
+      vbuf_.clear();
+      vbuf_.resize(n);
+      auto written = std::min(driver_->pull(span<data_message>{vbuf_}), n);
+      for (size_t i = 0; i < written; ++i)
+        if (!step.on_next(vbuf_[i], steps...))
+          return;
+    } else {
+      buf_.clear();
+      driver_->pull(buf_, n);
+      for (auto& msg : buf_)
+        if (!step.on_next(msg, steps...))
+          return;
+    }
     // Check for end condition again.
     if (driver_->at_end()) {
       step.on_complete(steps...);
@@ -951,6 +1190,7 @@ public:
 private:
   driver_ptr driver_;
   std::deque<data_message> buf_;
+  std::vector<data_message> vbuf_;
 };
 
 } // namespace
@@ -959,9 +1199,14 @@ worker
 endpoint::do_publish_all(const std::shared_ptr<detail::source_driver>& driver) {
   BROKER_ASSERT(driver != nullptr);
   using caf::async::make_spsc_buffer_resource;
-  // Get a pair of connected resources.
+  // Get a pair of connected resources. Vectorized drivers receive their demand
+  // in large chunks to make the most of filling a buffer in one go.
   // Note: structured bindings with values confuses clang-tidy's leak checker.
-  auto resources = make_spsc_buffer_resource<data_message>();
+  auto chunk_size = defaults::publish_all::chunk_size;
+  auto resources =
+    driver->vectorized()
+      ? make_spsc_buffer_resource<data_message>(2 * chunk_size, chunk_size)
+      : make_spsc_buffer_resource<data_message>();
   auto [con_res, prod_res] = resources;
   // Push to the producer end with a new worker.
   auto [src, launch_src] = ctx_->sys.spawn_inactive<worker_actor>();
@@ -1022,6 +1267,67 @@ expected<store> endpoint::attach_clone(std::string name, double resync_interval,
   return res;
 }
 
+expected<store>
+endpoint::attach_partial_clone(std::string name, std::string key_prefix,
+                               double resync_interval, double stale_interval,
+                               double mutation_buffer_interval) {
+  BROKER_TRACE(BROKER_ARG(name) << BROKER_ARG(key_prefix));
+  BROKER_INFO("attaching partial clone store" << name << "for prefix"
+                                              << key_prefix);
+  expected<store> res{ec::unspecified};
+  caf::scoped_actor self{ctx_->sys};
+  self
+    ->request(native(core_), caf::infinite, atom::data_store_v, atom::clone_v,
+              atom::attach_v, name, resync_interval, stale_interval,
+              mutation_buffer_interval, std::move(key_prefix))
+    .receive(
+      [&](caf::actor& clone) {
+        res = store{id_, facade(clone), std::move(name)};
+      },
+      [&](caf::error& e) { res = facade(e); });
+  return res;
+}
+
+expected<sharded_store>
+endpoint::attach_sharded_master(std::string name, backend type,
+                                size_t num_shards, backend_options opts) {
+  if (num_shards == 0)
+    return make_error(ec::unspecified, "num_shards must be positive");
+  std::vector<store> shards;
+  shards.reserve(num_shards);
+  for (size_t index = 0; index < num_shards; ++index) {
+    auto shard_opts = opts;
+    if (auto i = shard_opts.find("path"); i != shard_opts.end())
+      if (auto* path = get_if<std::string>(&i->second))
+        *path += "." + std::to_string(index);
+    auto shard = attach_master(sharded_store::shard_name(name, index), type,
+                               std::move(shard_opts));
+    if (!shard)
+      return shard.error();
+    shards.emplace_back(std::move(*shard));
+  }
+  return sharded_store{std::move(shards)};
+}
+
+expected<sharded_store>
+endpoint::attach_sharded_clone(std::string name, size_t num_shards,
+                               double resync_interval, double stale_interval,
+                               double mutation_buffer_interval) {
+  if (num_shards == 0)
+    return make_error(ec::unspecified, "num_shards must be positive");
+  std::vector<store> shards;
+  shards.reserve(num_shards);
+  for (size_t index = 0; index < num_shards; ++index) {
+    auto shard = attach_clone(sharded_store::shard_name(name, index),
+                              resync_interval, stale_interval,
+                              mutation_buffer_interval);
+    if (!shard)
+      return shard.error();
+    shards.emplace_back(std::move(*shard));
+  }
+  return sharded_store{std::move(shards)};
+}
+
 void endpoint::init_socket_api() {
 #ifdef BROKER_WINDOWS
   WSADATA WinsockData;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <future>
@@ -24,16 +25,21 @@
 #include "broker/message.hh"
 #include "broker/network_info.hh"
 #include "broker/peer_info.hh"
+#include "broker/sharded_store.hh"
+#include "broker/shared_publisher.hh"
 #include "broker/shutdown_options.hh"
 #include "broker/status.hh"
 #include "broker/status_subscriber.hh"
 #include "broker/store.hh"
+#include "broker/subscriber_group.hh"
 #include "broker/time.hh"
 #include "broker/topic.hh"
 #include "broker/worker.hh"
 
 namespace broker::internal {
 
+class publish_credit;
+class topic_log;
 struct endpoint_access;
 struct endpoint_context;
 
@@ -124,6 +130,10 @@ public:
     virtual ~background_task();
   };
 
+  /// Maps a message to a hash value for selecting a worker in
+  /// `subscribe_parallel`.
+  using partition_fn = std::function<size_t(const data_message&)>;
+
   friend class metrics_exporter_t;
 
   // --- construction and destruction ------------------------------------------
@@ -253,12 +263,19 @@ public:
 
   // --- publishing ------------------------------------------------------------
 
+  // Note: setting `broker.async-publish-credit` limits how many messages the
+  //       functions below may queue at the core. When running out of credit,
+  //       they either block or drop the message, depending on
+  //       `broker.async-publish-policy`.
+
   /// Publishes a message.
   /// @param t The topic of the message.
   /// @param d The message data.
   void publish(topic t, const data& d);
 
-  /// Publishes a message.
+  /// Publishes a message. Unlike the overload for `data`, this overload
+  /// neither copies nor serializes `d`. The new message shares the envelope
+  /// that holds `d`, e.g., when forwarding a received value.
   /// @param t The topic of the message.
   /// @param d The message data.
   void publish(topic t, variant d);
@@ -312,11 +329,28 @@ public:
   // Publishes all messages in `xs`.
   void publish(std::vector<data_message> xs);
 
+  /// Publishes a batch of pre-encoded data messages. The batch is a sequence
+  /// of records as written by `format::bin::v1::encode_record`. The core
+  /// receives the batch as a single unit and splits it into individual
+  /// messages without re-encoding the payloads.
+  /// @returns `false` if `batch` contains a truncated record or the endpoint
+  ///          ran out of publish credit, in which case the endpoint publishes
+  ///          none of its messages.
+  bool publish_encoded(std::vector<std::byte> batch);
+
   publisher make_publisher(topic ts);
 
+  /// Returns a publisher for `ts` that multiple threads may use concurrently.
+  shared_publisher make_shared_publisher(
+    topic ts, size_t ring_size = defaults::shared_publisher::ring_size);
+
   /// Starts a background worker from the given set of functions that publishes
   /// a series of messages. The worker will run in the background, but `init`
-  /// is guaranteed to be called before the function returns.
+  /// is guaranteed to be called before the function returns. If `f` has the
+  /// signature `size_t (span<data_message>)` (optionally taking the state
+  /// first), the worker hands out pre-sized buffers of up to
+  /// `defaults::publish_all::chunk_size` messages and `f` returns how many
+  /// messages it has written.
   template <class Init, class Pull, class AtEnd>
   worker publish_all(Init init, Pull f, AtEnd pred) {
     using driver_t = detail::source_driver_impl_t<Init, Pull, AtEnd>;
@@ -353,9 +387,34 @@ public:
   make_subscriber(filter_type filter,
                   size_t queue_size = defaults::subscriber::queue_size);
 
+  /// Returns a group of subscriptions that share a single queue. The tag of
+  /// each filter is its position in `filters`.
+  subscriber_group
+  make_subscriber_group(std::vector<filter_type> filters,
+                        size_t queue_size = defaults::subscriber::queue_size);
+
+  /// Reads up to `max` retained messages that match `filter` from the topic
+  /// log of this endpoint (see `broker.topic-log.directory`), starting at
+  /// `offset`. Afterwards, `offset` points past the last visited message.
+  /// Hence, calling this function until it returns 0 replays everything
+  /// since `offset`. Reading happens on the calling thread without involving
+  /// the core.
+  /// @returns the number of messages added to `out`. Always 0 if the endpoint
+  ///          has no topic log.
+  size_t replay(const filter_type& filter, uint64_t& offset,
+                std::vector<data_message>& out,
+                size_t max = defaults::topic_log::replay_batch_size);
+
+  /// Returns the offset that the next message in the topic log receives or 0
+  /// if the endpoint has no topic log. Subscribers that store this offset
+  /// before subscribing can later replay what they missed.
+  uint64_t topic_log_offset() const;
+
   /// Starts a background worker from the given set of function that consumes
   /// incoming messages. The worker will run in the background, but `init` is
-  /// guaranteed to be called before the function returns.
+  /// guaranteed to be called before the function returns. If `on_next` takes
+  /// a `span<const data_message>`, the worker passes all messages that are
+  /// available at once to a single call.
   template <class Init, class OnNext, class Cleanup>
   worker subscribe(filter_type filter, Init&& init, OnNext&& on_next,
                    Cleanup&& cleanup) {
@@ -374,6 +433,30 @@ public:
                                                  [](const error&) {}));
   }
 
+  /// Starts `num_workers` background workers that consume incoming messages
+  /// in parallel. The endpoint hashes the result of `key(msg)` for each
+  /// message to pick a worker. Hence, messages with the same key always go to
+  /// the same worker and arrive in order. Each worker runs on its own copy of
+  /// the callbacks with a separate state. Stopping the returned worker stops
+  /// all of them.
+  template <class Key, class Init, class OnNext, class Cleanup>
+  worker subscribe_parallel(filter_type filter, size_t num_workers, Key key,
+                            Init init, OnNext on_next, Cleanup cleanup) {
+    using key_type =
+      std::decay_t<std::invoke_result_t<const Key&, const data_message&>>;
+    if (num_workers == 0)
+      num_workers = 1;
+    std::vector<detail::sink_driver_ptr> drivers;
+    drivers.reserve(num_workers);
+    for (size_t i = 0; i < num_workers; ++i)
+      drivers.emplace_back(detail::make_sink_driver(init, on_next, cleanup));
+    partition_fn fn = [key = std::move(key)](const data_message& msg) {
+      return std::hash<key_type>{}(key(msg));
+    };
+    return do_subscribe_parallel(std::move(filter), std::move(fn),
+                                 std::move(drivers));
+  }
+
   template <class Init, class OnNext, class Cleanup>
   [[deprecated("use subscribe() instead")]] worker
   subscribe_nosync(filter_type filter, Init init, OnNext on_next,
@@ -424,6 +507,46 @@ public:
                                double stale_interval = 300.0,
                                double mutation_buffer_interval = 120.0);
 
+  /// Attaches and/or creates a *partial clone* that only keeps string keys
+  /// starting with `key_prefix`. The clone ignores all other keys in the
+  /// snapshot and in the updates from the master, i.e., lookups of these keys
+  /// fail with `no_such_key`. Writes through the clone reach the master
+  /// regardless of their key. All other parameters have the same meaning as
+  /// for `attach_clone`.
+  /// @note The master still sends its full snapshot and all updates. Partial
+  ///       clones reduce memory usage, not network traffic.
+  /// @note An endpoint has at most one clone per store. Attaching again
+  ///       returns the existing clone, regardless of its key prefix.
+  expected<store> attach_partial_clone(std::string name, std::string key_prefix,
+                                       double resync_interval = 10.0,
+                                       double stale_interval = 300.0,
+                                       double mutation_buffer_interval = 120.0);
+
+  /// Attaches and/or creates masters for all shards of a sharded data store.
+  /// The shard at index `i` uses the name `sharded_store::shard_name(name, i)`.
+  /// For persistent backends, each shard appends `.<i>` to the `path` option.
+  /// @param name The name of the sharded store.
+  /// @param type The type of backend to use.
+  /// @param num_shards The number of shards.
+  /// @param opts The options controlling backend construction.
+  /// @returns A handle to the sharded store or an error if attaching any of the
+  ///          masters failed.
+  /// @note To spread the shards across several endpoints, call `attach_master`
+  ///       with the shard names on each endpoint and combine the resulting
+  ///       stores to a `sharded_store`.
+  expected<sharded_store>
+  attach_sharded_master(std::string name, backend type, size_t num_shards,
+                        backend_options opts = backend_options());
+
+  /// Attaches and/or creates clones for all shards of a sharded data store. All
+  /// parameters except `num_shards` have the same meaning as for
+  /// `attach_clone`.
+  expected<sharded_store>
+  attach_sharded_clone(std::string name, size_t num_shards,
+                       double resync_interval = 10.0,
+                       double stale_interval = 300.0,
+                       double mutation_buffer_interval = 120.0);
+
   // --- messaging -------------------------------------------------------------
 
   /// @private
@@ -523,6 +646,25 @@ public:
       shutdown_options_.unset(flag);
   }
 
+  /// Queries whether the endpoint waits for buffered messages to reach its
+  /// peers before unpeering on shutdown.
+  bool drain_peers_on_shutdown() const {
+    constexpr auto flag = shutdown_options::drain_peers_on_shutdown;
+    return shutdown_options_.contains(flag);
+  }
+
+  /// Sets whether the endpoint waits for buffered messages to reach its peers
+  /// before unpeering on shutdown. The endpoint waits at most `timeout`.
+  void drain_peers_on_shutdown(bool x,
+                               timespan timeout = defaults::drain_timeout) {
+    constexpr auto flag = shutdown_options::drain_peers_on_shutdown;
+    if (x)
+      shutdown_options_.set(flag);
+    else
+      shutdown_options_.unset(flag);
+    shutdown_options_.drain_timeout(timeout);
+  }
+
   /// Returns a configuration object for the metrics exporter.
   metrics_exporter_t metrics_exporter() {
     return metrics_exporter_t{this};
@@ -560,20 +702,37 @@ private:
   worker do_subscribe(filter_type&& topics,
                       const detail::sink_driver_ptr& driver);
 
+  worker do_subscribe_parallel(filter_type&& topics, partition_fn&& key,
+                               std::vector<detail::sink_driver_ptr> drivers);
+
   worker do_publish_all(const detail::source_driver_ptr& driver);
 
   template <class F>
   worker make_worker(F fn);
 
+  /// Returns the handle of the metric exporter, spawning it when needed.
+  const worker& metric_exporter();
+
+  /// Takes one credit for publishing a message to the core.
+  /// @returns `false` if the message must be dropped.
+  bool acquire_publish_credit();
+
   std::shared_ptr<internal::endpoint_context> ctx_;
   endpoint_id id_;
   worker core_;
   shutdown_options shutdown_options_;
   worker telemetry_exporter_;
+  std::mutex telemetry_exporter_mtx_;
+  /// Starts the connector thread on first use for lightweight endpoints.
+  std::function<void()> launch_connector_;
   bool await_stores_on_shutdown_ = false;
   std::vector<worker> workers_;
   std::unique_ptr<clock> clock_;
   std::vector<std::unique_ptr<background_task>> background_tasks_;
+  /// Limits asynchronous publishing if configured.
+  std::shared_ptr<internal::publish_credit> publish_credit_;
+  /// Retains messages for replaying if configured.
+  std::shared_ptr<internal::topic_log> topic_log_;
 };
 
 } // namespace broker
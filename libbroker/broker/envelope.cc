@@ -22,8 +22,9 @@
 #include <caf/detail/ieee_754.hpp>
 #include <caf/detail/network_order.hpp>
 #include <caf/expected.hpp>
-#include <caf/json_object.hpp>
-#include <caf/json_value.hpp>
+
+#include <algorithm>
+#include <chrono>
 
 namespace broker {
 
@@ -84,6 +85,38 @@ endpoint_id envelope::receiver() const noexcept {
   return endpoint_id::nil();
 }
 
+void envelope::mark_sampled() const noexcept {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  sampled_at_.store(ns, std::memory_order_relaxed);
+}
+
+double envelope::sample_age() const noexcept {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  auto age = ns - sampled_at_.load(std::memory_order_relaxed);
+  return static_cast<double>(age) / 1e9;
+}
+
+void envelope::expire_after(timespan max_age) const noexcept {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  // Zero is reserved for "never expires".
+  expires_at_.store(std::max(ns + max_age.count(), int64_t{1}),
+                    std::memory_order_relaxed);
+}
+
+bool envelope::expired_slow() const noexcept {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  return ns >= expires_at_.load(std::memory_order_relaxed);
+}
+
+envelope_ptr envelope::with(endpoint_id new_sender,
+                           endpoint_id new_receiver) const {
+  return with(new_sender, new_receiver, ttl());
+}
+
 expected<envelope_ptr> envelope::deserialize(const std::byte* data,
                                              size_t size) {
   // Format is as follows:
@@ -154,28 +187,24 @@ expected<envelope_ptr> envelope::deserialize(const std::byte* data,
 
 expected<envelope_ptr> envelope::deserialize_json(const char* data,
                                                   size_t size) {
-  // Parse the JSON text into a JSON object.
-  auto val = caf::json_value::parse_shallow(std::string_view{data, size});
-  if (!val)
-    return error{ec::invalid_json};
-  auto obj = val->to_object();
-  // Type-checking.
-  if (obj.value("type").to_string() != "data-message")
-    return error{ec::deserialization_failed};
-  // Read the topic.
-  auto topic = obj.value("topic").to_string();
-  if (topic.empty())
-    return error{ec::deserialization_failed};
-  auto stl_topic = std::string_view{topic.data(), topic.size()};
-  // Try to convert the JSON structure into our binary serialization format.
+  // Convert the JSON text to our binary serialization format.
+  std::string type;
+  std::string topic;
   std::vector<std::byte> buf;
   buf.reserve(512); // Allocate some memory to avoid small allocations.
-  if (auto err = internal::json::data_message_to_binary(obj, buf))
+  auto str = std::string_view{data, size};
+  auto err = internal::json::data_message_to_binary(str, type, topic, buf);
+  if (err == ec::invalid_json)
+    return err;
+  // Type-checking.
+  if (type != "data-message" || topic.empty())
+    return error{ec::deserialization_failed};
+  if (err)
     return err;
   // Turn the binary data into a data envelope. TTL and sender/receiver are
   // not part of the JSON representation, so we use defaults values.
   auto res = data_envelope::deserialize(endpoint_id::nil(), endpoint_id::nil(),
-                                        defaults::ttl, stl_topic, buf.data(),
+                                        defaults::ttl, topic, buf.data(),
                                         buf.size());
   // Note: must manually "unbox" the expected to convert from
   // expected<data_envelope_ptr> to expected<envelope_ptr>.
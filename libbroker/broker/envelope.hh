@@ -10,6 +10,10 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <type_traits>
 
 namespace broker {
 
@@ -69,9 +73,43 @@ public:
   /// Returns the contained value in its serialized form.
   virtual std::pair<const std::byte*, size_t> raw_bytes() const noexcept = 0;
 
-  /// Returns a new envelope with the given sender and receiver.
-  virtual envelope_ptr with(endpoint_id new_sender,
-                            endpoint_id new_receiver) const = 0;
+  /// Marks this envelope as a sample for latency measurements by storing the
+  /// current time. Envelopes created via `with` inherit the sample time.
+  void mark_sampled() const noexcept;
+
+  /// Checks whether `mark_sampled` was called on this envelope.
+  bool sampled() const noexcept {
+    return sampled_at_.load(std::memory_order_relaxed) != 0;
+  }
+
+  /// Returns the time since calling `mark_sampled` in seconds.
+  /// @pre `sampled()`
+  double sample_age() const noexcept;
+
+  /// Lets this envelope expire after `max_age`. Queues drop expired envelopes
+  /// instead of delivering them. Envelopes created via `with` inherit the
+  /// deadline.
+  /// @note The deadline is local to this process and does not go on the wire.
+  void expire_after(timespan max_age) const noexcept;
+
+  /// Checks whether `expire_after` was called on this envelope.
+  bool has_deadline() const noexcept {
+    return expires_at_.load(std::memory_order_relaxed) != 0;
+  }
+
+  /// Checks whether the deadline of this envelope has passed. Always returns
+  /// `false` for envelopes without deadline.
+  bool expired() const noexcept {
+    return has_deadline() && expired_slow();
+  }
+
+  /// Returns a new envelope with the given sender and receiver. The new
+  /// envelope keeps the time-to-live of this envelope.
+  envelope_ptr with(endpoint_id new_sender, endpoint_id new_receiver) const;
+
+  /// Returns a new envelope with the given sender, receiver and time-to-live.
+  virtual envelope_ptr with(endpoint_id new_sender, endpoint_id new_receiver,
+                            uint16_t new_ttl) const = 0;
 
   /// Returns a string representation of this envelope.
   virtual std::string stringify() const = 0;
@@ -118,9 +156,17 @@ public:
   public:
     using decorated_ptr = intrusive_ptr<const Decorated>;
 
-    decorator(decorated_ptr decorated, endpoint_id sender, endpoint_id receiver)
-      : decorated_(std::move(decorated)), sender_(sender), receiver_(receiver) {
-      // nop
+    decorator(decorated_ptr decorated, endpoint_id sender, endpoint_id receiver,
+              uint16_t ttl)
+      : decorated_(std::move(decorated)),
+        sender_(sender),
+        receiver_(receiver),
+        ttl_(ttl) {
+      this->inherit_timestamps(*decorated_);
+    }
+
+    uint16_t ttl() const noexcept override {
+      return ttl_;
     }
 
     endpoint_id sender() const noexcept override {
@@ -143,22 +189,28 @@ public:
     decorated_ptr decorated_;
     endpoint_id sender_;
     endpoint_id receiver_;
+    uint16_t ttl_;
   };
 
   template <class T>
   using mbr_allocator = detail::monotonic_buffer_resource::allocator<T>;
 
+  /// Base type for envelopes that own a copy of their topic and payload. The
+  /// envelope, the copies and the first memory block for `buf()` share a
+  /// single allocation. Hence, instances must be created via `make`.
   template <class Base>
   class deserialized : public Base {
   public:
     deserialized(const endpoint_id& sender, const endpoint_id& receiver,
                  uint16_t ttl, std::string_view topic_str,
-                 const std::byte* payload, size_t payload_size)
+                 const std::byte* payload, size_t payload_size,
+                 std::byte* storage, size_t storage_size)
       : sender_(sender),
         receiver_(receiver),
         ttl_(ttl),
         topic_size_(topic_str.size()),
-        payload_size_(payload_size) {
+        payload_size_(payload_size),
+        buf_(storage, storage_size) {
       // Note: we need to copy the topic and the data into our memory resource.
       // The pointers passed to the constructor are only valid for the duration
       // of the call.
@@ -171,6 +223,39 @@ public:
       memcpy(payload_, payload, payload_size);
     }
 
+    /// Creates a new envelope of type `T` with trailing storage for topic,
+    /// payload and `arena_size` additional bytes for allocations from `buf()`.
+    /// @param args Additional arguments for the constructor of `T`.
+    template <class T, class... Ts>
+    static intrusive_ptr<T>
+    make(const endpoint_id& sender, const endpoint_id& receiver, uint16_t ttl,
+         std::string_view topic_str, const std::byte* payload,
+         size_t payload_size, size_t arena_size, Ts&&... args) {
+      static_assert(std::is_base_of_v<deserialized, T>);
+      static_assert(alignof(T) == alignof(deserialized));
+      auto storage_size = topic_str.size() + 1 + payload_size + arena_size;
+      auto vptr = allocate(sizeof(T) + storage_size);
+      auto storage = static_cast<std::byte*>(vptr) + sizeof(T);
+      try {
+        auto ptr = new (vptr) T(sender, receiver, ttl, topic_str, payload,
+                                payload_size, storage, storage_size,
+                                std::forward<Ts>(args)...);
+        return {adopt_ref, ptr};
+      } catch (...) {
+        deallocate(vptr);
+        throw;
+      }
+    }
+
+    // Instances live in memory regions from `allocate`.
+    static void* operator new(size_t, void* ptr) noexcept {
+      return ptr;
+    }
+
+    static void operator delete(void* ptr) noexcept {
+      deallocate(ptr);
+    }
+
     uint16_t ttl() const noexcept override {
       return ttl_;
     }
@@ -211,12 +296,39 @@ public:
     size_t payload_size_;
 
     detail::monotonic_buffer_resource buf_;
+
+    static void* allocate(size_t size) {
+      return ::operator new(size, std::align_val_t{alignof(deserialized)});
+    }
+
+    static void deallocate(void* ptr) noexcept {
+      ::operator delete(ptr, std::align_val_t{alignof(deserialized)});
+    }
   };
 
 private:
   using ref_count_t = std::atomic<size_t>;
 
   alignas(BROKER_CONSTRUCTIVE_INTERFERENCE_SIZE) mutable ref_count_t ref_count_;
+
+  /// Stores the time of `mark_sampled` as nanoseconds since the epoch of the
+  /// steady clock. Zero means "not sampled".
+  mutable std::atomic<int64_t> sampled_at_{0};
+
+  /// Stores the deadline of `expire_after` as nanoseconds since the epoch of
+  /// the steady clock. Zero means "never expires".
+  mutable std::atomic<int64_t> expires_at_{0};
+
+  bool expired_slow() const noexcept;
+
+protected:
+  /// Copies the sample time and the deadline of `other`.
+  void inherit_timestamps(const envelope& other) noexcept {
+    sampled_at_.store(other.sampled_at_.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+    expires_at_.store(other.expires_at_.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+  }
 };
 
 /// A shared pointer to an @ref envelope.
@@ -2,6 +2,13 @@
 
 #include "broker/broker-test.test.hh"
 
+#include "broker/format/bin.hh"
+#include "broker/format/json.hh"
+
+#include <iterator>
+#include <string>
+#include <vector>
+
 using namespace broker;
 using namespace std::literals;
 
@@ -125,3 +132,71 @@ TEST(a JSON payload that does not contain a broker data results in an error) {
   auto maybe_envelope = envelope::deserialize_json(obj.data(), obj.size());
   CHECK(!maybe_envelope);
 }
+
+TEST(decorated envelopes keep or override the TTL) {
+  auto msg = data_envelope::make("/foo/bar", data{42});
+  auto sender = endpoint_id::random(1);
+  auto forwarded = msg->with(sender, endpoint_id::nil(), 3);
+  CHECK_EQUAL(forwarded->ttl(), 3u);
+  CHECK_EQUAL(forwarded->sender(), sender);
+  auto relabeled = forwarded->with(endpoint_id::random(2), endpoint_id::nil());
+  CHECK_EQUAL(relabeled->ttl(), 3u);
+  CHECK_EQUAL(relabeled->topic(), "/foo/bar"sv);
+}
+
+TEST(decorated envelopes inherit the latency sample of their origin) {
+  auto msg = data_envelope::make("/foo/bar", data{42});
+  CHECK(!msg->sampled());
+  CHECK(!msg->with(endpoint_id::random(1), endpoint_id::nil())->sampled());
+  msg->mark_sampled();
+  CHECK(msg->sampled());
+  auto forwarded = msg->with(endpoint_id::random(1), endpoint_id::nil());
+  CHECK(forwarded->sampled());
+  CHECK_GREATER_EQUAL(forwarded->sample_age(), 0.0);
+}
+
+TEST(data envelopes render their JSON only once) {
+  auto msg = data_envelope::make("/foo/bar", data{42});
+  std::string expected;
+  format::json::v1::encode(msg, std::back_inserter(expected));
+  auto str1 = msg->to_json();
+  CHECK_EQUAL(str1, expected);
+  auto str2 = msg->to_json();
+  CHECK_EQUAL(str1.data(), str2.data());
+}
+
+TEST(elements of a data message keep their encoded bytes) {
+  auto inner = data{vector{data{1}, data{"two"s}}};
+  auto msg = data_envelope::make("/foo/bar", data{vector{inner, data{"x"s}}});
+  auto encoded = [](const data& x) {
+    std::vector<std::byte> result;
+    format::bin::v1::encode(x, std::back_inserter(result));
+    return result;
+  };
+  auto bytes_of = [](const data_envelope_ptr& env) {
+    auto [ptr, size] = env->raw_bytes();
+    return std::vector<std::byte>(ptr, ptr + size);
+  };
+  auto elements = msg->value().to_list();
+  REQUIRE_EQUAL(elements.size(), 2u);
+  // A nested list points into the bytes of the enclosing message.
+  auto first = data_envelope::make("/foo/bar", elements[0]);
+  auto [ptr, size] = first->raw_bytes();
+  auto [msg_ptr, msg_size] = msg->raw_bytes();
+  CHECK(ptr >= msg_ptr && ptr + size <= msg_ptr + msg_size);
+  CHECK(bytes_of(first) == encoded(inner));
+  // Other values get serialized on demand.
+  auto second = data_envelope::make("/foo/bar", elements[1]);
+  CHECK(bytes_of(second) == encoded(data{"x"s}));
+}
+
+TEST(decorated envelopes inherit the deadline of their origin) {
+  auto msg = data_envelope::make("/foo/bar", data{42});
+  CHECK(!msg->has_deadline());
+  CHECK(!msg->expired());
+  msg->expire_after(timespan{0});
+  CHECK(msg->expired());
+  auto forwarded = msg->with(endpoint_id::random(1), endpoint_id::nil());
+  CHECK(forwarded->has_deadline());
+  CHECK(forwarded->expired());
+}
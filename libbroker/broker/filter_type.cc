@@ -1,6 +1,7 @@
 #include "broker/filter_type.hh"
 
 #include <algorithm>
+#include <iterator>
 
 namespace broker {
 
@@ -22,6 +23,13 @@ extend_mode mode(filter_type& f, const topic& x) {
   return extend_mode::append;
 }
 
+/// Returns `xs` sorted and without duplicates.
+filter_type sorted(filter_type xs) {
+  std::sort(xs.begin(), xs.end());
+  xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+  return xs;
+}
+
 } // namespace
 
 bool filter_extend(filter_type& f, const topic& x) {
@@ -50,4 +58,33 @@ bool filter_extend(filter_type& f, const filter_type& other) {
   return count > 0;
 }
 
+filter_delta filter_diff(const filter_type& from, const filter_type& to) {
+  auto lhs = sorted(from);
+  auto rhs = sorted(to);
+  filter_delta result;
+  std::set_difference(rhs.begin(), rhs.end(), lhs.begin(), lhs.end(),
+                      std::back_inserter(result.added));
+  std::set_difference(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                      std::back_inserter(result.removed));
+  return result;
+}
+
+void filter_apply(filter_type& f, const filter_delta& delta) {
+  if (delta.is_snapshot()) {
+    f = delta.added;
+    return;
+  }
+  auto current = sorted(std::move(f));
+  auto added = sorted(delta.added);
+  auto removed = sorted(delta.removed);
+  filter_type remaining;
+  remaining.reserve(current.size());
+  std::set_difference(current.begin(), current.end(), removed.begin(),
+                      removed.end(), std::back_inserter(remaining));
+  f.clear();
+  f.reserve(remaining.size() + added.size());
+  std::set_union(remaining.begin(), remaining.end(), added.begin(),
+                 added.end(), std::back_inserter(f));
+}
+
 } // namespace broker
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 #include "broker/lamport_timestamp.hh"
@@ -13,12 +14,30 @@ namespace broker {
 using filter_type = std::vector<topic>;
 
 /// A set of topics with synchronized access. Enables the core actor to share
-/// its current filter with the connector.
+/// its current filter with the connector. Readers access an immutable snapshot
+/// of the filter without locking or copying. Writers create a new snapshot and
+/// publish it atomically, i.e., readers never block writers and vice versa.
 class shared_filter_type {
 public:
-  shared_filter_type() = default;
+  // -- member types -----------------------------------------------------------
 
-  shared_filter_type(filter_type filter) : filter_(std::move(filter)) {
+  /// An immutable, versioned state of the filter.
+  struct snapshot {
+    lamport_timestamp version;
+    filter_type filter;
+  };
+
+  /// A handle to an immutable state of the filter.
+  using snapshot_ptr = std::shared_ptr<const snapshot>;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  shared_filter_type() : ptr_(std::make_shared<snapshot>()) {
+    // nop
+  }
+
+  shared_filter_type(filter_type filter)
+    : ptr_(std::make_shared<snapshot>(snapshot{{}, std::move(filter)})) {
     // nop
   }
 
@@ -26,46 +45,118 @@ public:
 
   shared_filter_type& operator=(const shared_filter_type&) = delete;
 
+  // -- properties -------------------------------------------------------------
+
+  /// Returns the current state of the filter. The snapshot remains valid (and
+  /// unchanged) even if a writer publishes a new state in the meantime.
+  snapshot_ptr load() const noexcept {
+    return std::atomic_load(&ptr_);
+  }
+
   /// Reads the current value with `f`.
   template <class F>
   auto read(F&& f) const {
-    std::unique_lock guard{mtx_};
-    return f(version_, filter_);
+    auto ptr = load();
+    return f(std::as_const(ptr->version), std::as_const(ptr->filter));
   }
 
+  /// Returns a copy of the current filter.
   filter_type read() const {
-    filter_type result;
-    {
-      std::unique_lock guard{mtx_};
-      result = filter_;
-    }
-    return result;
+    return load()->filter;
   }
 
-  /// Updates the current value with `f`.
+  // -- modifiers --------------------------------------------------------------
+
+  /// Updates the current value with `f`. The function object receives a copy
+  /// of the current state and returns whether it has modified the filter. On
+  /// a change, this function publishes the new filter with an incremented
+  /// version.
+  /// @returns the result of `f`.
   template <class F>
-  auto update(F&& f) {
-    std::unique_lock guard{mtx_};
-    return f(version_, filter_);
+  bool update(F&& f) {
+    std::unique_lock guard{write_mtx_};
+    auto next = std::make_shared<snapshot>(*load());
+    if (!f(next->version, next->filter))
+      return false;
+    ++next->version;
+    std::atomic_store(&ptr_, snapshot_ptr{std::move(next)});
+    return true;
   }
 
   /// Override the current value.
   void set(lamport_timestamp version, filter_type filter) {
-    using std::swap;
-    std::unique_lock guard{mtx_};
-    version_ = version;
-    swap(filter, filter_);
+    auto next = std::make_shared<snapshot>(
+      snapshot{version, std::move(filter)});
+    std::unique_lock guard{write_mtx_};
+    std::atomic_store(&ptr_, snapshot_ptr{std::move(next)});
   }
 
 private:
-  mutable std::mutex mtx_;
-  lamport_timestamp version_;
-  filter_type filter_;
+  /// Serializes writers. Readers never acquire this mutex.
+  std::mutex write_mtx_;
+
+  /// Points to the current state. Must be accessed via `std::atomic_load` and
+  /// `std::atomic_store` only.
+  snapshot_ptr ptr_;
 };
 
 /// @relates shared_filter_type
 using shared_filter_ptr = std::shared_ptr<shared_filter_type>;
 
+/// An incremental change to a filter. Peers exchange deltas to avoid sending
+/// the entire filter on each change.
+struct filter_delta {
+  /// The version of the filter before applying this change. A base version of
+  /// zero marks a full snapshot, i.e., `added` contains the entire filter.
+  lamport_timestamp base{0};
+
+  /// The version of the filter after applying this change.
+  lamport_timestamp version{0};
+
+  /// Topics that the new version adds to the filter.
+  filter_type added;
+
+  /// Topics that the new version removes from the filter.
+  filter_type removed;
+
+  /// Asks the receiver to respond with a full snapshot instead of carrying a
+  /// change. Requests leave all other fields at their default values.
+  bool snapshot_request = false;
+
+  /// Returns whether this delta carries the entire filter.
+  bool is_snapshot() const noexcept {
+    return base.value == 0 && !snapshot_request;
+  }
+
+  /// Returns whether this delta asks the receiver for a full snapshot.
+  bool is_snapshot_request() const noexcept {
+    return snapshot_request;
+  }
+
+  /// Creates a full snapshot for `filter` at given version.
+  static filter_delta make_snapshot(lamport_timestamp version,
+                                    filter_type filter) {
+    return {lamport_timestamp{0}, version, std::move(filter), {}};
+  }
+
+  /// Creates a request for a full snapshot.
+  static filter_delta make_snapshot_request() {
+    filter_delta result;
+    result.snapshot_request = true;
+    return result;
+  }
+};
+
+/// Computes the topics that `to` adds to and removes from `from`. Leaves the
+/// versions of the result at their default values.
+/// @relates filter_delta
+filter_delta filter_diff(const filter_type& from, const filter_type& to);
+
+/// Applies the topics of `delta` to `f`, ignoring versions. For a snapshot,
+/// replaces the content of `f` with `delta.added`.
+/// @relates filter_delta
+void filter_apply(filter_type& f, const filter_delta& delta);
+
 /// Extends the filter `f` with `x` such that the filter contains the minimal
 /// set of subscriptions. For example, subscribing to `/foo/bar` does not change
 /// the filter when it already contains a subscription to `/foo`. Further,
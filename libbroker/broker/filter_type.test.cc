@@ -37,4 +37,58 @@ TEST(extending a filter with known topics does nothing) {
   CHECK_EQUAL(f, make("/foo/bar", "/foo/baz", "/zeek"));
 }
 
+TEST(filter deltas capture added and removed topics) {
+  auto from = make("/foo/bar", "/foo/baz", "/zeek");
+  auto to = make("/foo", "/zeek", "/zeek/event");
+  auto delta = filter_diff(from, to);
+  CHECK_EQUAL(delta.added, make("/foo", "/zeek/event"));
+  CHECK_EQUAL(delta.removed, make("/foo/bar", "/foo/baz"));
+  delta.base = lamport_timestamp{1};
+  filter_apply(from, delta);
+  CHECK_EQUAL(from, to);
+}
+
+TEST(applying a snapshot delta replaces the filter) {
+  auto f = make("/foo", "/bar");
+  filter_apply(f, filter_delta::make_snapshot(lamport_timestamp{7},
+                                              make("/zeek")));
+  CHECK_EQUAL(f, make("/zeek"));
+  CHECK(filter_delta::make_snapshot_request().is_snapshot_request());
+}
+
+TEST(a snapshot at version zero is not a snapshot request) {
+  auto snapshot = filter_delta::make_snapshot(lamport_timestamp{0}, {});
+  CHECK(snapshot.is_snapshot());
+  CHECK(!snapshot.is_snapshot_request());
+  auto request = filter_delta::make_snapshot_request();
+  CHECK(!request.is_snapshot());
+  CHECK(request.is_snapshot_request());
+}
+
+TEST(shared filter snapshots remain unchanged after updates) {
+  shared_filter_type uut{make("/foo")};
+  auto before = uut.load();
+  auto changed = uut.update([](auto&, auto& xs) {
+    return filter_extend(xs, topic{"/bar"});
+  });
+  CHECK(changed);
+  auto after = uut.load();
+  CHECK_EQUAL(before->filter, make("/foo"));
+  CHECK_EQUAL(after->filter, make("/bar", "/foo"));
+  CHECK_LESS(before->version, after->version);
+}
+
+TEST(shared filters only publish a new version on changes) {
+  shared_filter_type uut{make("/foo")};
+  auto before = uut.load();
+  auto changed = uut.update([](auto&, auto& xs) {
+    return filter_extend(xs, topic{"/foo/bar"});
+  });
+  CHECK(!changed);
+  CHECK_EQUAL(uut.load(), before);
+  uut.set(lamport_timestamp{42}, make("/zeek"));
+  CHECK_EQUAL(uut.read(), make("/zeek"));
+  CHECK_EQUAL(uut.load()->version, lamport_timestamp{42});
+}
+
 FIXTURE_SCOPE_END()
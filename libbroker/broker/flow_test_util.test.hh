@@ -0,0 +1,180 @@
+#pragma once
+
+#include <caf/flow/observer.hpp>
+#include <caf/flow/scoped_coordinator.hpp>
+#include <caf/flow/subscription.hpp>
+#include <caf/intrusive_ptr.hpp>
+#include <caf/make_counted.hpp>
+#include <caf/ref_counted.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "broker/data.hh"
+#include "broker/entity_id.hh"
+#include "broker/internal_command.hh"
+#include "broker/message.hh"
+
+// -- utilities for testing flow operators on node messages --------------------
+
+using string_list = std::vector<std::string>;
+
+inline std::vector<std::byte> to_bytes(const std::string& str) {
+  std::vector<std::byte> result;
+  result.resize(str.size());
+  memcpy(result.data(), str.data(), str.size());
+  return result;
+}
+
+/// Stores a label for each item without signaling any demand on its own. Pings
+/// carry their payload as label and all other messages their topic.
+class collector : public caf::ref_counted,
+                  public caf::flow::observer_impl<broker::node_message> {
+public:
+  void ref_coordinated() const noexcept final {
+    this->ref();
+  }
+
+  void deref_coordinated() const noexcept final {
+    this->deref();
+  }
+
+  friend void intrusive_ptr_add_ref(const collector* ptr) noexcept {
+    ptr->ref();
+  }
+
+  friend void intrusive_ptr_release(const collector* ptr) noexcept {
+    ptr->deref();
+  }
+
+  void on_next(const broker::node_message& item) override {
+    if (get_type(item) == broker::packed_message_type::ping) {
+      auto [bytes, size] = item->raw_bytes();
+      labels.emplace_back(reinterpret_cast<const char*>(bytes), size);
+    } else {
+      labels.emplace_back(get_topic(item));
+    }
+  }
+
+  void on_complete() override {
+    completed = true;
+  }
+
+  void on_error(const caf::error&) override {
+    failed = true;
+  }
+
+  void on_subscribe(caf::flow::subscription) override {
+    // nop
+  }
+
+  string_list labels;
+  bool completed = false;
+  bool failed = false;
+};
+
+/// Stands in for the input of the operator under test and records the demand.
+class dummy_input : public caf::ref_counted,
+                    public caf::flow::subscription_impl {
+public:
+  void ref_disposable() const noexcept final {
+    this->ref();
+  }
+
+  void deref_disposable() const noexcept final {
+    this->deref();
+  }
+
+  friend void intrusive_ptr_add_ref(const dummy_input* ptr) noexcept {
+    ptr->ref();
+  }
+
+  friend void intrusive_ptr_release(const dummy_input* ptr) noexcept {
+    ptr->deref();
+  }
+
+  bool disposed() const noexcept override {
+    return disposed_;
+  }
+
+  void dispose() override {
+    disposed_ = true;
+  }
+
+  void request(size_t n) override {
+    requested += n;
+  }
+
+  size_t requested = 0;
+
+private:
+  bool disposed_ = false;
+};
+
+/// Connects the operator under test to a `dummy_input` and a `collector`.
+template <class Sub>
+struct flow_test_base {
+  using sub_type = Sub;
+
+  caf::intrusive_ptr<collector> out = caf::make_counted<collector>();
+
+  caf::intrusive_ptr<dummy_input> in = caf::make_counted<dummy_input>();
+
+  caf::intrusive_ptr<sub_type> uut;
+
+  /// Creates the operator under test from `ctx` and `xs` and subscribes it to
+  /// `in`.
+  template <class Context, class... Ts>
+  void init(Context* ctx, Ts&&... xs) {
+    uut = caf::make_counted<sub_type>(
+      ctx, caf::flow::observer<broker::node_message>{out},
+      std::forward<Ts>(xs)...);
+    uut->on_subscribe(caf::flow::subscription{in});
+  }
+
+  void push_data(const std::string& str) {
+    uut->on_next(broker::make_data_message(str, broker::data{str}));
+  }
+
+  void push_command(const std::string& str) {
+    using namespace broker;
+    auto nil = entity_id::nil();
+    uut->on_next(make_command_message(
+      str, internal_command{0, nil, nil, clear_command{nil}}));
+  }
+
+  void push_ping(const std::string& str) {
+    using broker::endpoint_id;
+    auto token = to_bytes(str);
+    uut->on_next(broker::make_ping_message(endpoint_id::random(),
+                                           endpoint_id::random(), token.data(),
+                                           token.size()));
+  }
+
+  /// Returns and clears the labels of all items that `out` received so far.
+  string_list take() {
+    return std::move(out->labels);
+  }
+};
+
+/// Runs the operator under test on a scoped coordinator.
+template <class Sub>
+struct flow_fixture : flow_test_base<Sub> {
+  using super = flow_test_base<Sub>;
+
+  caf::flow::scoped_coordinator_ptr ctx = caf::flow::make_scoped_coordinator();
+
+  template <class... Ts>
+  void init(Ts&&... xs) {
+    super::init(ctx.get(), std::forward<Ts>(xs)...);
+  }
+
+  /// Signals demand for `n` items and returns what reaches the observer.
+  string_list drain(size_t n = 100) {
+    this->uut->request(n);
+    ctx->run();
+    return this->take();
+  }
+};
@@ -33,14 +33,15 @@ double float64_from_network_representation(uint64_t value) {
   return caf::detail::unpack754(value);
 }
 
-bool read_varbyte(const_byte_pointer& first, const_byte_pointer last,
-                  size_t& result) {
+bool read_varbyte_impl(const_byte_pointer& first, const_byte_pointer last,
+                       size_t& result) {
   // Use varbyte encoding to compress sequence size on the wire.
   uint32_t x = 0;
-  int n = 0;
+  size_t n = 0;
   uint8_t low7 = 0;
   do {
-    if (first == last)
+    // Reject values that do not fit into 32 bits.
+    if (first == last || n == max_varbyte32_size)
       return false;
     low7 = static_cast<uint8_t>(*first++);
     x |= static_cast<uint32_t>((low7 & 0x7F)) << (7 * n);
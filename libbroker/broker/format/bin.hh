@@ -2,6 +2,7 @@
 
 #include "broker/config.hh"
 #include "broker/data.hh"
+#include "broker/detail/append_range.hh"
 #include "broker/detail/type_traits.hh"
 #include "broker/variant.hh"
 #include "broker/variant_data.hh"
@@ -64,9 +65,23 @@ constexpr size_t max_varbyte_size = 10;
 /// A pointer that a sequence of bytes.
 using const_byte_pointer = const std::byte*;
 
+/// The maximum size of a varbyte-encoded 32-bit value.
+constexpr size_t max_varbyte32_size = 5;
+
+/// Reads a multi-byte value in varbyte encoding. Called by `read_varbyte`.
+bool read_varbyte_impl(const_byte_pointer& first, const_byte_pointer last,
+                       size_t& result);
+
 /// Reads a size_t from a byte sequence using varbyte encoding.
-bool read_varbyte(const_byte_pointer& first, const_byte_pointer last,
-                  size_t& result);
+inline bool read_varbyte(const_byte_pointer& first, const_byte_pointer last,
+                         size_t& result) {
+  // Fast path for values below 128, which covers almost all sizes in practice.
+  if (first != last && (static_cast<uint8_t>(*first) & 0x80) == 0) {
+    result = static_cast<uint8_t>(*first++);
+    return true;
+  }
+  return read_varbyte_impl(first, last, result);
+}
 
 template <class OutIter>
 struct value_type_oracle {
@@ -109,6 +124,10 @@ inline size_t varbyte_size(size_t value) {
 /// Encodes `value` to a variable-length byte sequence and appends it to `out`.
 template <class OutIter>
 OutIter write_varbyte(size_t value, OutIter out) {
+  if (value < 0x80) {
+    *out++ = static_cast<iter_value_t<OutIter>>(value);
+    return out;
+  }
   return write_varbyte_impl(value, [out](auto* begin, auto* end) {
     using value_type = iter_value_t<OutIter>;
     return std::copy(reinterpret_cast<value_type*>(begin),
@@ -116,6 +135,15 @@ OutIter write_varbyte(size_t value, OutIter out) {
   });
 }
 
+/// Copies the bytes in `[first, last)` to `out`.
+template <class T, class OutIter>
+OutIter write_bytes(const T* first, const T* last, OutIter out) {
+  static_assert(sizeof(T) == 1);
+  using val_t = iter_value_t<OutIter>;
+  return detail::append_range(reinterpret_cast<const val_t*>(first),
+                              reinterpret_cast<const val_t*>(last), out);
+}
+
 /// Encodes `value` to its binary representation and appends it to `out`.
 template <class T, class OutIter>
 OutIter write_unsigned(T value, OutIter out) {
@@ -126,21 +154,13 @@ OutIter write_unsigned(T value, OutIter out) {
     auto tmp = to_network_order(value);
     iter_value_t<OutIter> buf[sizeof(T)];
     memcpy(buf, &tmp, sizeof(T));
-    return std::copy(buf, buf + sizeof(T), out);
+    return write_bytes(buf, buf + sizeof(T), out);
   } else {
     *out++ = static_cast<iter_value_t<OutIter>>(value);
     return out;
   }
 }
 
-template <class T, class OutIter>
-OutIter write_bytes(const T* first, const T* last, OutIter out) {
-  static_assert(sizeof(T) == 1);
-  using val_t = iter_value_t<OutIter>;
-  return std::copy(reinterpret_cast<const val_t*>(first),
-                   reinterpret_cast<const val_t*>(last), out);
-}
-
 template <class Container, class OutIter>
 OutIter write_bytes(const Container& in, OutIter out) {
   return write_bytes(in.data(), in.data() + in.size(), out);
@@ -254,6 +274,57 @@ OutIter encode(enum_value_view value, OutIter out) {
   return write_bytes(value.name, out);
 }
 
+/// Returns the number of bytes that `encode` writes for `value`. Fixed-size
+/// types compute their size at compile time.
+inline constexpr size_t encoded_size(none) noexcept {
+  return 0;
+}
+
+/// @copydoc encoded_size
+template <class T>
+constexpr std::enable_if_t<std::is_arithmetic_v<T>, size_t>
+encoded_size(T) noexcept {
+  return sizeof(T);
+}
+
+/// @copydoc encoded_size
+inline size_t encoded_size(std::string_view value) {
+  return varbyte_size(value.size()) + value.size();
+}
+
+/// @copydoc encoded_size
+inline constexpr size_t encoded_size(const address&) noexcept {
+  return 16;
+}
+
+/// @copydoc encoded_size
+inline constexpr size_t encoded_size(const subnet&) noexcept {
+  return 17;
+}
+
+/// @copydoc encoded_size
+inline size_t encoded_size(port) noexcept {
+  return 3;
+}
+
+/// @copydoc encoded_size
+template <class Rep, class Period>
+constexpr size_t encoded_size(std::chrono::duration<Rep, Period>) noexcept {
+  return sizeof(Rep);
+}
+
+/// @copydoc encoded_size
+template <class Clock, class Duration>
+constexpr size_t
+encoded_size(std::chrono::time_point<Clock, Duration>) noexcept {
+  return sizeof(typename Duration::rep);
+}
+
+/// @copydoc encoded_size
+inline size_t encoded_size(enum_value_view value) {
+  return encoded_size(value.name);
+}
+
 template <class OutIter>
 OutIter encode(const variant_data& value, OutIter out);
 
@@ -306,7 +377,8 @@ OutIter encode(const variant_table& values, OutIter out) {
 template <class OutIter>
 OutIter encode(const variant_data& value, OutIter out) {
   out = write_unsigned(value.get_tag(), out);
-  return std::visit([&](const auto& x) { return encode(x, out); }, value.value);
+  return std::visit([&](const auto& x) { return encode(x, out); },
+                    value.stl_value());
 }
 
 // Note: enable_if trickery to suppress implicit conversions.
@@ -464,4 +536,42 @@ auto encode_with_tag(const T& x, OutIter out) -> decltype(encode(x, out)) {
   return encode(x, write_unsigned(data_tag_v<T>, out));
 }
 
+// -- batches of pre-encoded data messages -------------------------------------
+
+/// Appends a record for a batch of pre-encoded data messages to `out`. A
+/// record consists of the topic size (varbyte), the topic, the payload size
+/// (varbyte) and the payload, i.e., a value as written by `encode`.
+template <class OutIter>
+OutIter encode_record(std::string_view topic, const std::byte* payload,
+                      size_t payload_size, OutIter out) {
+  out = write_varbyte(topic.size(), out);
+  out = write_bytes(topic.data(), topic.data() + topic.size(), out);
+  out = write_varbyte(payload_size, out);
+  return write_bytes(payload, payload + payload_size, out);
+}
+
+/// Calls `f(topic, payload, payload_size)` for each record in `[first, last)`
+/// until reaching the end of the range or a truncated record. Only checks the
+/// framing, i.e., does not parse the payloads.
+/// @returns `true` if `[first, last)` contains only complete records.
+template <class F>
+bool decode_records(const_byte_pointer first, const_byte_pointer last, F&& f) {
+  auto read_size = [&first, last](size_t& len) {
+    return read_varbyte(first, last, len)
+           && static_cast<size_t>(last - first) >= len;
+  };
+  while (first != last) {
+    size_t len = 0;
+    if (!read_size(len))
+      return false;
+    auto topic = std::string_view{reinterpret_cast<const char*>(first), len};
+    first += len;
+    if (!read_size(len))
+      return false;
+    f(topic, first, len);
+    first += len;
+  }
+  return true;
+}
+
 } // namespace broker::format::bin::v1
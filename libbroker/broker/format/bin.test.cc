@@ -140,3 +140,69 @@ TEST(the encoder emits the same output for data as a binary serializer) {
     123, {eid, 1}, {eid, 2}, {retransmit_failed_command{42}}}));
   CHECK_EQ_ENCODE_OBJ(network_info("192.168.9.2", 8080, timeout::seconds{1}));
 }
+
+TEST(varbyte values roundtrip) {
+  using format::bin::v1::read_varbyte;
+  using format::bin::v1::varbyte_size;
+  using format::bin::v1::write_varbyte;
+  for (size_t value : {0u, 1u, 127u, 128u, 300u, 16384u, 0xFFFFFFFFu}) {
+    std::vector<std::byte> buf;
+    write_varbyte(value, std::back_inserter(buf));
+    CHECK_EQ(buf.size(), varbyte_size(value));
+    auto pos = static_cast<const std::byte*>(buf.data());
+    size_t result = 0;
+    if (CHECK(read_varbyte(pos, buf.data() + buf.size(), result))) {
+      CHECK_EQ(result, value);
+      CHECK_EQ(pos, buf.data() + buf.size());
+    }
+  }
+}
+
+TEST(read_varbyte rejects truncated and oversized values) {
+  using format::bin::v1::read_varbyte;
+  size_t result = 0;
+  auto truncated = std::vector<std::byte>{std::byte{0x80}, std::byte{0x80}};
+  auto pos = static_cast<const std::byte*>(truncated.data());
+  CHECK(!read_varbyte(pos, truncated.data() + truncated.size(), result));
+  auto oversized = std::vector<std::byte>(6, std::byte{0x80});
+  oversized.push_back(std::byte{0x01});
+  pos = oversized.data();
+  CHECK(!read_varbyte(pos, oversized.data() + oversized.size(), result));
+}
+
+TEST(encode appends strings to byte buffers and strings alike) {
+  auto str = std::string(1000, 'x');
+  std::vector<caf::byte> bytes{caf::byte{0xFF}};
+  format::bin::v1::encode(std::string_view{str}, std::back_inserter(bytes));
+  std::string chars(1, '\xFF');
+  format::bin::v1::encode(std::string_view{str}, std::back_inserter(chars));
+  REQUIRE_EQ(bytes.size(), chars.size());
+  CHECK_EQ(bytes.size(), str.size() + 3);
+  CHECK(memcmp(bytes.data(), chars.data(), bytes.size()) == 0);
+  CHECK_EQ(bytes[0], caf::byte{0xFF});
+}
+
+TEST(records of pre-encoded messages roundtrip) {
+  using format::bin::v1::decode_records;
+  using format::bin::v1::encode_record;
+  auto payload = std::vector<std::byte>(200, std::byte{0x2A});
+  std::vector<std::byte> batch;
+  encode_record("foo", payload.data(), 3, std::back_inserter(batch));
+  encode_record("bar/baz", payload.data(), payload.size(),
+                std::back_inserter(batch));
+  std::vector<std::pair<std::string, size_t>> records;
+  auto add = [&records](std::string_view topic, const std::byte*,
+                        size_t size) {
+    records.emplace_back(std::string{topic}, size);
+  };
+  CHECK(decode_records(batch.data(), batch.data() + batch.size(), add));
+  REQUIRE_EQ(records.size(), 2u);
+  CHECK_EQ(records[0].first, "foo");
+  CHECK_EQ(records[0].second, 3u);
+  CHECK_EQ(records[1].first, "bar/baz");
+  CHECK_EQ(records[1].second, 200u);
+  MESSAGE("truncated records stop the decoder");
+  records.clear();
+  CHECK(!decode_records(batch.data(), batch.data() + batch.size() - 1, add));
+  CHECK_EQ(records.size(), 1u);
+}
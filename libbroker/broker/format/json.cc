@@ -6,13 +6,11 @@
 #include "broker/internal/json.hh"
 #include "broker/variant.hh"
 
-#include <caf/expected.hpp>
-#include <caf/json_object.hpp>
-#include <caf/json_value.hpp>
-
 #include <cassert>
 #include <chrono>
 #include <ctime>
+#include <string>
+#include <vector>
 
 namespace broker::format::json::v1 {
 
@@ -51,15 +49,13 @@ size_t encode_to_buf(timestamp value, std::array<char, 32>& buf) {
 }
 
 error decode(std::string_view str, variant& result) {
-  // Parse the JSON text into a JSON object.
-  auto val = caf::json_value::parse_shallow(str);
-  if (!val)
-    return error{ec::invalid_json};
-  auto obj = val->to_object();
-  // Try to convert the JSON structure into our binary serialization format.
+  // Convert the JSON text to our binary serialization format.
+  std::string type_str;
+  std::string topic_str;
   std::vector<std::byte> buf;
   buf.reserve(512); // Allocate some memory to avoid small allocations.
-  if (auto err = internal::json::data_message_to_binary(obj, buf))
+  if (auto err = internal::json::data_message_to_binary(str, type_str,
+                                                        topic_str, buf))
     return err;
   // Turn the binary data into a data envelope. TTL and sender/receiver are
   // not part of the JSON representation, so we use defaults values.
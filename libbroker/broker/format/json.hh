@@ -2,13 +2,16 @@
 
 #include "broker/config.hh"
 #include "broker/data.hh"
+#include "broker/detail/append_range.hh"
 #include "broker/fwd.hh"
 #include "broker/message.hh"
 
 #include <algorithm>
 #include <array>
+#include <charconv>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <string_view>
 #include <vector>
 
@@ -25,7 +28,7 @@ struct render_embedded {};
 /// Appends a string to the output iterator.
 template <class OutIter>
 OutIter append(std::string_view str, OutIter out) {
-  return std::copy(str.begin(), str.end(), out);
+  return detail::append_range(str.begin(), str.end(), out);
 }
 
 /// Tag type for selecting the `quoted` overload of `append_encoded`.
@@ -33,50 +36,52 @@ struct quoted {
   std::string_view str;
 };
 
+/// Checks whether `c` requires an escape sequence in a quoted string.
+constexpr bool needs_escaping(char c) noexcept {
+  // Covers '\b', '\t', '\n', '\v', '\f' and '\r', which are consecutive.
+  return static_cast<unsigned char>(c - '\b') <= '\r' - '\b' || c == '"'
+         || c == '\\';
+}
+
 /// Appends a quoted string to the output iterator. Special characters are
 /// escaped.
 template <class OutIter>
 OutIter append(quoted value, OutIter out) {
-  using namespace std::literals;
   *out++ = '"';
-  for (auto c : value.str) {
-    switch (c) {
-      default:
-        *out++ = c;
-        break;
-      case '\\':
-        *out++ = '\\';
-        *out++ = '\\';
+  // Copy runs of regular characters in bulk and only escape special
+  // characters individually.
+  auto first = value.str.data();
+  auto last = first + value.str.size();
+  for (;;) {
+    auto i = std::find_if(first, last, needs_escaping);
+    out = append(std::string_view{first, static_cast<size_t>(i - first)}, out);
+    if (i == last)
+      break;
+    *out++ = '\\';
+    switch (*i) {
+      default: // '"' or '\\'
+        *out++ = *i;
         break;
       case '\b':
-        *out++ = '\\';
         *out++ = 'b';
         break;
       case '\f':
-        *out++ = '\\';
         *out++ = 'f';
         break;
       case '\n':
-        *out++ = '\\';
         *out++ = 'n';
         break;
       case '\r':
-        *out++ = '\\';
         *out++ = 'r';
         break;
       case '\t':
-        *out++ = '\\';
         *out++ = 't';
         break;
       case '\v':
-        *out++ = '\\';
         *out++ = 'v';
         break;
-      case '"':
-        *out++ = '\\';
-        *out++ = '"';
-        break;
     }
+    first = i + 1;
   }
   *out++ = '"';
   return out;
@@ -116,27 +121,23 @@ OutIter encode(none, OutIter out) {
 }
 
 /// Renders a boolean, `count` or `integer` value to `out`. The latter two are
-/// rendered using `snprintf`, whereas boolean values are rendered as `true` or
-/// `false`.
+/// rendered using `std::to_chars`, whereas boolean values are rendered as
+/// `true` or `false`.
 template <class Policy = render_object, class T, class OutIter>
 std::enable_if_t<std::is_integral_v<T>, OutIter> encode(T value, OutIter out) {
   using namespace std::literals;
   if constexpr (std::is_same_v<T, bool>) {
     return append_encoded<Policy>("boolean", value ? "true"sv : "false"sv, out);
-  } else if constexpr (std::is_same_v<T, count>) {
-    // An integer can at most have 20 digits (UINT64_MAX).
-    char buf[24];
-    auto size = std::snprintf(buf, 24, "%llu",
-                              static_cast<long long unsigned>(value));
-    auto str = std::string_view{buf, static_cast<size_t>(size)};
-    return append_encoded<Policy>("count", str, out);
   } else {
-    static_assert(std::is_same_v<T, integer>);
-    // An integer can at most have 20 digits (UINT64_MAX).
+    static_assert(std::is_same_v<T, count> || std::is_same_v<T, integer>);
+    // An integer can at most have 20 digits (UINT64_MAX) plus a sign.
     char buf[24];
-    auto size = std::snprintf(buf, 24, "%lld", static_cast<long long>(value));
-    auto str = std::string_view{buf, static_cast<size_t>(size)};
-    return append_encoded<Policy>("integer", str, out);
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    auto str = std::string_view{buf, static_cast<size_t>(res.ptr - buf)};
+    if constexpr (std::is_same_v<T, count>)
+      return append_encoded<Policy>("count", str, out);
+    else
+      return append_encoded<Policy>("integer", str, out);
   }
 }
 
@@ -144,17 +145,18 @@ std::enable_if_t<std::is_integral_v<T>, OutIter> encode(T value, OutIter out) {
 /// digits), e.g., `0.123456`.
 template <class Policy = render_object, class OutIter>
 OutIter encode(real value, OutIter out) {
-  auto size = std::snprintf(nullptr, 0, "%f", value);
-  if (size < 24) {
-    char buf[24];
-    size = std::snprintf(buf, 24, "%f", value);
+  // Try a stack buffer first and only compute the required size for values
+  // that do not fit.
+  char buf[24];
+  auto size = std::snprintf(buf, sizeof(buf), "%f", value);
+  if (size < static_cast<int>(sizeof(buf))) {
     auto str = std::string_view{buf, static_cast<size_t>(size)};
     return append_encoded<Policy>("real", str, out);
   } else {
-    std::vector<char> buf;
-    buf.resize(static_cast<size_t>(size) + 1); // +1 for the null terminator
-    size = std::snprintf(buf.data(), size + 1, "%f", value);
-    auto str = std::string_view{buf.data(), static_cast<size_t>(size)};
+    std::vector<char> heap_buf;
+    heap_buf.resize(static_cast<size_t>(size) + 1); // +1 for the terminator
+    size = std::snprintf(heap_buf.data(), size + 1, "%f", value);
+    auto str = std::string_view{heap_buf.data(), static_cast<size_t>(size)};
     return append_encoded<Policy>("real", str, out);
   }
 }
@@ -212,13 +214,16 @@ OutIter encode(timestamp value, OutIter out) {
 template <class Policy = render_object, class OutIter>
 OutIter encode(timespan value, OutIter out) {
   using namespace std::literals;
-  // Helper function to print the value with a suffix via snprintf.
-  auto do_encode = [&out](long long val, const char* suffix) {
+  // Helper function to print the value with a suffix as quoted string.
+  auto do_encode = [&out](long long val, std::string_view suffix) {
     // An integer can at most have 20 digits (UINT64_MAX) and our suffix may
     // only be 2 characters long.
     char buf[32];
-    auto size = std::snprintf(buf, 32, R"_("%lld%s")_", val, suffix);
-    auto str = std::string_view{buf, static_cast<size_t>(size)};
+    buf[0] = '"';
+    auto res = std::to_chars(buf + 1, buf + 24, val);
+    auto pos = std::copy(suffix.begin(), suffix.end(), res.ptr);
+    *pos++ = '"';
+    auto str = std::string_view{buf, static_cast<size_t>(pos - buf)};
     return append_encoded<Policy>("timespan", str, out);
   };
   // Short-circuit for zero. Always prints "0s".
@@ -314,7 +319,7 @@ std::enable_if_t<std::is_same_v<data, Data>, OutIter> encode(const Data& value,
 template <class Policy = render_object, class OutIter>
 OutIter encode(const variant_data& value, OutIter out) {
   return std::visit([&](auto&& x) { return encode<Policy>(x, out); },
-                    value.value);
+                    value.stl_value());
 }
 
 /// Renders a `data` object to `out` by dispatching to the appropriate overload
@@ -76,6 +76,8 @@ TEST(count) {
   CHECK_EQUAL(to_v1(count{100}), R"_({"@data-type":"count","data":100})_");
   CHECK_EQUAL(to_v1(data{count{0}}), R"_({"@data-type":"count","data":0})_");
   CHECK_EQUAL(to_v1(data{count{10}}), R"_({"@data-type":"count","data":10})_");
+  CHECK_EQUAL(to_v1(count{18446744073709551615u}),
+              R"_({"@data-type":"count","data":18446744073709551615})_");
 }
 
 TEST(integer) {
@@ -133,6 +135,19 @@ TEST(string) {
   CHECK_EQUAL(to_v1(data{foobar}), foobar_res);
 }
 
+TEST(string escaping) {
+  auto special = "\\\b\f\n\r\t\v\""s;
+  auto special_res = R"_({"@data-type":"string","data":"\\\b\f\n\r\t\v\""})_";
+  CHECK_EQUAL(to_v1(special), special_res);
+  auto mixed = "key=\"value\"\tnext"s;
+  auto mixed_res =
+    R"_({"@data-type":"string","data":"key=\"value\"\tnext"})_";
+  CHECK_EQUAL(to_v1(mixed), mixed_res);
+  auto long_str = std::string(1000, 'x');
+  CHECK_EQUAL(to_v1(long_str),
+              R"_({"@data-type":"string","data":")_" + long_str + "\"}");
+}
+
 TEST(address) {
   CHECK_EQUAL(to_v1(addr("192.128.4.4")),
               R"_({"@data-type":"address","data":"192.128.4.4"})_");
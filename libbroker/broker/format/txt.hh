@@ -164,7 +164,8 @@ OutIter encode(const variant_data::list* values, OutIter out) {
 
 template <class OutIter>
 OutIter encode(const variant_data& value, OutIter out) {
-  return std::visit([&](auto&& x) { return encode(x, out); }, value.value);
+  return std::visit([&](auto&& x) { return encode(x, out); },
+                    value.stl_value());
 }
 
 // Unfortunately, broker::data is a nasty type due to its implicit conversions.
@@ -42,6 +42,8 @@ struct cumulative_ack_command;
 struct nack_command;
 struct keepalive_command;
 struct retransmit_failed_command;
+struct batch_command;
+struct snapshot_chunk_command;
 
 using publisher_id [[deprecated("use entity_id instead")]] = entity_id;
 
@@ -67,11 +69,14 @@ class publisher;
 class routing_update_envelope;
 class set_builder;
 class shared_filter_type;
+class shared_publisher;
 class shutdown_options;
 class status;
+class sharded_store;
 class store;
 class subnet;
 class subscriber;
+class subscriber_group;
 class table_builder;
 class topic;
 class variant;
@@ -98,6 +103,7 @@ enum class backend : uint8_t;
 enum class ec : uint8_t;
 enum class p2p_message_type : uint8_t;
 enum class sc : uint8_t;
+enum class value_query : uint8_t;
 enum class variant_tag : uint8_t;
 
 // -- STD type aliases ---------------------------------------------------------
@@ -118,7 +124,8 @@ using internal_command_variant =
                erase_command, expire_command, add_command, subtract_command,
                clear_command, attach_writer_command, keepalive_command,
                cumulative_ack_command, nack_command, ack_clone_command,
-               retransmit_failed_command>;
+               retransmit_failed_command, batch_command,
+               snapshot_chunk_command>;
 
 // -- arithmetic type aliases --------------------------------------------------
 
@@ -191,5 +198,7 @@ class HandleAndRelayEvent;
 class LogCreate;
 class LogWrite;
 class IdentifierUpdate;
+class CompactEvent;
+class EventRegistry;
 
 } // namespace broker::zeek
@@ -0,0 +1,285 @@
+#include "broker/internal/async_backend.hh"
+
+#include "broker/internal/logger.hh"
+
+#include <vector>
+
+namespace broker::internal {
+
+async_backend::async_backend(backend_pointer decorated)
+  : decorated_(std::move(decorated)) {
+  thread_ = std::thread{[this] { run(); }};
+}
+
+async_backend::~async_backend() {
+  {
+    std::lock_guard guard{mtx_};
+    shutting_down_ = true;
+  }
+  wakeup_.notify_all();
+  // The I/O thread writes all pending modifications before returning.
+  thread_.join();
+}
+
+// -- modifiers ----------------------------------------------------------------
+
+expected<void> async_backend::put(const data& key, data value,
+                                  std::optional<timestamp> expiry) {
+  std::lock_guard guard{mtx_};
+  auto seq = ++seq_;
+  overlay_.insert_or_assign(key, overlay_entry{std::move(value), expiry, seq});
+  enqueue({op_type::write, key, seq});
+  return take_error();
+}
+
+expected<void> async_backend::erase(const data& key) {
+  std::lock_guard guard{mtx_};
+  auto seq = ++seq_;
+  overlay_.insert_or_assign(key,
+                            overlay_entry{std::nullopt, std::nullopt, seq});
+  enqueue({op_type::write, key, seq});
+  return take_error();
+}
+
+expected<void> async_backend::clear() {
+  drain();
+  {
+    std::lock_guard guard{backend_mtx_};
+    if (auto res = decorated_->clear(); !res)
+      return res;
+  }
+  std::lock_guard guard{mtx_};
+  return take_error();
+}
+
+expected<bool> async_backend::expire(const data& key, timestamp current_time) {
+  std::unique_lock guard{mtx_};
+  if (auto i = overlay_.find(key); i != overlay_.end()) {
+    auto& entry = i->second;
+    if (!entry.value || !entry.expiry || current_time < *entry.expiry)
+      return false;
+    entry.value.reset();
+    entry.expiry.reset();
+    entry.seq = ++seq_;
+    enqueue({op_type::write, key, entry.seq});
+    return true;
+  }
+  // The decorated backend has the latest state of the key.
+  guard.unlock();
+  std::lock_guard backend_guard{backend_mtx_};
+  return decorated_->expire(key, current_time);
+}
+
+expected<void> async_backend::begin_transaction() {
+  std::lock_guard guard{mtx_};
+  enqueue({op_type::begin_transaction, data{}, 0});
+  return take_error();
+}
+
+expected<void> async_backend::commit_transaction() {
+  std::lock_guard guard{mtx_};
+  enqueue({op_type::commit_transaction, data{}, 0});
+  return take_error();
+}
+
+expected<void> async_backend::abort_transaction() {
+  std::lock_guard guard{mtx_};
+  enqueue({op_type::abort_transaction, data{}, 0});
+  return take_error();
+}
+
+expected<void> async_backend::flush() {
+  std::lock_guard guard{mtx_};
+  enqueue({op_type::flush, data{}, 0});
+  return take_error();
+}
+
+void async_backend::release_memory() {
+  std::lock_guard guard{backend_mtx_};
+  decorated_->release_memory();
+}
+
+// -- inspectors ---------------------------------------------------------------
+
+expected<data> async_backend::get(const data& key) const {
+  {
+    std::lock_guard guard{mtx_};
+    if (auto i = overlay_.find(key); i != overlay_.end()) {
+      if (!i->second.value)
+        return ec::no_such_key;
+      return *i->second.value;
+    }
+  }
+  std::lock_guard guard{backend_mtx_};
+  return decorated_->get(key);
+}
+
+expected<bool> async_backend::exists(const data& key) const {
+  {
+    std::lock_guard guard{mtx_};
+    if (auto i = overlay_.find(key); i != overlay_.end())
+      return i->second.value.has_value();
+  }
+  std::lock_guard guard{backend_mtx_};
+  return decorated_->exists(key);
+}
+
+expected<uint64_t> async_backend::size() const {
+  drain();
+  std::lock_guard guard{backend_mtx_};
+  return decorated_->size();
+}
+
+expected<data> async_backend::keys() const {
+  drain();
+  std::lock_guard guard{backend_mtx_};
+  return decorated_->keys();
+}
+
+expected<data> async_backend::range(const data& first, const data& last,
+                                    size_t limit) const {
+  drain();
+  std::lock_guard guard{backend_mtx_};
+  return decorated_->range(first, last, limit);
+}
+
+expected<data> async_backend::keys_with_prefix(const std::string& prefix,
+                                               size_t limit) const {
+  drain();
+  std::lock_guard guard{backend_mtx_};
+  return decorated_->keys_with_prefix(prefix, limit);
+}
+
+expected<broker::snapshot> async_backend::snapshot() const {
+  drain();
+  std::lock_guard guard{backend_mtx_};
+  return decorated_->snapshot();
+}
+
+expected<void> async_backend::for_each(const detail::entry_visitor& f) const {
+  drain();
+  std::lock_guard guard{backend_mtx_};
+  return decorated_->for_each(f);
+}
+
+expected<detail::expirables> async_backend::expiries() const {
+  drain();
+  std::lock_guard guard{backend_mtx_};
+  return decorated_->expiries();
+}
+
+expected<detail::expirables>
+async_backend::expiries_between(timestamp first, timestamp last) const {
+  drain();
+  std::lock_guard guard{backend_mtx_};
+  return decorated_->expiries_between(first, last);
+}
+
+// -- properties ---------------------------------------------------------------
+
+size_t async_backend::pending() const {
+  std::lock_guard guard{mtx_};
+  return overlay_.size();
+}
+
+// -- private utility ----------------------------------------------------------
+
+void async_backend::enqueue(op x) {
+  queue_.emplace_back(std::move(x));
+  wakeup_.notify_one();
+}
+
+expected<void> async_backend::take_error() {
+  if (!error_)
+    return {};
+  auto err = std::move(error_);
+  error_ = error{};
+  return err;
+}
+
+void async_backend::drain() const {
+  std::unique_lock guard{mtx_};
+  idle_.wait(guard, [this] { return queue_.empty() && !busy_; });
+}
+
+void async_backend::run() {
+  struct write_op {
+    op_type type;
+    data key;
+    std::optional<data> value;
+    std::optional<timestamp> expiry;
+    uint64_t seq;
+  };
+  std::vector<write_op> batch;
+  std::unique_lock guard{mtx_};
+  for (;;) {
+    wakeup_.wait(guard, [this] { return !queue_.empty() || shutting_down_; });
+    if (queue_.empty())
+      return;
+    // Copy the state of each key while holding the lock, since the overlay
+    // may change as soon as we release it. Writes that a later modification
+    // superseded carry an outdated sequence number and we skip them.
+    busy_ = true;
+    batch.clear();
+    for (auto& x : queue_) {
+      if (x.type != op_type::write) {
+        batch.push_back({x.type, data{}, std::nullopt, std::nullopt, 0});
+        continue;
+      }
+      auto i = overlay_.find(x.key);
+      if (i == overlay_.end() || i->second.seq != x.seq)
+        continue;
+      batch.push_back({x.type, std::move(x.key), i->second.value,
+                       i->second.expiry, x.seq});
+    }
+    queue_.clear();
+    guard.unlock();
+    error err;
+    {
+      std::lock_guard backend_guard{backend_mtx_};
+      for (auto& x : batch) {
+        expected<void> res;
+        switch (x.type) {
+          case op_type::write:
+            if (x.value)
+              res = decorated_->put(x.key, std::move(*x.value), x.expiry);
+            else
+              res = decorated_->erase(x.key);
+            break;
+          case op_type::begin_transaction:
+            res = decorated_->begin_transaction();
+            break;
+          case op_type::commit_transaction:
+            res = decorated_->commit_transaction();
+            break;
+          case op_type::abort_transaction:
+            res = decorated_->abort_transaction();
+            break;
+          case op_type::flush:
+            res = decorated_->flush();
+            break;
+        }
+        if (!res && !err) {
+          BROKER_ERROR("failed to write to the backend:" << res.error());
+          err = std::move(res.error());
+        }
+      }
+    }
+    guard.lock();
+    // Drop overlay entries unless the master modified the key again.
+    for (auto& x : batch) {
+      if (x.type != op_type::write)
+        continue;
+      if (auto i = overlay_.find(x.key);
+          i != overlay_.end() && i->second.seq == x.seq)
+        overlay_.erase(i);
+    }
+    if (err && !error_)
+      error_ = std::move(err);
+    busy_ = false;
+    if (queue_.empty())
+      idle_.notify_all();
+  }
+}
+
+} // namespace broker::internal
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "broker/detail/abstract_backend.hh"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+
+namespace broker::internal {
+
+/// Decorates a backend for writing to it from a dedicated I/O thread.
+///
+/// Modifications return immediately. The decorator keeps the latest state of
+/// each modified key in an overlay until the I/O thread has written it, which
+/// lets reads of these keys bypass the decorated backend. The I/O thread
+/// applies all pending modifications in one go and skips modifications that a
+/// later modification of the same key superseded.
+///
+/// Operations that need the full state of the backend (e.g., `size`, `keys`
+/// or `snapshot`) wait until the I/O thread has written all pending
+/// modifications. When writing fails, the next modifier returns the error.
+class async_backend : public detail::abstract_backend {
+public:
+  using backend_pointer = std::unique_ptr<detail::abstract_backend>;
+
+  explicit async_backend(backend_pointer decorated);
+
+  ~async_backend() override;
+
+  // -- modifiers --------------------------------------------------------------
+
+  expected<void> put(const data& key, data value,
+                     std::optional<timestamp> expiry) override;
+
+  expected<void> erase(const data& key) override;
+
+  expected<void> clear() override;
+
+  expected<bool> expire(const data& key, timestamp current_time) override;
+
+  expected<void> begin_transaction() override;
+
+  expected<void> commit_transaction() override;
+
+  expected<void> abort_transaction() override;
+
+  expected<void> flush() override;
+
+  void release_memory() override;
+
+  // -- inspectors -------------------------------------------------------------
+
+  expected<data> get(const data& key) const override;
+
+  expected<bool> exists(const data& key) const override;
+
+  expected<uint64_t> size() const override;
+
+  expected<data> keys() const override;
+
+  expected<data> range(const data& first, const data& last,
+                       size_t limit) const override;
+
+  expected<data> keys_with_prefix(const std::string& prefix,
+                                  size_t limit) const override;
+
+  expected<broker::snapshot> snapshot() const override;
+
+  expected<void> for_each(const detail::entry_visitor& f) const override;
+
+  expected<detail::expirables> expiries() const override;
+
+  expected<detail::expirables> expiries_between(timestamp first,
+                                                timestamp last) const override;
+
+  // -- properties -------------------------------------------------------------
+
+  /// Returns the number of keys with modifications that the I/O thread didn't
+  /// write yet.
+  size_t pending() const;
+
+private:
+  /// The latest state of a key with pending modifications.
+  struct overlay_entry {
+    /// The new value or `nullopt` if the key got erased.
+    std::optional<data> value;
+    std::optional<timestamp> expiry;
+    /// Identifies the modification that produced this state.
+    uint64_t seq;
+  };
+
+  enum class op_type {
+    write,
+    begin_transaction,
+    commit_transaction,
+    abort_transaction,
+    flush,
+  };
+
+  struct op {
+    op_type type;
+    data key;
+    uint64_t seq;
+  };
+
+  /// Pushes an operation to the queue of the I/O thread. Requires a lock on
+  /// `mtx_`.
+  void enqueue(op x);
+
+  /// Returns and resets the first error of the I/O thread. Requires a lock on
+  /// `mtx_`.
+  expected<void> take_error();
+
+  /// Blocks until the I/O thread has written all pending modifications.
+  void drain() const;
+
+  /// Runs the loop of the I/O thread.
+  void run();
+
+  backend_pointer decorated_;
+
+  /// Guards all access to `decorated_`.
+  mutable std::mutex backend_mtx_;
+
+  /// Guards the queue, the overlay and the state of the I/O thread.
+  mutable std::mutex mtx_;
+
+  /// Signals new operations to the I/O thread.
+  std::condition_variable wakeup_;
+
+  /// Signals that the I/O thread has no more pending operations.
+  mutable std::condition_variable idle_;
+
+  std::deque<op> queue_;
+
+  std::unordered_map<data, overlay_entry> overlay_;
+
+  uint64_t seq_ = 0;
+
+  bool busy_ = false;
+
+  bool shutting_down_ = false;
+
+  error error_;
+
+  std::thread thread_;
+};
+
+} // namespace broker::internal
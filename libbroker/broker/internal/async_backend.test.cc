@@ -0,0 +1,90 @@
+#include "broker/internal/async_backend.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include "broker/detail/memory_backend.hh"
+
+#include <map>
+#include <memory>
+
+using namespace broker;
+
+namespace {
+
+// Records the last value per key in a map that outlives the backend.
+class recording_backend : public detail::memory_backend {
+public:
+  explicit recording_backend(std::shared_ptr<std::map<data, data>> writes)
+    : writes_(std::move(writes)) {}
+
+  expected<void> put(const data& key, data value,
+                     std::optional<timestamp> expiry) override {
+    (*writes_)[key] = value;
+    return memory_backend::put(key, std::move(value), expiry);
+  }
+
+private:
+  std::shared_ptr<std::map<data, data>> writes_;
+};
+
+struct fixture {
+  std::unique_ptr<internal::async_backend> backend;
+
+  fixture() {
+    backend = std::make_unique<internal::async_backend>(
+      std::make_unique<detail::memory_backend>());
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(async_backend_tests, fixture)
+
+TEST(reads observe pending modifications) {
+  REQUIRE(backend->put(data{"a"}, data{1}, std::nullopt));
+  REQUIRE(backend->put(data{"b"}, data{2}, std::nullopt));
+  REQUIRE(backend->put(data{"a"}, data{3}, std::nullopt));
+  REQUIRE(backend->erase(data{"b"}));
+  CHECK_EQUAL(backend->get(data{"a"}), data{3});
+  CHECK_EQUAL(backend->get(data{"b"}), ec::no_such_key);
+  CHECK_EQUAL(backend->exists(data{"a"}), true);
+  CHECK_EQUAL(backend->exists(data{"b"}), false);
+  REQUIRE(backend->add(data{"a"}, data{1}, data::type::integer, std::nullopt));
+  CHECK_EQUAL(backend->get(data{"a"}), data{4});
+}
+
+TEST(aggregate reads wait for all pending modifications) {
+  for (integer i = 0; i < 100; ++i)
+    REQUIRE(backend->put(data{i}, data{i}, std::nullopt));
+  REQUIRE(backend->erase(data{integer{0}}));
+  CHECK_EQUAL(backend->size(), 99u);
+  CHECK_EQUAL(backend->pending(), 0u);
+  auto snap = backend->snapshot();
+  REQUIRE(snap);
+  CHECK_EQUAL(snap->size(), 99u);
+  CHECK_EQUAL(snap->count(data{integer{0}}), 0u);
+}
+
+TEST(expire honors pending modifications) {
+  auto t0 = broker::now();
+  REQUIRE(backend->put(data{"a"}, data{1}, t0 + std::chrono::seconds{1}));
+  CHECK_EQUAL(backend->expire(data{"a"}, t0), false);
+  CHECK_EQUAL(backend->expire(data{"a"}, t0 + std::chrono::seconds{2}), true);
+  CHECK_EQUAL(backend->exists(data{"a"}), false);
+  CHECK_EQUAL(backend->expire(data{"a"}, t0 + std::chrono::seconds{2}), false);
+  CHECK_EQUAL(backend->size(), 0u);
+}
+
+TEST(destroying the decorator writes all pending modifications) {
+  auto writes = std::make_shared<std::map<data, data>>();
+  {
+    internal::async_backend uut{std::make_unique<recording_backend>(writes)};
+    for (integer i = 0; i < 100; ++i)
+      REQUIRE(uut.put(data{i % 10}, data{i}, std::nullopt));
+  }
+  REQUIRE_EQUAL(writes->size(), 10u);
+  for (integer i = 0; i < 10; ++i)
+    CHECK_EQUAL(writes->at(data{i}), data{i + 90});
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,91 @@
+#include "broker/internal/auto_batcher.hh"
+
+#include "broker/zeek.hh"
+
+#include <type_traits>
+#include <utility>
+
+namespace broker::internal {
+
+namespace {
+
+/// Checks whether `msg` is a valid Zeek message that may become part of a
+/// batch. We never nest batches, since receivers only unpack one level.
+bool is_batchable(const data_message& msg) {
+  return zeek::visit_as_message(
+    [](const auto& x) {
+      using type = std::decay_t<decltype(x)>;
+      return !std::is_same_v<type, zeek::Invalid>
+             && !std::is_same_v<type, zeek::Batch>;
+    },
+    msg);
+}
+
+} // namespace
+
+std::optional<timestamp> auto_batcher::next_deadline() const {
+  std::optional<timestamp> result;
+  for (const auto& kvp : pending_)
+    if (!result || kvp.second.deadline < *result)
+      result = kvp.second.deadline;
+  return result;
+}
+
+void auto_batcher::push(const data_message& msg, timestamp now,
+                        std::vector<data_message>& out) {
+  auto topic_str = msg->topic();
+  if (!is_batchable(msg)) {
+    if (auto i = pending_.find(std::string{topic_str}); i != pending_.end())
+      out.emplace_back(finalize(i));
+    out.emplace_back(msg);
+    return;
+  }
+  auto [i, added] = pending_.try_emplace(std::string{topic_str});
+  auto& batch = i->second;
+  if (added) {
+    batch.first = msg;
+    batch.deadline = now + linger_;
+  }
+  batch.items.add(get_data(msg));
+  if (++batch.size >= max_size_)
+    out.emplace_back(finalize(i));
+}
+
+void auto_batcher::flush_expired(timestamp now,
+                                 std::vector<data_message>& out) {
+  auto i = pending_.begin();
+  while (i != pending_.end()) {
+    if (i->second.deadline <= now) {
+      auto next = std::next(i);
+      out.emplace_back(finalize(i));
+      i = next;
+    } else {
+      ++i;
+    }
+  }
+}
+
+void auto_batcher::flush_all(std::vector<data_message>& out) {
+  while (!pending_.empty())
+    out.emplace_back(finalize(pending_.begin()));
+}
+
+data_message auto_batcher::finalize(map_type::iterator i) {
+  if (i->second.size == 1) {
+    auto result = std::move(i->second.first);
+    pending_.erase(i);
+    return result;
+  }
+  // Same layout as `zeek::BatchBuilder::build_transparent`, but we skip
+  // parsing the batch again.
+  auto result = list_builder{}
+                  .add(zeek::ProtocolVersion)
+                  .add(static_cast<count>(zeek::Message::Type::Batch))
+                  .add(i->second.items)
+                  .add(true)
+                  .build_envelope(i->first);
+  pending_.erase(i);
+  return result;
+}
+
+} // namespace broker::internal
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "broker/builder.hh"
+#include "broker/message.hh"
+#include "broker/time.hh"
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace broker::internal {
+
+/// Packs Zeek messages for the same topic into transparent `zeek::Batch`
+/// messages (see `zeek::Batch::transparent`). A batch is complete once it
+/// reaches its maximum size or after its oldest message waited for the linger
+/// time. Messages that are not Zeek messages pass through unchanged, but only
+/// after the pending batch for the same topic, i.e., the batcher preserves the
+/// order of messages per topic.
+class auto_batcher {
+public:
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// @param max_size Maximum number of messages per batch.
+  /// @param linger Maximum time a message waits for its batch to fill up.
+  auto_batcher(size_t max_size, timespan linger)
+    : max_size_(max_size), linger_(linger) {
+    // nop
+  }
+
+  // -- properties -------------------------------------------------------------
+
+  size_t max_size() const noexcept {
+    return max_size_;
+  }
+
+  timespan linger() const noexcept {
+    return linger_;
+  }
+
+  /// Checks whether no batch is pending.
+  bool empty() const noexcept {
+    return pending_.empty();
+  }
+
+  /// Returns the earliest deadline of all pending batches.
+  std::optional<timestamp> next_deadline() const;
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Adds `msg` to the pending batch for its topic. Appends all messages that
+  /// are ready for dispatching to `out`.
+  void push(const data_message& msg, timestamp now,
+            std::vector<data_message>& out);
+
+  /// Appends all batches that reached their deadline to `out`.
+  void flush_expired(timestamp now, std::vector<data_message>& out);
+
+  /// Appends all pending batches to `out`.
+  void flush_all(std::vector<data_message>& out);
+
+private:
+  struct pending_batch {
+    /// Stores the first message for skipping the batch if no other message
+    /// arrives before the deadline.
+    data_message first;
+    list_builder items;
+    size_t size = 0;
+    timestamp deadline;
+  };
+
+  using map_type = std::unordered_map<std::string, pending_batch>;
+
+  /// Converts a pending batch to a message and removes it from the map.
+  data_message finalize(map_type::iterator i);
+
+  size_t max_size_;
+  timespan linger_;
+  map_type pending_;
+};
+
+} // namespace broker::internal
@@ -0,0 +1,99 @@
+#include "broker/internal/auto_batcher.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include "broker/zeek.hh"
+
+#include <chrono>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace broker;
+using namespace std::literals;
+
+namespace {
+
+data_message make_event(std::string_view topic_str, count n) {
+  zeek::Event ev{"test", vector{n}};
+  return data_envelope::make(topic_str, ev.raw());
+}
+
+struct fixture {
+  internal::auto_batcher uut{3, 10ms};
+
+  timestamp t0 = timestamp{1s};
+
+  std::vector<data_message> out;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(auto_batcher_tests, fixture)
+
+TEST(the batcher emits a transparent batch once it reaches its max size) {
+  uut.push(make_event("a", 1), t0, out);
+  uut.push(make_event("a", 2), t0, out);
+  CHECK(out.empty());
+  uut.push(make_event("a", 3), t0, out);
+  REQUIRE_EQUAL(out.size(), 1u);
+  CHECK(uut.empty());
+  CHECK_EQUAL(out[0]->topic(), "a");
+  zeek::Batch batch{out[0]};
+  REQUIRE(batch.valid());
+  CHECK(batch.transparent());
+  std::vector<count> args;
+  batch.for_each([&args](const auto& x) {
+    if constexpr (std::is_same_v<std::decay_t<decltype(x)>, zeek::Event>)
+      args.push_back(x.args().at(0).to_count());
+  });
+  CHECK_EQUAL(args, std::vector<count>({1, 2, 3}));
+}
+
+TEST(the batcher keeps separate batches per topic) {
+  uut.push(make_event("a", 1), t0, out);
+  uut.push(make_event("b", 2), t0, out);
+  uut.push(make_event("a", 3), t0, out);
+  CHECK(out.empty());
+  CHECK(uut.next_deadline() == t0 + 10ms);
+  uut.flush_all(out);
+  REQUIRE_EQUAL(out.size(), 2u);
+  CHECK(uut.empty());
+  CHECK(!uut.next_deadline());
+}
+
+TEST(single messages pass through unchanged after the linger time) {
+  auto msg = make_event("a", 1);
+  uut.push(msg, t0, out);
+  uut.flush_expired(t0 + 5ms, out);
+  CHECK(out.empty());
+  uut.flush_expired(t0 + 10ms, out);
+  REQUIRE_EQUAL(out.size(), 1u);
+  CHECK(out[0] == msg);
+  CHECK(uut.empty());
+}
+
+TEST(other messages flush the pending batch for their topic first) {
+  uut.push(make_event("a", 1), t0, out);
+  uut.push(make_event("a", 2), t0, out);
+  auto other = make_data_message("a", data{"hello"});
+  uut.push(other, t0, out);
+  REQUIRE_EQUAL(out.size(), 2u);
+  CHECK(zeek::Batch{out[0]}.transparent());
+  CHECK(out[1] == other);
+  CHECK(uut.empty());
+}
+
+TEST(regular batches are not transparent) {
+  zeek::BatchBuilder builder;
+  builder.add(zeek::Event{"test", vector{1}});
+  auto batch = builder.build();
+  REQUIRE(batch.valid());
+  CHECK(!batch.transparent());
+  builder.add(zeek::Event{"test", vector{2}});
+  auto tbatch = builder.build_transparent();
+  REQUIRE(tbatch.valid());
+  CHECK(tbatch.transparent());
+}
+
+FIXTURE_SCOPE_END()
@@ -4,8 +4,14 @@
 #include <cassert>
 #include <cstdint>
 #include <deque>
+#include <functional>
+#include <map>
+#include <memory>
 #include <optional>
+#include <type_traits>
+#include <utility>
 #include <variant>
+#include <vector>
 
 #include <caf/actor.hpp>
 #include <caf/send.hpp>
@@ -18,6 +24,17 @@
 
 namespace broker::internal {
 
+/// Checks whether a producer backend provides the optional `stamp` hook.
+template <class Backend, class Producer, class Payload, class = void>
+struct has_stamp_hook : std::false_type {};
+
+template <class Backend, class Producer, class Payload>
+struct has_stamp_hook<
+  Backend, Producer, Payload,
+  std::void_t<decltype(std::declval<Backend&>().stamp(
+    std::declval<Producer*>(), sequence_number_type{},
+    std::declval<Payload&>()))>> : std::true_type {};
+
 /// A message-driven channel for ensuring reliable and ordered transport over an
 /// unreliable and unordered communication layer. A channel connects a single
 /// producer with any number of consumers.
@@ -133,6 +150,12 @@ public:
   ///                   indicate that a consumer got removed by the producer.
   ///                 - `void handshake_completed(producer*, const Handle&)`
   ///                   called to indicate that the producer received an ACK
+  ///                 - `void stamp(producer*, sequence_number_type, Payload&)`
+  ///                   (optional) called right before sending an event for the
+  ///                   first time. Allows the backend to embed the final
+  ///                   sequence number into the payload, since events that
+  ///                   wait for space in the sending window only receive their
+  ///                   sequence number once they leave the pending queue.
   template <class Backend, class Base = default_producer_base>
   class producer : public Base {
   public:
@@ -168,11 +191,19 @@ public:
       /// Keeps track of how many messages were sent (acknowledged) in total.
       caf::telemetry::int_counter* processed = nullptr;
 
+      /// Counts received NACK messages.
+      caf::telemetry::int_counter* nacks = nullptr;
+
+      /// Counts events that the producer sent again after receiving a NACK.
+      caf::telemetry::int_counter* retransmissions = nullptr;
+
       void init(caf::telemetry::metric_registry& reg, std::string_view name) {
         metric_factory factory{reg};
         output_channels = factory.store.output_channels_instance(name);
         unacknowledged = factory.store.unacknowledged_updates_instance(name);
         processed = factory.store.processed_updates_instance(name);
+        nacks = factory.store.nacks_instance(name);
+        retransmissions = factory.store.retransmissions_instance(name);
       }
 
       void init(caf::actor_system& sys, std::string_view name) {
@@ -205,6 +236,16 @@ public:
           processed->inc(num);
         }
       }
+
+      void inc_nacks() {
+        if (nacks)
+          nacks->inc();
+      }
+
+      void retransmitted(int64_t num) {
+        if (retransmissions)
+          retransmissions->inc(num);
+      }
     };
 
     // -- constructors, destructors, and assignment operators ------------------
@@ -216,13 +257,14 @@ public:
     // -- message processing ---------------------------------------------------
 
     void produce(Payload content) {
-      if (paths_.empty())
+      if (paths_.empty() && replay_log_size_ == 0)
         return;
-      metrics_.inc_unacknowledged();
-      ++seq_;
-      buf_.emplace_back(event{seq_, std::move(content)});
-      last_broadcast_ = tick_;
-      backend_->broadcast(this, buf_.back());
+      if (window_full()) {
+        // Hold back the event until consumers acknowledge earlier events.
+        pending_.emplace_back(std::move(content));
+        return;
+      }
+      emit(std::move(content));
     }
 
     error add(const Handle& hdl) {
@@ -235,6 +277,26 @@ public:
       return {};
     }
 
+    /// Re-adds a consumer that has lost its path, e.g., after a timeout, by
+    /// sending it all events starting at `first` from the replay log. A
+    /// consumer that already received all events may always resume, i.e.,
+    /// `first == seq() + 1` requires no replay log.
+    /// @returns `false` if the replay log does not cover `first`.
+    bool resume(const Handle& hdl, sequence_number_type first) {
+      if (first == 0 || first > seq_ + 1 || find_path(hdl) != paths_.end())
+        return false;
+      if (first <= seq_
+          && (replay_log_.empty() || first < replay_log_.front().seq))
+        return false;
+      BROKER_DEBUG("resume" << hdl << "at" << first);
+      metrics_.inc_output_channels();
+      paths_.emplace_back(path{hdl, first - 1, first - 1, tick_});
+      for (auto& x : replay_log_)
+        if (x.seq >= first)
+          backend_->send(this, hdl, x);
+      return true;
+    }
+
     void trigger_handshakes() {
       for (auto& path : paths_)
         if (path.offset == 0)
@@ -265,13 +327,7 @@ public:
           acked = std::min(x.acked, acked);
         }
       }
-      // Drop events from the buffer if possible.
-      auto not_acked = [acked](const event& x) { return x.seq > acked; };
-      auto new_begin = std::find_if(buf_.begin(), buf_.end(), not_acked);
-      if (auto n = std::distance(buf_.begin(), new_begin); n > 0) {
-        metrics_.shipped(n);
-        buf_.erase(buf_.begin(), new_begin);
-      }
+      drop_acked(acked);
     }
 
     void handle_nack(const Handle& hdl,
@@ -285,6 +341,9 @@ public:
         if (seqs.size() == 1 && seqs.front() == 0) {
           auto err = add(hdl);
           static_cast<void>(err); // Discard: always default-constructed.
+        } else if (!resume(hdl, seqs.front())) {
+          // Force the consumer to start over with a new handshake.
+          backend_->send(this, hdl, retransmit_failed{seqs.front()});
         }
         return;
       }
@@ -300,12 +359,29 @@ public:
         backend_->send(this, hdl, handshake{p->offset, heartbeat_interval_});
         return;
       }
+      metrics_.inc_nacks();
       handle_ack(hdl, first - 1);
+      // The consumer lost events: back off.
+      shrink_window();
+      if (retransmit_broadcast_threshold_ > 0) {
+        // Collect the request and answer it on the next tick.
+        for (auto seq : seqs) {
+          auto& hdls = retransmits_[seq];
+          if (std::find(hdls.begin(), hdls.end(), hdl) == hdls.end())
+            hdls.emplace_back(hdl);
+        }
+        return;
+      }
       for (auto seq : seqs) {
-        if (auto i = find_event(seq); i != buf_.end())
+        if (auto i = find_event(seq); i != buf_.end()) {
+          metrics_.retransmitted(1);
           backend_->send(this, hdl, *i);
-        else
+        } else if (auto j = find_logged_event(seq); j != replay_log_.end()) {
+          metrics_.retransmitted(1);
+          backend_->send(this, hdl, *j);
+        } else {
           backend_->send(this, hdl, retransmit_failed{seq});
+        }
       }
     }
 
@@ -313,6 +389,7 @@ public:
 
     void tick() {
       BROKER_TRACE("");
+      flush_retransmits();
       // Increase local time and send heartbeats.
       ++tick_;
       if (heartbeat_interval_ == 0)
@@ -339,18 +416,15 @@ public:
       // Check whether we can clear some items from the buffer.
       if (paths_.empty()) {
         buf_.clear();
+        sent_at_.clear();
+        release_pending();
       } else if (erased_paths > 0) {
         auto i = paths_.begin();
         auto acked = i->acked;
         for (++i; i != paths_.end(); ++i)
           if (i->acked < acked)
             acked = i->acked;
-        auto not_acked = [acked](const event& x) { return x.seq > acked; };
-        auto new_begin = std::find_if(buf_.begin(), buf_.end(), not_acked);
-        if (auto n = std::distance(buf_.begin(), new_begin); n > 0) {
-          metrics_.shipped(n);
-          buf_.erase(buf_.begin(), new_begin);
-        }
+        drop_acked(acked);
       }
     }
 
@@ -412,9 +486,90 @@ public:
       connection_timeout_factor_ = value;
     }
 
+    /// Returns the maximum number of events in the replay log.
+    size_t replay_log_size() const noexcept {
+      return replay_log_size_;
+    }
+
+    /// Sets the maximum number of events in the replay log. Passing 0 disables
+    /// the replay log.
+    void replay_log_size(size_t value) {
+      replay_log_size_ = value;
+      while (replay_log_.size() > value)
+        replay_log_.pop_front();
+    }
+
+    const auto& replay_log() const noexcept {
+      return replay_log_;
+    }
+
+    /// Returns the maximum number of unacknowledged events.
+    size_t max_window() const noexcept {
+      return max_window_;
+    }
+
+    /// Sets the maximum number of unacknowledged events. Once reaching the
+    /// current window size, the producer holds back new events until consumers
+    /// acknowledge earlier events. Passing 0 disables flow control.
+    void max_window(size_t value) {
+      max_window_ = value;
+      window_ = std::max(value / 2, size_t{1});
+      release_pending();
+    }
+
+    /// Returns the current size of the sending window, which adapts to the
+    /// latency of incoming ACKs.
+    size_t window() const noexcept {
+      return max_window_ > 0 ? window_ : 0;
+    }
+
+    /// Returns the ACK latency (in ticks) that causes the producer to shrink
+    /// its window.
+    uint64_t ack_latency_target() const noexcept {
+      if (ack_latency_target_ > 0)
+        return ack_latency_target_;
+      return uint64_t{heartbeat_interval_} * 2;
+    }
+
+    /// Sets the ACK latency (in ticks) that causes the producer to shrink its
+    /// window. Passing 0 selects twice the heartbeat interval.
+    void ack_latency_target(tick_interval_type value) noexcept {
+      ack_latency_target_ = value;
+    }
+
+    /// Returns how many consumers must request the same event within a tick
+    /// before the producer broadcasts the event instead of sending it to each
+    /// consumer individually.
+    size_t retransmit_broadcast_threshold() const noexcept {
+      return retransmit_broadcast_threshold_;
+    }
+
+    /// Sets how many consumers must request the same event within a tick
+    /// before the producer broadcasts the event. Passing 0 disables collecting
+    /// retransmit requests, i.e., the producer answers each NACK immediately.
+    void retransmit_broadcast_threshold(size_t value) {
+      retransmit_broadcast_threshold_ = value;
+      if (value == 0)
+        flush_retransmits();
+    }
+
+    /// Returns events that wait for space in the sending window.
+    const auto& pending() const noexcept {
+      return pending_;
+    }
+
     bool idle() const noexcept {
       auto at_head = [seq{seq_}](const path& x) { return x.acked == seq; };
-      return std::all_of(paths_.begin(), paths_.end(), at_head);
+      return pending_.empty()
+             && std::all_of(paths_.begin(), paths_.end(), at_head);
+    }
+
+    /// Releases unused capacity of the internal buffers.
+    void compact() {
+      buf_.shrink_to_fit();
+      sent_at_.shrink_to_fit();
+      pending_.shrink_to_fit();
+      paths_.shrink_to_fit();
     }
 
     /// Checks whether any path was added but not yet acknowledged.
@@ -440,7 +595,118 @@ public:
       return std::find_if(buf_.begin(), buf_.end(), has_seq);
     }
 
+    auto find_logged_event(sequence_number_type seq) noexcept {
+      if (replay_log_.empty() || seq < replay_log_.front().seq)
+        return replay_log_.end();
+      auto index = seq - replay_log_.front().seq;
+      if (index >= replay_log_.size())
+        return replay_log_.end();
+      return replay_log_.begin() + static_cast<ptrdiff_t>(index);
+    }
+
   private:
+    // -- flow control ---------------------------------------------------------
+
+    /// Assigns the next sequence number to `content` and sends it.
+    void emit(Payload content) {
+      ++seq_;
+      if constexpr (has_stamp_hook<Backend, producer, Payload>::value)
+        backend_->stamp(this, seq_, content);
+      last_broadcast_ = tick_;
+      if (replay_log_size_ > 0) {
+        if (replay_log_.size() == replay_log_size_)
+          replay_log_.pop_front();
+        replay_log_.emplace_back(event{seq_, content});
+      }
+      if (paths_.empty()) {
+        // Keep counting for consumers that resume later.
+        event ev{seq_, std::move(content)};
+        backend_->broadcast(this, ev);
+        return;
+      }
+      metrics_.inc_unacknowledged();
+      buf_.emplace_back(event{seq_, std::move(content)});
+      sent_at_.emplace_back(tick_);
+      backend_->broadcast(this, buf_.back());
+    }
+
+    bool window_full() const noexcept {
+      return max_window_ > 0 && !paths_.empty()
+             && (buf_.size() >= window_ || !pending_.empty());
+    }
+
+    /// Removes all events up to `acked` from the buffer, adjusts the window
+    /// and sends events that now fit into the window.
+    void drop_acked(sequence_number_type acked) {
+      auto not_acked = [acked](const event& x) { return x.seq > acked; };
+      auto new_begin = std::find_if(buf_.begin(), buf_.end(), not_acked);
+      auto n = std::distance(buf_.begin(), new_begin);
+      if (n == 0)
+        return;
+      metrics_.shipped(n);
+      // Grow the window by the number of shipped events as long as the ACK
+      // for the most recent of them arrived in time, otherwise back off.
+      auto latency = tick_.value - sent_at_[static_cast<size_t>(n - 1)].value;
+      if (max_window_ > 0) {
+        if (latency <= ack_latency_target())
+          window_ = std::min(window_ + static_cast<size_t>(n), max_window_);
+        else
+          shrink_window();
+      }
+      buf_.erase(buf_.begin(), new_begin);
+      sent_at_.erase(sent_at_.begin(), sent_at_.begin() + n);
+      release_pending();
+    }
+
+    // -- retransmissions ------------------------------------------------------
+
+    /// Answers all collected retransmit requests.
+    void flush_retransmits() {
+      if (retransmits_.empty())
+        return;
+      auto requests = std::move(retransmits_);
+      retransmits_.clear();
+      for (auto& [seq, hdls] : requests) {
+        auto known = [this](const Handle& x) {
+          return find_path(x) != paths_.end();
+        };
+        hdls.erase(std::remove_if(hdls.begin(), hdls.end(), std::not_fn(known)),
+                   hdls.end());
+        if (hdls.empty())
+          continue;
+        const event* ev = nullptr;
+        if (auto i = find_event(seq); i != buf_.end())
+          ev = std::addressof(*i);
+        else if (auto j = find_logged_event(seq); j != replay_log_.end())
+          ev = std::addressof(*j);
+        if (ev == nullptr) {
+          for (auto& hdl : hdls)
+            backend_->send(this, hdl, retransmit_failed{seq});
+        } else if (hdls.size() >= retransmit_broadcast_threshold_) {
+          // Consumers simply drop events they already have.
+          metrics_.retransmitted(1);
+          backend_->broadcast(this, *ev);
+        } else {
+          metrics_.retransmitted(static_cast<int64_t>(hdls.size()));
+          for (auto& hdl : hdls)
+            backend_->send(this, hdl, *ev);
+        }
+      }
+    }
+
+    void shrink_window() noexcept {
+      window_ = std::max(window_ / 2, size_t{1});
+    }
+
+    void release_pending() {
+      while (!pending_.empty()
+             && (max_window_ == 0 || paths_.empty() || buf_.size() < window_)) {
+        auto content = std::move(pending_.front());
+        pending_.pop_front();
+        emit(std::move(content));
+      }
+    }
+
     // -- member variables -----------------------------------------------------
 
     /// Transmits messages to the consumers.
@@ -465,6 +731,36 @@ public:
     /// Stores outgoing events with their sequence number.
     buf_type buf_;
 
+    /// Stores when we have sent the events in `buf_`.
+    std::deque<lamport_timestamp> sent_at_;
+
+    /// Stores events that wait for space in the sending window.
+    std::deque<Payload> pending_;
+
+    /// Maximum number of unacknowledged events (0 = disabled).
+    size_t max_window_ = 0;
+
+    /// Current number of events we may send without receiving an ACK.
+    size_t window_ = 1;
+
+    /// Maximum ACK latency before shrinking the window (0 = derive from the
+    /// heartbeat interval).
+    tick_interval_type ack_latency_target_ = 0;
+
+    /// Collects retransmit requests per sequence number until the next tick.
+    std::map<sequence_number_type, std::vector<Handle>> retransmits_;
+
+    /// Minimum number of requests for broadcasting a retransmitted event
+    /// (0 = disabled).
+    size_t retransmit_broadcast_threshold_ = 0;
+
+    /// Stores the most recent events, regardless of whether all consumers
+    /// acknowledged them, for consumers that resume after losing their path.
+    buf_type replay_log_;
+
+    /// Maximum size of `replay_log_` (0 = disabled).
+    size_t replay_log_size_ = 0;
+
     /// List of consumers with the last acknowledged sequence number.
     path_list paths_;
 
@@ -593,6 +889,28 @@ public:
       return handle_handshake_impl(offset, heartbeat_interval);
     }
 
+    /// Initializes the consumer from a previous session with `producer_hdl`,
+    /// e.g., after restoring persisted state, and asks the producer to resume
+    /// the channel at `next`. The producer either re-adds the consumer or
+    /// answers with `retransmit_failed`, which the consumer handles like any
+    /// other lost event.
+    /// @returns `false` if the consumer already has a producer.
+    bool resume(Handle producer_hdl, sequence_number_type next,
+                tick_interval_type heartbeat_interval) {
+      BROKER_TRACE(BROKER_ARG(producer_hdl)
+                   << BROKER_ARG(next) << BROKER_ARG(heartbeat_interval));
+      if (initialized() || next == 0)
+        return false;
+      producer_ = std::move(producer_hdl);
+      next_seq_ = next;
+      last_seq_ = next;
+      heartbeat_interval_ = heartbeat_interval;
+      last_ack_ = next - 1;
+      metrics_.inc_input_channels();
+      backend_->send(this, nack{std::vector<sequence_number_type>{next}});
+      return true;
+    }
+
     /// @copydoc handle_handshake
     bool handle_handshake(sequence_number_type offset,
                           tick_interval_type heartbeat_interval) {
@@ -643,6 +961,7 @@ public:
         backend_->consume(this, payload);
         bump_seq();
         try_consume_buffer();
+        maybe_send_ack();
       } else if (seq > next_seq_) {
         if (seq > last_seq_)
           last_seq_ = seq;
@@ -671,6 +990,7 @@ public:
         }
         bump_seq();
         try_consume_buffer();
+        maybe_send_ack();
       } else if (seq > next_seq_) {
         // Insert event into buf_: sort by the sequence number, drop duplicates.
         auto pred = [seq](const optional_event& x) { return x.seq >= seq; };
@@ -804,6 +1124,17 @@ public:
       nack_timeout_ = value;
     }
 
+    auto ack_batch_size() const noexcept {
+      return ack_batch_size_;
+    }
+
+    /// Configures the consumer to send a cumulative ACK as soon as it has
+    /// processed `value` events since its last ACK, in addition to the
+    /// periodic ACKs. Passing 0 disables ACK batching.
+    void ack_batch_size(size_t value) noexcept {
+      ack_batch_size_ = value;
+    }
+
     auto next_seq() const noexcept {
       return next_seq_;
     }
@@ -820,6 +1151,11 @@ public:
       return initialized() && buf_.empty() && next_seq_ == last_seq_;
     }
 
+    /// Releases unused capacity of the internal buffers.
+    void compact() {
+      buf_.shrink_to_fit();
+    }
+
     void reset() {
       if (initialized()) {
         metrics_.dec_input_channels();
@@ -833,6 +1169,7 @@ public:
       idle_ticks_ = 0;
       heartbeat_interval_ = 0;
       nack_timeout_ = 5;
+      last_ack_ = 0;
     }
 
   private:
@@ -868,7 +1205,15 @@ public:
     }
 
     void send_ack() {
-      backend_->send(this, cumulative_ack{next_seq_ > 0 ? next_seq_ - 1 : 0});
+      last_ack_ = next_seq_ > 0 ? next_seq_ - 1 : 0;
+      backend_->send(this, cumulative_ack{last_ack_});
+    }
+
+    // Sends an ACK if we have processed enough events since the last one.
+    void maybe_send_ack() {
+      if (ack_batch_size_ > 0 && initialized()
+          && next_seq_ - 1 >= last_ack_ + ack_batch_size_)
+        send_ack();
     }
 
     // -- member variables -----------------------------------------------------
@@ -907,6 +1252,12 @@ public:
     /// Number of ticks without progress before sending a NACK.
     tick_interval_type nack_timeout_ = 5;
 
+    /// Number of processed events that trigger an ACK (0 = disabled).
+    size_t ack_batch_size_ = 0;
+
+    /// Stores the sequence number of our last ACK.
+    sequence_number_type last_ack_ = 0;
+
     /// Factor for computing the timeout for producers, i.e., after how many
     /// heartbeats of not receiving any message do we assume the producer no
     /// longer exists.
@@ -363,6 +363,99 @@ B <- retransmit_failed(2)
 B <- retransmit_failed(4))");
 }
 
+TEST(the replay log allows consumers to resume after losing their path) {
+  producer.replay_log_size(3);
+  producer.produce("a");
+  producer.produce("b");
+  producer.produce("c");
+  producer.produce("d");
+  CHECK_EQUAL(producer.seq(), 5u);
+  CHECK_EQUAL(producer.buf().size(), 0u);
+  CHECK_EQUAL(producer.replay_log().size(), 3u);
+  producer_log.clear();
+  MESSAGE("sending NACK for a logged sequence number resumes the path");
+  producer.handle_nack("A", {4});
+  CHECK_EQUAL(producer_log, R"(
+A <- event(4, "c")
+A <- event(5, "d"))");
+  REQUIRE_EQUAL(producer.paths().size(), 1u);
+  CHECK_EQUAL(producer.paths().front().acked, 3u);
+  producer_log.clear();
+  MESSAGE("NACKs on the resumed path fall back to the replay log");
+  producer.handle_nack("A", {4});
+  CHECK_EQUAL(producer_log, "\nA <- event(4, \"c\")");
+  producer_log.clear();
+  MESSAGE("sending NACK for a truncated sequence number sends an error");
+  producer.handle_nack("B", {2});
+  CHECK_EQUAL(producer_log, "\nB <- retransmit_failed(2)");
+  CHECK_EQUAL(producer.paths().size(), 1u);
+}
+
+TEST(consumers that received all events resume without a replay log) {
+  producer.add("A");
+  producer.produce("a");
+  producer.produce("b");
+  producer.handle_ack("A", 3);
+  producer_log.clear();
+  producer.handle_nack("B", {4});
+  CHECK_EQUAL(producer_log, "");
+  CHECK_EQUAL(producer.paths().size(), 2u);
+  producer.handle_nack("C", {3});
+  CHECK_EQUAL(producer_log, "\nC <- retransmit_failed(3)");
+  CHECK_EQUAL(producer.paths().size(), 2u);
+}
+
+TEST(the sending window limits unacknowledged events) {
+  producer.max_window(4);
+  CHECK_EQUAL(producer.window(), 2u);
+  producer.add("A");
+  producer.produce("a");
+  producer.produce("b");
+  producer.produce("c");
+  CHECK_EQUAL(producer.seq(), 3u);
+  CHECK_EQUAL(producer.buf().size(), 2u);
+  CHECK_EQUAL(producer.pending().size(), 1u);
+  CHECK(!producer.idle());
+  MESSAGE("timely ACKs grow the window and release pending events");
+  producer.handle_ack("A", 2);
+  CHECK_EQUAL(producer.window(), 3u);
+  CHECK_EQUAL(producer.seq(), 4u);
+  CHECK_EQUAL(producer.pending().size(), 0u);
+  MESSAGE("NACKs shrink the window");
+  producer.handle_nack("A", {4});
+  CHECK_EQUAL(producer.window(), 2u);
+  MESSAGE("late ACKs shrink the window");
+  producer.produce("d");
+  producer.produce("e");
+  CHECK_EQUAL(producer.pending().size(), 1u);
+  for (int i = 0; i <= producer.heartbeat_interval() * 2; ++i)
+    producer.tick();
+  producer.handle_ack("A", 5);
+  CHECK_EQUAL(producer.window(), 1u);
+  CHECK_EQUAL(producer.seq(), 6u);
+  CHECK_EQUAL(producer.buf().size(), 1u);
+  producer.handle_ack("A", 6);
+  CHECK(producer.idle());
+}
+
+TEST(producers broadcast events that many consumers request) {
+  producer.retransmit_broadcast_threshold(2);
+  producer.add("A");
+  producer.add("B");
+  producer.add("C");
+  producer.produce("a");
+  producer.produce("b");
+  producer_log.clear();
+  producer.handle_nack("A", {2});
+  producer.handle_nack("B", {2});
+  producer.handle_nack("C", {3});
+  CHECK_EQUAL(producer_log, "");
+  producer.tick();
+  CHECK_EQUAL(producer_log, R"(
+[A, B, C] <- event(2, "a")
+C <- event(3, "b"))");
+}
+
 TEST(consumers process events in order) {
   consumer_backend cb{"A"};
   consumer_type consumer{&cb};
@@ -427,6 +520,20 @@ TEST(consumers buffer events until receiving the handshake) {
   CHECK_EQUAL(cb.input, "abc");
 }
 
+TEST(consumers resume a previous session by sending a NACK) {
+  consumer_backend cb{"A"};
+  consumer_type consumer{&cb};
+  CHECK(consumer.resume("P", 5, 3));
+  CHECK(consumer.initialized());
+  CHECK_EQUAL(consumer.producer(), "P");
+  CHECK_EQUAL(cb.output, "nack([5])");
+  CHECK(!consumer.resume("P", 7, 3));
+  consumer.handle_event(4, "d");
+  consumer.handle_event(5, "e");
+  CHECK_EQUAL(cb.input, "e");
+  CHECK_EQUAL(consumer.next_seq(), 6u);
+}
+
 TEST(consumers send cumulative ACK messages) {
   consumer_backend cb{"A"};
   consumer_type consumer{&cb};
@@ -446,6 +553,18 @@ TEST(consumers send cumulative ACK messages) {
   CHECK_EQUAL(cb.output, "cumulative_ack(3)");
 }
 
+TEST(consumers send batched ACK messages) {
+  consumer_backend cb{"A"};
+  consumer_type consumer{&cb};
+  consumer.ack_batch_size(2);
+  consumer.handle_handshake(1, 5);
+  cb.output.clear();
+  consumer.handle_event(2, "a");
+  CHECK_EQUAL(cb.output, "");
+  consumer.handle_event(3, "b");
+  CHECK_EQUAL(cb.output, "cumulative_ack(3)");
+}
+
 TEST(consumers send NACK messages when receiving incomplete data) {
   consumer_backend cb{"A"};
   consumer_type consumer{&cb};
@@ -5,9 +5,14 @@
 #include "broker/defaults.hh"
 #include "broker/detail/appliers.hh"
 #include "broker/detail/assert.hh"
+#include "broker/detail/filesystem.hh"
 #include "broker/error.hh"
+#include "broker/internal/clone_checkpoint.hh"
 #include "broker/internal/logger.hh"
+#include "broker/internal/metric_factory.hh"
+#include "broker/internal/store_batch.hh"
 #include "broker/internal/type_id.hh"
+#include "broker/detail/key_collector.hh"
 #include "broker/store.hh"
 #include "broker/topic.hh"
 
@@ -24,6 +29,7 @@
 
 #include <chrono>
 #include <memory>
+#include <type_traits>
 
 using namespace std::literals;
 
@@ -42,19 +48,55 @@ double now(endpoint::clock* clock) {
 
 clone_state::clone_state(caf::event_based_actor* ptr, endpoint_id this_endpoint,
                          std::string nm, caf::timespan master_timeout,
-                         caf::actor parent, endpoint::clock* ep_clock,
+                         std::string key_prefix, caf::actor parent,
+                         endpoint::clock* ep_clock,
                          caf::async::consumer_resource<command_message> in_res,
                          caf::async::producer_resource<command_message> out_res)
-  : super(ptr), input(this), max_sync_interval(master_timeout) {
+  : super(ptr),
+    key_prefix(std::move(key_prefix)),
+    input(this),
+    max_sync_interval(master_timeout) {
   super::init(this_endpoint, ep_clock, std::move(nm), std::move(parent),
               std::move(in_res), std::move(out_res));
   master_topic = store_name / topic::master_suffix();
   super::init(input);
   max_get_delay = caf::get_or(ptr->config(), "broker.store.max-get-delay",
                               defaults::store::max_get_delay);
+  local_reads = caf::get_or(ptr->config(), "broker.store.local-reads",
+                            defaults::store::local_reads);
+  optimistic_writes = caf::get_or(ptr->config(),
+                                  "broker.store.optimistic-writes",
+                                  defaults::store::optimistic_writes);
+  stalled.enabled(caf::get_or(ptr->config(), "broker.store.coalesce-updates",
+                              defaults::store::coalesce_updates));
+  input.ack_batch_size(caf::get_or(ptr->config(),
+                                   "broker.store.ack-batch-size",
+                                   defaults::store::ack_batch_size));
+  auto checkpoint_dir = caf::get_or(
+    ptr->config(), "broker.store.clone-checkpoint-directory",
+    caf::string_view{defaults::store::clone_checkpoint_directory});
+  // Note: a checkpoint of a partial clone lacks the keys of a full clone and
+  //       vice versa. Hence, only full clones use checkpoints.
+  if (!checkpoint_dir.empty() && this->key_prefix.empty()) {
+    if (detail::is_directory(checkpoint_dir) || detail::mkdirs(checkpoint_dir))
+      checkpoint_path = clone_checkpoint::file_name(checkpoint_dir, store_name);
+    else
+      BROKER_ERROR("unable to create checkpoint directory" << checkpoint_dir);
+  }
+  checkpoint_interval = caf::get_or(ptr->config(),
+                                    "broker.store.clone-checkpoint-interval",
+                                    defaults::store::clone_checkpoint_interval);
+  snapshot_duration = metric_factory{ptr->system()}
+                        .store.snapshot_duration_instance(store_name);
   BROKER_INFO("attached clone" << id << "to" << store_name);
 }
 
+clone_state::~clone_state() {
+  // Make sure a restarted clone may resume with the latest content.
+  if (checkpoint_dirty && input.initialized() && !checkpoint_path.empty())
+    write_checkpoint();
+}
+
 void clone_state::forward(internal_command&& x) {
   self->send(core, atom::publish_v,
              make_command_message(master_topic, std::move(x)));
@@ -68,6 +110,21 @@ void clone_state::dispatch(const command_message& msg) {
   auto seq = cmd.seq;
   auto tag = detail::tag_of(cmd);
   auto type = detail::type_of(cmd);
+  if (resuming) {
+    resuming = false;
+    if (cmd.sender == master_id) {
+      BROKER_DEBUG("resumed channel to master" << master_id);
+      if (!output_opt)
+        start_output();
+    } else {
+      // The master restarted since the clone wrote its checkpoint. Start over
+      // with a full resync.
+      BROKER_INFO("discard checkpoint: new master" << cmd.sender);
+      input.reset();
+      master_id = entity_id::nil();
+      send(std::addressof(input), channel_type::nack{{0}});
+    }
+  }
   if (input.initialized() && cmd.sender != input.producer()) {
     BROKER_WARNING("received message from unrecognized sender:" << cmd.sender);
     return;
@@ -97,7 +154,9 @@ void clone_state::dispatch(const command_message& msg) {
       // Control messages from the master.
       switch (type) {
         case internal_command::type::ack_clone_command: {
-          if (master_id) {
+          // After losing the channel, we accept a new handshake from our
+          // master for a full resync.
+          if (master_id && (cmd.sender != master_id || input.initialized())) {
             if (cmd.sender == master_id) {
               BROKER_DEBUG("drop repeated ack_clone from" << master_id);
             } else {
@@ -106,6 +165,12 @@ void clone_state::dispatch(const command_message& msg) {
                            << master_id);
             }
             return;
+          } else if (next_snapshot_chunk != snapshot_chunk_count) {
+            // Wait for the master to repeat the handshake.
+            BROKER_DEBUG("drop ack_clone: received only"
+                         << next_snapshot_chunk << "of"
+                         << snapshot_chunk_count << "snapshot chunks");
+            return;
           } else {
             master_id = cmd.sender;
           }
@@ -115,13 +180,61 @@ void clone_state::dispatch(const command_message& msg) {
             BROKER_DEBUG("received ack_clone from" << cmd.sender);
             if (!master_id)
               master_id = cmd.sender;
-            set_store(inner.state);
-            start_output();
+            if (snapshot_requested) {
+              using fractional_seconds = std::chrono::duration<double>;
+              auto elapsed = std::chrono::steady_clock::now()
+                             - *snapshot_requested;
+              snapshot_duration->observe(
+                std::chrono::duration_cast<fractional_seconds>(elapsed)
+                  .count());
+              snapshot_requested.reset();
+            }
+            if (snapshot_chunk_count > 0) {
+              for (auto& [key, value] : inner.state)
+                if (accepts(key))
+                  pending_snapshot.insert_or_assign(key, value);
+              next_snapshot_chunk = 0;
+              snapshot_chunk_count = 0;
+              set_store(std::move(pending_snapshot));
+              pending_snapshot.clear();
+            } else {
+              set_store(inner.state);
+            }
+            if (!output_opt)
+              start_output();
           } else {
             BROKER_DEBUG("drop repeated ack_clone from" << cmd.sender);
           }
           break;
         }
+        case internal_command::type::snapshot_chunk_command: {
+          auto& inner = get<snapshot_chunk_command>(cmd.content);
+          if (input.initialized()) {
+            BROKER_DEBUG("drop snapshot chunk: already attached to"
+                         << master_id);
+            break;
+          }
+          // The master starts over with index 0 when repeating the handshake.
+          if (inner.index == 0) {
+            pending_snapshot.clear();
+            next_snapshot_chunk = 0;
+            snapshot_chunk_count = inner.count;
+          }
+          if (inner.index != next_snapshot_chunk) {
+            BROKER_DEBUG("drop snapshot chunk" << inner.index
+                                               << "while waiting for"
+                                               << next_snapshot_chunk);
+            break;
+          }
+          BROKER_DEBUG("received snapshot chunk" << inner.index << "with"
+                                                 << inner.state.size()
+                                                 << "entries");
+          for (auto& [key, value] : inner.state)
+            if (accepts(key))
+              pending_snapshot.insert_or_assign(key, value);
+          ++next_snapshot_chunk;
+          break;
+        }
         case internal_command::type::keepalive_command: {
           if (!input.initialized()) {
             BROKER_DEBUG("ignored keepalive: input not initialized yet");
@@ -202,6 +315,8 @@ void clone_state::dispatch(const command_message& msg) {
 table clone_state::status_snapshot() const {
   table result;
   result.emplace("master-id"s, to_string(master_id.endpoint));
+  if (!key_prefix.empty())
+    result.emplace("key-prefix"s, key_prefix);
   result.emplace("input"s, get_stats(input));
   if (output_opt)
     result.emplace("output"s, get_stats(*output_opt));
@@ -212,14 +327,20 @@ table clone_state::status_snapshot() const {
 
 void clone_state::tick() {
   BROKER_TRACE("");
+  tick_events();
   input.tick();
   if (output_opt)
     output_opt->tick();
+  expire_optimistic();
+  publish_local_view();
+  maybe_write_checkpoint();
 }
 
 // -- callbacks for the consumer -----------------------------------------------
 
 void clone_state::consume(consumer_type*, command_message& msg) {
+  local_view_dirty = true;
+  checkpoint_dirty = true;
   auto f = [this](auto& cmd) { consume(cmd); };
   auto val = get_command(msg);
   std::visit(f, val.content);
@@ -227,14 +348,18 @@ void clone_state::consume(consumer_type*, command_message& msg) {
 
 void clone_state::consume(put_command& x) {
   BROKER_INFO("PUT" << x.key << "->" << x.value << "with expiry" << x.expiry);
-  if (auto i = store.find(x.key); i != store.end()) {
+  if (!accepts(x.key))
+    return;
+  reconcile(x.key, &x.value);
+  auto h = store.hash_code(x.key);
+  if (auto i = store.find(x.key, h); i != store.end()) {
     auto& value = i->second;
     auto old_value = std::move(value);
     emit_update_event(x, old_value);
     value = std::move(x.value);
   } else {
     emit_insert_event(x);
-    store.emplace(std::move(x.key), std::move(x.value));
+    store.try_emplace_hashed(h, std::move(x.key), std::move(x.value));
   }
 }
 
@@ -249,23 +374,32 @@ void clone_state::consume(put_unique_result_command& cmd) {
 
 void clone_state::consume(erase_command& x) {
   BROKER_INFO("ERASE" << x.key);
+  reconcile(x.key, nullptr);
   if (store.erase(x.key) != 0)
     emit_erase_event(x.key, x.publisher);
 }
 
 void clone_state::consume(expire_command& x) {
   BROKER_INFO("EXPIRE" << x.key);
+  reconcile(x.key, nullptr);
   if (store.erase(x.key) != 0)
     emit_expire_event(x.key, x.publisher);
 }
 
 void clone_state::consume(clear_command& x) {
   BROKER_INFO("CLEAR");
+  overlay.clear();
   for (auto& kvp : store)
     emit_erase_event(kvp.first, x.publisher);
   store.clear();
 }
 
+void clone_state::consume(batch_command& x) {
+  BROKER_INFO("BATCH" << x.entries.size() << "entries");
+  for (auto& entry : x.entries)
+    std::visit([this](auto& cmd) { consume(cmd); }, entry);
+}
+
 error clone_state::consume_nil(consumer_type* src) {
   BROKER_ERROR("clone out of sync: lost message from the master!");
   // By returning an error, we cause the channel to abort and call `close`.
@@ -291,6 +425,9 @@ void clone_state::send(consumer_type* ptr, channel_type::cumulative_ack ack) {
 
 void clone_state::send(consumer_type* ptr, channel_type::nack nack) {
   BROKER_DEBUG(BROKER_ARG(nack) << master_id << ptr->producer());
+  // A NACK for sequence number 0 asks the master for a full snapshot.
+  if (!snapshot_requested && nack.seqs.size() == 1 && nack.seqs[0] == 0)
+    snapshot_requested = std::chrono::steady_clock::now();
   auto msg = make_command_message(
     master_topic,
     internal_command{0, id, master_id, nack_command{std::move(nack.seqs)}});
@@ -391,9 +528,40 @@ data clone_state::keys() const {
   return result;
 }
 
+data clone_state::get_many(const std::vector<data>& xs) const {
+  table result;
+  for (auto& key : xs)
+    if (auto val = lookup(key))
+      result.insert_or_assign(key, *val);
+  return result;
+}
+
+const data* clone_state::lookup(const data& key) const {
+  if (!overlay.empty()) {
+    if (auto i = overlay.find(key); i != overlay.end()) {
+      const auto& val = i->second.back().value;
+      return val ? std::addressof(*val) : nullptr;
+    }
+  }
+  if (auto i = store.find(key); i != store.end())
+    return std::addressof(i->second);
+  return nullptr;
+}
+
 void clone_state::set_store(std::unordered_map<data, data> x) {
   BROKER_TRACE("");
   BROKER_INFO("SET" << x);
+  local_view_dirty = true;
+  checkpoint_dirty = true;
+  overlay.clear();
+  if (!key_prefix.empty()) {
+    for (auto i = x.begin(); i != x.end();) {
+      if (accepts(i->first))
+        ++i;
+      else
+        i = x.erase(i);
+    }
+  }
   // We consider the master the source of all updates.
   entity_id publisher = input.producer();
   // Short-circuit messages with an empty state.
@@ -402,6 +570,8 @@ void clone_state::set_store(std::unordered_map<data, data> x) {
       clear_command cmd{publisher};
       consume(cmd);
     }
+  } else if (on_demand_events && !has_event_subscribers) {
+    // Nobody listens to the events, so we can skip computing the difference.
   } else if (store.empty()) {
     // Emit insert events.
     for (auto& [key, value] : x)
@@ -420,33 +590,199 @@ void clone_state::set_store(std::unordered_map<data, data> x) {
       const auto& value = x[**i];
       emit_update_event(**i, store[**i], value, std::nullopt, publisher);
     }
-    // Emit insert events.
-    auto is_new = [&keys](const data& key) {
-      for (const auto key_ptr : keys)
-        if (*key_ptr == key)
-          return false;
-      return true;
-    };
+    // Emit insert events. The old state is still intact, so a lookup tells
+    // us which keys are new.
     for (const auto& [key, value] : x)
-      if (is_new(key))
+      if (store.find(key) == store.end())
         emit_insert_event(key, value, std::nullopt, publisher);
   }
   // Override local state.
-  store = std::move(x);
+  store.clear();
+  store.reserve(x.size());
+  while (!x.empty()) {
+    auto node = x.extract(x.begin());
+    store.emplace(std::move(node.key()), std::move(node.mapped()));
+  }
   // Trigger any GET messages waiting for a reply.
   for (auto& callback : on_set_store_callbacks)
     callback();
   on_set_store_callbacks.clear();
 }
 
+bool clone_state::accepts(const data& key) const noexcept {
+  if (key_prefix.empty())
+    return true;
+  auto* str = get_if<std::string>(key);
+  return str != nullptr && str->compare(0, key_prefix.size(), key_prefix) == 0;
+}
+
+// -- optimistic writes --------------------------------------------------------
+
+void clone_state::apply_optimistic(const internal_command_variant& content) {
+  if (optimistic_writes.count() <= 0)
+    return;
+  auto deadline = clock->now() + optimistic_writes;
+  auto write = [this, deadline](const data& key, const data* value) {
+    if (!accepts(key))
+      return;
+    auto& entry = overlay[key];
+    if (value)
+      entry.push_back(pending_write{*value, deadline});
+    else
+      entry.push_back(pending_write{std::nullopt, deadline});
+    local_view_dirty = true;
+  };
+  auto f = [this, &write](const auto& cmd) {
+    using cmd_type = std::decay_t<decltype(cmd)>;
+    if constexpr (std::is_same_v<cmd_type, put_command>) {
+      write(cmd.key, &cmd.value);
+    } else if constexpr (std::is_same_v<cmd_type, erase_command>) {
+      write(cmd.key, nullptr);
+    } else if constexpr (std::is_same_v<cmd_type, clear_command>) {
+      overlay.clear();
+      local_view_dirty = true;
+    } else if constexpr (std::is_same_v<cmd_type, add_command>
+                         || std::is_same_v<cmd_type, subtract_command>
+                         || std::is_same_v<cmd_type, put_unique_command>) {
+      // We cannot predict the result. Hence, reads fall back to the
+      // confirmed state until the master responds.
+      if (overlay.erase(cmd.key) != 0)
+        local_view_dirty = true;
+    }
+  };
+  std::visit(f, content);
+}
+
+void clone_state::reconcile(const data& key, const data* value) {
+  if (overlay.empty())
+    return;
+  auto i = overlay.find(key);
+  if (i == overlay.end())
+    return;
+  // The master applies our writes in order. Hence, its echo must match our
+  // oldest pending write.
+  auto& entry = i->second;
+  auto& oldest = entry.front().value;
+  auto match = value != nullptr ? oldest && *oldest == *value : !oldest;
+  // On a mismatch, the master applied a write from someone else (or rejected
+  // ours). Either way, its update is authoritative.
+  if (match)
+    entry.pop_front();
+  if (!match || entry.empty())
+    overlay.erase(i);
+  local_view_dirty = true;
+}
+
+void clone_state::expire_optimistic() {
+  if (overlay.empty())
+    return;
+  auto now = clock->now();
+  for (auto i = overlay.begin(); i != overlay.end();) {
+    // Deadlines increase from front to back.
+    auto& entry = i->second;
+    while (!entry.empty() && entry.front().deadline <= now) {
+      BROKER_DEBUG("drop unconfirmed write for" << i->first);
+      entry.pop_front();
+      local_view_dirty = true;
+    }
+    if (entry.empty())
+      i = overlay.erase(i);
+    else
+      ++i;
+  }
+}
+
 bool clone_state::has_master() const noexcept {
   return input.initialized();
 }
 
+void clone_state::publish_local_view() {
+  if (!local_reads)
+    return;
+  // Without a master, reads must go through the actor to honor
+  // `max_get_delay`.
+  if (!has_master()) {
+    local_view = nullptr;
+    local_view_dirty = true;
+  } else if (local_view_dirty || !local_view) {
+    auto view = std::make_shared<snapshot>(store.begin(), store.end());
+    for (const auto& [key, entry] : overlay) {
+      if (const auto& val = entry.back().value)
+        view->insert_or_assign(key, *val);
+      else
+        view->erase(key);
+    }
+    local_view = std::move(view);
+    local_view_dirty = false;
+  }
+  for (auto& kvp : attached_states)
+    if (kvp.first->local_view() != local_view)
+      kvp.first->local_view(local_view);
+}
+
+// -- checkpoints --------------------------------------------------------------
+
+bool clone_state::restore_checkpoint() {
+  if (checkpoint_path.empty())
+    return false;
+  auto cp = clone_checkpoint::load(checkpoint_path);
+  if (!cp || !cp->master || cp->next_seq == 0)
+    return false;
+  BROKER_INFO("restore" << cp->entries.size() << "entries of" << store_name
+                        << "from checkpoint at seq" << cp->next_seq);
+  master_id = cp->master;
+  input.resume(cp->master, cp->next_seq, cp->heartbeat_interval);
+  resuming = true;
+  set_store(std::move(cp->entries));
+  checkpoint_dirty = false;
+  return true;
+}
+
+void clone_state::maybe_write_checkpoint() {
+  if (checkpoint_path.empty() || !checkpoint_dirty || !input.initialized())
+    return;
+  auto t = clock->now();
+  if (t < next_checkpoint)
+    return;
+  write_checkpoint();
+  next_checkpoint = t + checkpoint_interval;
+}
+
+void clone_state::write_checkpoint() {
+  clone_checkpoint cp;
+  cp.master = master_id;
+  cp.next_seq = input.next_seq();
+  cp.heartbeat_interval = input.heartbeat_interval();
+  cp.entries.reserve(store.size());
+  for (const auto& [key, value] : store)
+    cp.entries.emplace(key, value);
+  if (cp.save(checkpoint_path)) {
+    BROKER_DEBUG("wrote checkpoint for" << store_name << "at seq"
+                                        << cp.next_seq);
+    checkpoint_dirty = false;
+  }
+}
+
 bool clone_state::idle() const noexcept {
   return input.idle() && (!output_opt || output_opt->idle());
 }
 
+bool clone_state::quiescent(timestamp) const noexcept {
+  // Without a master, the clone has to retry its attach operation and to
+  // check `sync_timeout` on each tick.
+  return has_master() && !sync_timeout && idle() && pending_events.empty()
+         && overlay.empty()
+         && !(local_reads && local_view_dirty)
+         && (checkpoint_path.empty() || !checkpoint_dirty);
+}
+
+void clone_state::hibernate() {
+  super::hibernate();
+  input.compact();
+  if (output_opt)
+    output_opt->compact();
+}
+
 // -- helper functions ---------------------------------------------------------
 
 void clone_state::start_output() {
@@ -460,8 +796,7 @@ void clone_state::start_output() {
   super::init(*output_opt);
   output_opt->add(master_id);
   if (!stalled.empty()) {
-    std::vector<internal_command_variant> buf;
-    buf.swap(stalled);
+    auto buf = stalled.take();
     for (auto& content : buf)
       send_to_master(std::move(content));
     BROKER_ASSERT(stalled.empty());
@@ -479,7 +814,7 @@ void clone_state::send_to_master(internal_command_variant&& content) {
     out.produce(std::move(msg));
   } else {
     BROKER_DEBUG("add command of type" << content.index() << "to buffer");
-    stalled.emplace_back(std::move(content));
+    std::visit([this](auto& cmd) { stalled.push(std::move(cmd)); }, content);
   }
 }
 
@@ -490,16 +825,17 @@ caf::behavior clone_state::make_behavior() {
   self->monitor(core);
   self->set_down_handler(
     [this](const caf::down_msg& msg) { on_down_msg(msg.source, msg.reason); });
-  // Ask the master to add this clone.
-  send(std::addressof(input), clone_state::channel_type::nack{{0}});
+  // Ask the master to add this clone unless it resumes from a checkpoint.
+  if (!restore_checkpoint())
+    send(std::addressof(input), clone_state::channel_type::nack{{0}});
   // Schedule first tick and set a timeout for the attach operation.
-  send_later(self, defaults::store::tick_interval,
-             caf::make_message(atom::tick_v));
+  schedule_tick();
   if (max_sync_interval.count() > 0)
     sync_timeout = caf::make_timestamp() + max_sync_interval;
   return super::make_behavior(
     // --- local communication -------------------------------------------------
     [=](atom::local, internal_command_variant& content) {
+      wakeup();
       if (auto inner = get_if<put_unique_command>(&content)) {
         if (inner->who) {
           BROKER_DEBUG("received put_unique with who"
@@ -515,13 +851,18 @@ caf::behavior clone_state::make_behavior() {
           return;
         }
       }
+      apply_optimistic(content);
       send_to_master(std::move(content));
     },
     [=](atom::sync_point, caf::actor& who) {
       self->send(who, atom::sync_point_v);
     },
-    [=](atom::tick) {
-      tick();
+    [=](atom::tick, uint64_t generation) {
+      auto n = due_ticks(generation);
+      if (n == 0)
+        return;
+      for (size_t i = 0; i < n; ++i)
+        tick();
       if (sync_timeout) {
         if (has_master()) {
           sync_timeout.reset();
@@ -535,8 +876,7 @@ caf::behavior clone_state::make_behavior() {
           return;
         }
       }
-      send_later(self, defaults::store::tick_interval,
-                 caf::make_message(atom::tick_v));
+      schedule_tick();
       if (!idle_callbacks.empty() && idle()) {
         for (auto& rp : idle_callbacks)
           rp.deliver(atom::ok_v);
@@ -565,10 +905,38 @@ caf::behavior clone_state::make_behavior() {
         id);
       return rp;
     },
+    [=](atom::get, atom::keys, data& first, data& last,
+        count limit) -> caf::result<data> {
+      auto rp = self->make_response_promise();
+      auto filter = detail::key_range_filter(std::move(first), std::move(last));
+      get_impl(rp, [this, rp, filter{std::move(filter)}, limit]() mutable {
+        auto collector = detail::make_key_collector(std::move(filter), limit);
+        for (const auto& kvp : store)
+          collector.add(kvp.first);
+        auto x = std::move(collector).result();
+        BROKER_INFO("RANGE ->" << x);
+        rp.deliver(std::move(x));
+      });
+      return rp;
+    },
+    [=](atom::get, atom::keys, std::string& prefix,
+        count limit) -> caf::result<data> {
+      auto rp = self->make_response_promise();
+      auto filter = detail::key_prefix_filter(std::move(prefix));
+      get_impl(rp, [this, rp, filter{std::move(filter)}, limit]() mutable {
+        auto collector = detail::make_key_collector(std::move(filter), limit);
+        for (const auto& kvp : store)
+          collector.add(kvp.first);
+        auto x = std::move(collector).result();
+        BROKER_INFO("KEYS_WITH_PREFIX ->" << x);
+        rp.deliver(std::move(x));
+      });
+      return rp;
+    },
     [=](atom::exists, data& key) -> caf::result<data> {
       auto rp = self->make_response_promise();
       get_impl(rp, [this, rp, key{std::move(key)}]() mutable {
-        auto result = this->store.count(key) != 0;
+        auto result = this->lookup(key) != nullptr;
         BROKER_INFO("EXISTS" << key << "->" << result);
         rp.deliver(data{result});
       });
@@ -579,7 +947,7 @@ caf::behavior clone_state::make_behavior() {
       get_impl(
         rp,
         [this, rp, key{std::move(key)}, id]() mutable {
-          auto result = this->store.count(key) != 0;
+          auto result = this->lookup(key) != nullptr;
           BROKER_INFO("EXISTS" << key << "with id" << id << "->" << result);
           rp.deliver(data{result}, id);
         },
@@ -590,9 +958,9 @@ caf::behavior clone_state::make_behavior() {
       auto rp = self->make_response_promise();
       get_impl(rp, [this, rp, key{std::move(key)}]() mutable {
         if (rp.pending()) {
-          if (auto i = this->store.find(key); i != this->store.end()) {
-            BROKER_INFO("GET" << key << "->" << i->second);
-            rp.deliver(i->second);
+          if (auto val = this->lookup(key)) {
+            BROKER_INFO("GET" << key << "->" << *val);
+            rp.deliver(*val);
           } else {
             BROKER_INFO("GET" << key << "-> no_such_key");
             rp.deliver(caf::make_error(ec::no_such_key));
@@ -605,9 +973,9 @@ caf::behavior clone_state::make_behavior() {
       auto rp = self->make_response_promise();
       get_impl(rp, [this, rp, key{std::move(key)},
                     aspect{std::move(aspect)}]() mutable {
-        if (auto i = this->store.find(key); i != this->store.end()) {
-          BROKER_INFO("GET" << key << aspect << "->" << i->second);
-          if (auto res = visit(detail::retriever{aspect}, i->second))
+        if (auto val = this->lookup(key)) {
+          BROKER_INFO("GET" << key << aspect << "->" << *val);
+          if (auto res = visit(detail::retriever{aspect}, *val))
             rp.deliver(std::move(*res));
           else
             rp.deliver(native(res.error()));
@@ -618,14 +986,55 @@ caf::behavior clone_state::make_behavior() {
       });
       return rp;
     },
+    [=](atom::get, data& key, value_query op,
+        data& arg) -> caf::result<data> {
+      auto rp = self->make_response_promise();
+      get_impl(rp, [this, rp, key{std::move(key)}, op,
+                    arg{std::move(arg)}]() mutable {
+        if (auto val = this->lookup(key)) {
+          auto x = visit(detail::evaluator{op, arg}, *val);
+          BROKER_INFO("QUERY" << key << op << arg << "->" << x);
+          if (x)
+            rp.deliver(std::move(*x));
+          else
+            rp.deliver(native(x.error()));
+        } else {
+          BROKER_INFO("QUERY" << key << op << "-> no_such_key");
+          rp.deliver(caf::make_error(ec::no_such_key));
+        }
+      });
+      return rp;
+    },
+    [=](atom::get, data& key, value_query op, data& arg, request_id id) {
+      auto rp = self->make_response_promise();
+      get_impl(
+        rp,
+        [this, rp, key{std::move(key)}, op, arg{std::move(arg)}, id]() mutable {
+          if (auto val = this->lookup(key)) {
+            auto x = visit(detail::evaluator{op, arg}, *val);
+            BROKER_INFO("QUERY" << key << op << arg << "with id" << id << "->"
+                                << x);
+            if (x)
+              rp.deliver(std::move(*x), id);
+            else
+              rp.deliver(std::move(native(x.error())), id);
+          } else {
+            BROKER_INFO("QUERY" << key << op << "with id" << id
+                                << "-> no_such_key");
+            rp.deliver(caf::make_error(ec::no_such_key), id);
+          }
+        },
+        id);
+      return rp;
+    },
     [=](atom::get, data& key, request_id id) {
       auto rp = self->make_response_promise();
       get_impl(
         rp,
         [this, rp, key{std::move(key)}, id]() mutable {
-          if (auto i = this->store.find(key); i != this->store.end()) {
-            BROKER_INFO("GET" << key << "with id" << id << "->" << i->second);
-            rp.deliver(i->second, id);
+          if (auto val = this->lookup(key)) {
+            BROKER_INFO("GET" << key << "with id" << id << "->" << *val);
+            rp.deliver(*val, id);
           } else {
             BROKER_INFO("GET" << key << "with id" << id << "-> no_such_key");
             rp.deliver(caf::make_error(ec::no_such_key), id);
@@ -634,13 +1043,34 @@ caf::behavior clone_state::make_behavior() {
         id);
       return rp;
     },
+    [=](atom::get, std::vector<data>& keys) -> caf::result<data> {
+      auto rp = self->make_response_promise();
+      get_impl(rp, [this, rp, keys{std::move(keys)}]() mutable {
+        auto x = get_many(keys);
+        BROKER_INFO("GET_MANY" << keys << "->" << x);
+        rp.deliver(std::move(x));
+      });
+      return rp;
+    },
+    [=](atom::get, std::vector<data>& keys, request_id id) {
+      auto rp = self->make_response_promise();
+      get_impl(
+        rp,
+        [this, rp, keys{std::move(keys)}, id]() mutable {
+          auto x = get_many(keys);
+          BROKER_INFO("GET_MANY" << keys << "with id" << id << "->" << x);
+          rp.deliver(std::move(x), id);
+        },
+        id);
+      return rp;
+    },
     [=](atom::get, data& key, data& aspect, request_id id) {
       auto rp = self->make_response_promise();
       get_impl(
         rp,
         [this, rp, key{std::move(key)}, asp{std::move(aspect)}, id]() mutable {
-          if (auto i = this->store.find(key); i != this->store.end()) {
-            auto x = visit(detail::retriever{asp}, i->second);
+          if (auto val = this->lookup(key)) {
+            auto x = visit(detail::retriever{asp}, *val);
             BROKER_INFO("GET" << key << asp << "with id" << id << "->" << x);
             if (x)
               rp.deliver(std::move(*x), id);
@@ -655,6 +1085,39 @@ caf::behavior clone_state::make_behavior() {
         id);
       return rp;
     },
+    [=](atom::get, store_request_batch_ptr& batch) {
+      auto rp = self->make_response_promise();
+      get_impl_or(
+        rp,
+        [this, rp, batch]() mutable {
+          if (!rp.pending())
+            return;
+          auto result = std::make_shared<store_response_batch>();
+          auto& responses = result->responses;
+          responses.reserve(batch->size());
+          for (const auto& req : batch->requests) {
+            auto val = this->lookup(req.key);
+            if (req.op == store_request_batch::kind::exists)
+              responses.push_back(
+                store::response{data{val != nullptr}, req.id});
+            else if (val != nullptr)
+              responses.push_back(store::response{*val, req.id});
+            else
+              responses.push_back(store::response{ec::no_such_key, req.id});
+          }
+          BROKER_INFO("BATCH with" << batch->size() << "requests");
+          rp.deliver(std::move(result));
+        },
+        [rp, batch]() mutable {
+          auto result = std::make_shared<store_response_batch>();
+          result->responses.reserve(batch->size());
+          for (const auto& req : batch->requests)
+            result->responses.push_back(
+              store::response{ec::stale_data, req.id});
+          rp.deliver(std::move(result));
+        });
+      return rp;
+    },
     [=](atom::get, atom::name) { return store_name; },
     [=](atom::await, atom::idle) -> caf::result<atom::ok> {
       if (idle())
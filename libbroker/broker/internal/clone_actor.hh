@@ -1,6 +1,9 @@
 #pragma once
 
+#include <chrono>
+#include <deque>
 #include <optional>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -8,13 +11,18 @@
 #include <caf/behavior.hpp>
 #include <caf/event_based_actor.hpp>
 #include <caf/stateful_actor.hpp>
+#include <caf/telemetry/histogram.hpp>
 
 #include "broker/data.hh"
+#include "broker/detail/flat_hash_map.hh"
 #include "broker/endpoint.hh"
 #include "broker/entity_id.hh"
 #include "broker/internal/store_actor.hh"
+#include "broker/internal/update_coalescer.hh"
 #include "broker/internal_command.hh"
 #include "broker/message.hh"
+#include "broker/snapshot.hh"
+#include "broker/time.hh"
 #include "broker/topic.hh"
 
 namespace broker::internal {
@@ -35,11 +43,14 @@ public:
   // -- initialization ---------------------------------------------------------
 
   clone_state(caf::event_based_actor* ptr, endpoint_id this_endpoint,
-              std::string nm, caf::timespan master_timeout, caf::actor parent,
+              std::string nm, caf::timespan master_timeout,
+              std::string key_prefix, caf::actor parent,
               endpoint::clock* ep_clock,
               caf::async::consumer_resource<command_message> in_res,
               caf::async::producer_resource<command_message> out_res);
 
+  ~clone_state() override;
+
   /// Sends `x` to the master.
   void forward(internal_command&& x);
 
@@ -51,6 +62,10 @@ public:
 
   table status_snapshot() const override;
 
+  bool quiescent(timestamp until) const noexcept override;
+
+  void hibernate() override;
+
   void tick();
 
   // -- callbacks for the consumer ---------------------------------------------
@@ -67,6 +82,8 @@ public:
 
   void consume(clear_command& cmd);
 
+  void consume(batch_command& cmd);
+
   template <class T>
   void consume(T& cmd) {
     BROKER_ERROR("master got unexpected command:" << cmd);
@@ -101,6 +118,13 @@ public:
   /// Returns all keys of the store.
   data keys() const;
 
+  /// Returns the value for `key`, preferring unconfirmed local writes, or
+  /// `nullptr` if the key does not exist.
+  const data* lookup(const data& key) const;
+
+  /// Returns a table with the values for all keys in `xs` that exist.
+  data get_many(const std::vector<data>& xs) const;
+
   /// Sets the store content of the clone.
   void set_store(std::unordered_map<data, data> x);
 
@@ -109,6 +133,37 @@ public:
 
   bool idle() const noexcept;
 
+  /// Publishes a copy of `store` to all attached frontends if `local_reads` is
+  /// enabled and the content changed since the last call.
+  void publish_local_view();
+
+  // -- optimistic writes ------------------------------------------------------
+
+  /// Applies a local command to `overlay` before sending it to the master.
+  void apply_optimistic(const internal_command_variant& content);
+
+  /// Reconciles `overlay` with an update from the master by comparing it to
+  /// the oldest pending write for `key`. A `nullptr` for `value` marks an
+  /// erased key.
+  void reconcile(const data& key, const data* value);
+
+  /// Drops overlay entries that the master failed to confirm in time.
+  void expire_optimistic();
+
+  // -- checkpoints ------------------------------------------------------------
+
+  /// Restores `store` from the checkpoint at `checkpoint_path` and resumes the
+  /// channel to the master that produced the checkpoint.
+  /// @returns `true` if the clone resumed from a checkpoint.
+  bool restore_checkpoint();
+
+  /// Writes a checkpoint if the content changed and `checkpoint_interval` has
+  /// passed since the last write.
+  void maybe_write_checkpoint();
+
+  /// Writes the current content of the clone to `checkpoint_path`.
+  void write_checkpoint();
+
   // -- helper functions -------------------------------------------------------
 
   /// Runs @p body immediately if the master is available. Otherwise, schedules
@@ -117,17 +172,25 @@ public:
   template <class F>
   void get_impl(caf::response_promise& rp, F&& body,
                 std::optional<request_id> req_id = std::nullopt) {
+    get_impl_or(rp, std::forward<F>(body), [rp, req_id]() mutable {
+      if (!req_id)
+        rp.deliver(caf::make_error(ec::stale_data));
+      else
+        rp.deliver(caf::make_error(ec::stale_data), *req_id);
+    });
+  }
+
+  /// Like `get_impl`, but calls @p on_stale instead of responding with a
+  /// single `stale_data` error when running into the timeout.
+  template <class F, class G>
+  void get_impl_or(caf::response_promise& rp, F&& body, G on_stale) {
     if (has_master()) {
       body();
       return;
     }
-    auto emit_stale_data = [rp, req_id]() mutable {
-      if (rp.pending()) {
-        if (!req_id)
-          rp.deliver(caf::make_error(ec::stale_data));
-        else
-          rp.deliver(caf::make_error(ec::stale_data), *req_id);
-      }
+    auto emit_stale_data = [rp, on_stale]() mutable {
+      if (rp.pending())
+        on_stale();
     };
     if (max_get_delay.count() > 0) {
       self->run_delayed(max_get_delay, emit_stale_data);
@@ -144,11 +207,18 @@ public:
   /// `start_output` gets called.
   void send_to_master(internal_command_variant&& content);
 
+  /// Checks whether the clone keeps a copy of `key`.
+  bool accepts(const data& key) const noexcept;
+
   // -- member variables -------------------------------------------------------
 
   topic master_topic;
 
-  std::unordered_map<data, data> store;
+  detail::flat_hash_map<data, data> store;
+
+  /// Restricts the clone to string keys that start with this prefix. An empty
+  /// prefix selects all keys.
+  std::string key_prefix;
 
   consumer_type input;
 
@@ -168,6 +238,50 @@ public:
 
   std::vector<on_set_store> on_set_store_callbacks;
 
+  /// Configures whether the clone publishes its content for local reads.
+  bool local_reads = false;
+
+  /// Stores whether `store` changed since the last call to
+  /// `publish_local_view`.
+  bool local_view_dirty = true;
+
+  /// Stores the most recent copy of `store` for local reads.
+  std::shared_ptr<const snapshot> local_view;
+
+  /// Stores the path for persisting the content of the clone or an empty
+  /// string if `broker.store.clone-checkpoint-directory` is not set.
+  std::string checkpoint_path;
+
+  /// Caches the configuration parameter
+  /// `broker.store.clone-checkpoint-interval`.
+  timespan checkpoint_interval = defaults::store::clone_checkpoint_interval;
+
+  /// Stores when the clone may write its next checkpoint.
+  timestamp next_checkpoint;
+
+  /// Stores whether `store` changed since writing the last checkpoint.
+  bool checkpoint_dirty = false;
+
+  /// Stores whether the clone resumed from a checkpoint and did not hear from
+  /// its master since.
+  bool resuming = false;
+
+  /// Collects the snapshot chunks from the master until receiving the ACK.
+  std::unordered_map<data, data> pending_snapshot;
+
+  /// Stores the index of the next expected snapshot chunk.
+  uint64_t next_snapshot_chunk = 0;
+
+  /// Stores how many snapshot chunks precede the ACK from the master.
+  uint64_t snapshot_chunk_count = 0;
+
+  /// Stores when the clone asked its master for a full snapshot.
+  std::optional<std::chrono::steady_clock::time_point> snapshot_requested;
+
+  /// Observes how long it takes from requesting a snapshot until receiving
+  /// the complete state from the master.
+  caf::telemetry::dbl_histogram* snapshot_duration = nullptr;
+
   entity_id master_id;
 
   /// Stores writes that are currently stalled by the clone. This solves a race
@@ -175,8 +289,29 @@ public:
   /// before the master completed the handshake with `input`. Without this
   /// stalling, a clone might "miss" its own writes. This becomes particularly
   /// problematic for `put_unique` operations if the master performs these
-  /// operations before attaching the clone as a consumer.
-  std::vector<internal_command_variant> stalled;
+  /// operations before attaching the clone as a consumer. Merges redundant
+  /// writes if `broker.store.coalesce-updates` is enabled.
+  update_coalescer<internal_command_variant> stalled;
+
+  /// A local write that the master did not confirm yet.
+  struct pending_write {
+    /// Stores the written value or `nullopt` for an erased key.
+    std::optional<data> value;
+
+    /// Stores when the clone gives up waiting for the master.
+    timestamp deadline;
+  };
+
+  /// Stores the unconfirmed local writes to a key, oldest first. Reads see the
+  /// most recent write and each update from the master confirms the oldest.
+  using overlay_entry = std::deque<pending_write>;
+
+  /// Caches the configuration parameter `broker.store.optimistic-writes`.
+  timespan optimistic_writes = defaults::store::optimistic_writes;
+
+  /// Stores local writes until the master confirms them if
+  /// `optimistic_writes` is positive.
+  std::unordered_map<data, overlay_entry> overlay;
 
   static inline constexpr const char* name = "broker.clone";
 };
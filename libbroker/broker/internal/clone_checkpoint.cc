@@ -0,0 +1,90 @@
+#include "broker/internal/clone_checkpoint.hh"
+
+#include "broker/detail/filesystem.hh"
+#include "broker/internal/logger.hh"
+
+#include <caf/binary_deserializer.hpp>
+#include <caf/binary_serializer.hpp>
+#include <caf/byte_buffer.hpp>
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace broker::internal {
+
+std::string clone_checkpoint::file_name(std::string_view dir,
+                                        const std::string& store_name) {
+  // Store names may contain characters such as '/' (e.g., for shards). Hence,
+  // we percent-encode everything but a few safe characters.
+  constexpr auto hex = "0123456789ABCDEF";
+  std::string result{dir};
+  if (!result.empty() && result.back() != '/')
+    result += '/';
+  for (auto c : store_name) {
+    auto uc = static_cast<unsigned char>(c);
+    if (std::isalnum(uc) || c == '-' || c == '_' || c == '.') {
+      result += c;
+    } else {
+      result += '%';
+      result += hex[uc >> 4];
+      result += hex[uc & 0x0F];
+    }
+  }
+  result += ".checkpoint";
+  return result;
+}
+
+bool clone_checkpoint::save(const std::string& path) const {
+  caf::byte_buffer buf;
+  caf::binary_serializer sink{nullptr, buf};
+  if (!sink.apply(format_version) || !sink.apply(*this)) {
+    BROKER_ERROR("failed to serialize clone checkpoint");
+    return false;
+  }
+  auto tmp = path + ".tmp";
+  {
+    std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+    out.write(reinterpret_cast<const char*>(buf.data()),
+              static_cast<std::streamsize>(buf.size()));
+    if (!out) {
+      BROKER_ERROR("failed to write clone checkpoint" << tmp);
+      return false;
+    }
+  }
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+    // Some platforms refuse to replace an existing file.
+    detail::remove(path);
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+      BROKER_ERROR("failed to replace clone checkpoint" << path);
+      return false;
+    }
+  }
+  return true;
+}
+
+std::optional<clone_checkpoint>
+clone_checkpoint::load(const std::string& path) {
+  if (!detail::is_file(path))
+    return std::nullopt;
+  std::ifstream in{path, std::ios::binary};
+  std::vector<char> buf{std::istreambuf_iterator<char>{in},
+                        std::istreambuf_iterator<char>{}};
+  caf::binary_deserializer source{nullptr, buf.data(), buf.size()};
+  uint32_t version = 0;
+  if (!source.apply(version) || version != format_version) {
+    BROKER_WARNING("ignore clone checkpoint" << path
+                                             << "with unsupported version");
+    return std::nullopt;
+  }
+  clone_checkpoint result;
+  if (!source.apply(result) || source.remaining() != 0) {
+    BROKER_WARNING("ignore malformed clone checkpoint" << path);
+    return std::nullopt;
+  }
+  return result;
+}
+
+} // namespace broker::internal
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "broker/data.hh"
+#include "broker/entity_id.hh"
+#include "broker/fwd.hh"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace broker::internal {
+
+/// Persistent state of a clone that allows it to serve reads right after a
+/// restart and to resume its channel to the master instead of requesting a
+/// full snapshot.
+struct clone_checkpoint {
+  /// Identifies the file format.
+  static constexpr uint32_t format_version = 1;
+
+  /// Identifies the master that produced `entries`.
+  entity_id master;
+
+  /// Stores the sequence number of the next event from the master, i.e., the
+  /// clone has applied all events before this sequence number to `entries`.
+  sequence_number_type next_seq = 0;
+
+  /// Stores the heartbeat interval of the master.
+  tick_interval_type heartbeat_interval = 0;
+
+  /// Stores the content of the clone.
+  std::unordered_map<data, data> entries;
+
+  /// Returns the path for the checkpoint of `store_name` in `dir`.
+  static std::string file_name(std::string_view dir,
+                               const std::string& store_name);
+
+  /// Writes the checkpoint to `path`, replacing a previous version of the
+  /// file only after writing the new version completely.
+  /// @returns `true` on success, `false` otherwise.
+  bool save(const std::string& path) const;
+
+  /// Reads a checkpoint from `path`.
+  /// @returns the checkpoint or `std::nullopt` if `path` does not exist or
+  ///          contains no valid checkpoint.
+  static std::optional<clone_checkpoint> load(const std::string& path);
+};
+
+/// @relates clone_checkpoint
+template <class Inspector>
+bool inspect(Inspector& f, clone_checkpoint& x) {
+  return f.object(x).fields(f.field("master", x.master),
+                            f.field("next_seq", x.next_seq),
+                            f.field("heartbeat_interval", x.heartbeat_interval),
+                            f.field("entries", x.entries));
+}
+
+} // namespace broker::internal
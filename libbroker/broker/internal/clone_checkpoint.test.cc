@@ -0,0 +1,59 @@
+#include "broker/internal/clone_checkpoint.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include "broker/detail/filesystem.hh"
+
+#include <fstream>
+
+using namespace broker;
+
+namespace {
+
+struct fixture {
+  std::string path = detail::make_temp_file_name();
+
+  ~fixture() {
+    detail::remove(path);
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(clone_checkpoint_tests, fixture)
+
+TEST(file names encode special characters of the store name) {
+  using internal::clone_checkpoint;
+  CHECK_EQUAL(clone_checkpoint::file_name("/tmp", "foo"),
+              "/tmp/foo.checkpoint");
+  CHECK_EQUAL(clone_checkpoint::file_name("/tmp/", "foo/1"),
+              "/tmp/foo%2F1.checkpoint");
+}
+
+TEST(checkpoints survive a round trip through the file system) {
+  internal::clone_checkpoint x;
+  x.master = entity_id{endpoint_id::random(42), 7};
+  x.next_seq = 23;
+  x.heartbeat_interval = 5;
+  x.entries.emplace(data{"a"}, data{1});
+  x.entries.emplace(data{"b"}, data{vector{data{2}, data{"c"}}});
+  REQUIRE(x.save(path));
+  auto y = internal::clone_checkpoint::load(path);
+  REQUIRE(y);
+  CHECK_EQUAL(y->master, x.master);
+  CHECK_EQUAL(y->next_seq, 23u);
+  CHECK_EQUAL(y->heartbeat_interval, 5u);
+  CHECK(y->entries == x.entries);
+}
+
+TEST(loading ignores missing and malformed files) {
+  detail::remove(path);
+  CHECK(!internal::clone_checkpoint::load(path));
+  {
+    std::ofstream out{path, std::ios::binary};
+    out << "garbage";
+  }
+  CHECK(!internal::clone_checkpoint::load(path));
+}
+
+FIXTURE_SCOPE_END()
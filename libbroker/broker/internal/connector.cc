@@ -24,10 +24,20 @@
 #include <caf/net/tcp_accept_socket.hpp>
 #include <caf/net/tcp_stream_socket.hpp>
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
 #include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 // -- platform setup -----------------------------------------------------------
 
@@ -51,6 +61,8 @@
 #else
 #  include <sys/types.h>
 #  include <sys/socket.h>
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
 #  include <poll.h>
 #endif // CAF_WINDOWS
 // clang-format on
@@ -91,6 +103,14 @@ namespace bin_v1 = broker::format::bin::v1;
 
 namespace {
 
+struct ssl_session_deleter {
+  void operator()(SSL_SESSION* ptr) const noexcept {
+    SSL_SESSION_free(ptr);
+  }
+};
+
+using ssl_session_ptr = std::unique_ptr<SSL_SESSION, ssl_session_deleter>;
+
 // -- OpenSSL setup ------------------------------------------------------------
 
 class ssl_error : public std::runtime_error {
@@ -206,6 +226,19 @@ ssl_context_from_cfg(const openssl_options_ptr& cfg) {
   auto method = TLSv1_2_method();
 #endif
   auto ctx = caf::net::openssl::make_ctx(method);
+  // Allow peers to resume their session when reconnecting. OpenSSL refuses to
+  // resume sessions on servers that verify their peers unless we set a session
+  // ID context.
+  static constexpr unsigned char session_id_context[] = "broker";
+  SSL_CTX_set_session_id_context(ctx.get(), session_id_context,
+                                 sizeof(session_id_context) - 1);
+#ifdef SSL_OP_ENABLE_KTLS
+  if (cfg->enable_ktls)
+    SSL_CTX_set_options(ctx.get(), SSL_OP_ENABLE_KTLS);
+#else
+  if (cfg->enable_ktls)
+    BROKER_WARNING("kTLS requires OpenSSL 3.0 or later -> ignore enable-ktls");
+#endif
   BROKER_DEBUG(BROKER_ARG2("authentication", cfg->authentication_enabled()));
   if (cfg->authentication_enabled()) {
     // Require valid certificates on both sides.
@@ -285,6 +318,10 @@ public:
                                           << "(no SSL)");
     using trait_t = wire_format::v1::trait;
     if (fd_ != caf::net::invalid_socket) {
+      // Note: the framing layer appends all envelopes that are available when
+      // the socket becomes writable to a single write buffer, i.e., frames are
+      // coalesced per wakeup of the multiplexer. Likewise, a single read may
+      // yield any number of frames. Hence, we do not batch on top of CAF.
       using caf::net::run_with_length_prefix_framing;
       auto& mpx = sys.network_manager().mpx();
       auto res = run_with_length_prefix_framing(mpx, fd_, caf::settings{},
@@ -592,6 +629,9 @@ public:
   /// Keeps track of how many times we tried to connect to the remote node.
   size_t connection_attempts = 0;
 
+  /// Stores whether the remote node initiated the connection.
+  bool incoming = false;
+
   /// Stores whether we detected a redundant connection. Either locally or by
   /// receiving a drop_con messages from the remote.
   bool redundant = false;
@@ -614,8 +654,8 @@ public:
   /// Returns the peer status map for the local endpoint.
   detail::peer_status_map& peer_statuses();
 
-  /// Returns the filter from the local endpoint.
-  filter_type local_filter();
+  /// Returns the current filter snapshot of the local endpoint.
+  shared_filter_type::snapshot_ptr local_filter();
 
   /// Returns the ID of this peer.
   endpoint_id this_peer();
@@ -894,6 +934,17 @@ public:
   template <class T>
   void send(const T& what);
 
+  /// Sends a handshake message of type `T` that carries the local filter.
+  /// Encodes the filter straight from its snapshot instead of copying it into
+  /// a message first.
+  template <class T>
+  void send_local_filter();
+
+  /// Appends a message to the write buffer, prefixed with its size.
+  /// @returns the size of the message.
+  template <class Encode>
+  uint32_t write_frame(Encode encode);
+
   bool handle(wire_format::drop_conn_msg& msg);
 
   bool await_hello_or_version_select(wire_format::var_msg& msg);
@@ -935,6 +986,155 @@ connect_state_ptr make_connect_state(Ts&&... xs) {
   return std::make_shared<connect_state>(std::forward<Ts>(xs)...);
 }
 
+/// Resolves host names and connects to peers on a pool of background threads.
+/// Both steps may block for a while, e.g., when the DNS server is slow or when
+/// the peer is unreachable. Running them on the connector thread would stall
+/// all other handshakes. Each completed attempt writes a byte to a pipe that
+/// the connector polls in order to wake it up.
+class dialer {
+public:
+  /// Bundles a state object with the result of the connection attempt.
+  using result_type =
+    std::pair<connect_state_ptr, caf::expected<caf::net::stream_socket>>;
+
+  explicit dialer(size_t num_threads) {
+    auto fds = caf::net::make_pipe();
+    if (!fds) {
+      auto err_str = to_string(fds.error());
+      fprintf(stderr, "failed to create pipe: %s\n", err_str.c_str());
+      abort();
+    }
+    std::tie(rd_, wr_) = *fds;
+    // Note: a full pipe still has pending bytes for waking up the connector.
+    // Hence, the workers may safely ignore EAGAIN.
+    for (auto fd : {rd_, wr_}) {
+      if (auto err = caf::net::nonblocking(fd, true)) {
+        auto err_str = to_string(err);
+        fprintf(stderr,
+                "failed to set pipe handle %d to nonblocking (line %d): %s\n",
+                (int) fd.id, __LINE__, err_str.c_str());
+        ::abort();
+      }
+    }
+    threads_.reserve(num_threads);
+    for (size_t index = 0; index < num_threads; ++index)
+      threads_.emplace_back([this] { run(); });
+  }
+
+  dialer(const dialer&) = delete;
+
+  dialer& operator=(const dialer&) = delete;
+
+  ~dialer() {
+    {
+      std::unique_lock guard{mtx_};
+      done_ = true;
+    }
+    cv_.notify_all();
+    for (auto& hdl : threads_)
+      hdl.join();
+    caf::net::close(rd_);
+    caf::net::close(wr_);
+  }
+
+  /// Returns the handle that becomes readable after completing an attempt.
+  detail::native_socket wake_fd() const noexcept {
+    return rd_.id;
+  }
+
+  /// Schedules a connection attempt to the address of `state`.
+  void submit(connect_state_ptr state) {
+    caf::uri::authority_type authority;
+    authority.host = state->addr.address;
+    authority.port = state->addr.port;
+    {
+      std::unique_lock guard{mtx_};
+      queue_.emplace_back(std::move(state), std::move(authority));
+    }
+    cv_.notify_one();
+  }
+
+  /// Clears the wake-up pipe and returns all completed attempts.
+  std::vector<result_type> take_results() {
+    caf::byte buf[64];
+    while (caf::net::read(rd_, caf::make_span(buf)) > 0)
+      ; // nop
+    std::vector<result_type> result;
+    std::unique_lock guard{mtx_};
+    result.swap(results_);
+    return result;
+  }
+
+private:
+  void run() {
+    using namespace std::literals;
+    std::unique_lock guard{mtx_};
+    for (;;) {
+      cv_.wait(guard, [this] { return done_ || !queue_.empty(); });
+      if (done_)
+        return;
+      auto [state, authority] = std::move(queue_.front());
+      queue_.pop_front();
+      guard.unlock();
+      BROKER_DEBUG("try connecting to" << authority << "with a timeout of 1s");
+      auto sock = caf::net::make_connected_tcp_stream_socket(authority, 1s);
+      guard.lock();
+      if (done_) {
+        if (sock)
+          caf::net::close(*sock);
+        return;
+      }
+      results_.emplace_back(std::move(state), std::move(sock));
+      const caf::byte wake_byte{0};
+      std::ignore = caf::net::write(wr_, caf::make_span(&wake_byte, 1));
+    }
+  }
+
+  caf::net::pipe_socket rd_;
+  caf::net::pipe_socket wr_;
+  std::vector<std::thread> threads_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  bool done_ = false;
+  std::deque<std::pair<connect_state_ptr, caf::uri::authority_type>> queue_;
+  std::vector<result_type> results_;
+};
+
+/// Sets a socket option, logging a warning on error. Broker keeps going with
+/// the default of the operating system in this case.
+template <class Value>
+void set_sockopt(stream_socket fd, int level, int name, const char* name_str,
+                 Value value) {
+  auto ptr = reinterpret_cast<const char*>(&value);
+  if (setsockopt(fd.id, level, name, ptr, sizeof(Value)) != 0)
+    BROKER_WARNING("failed to set" << name_str << "on socket" << fd.id);
+}
+
+/// Applies user-defined tuning parameters to a peer socket.
+void apply_socket_options(stream_socket fd, const socket_options& opts) {
+  if (opts.send_buffer_size > 0)
+    set_sockopt(fd, SOL_SOCKET, SO_SNDBUF, "SO_SNDBUF",
+                static_cast<int>(opts.send_buffer_size));
+  if (opts.receive_buffer_size > 0)
+    set_sockopt(fd, SOL_SOCKET, SO_RCVBUF, "SO_RCVBUF",
+                static_cast<int>(opts.receive_buffer_size));
+  if (opts.tcp_nodelay) {
+    if (auto err = caf::net::nodelay(fd, true))
+      BROKER_WARNING("failed to set TCP_NODELAY on socket" << fd.id << ":"
+                                                           << err);
+  }
+#ifdef TCP_NOTSENT_LOWAT
+  if (opts.tcp_notsent_lowat > 0)
+    set_sockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, "TCP_NOTSENT_LOWAT",
+                static_cast<int>(opts.tcp_notsent_lowat));
+#endif
+#ifdef SO_BUSY_POLL
+  if (opts.busy_poll > 0)
+    set_sockopt(fd, SOL_SOCKET, SO_BUSY_POLL, "SO_BUSY_POLL",
+                static_cast<int>(opts.busy_poll));
+#endif
+}
+
 struct connect_manager {
   /// Our pollset.
   std::vector<pollfd> fdset;
@@ -967,16 +1167,72 @@ struct connect_manager {
   /// Stores a pointer to the OpenSSL context when running with SSL enabled.
   caf::net::openssl::ctx_ptr ssl_ctx;
 
+  /// Stores the TLS sessions of outgoing connections. Reconnecting to the
+  /// same peer resumes the session, which skips the key exchange.
+  std::map<network_info, ssl_session_ptr> ssl_sessions;
+
+  /// Connects to peers in the background. May be `nullptr`, in which case we
+  /// connect on the connector thread.
+  std::unique_ptr<dialer> dial;
+
+  /// Upper bound for the exponential backoff or 0 for fixed retry intervals.
+  timespan max_retry_interval;
+
+  /// Maximum number of concurrent incoming handshakes or 0 for no limit.
+  size_t max_pending_handshakes;
+
+  /// Tuning parameters for peer sockets.
+  socket_options sock_opts;
+
+  /// Source of randomness for jittering retry intervals.
+  std::minstd_rand rng{std::random_device{}()};
+
   connect_manager(endpoint_id this_peer, connector::listener* ls,
                   shared_filter_type* filter,
                   detail::peer_status_map* peer_statuses,
-                  caf::net::openssl::ctx_ptr ctx)
+                  caf::net::openssl::ctx_ptr ctx, const broker_options& cfg)
     : listener(ls),
       filter(filter),
       peer_statuses_(peer_statuses),
       this_peer(this_peer),
-      ssl_ctx(std::move(ctx)) {
-    BROKER_TRACE(BROKER_ARG(this_peer));
+      ssl_ctx(std::move(ctx)),
+      max_retry_interval(cfg.max_retry_interval),
+      max_pending_handshakes(cfg.max_pending_handshakes),
+      sock_opts(cfg.network) {
+    BROKER_TRACE(BROKER_ARG(this_peer)
+                 << BROKER_ARG2("connector_threads", cfg.connector_threads));
+    if (cfg.connector_threads > 0)
+      dial = std::make_unique<dialer>(cfg.connector_threads);
+  }
+
+  /// Schedules another connection attempt for `state`. Without backoff, the
+  /// connector simply waits for the retry interval of the peer. With backoff,
+  /// the interval doubles after each failed attempt up to
+  /// `max_retry_interval` and we pick a random delay between half the
+  /// interval and the full interval. The jitter keeps many peers from
+  /// reconnecting in lockstep after a node restarts.
+  timespan schedule_retry(connect_state_ptr state) {
+    auto delay = state->addr.retry;
+    if (max_retry_interval.count() > 0) {
+      auto attempts = std::min(state->connection_attempts, size_t{30});
+      for (size_t i = 1; i < attempts && delay < max_retry_interval; ++i)
+        delay *= 2;
+      delay = std::min(delay, std::max(max_retry_interval, state->addr.retry));
+      using dist_t = std::uniform_int_distribution<timespan::rep>;
+      dist_t dist{delay.count() / 2, delay.count()};
+      delay = timespan{dist(rng)};
+    }
+    retry_schedule.emplace(caf::make_timestamp() + delay, std::move(state));
+    return delay;
+  }
+
+  /// Returns the number of incoming connections that perform handshakes.
+  size_t num_pending_incoming() const {
+    size_t result = 0;
+    for (const auto& kvp : pending)
+      if (kvp.second->incoming)
+        ++result;
+    return result;
   }
 
   connect_manager(const connect_manager&) = delete;
@@ -1045,12 +1301,34 @@ struct connect_manager {
     using namespace std::literals;
     BROKER_TRACE("");
     BROKER_ASSERT(!state->addr.address.empty());
+    ++state->connection_attempts;
+    if (dial) {
+      dial->submit(std::move(state));
+      return;
+    }
     caf::uri::authority_type authority;
     authority.host = state->addr.address;
     authority.port = state->addr.port;
     BROKER_DEBUG("try connecting to" << authority << "with a timeout of 1s");
+    auto sock = caf::net::make_connected_tcp_stream_socket(authority, 1s);
+    on_connect_result(std::move(state), std::move(sock));
+  }
+
+  /// Processes all connection attempts that the dialer has completed.
+  void handle_dial_results() {
+    BROKER_ASSERT(dial != nullptr);
+    for (auto& [state, sock] : dial->take_results())
+      on_connect_result(std::move(state), std::move(sock));
+  }
+
+  /// Starts the handshake on a newly connected socket or schedules a retry.
+  void on_connect_result(connect_state_ptr state,
+                         caf::expected<stream_socket> sock) {
+    caf::uri::authority_type authority;
+    authority.host = state->addr.address;
+    authority.port = state->addr.port;
     auto event_id = state->event_id;
-    if (auto sock = caf::net::make_connected_tcp_stream_socket(authority, 1s)) {
+    if (sock) {
       BROKER_DEBUG("established connection to" << authority
                                                << "(initiate handshake)"
                                                << BROKER_ARG2("fd", sock->id));
@@ -1068,6 +1346,7 @@ struct connect_manager {
                 (int) sock->id, __LINE__, err_str.c_str());
         ::abort();
       }
+      apply_socket_options(*sock, sock_opts);
       if (auto i = pending.find(sock->id); i != pending.end()) {
         BROKER_WARNING("socket" << sock->id
                                 << "already associated to state object -> "
@@ -1077,8 +1356,11 @@ struct connect_manager {
       short mask = 0;
       if (ssl_ctx) {
         mask = write_mask; // SSL wants to write first.
+        auto policy = caf::net::openssl::policy::make(ssl_ctx, *sock);
+        if (auto i = ssl_sessions.find(state->addr); i != ssl_sessions.end())
+          SSL_set_session(policy.conn(), i->second.get());
         state->reset(connect_state::socket_state::connecting,
-                     caf::net::openssl::policy::make(ssl_ctx, *sock));
+                     std::move(policy));
       } else {
         mask = read_mask;
         state->reset(connect_state::socket_state::running,
@@ -1089,13 +1371,11 @@ struct connect_manager {
       state->transition(&connect_state::await_hello_or_version_select);
       state->send(wire_format::make_hello_msg(this_peer));
     } else {
-      auto retry_interval = state->addr.retry;
-      if (retry_interval.count() != 0) {
+      if (state->addr.retry.count() != 0) {
+        listener->on_peer_unavailable(state->addr);
+        auto retry_interval = schedule_retry(std::move(state));
         BROKER_DEBUG("failed to connect to" << authority << "-> retry in"
                                             << retry_interval);
-        listener->on_peer_unavailable(state->addr);
-        retry_schedule.emplace(caf::make_timestamp() + retry_interval,
-                               std::move(state));
       } else if (valid(event_id)) {
         BROKER_DEBUG("failed to connect to" << authority
                                             << "-> fail (retry disabled)");
@@ -1148,9 +1428,29 @@ struct connect_manager {
     // nop
   }
 
+  /// Stores the TLS session of an outgoing connection for resuming it later.
+  void store_ssl_session(connect_state& state) {
+    if (state.addr.address.empty()) // Incoming connection.
+      return;
+    auto pol = std::get_if<caf::net::openssl::policy>(&state.sck_policy);
+    if (!pol)
+      return;
+    // Note: TLS 1.3 sends session tickets after the handshake. Since we only
+    // get here after exchanging the Broker handshake, OpenSSL has already
+    // processed the tickets.
+    if (ssl_session_ptr session{SSL_get1_session(pol->conn())}) {
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+      if (!SSL_SESSION_is_resumable(session.get()))
+        return;
+#endif
+      ssl_sessions[state.addr] = std::move(session);
+    }
+  }
+
   void finalize(pollfd& entry, connect_state& state) {
     BROKER_TRACE(BROKER_ARG2("fd", entry.fd));
     if (!state.redundant) {
+      store_ssl_session(state);
       auto conn = state.make_pending_connection(stream_socket{entry.fd});
       listener->on_connection(state.event_id, state.remote_id, state.addr,
                               state.remote_filter, std::move(conn));
@@ -1205,6 +1505,15 @@ struct connect_manager {
       auto accept_sock = caf::net::tcp_accept_socket{entry.fd};
       if (auto sock = caf::net::accept(accept_sock)) {
         BROKER_ASSERT(pending.count(sock->id) == 0);
+        // Admission control: close the connection right away when running too
+        // many handshakes. The remote peer retries later.
+        if (max_pending_handshakes > 0
+            && num_pending_incoming() >= max_pending_handshakes) {
+          BROKER_INFO("too many pending handshakes -> close new connection"
+                      << BROKER_ARG2("fd", sock->id));
+          caf::net::close(*sock);
+          return;
+        }
         if (auto err = caf::net::nonblocking(*sock, true)) {
           auto err_str = to_string(err);
           fprintf(stderr,
@@ -1219,7 +1528,9 @@ struct connect_manager {
                   (int) sock->id, __LINE__, err_str.c_str());
           ::abort();
         }
+        apply_socket_options(*sock, sock_opts);
         auto st = make_connect_state(this);
+        st->incoming = true;
         st->addr.retry = 0s;
         if (auto addr = caf::net::remote_addr(*sock))
           st->addr.address = std::move(*addr);
@@ -1290,11 +1601,9 @@ struct connect_manager {
           listener->on_redundant_connection(state->event_id, state->remote_id,
                                             state->addr);
       } else if (state->event_id != invalid_connector_event_id) {
-        auto retry_interval = state->addr.retry;
-        if (retry_interval.count() > 0) {
+        if (state->addr.retry.count() > 0) {
           listener->on_peer_unavailable(state->addr);
-          retry_schedule.emplace(caf::make_timestamp() + retry_interval,
-                                 std::move(state));
+          auto retry_interval = schedule_retry(std::move(state));
           BROKER_DEBUG("failed to connect on socket"
                        << entry.fd << "-> try again in" << retry_interval);
         } else {
@@ -1429,17 +1738,37 @@ read_result connect_state::do_transport_handshake_rd(stream_socket fd) {
   }
 }
 
-template <class T>
-void connect_state::send(const T& what) {
+template <class Encode>
+uint32_t connect_state::write_frame(Encode encode) {
   bin_v1::encoder sink{std::back_inserter(wr_buf)};
   // Store the current writing position for later and add dummy size.
   auto old_size = wr_buf.size();
   uint32_t dummy = 0;
   std::ignore = sink.apply(dummy);
   // Encode the actual message and override the dummy with the actual size.
-  std::ignore = wire_format::encode(sink, what);
+  std::ignore = encode(sink);
   auto len = static_cast<uint32_t>(wr_buf.size() - old_size - 4);
   bin_v1::encode(len, wr_buf.begin() + static_cast<ptrdiff_t>(old_size));
+  return len;
+}
+
+template <class T>
+void connect_state::send(const T& what) {
+  auto len = write_frame(
+    [&what](auto& sink) { return wire_format::encode(sink, what); });
+  BROKER_DEBUG("start writing a" << T::tag << "message of size" << len);
+  mgr->register_writing(this);
+}
+
+template <class T>
+void connect_state::send_local_filter() {
+  // The binary format encodes an object with a single field just like the
+  // field itself. Hence, the tag followed by the filter is a valid T.
+  auto snapshot = local_filter();
+  auto len = write_frame([&snapshot](auto& sink) {
+    auto tag = T::tag;
+    return sink.apply(tag) && sink.apply(snapshot->filter);
+  });
   BROKER_DEBUG("start writing a" << T::tag << "message of size" << len);
   mgr->register_writing(this);
 }
@@ -1610,7 +1939,7 @@ bool connect_state::await_hello(wire_format::var_msg& msg) {
   } else if (mgr->this_peer < hello.sender_id) {
     if (proceed_with_handshake(hello.sender_id, true)) {
       send(wire_format::make_version_select_msg(this_peer()));
-      send(wire_format::v1::make_originator_syn_msg(local_filter()));
+      send_local_filter<wire_format::v1::originator_syn_msg>();
       transition(&connect_state::await_resp_syn_ack);
       return true;
     } else {
@@ -1659,7 +1988,7 @@ bool connect_state::await_orig_syn(wire_format::var_msg& msg) {
   }
   auto& syn = std::get<wire_format::v1::originator_syn_msg>(msg);
   remote_filter = std::move(syn.filter);
-  send(wire_format::v1::make_responder_syn_ack_msg(local_filter()));
+  send_local_filter<wire_format::v1::responder_syn_ack_msg>();
   transition(&connect_state::await_orig_ack);
   return true;
 }
@@ -1709,8 +2038,8 @@ bool connect_state::await_orig_ack(wire_format::var_msg& msg) {
   return true;
 }
 
-filter_type connect_state::local_filter() {
-  return mgr->filter->read();
+shared_filter_type::snapshot_ptr connect_state::local_filter() {
+  return mgr->filter->load();
 }
 
 endpoint_id connect_state::this_peer() {
@@ -1892,10 +2221,19 @@ void connector::run_impl(listener* sub, shared_filter_type* filter) {
   // performance-critical system component. It only establishes connections and
   // reads handshake messages, so poll() is 'good enough' and we use it since
   // it's portable.
-  connect_manager mgr{this_peer_, sub, filter, peer_statuses_.get(),
-                      ssl_context_from_cfg(ssl_cfg_)};
+  connect_manager mgr{this_peer_,
+                      sub,
+                      filter,
+                      peer_statuses_.get(),
+                      ssl_context_from_cfg(ssl_cfg_),
+                      broker_cfg_};
   auto& fdset = mgr.fdset;
   fdset.push_back({pipe_rd_, read_mask, 0});
+  auto dial_fd = detail::invalid_native_socket;
+  if (mgr.dial) {
+    dial_fd = mgr.dial->wake_fd();
+    fdset.push_back({dial_fd, read_mask, 0});
+  }
   bool done = false;
   pipe_reader prd{caf::net::pipe_socket{pipe_rd_}, &done};
   // Loop until we receive a shutdown via the pipe.
@@ -1935,6 +2273,12 @@ void connector::run_impl(listener* sub, shared_filter_type* filter) {
           } else if (i->revents & error_mask) {
             throw broken_pipe{i->revents};
           }
+        } else if (i->fd == dial_fd) {
+          if (i->revents & read_mask) {
+            mgr.handle_dial_results();
+          } else if (i->revents & error_mask) {
+            throw broken_pipe{i->revents};
+          }
         } else {
           if (i->revents & read_mask) {
             mgr.continue_reading(*i);
@@ -3,6 +3,7 @@
 #include <caf/actor.hpp>
 #include <caf/actor_cast.hpp>
 #include <caf/allowed_unsafe_message_type.hpp>
+#include <caf/async/spsc_buffer.hpp>
 #include <caf/behavior.hpp>
 #include <caf/binary_deserializer.hpp>
 #include <caf/error.hpp>
@@ -22,13 +23,20 @@
 
 #include "broker/detail/assert.hh"
 #include "broker/detail/make_backend.hh"
+#include "broker/detail/monotonic_buffer_resource.hh"
 #include "broker/detail/prefix_matcher.hh"
+#include "broker/detail/thread_affinity.hh"
+#include "broker/detail/topic_matcher.hh"
 #include "broker/domain_options.hh"
 #include "broker/filter_type.hh"
 #include "broker/format/bin.hh"
+#include "broker/internal/async_backend.hh"
 #include "broker/internal/clone_actor.hh"
+#include "broker/internal/dispatcher_actor.hh"
+#include "broker/internal/instrumented_backend.hh"
 #include "broker/internal/killswitch.hh"
 #include "broker/internal/master_actor.hh"
+#include "broker/internal/tracer.hh"
 
 using namespace std::literals;
 
@@ -122,6 +130,11 @@ core_actor_state::metrics_t::metrics_t(caf::actor_system& sys) {
   auto [native, ws] = factory.core.connections_instances();
   native_connections = native;
   web_socket_connections = ws;
+  dropped_messages = factory.core.dropped_messages_instance();
+  peer_messages = factory.core.peer_messages_family();
+  peer_bytes = factory.core.peer_bytes_family();
+  peer_rtt = factory.core.peer_rtt_family();
+  flow_stages = factory.core.flow_stage_instances();
   // Initialize message metrics, indexes are according to packed_message_type.
   auto proc = factory.core.processed_messages_instances();
   auto buf = factory.core.buffered_messages_instances();
@@ -137,16 +150,147 @@ core_actor_state::core_actor_state(caf::event_based_actor* self,
                                    filter_type initial_filter,
                                    endpoint::clock* clock,
                                    const domain_options* adaptation,
-                                   connector_ptr conn)
+                                   connector_ptr conn,
+                                   publish_credit_ptr credit,
+                                   topic_log_ptr log)
   : self(self),
     id(this_peer),
     filter(std::make_shared<shared_filter_type>(std::move(initial_filter))),
     clock(clock),
     metrics(self->system()),
     unsafe_inputs(self),
-    flow_inputs(self) {
+    flow_inputs(self),
+    retention_log(std::move(log)),
+    async_credit(std::move(credit)) {
   // Read config and check for extra configuration parameters.
   ttl = caf::get_or(self->config(), "broker.ttl", defaults::ttl);
+  if (auto n = caf::get_or(self->config(), "broker.duplicate-cache-size",
+                           defaults::duplicate_cache_size);
+      n > 0)
+    duplicates = std::make_unique<detail::duplicate_filter>(n);
+  batch_metrics = caf::get_or(self->config(), "broker.batch-core-metrics",
+                              defaults::batch_core_metrics);
+  routing_update_deltas = caf::get_or(self->config(),
+                                      "broker.routing-update-deltas",
+                                      defaults::routing_update_deltas);
+  routing_update_interval = caf::get_or(self->config(),
+                                        "broker.routing-update-interval",
+                                        defaults::routing_update_interval);
+  peer_buffer_size = caf::get_or(self->config(), "broker.peer-buffer-size",
+                                 defaults::peer_buffer_size);
+  if (auto str = caf::get_or(self->config(), "broker.peer-overflow-policy",
+                             caf::string_view{defaults::peer_overflow_policy});
+      !from_string(str, peer_overflow_policy)) {
+    BROKER_ERROR("invalid value for broker.peer-overflow-policy:"
+                 << str << "-> fall back to 'disconnect'");
+    peer_overflow_policy = overflow_policy::disconnect;
+  }
+  {
+    metric_factory factory{self->system()};
+    auto budget = caf::get_or(self->config(), "broker.memory-budget",
+                              defaults::memory_budget);
+    memory = std::make_shared<memory_accountant>(
+      budget, factory.core.buffered_bytes_instance(),
+      factory.core.shed_messages_instance());
+    // The pool is process-wide, so we never turn it off again.
+    if (auto bytes = caf::get_or(self->config(), "broker.huge-page-pool",
+                                 defaults::huge_page_pool);
+        bytes > 0)
+      detail::monotonic_buffer_resource::huge_page_pool(bytes);
+    auto specs = caf::get_or(self->config(), "broker.qos.classes",
+                             std::vector<std::string>{});
+    std::vector<qos_class> classes;
+    for (const auto& spec : specs) {
+      qos_class cls;
+      if (qos_class::parse(spec, cls))
+        classes.emplace_back(std::move(cls));
+      else
+        BROKER_ERROR("invalid value in broker.qos.classes:" << spec);
+    }
+    if (!classes.empty()) {
+      qos = std::make_shared<qos_table>(
+        std::move(classes), factory.core.qos_dropped_messages_family());
+      memory->qos(qos);
+    }
+    expired_messages = factory.core.expired_messages_instance();
+    auto ages = caf::get_or(self->config(), "broker.max-age",
+                            std::vector<std::string>{});
+    std::vector<max_age_rule> rules;
+    for (const auto& spec : ages) {
+      max_age_rule rule;
+      if (max_age_rule::parse(spec, rule))
+        rules.emplace_back(std::move(rule));
+      else
+        BROKER_ERROR("invalid value in broker.max-age:" << spec);
+    }
+    if (!rules.empty())
+      max_age = std::make_shared<max_age_table>(std::move(rules));
+  }
+  subscriber_wakeup_batch = caf::get_or(self->config(),
+                                        "broker.subscriber.wakeup-batch",
+                                        defaults::subscriber::wakeup_batch);
+  subscriber_wakeup_delay = caf::get_or(self->config(),
+                                        "broker.subscriber.wakeup-delay",
+                                        defaults::subscriber::wakeup_delay);
+  peer_priority_window = caf::get_or(self->config(),
+                                     "broker.peer-priority-window",
+                                     defaults::peer_priority_window);
+  peer_probe_interval = caf::get_or(self->config(),
+                                    "broker.peer-probe-interval",
+                                    defaults::peer_probe_interval);
+  if (auto n = caf::get_or(self->config(), "broker.auto-batch.max-size",
+                           defaults::auto_batch::max_size);
+      n > 0) {
+    auto linger = caf::get_or(self->config(), "broker.auto-batch.linger",
+                              defaults::auto_batch::linger);
+    batcher = std::make_unique<auto_batcher>(n, linger);
+  }
+  if (auto dir = caf::get_or(self->config(), "broker.flight-recorder.directory",
+                             caf::string_view{
+                               defaults::flight_recorder::directory});
+      !dir.empty()) {
+    namespace fr = defaults::flight_recorder;
+    const auto& cfg = self->config();
+    recorder = std::make_unique<flight_recorder>(
+      std::move(dir),
+      caf::get_or(cfg, "broker.flight-recorder.queue-size", fr::queue_size),
+      caf::get_or(cfg, "broker.flight-recorder.max-file-size",
+                  fr::max_file_size),
+      caf::get_or(cfg, "broker.flight-recorder.max-files", fr::max_files));
+    if (!recorder->start()) {
+      BROKER_WARNING("failed to start the flight recorder in"
+                     << recorder->directory());
+      recorder = nullptr;
+    }
+  }
+  latency_sample_rate = caf::get_or(self->config(),
+                                    "broker.metrics.latency-sample-rate",
+                                    defaults::metrics::latency_sample_rate);
+  if (latency_sample_rate > 0) {
+    metric_factory factory{self->system()};
+    metrics.message_latency = factory.core.message_latency_instances();
+  }
+  if (auto depth = caf::get_or(self->config(), "broker.metrics.topic-depth",
+                               defaults::metrics::topic_depth);
+      depth > 0) {
+    auto max_prefixes = caf::get_or(self->config(),
+                                    "broker.metrics.max-topic-prefixes",
+                                    defaults::metrics::max_topic_prefixes);
+    metric_factory factory{self->system()};
+    topic_stats = std::make_unique<topic_traffic>(
+      depth, max_prefixes, factory.core.topic_messages_family(),
+      factory.core.topic_bytes_family());
+  }
+  if (caf::get_or(self->config(), "broker.tracing.enabled",
+                  defaults::tracing::enabled)) {
+#ifdef BROKER_ENABLE_TRACING
+    tracer::enable(caf::get_or(self->config(), "broker.tracing.buffer-size",
+                               defaults::tracing::buffer_size));
+#else
+    BROKER_WARNING("broker.tracing.enabled has no effect: Broker was built "
+                   "without tracing support");
+#endif
+  }
   if (adaptation && adaptation->disable_forwarding) {
     BROKER_INFO("disable forwarding on this peer");
     disable_forwarding = true;
@@ -172,21 +316,77 @@ core_actor_state::core_actor_state(caf::event_based_actor* self,
 
 core_actor_state::~core_actor_state() {
   BROKER_DEBUG("core_actor_state destroyed");
+  // Unblock publishers that wait for credit we can no longer return.
+  if (async_credit)
+    async_credit->close();
 }
 
 // -- initialization and tear down ---------------------------------------------
 
 caf::behavior core_actor_state::make_behavior() {
-  // Create the central "bus" where everything flows through.
-  central_merge = flow_inputs.as_observable().merge().share();
+  // The core runs on its own thread unless running in the deterministic test
+  // setup. Hence, we only pin the current thread outside of tests.
+  if (auto cpus = caf::get_as<std::vector<size_t>>(self->config(),
+                                                   "broker.affinity.core");
+      cpus
+      && caf::get_or(self->config(), "caf.scheduler.policy", "") != "testing") {
+    if (!detail::set_thread_affinity(*cpus))
+      BROKER_WARNING("failed to pin the core actor to the configured CPUs");
+  }
+  // Create the central "bus" where everything flows through. We compute the
+  // routing decision for each message at this point once, so that the flows
+  // for the peers only need to check their slot in the destination mask.
+  central_merge_stats->demand_gauge = metrics.flow_stages.central_merge.demand;
+  central_merge_stats->stalled_counter = metrics.flow_stages.central_merge
+                                           .stalled;
+  central_merge = flow_inputs.as_observable()
+                    .merge()
+                    .filter([this](const node_message& msg) {
+                      // Start the clock for topics with a maximum age and
+                      // drop messages that went stale before reaching us.
+                      if (max_age)
+                        max_age->apply(msg);
+                      if (msg->expired()) {
+                        expired_messages->inc();
+                        return false;
+                      }
+                      // Enforce the rate limits of the QoS classes.
+                      return !qos
+                             || qos->admit(msg, qos_table::clock_type::now());
+                    })
+                    .compose(add_flow_scope_t{central_merge_stats})
+                    .map([this](const node_message& msg) { //
+                      observe_latency(metrics.message_latency.merge, *msg);
+                      BROKER_TRACE_EVENT(merge, msg.get(), get_sender(msg));
+                      return route(msg);
+                    })
+                    .share();
   // Process control messages and add instrumentation for metrics.
   central_merge //
-    .for_each([this](const node_message& msg) {
+    .for_each([this](const routed_message& item) {
+      const auto& msg = item.msg;
       auto sender = get_sender(msg);
       // Update metrics.
-      auto& metrics = metrics_for(get_type(msg));
-      metrics.processed->inc();
-      metrics.buffered->dec();
+      count_processed(get_type(msg));
+      // Hand data and command messages to the flight recorder. This only
+      // copies the envelope pointer. The recorder writes in the background.
+      if (recorder)
+        recorder->try_record(msg);
+      // Append data messages to the topic log. This copies the serialized
+      // envelope into a memory-mapped segment.
+      if (retention_log)
+        retention_log->append(msg);
+      if (topic_stats) {
+        switch (get_type(msg)) {
+          case packed_message_type::data:
+          case packed_message_type::command:
+            topic_stats->count(msg->topic(), msg->topic().size()
+                                               + msg->raw_bytes().second);
+            break;
+          default:
+            break;
+        }
+      }
       // Ignore our own outputs.
       if (is_local(msg))
         return;
@@ -195,16 +395,7 @@ caf::behavior core_actor_state::make_behavior() {
         default:
           break;
         case packed_message_type::routing_update:
-          // Deserialize payload and update peer filter.
-          if (auto i = peers.find(sender); i != peers.end()) {
-            filter_type new_filter;
-            for (auto new_topic : *msg->as_routing_update()) {
-              new_filter.emplace_back(std::string{new_topic});
-            }
-            BROKER_DEBUG(sender << "changed its filter to" << new_filter);
-            i->second->filter(std::move(new_filter));
-          }
-          // else: ignore. Probably a stale message after unpeering.
+          handle_routing_update(sender, msg->as_routing_update());
           break;
         case packed_message_type::ping: {
           // Respond to PING messages with a PONG that has the same payload.
@@ -213,6 +404,9 @@ caf::behavior core_actor_state::make_behavior() {
           dispatch(make_pong_message(msg->as_ping()));
           break;
         }
+        case packed_message_type::pong:
+          handle_probe_response(sender, msg);
+          break;
       }
     });
   // Initialize data_outputs and command_outputs.
@@ -220,35 +414,46 @@ caf::behavior core_actor_state::make_behavior() {
     central_merge
       // Drop everything but data messages and only process messages that are
       // not meant for another peer.
-      .filter([this](const node_message& msg) {
-        // Note: local subscribers do not receive messages from local
-        // publishers. Except when the message explicitly says otherwise by
-        // setting receiver == id. This is the case for messages that were
-        // published via `(atom::publish, atom::local, ...)` message.
-        auto receiver = get_receiver(msg);
-        return get_type(msg) == packed_message_type::data
-               && (!is_local(msg) || receiver == id)
-               && (!receiver || receiver == id);
+      .filter([this](const routed_message& item) {
+        return is_for_local_subscribers(item.msg);
       })
       // Convert to data_message.
-      .map([this](const node_message& msg) { return msg->as_data(); })
+      .map([this](const routed_message& item) {
+        observe_latency(metrics.message_latency.delivery, *item.msg);
+        BROKER_TRACE_EVENT(delivery, item.msg.get(), endpoint_id{});
+        return item.msg->as_data();
+      })
       // Convert this blueprint to a *hot* observable.
       .share();
   command_outputs =
     central_merge
       // Drop everything but command messages and only process messages that
       // are not meant for another peer.
-      .filter([this](const node_message& msg) {
-        auto receiver = get_receiver(msg);
-        return get_type(msg) == packed_message_type::command
+      .filter([this](const routed_message& item) {
+        auto receiver = get_receiver(item.msg);
+        return get_type(item.msg) == packed_message_type::command
                && (!receiver || receiver == id);
       })
       // Deserialize payload and wrap it into an actual command message.
-      .map([this](const node_message& msg) { return msg->as_command(); })
+      .map([](const routed_message& item) { return item.msg->as_command(); })
       // Convert this blueprint to a *hot* observable.
       .share();
+  // Spawn dispatchers for local subscribers when running in sharded mode.
+  auto num_dispatchers = caf::get_or(self->config(), "broker.core-dispatchers",
+                                     defaults::core_dispatchers);
+  for (size_t index = 0; index < num_dispatchers; ++index) {
+    auto [con, prod] = caf::async::make_spsc_buffer_resource<data_message>();
+    data_outputs.subscribe(std::move(prod));
+    auto hdl = self->system().spawn<dispatcher_actor>(std::move(con));
+    self->link_to(hdl);
+    dispatchers.emplace_back(std::move(hdl));
+  }
   // Connect the unsafe inputs to the central merge point.
   flow_inputs.push(unsafe_inputs.as_observable());
+  // Start measuring the round-trip time to our peers if configured.
+  if (peer_probe_interval.count() > 0)
+    probe_timer = self->run_delayed(peer_probe_interval,
+                                    [this] { send_latency_probes(); });
   // Override the default exit handler to add logging.
   self->set_exit_handler([this](caf::exit_msg& msg) {
     if (msg.reason) {
@@ -327,23 +532,75 @@ caf::behavior core_actor_state::make_behavior() {
       return result;
     },
     [this](atom::get_filter) { return filter->read(); },
+    [this](atom::get, atom::subscriptions, const topic& what) {
+      auto rp = self->make_response_promise();
+      auto found = local_subscriptions.has_match(what.string());
+      if (found || dispatchers.empty()) {
+        rp.deliver(found);
+        return rp;
+      }
+      // Dispatchers manage their subscribers on their own. Hence, we need to
+      // ask each of them. The core forwards subscriptions to the dispatchers
+      // in order, so the answers include all previous subscriptions.
+      auto pending = std::make_shared<size_t>(dispatchers.size());
+      for (auto& hdl : dispatchers) {
+        auto on_result = [rp, pending](bool hit) mutable {
+          --*pending;
+          if (rp.pending() && (hit || *pending == 0))
+            rp.deliver(hit);
+        };
+        self
+          ->request(hdl, caf::infinite, atom::get_v, atom::subscriptions_v,
+                    what)
+          .then(on_result, [on_result](const caf::error&) mutable {
+            on_result(false);
+          });
+      }
+      return rp;
+    },
     // -- publishing of messages without going through a publisher -------------
     [this](atom::publish, const data_message& msg) {
       ++published_via_async_msg;
-      dispatch(msg);
+      return_credit();
+      publish_local(msg);
     },
     [this](atom::publish, const data_message& msg, const endpoint_info& dst) {
       ++published_via_async_msg;
+      return_credit();
       dispatch(msg->with(id, dst.node));
     },
     [this](atom::publish, const data_message& msg, endpoint_id dst) {
       ++published_via_async_msg;
+      return_credit();
       dispatch(msg->with(id, dst));
     },
     [this](atom::publish, atom::local, const data_message& msg) {
       ++published_via_async_msg;
       dispatch(msg->with(id, id));
     },
+    [this](atom::publish, const encoded_batch_ptr& batch) {
+      // The endpoint checked the framing already, but the payloads may still
+      // be malformed. Hence, we drop individual messages that fail to parse.
+      return_credit();
+      auto first = batch->data();
+      auto last = first + batch->size();
+      format::bin::v1::decode_records(
+        first, last,
+        [this](std::string_view topic_str, const std::byte* payload,
+               size_t payload_size) {
+          auto msg = data_envelope::deserialize(endpoint_id::nil(),
+                                                endpoint_id::nil(),
+                                                defaults::ttl, topic_str,
+                                                payload, payload_size);
+          if (!msg) {
+            BROKER_WARNING("drop malformed message from a batch:"
+                           << msg.error());
+            return;
+          }
+          ++published_via_async_msg;
+          dispatch(*msg);
+        });
+    },
     [this](atom::publish, const command_message& msg) { //
       dispatch(msg);
     },
@@ -363,13 +620,12 @@ caf::behavior core_actor_state::make_behavior() {
     },
     [this](filter_type& filter, data_producer_res snk) {
       subscribe(filter);
-      data_outputs
-        .filter([xs = std::move(filter)](const data_message& msg) {
-          detail::prefix_matcher f;
-          return f(xs, msg);
-        })
-        .compose(local_subscriber_scope_adder())
-        .subscribe(std::move(snk));
+      if (!dispatchers.empty()) {
+        auto& hdl = dispatchers[next_dispatcher++ % dispatchers.size()];
+        self->send(hdl, std::move(filter), std::move(snk));
+        return;
+      }
+      add_local_subscriber(local_subscriptions.add(filter), std::move(snk));
     },
     [this](std::shared_ptr<filter_type> fptr, data_producer_res snk) {
       // Here, we accept a shared_ptr to the filter instead of an actual object.
@@ -377,17 +633,37 @@ caf::behavior core_actor_state::make_behavior() {
       // an update message. The filter itself is not thread-safe. Hence, the
       // publishers should never write to it directly.
       subscribe(*fptr);
-      data_outputs
-        .filter([fptr = std::move(fptr)](const data_message& msg) {
-          detail::prefix_matcher f;
-          return f(*fptr, msg);
-        })
-        .compose(local_subscriber_scope_adder())
-        .subscribe(std::move(snk));
+      if (!dispatchers.empty()) {
+        self->send(dispatcher_for(*fptr), std::move(fptr), std::move(snk));
+        return;
+      }
+      auto hdl = local_subscriptions.add(*fptr);
+      local_subscription_handles.emplace(fptr.get(), hdl);
+      add_local_subscriber(hdl, std::move(snk));
+    },
+    [this](atom::update, std::shared_ptr<filter_type> fptr,
+           data_producer_res snk) {
+      // A subscriber resizes its queue by handing us a new buffer.
+      if (!dispatchers.empty()) {
+        self->send(dispatcher_for(*fptr), atom::update_v, std::move(fptr),
+                   std::move(snk));
+        return;
+      }
+      if (auto i = local_subscription_handles.find(fptr.get());
+          i != local_subscription_handles.end())
+        add_local_subscriber(i->second, std::move(snk));
     },
     [this](std::shared_ptr<filter_type>& fptr, topic& x, bool add,
            std::shared_ptr<std::promise<void>>& sync) {
       // We assume that fptr belongs to a previously constructed flow.
+      if (!dispatchers.empty()) {
+        // The dispatcher owns the filter. We only update our own filter.
+        if (add)
+          subscribe(filter_type{x});
+        auto& hdl = dispatcher_for(*fptr);
+        self->send(hdl, std::move(fptr), std::move(x), add, std::move(sync));
+        return;
+      }
       auto e = fptr->end();
       auto i = std::find(fptr->begin(), e, x);
       if (add) {
@@ -399,6 +675,9 @@ caf::behavior core_actor_state::make_behavior() {
         if (i != e)
           fptr->erase(i);
       }
+      if (auto j = local_subscription_handles.find(fptr.get());
+          j != local_subscription_handles.end())
+        local_subscriptions.update(j->second, *fptr);
       if (sync)
         sync->set_value();
     },
@@ -408,10 +687,22 @@ caf::behavior core_actor_state::make_behavior() {
         self
           ->make_observable() //
           .from_resource(std::move(src))
+          .filter([this](const data_message& msg) {
+            // Batches bypass the flow and go through `dispatch` instead.
+            if (!batcher)
+              return true;
+            publish_local(msg);
+            return false;
+          })
           .do_on_next([this](const data_message&) {
-            metrics_for(packed_message_type::data).buffered->inc();
+            count_buffered(packed_message_type::data);
+          })
+          .map([this](const data_message& msg) {
+            auto result = node_message{msg};
+            sample_latency(result);
+            BROKER_TRACE_EVENT(publish, result.get(), endpoint_id{});
+            return result;
           })
-          .map([this](const data_message& msg) { return node_message{msg}; })
           .compose(local_publisher_scope_adder())
           .compose(add_killswitch_t{});
       flow_inputs.push(in);
@@ -426,6 +717,12 @@ caf::behavior core_actor_state::make_behavior() {
       return attach_clone(name, resync_interval, stale_interval,
                           mutation_buffer_interval);
     },
+    [this](atom::data_store, atom::clone, atom::attach, const std::string& name,
+           double resync_interval, double stale_interval,
+           double mutation_buffer_interval, std::string& key_prefix) {
+      return attach_clone(name, resync_interval, stale_interval,
+                          mutation_buffer_interval, std::move(key_prefix));
+    },
     [this](atom::data_store, atom::master, atom::attach,
            const std::string& name, backend backend_type,
            backend_options opts) {
@@ -466,8 +763,7 @@ caf::behavior core_actor_state::make_behavior() {
       auto hdl = caf::actor_cast<caf::actor>(sender_ptr);
       auto sub = data_outputs
                    .filter([fptr](const data_message& item) {
-                     detail::prefix_matcher f;
-                     return f(*fptr, item);
+                     return detail::topic_matcher::matches(*fptr, item);
                    })
                    .compose(local_subscriber_scope_adder())
                    .for_each([this, hdl](const data_message& msg) {
@@ -520,6 +816,21 @@ void core_actor_state::shutdown(shutdown_options options) {
   shutdown_stores();
   // We no longer add new input flows.
   flow_inputs.close();
+  // Stop measuring round-trip times.
+  probe_timer.dispose();
+  // Send all pending batches.
+  if (batcher) {
+    batch_timer.dispose();
+    std::vector<data_message> ready;
+    batcher->flush_all(ready);
+    for (auto& msg : ready)
+      dispatch(msg);
+  }
+  // Tell our peers about subscription changes that are still pending.
+  if (pending_routing_update) {
+    routing_update_timer.dispose();
+    flush_routing_update();
+  }
   // Cancel all subscriptions to local publishers.
   for (auto& sub : subscriptions)
     sub.dispose();
@@ -553,9 +864,52 @@ void core_actor_state::shutdown(shutdown_options options) {
     finalize_shutdown();
     return;
   }
+  // When draining, we send the BYE only after all buffered messages passed the
+  // central merge point. The BYE then queues up behind the data.
+  if (options.contains(shutdown_options::drain_peers_on_shutdown)) {
+    auto timeout = options.drain_timeout();
+    shutting_down_timeout =
+      self->run_delayed(timeout + defaults::unpeer_timeout,
+                        [this] { finalize_shutdown(); });
+    remove_peers_after_drain(caf::make_timestamp() + timeout);
+    return;
+  }
+  remove_peers_for_shutdown(defaults::unpeer_timeout);
+}
+
+bool core_actor_state::has_buffered_messages() const {
+  for (size_t msg_type = 1; msg_type < 6; ++msg_type) {
+    auto& msg_metrics = metrics.message_metric_sets[msg_type];
+    if (msg_metrics.buffered->value() + msg_metrics.pending_buffered > 0)
+      return true;
+  }
+  for (auto& kvp : peers)
+    if (kvp.second->overflow_stats()->buffered > 0)
+      return true;
+  return false;
+}
+
+void core_actor_state::remove_peers_after_drain(caf::timestamp deadline) {
+  if (peers.empty())
+    return;
+  auto now = caf::make_timestamp();
+  if (now < deadline && has_buffered_messages()) {
+    self->run_delayed(defaults::drain_poll_interval, [this, deadline] {
+      remove_peers_after_drain(deadline);
+    });
+    return;
+  }
+  if (now >= deadline)
+    BROKER_DEBUG("drain timeout reached, unpeer with buffered messages");
+  // Replace the timeout from shutdown() with the regular unpeer timeout.
+  shutting_down_timeout.dispose();
+  remove_peers_for_shutdown(defaults::unpeer_timeout);
+}
+
+void core_actor_state::remove_peers_for_shutdown(timespan timeout) {
   for (auto& kvp : peers)
     kvp.second->remove(self, unsafe_inputs, false);
-  shutting_down_timeout = self->run_delayed(defaults::unpeer_timeout,
+  shutting_down_timeout = self->run_delayed(timeout,
                                             [this] { finalize_shutdown(); });
 }
 
@@ -599,11 +953,104 @@ void core_actor_state::emit(Info&& ep, EnumConstant code, const char* msg) {
   }
 }
 
-bool core_actor_state::has_remote_subscriber(const topic& x) const noexcept {
-  auto is_subscribed = [&x](auto& kvp) {
-    return kvp.second->is_subscribed_to(x);
-  };
-  return std::any_of(peers.begin(), peers.end(), is_subscribed);
+bool core_actor_state::has_remote_subscriber(const topic& x) const {
+  return peer_subscriptions.has_match(x.string());
+}
+
+routed_message core_actor_state::route(const node_message& msg) {
+  routed_message result{msg, {}, {}};
+  // Select local subscribers. They receive messages even when running as a
+  // leaf node.
+  if (!local_subscriptions.empty() && is_for_local_subscribers(msg)) {
+    auto& hdls = local_subscriptions.match_cached(get_topic(msg));
+    for (auto hdl : hdls)
+      result.locals.set(hdl);
+  }
+  // Never forward messages from other peers when running as a leaf node or
+  // after they have exhausted their TTL.
+  if (!is_local(msg) && (disable_forwarding || msg->ttl() <= 1))
+    return result;
+  // Select by sender/receiver fields and subscriptions.
+  if (auto receiver = get_receiver(msg)) {
+    if (auto i = peers.find(receiver); i != peers.end())
+      result.peers.set(i->second->subscription_handle());
+  } else {
+    // The index caches lookups, which skips the tree walk for recurring
+    // topics.
+    for (auto hdl : peer_subscriptions.match_cached(get_topic(msg)))
+      result.peers.set(hdl);
+  }
+  // Never send a message back to the peer we have received it from.
+  if (auto sender = get_sender(msg); sender && sender != id) {
+    if (auto i = peers.find(sender); i != peers.end())
+      result.peers.reset(i->second->subscription_handle());
+  }
+  return result;
+}
+
+bool core_actor_state::is_for_local_subscribers(
+  const node_message& msg) const noexcept {
+  // Note: local subscribers do not receive messages from local publishers.
+  // Except when the message explicitly says otherwise by setting receiver ==
+  // id. This is the case for messages that were published via `(atom::publish,
+  // atom::local, ...)` message.
+  auto receiver = get_receiver(msg);
+  return get_type(msg) == packed_message_type::data
+         && (!is_local(msg) || receiver == id) && (!receiver || receiver == id);
+}
+
+void core_actor_state::add_local_subscriber(
+  detail::subscription_index::handle_type hdl, data_producer_res snk) {
+  // Disposing the previous flow closes the previous buffer. Since we connect
+  // the new buffer in the same step, the subscriber receives each message
+  // exactly once and in order: it only switches to the new buffer after
+  // draining the previous one.
+  auto gen = ++local_subscriber_flows[hdl].generation;
+  if (auto& prev = local_subscriber_flows[hdl].sub) {
+    BROKER_DEBUG("replace the buffer of local subscriber" << hdl);
+    prev.dispose();
+  }
+  // The central merge point already selected the receivers. Hence, each
+  // subscriber only checks a single bit instead of evaluating its filter.
+  auto src =
+    central_merge
+      .filter(
+        [hdl](const routed_message& item) { return item.locals.test(hdl); })
+      .map([this](const routed_message& item) {
+        observe_latency(metrics.message_latency.delivery, *item.msg);
+        BROKER_TRACE_EVENT(delivery, item.msg.get(), endpoint_id{});
+        return item.msg->as_data();
+      })
+      .as_observable();
+  // Wake up the subscriber once for multiple messages if configured.
+  if (subscriber_wakeup_batch > 1 && subscriber_wakeup_delay.count() > 0)
+    src = std::move(src).compose(add_wakeup_coalescer_t{
+      self, subscriber_wakeup_batch, subscriber_wakeup_delay});
+  auto sub =
+    std::move(src)
+      .do_finally([this, hdl, gen] {
+        // Keep the subscription if the subscriber merely replaced its buffer.
+        if (auto j = local_subscriber_flows.find(hdl);
+            j != local_subscriber_flows.end()) {
+          if (j->second.generation != gen)
+            return;
+          local_subscriber_flows.erase(j);
+        }
+        local_subscriptions.erase(hdl);
+        for (auto i = local_subscription_handles.begin();
+             i != local_subscription_handles.end(); ++i) {
+          if (i->second == hdl) {
+            local_subscription_handles.erase(i);
+            break;
+          }
+        }
+      })
+      .compose(local_subscriber_scope_adder())
+      .subscribe(std::move(snk));
+  // Note: the flow may have terminated already if the subscriber is gone.
+  if (auto j = local_subscriber_flows.find(hdl);
+      j != local_subscriber_flows.end() && j->second.generation == gen)
+    j->second.sub = std::move(sub);
 }
 
 std::optional<network_info> core_actor_state::addr_of(endpoint_id id) const {
@@ -625,8 +1072,10 @@ table core_actor_state::message_metrics_snapshot() const {
   for (size_t msg_type = 1; msg_type < 6; ++msg_type) {
     auto& msg_metrics = metrics.message_metric_sets[msg_type];
     table vals;
-    vals.emplace("processed"s, msg_metrics.processed->value());
-    vals.emplace("buffered"s, msg_metrics.buffered->value());
+    vals.emplace("processed"s, msg_metrics.processed->value()
+                                 + msg_metrics.pending_processed);
+    vals.emplace("buffered"s, msg_metrics.buffered->value()
+                                + msg_metrics.pending_buffered);
     auto key = static_cast<packed_message_type>(msg_type);
     result.emplace(to_string(key), std::move(vals));
   }
@@ -639,6 +1088,27 @@ table to_vals(const flow_scope_stats& stats) {
   table vals;
   vals.emplace("requested"s, stats.requested);
   vals.emplace("delivered"s, stats.delivered);
+  vals.emplace("demand"s, stats.demand());
+  vals.emplace("stalled"s, stats.stalled_time());
+  return vals;
+}
+
+table to_vals(const core_actor_state::flow_scope_stats_ptr_map& stats) {
+  table vals;
+  for (auto& [key, ptr] : stats)
+    vals.emplace(key, to_vals(*ptr));
+  return vals;
+}
+
+table to_vals(const peer_traffic_stats& stats) {
+  table vals;
+  for (size_t index = 1; index < stats.messages.size(); ++index) {
+    table entry;
+    entry.emplace("messages"s, stats.messages[index]);
+    entry.emplace("bytes"s, stats.bytes[index]);
+    vals.emplace(to_string(static_cast<packed_message_type>(index)),
+                 std::move(entry));
+  }
   return vals;
 }
 
@@ -650,6 +1120,18 @@ table core_actor_state::peer_stats_snapshot() const {
     table entry;
     entry.emplace("input", to_vals(*state_ptr->input_stats()));
     entry.emplace("output", to_vals(*state_ptr->output_stats()));
+    entry.emplace("dropped", state_ptr->overflow_stats()->dropped);
+    entry.emplace("queued", state_ptr->overflow_stats()->buffered);
+    entry.emplace("queued-bytes", state_ptr->overflow_stats()->bytes);
+    table traffic;
+    traffic.emplace("in", to_vals(*state_ptr->input_traffic()));
+    traffic.emplace("out", to_vals(*state_ptr->output_traffic()));
+    entry.emplace("traffic", std::move(traffic));
+    const auto& latency = state_ptr->latency();
+    if (latency.samples > 0) {
+      entry.emplace("rtt", latency.rtt);
+      entry.emplace("jitter", latency.jitter);
+    }
     result.emplace(to_string(pid), std::move(entry));
   }
   return result;
@@ -669,6 +1151,20 @@ vector core_actor_state::local_publisher_stats_snapshot() const {
   return result;
 }
 
+vector core_actor_state::topic_stats_snapshot() const {
+  if (!topic_stats)
+    return {};
+  return topic_stats->top_snapshot(defaults::metrics::top_topic_prefixes);
+}
+
+table core_actor_state::flow_stats_snapshot() const {
+  table result;
+  result.emplace("central-merge"s, to_vals(*central_merge_stats));
+  result.emplace("client-outputs"s, to_vals(*client_output_stats));
+  result.emplace("store-inputs"s, to_vals(*store_input_stats));
+  return result;
+}
+
 table core_actor_state::status_snapshot() const {
   auto env_or_default = [](const char* env_name,
                            const char* fallback) -> std::string {
@@ -689,7 +1185,28 @@ table core_actor_state::status_snapshot() const {
   add("peerings", peer_stats_snapshot());
   add("local-subscribers", local_subscriber_stats_snapshot());
   add("local-publishers", local_publisher_stats_snapshot());
+  add("flows", flow_stats_snapshot());
+  if (topic_stats)
+    add("topics", topic_stats_snapshot());
+  if (qos)
+    add("qos", qos->snapshot());
   add("published-via-async-msg", published_via_async_msg);
+  table mem;
+  mem.emplace("budget"s, static_cast<count>(memory->budget()));
+  mem.emplace("held"s, static_cast<count>(memory->held()));
+  mem.emplace("shed"s, static_cast<count>(memory->shed()));
+  using detail::monotonic_buffer_resource;
+  auto huge_pages = monotonic_buffer_resource::huge_page_pool_reserved();
+  mem.emplace("huge-pages"s, static_cast<count>(huge_pages));
+  add("memory", std::move(mem));
+  if (async_credit) {
+    auto& x = *async_credit;
+    table credit;
+    credit.emplace("capacity"s, static_cast<count>(x.capacity()));
+    credit.emplace("in-flight"s, static_cast<count>(x.in_flight()));
+    credit.emplace("dropped"s, static_cast<count>(x.dropped()));
+    add("async-publish-credit", std::move(credit));
+  }
   return result;
 }
 
@@ -794,6 +1311,36 @@ void core_actor_state::try_connect(const network_info& addr,
 
 // -- flow management ----------------------------------------------------------
 
+void core_actor_state::instrument_traffic(peering& ptr) {
+  // Indexes are according to packed_message_type.
+  static constexpr std::array<std::string_view, 6> type_names = {
+    "", "data", "command", "routing-update", "ping", "pong",
+  };
+  // Note: the metrics aggregate the traffic of all peers, since metric
+  //       families cannot drop instances after a peer disconnects. The peering
+  //       status still reports the traffic per peer.
+  auto add = [this](peer_traffic_stats& stats, std::string_view dir) {
+    for (size_t index = 1; index < type_names.size(); ++index) {
+      auto name = type_names[index];
+      stats.message_counters[index] = metrics.peer_messages->get_or_add(
+        {{"direction", dir}, {"type", name}});
+      stats.byte_counters[index] = metrics.peer_bytes->get_or_add(
+        {{"direction", dir}, {"type", name}});
+    }
+  };
+  add(*ptr.input_traffic(), "in");
+  add(*ptr.output_traffic(), "out");
+  // Per-peer counters are updated for each message. In batch mode, we only
+  // touch the (atomic) metric instances when flushing the metrics.
+  ptr.input_traffic()->deferred = batch_metrics;
+  ptr.output_traffic()->deferred = batch_metrics;
+  ptr.output_traffic()->sample_ages = metrics.message_latency.peer_write;
+  ptr.output_stats()->demand_gauge = metrics.flow_stages.peer_out.demand;
+  ptr.output_stats()->stalled_counter = metrics.flow_stages.peer_out.stalled;
+  auto pid = to_string(ptr.peer_id());
+  ptr.latency().histogram = metrics.peer_rtt->get_or_add({{"peer", pid}});
+}
+
 caf::error core_actor_state::init_new_peer(endpoint_id peer_id,
                                            const network_info& addr,
                                            const filter_type& filter,
@@ -827,35 +1374,65 @@ caf::error core_actor_state::init_new_peer(endpoint_id peer_id,
   // Hook into the central merge point for forwarding the data to the peer.
   auto filter_ptr = std::make_shared<filter_type>(filter);
   auto ptr = std::make_shared<peering>(addr, filter_ptr, id, peer_id);
+  auto hdl = peer_subscriptions.add(filter);
+  ptr->subscription_handle(hdl);
+  ptr->enable_overflow_buffer(peer_buffer_size, peer_overflow_policy,
+                              metrics.dropped_messages, memory);
+  ptr->enable_priority_lanes(peer_priority_window);
+  instrument_traffic(*ptr);
   auto in = ptr->setup(
     self, std::move(in_res), std::move(out_res),
     central_merge
-      // Select by subscription and sender/receiver fields.
-      .filter([this, pid = peer_id, filter_ptr](const node_message& msg) {
-        if (get_sender(msg) == pid)
-          return false;
-        if (disable_forwarding && !is_local(msg))
-          return false;
-        auto f = detail::prefix_matcher{};
-        auto receiver = get_receiver(msg);
-        return receiver == pid || (!receiver && f(*filter_ptr, get_topic(msg)));
+      // Select by the precomputed routing decision.
+      .filter([hdl](const routed_message& item) { //
+        return item.peers.test(hdl);
       })
       // Override the sender field. This makes sure the sender field always
       // reflects the last hop. Since we only need this information to avoid
       // forwarding loops, "sender" really just means "last hop" in the current
-      // implementation.
-      .map([this](const node_message& msg) {
-        if (get_sender(msg) == id)
-          return msg;
-        return msg->with(id, msg->receiver());
+      // implementation. Forwarded messages also lose one hop of their TTL.
+      .map([this](const routed_message& item) {
+        const auto& msg = item.msg;
+        if (is_local(msg)) {
+          if (get_sender(msg) == id && msg->ttl() == ttl)
+            return msg;
+          return msg->with(id, msg->receiver(), ttl);
+        }
+        return msg->with(id, msg->receiver(),
+                         static_cast<uint16_t>(msg->ttl() - 1));
       })
       .as_observable());
   // Push messages received from the peer into the central merge point.
   flow_inputs.push( //
     in
+      // Drop copies of messages that we have received via another peer. Only
+      // data and commands may travel along redundant paths, all other
+      // messages are addressed to a single peer. Without a second peer, there
+      // is no redundant path to begin with.
+      .filter([this, peer_id](const node_message& msg) {
+        if (!duplicates || peers.size() < 2)
+          return true;
+        switch (get_type(msg)) {
+          case packed_message_type::data:
+          case packed_message_type::command: {
+            auto fp = detail::duplicate_filter::fingerprint(*msg);
+            // Messages with the full TTL come straight from their publisher.
+            // These are never copies, but later copies may refer to them.
+            if (msg->ttl() >= ttl) {
+              duplicates->remember(fp, peer_id);
+              return true;
+            }
+            return duplicates->admit(fp, peer_id);
+          }
+          default:
+            return true;
+        }
+      })
       // Add instrumentation for metrics.
-      .do_on_next([this](const node_message& msg) {
-        metrics_for(get_type(msg)).buffered->inc();
+      .do_on_next([this, peer_id](const node_message& msg) {
+        count_buffered(get_type(msg));
+        sample_latency(msg);
+        BROKER_TRACE_EVENT(peer_in, msg.get(), peer_id);
       })
       // Handle peer disconnect events.
       .do_on_complete([this, peer_id, ptr]() mutable {
@@ -871,6 +1448,9 @@ caf::error core_actor_state::init_new_peer(endpoint_id peer_id,
           // TODO: maybe we should consider this a fatal error?
         }
         // Clean up state our local state.
+        ptr->input_traffic()->sync_counters();
+        ptr->output_traffic()->sync_counters();
+        peer_subscriptions.erase(ptr->subscription_handle());
         peers.erase(peer_id);
         // Trigger a reconnect if we have initiated the peering and did not
         // disconnect this peer as a result of unpeering from it.
@@ -949,18 +1529,21 @@ caf::error core_actor_state::init_new_client(const network_info& addr,
   if (out_res) {
     auto sub = central_merge
                  // Select by subscription.
-                 .filter([this, filt = std::move(filter),
-                          client_id](const node_message& msg) {
+                 .filter([this, f = detail::topic_matcher{filter},
+                          client_id](const routed_message& item) {
+                   const auto& msg = item.msg;
                    if (get_type(msg) != packed_message_type::data
                        || get_sender(msg) == client_id)
                      return false;
-                   detail::prefix_matcher f;
-                   return f(filt, get_topic(msg));
+                   return f(get_topic(msg));
                  })
                  // Deserialize payload and wrap it into a data message.
-                 .map([this](const node_message& msg) { //
-                   return msg->as_data();
+                 .map([](const routed_message& item) { //
+                   return item.msg->as_data();
                  })
+                 .compose(named_scope_adder(client_output_stats,
+                                            to_string(client_id),
+                                            metrics.flow_stages.client_out))
                  // Emit values to the producer resource.
                  .subscribe(std::move(out_res));
     subscriptions.emplace_back(sub);
@@ -975,12 +1558,14 @@ caf::error core_actor_state::init_new_client(const network_info& addr,
                       metrics.web_socket_connections->dec();
                     })
                     .map([this, client_id](const data_message& msg) {
-                      metrics_for(packed_message_type::data).buffered->inc();
+                      count_buffered(packed_message_type::data);
                       node_message result;
                       if (msg->sender() == client_id)
                         result = msg;
                       else
                         result = msg->with(client_id, msg->receiver());
+                      sample_latency(result);
+                      BROKER_TRACE_EVENT(client_in, result.get(), client_id);
                       return result;
                     })
                     // Ignore any errors from the client.
@@ -995,9 +1580,17 @@ caf::error core_actor_state::init_new_client(const network_info& addr,
 
 void core_actor_state::subscribe(const filter_type& what) {
   BROKER_TRACE(BROKER_ARG(what));
-  auto changed = filter->update([this, &what](auto&, auto& xs) {
+  // Peers only support prefix matching. Hence, we subscribe to the literal
+  // prefix of each pattern and leave the actual matching to local subscribers.
+  filter_type prefixes;
+  prefixes.reserve(what.size());
+  for (const auto& x : what)
+    prefixes.emplace_back(
+      std::string{detail::topic_matcher::literal_prefix(x.string())});
+  auto before = filter->load();
+  auto changed = filter->update([this, &prefixes](auto&, auto& xs) {
     auto not_internal = [](const topic& x) { return !is_internal(x); };
-    if (filter_extend(xs, what, not_internal)) {
+    if (filter_extend(xs, prefixes, not_internal)) {
       return true;
     } else {
       return false;
@@ -1006,14 +1599,148 @@ void core_actor_state::subscribe(const filter_type& what) {
   // Note: this member function is the only place we call `update`. Hence, we
   // need not worry about the filter changing again concurrently.
   if (changed) {
-    broadcast_subscriptions();
+    if (routing_update_interval.count() > 0) {
+      // Merge all changes within the window into a single update.
+      if (!pending_routing_update) {
+        pending_routing_update = std::move(before);
+        routing_update_timer = self->run_delayed(
+          routing_update_interval, [this] { flush_routing_update(); });
+      }
+      return;
+    }
+    if (routing_update_deltas)
+      broadcast_subscriptions(*before);
+    else
+      broadcast_subscriptions();
   } else {
     BROKER_DEBUG("already subscribed to topics:" << what);
   }
 }
 
+void core_actor_state::handle_routing_update(
+  endpoint_id sender, const routing_update_envelope_ptr& msg) {
+  auto i = peers.find(sender);
+  if (i == peers.end()) {
+    // Ignore. Probably a stale message after unpeering.
+    return;
+  }
+  auto& peer = *i->second;
+  auto hdl = peer.subscription_handle();
+  // Full filter: deserialize payload and replace the peer filter.
+  if (!msg->is_delta()) {
+    filter_type new_filter;
+    for (auto new_topic : *msg) {
+      new_filter.emplace_back(std::string{new_topic});
+    }
+    BROKER_DEBUG(sender << "changed its filter to" << new_filter);
+    peer_subscriptions.update(hdl, new_filter);
+    peer.filter(std::move(new_filter));
+    peer.filter_version(lamport_timestamp{0});
+    return;
+  }
+  // Note: deserialize() already rejects malformed deltas. Hence, this check
+  // should never fail in practice.
+  auto delta = msg->delta();
+  if (!delta) {
+    BROKER_ERROR("received a malformed routing update from" << sender);
+    return;
+  }
+  if (delta->is_snapshot_request()) {
+    BROKER_DEBUG(sender << "requested a snapshot of our filter");
+    auto snapshot = filter->load();
+    auto reply = filter_delta::make_snapshot(snapshot->version,
+                                             snapshot->filter);
+    dispatch(routing_update_envelope::make(reply)->with(id, sender));
+    return;
+  }
+  if (!delta->is_snapshot() && delta->base != peer.filter_version()) {
+    // We have missed an update (or received the filter without version info
+    // during the handshake). Fall back to a full snapshot.
+    if (!peer.awaits_filter_snapshot()) {
+      BROKER_DEBUG("version gap for the filter of" << sender << "(expected"
+                   << peer.filter_version().value << "got"
+                   << delta->base.value << "): request snapshot");
+      peer.awaits_filter_snapshot(true);
+      auto req = filter_delta::make_snapshot_request();
+      dispatch(routing_update_envelope::make(req)->with(id, sender));
+    }
+    return;
+  }
+  BROKER_DEBUG(sender << "changed its filter to version"
+                      << delta->version.value << "( added:" << delta->added
+                      << "removed:" << delta->removed << ")");
+  peer_subscriptions.update(hdl, *delta);
+  peer.filter(*delta);
+  peer.filter_version(delta->version);
+  if (delta->is_snapshot())
+    peer.awaits_filter_snapshot(false);
+}
+
+// -- latency probes -----------------------------------------------------------
+
+namespace {
+
+// ASCII sequence 'RTT' followed by the 64-bit send time of the probe.
+constexpr size_t probe_token_size = 11;
+
+int64_t probe_clock(caf::scheduled_actor* self) {
+  using std::chrono::duration_cast;
+  using std::chrono::nanoseconds;
+  auto now = self->clock().now().time_since_epoch();
+  return duration_cast<nanoseconds>(now).count();
+}
+
+} // namespace
+
+void core_actor_state::send_latency_probes() {
+  if (shutting_down())
+    return;
+  std::array<std::byte, probe_token_size> token;
+  auto now = probe_clock(self);
+  memcpy(token.data(), "RTT", 3);
+  memcpy(token.data() + 3, &now, 8);
+  for (auto& [peer_id, ptr] : peers)
+    if (!ptr->removed())
+      dispatch(make_ping_message(id, peer_id, token.data(), token.size()));
+  probe_timer = self->run_delayed(peer_probe_interval,
+                                  [this] { send_latency_probes(); });
+}
+
+void core_actor_state::handle_probe_response(endpoint_id sender,
+                                             const node_message& msg) {
+  if (get_receiver(msg) != id)
+    return;
+  auto [bytes, size] = msg->raw_bytes();
+  if (size != probe_token_size || memcmp(bytes, "RTT", 3) != 0)
+    return;
+  auto i = peers.find(sender);
+  if (i == peers.end())
+    return;
+  int64_t sent = 0;
+  memcpy(&sent, bytes + 3, 8);
+  if (auto rtt = probe_clock(self) - sent; rtt >= 0)
+    i->second->latency().add(timespan{rtt});
+}
+
 // -- data store management --------------------------------------------------
 
+namespace {
+
+/// Spawns a master or clone actor. With `broker.store.detached`, each store
+/// runs on its own thread, which isolates the core from slow backend
+/// operations such as sqlite commits. The deterministic test setup always
+/// uses the scheduler.
+template <class Impl, class... Ts>
+caf::actor spawn_store(caf::actor_system& sys, Ts&&... xs) {
+  const auto& cfg = sys.config();
+  if (caf::get_or(cfg, "broker.store.detached", defaults::store::detached)
+      && caf::get_or(cfg, "caf.scheduler.policy", "") != "testing")
+    return sys.spawn<Impl, caf::detached>(std::forward<Ts>(xs)...);
+  return sys.spawn<Impl>(std::forward<Ts>(xs)...);
+}
+
+} // namespace
+
 bool core_actor_state::has_remote_master(const std::string& name) const {
   // A master would subscribe to its 'special topic', so we would see a
   // subscription for that topic if another node has a master attached. This
@@ -1038,6 +1765,17 @@ caf::result<caf::actor> core_actor_state::attach_master(const std::string& name,
   auto ptr = detail::make_backend(backend_type, std::move(opts));
   if (!ptr)
     return caf::make_error(ec::backend_failure);
+  if (caf::get_or(self->config(), "broker.store.backend-metrics",
+                  defaults::store::backend_metrics)) {
+    metric_factory factory{self->system()};
+    auto backend_name = to_string(backend_type);
+    auto hists = factory.store.backend_latency_instances(name, backend_name);
+    ptr = std::make_unique<instrumented_backend>(std::move(ptr), hists);
+  }
+  if (backend_type != backend::memory
+      && caf::get_or(self->config(), "broker.store.async-backend",
+                     defaults::store::async_backend))
+    ptr = std::make_unique<async_backend>(std::move(ptr));
   BROKER_INFO("spawning new master:" << name);
   using caf::async::make_spsc_buffer_resource;
   // Note: structured bindings with values confuses clang-tidy's leak checker.
@@ -1046,10 +1784,10 @@ caf::result<caf::actor> core_actor_state::attach_master(const std::string& name,
   auto resources2 = make_spsc_buffer_resource<command_message>();
   auto& [con2, prod2] = resources2;
   // Spin up the master and connect it to our flows.
-  auto hdl = self->system().spawn<master_actor_type>(id, name, std::move(ptr),
-                                                     caf::actor{self}, clock,
-                                                     std::move(con1),
-                                                     std::move(prod2));
+  auto hdl = spawn_store<master_actor_type>(self->system(), id, name,
+                                            std::move(ptr), caf::actor{self},
+                                            clock, std::move(con1),
+                                            std::move(prod2));
   filter_type filter{name / topic::master_suffix()};
   subscribe(filter);
   command_outputs
@@ -1057,12 +1795,14 @@ caf::result<caf::actor> core_actor_state::attach_master(const std::string& name,
       detail::prefix_matcher f;
       return f(xs, item);
     })
+    .compose(named_scope_adder(store_input_stats, name,
+                               metrics.flow_stages.store_in))
     .subscribe(prod1);
   auto in = self
               ->make_observable() //
               .from_resource(con2)
               .map([this](const command_message& msg) {
-                metrics_for(packed_message_type::command).buffered->inc();
+                count_buffered(packed_message_type::command);
                 return node_message{msg};
               })
               .as_observable();
@@ -1076,10 +1816,12 @@ caf::result<caf::actor> core_actor_state::attach_master(const std::string& name,
 caf::result<caf::actor>
 core_actor_state::attach_clone(const std::string& name, double resync_interval,
                                double stale_interval,
-                               double mutation_buffer_interval) {
+                               double mutation_buffer_interval,
+                               std::string key_prefix) {
   BROKER_TRACE(BROKER_ARG(name)
                << BROKER_ARG(resync_interval) << BROKER_ARG(stale_interval)
-               << BROKER_ARG(mutation_buffer_interval));
+               << BROKER_ARG(mutation_buffer_interval)
+               << BROKER_ARG(key_prefix));
   // Sanity checking: make sure there is no master or clone already.
   if (auto i = masters.find(name); i != masters.end()) {
     BROKER_WARNING("attempted to run clone & master on the same endpoint");
@@ -1098,8 +1840,10 @@ core_actor_state::attach_clone(const std::string& name, double resync_interval,
   auto& [con1, prod1] = resources1;
   auto resources2 = make_spsc_buffer_resource<command_message>();
   auto& [con2, prod2] = resources2;
-  auto hdl = self->system().spawn<clone_actor_type>(
-    id, name, tout, caf::actor{self}, clock, std::move(con1), std::move(prod2));
+  auto hdl = spawn_store<clone_actor_type>(self->system(), id, name, tout,
+                                           std::move(key_prefix),
+                                           caf::actor{self}, clock,
+                                           std::move(con1), std::move(prod2));
   filter_type filter{name / topic::clone_suffix()};
   subscribe(filter);
   command_outputs
@@ -1107,12 +1851,14 @@ core_actor_state::attach_clone(const std::string& name, double resync_interval,
       detail::prefix_matcher f;
       return f(xs, item);
     })
+    .compose(named_scope_adder(store_input_stats, name,
+                               metrics.flow_stages.store_in))
     .subscribe(prod1);
   auto in = self
               ->make_observable() //
               .from_resource(con2)
               .map([this](const command_message& msg) {
-                metrics_for(packed_message_type::command).buffered->inc();
+                count_buffered(packed_message_type::command);
                 return node_message{msg};
               })
               .as_observable();
@@ -1134,19 +1880,118 @@ void core_actor_state::shutdown_stores() {
   clones.clear();
 }
 
+// -- sharded dispatching -----------------------------------------------------
+
+caf::actor& core_actor_state::dispatcher_for(const filter_type& filter) {
+  BROKER_ASSERT(!dispatchers.empty());
+  auto key = std::hash<const void*>{}(&filter);
+  return dispatchers[key % dispatchers.size()];
+}
+
+// -- metrics ------------------------------------------------------------------
+
+void core_actor_state::flush_metrics() {
+  for (auto& mm : metrics.message_metric_sets) {
+    if (mm.pending_processed != 0) {
+      mm.processed->inc(mm.pending_processed);
+      mm.pending_processed = 0;
+    }
+    if (mm.pending_buffered != 0) {
+      mm.buffered->inc(mm.pending_buffered);
+      mm.pending_buffered = 0;
+    }
+  }
+  for (auto& kvp : peers) {
+    kvp.second->input_traffic()->sync_counters();
+    kvp.second->output_traffic()->sync_counters();
+  }
+}
+
+void core_actor_state::schedule_metrics_flush() {
+  if (metrics_flush_scheduled)
+    return;
+  metrics_flush_scheduled = true;
+  self->delay_fn([this] {
+    metrics_flush_scheduled = false;
+    flush_metrics();
+  });
+}
+
 // -- dispatching of messages to peers regardless of subscriptions ------------
 
 void core_actor_state::dispatch(const node_message& msg) {
-  metrics_for(get_type(msg)).buffered->inc();
+  count_buffered(get_type(msg));
+  sample_latency(msg);
+  BROKER_TRACE_EVENT(publish, msg.get(), endpoint_id{});
   unsafe_inputs.push(msg);
 }
 
+void core_actor_state::return_credit() noexcept {
+  if (async_credit && !self->current_sender())
+    async_credit->release();
+}
+
+void core_actor_state::publish_local(const data_message& msg) {
+  if (!batcher) {
+    dispatch(msg);
+    return;
+  }
+  std::vector<data_message> ready;
+  batcher->push(msg, broker::now(), ready);
+  for (auto& out : ready)
+    dispatch(out);
+  if (!batcher->empty() && !batch_timer.valid())
+    batch_timer = self->run_delayed(batcher->linger(),
+                                    [this] { flush_auto_batches(); });
+}
+
+void core_actor_state::flush_auto_batches() {
+  batch_timer = caf::disposable{};
+  if (shutting_down())
+    return;
+  auto now = broker::now();
+  std::vector<data_message> ready;
+  batcher->flush_expired(now, ready);
+  for (auto& msg : ready)
+    dispatch(msg);
+  if (auto deadline = batcher->next_deadline()) {
+    auto delay = *deadline > now ? *deadline - now : timespan{0};
+    batch_timer = self->run_delayed(delay, [this] { flush_auto_batches(); });
+  }
+}
+
 void core_actor_state::broadcast_subscriptions() {
   auto msg = routing_update_envelope::make(filter->read());
   for (auto& kvp : peers)
     dispatch(msg->with(id, kvp.first));
 }
 
+void core_actor_state::broadcast_subscriptions(
+  const shared_filter_type::snapshot& before) {
+  auto after = filter->load();
+  auto delta = filter_diff(before.filter, after->filter);
+  delta.base = before.version;
+  delta.version = after->version;
+  auto msg = routing_update_envelope::make(delta);
+  for (auto& kvp : peers)
+    dispatch(msg->with(id, kvp.first));
+}
+
+void core_actor_state::flush_routing_update() {
+  auto before = std::move(pending_routing_update);
+  pending_routing_update = nullptr;
+  if (!before)
+    return;
+  if (before->version == filter->load()->version) {
+    BROKER_DEBUG("drop routing update without changes");
+    return;
+  }
+  if (routing_update_deltas)
+    broadcast_subscriptions(*before);
+  else
+    broadcast_subscriptions();
+}
+
 // -- unpeering ----------------------------------------------------------------
 
 void core_actor_state::unpeer(endpoint_id peer_id) {
@@ -1,10 +1,23 @@
 #pragma once
 
+#include "broker/detail/duplicate_filter.hh"
+#include "broker/detail/subscription_index.hh"
 #include "broker/endpoint.hh"
+#include "broker/internal/auto_batcher.hh"
 #include "broker/internal/connector.hh"
 #include "broker/internal/connector_adapter.hh"
+#include "broker/internal/flight_recorder.hh"
 #include "broker/internal/fwd.hh"
+#include "broker/internal/max_age.hh"
+#include "broker/internal/memory_accountant.hh"
+#include "broker/internal/metric_factory.hh"
 #include "broker/internal/peering.hh"
+#include "broker/internal/publish_credit.hh"
+#include "broker/internal/qos.hh"
+#include "broker/internal/routed_message.hh"
+#include "broker/internal/topic_log.hh"
+#include "broker/internal/topic_traffic.hh"
+#include "broker/internal/wakeup_coalescer.hh"
 #include "broker/lamport_timestamp.hh"
 #include "broker/message.hh"
 
@@ -14,7 +27,10 @@
 #include <caf/make_counted.hpp>
 #include <caf/telemetry/counter.hpp>
 #include <caf/telemetry/gauge.hpp>
+#include <caf/timestamp.hpp>
 
+#include <map>
+#include <memory>
 #include <optional>
 #include <string_view>
 #include <unordered_map>
@@ -37,6 +53,12 @@ public:
     /// Keeps track of how many messages are currently buffered at the core.
     caf::telemetry::int_gauge* buffered = nullptr;
 
+    /// Counts processed messages that we did not add to `processed` yet.
+    int64_t pending_processed = 0;
+
+    /// Stores the change to `buffered` that we did not apply yet.
+    int64_t pending_buffered = 0;
+
     void assign(caf::telemetry::int_counter* processed_instance,
                 caf::telemetry::int_gauge* buffered_instance) noexcept {
       processed = processed_instance;
@@ -54,6 +76,26 @@ public:
     /// Keeps track of how many WebSocket clients are currently connected.
     caf::telemetry::int_gauge* web_socket_connections = nullptr;
 
+    /// Counts messages that overflowing peer buffers have dropped.
+    caf::telemetry::int_counter* dropped_messages = nullptr;
+
+    /// Counts messages exchanged with peers per direction and type.
+    metric_factory::int_counter_family* peer_messages = nullptr;
+
+    /// Counts bytes exchanged with peers per direction and type.
+    metric_factory::int_counter_family* peer_bytes = nullptr;
+
+    /// Samples the round-trip time per peer.
+    metric_factory::dbl_histogram_family* peer_rtt = nullptr;
+
+    /// Samples the time until a data message reaches the central merge point,
+    /// the output of a peer, or a local subscriber. Only available if the core
+    /// samples message latencies.
+    metric_factory::core_t::message_latency_t message_latency = {};
+
+    /// Aggregates demand and stalled time per flow stage.
+    metric_factory::core_t::flow_stages_t flow_stages = {};
+
     /// Stores the metrics for all message types.
     std::array<message_metrics_t, 6> message_metric_sets;
 
@@ -71,7 +113,9 @@ public:
   core_actor_state(caf::event_based_actor* self, endpoint_id this_peer,
                    filter_type initial_filter, endpoint::clock* clock = nullptr,
                    const domain_options* adaptation = nullptr,
-                   connector_ptr conn = nullptr);
+                   connector_ptr conn = nullptr,
+                   publish_credit_ptr credit = nullptr,
+                   topic_log_ptr log = nullptr);
 
   ~core_actor_state();
 
@@ -86,6 +130,17 @@ public:
   /// Cleans up all state.
   void finalize_shutdown();
 
+  /// Returns whether the core and the outputs to its peers still buffer any
+  /// message.
+  bool has_buffered_messages() const;
+
+  /// Sends the BYE message to all peers once the core no longer buffers any
+  /// message or when reaching `deadline`.
+  void remove_peers_after_drain(caf::timestamp deadline);
+
+  /// Sends the BYE message to all peers and schedules the shutdown timeout.
+  void remove_peers_for_shutdown(timespan timeout);
+
   // -- convenience functions --------------------------------------------------
 
   /// Emits a status or error code.
@@ -93,8 +148,21 @@ public:
   template <class Info, class EnumConstant>
   void emit(Info&& ep, EnumConstant code, const char* msg);
 
+  /// Returns whether `msg` is a data message that local subscribers may
+  /// receive.
+  bool is_for_local_subscribers(const node_message& msg) const noexcept;
+
+  /// Connects a local subscriber with the handle `hdl` in `local_subscriptions`
+  /// to the central merge point. Replaces the previous buffer of the
+  /// subscriber if `hdl` already has a flow.
+  void add_local_subscriber(detail::subscription_index::handle_type hdl,
+                            data_producer_res snk);
+
   /// Returns whether `x` has at least one remote subscriber.
-  bool has_remote_subscriber(const topic& x) const noexcept;
+  bool has_remote_subscriber(const topic& x) const;
+
+  /// Computes the set of peers that receive `msg`.
+  routed_message route(const node_message& msg);
 
   /// Checks whether peer with given `id` is subscribed to the topic `what`.
   bool is_subscribed_to(endpoint_id id, const topic& what);
@@ -117,6 +185,13 @@ public:
   /// Creates a snapshot for the status of local publishers.
   vector local_publisher_stats_snapshot() const;
 
+  /// Creates a snapshot for the topic prefixes with the most traffic.
+  vector topic_stats_snapshot() const;
+
+  /// Creates a snapshot for the flow stages between the central merge point,
+  /// WebSocket clients and data stores.
+  table flow_stats_snapshot() const;
+
   /// Creates a snapshot that summarizes the current status of the core.
   table status_snapshot() const;
 
@@ -161,6 +236,9 @@ public:
                            const filter_type& filter,
                            const pending_connection_ptr& conn);
 
+  /// Assigns per-peer metric instances to the statistics of `ptr`.
+  void instrument_traffic(peering& ptr);
+
   /// Connects the input and output buffers for a new client to our central
   /// merge point.
   caf::error init_new_client(const network_info& addr, const std::string& type,
@@ -173,6 +251,18 @@ public:
   /// connected peers.
   void subscribe(const filter_type& what);
 
+  /// Updates the filter of the peer `sender` from a routing update message.
+  void handle_routing_update(endpoint_id sender,
+                             const routing_update_envelope_ptr& msg);
+
+  // -- latency probes ---------------------------------------------------------
+
+  /// Sends a latency probe (PING) to each peer and schedules the next round.
+  void send_latency_probes();
+
+  /// Updates the round-trip time for `sender` if `msg` answers a probe.
+  void handle_probe_response(endpoint_id sender, const node_message& msg);
+
   // -- data store management --------------------------------------------------
 
   /// Returns whether a master for `name` probably exists already on one of our
@@ -184,11 +274,13 @@ public:
                                         backend backend_type,
                                         backend_options opts);
 
-  /// Attaches a clone for given store to this peer.
+  /// Attaches a clone for given store to this peer. A non-empty `key_prefix`
+  /// restricts the clone to string keys with this prefix.
   caf::result<caf::actor> attach_clone(const std::string& name,
                                        double resync_interval,
                                        double stale_interval,
-                                       double mutation_buffer_interval);
+                                       double mutation_buffer_interval,
+                                       std::string key_prefix = {});
 
   /// Terminates all masters and clones by sending exit messages to the
   /// corresponding actors.
@@ -200,9 +292,30 @@ public:
   /// @returns `true` on success, `false` if no peering to `receiver` exists.
   void dispatch(const node_message& msg);
 
+  /// Gives the credit of an asynchronously published message back to the
+  /// endpoint. The endpoint sends these messages anonymously, whereas stores
+  /// and the metric exporter use the same handlers without taking credit.
+  void return_credit() noexcept;
+
+  /// Dispatches `msg` after passing it through `batcher` if automatic
+  /// batching is enabled.
+  void publish_local(const data_message& msg);
+
+  /// Dispatches all batches that reached their deadline and schedules the
+  /// next flush if batches remain pending.
+  void flush_auto_batches();
+
   /// Broadcasts the local subscriptions to all peers.
   void broadcast_subscriptions();
 
+  /// Broadcasts the change from `before` to the current local subscriptions to
+  /// all peers.
+  void broadcast_subscriptions(const shared_filter_type::snapshot& before);
+
+  /// Broadcasts all subscription changes since `pending_routing_update` to
+  /// all peers.
+  void flush_routing_update();
+
   // -- unpeering --------------------------------------------------------------
 
   /// Disconnects a peer by demand of the user.
@@ -229,10 +342,52 @@ public:
   /// with the connector, which needs access to the filter during handshake.
   shared_filter_ptr filter;
 
+  /// Maps topic prefixes to the peers that subscribed to them. The filter of
+  /// each @ref peering only serves as representation for the wire format.
+  detail::subscription_index peer_subscriptions;
+
+  /// Maps topic prefixes to the local subscribers that subscribed to them.
+  detail::subscription_index local_subscriptions;
+
+  /// Maps the shared filters of local subscribers to their handle in
+  /// `local_subscriptions`.
+  std::unordered_map<const filter_type*,
+                     detail::subscription_index::handle_type>
+    local_subscription_handles;
+
+  /// Connects a local subscriber to the central merge point.
+  struct local_subscriber_flow {
+    /// Increases whenever the subscriber replaces its buffer.
+    size_t generation = 0;
+
+    /// Disposes the flow to the current buffer of the subscriber.
+    caf::disposable sub;
+  };
+
+  /// Maps handles in `local_subscriptions` to the flows of local subscribers.
+  std::unordered_map<detail::subscription_index::handle_type,
+                     local_subscriber_flow>
+    local_subscriber_flows;
+
   /// Stores whether this peer disabled forwarding, i.e., only appears as leaf
   /// node to other peers.
   bool disable_forwarding = false;
 
+  /// Stores whether this peer sends incremental routing updates instead of its
+  /// full filter. Requires that all peers understand deltas.
+  bool routing_update_deltas = false;
+
+  /// Configures how long the core collects subscription changes before
+  /// broadcasting them. A value of 0 broadcasts each change immediately.
+  timespan routing_update_interval{0};
+
+  /// Stores the state of the filter prior to the first change that the core
+  /// did not broadcast yet or `nullptr` if no change is pending.
+  shared_filter_type::snapshot_ptr pending_routing_update;
+
+  /// Triggers `flush_routing_update` at the end of the current window.
+  caf::disposable routing_update_timer;
+
   /// Turns off status and error notifications for peering events.
   bool disable_notifications = false;
 
@@ -260,8 +415,9 @@ public:
   /// Pushes flows into the central merge point.
   caf::flow::item_publisher<caf::flow::observable<node_message>> flow_inputs;
 
-  /// The output of `flow_inputs`.
-  caf::flow::observable<node_message> central_merge;
+  /// The output of `flow_inputs`. Each message carries the set of peers that
+  /// receive it, computed once before dispatching it to all flows.
+  caf::flow::observable<routed_message> central_merge;
 
   /// Pushes data messages into the flow.
   caf::flow::observable<data_message> data_outputs;
@@ -280,11 +436,6 @@ public:
   detail::shared_peer_status_map_ptr peer_statuses =
     std::make_shared<detail::peer_status_map>();
 
-  /// Buffer for serializing messages. Having this as a member allows us to
-  /// re-use the same heap-allocated buffer instead of always allocating fresh
-  /// memory regions over and over again.
-  caf::byte_buffer buf;
-
   /// Stores the subscriptions for our input sources to allow us to cancel them.
   std::vector<caf::disposable> subscriptions;
 
@@ -300,6 +451,65 @@ public:
   /// Time-to-live when sending messages.
   uint16_t ttl;
 
+  /// Drops copies of messages that arrive via redundant paths. Null if
+  /// duplicate suppression is disabled.
+  std::unique_ptr<detail::duplicate_filter> duplicates;
+
+  /// Number of messages we buffer for each peer before applying
+  /// `peer_overflow_policy`. A value of 0 disables the buffer.
+  size_t peer_buffer_size = 0;
+
+  /// Selects what happens when the buffer for a peer overflows.
+  overflow_policy peer_overflow_policy = overflow_policy::disconnect;
+
+  /// Number of messages that wake up a local subscriber at once. A value of 1
+  /// disables coalescing.
+  size_t subscriber_wakeup_batch = 1;
+
+  /// Maximum time a message for a local subscriber waits for reaching
+  /// `subscriber_wakeup_batch`.
+  timespan subscriber_wakeup_delay = timespan{0};
+
+  /// Keeps track of the bytes in the buffers of all peers and enforces the
+  /// memory budget.
+  memory_accountant_ptr memory;
+
+  /// Assigns priorities and rate limits to data messages by topic. Null if
+  /// no QoS classes are configured.
+  qos_table_ptr qos;
+
+  /// Assigns deadlines to data messages by topic. Null if no maximum ages are
+  /// configured.
+  max_age_table_ptr max_age;
+
+  /// Counts data messages that exceeded their maximum age.
+  caf::telemetry::int_counter* expired_messages = nullptr;
+
+  /// Number of pending data messages that control messages to a peer may
+  /// overtake. A value of 0 disables priority lanes.
+  size_t peer_priority_window = 0;
+
+  /// Interval between two latency probes. A value of 0 disables the probes.
+  timespan peer_probe_interval{0};
+
+  /// Triggers the next round of latency probes.
+  caf::disposable probe_timer;
+
+  /// Packs local Zeek messages into batches. A `nullptr` disables automatic
+  /// batching.
+  std::unique_ptr<auto_batcher> batcher;
+
+  /// Triggers the next flush of `batcher`.
+  caf::disposable batch_timer;
+
+  /// Continuously captures all data and command messages. A `nullptr`
+  /// disables the capture.
+  std::unique_ptr<flight_recorder> recorder;
+
+  /// Retains data messages on configured topics for replaying them to late
+  /// subscribers. A `nullptr` disables the retention.
+  topic_log_ptr retention_log;
+
   /// When shutting down, this scheduled action forces disconnects on all peers
   /// after the timeout.
   caf::disposable shutting_down_timeout;
@@ -342,6 +552,40 @@ public:
                             }};
   }
 
+  /// Keeps track of statistics for the central merge point.
+  flow_scope_stats_ptr central_merge_stats =
+    std::make_shared<flow_scope_stats>();
+
+  using flow_scope_stats_ptr_map = std::map<std::string, flow_scope_stats_ptr>;
+
+  /// Keeps track of statistics for the outputs to WebSocket clients by ID. This
+  /// is a pointer for the same reason as `local_subscriber_stats`.
+  std::shared_ptr<flow_scope_stats_ptr_map> client_output_stats =
+    std::make_shared<flow_scope_stats_ptr_map>();
+
+  /// Keeps track of statistics for the inputs of data stores by name. This is
+  /// a pointer for the same reason as `local_subscriber_stats`.
+  std::shared_ptr<flow_scope_stats_ptr_map> store_input_stats =
+    std::make_shared<flow_scope_stats_ptr_map>();
+
+  /// Returns a function object for adding instrumentation to a flow that we
+  /// store in `stats_map` under `key`.
+  static auto
+  named_scope_adder(const std::shared_ptr<flow_scope_stats_ptr_map>& stats_map,
+                    std::string key,
+                    metric_factory::core_t::flow_stage_t stage) {
+    auto stats_ptr = std::make_shared<flow_scope_stats>();
+    stats_ptr->demand_gauge = stage.demand;
+    stats_ptr->stalled_counter = stage.stalled;
+    (*stats_map)[key] = stats_ptr;
+    return add_flow_scope_t{stats_ptr, [stats_map, key = std::move(key)](
+                                         const flow_scope_stats_ptr& ptr) {
+                              if (auto i = stats_map->find(key);
+                                  i != stats_map->end() && i->second == ptr)
+                                stats_map->erase(i);
+                            }};
+  }
+
   /// Returns whether `shutdown` was called.
   bool shutting_down();
 
@@ -350,9 +594,91 @@ public:
     return metrics.metrics_for(msg_type);
   }
 
+  /// Counts a message that enters the central merge point.
+  void count_buffered(packed_message_type msg_type) {
+    auto& mm = metrics_for(msg_type);
+    if (!batch_metrics) {
+      mm.buffered->inc();
+      return;
+    }
+    ++mm.pending_buffered;
+    schedule_metrics_flush();
+  }
+
+  /// Counts a message that has passed the central merge point.
+  void count_processed(packed_message_type msg_type) {
+    auto& mm = metrics_for(msg_type);
+    if (!batch_metrics) {
+      mm.processed->inc();
+      mm.buffered->dec();
+      return;
+    }
+    ++mm.pending_processed;
+    --mm.pending_buffered;
+    schedule_metrics_flush();
+  }
+
+  /// Returns the dispatcher that owns the shared filter `filter`.
+  /// @pre `!dispatchers.empty()`
+  caf::actor& dispatcher_for(const filter_type& filter);
+
+  /// Delivers data messages to local subscribers in sharded mode. Empty if the
+  /// core delivers data messages to local subscribers itself.
+  std::vector<caf::actor> dispatchers;
+
+  /// Selects the dispatcher for the next local subscriber with a fixed filter.
+  size_t next_dispatcher = 0;
+
+  /// Applies all pending metric updates in batched mode.
+  void flush_metrics();
+
+  /// Schedules a call to `flush_metrics` at the end of the current scheduling
+  /// step unless a flush is already pending.
+  void schedule_metrics_flush();
+
+  /// Stores whether the core updates its message metrics and the traffic
+  /// metrics of its peers once per scheduling step instead of once per
+  /// message.
+  bool batch_metrics = false;
+
+  /// Stores whether `flush_metrics` is already scheduled.
+  bool metrics_flush_scheduled = false;
+
+  /// Marks every n-th data message as a sample for the latency histograms.
+  void sample_latency(const node_message& msg) {
+    if (latency_sample_rate == 0 || get_type(msg) != packed_message_type::data)
+      return;
+    if (++latency_sample_counter == latency_sample_rate) {
+      latency_sample_counter = 0;
+      msg->mark_sampled();
+    }
+  }
+
+  /// Records the age of `msg` in `hist` if `msg` is a sample.
+  static void observe_latency(caf::telemetry::dbl_histogram* hist,
+                              const envelope& msg) {
+    if (hist != nullptr && msg.sampled())
+      hist->observe(msg.sample_age());
+  }
+
+  /// Configures how many data messages the core receives per latency sample.
+  /// A value of 0 disables the sampling.
+  size_t latency_sample_rate = 0;
+
+  /// Counts data messages since the last latency sample.
+  size_t latency_sample_counter = 0;
+
+  /// Counts messages and bytes per topic prefix. Only available if the user
+  /// configured a topic depth.
+  std::unique_ptr<topic_traffic> topic_stats;
+
   /// Counts messages that were published directly via message, i.e., without
   /// using the back-pressure of flows.
   int64_t published_via_async_msg = 0;
+
+  /// Bounds the messages that `endpoint::publish` sends as asynchronous
+  /// messages. Only available if the user configured a credit.
+  publish_credit_ptr async_credit;
 };
 
 using core_actor = caf::stateful_actor<core_actor_state>;
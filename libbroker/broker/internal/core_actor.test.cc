@@ -169,4 +169,53 @@ TEST(peers forward local data to any peer with forwarding paths) {
   CHECK_EQUAL(values(*buf), values(test_data));
 }
 
+TEST(route selects receiving peers and skips the sender) {
+  MESSAGE("spin up ep1, ep2 and ep3 and connect ep2 to both");
+  auto abc = filter_type{"a", "b", "c"};
+  ep1.filter = abc;
+  ep2.filter = abc;
+  ep3.filter = abc;
+  spin_up(ep1, ep2, ep3);
+  bridge(ep1, ep2);
+  bridge(ep2, ep3);
+  run();
+  auto& st = state(ep2);
+  auto i1 = st.peers.find(ep1.id);
+  auto i3 = st.peers.find(ep3.id);
+  REQUIRE(i1 != st.peers.end());
+  REQUIRE(i3 != st.peers.end());
+  auto slot1 = i1->second->subscription_handle();
+  auto slot3 = i3->second->subscription_handle();
+  auto msg = node_message{make_data_message("a", data{1})};
+  MESSAGE("local messages go to all subscribed peers");
+  {
+    auto res = st.route(msg);
+    CHECK(res.peers.test(slot1));
+    CHECK(res.peers.test(slot3));
+  }
+  MESSAGE("messages from ep1 go to ep3 but not back to ep1");
+  {
+    auto res = st.route(msg->with(ep1.id, endpoint_id::nil()));
+    CHECK(!res.peers.test(slot1));
+    CHECK(res.peers.test(slot3));
+  }
+  MESSAGE("messages for a specific receiver go to that peer only");
+  {
+    auto res = st.route(msg->with(ep2.id, ep3.id));
+    CHECK(!res.peers.test(slot1));
+    CHECK(res.peers.test(slot3));
+  }
+  MESSAGE("messages with an exhausted TTL stay on this node");
+  {
+    auto res = st.route(msg->with(ep1.id, endpoint_id::nil(), 1));
+    CHECK(res.peers.none());
+  }
+  MESSAGE("messages on topics without subscribers go nowhere");
+  {
+    auto res = st.route(node_message{make_data_message("x", data{1})});
+    CHECK(res.peers.none());
+    CHECK(res.locals.none());
+  }
+}
+
 FIXTURE_SCOPE_END()
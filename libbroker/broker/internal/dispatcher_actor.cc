@@ -0,0 +1,106 @@
+#include "broker/internal/dispatcher_actor.hh"
+
+#include <caf/behavior.hpp>
+#include <caf/scheduled_actor/flow.hpp>
+
+#include "broker/detail/topic_matcher.hh"
+#include "broker/internal/logger.hh"
+#include "broker/internal/type_id.hh"
+
+#include <algorithm>
+
+namespace broker::internal {
+
+dispatcher_actor_state::dispatcher_actor_state(caf::event_based_actor* self,
+                                               data_consumer_res src)
+  : self(self), src(std::move(src)) {
+  // nop
+}
+
+caf::behavior dispatcher_actor_state::make_behavior() {
+  inputs = self->make_observable().from_resource(std::move(src)).share();
+  // Always consume the inputs, even without any subscriber. Otherwise, this
+  // dispatcher would stall the core until the first subscriber arrives.
+  inputs
+    .do_on_complete([this] {
+      BROKER_DEBUG("core closed the input of the dispatcher");
+      self->quit();
+    })
+    .for_each([](const data_message&) {});
+  return {
+    [this](filter_type& filter, data_producer_res snk) {
+      // Fixed filters never change. Hence, the flow uses a precompiled matcher
+      // and we keep a copy of the filter only for `has_subscriber`.
+      auto fptr = std::make_shared<filter_type>(filter);
+      auto key = fptr.get();
+      flows[key].filter = std::move(fptr);
+      auto sub = inputs
+                   .filter([f = detail::topic_matcher{filter}](
+                             const data_message& msg) { return f(msg); })
+                   .do_finally([this, key] { flows.erase(key); })
+                   .subscribe(std::move(snk));
+      if (auto i = flows.find(key); i != flows.end())
+        i->second.sub = std::move(sub);
+    },
+    [this](std::shared_ptr<filter_type> fptr, data_producer_res snk) {
+      add_subscriber(std::move(fptr), std::move(snk));
+    },
+    [this](atom::update, std::shared_ptr<filter_type> fptr,
+           data_producer_res snk) {
+      // The subscriber resizes its queue by handing us a new buffer.
+      if (flows.count(fptr.get()) != 0)
+        add_subscriber(std::move(fptr), std::move(snk));
+    },
+    [](std::shared_ptr<filter_type>& fptr, topic& x, bool add,
+       std::shared_ptr<std::promise<void>>& sync) {
+      auto e = fptr->end();
+      auto i = std::find(fptr->begin(), e, x);
+      if (add) {
+        if (i == e)
+          fptr->emplace_back(std::move(x));
+      } else if (i != e) {
+        fptr->erase(i);
+      }
+      if (sync)
+        sync->set_value();
+    },
+    [this](atom::get, atom::subscriptions, const topic& what) {
+      return has_subscriber(what.string());
+    },
+  };
+}
+
+void dispatcher_actor_state::add_subscriber(std::shared_ptr<filter_type> fptr,
+                                            data_producer_res snk) {
+  // Same logic as `core_actor_state::add_local_subscriber`: disposing the
+  // previous flow closes the previous buffer of the subscriber.
+  auto key = fptr.get();
+  auto gen = ++flows[key].generation;
+  flows[key].filter = fptr;
+  if (auto& prev = flows[key].sub)
+    prev.dispose();
+  // The core forwards all updates to this filter to us. Hence, only this
+  // actor accesses the filter after the subscriber has been added.
+  auto sub = inputs
+               .filter([fptr = std::move(fptr)](const data_message& msg) {
+                 return detail::topic_matcher::matches(*fptr, msg);
+               })
+               .do_finally([this, key, gen] {
+                 if (auto i = flows.find(key);
+                     i != flows.end() && i->second.generation == gen)
+                   flows.erase(i);
+               })
+               .subscribe(std::move(snk));
+  if (auto i = flows.find(key); i != flows.end() && i->second.generation == gen)
+    i->second.sub = std::move(sub);
+}
+
+bool dispatcher_actor_state::has_subscriber(
+  std::string_view str) const noexcept {
+  for (const auto& [key, flow] : flows)
+    if (flow.filter && detail::topic_matcher::matches(*flow.filter, str))
+      return true;
+  return false;
+}
+
+} // namespace broker::internal
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "broker/filter_type.hh"
+#include "broker/internal/fwd.hh"
+#include "broker/message.hh"
+
+#include <caf/disposable.hpp>
+#include <caf/event_based_actor.hpp>
+#include <caf/flow/observable.hpp>
+#include <caf/stateful_actor.hpp>
+
+#include <future>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+namespace broker::internal {
+
+/// Delivers data messages to a group of local subscribers on behalf of the
+/// core. In sharded mode, the core spawns several dispatchers and assigns each
+/// local subscriber to one of them. Every dispatcher receives the full stream
+/// of data messages for local subscribers, in the same order as the core.
+/// Hence, the sharding preserves the per-publisher ordering while moving the
+/// filter evaluation for local subscribers off the core.
+class dispatcher_actor_state {
+public:
+  // -- constants --------------------------------------------------------------
+
+  static inline const char* name = "broker.dispatcher";
+
+  // -- constructors and destructors -------------------------------------------
+
+  dispatcher_actor_state(caf::event_based_actor* self, data_consumer_res src);
+
+  // -- initialization ---------------------------------------------------------
+
+  caf::behavior make_behavior();
+
+  // -- member functions -------------------------------------------------------
+
+  /// Connects a local subscriber to `inputs`, replacing the previous buffer of
+  /// the subscriber if it already has a flow.
+  void add_subscriber(std::shared_ptr<filter_type> fptr, data_producer_res snk);
+
+  /// Returns whether at least one subscriber of this dispatcher receives
+  /// messages on the topic `str`.
+  bool has_subscriber(std::string_view str) const noexcept;
+
+  // -- member variables -------------------------------------------------------
+
+  /// Points to the actor that owns this state.
+  caf::event_based_actor* self;
+
+  /// Stores the input resource until `make_behavior` connects it.
+  data_consumer_res src;
+
+  /// Provides all data messages for local subscribers.
+  caf::flow::observable<data_message> inputs;
+
+  /// Connects a subscriber with a shared filter to `inputs`.
+  struct subscriber_flow {
+    /// Selects the messages for the subscriber.
+    std::shared_ptr<filter_type> filter;
+
+    /// Increases whenever the subscriber replaces its buffer.
+    size_t generation = 0;
+
+    /// Disposes the flow to the current buffer of the subscriber.
+    caf::disposable sub;
+  };
+
+  /// Maps the filters of subscribers to their flows. For subscribers with a
+  /// fixed filter, the dispatcher owns a copy of the filter.
+  std::unordered_map<const filter_type*, subscriber_flow> flows;
+};
+
+using dispatcher_actor = caf::stateful_actor<dispatcher_actor_state>;
+
+} // namespace broker::internal
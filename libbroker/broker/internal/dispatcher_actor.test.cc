@@ -0,0 +1,174 @@
+#include "broker/internal/dispatcher_actor.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <caf/flow/item_publisher.hpp>
+#include <caf/scheduled_actor/flow.hpp>
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "broker/internal/type_id.hh"
+
+using namespace broker;
+using namespace broker::internal;
+
+namespace {
+
+using string_list = std::vector<std::string>;
+
+using message_list = std::vector<data_message>;
+
+using message_list_ptr = std::shared_ptr<message_list>;
+
+// Stands in for the core by pushing each incoming message to the dispatcher.
+caf::behavior source_impl(caf::event_based_actor* self,
+                          data_producer_res snk) {
+  using publisher_type = caf::flow::item_publisher<data_message>;
+  auto pub = std::make_shared<publisher_type>(self);
+  pub->as_observable().subscribe(std::move(snk));
+  return {
+    [pub](const data_message& msg) { pub->push(msg); },
+  };
+}
+
+// Stands in for a local subscriber.
+void sink_impl(caf::event_based_actor* self, message_list_ptr buf,
+               data_consumer_res src) {
+  self->make_observable()
+    .from_resource(std::move(src))
+    .for_each([buf](const data_message& msg) { buf->emplace_back(msg); });
+}
+
+struct fixture : base_fixture {
+  caf::actor source;
+
+  caf::actor uut;
+
+  fixture() {
+    auto [con, prod] = caf::async::make_spsc_buffer_resource<data_message>();
+    source = sys.spawn(source_impl, std::move(prod));
+    uut = sys.spawn<dispatcher_actor>(std::move(con));
+    run();
+  }
+
+  ~fixture() override {
+    caf::anon_send_exit(source, caf::exit_reason::user_shutdown);
+    caf::anon_send_exit(uut, caf::exit_reason::user_shutdown);
+    run();
+  }
+
+  auto make_sink() {
+    auto [con, prod] = caf::async::make_spsc_buffer_resource<data_message>();
+    auto buf = std::make_shared<message_list>();
+    sys.spawn(sink_impl, buf, std::move(con));
+    return std::make_pair(buf, std::move(prod));
+  }
+
+  void publish(std::initializer_list<const char*> topics) {
+    for (auto str : topics)
+      caf::anon_send(source, make_data_message(str, data{str}));
+    run();
+  }
+
+  static string_list topics(const message_list& xs) {
+    string_list result;
+    for (const auto& x : xs)
+      result.emplace_back(x->topic());
+    return result;
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(dispatcher_actor_tests, fixture)
+
+TEST(dispatchers deliver messages to subscribers with matching filters) {
+  auto buf_a = collect_data(uut, filter_type{"/a"});
+  auto buf_b = collect_data(uut, filter_type{"/b"});
+  run();
+  publish({"/a/1", "/b/1", "/c/1", "/a/2"});
+  CHECK_EQUAL(topics(*buf_a), string_list({"/a/1", "/a/2"}));
+  CHECK_EQUAL(topics(*buf_b), string_list({"/b/1"}));
+}
+
+TEST(dispatchers consume their input without any subscriber) {
+  publish({"/a/1", "/a/2"});
+  auto buf = collect_data(uut, filter_type{"/a"});
+  run();
+  publish({"/a/3"});
+  CHECK_EQUAL(topics(*buf), string_list({"/a/3"}));
+}
+
+TEST(dispatchers apply updates to shared filters) {
+  auto fptr = std::make_shared<filter_type>(filter_type{"/a"});
+  auto [buf, snk] = make_sink();
+  caf::anon_send(uut, fptr, std::move(snk));
+  run();
+  publish({"/a/1", "/b/1"});
+  MESSAGE("add /b to the filter");
+  auto sync = std::make_shared<std::promise<void>>();
+  caf::anon_send(uut, fptr, topic{"/b"}, true, sync);
+  run();
+  publish({"/a/2", "/b/2"});
+  MESSAGE("remove /a from the filter");
+  caf::anon_send(uut, fptr, topic{"/a"}, false,
+                 std::shared_ptr<std::promise<void>>{});
+  run();
+  publish({"/a/3", "/b/3"});
+  CHECK_EQUAL(*fptr, filter_type{"/b"});
+  CHECK_EQUAL(topics(*buf), string_list({"/a/1", "/a/2", "/b/2", "/b/3"}));
+}
+
+TEST(subscribers replace their buffer without losing their filter) {
+  auto fptr = std::make_shared<filter_type>(filter_type{"/a"});
+  auto [buf1, snk1] = make_sink();
+  caf::anon_send(uut, fptr, std::move(snk1));
+  run();
+  publish({"/a/1"});
+  MESSAGE("hand the dispatcher a new buffer for the same filter");
+  auto [buf2, snk2] = make_sink();
+  caf::anon_send(uut, atom::update_v, fptr, std::move(snk2));
+  run();
+  publish({"/a/2"});
+  CHECK_EQUAL(topics(*buf1), string_list({"/a/1"}));
+  CHECK_EQUAL(topics(*buf2), string_list({"/a/2"}));
+  CHECK_EQUAL(deref<dispatcher_actor>(uut).state.flows.size(), 1u);
+}
+
+TEST(dispatchers know which topics have subscribers) {
+  auto& state = deref<dispatcher_actor>(uut).state;
+  CHECK(!state.has_subscriber("/a/1"));
+  MESSAGE("add a subscriber with a fixed filter and one with a shared filter");
+  auto buf = collect_data(uut, filter_type{"/a"});
+  auto fptr = std::make_shared<filter_type>(filter_type{"/b"});
+  auto [shared_buf, snk] = make_sink();
+  caf::anon_send(uut, fptr, std::move(snk));
+  run();
+  CHECK(state.has_subscriber("/a/1"));
+  CHECK(state.has_subscriber("/b/1"));
+  CHECK(!state.has_subscriber("/c/1"));
+  MESSAGE("remove /b from the shared filter");
+  caf::anon_send(uut, fptr, topic{"/b"}, false,
+                 std::shared_ptr<std::promise<void>>{});
+  run();
+  CHECK(!state.has_subscriber("/b/1"));
+  MESSAGE("the dispatcher answers subscription queries from the core");
+  self->send(uut, atom::get_v, atom::subscriptions_v, topic{"/a/1"});
+  run();
+  self->receive([](bool found) { CHECK(found); });
+}
+
+TEST(updates for unknown filters leave the dispatcher unchanged) {
+  auto fptr = std::make_shared<filter_type>(filter_type{"/a"});
+  auto [buf, snk] = make_sink();
+  caf::anon_send(uut, atom::update_v, fptr, std::move(snk));
+  run();
+  publish({"/a/1"});
+  CHECK(buf->empty());
+  CHECK(deref<dispatcher_actor>(uut).state.flows.empty());
+}
+
+FIXTURE_SCOPE_END()
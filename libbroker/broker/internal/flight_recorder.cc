@@ -0,0 +1,222 @@
+#include "broker/internal/flight_recorder.hh"
+
+#include "broker/detail/filesystem.hh"
+#include "broker/error.hh"
+#include "broker/format/bin.hh"
+#include "broker/internal/logger.hh"
+#include "broker/internal/wire_format.hh"
+
+#include <caf/byte_span.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace broker::internal {
+
+namespace {
+
+/// Time the writer sleeps when finding the queue empty.
+constexpr auto idle_interval = std::chrono::milliseconds{1};
+
+/// Writes to disk once the buffer exceeds this size, even if the queue still
+/// has messages.
+constexpr size_t flush_threshold = 64 * 1024;
+
+} // namespace
+
+flight_recorder::flight_recorder(std::string directory, size_t queue_size,
+                                 size_t max_file_size, size_t max_files)
+  : directory_(std::move(directory)),
+    max_file_size_(max_file_size),
+    max_files_(max_files),
+    queue_(queue_size) {
+  // nop
+}
+
+flight_recorder::~flight_recorder() {
+  stop();
+}
+
+std::string flight_recorder::file_name(const std::string& directory,
+                                       uint64_t seq) {
+  // Pad the sequence number to keep lexicographic and chronological order
+  // consistent.
+  auto num = std::to_string(seq);
+  if (num.size() < 6)
+    num.insert(0, 6 - num.size(), '0');
+  auto result = directory;
+  if (!result.empty() && result.back() != '/')
+    result += '/';
+  result += "capture-";
+  result += num;
+  result += ".dat";
+  return result;
+}
+
+bool flight_recorder::start() {
+  if (running_)
+    return true;
+  if (!detail::is_directory(directory_) && !detail::mkdirs(directory_)) {
+    BROKER_WARNING("cannot create flight recorder directory" << directory_);
+    return false;
+  }
+  if (!rotate())
+    return false;
+  running_ = true;
+  thread_ = std::thread{[this] {
+    while (running_.load(std::memory_order_acquire)) {
+      if (!drain()) {
+        // Make the file reflect the latest state before going to sleep.
+        flush();
+        std::this_thread::sleep_for(idle_interval);
+      }
+    }
+    // Producers may still have added messages after the last iteration.
+    drain();
+    flush();
+  }};
+  return true;
+}
+
+void flight_recorder::stop() {
+  if (!running_)
+    return;
+  running_.store(false, std::memory_order_release);
+  thread_.join();
+  file_.close();
+  BROKER_DEBUG("flight recorder stopped:" << recorded() << "recorded,"
+                                          << dropped() << "dropped");
+}
+
+bool flight_recorder::try_record(const node_message& msg) {
+  switch (get_type(msg)) {
+    case packed_message_type::data:
+    case packed_message_type::command:
+      break;
+    default:
+      return false;
+  }
+  // Copying the pointer is cheap. The writer thread serializes the envelope.
+  if (!queue_.try_push(msg)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+expected<std::vector<node_message>>
+flight_recorder::load(const std::string& fname) {
+  std::ifstream in{fname, std::ios::binary};
+  if (!in)
+    return make_error(ec::cannot_open_file, fname);
+  std::vector<char> bytes{std::istreambuf_iterator<char>{in},
+                          std::istreambuf_iterator<char>{}};
+  uint32_t file_magic = 0;
+  if (bytes.size() < header_size)
+    return make_error(ec::invalid_data, "capture file too short");
+  memcpy(&file_magic, bytes.data(), sizeof(file_magic));
+  if (format::bin::v1::from_network_order(file_magic) != magic
+      || static_cast<uint8_t>(bytes[sizeof(magic)]) != version)
+    return make_error(ec::invalid_data, "not a capture file");
+  std::vector<node_message> result;
+  wire_format::v1::trait trait;
+  size_t pos = header_size;
+  while (pos < bytes.size()) {
+    uint32_t len = 0;
+    if (bytes.size() - pos < sizeof(len))
+      return make_error(ec::invalid_data, "truncated capture file");
+    memcpy(&len, bytes.data() + pos, sizeof(len));
+    len = format::bin::v1::from_network_order(len);
+    pos += sizeof(len);
+    if (bytes.size() - pos < len)
+      return make_error(ec::invalid_data, "truncated capture file");
+    auto first = reinterpret_cast<const caf::byte*>(bytes.data() + pos);
+    node_message msg;
+    if (!trait.convert(caf::const_byte_span{first, len}, msg))
+      return make_error(ec::invalid_data, "invalid entry in capture file");
+    result.emplace_back(std::move(msg));
+    pos += len;
+  }
+  return result;
+}
+
+bool flight_recorder::drain() {
+  node_message msg;
+  if (!queue_.try_pop(msg))
+    return false;
+  do {
+    write(msg);
+  } while (queue_.try_pop(msg));
+  return true;
+}
+
+void flight_recorder::write(const node_message& msg) {
+  // We rotate before writing to never leave an empty file behind.
+  if (file_size_ + buf_.size() >= max_file_size_) {
+    flush();
+    rotate();
+  }
+  if (!file_.is_open()) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  // Reserve space for the size prefix and fill it in after serializing.
+  auto offset = buf_.size();
+  buf_.resize(offset + sizeof(uint32_t));
+  wire_format::v1::trait trait;
+  if (!trait.convert(msg, buf_)) {
+    BROKER_WARNING("unable to serialize a message for the flight recorder");
+    buf_.resize(offset);
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  auto len = static_cast<uint32_t>(buf_.size() - offset - sizeof(uint32_t));
+  len = format::bin::v1::to_network_order(len);
+  memcpy(buf_.data() + offset, &len, sizeof(len));
+  recorded_.fetch_add(1, std::memory_order_relaxed);
+  if (buf_.size() >= flush_threshold)
+    flush();
+}
+
+void flight_recorder::flush() {
+  if (buf_.empty())
+    return;
+  if (file_.is_open()) {
+    if (file_.write(reinterpret_cast<const char*>(buf_.data()), buf_.size())
+        && file_.flush()) {
+      file_size_ += buf_.size();
+    } else {
+      BROKER_WARNING("unable to write to capture file:" << files_.back());
+      file_.close();
+    }
+  }
+  buf_.clear();
+}
+
+bool flight_recorder::rotate() {
+  file_.close();
+  auto fname = file_name(directory_, next_seq_++);
+  file_.open(fname, std::ios::binary);
+  if (!file_) {
+    BROKER_WARNING("cannot open capture file" << fname);
+    file_.close();
+    return false;
+  }
+  // Write the header.
+  buf_.resize(header_size);
+  auto m = format::bin::v1::to_network_order(magic);
+  memcpy(buf_.data(), &m, sizeof(m));
+  buf_[sizeof(m)] = static_cast<caf::byte>(version);
+  file_size_ = 0;
+  files_.emplace_back(std::move(fname));
+  flush();
+  if (max_files_ > 0 && files_.size() > max_files_) {
+    detail::remove(files_.front());
+    files_.pop_front();
+  }
+  return true;
+}
+
+} // namespace broker::internal
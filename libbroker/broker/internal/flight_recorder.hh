@@ -0,0 +1,139 @@
+#pragma once
+
+#include "broker/detail/mpsc_ring.hh"
+#include "broker/expected.hh"
+#include "broker/message.hh"
+
+#include <caf/byte_buffer.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace broker::internal {
+
+/// Continuously records data and command messages into a rotating set of
+/// capture files. The recorder never writes on the thread of the caller:
+/// `try_record` only stores a reference to the envelope in a lock-free queue
+/// and a background thread writes the queued messages. When the writer falls
+/// behind, the recorder drops messages instead of slowing down the caller.
+///
+/// Capture files start with a 4-byte magic number and a 1-byte version,
+/// followed by one entry per message. Each entry consists of a 4-byte size
+/// (network byte order) and the envelope in Broker's wire format. Hence,
+/// writing an entry only copies the serialized envelope.
+class flight_recorder {
+public:
+  // -- constants --------------------------------------------------------------
+
+  static constexpr uint32_t magic = 0x42524643; // "BRFC"
+
+  static constexpr uint8_t version = 1;
+
+  static constexpr size_t header_size = sizeof(magic) + sizeof(version);
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// @param directory Path for storing the capture files.
+  /// @param queue_size Maximum number of messages waiting for the writer.
+  /// @param max_file_size Starts a new file once the current file reaches
+  ///                      this many bytes.
+  /// @param max_files Maximum number of files to keep on disk. The recorder
+  ///                  removes the oldest file when exceeding this limit. A
+  ///                  value of 0 keeps all files.
+  flight_recorder(std::string directory, size_t queue_size,
+                  size_t max_file_size, size_t max_files);
+
+  flight_recorder(const flight_recorder&) = delete;
+
+  flight_recorder& operator=(const flight_recorder&) = delete;
+
+  ~flight_recorder();
+
+  // -- properties -------------------------------------------------------------
+
+  const std::string& directory() const noexcept {
+    return directory_;
+  }
+
+  /// Returns the number of messages that the writer stored on disk.
+  size_t recorded() const noexcept {
+    return recorded_.load(std::memory_order_relaxed);
+  }
+
+  /// Returns the number of messages that the recorder dropped, either because
+  /// the queue was full or because writing to disk failed.
+  size_t dropped() const noexcept {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  /// Returns the names of all capture files that are currently on disk, from
+  /// oldest to newest.
+  /// @pre `stop` was called or `start` was never called.
+  const std::deque<std::string>& files() const noexcept {
+    return files_;
+  }
+
+  /// Returns the name of the capture file with sequence number `seq`.
+  static std::string file_name(const std::string& directory, uint64_t seq);
+
+  // -- recording --------------------------------------------------------------
+
+  /// Opens the first capture file and launches the writer thread.
+  /// @returns `false` if the recorder cannot open a file in its directory.
+  bool start();
+
+  /// Writes all queued messages, closes the current file and joins the writer
+  /// thread.
+  void stop();
+
+  /// Queues `msg` for the writer if `msg` is a data or command message.
+  /// @returns `true` if the recorder accepted `msg`, `false` if the recorder
+  ///          ignored or dropped it.
+  bool try_record(const node_message& msg);
+
+  // -- reading ----------------------------------------------------------------
+
+  /// Reads all messages from a capture file.
+  static expected<std::vector<node_message>> load(const std::string& fname);
+
+private:
+  /// Writes all queued messages.
+  /// @returns `true` if there was at least one message in the queue.
+  bool drain();
+
+  /// Serializes a single message and rotates the file if necessary.
+  void write(const node_message& msg);
+
+  /// Writes the content of `buf_` to the current file.
+  void flush();
+
+  /// Closes the current file and opens the next one.
+  bool rotate();
+
+  std::string directory_;
+  size_t max_file_size_;
+  size_t max_files_;
+
+  /// Passes messages from producers to the writer thread.
+  detail::mpsc_ring<node_message> queue_;
+
+  std::atomic<bool> running_{false};
+  std::atomic<size_t> recorded_{0};
+  std::atomic<size_t> dropped_{0};
+
+  /// State of the writer thread.
+  std::thread thread_;
+  std::ofstream file_;
+  caf::byte_buffer buf_;
+  size_t file_size_ = 0;
+  uint64_t next_seq_ = 0;
+  std::deque<std::string> files_;
+};
+
+} // namespace broker::internal
@@ -0,0 +1,99 @@
+#include "broker/internal/flight_recorder.hh"
+
+#include "broker/broker-test.test.hh"
+#include "broker/temp_directory.test.hh"
+
+#include "broker/detail/filesystem.hh"
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace broker;
+
+namespace {
+
+struct fixture : temp_directory_fixture {
+  /// Reads all messages from `fname` and returns their data.
+  std::vector<data> read_all(const std::string& fname) {
+    std::vector<data> result;
+    auto msgs = internal::flight_recorder::load(fname);
+    if (!msgs) {
+      FAIL("unable to read " << fname << ": " << to_string(msgs.error()));
+    }
+    for (const auto& msg : *msgs)
+      if (get_type(msg) == packed_message_type::data)
+        result.emplace_back(get_data(msg->as_data()).to_data());
+    return result;
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(flight_recorder_tests, fixture)
+
+TEST(file names sort in the order of their sequence numbers) {
+  using internal::flight_recorder;
+  CHECK_EQUAL(flight_recorder::file_name("/tmp", 7),
+              "/tmp/capture-000007.dat");
+  CHECK_EQUAL(flight_recorder::file_name("/tmp/", 1234567),
+              "/tmp/capture-1234567.dat");
+}
+
+TEST(the recorder writes queued messages in the background) {
+  internal::flight_recorder uut{path, 64, 1024 * 1024, 0};
+  REQUIRE(uut.start());
+  for (count n = 0; n < 10; ++n)
+    CHECK(uut.try_record(make_msg(n)));
+  uut.stop();
+  CHECK_EQUAL(uut.recorded(), 10u);
+  CHECK_EQUAL(uut.dropped(), 0u);
+  REQUIRE_EQUAL(uut.files().size(), 1u);
+  auto xs = read_all(uut.files().front());
+  REQUIRE_EQUAL(xs.size(), 10u);
+  for (count n = 0; n < 10; ++n)
+    CHECK_EQUAL(xs[n], data{n});
+}
+
+TEST(the recorder rotates its files and removes old ones) {
+  internal::flight_recorder uut{path, 1024, 256, 2};
+  REQUIRE(uut.start());
+  for (count n = 0; n < 200; ++n) {
+    // Give the writer a chance to catch up instead of dropping messages.
+    while (!uut.try_record(make_msg(n)))
+      std::this_thread::yield();
+  }
+  uut.stop();
+  CHECK_EQUAL(uut.recorded(), 200u);
+  REQUIRE_EQUAL(uut.files().size(), 2u);
+  CHECK(!detail::exists(internal::flight_recorder::file_name(path, 0)));
+  for (const auto& fname : uut.files())
+    CHECK(detail::exists(fname));
+  // The last file contains the most recent messages.
+  auto xs = read_all(uut.files().back());
+  REQUIRE(!xs.empty());
+  CHECK_EQUAL(xs.back(), data{count{199}});
+}
+
+TEST(the recorder drops messages instead of blocking when its queue is full) {
+  // Without calling start, nobody drains the queue.
+  internal::flight_recorder uut{path, 4, 1024, 0};
+  size_t accepted = 0;
+  for (count n = 0; n < 10; ++n)
+    if (uut.try_record(make_msg(n)))
+      ++accepted;
+  CHECK_EQUAL(accepted, 4u);
+  CHECK_EQUAL(uut.dropped(), 6u);
+}
+
+TEST(loading rejects files that are not capture files) {
+  CHECK(!internal::flight_recorder::load(path));
+  {
+    std::ofstream out{path, std::ios::binary};
+    out << "garbage";
+  }
+  CHECK(!internal::flight_recorder::load(path));
+}
+
+FIXTURE_SCOPE_END()
@@ -1,18 +1,78 @@
 #pragma once
 
+#include "broker/time.hh"
+
 #include <caf/disposable.hpp>
 #include <caf/flow/op/cold.hpp>
 #include <caf/scheduled_actor.hpp>
 #include <caf/telemetry/counter.hpp>
+#include <caf/telemetry/gauge.hpp>
 
+#include <chrono>
 #include <functional>
 
 namespace broker::internal {
 
 /// Bundles counters that give insight into how much data flows through a scope.
 struct flow_scope_stats {
+  using clock_type = std::chrono::steady_clock;
+
   int64_t requested = 0;
   int64_t delivered = 0;
+
+  /// Accumulates the time the scope spent without demand after delivering an
+  /// item, i.e., how long the downstream stages back-pressured this scope.
+  timespan stalled{0};
+
+  /// Stores when the current stall began or the default value if the scope
+  /// still has demand.
+  clock_type::time_point stalled_since;
+
+  /// Optionally aggregates the outstanding demand of several scopes.
+  caf::telemetry::int_gauge* demand_gauge = nullptr;
+
+  /// Optionally aggregates the stalled time of several scopes in seconds.
+  caf::telemetry::dbl_counter* stalled_counter = nullptr;
+
+  /// Returns how many items the scope may deliver without further requests.
+  int64_t demand() const noexcept {
+    return requested - delivered;
+  }
+
+  /// Returns the accumulated stalled time, including the current stall.
+  timespan stalled_time() const {
+    if (stalled_since == clock_type::time_point{})
+      return stalled;
+    return stalled + (clock_type::now() - stalled_since);
+  }
+
+  void on_request(size_t n) {
+    requested += static_cast<int64_t>(n);
+    if (demand_gauge)
+      demand_gauge->inc(static_cast<int64_t>(n));
+    if (stalled_since != clock_type::time_point{}) {
+      auto elapsed = clock_type::now() - stalled_since;
+      stalled += elapsed;
+      stalled_since = clock_type::time_point{};
+      if (stalled_counter)
+        stalled_counter->inc(fractional_seconds{elapsed}.count());
+    }
+  }
+
+  void on_deliver() {
+    ++delivered;
+    if (demand_gauge)
+      demand_gauge->dec();
+    if (demand() == 0)
+      stalled_since = clock_type::now();
+  }
+
+  /// Removes the outstanding demand of this scope from the gauge.
+  void on_dispose() {
+    if (demand_gauge)
+      demand_gauge->dec(demand());
+    demand_gauge = nullptr;
+  }
 };
 
 /// @relates flow_scope_stats
@@ -48,6 +108,7 @@ public:
   }
 
   ~flow_scope_sub() override {
+    stats_->on_dispose();
     if (deregister_cb_) {
       try {
         deregister_cb_(stats_);
@@ -89,7 +150,7 @@ public:
 
   void on_next(const Input& item) override {
     if (out_) {
-      ++stats_->delivered;
+      stats_->on_deliver();
       out_.on_next(item);
     }
   }
@@ -139,7 +200,7 @@ public:
   }
 
   void request(size_t n) override {
-    stats_->requested += static_cast<int64_t>(n);
+    stats_->on_request(n);
     if (in_)
       in_.request(n);
     else
@@ -0,0 +1,35 @@
+#include "broker/internal/flow_scope.hh"
+
+#include "broker/broker-test.test.hh"
+
+using namespace broker;
+
+namespace {
+
+using clock_type = internal::flow_scope_stats::clock_type;
+
+} // namespace
+
+TEST(flow scope stats track the outstanding demand) {
+  internal::flow_scope_stats stats;
+  stats.on_request(3);
+  CHECK_EQUAL(stats.demand(), 3);
+  stats.on_deliver();
+  stats.on_deliver();
+  CHECK_EQUAL(stats.requested, 3);
+  CHECK_EQUAL(stats.delivered, 2);
+  CHECK_EQUAL(stats.demand(), 1);
+}
+
+TEST(flow scope stats measure how long a scope has no demand) {
+  internal::flow_scope_stats stats;
+  stats.on_request(1);
+  CHECK(stats.stalled_since == clock_type::time_point{});
+  stats.on_deliver();
+  CHECK(stats.stalled_since != clock_type::time_point{});
+  CHECK_GREATER_EQUAL(stats.stalled_time(), stats.stalled);
+  MESSAGE("receiving more demand ends the stall");
+  stats.on_request(1);
+  CHECK(stats.stalled_since == clock_type::time_point{});
+  CHECK_EQUAL(stats.stalled_time(), stats.stalled);
+}
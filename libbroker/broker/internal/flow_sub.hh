@@ -0,0 +1,129 @@
+#pragma once
+
+#include <caf/flow/coordinator.hpp>
+#include <caf/flow/observer.hpp>
+#include <caf/flow/subscription.hpp>
+#include <caf/ref_counted.hpp>
+
+#include <cstddef>
+
+namespace broker::internal {
+
+/// Base class for the subscriptions of flow operators that sit between a
+/// single input and a single observer. Implements reference counting, the
+/// handshake with the input, and shutting down both ends. Subclasses buffer
+/// the items and implement `on_next`, `on_complete`, `request` and `clear`.
+template <class In, class Out = In>
+class flow_sub : public caf::ref_counted,
+                 public caf::flow::observer_impl<In>,
+                 public caf::flow::subscription_impl {
+public:
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// @param ctx The coordinator that runs the flow.
+  /// @param out The observer that receives the outputs.
+  /// @param initial_demand The demand that the subscription signals to its
+  ///                       input right after subscribing.
+  flow_sub(caf::flow::coordinator* ctx, caf::flow::observer<Out> out,
+           size_t initial_demand)
+    : ctx_(ctx), out_(std::move(out)), initial_demand_(initial_demand) {
+    // nop
+  }
+
+  // -- ref counting -----------------------------------------------------------
+
+  void ref_disposable() const noexcept final {
+    this->ref();
+  }
+
+  void deref_disposable() const noexcept final {
+    this->deref();
+  }
+
+  void ref_coordinated() const noexcept final {
+    this->ref();
+  }
+
+  void deref_coordinated() const noexcept final {
+    this->deref();
+  }
+
+  friend void intrusive_ptr_add_ref(const flow_sub* ptr) noexcept {
+    ptr->ref();
+  }
+
+  friend void intrusive_ptr_release(const flow_sub* ptr) noexcept {
+    ptr->deref();
+  }
+
+  // -- implementation of observer_impl<In> ------------------------------------
+
+  void on_error(const caf::error& what) override {
+    in_ = nullptr;
+    clear();
+    if (out_) {
+      auto tmp = std::move(out_);
+      tmp.on_error(what);
+    }
+  }
+
+  void on_subscribe(caf::flow::subscription in) override {
+    if (!in_ && out_) {
+      in_ = std::move(in);
+      if (initial_demand_ > 0)
+        in_.request(initial_demand_);
+    } else {
+      in.dispose();
+    }
+  }
+
+  // -- implementation of subscription_impl ------------------------------------
+
+  bool disposed() const noexcept override {
+    return !in_ && !out_;
+  }
+
+  void dispose() override {
+    clear();
+    if (out_) {
+      ctx_->delay_fn([out = std::move(out_)]() mutable { out.on_complete(); });
+    }
+    if (in_) {
+      in_.dispose();
+      in_ = nullptr;
+    }
+  }
+
+protected:
+  /// Drops all buffered state. Called on errors and when disposing the
+  /// subscription.
+  virtual void clear() = 0;
+
+  /// Completes the observer unless it already received a terminal event.
+  void complete_out() {
+    if (out_) {
+      auto tmp = std::move(out_);
+      tmp.on_complete();
+    }
+  }
+
+  /// Runs the flow.
+  caf::flow::coordinator* ctx_;
+
+  /// Provides the inputs. Null after the input completed or failed.
+  caf::flow::subscription in_;
+
+  /// Receives the outputs. Null after sending a terminal event.
+  caf::flow::observer<Out> out_;
+
+  /// Demand for the input right after subscribing.
+  size_t initial_demand_;
+
+  /// Pending demand of the observer.
+  size_t demand_ = 0;
+
+  /// Stores whether the input completed.
+  bool completed_ = false;
+};
+
+} // namespace broker::internal
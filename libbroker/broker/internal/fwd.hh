@@ -2,13 +2,17 @@
 
 #include <caf/async/fwd.hpp>
 
+#include <cstddef>
 #include <memory>
+#include <vector>
 
 namespace broker::internal {
 
 enum class connector_event_id : uint64_t;
 
 struct retry_state;
+struct store_request_batch;
+struct store_response_batch;
 
 class central_dispatcher;
 class flare_actor;
@@ -22,5 +26,10 @@ using data_producer_res = caf::async::producer_resource<data_message>;
 using node_consumer_res = caf::async::consumer_resource<node_message>;
 using node_producer_res = caf::async::producer_resource<node_message>;
 using pending_connection_ptr = std::shared_ptr<pending_connection>;
+using store_request_batch_ptr = std::shared_ptr<store_request_batch>;
+using store_response_batch_ptr = std::shared_ptr<store_response_batch>;
+
+/// A batch of pre-encoded data messages (see `format::bin::v1::encode_record`).
+using encoded_batch_ptr = std::shared_ptr<const std::vector<std::byte>>;
 
 } // namespace broker::internal
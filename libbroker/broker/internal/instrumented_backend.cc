@@ -0,0 +1,143 @@
+#include "broker/internal/instrumented_backend.hh"
+
+#include <chrono>
+
+namespace broker::internal {
+
+namespace {
+
+/// Runs `f` and records its run time in `hist`.
+template <class F>
+auto timed(caf::telemetry::dbl_histogram* hist, F&& f) {
+  using clock_type = std::chrono::steady_clock;
+  auto t0 = clock_type::now();
+  auto result = f();
+  auto elapsed = clock_type::now() - t0;
+  hist->observe(std::chrono::duration<double>{elapsed}.count());
+  return result;
+}
+
+} // namespace
+
+instrumented_backend::instrumented_backend(backend_pointer decorated,
+                                           latency_metrics metrics)
+  : decorated_(std::move(decorated)), metrics_(metrics) {
+  // nop
+}
+
+// -- modifiers ----------------------------------------------------------------
+
+expected<void> instrumented_backend::put(const data& key, data value,
+                                         std::optional<timestamp> expiry) {
+  return timed(metrics_.put, [&] {
+    return decorated_->put(key, std::move(value), expiry);
+  });
+}
+
+expected<void> instrumented_backend::add(const data& key, const data& value,
+                                         data::type init_type,
+                                         std::optional<timestamp> expiry) {
+  return timed(metrics_.add, [&] {
+    return decorated_->add(key, value, init_type, expiry);
+  });
+}
+
+expected<void>
+instrumented_backend::subtract(const data& key, const data& value,
+                               std::optional<timestamp> expiry) {
+  return timed(metrics_.subtract,
+               [&] { return decorated_->subtract(key, value, expiry); });
+}
+
+expected<void> instrumented_backend::erase(const data& key) {
+  return timed(metrics_.erase, [&] { return decorated_->erase(key); });
+}
+
+expected<void> instrumented_backend::clear() {
+  return decorated_->clear();
+}
+
+expected<bool> instrumented_backend::expire(const data& key,
+                                            timestamp current_time) {
+  return timed(metrics_.expire,
+               [&] { return decorated_->expire(key, current_time); });
+}
+
+expected<void> instrumented_backend::begin_transaction() {
+  return decorated_->begin_transaction();
+}
+
+expected<void> instrumented_backend::commit_transaction() {
+  return decorated_->commit_transaction();
+}
+
+expected<void> instrumented_backend::abort_transaction() {
+  return decorated_->abort_transaction();
+}
+
+expected<void> instrumented_backend::flush() {
+  return decorated_->flush();
+}
+
+void instrumented_backend::release_memory() {
+  decorated_->release_memory();
+}
+
+// -- inspectors ---------------------------------------------------------------
+
+expected<data> instrumented_backend::get(const data& key) const {
+  return timed(metrics_.get, [&] { return decorated_->get(key); });
+}
+
+expected<data> instrumented_backend::get(const data& key,
+                                         const data& aspect) const {
+  return timed(metrics_.get, [&] { return decorated_->get(key, aspect); });
+}
+
+expected<data>
+instrumented_backend::get_many(const std::vector<data>& keys) const {
+  return decorated_->get_many(keys);
+}
+
+expected<bool> instrumented_backend::exists(const data& key) const {
+  return decorated_->exists(key);
+}
+
+expected<uint64_t> instrumented_backend::size() const {
+  return decorated_->size();
+}
+
+expected<data> instrumented_backend::keys() const {
+  return decorated_->keys();
+}
+
+expected<data> instrumented_backend::range(const data& first, const data& last,
+                                           size_t limit) const {
+  return decorated_->range(first, last, limit);
+}
+
+expected<data>
+instrumented_backend::keys_with_prefix(const std::string& prefix,
+                                       size_t limit) const {
+  return decorated_->keys_with_prefix(prefix, limit);
+}
+
+expected<broker::snapshot> instrumented_backend::snapshot() const {
+  return decorated_->snapshot();
+}
+
+expected<void>
+instrumented_backend::for_each(const detail::entry_visitor& f) const {
+  return decorated_->for_each(f);
+}
+
+expected<detail::expirables> instrumented_backend::expiries() const {
+  return decorated_->expiries();
+}
+
+expected<detail::expirables>
+instrumented_backend::expiries_between(timestamp first, timestamp last) const {
+  return decorated_->expiries_between(first, last);
+}
+
+} // namespace broker::internal
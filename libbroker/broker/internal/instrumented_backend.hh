@@ -0,0 +1,80 @@
+#pragma once
+
+#include "broker/detail/abstract_backend.hh"
+#include "broker/internal/metric_factory.hh"
+
+#include <memory>
+
+namespace broker::internal {
+
+/// Decorates a backend for sampling how long its operations take.
+class instrumented_backend : public detail::abstract_backend {
+public:
+  using backend_pointer = std::unique_ptr<detail::abstract_backend>;
+
+  using latency_metrics = metric_factory::store_t::backend_latency_t;
+
+  instrumented_backend(backend_pointer decorated, latency_metrics metrics);
+
+  // -- modifiers --------------------------------------------------------------
+
+  expected<void> put(const data& key, data value,
+                     std::optional<timestamp> expiry) override;
+
+  expected<void> add(const data& key, const data& value, data::type init_type,
+                     std::optional<timestamp> expiry) override;
+
+  expected<void> subtract(const data& key, const data& value,
+                          std::optional<timestamp> expiry) override;
+
+  expected<void> erase(const data& key) override;
+
+  expected<void> clear() override;
+
+  expected<bool> expire(const data& key, timestamp current_time) override;
+
+  expected<void> begin_transaction() override;
+
+  expected<void> commit_transaction() override;
+
+  expected<void> abort_transaction() override;
+
+  expected<void> flush() override;
+
+  void release_memory() override;
+
+  // -- inspectors -------------------------------------------------------------
+
+  expected<data> get(const data& key) const override;
+
+  expected<data> get(const data& key, const data& aspect) const override;
+
+  expected<data> get_many(const std::vector<data>& keys) const override;
+
+  expected<bool> exists(const data& key) const override;
+
+  expected<uint64_t> size() const override;
+
+  expected<data> keys() const override;
+
+  expected<data> range(const data& first, const data& last,
+                       size_t limit) const override;
+
+  expected<data> keys_with_prefix(const std::string& prefix,
+                                  size_t limit) const override;
+
+  expected<broker::snapshot> snapshot() const override;
+
+  expected<void> for_each(const detail::entry_visitor& f) const override;
+
+  expected<detail::expirables> expiries() const override;
+
+  expected<detail::expirables> expiries_between(timestamp first,
+                                                timestamp last) const override;
+
+private:
+  backend_pointer decorated_;
+  latency_metrics metrics_;
+};
+
+} // namespace broker::internal
@@ -0,0 +1,61 @@
+#include "broker/internal/instrumented_backend.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include "broker/detail/memory_backend.hh"
+
+#include <caf/telemetry/metric_registry.hpp>
+
+using namespace broker;
+
+namespace {
+
+int64_t observations(const caf::telemetry::dbl_histogram* hist) {
+  int64_t result = 0;
+  for (auto& bucket : hist->buckets())
+    result += bucket.count.value();
+  return result;
+}
+
+struct fixture {
+  caf::telemetry::metric_registry reg;
+  internal::instrumented_backend::latency_metrics metrics;
+  std::unique_ptr<internal::instrumented_backend> backend;
+
+  fixture() {
+    internal::metric_factory factory{reg};
+    metrics = factory.store.backend_latency_instances("foo", "memory");
+    backend = std::make_unique<internal::instrumented_backend>(
+      std::make_unique<detail::memory_backend>(), metrics);
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(instrumented_backend_tests, fixture)
+
+TEST(the decorator samples the latency of each operation) {
+  REQUIRE(backend->put(data{"a"}, data{1}, std::nullopt));
+  REQUIRE(backend->put(data{"b"}, data{2}, std::nullopt));
+  REQUIRE(backend->add(data{"a"}, data{1}, data::type::integer, std::nullopt));
+  REQUIRE(backend->erase(data{"b"}));
+  auto value = backend->get(data{"a"});
+  REQUIRE(value);
+  CHECK_EQUAL(*value, data{2});
+  CHECK_EQUAL(observations(metrics.put), 2);
+  CHECK_EQUAL(observations(metrics.add), 1);
+  CHECK_EQUAL(observations(metrics.subtract), 0);
+  CHECK_EQUAL(observations(metrics.erase), 1);
+  CHECK_EQUAL(observations(metrics.get), 1);
+}
+
+TEST(other operations pass through without sampling) {
+  REQUIRE(backend->put(data{"a"}, data{1}, std::nullopt));
+  auto size = backend->size();
+  REQUIRE(size);
+  CHECK_EQUAL(*size, 1u);
+  CHECK_EQUAL(backend->exists(data{"a"}), true);
+  CHECK_EQUAL(observations(metrics.get), 0);
+}
+
+FIXTURE_SCOPE_END()
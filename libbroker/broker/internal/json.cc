@@ -7,11 +7,18 @@
 #include "broker/variant_set.hh"
 #include "broker/variant_table.hh"
 
+#include <caf/detail/parse.hpp>
 #include <caf/json_array.hpp>
 #include <caf/json_object.hpp>
 #include <caf/json_value.hpp>
 #include <caf/type_id.hpp>
 
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+
 namespace broker::internal {
 
 namespace {
@@ -156,6 +163,671 @@ bool to_binary_impl(const caf::json_object& obj, OutIter& out) {
   return false;
 }
 
+/// Maximum nesting of JSON arrays and objects that we accept. Protects the
+/// recursive descent below against stack exhaustion.
+constexpr size_t max_json_depth = 256;
+
+/// Converts a JSON text to the binary format in a single pass, i.e., without
+/// building a JSON object first. Member functions return `false` on error and
+/// set `code` to `ec::type_clash` if the input could not be converted to Broker
+/// data. Otherwise, the error is a malformed JSON input.
+class streaming_converter {
+public:
+  streaming_converter(std::string_view str, std::vector<std::byte>& buf)
+    : first_(str.data()),
+      pos_(str.data()),
+      end_(str.data() + str.size()),
+      buf_(buf) {
+    // nop
+  }
+
+  /// Converts the top-level object, which represents a data message.
+  bool run(std::string& type, std::string& topic) {
+    if (!convert_object(&type, &topic))
+      return false;
+    skip_ws();
+    return pos_ == end_;
+  }
+
+  /// Validates the entire input without converting anything.
+  bool validate() {
+    pos_ = first_;
+    depth_ = 0;
+    if (!skip_value())
+      return false;
+    skip_ws();
+    return pos_ == end_;
+  }
+
+  /// Returns the position of the last character that we have read.
+  size_t offset() const noexcept {
+    return static_cast<size_t>(pos_ - first_);
+  }
+
+  ec code = ec::invalid_json;
+
+private:
+  /// Decrements the nesting depth when leaving an array or object.
+  struct depth_guard {
+    size_t& depth;
+    ~depth_guard() {
+      --depth;
+    }
+  };
+
+  // -- error handling ---------------------------------------------------------
+
+  bool type_clash() {
+    code = ec::type_clash;
+    return false;
+  }
+
+  // -- tokenizing -------------------------------------------------------------
+
+  static bool is_digit(char c) noexcept {
+    return c >= '0' && c <= '9';
+  }
+
+  void skip_ws() noexcept {
+    while (pos_ != end_
+           && (*pos_ == ' ' || *pos_ == '\n' || *pos_ == '\r' || *pos_ == '\t'))
+      ++pos_;
+  }
+
+  /// Skips whitespace and returns the next character without consuming it or
+  /// '\0' at the end of the input.
+  char peek() noexcept {
+    skip_ws();
+    return pos_ != end_ ? *pos_ : '\0';
+  }
+
+  /// Consumes `c` if it is the next non-whitespace character.
+  bool consume(char c) noexcept {
+    if (peek() != c)
+      return false;
+    ++pos_;
+    return true;
+  }
+
+  bool consume_literal(std::string_view str) noexcept {
+    skip_ws();
+    if (static_cast<size_t>(end_ - pos_) < str.size()
+        || std::string_view{pos_, str.size()} != str)
+      return false;
+    pos_ += str.size();
+    return true;
+  }
+
+  static int hex_value(char c) noexcept {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  /// Reads four hex digits of a `\u` escape sequence.
+  bool read_hex4(const char*& pos, uint32_t& result) const noexcept {
+    if (end_ - pos < 4)
+      return false;
+    result = 0;
+    for (int i = 0; i < 4; ++i) {
+      auto val = hex_value(*pos++);
+      if (val < 0)
+        return false;
+      result = (result << 4) | static_cast<uint32_t>(val);
+    }
+    return true;
+  }
+
+  /// Reads one escape sequence at `pos`, i.e., after the backslash. Appends
+  /// the decoded character to `out` unless `out` is `nullptr`.
+  bool read_escaped(const char*& pos, std::string* out) const {
+    if (pos == end_)
+      return false;
+    char ch;
+    switch (*pos++) {
+      case '"':
+        ch = '"';
+        break;
+      case '\\':
+        ch = '\\';
+        break;
+      case '/':
+        ch = '/';
+        break;
+      case 'b':
+        ch = '\b';
+        break;
+      case 'f':
+        ch = '\f';
+        break;
+      case 'n':
+        ch = '\n';
+        break;
+      case 'r':
+        ch = '\r';
+        break;
+      case 't':
+        ch = '\t';
+        break;
+      case 'v': // Not standard JSON, but our encoder produces it.
+        ch = '\v';
+        break;
+      case 'u': {
+        uint32_t cp = 0;
+        if (!read_hex4(pos, cp))
+          return false;
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+          // A high surrogate must be followed by a low surrogate.
+          uint32_t low = 0;
+          if (end_ - pos < 2 || pos[0] != '\\' || pos[1] != 'u')
+            return false;
+          pos += 2;
+          if (!read_hex4(pos, low) || low < 0xDC00 || low > 0xDFFF)
+            return false;
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+          return false;
+        }
+        if (out != nullptr)
+          append_utf8(cp, *out);
+        return true;
+      }
+      default:
+        return false;
+    }
+    if (out != nullptr)
+      out->push_back(ch);
+    return true;
+  }
+
+  static void append_utf8(uint32_t cp, std::string& out) {
+    if (cp < 0x80) {
+      out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+      out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+      out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+      out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+      out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+      out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+      out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+      out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+      out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+      out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+  }
+
+  /// Reads a quoted string. Points `result` into the input if the string has
+  /// no escape sequences and decodes the string into `scratch` otherwise. Only
+  /// validates the string if `scratch` is `nullptr`.
+  bool read_string(std::string_view& result, std::string* scratch) {
+    if (!consume('"'))
+      return false;
+    auto first = pos_;
+    while (pos_ != end_ && *pos_ != '"' && *pos_ != '\\')
+      ++pos_;
+    if (pos_ == end_)
+      return false;
+    if (*pos_ == '"') {
+      result = std::string_view{first, static_cast<size_t>(pos_ - first)};
+      ++pos_;
+      return true;
+    }
+    // Slow path: decode escape sequences.
+    if (scratch != nullptr)
+      scratch->assign(first, pos_);
+    while (pos_ != end_) {
+      auto ch = *pos_++;
+      if (ch == '"') {
+        if (scratch != nullptr)
+          result = *scratch;
+        return true;
+      }
+      if (ch != '\\') {
+        if (scratch != nullptr)
+          scratch->push_back(ch);
+      } else if (!read_escaped(pos_, scratch)) {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  /// Represents a JSON number.
+  struct number {
+    enum { signed_integer, unsigned_integer, real } kind;
+    int64_t int_val;
+    uint64_t uint_val;
+    double real_val;
+  };
+
+  bool read_number(number& result) {
+    skip_ws();
+    auto first = pos_;
+    if (pos_ != end_ && *pos_ == '-')
+      ++pos_;
+    if (pos_ == end_ || !is_digit(*pos_))
+      return false;
+    if (*pos_ == '0')
+      ++pos_;
+    else
+      while (pos_ != end_ && is_digit(*pos_))
+        ++pos_;
+    auto is_real = false;
+    if (pos_ != end_ && *pos_ == '.') {
+      is_real = true;
+      if (++pos_ == end_ || !is_digit(*pos_))
+        return false;
+      while (pos_ != end_ && is_digit(*pos_))
+        ++pos_;
+    }
+    if (pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E')) {
+      is_real = true;
+      if (++pos_ != end_ && (*pos_ == '+' || *pos_ == '-'))
+        ++pos_;
+      if (pos_ == end_ || !is_digit(*pos_))
+        return false;
+      while (pos_ != end_ && is_digit(*pos_))
+        ++pos_;
+    }
+    if (!is_real) {
+      if (*first == '-') {
+        auto [ptr, err] = std::from_chars(first, pos_, result.int_val);
+        if (err == std::errc{} && ptr == pos_) {
+          result.kind = number::signed_integer;
+          return true;
+        }
+      } else {
+        auto [ptr, err] = std::from_chars(first, pos_, result.uint_val);
+        if (err == std::errc{} && ptr == pos_) {
+          result.kind = number::unsigned_integer;
+          return true;
+        }
+      }
+      // Fall through: integers out of range become real numbers.
+    }
+    auto str = std::string_view{first, static_cast<size_t>(pos_ - first)};
+    if (auto err = caf::detail::parse(str, result.real_val))
+      return false;
+    result.kind = number::real;
+    return true;
+  }
+
+  /// Skips over any JSON value.
+  bool skip_value() {
+    switch (peek()) {
+      case '{': {
+        if (++depth_ > max_json_depth)
+          return false;
+        depth_guard guard{depth_};
+        ++pos_;
+        if (consume('}'))
+          return true;
+        do {
+          std::string_view key;
+          if (!read_string(key, nullptr) || !consume(':') || !skip_value())
+            return false;
+        } while (consume(','));
+        return consume('}');
+      }
+      case '[': {
+        if (++depth_ > max_json_depth)
+          return false;
+        depth_guard guard{depth_};
+        ++pos_;
+        if (consume(']'))
+          return true;
+        do {
+          if (!skip_value())
+            return false;
+        } while (consume(','));
+        return consume(']');
+      }
+      case '"': {
+        std::string_view str;
+        return read_string(str, nullptr);
+      }
+      case 't':
+        return consume_literal("true");
+      case 'f':
+        return consume_literal("false");
+      case 'n':
+        return consume_literal("null");
+      default: {
+        number tmp;
+        return read_number(tmp);
+      }
+    }
+  }
+
+  // -- conversion -------------------------------------------------------------
+
+  /// Converts the value in `[first, last)` by calling `fn()`.
+  template <class Fn>
+  bool convert_range(const char* first, const char* last, Fn fn) {
+    auto pos = pos_;
+    auto end = end_;
+    pos_ = first;
+    end_ = last;
+    auto ok = fn();
+    skip_ws();
+    ok = ok && pos_ == end_;
+    pos_ = pos;
+    end_ = end;
+    return ok;
+  }
+
+  /// Converts a value that we expect to be a JSON string by calling
+  /// `fn(str)`, whereas `fn` returns `false` if the string has the wrong
+  /// format.
+  template <class Fn>
+  bool convert_string(Fn fn) {
+    if (peek() != '"')
+      return type_clash();
+    std::string_view str;
+    if (!read_string(str, &scratch_))
+      return false;
+    if (!fn(str))
+      return type_clash();
+    return true;
+  }
+
+  /// Converts a value with `@data-type` equal to `dtype`.
+  bool convert_data(std::string_view dtype) {
+    namespace bin_v1 = format::bin::v1;
+    auto out = std::back_inserter(buf_);
+    if (dtype == "none") {
+      out = bin_v1::encode_with_tag(nil, out);
+      return skip_value();
+    }
+    if (dtype == "boolean") {
+      if (consume_literal("true")) {
+        out = bin_v1::encode_with_tag(true, out);
+        return true;
+      }
+      if (consume_literal("false")) {
+        out = bin_v1::encode_with_tag(false, out);
+        return true;
+      }
+      return type_clash();
+    }
+    if (dtype == "count" || dtype == "integer" || dtype == "real") {
+      auto c = peek();
+      if (c != '-' && !is_digit(c))
+        return type_clash();
+      number num;
+      if (!read_number(num))
+        return false;
+      if (dtype == "count") {
+        if (num.kind == number::unsigned_integer)
+          out = bin_v1::encode_with_tag(count{num.uint_val}, out);
+        else if (num.kind == number::signed_integer && num.int_val >= 0)
+          out = bin_v1::encode_with_tag(static_cast<count>(num.int_val), out);
+        else
+          return type_clash();
+      } else if (dtype == "integer") {
+        if (num.kind == number::signed_integer)
+          out = bin_v1::encode_with_tag(integer{num.int_val}, out);
+        else if (num.kind == number::unsigned_integer
+                 && num.uint_val <= uint64_t{INT64_MAX})
+          out = bin_v1::encode_with_tag(static_cast<integer>(num.uint_val),
+                                        out);
+        else
+          return type_clash();
+      } else {
+        if (num.kind != number::real)
+          return type_clash();
+        out = bin_v1::encode_with_tag(real{num.real_val}, out);
+      }
+      return true;
+    }
+    if (dtype == "string") {
+      return convert_string([&out](std::string_view str) {
+        out = bin_v1::encode_with_tag(str, out);
+        return true;
+      });
+    }
+    if (dtype == "enum-value") {
+      return convert_string([&out](std::string_view str) {
+        out = bin_v1::encode_with_tag(enum_value_view{str}, out);
+        return true;
+      });
+    }
+    if (dtype == "address")
+      return convert_via<broker::address>();
+    if (dtype == "subnet")
+      return convert_via<broker::subnet>();
+    if (dtype == "port")
+      return convert_via<broker::port>();
+    if (dtype == "timestamp")
+      return parse_via<broker::timestamp>();
+    if (dtype == "timespan")
+      return parse_via<broker::timespan>();
+    if (dtype == "vector")
+      return convert_sequence(data::type::list, [this] {
+        return convert_object();
+      });
+    if (dtype == "set")
+      return convert_sequence(data::type::set, [this] {
+        return convert_object();
+      });
+    if (dtype == "table")
+      return convert_sequence(data::type::table, [this] {
+        return convert_key_value_pair();
+      });
+    return type_clash();
+  }
+
+  /// Converts a string to `T` with the `convert` API.
+  template <class T>
+  bool convert_via() {
+    return convert_string([this](std::string_view str) {
+      T tmp;
+      if (!convert(std::string{str}, tmp))
+        return false;
+      buf_out() = format::bin::v1::encode_with_tag(tmp, buf_out());
+      return true;
+    });
+  }
+
+  /// Converts a string to `T` with CAF's parser.
+  template <class T>
+  bool parse_via() {
+    return convert_string([this](std::string_view str) {
+      T tmp;
+      if (auto err = caf::detail::parse(str, tmp))
+        return false;
+      buf_out() = format::bin::v1::encode_with_tag(tmp, buf_out());
+      return true;
+    });
+  }
+
+  std::back_insert_iterator<std::vector<std::byte>> buf_out() {
+    return std::back_inserter(buf_);
+  }
+
+  /// Converts a JSON array to a sequence by calling `fn` for each element. The
+  /// size prefix precedes the elements in the binary format. Hence, we reserve
+  /// space for the largest possible prefix and shift the elements afterwards.
+  template <class Fn>
+  bool convert_sequence(data::type tag, Fn fn) {
+    namespace bin_v1 = format::bin::v1;
+    if (peek() != '[')
+      return type_clash();
+    if (++depth_ > max_json_depth)
+      return false;
+    depth_guard guard{depth_};
+    ++pos_;
+    bin_v1::write_unsigned(tag, buf_out());
+    auto offset = buf_.size();
+    buf_.resize(offset + bin_v1::max_varbyte32_size);
+    size_t size = 0;
+    if (!consume(']')) {
+      do {
+        if (!fn())
+          return false;
+        ++size;
+      } while (consume(','));
+      if (!consume(']'))
+        return false;
+    }
+    auto prefix_size = bin_v1::varbyte_size(size);
+    auto gap = bin_v1::max_varbyte32_size - prefix_size;
+    auto* prefix = buf_.data() + offset;
+    bin_v1::write_varbyte(size, prefix);
+    auto* elements = prefix + bin_v1::max_varbyte32_size;
+    auto num_bytes = static_cast<size_t>(buf_.data() + buf_.size() - elements);
+    memmove(prefix + prefix_size, elements, num_bytes);
+    buf_.resize(buf_.size() - gap);
+    return true;
+  }
+
+  /// Converts a JSON object with the fields `key` and `value`.
+  bool convert_key_value_pair() {
+    if (peek() != '{')
+      return type_clash();
+    if (++depth_ > max_json_depth)
+      return false;
+    depth_guard guard{depth_};
+    ++pos_;
+    auto has_key = false;
+    auto has_value = false;
+    const char* value_first = nullptr;
+    const char* value_last = nullptr;
+    if (!consume('}')) {
+      do {
+        std::string_view field;
+        if (!read_string(field, &scratch_) || !consume(':'))
+          return false;
+        if (field == "key" && !has_key) {
+          has_key = true;
+          if (!convert_object())
+            return false;
+          // The binary format requires the key first. Hence, we convert the
+          // value after the key if it came first in the JSON input.
+          if (has_value
+              && !convert_range(value_first, value_last,
+                                [this] { return convert_object(); }))
+            return false;
+        } else if (field == "value" && !has_value) {
+          has_value = true;
+          if (has_key) {
+            if (!convert_object())
+              return false;
+          } else {
+            skip_ws();
+            value_first = pos_;
+            if (!skip_value())
+              return false;
+            value_last = pos_;
+          }
+        } else if (!skip_value()) {
+          return false;
+        }
+      } while (consume(','));
+      if (!consume('}'))
+        return false;
+    }
+    if (!has_key || !has_value)
+      return type_clash();
+    return true;
+  }
+
+  /// Converts a JSON object with the fields `@data-type` and `data`. For the
+  /// top-level object, also reads the fields `type` and `topic` (if present).
+  bool convert_object(std::string* type = nullptr,
+                      std::string* topic = nullptr) {
+    if (peek() != '{')
+      return type_clash();
+    if (++depth_ > max_json_depth)
+      return false;
+    depth_guard guard{depth_};
+    ++pos_;
+    std::string dtype_buf;
+    std::string_view dtype;
+    auto has_dtype = false;
+    auto has_data = false;
+    auto done = false;
+    const char* data_first = nullptr;
+    const char* data_last = nullptr;
+    // Reads the field into `out` if it is a string and skips it otherwise.
+    auto read_string_field = [this](std::string& out) {
+      if (peek() != '"')
+        return skip_value();
+      std::string_view str;
+      if (!read_string(str, &scratch_))
+        return false;
+      out.assign(str.begin(), str.end());
+      return true;
+    };
+    if (!consume('}')) {
+      do {
+        std::string_view field;
+        if (!read_string(field, &scratch_) || !consume(':'))
+          return false;
+        if (field == "@data-type" && !has_dtype) {
+          has_dtype = true;
+          if (peek() != '"')
+            return type_clash();
+          if (!read_string(dtype, &dtype_buf))
+            return false;
+          // The binary format requires the type first. Hence, we convert the
+          // data after reading the type if it came first in the JSON input.
+          if (has_data) {
+            if (!convert_range(data_first, data_last,
+                               [this, dtype] { return convert_data(dtype); }))
+              return false;
+            done = true;
+          }
+        } else if (field == "data" && !has_data) {
+          has_data = true;
+          if (has_dtype) {
+            if (!convert_data(dtype))
+              return false;
+            done = true;
+          } else {
+            skip_ws();
+            data_first = pos_;
+            if (!skip_value())
+              return false;
+            data_last = pos_;
+          }
+        } else if (type != nullptr && field == "type") {
+          if (!read_string_field(*type))
+            return false;
+        } else if (topic != nullptr && field == "topic") {
+          if (!read_string_field(*topic))
+            return false;
+        } else if (!skip_value()) {
+          return false;
+        }
+      } while (consume(','));
+      if (!consume('}'))
+        return false;
+    }
+    if (done)
+      return true;
+    // A `none` value may omit the data field.
+    if (has_dtype && dtype == "none") {
+      format::bin::v1::encode_with_tag(nil, buf_out());
+      return true;
+    }
+    return type_clash();
+  }
+
+  const char* first_;
+  const char* pos_;
+  const char* end_;
+  std::vector<std::byte>& buf_;
+  std::string scratch_;
+  size_t depth_ = 0;
+};
+
 } // namespace
 
 error json::data_message_to_binary(const caf::json_object& obj,
@@ -166,4 +838,19 @@ error json::data_message_to_binary(const caf::json_object& obj,
   return ec::type_clash;
 }
 
+error json::data_message_to_binary(std::string_view str, std::string& type,
+                                   std::string& topic,
+                                   std::vector<std::byte>& buf) {
+  streaming_converter converter{str, buf};
+  if (converter.run(type, topic))
+    return {};
+  // On a type clash, we still need to check whether the input is valid JSON in
+  // order to report the right error.
+  if (converter.code == ec::type_clash && converter.validate())
+    return ec::type_clash;
+  return make_error(ec::invalid_json,
+                    "malformed JSON near offset "
+                      + std::to_string(converter.offset()));
+}
+
 } // namespace broker::internal
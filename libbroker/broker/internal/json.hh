@@ -5,6 +5,8 @@
 #include <caf/fwd.hpp>
 
 #include <cstddef>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace broker::internal {
@@ -16,6 +18,17 @@ public:
   /// representation.
   static error data_message_to_binary(const caf::json_object& obj,
                                       std::vector<std::byte>& buf);
+
+  /// Converts a JSON text that represents a @ref data_message to a binary
+  /// representation in a single pass, i.e., without parsing the text into a
+  /// JSON object first. Stores the `type` and `topic` fields of the message to
+  /// `type` and `topic` if present.
+  /// @returns `ec::invalid_json` if `str` is not valid JSON, `ec::type_clash`
+  ///          if the JSON does not represent Broker data, and a default-
+  ///          constructed error on success.
+  static error data_message_to_binary(std::string_view str, std::string& type,
+                                      std::string& topic,
+                                      std::vector<std::byte>& buf);
 };
 
 } // namespace broker::internal
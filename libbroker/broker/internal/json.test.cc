@@ -160,3 +160,60 @@ TEST(a data message in JSON can be rewritten to the binary format) {
   REQUIRE(maybe_msg);
   CHECK_EQ((*maybe_msg)->value().to_data(), native()->value().to_data());
 }
+
+TEST(a data message in JSON can be rewritten to the binary format directly) {
+  using util = broker::internal::json;
+  auto bin = std::vector<std::byte>{};
+  std::string type;
+  std::string topic;
+  auto err = util::data_message_to_binary(json, type, topic, bin);
+  CHECK(!err);
+  CHECK_EQ(type, "data-message");
+  CHECK_EQ(topic, "/test/cpp/internal/json-type-mapper");
+  auto maybe_msg = data_envelope::deserialize(endpoint_id::nil(),
+                                              endpoint_id::nil(), defaults::ttl,
+                                              topic, bin.data(), bin.size());
+  REQUIRE(maybe_msg);
+  CHECK_EQ((*maybe_msg)->value().to_data(), native()->value().to_data());
+}
+
+TEST(the direct conversion accepts fields in any order) {
+  using util = broker::internal::json;
+  auto bin = std::vector<std::byte>{};
+  std::string type;
+  std::string topic;
+  auto input = R"_({"data": [{"value": {"data": 1, "@data-type": "count"},
+                              "key": {"@data-type": "string", "data": "a"}}],
+                    "@data-type": "table", "topic": "/foo",
+                    "type": "data-message"})_";
+  auto err = util::data_message_to_binary(input, type, topic, bin);
+  CHECK(!err);
+  CHECK_EQ(topic, "/foo");
+  auto maybe_msg = data_envelope::deserialize(endpoint_id::nil(),
+                                              endpoint_id::nil(), defaults::ttl,
+                                              topic, bin.data(), bin.size());
+  REQUIRE(maybe_msg);
+  auto expected = table{{data{std::string{"a"}}, data{count{1}}}};
+  CHECK_EQ((*maybe_msg)->value().to_data(), data{expected});
+}
+
+TEST(the direct conversion distinguishes malformed JSON from invalid data) {
+  using util = broker::internal::json;
+  auto bin = std::vector<std::byte>{};
+  std::string type;
+  std::string topic;
+  CHECK_EQ(util::data_message_to_binary(R"_({"foo": "bar"})_", type, topic,
+                                        bin),
+           ec::type_clash);
+  bin.clear();
+  CHECK_EQ(util::data_message_to_binary(R"_({"@data-type":"count","data":-1})_",
+                                        type, topic, bin),
+           ec::type_clash);
+  bin.clear();
+  CHECK_EQ(util::data_message_to_binary(R"_({"@data-type":"count","data":1)_",
+                                        type, topic, bin),
+           ec::invalid_json);
+  bin.clear();
+  CHECK_EQ(util::data_message_to_binary("this is not json!", type, topic, bin),
+           ec::invalid_json);
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "broker/internal/flow_sub.hh"
+#include "broker/time.hh"
+
+#include <caf/cow_string.hpp>
+#include <caf/disposable.hpp>
+#include <caf/flow/op/cold.hpp>
+#include <caf/intrusive_ptr.hpp>
+#include <caf/scheduled_actor.hpp>
+#include <caf/sec.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace broker::internal {
+
+/// Splits JSON arrays into their elements to allow clients to publish batches
+/// of data messages in a single WebSocket frame. Forwards all other inputs
+/// unchanged. Malformed arrays pass through unchanged as well and the parser
+/// reports the error later.
+struct split_batch_step {
+  using input_type = caf::cow_string;
+
+  using output_type = caf::cow_string;
+
+  template <class Next, class... Steps>
+  bool on_next(const input_type& item, Next& next, Steps&... steps) {
+    const auto& str = item.str();
+    auto first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos || str[first] != '[')
+      return next.on_next(item, steps...);
+    std::vector<std::string_view> elements;
+    if (!split(std::string_view{str}.substr(first + 1), elements))
+      return next.on_next(item, steps...);
+    for (auto element : elements)
+      if (!next.on_next(caf::cow_string{std::string{element}}, steps...))
+        return false;
+    return true;
+  }
+
+  template <class Next, class... Steps>
+  void on_complete(Next& next, Steps&... steps) {
+    next.on_complete(steps...);
+  }
+
+  template <class Next, class... Steps>
+  void on_error(const caf::error& what, Next& next, Steps&... steps) {
+    next.on_error(what, steps...);
+  }
+
+  /// Splits the content of a JSON array at its top-level commas.
+  /// @pre `str` starts right after the opening bracket.
+  static bool split(std::string_view str, std::vector<std::string_view>& out) {
+    size_t depth = 0;
+    size_t begin = 0;
+    bool in_string = false;
+    for (size_t pos = 0; pos < str.size(); ++pos) {
+      auto ch = str[pos];
+      if (in_string) {
+        if (ch == '\\')
+          ++pos;
+        else if (ch == '"')
+          in_string = false;
+        continue;
+      }
+      switch (ch) {
+        case '"':
+          in_string = true;
+          break;
+        case '{':
+        case '[':
+          ++depth;
+          break;
+        case '}':
+          if (depth-- == 0)
+            return false;
+          break;
+        case ']':
+          if (depth == 0) {
+            if (auto element = str.substr(begin, pos - begin);
+                element.find_first_not_of(" \t\r\n") != std::string::npos)
+              out.push_back(element);
+            return str.find_first_not_of(" \t\r\n", pos + 1)
+                   == std::string::npos;
+          }
+          --depth;
+          break;
+        case ',':
+          if (depth == 0) {
+            out.push_back(str.substr(begin, pos - begin));
+            begin = pos + 1;
+          }
+          break;
+        default:
+          break;
+      }
+    }
+    return false;
+  }
+};
+
+/// Combines up to `max_size` JSON messages into a single JSON array. Emits
+/// partial batches after `timeout`.
+class json_batch_sub : public flow_sub<caf::cow_string> {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using super = flow_sub<caf::cow_string>;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  json_batch_sub(caf::scheduled_actor* self,
+                 caf::flow::observer<caf::cow_string> out, size_t max_size,
+                 timespan timeout)
+    : super(self, std::move(out), max_size),
+      self_(self),
+      max_size_(max_size),
+      timeout_(timeout) {
+    // nop
+  }
+
+  // -- implementation of observer_impl<caf::cow_string> -----------------------
+
+  void on_next(const caf::cow_string& item) override {
+    if (!out_)
+      return;
+    buf_ += count_ == 0 ? '[' : ',';
+    buf_ += item.str();
+    if (++count_ == max_size_) {
+      flush();
+    } else if (count_ == 1) {
+      using ptr_t = caf::intrusive_ptr<json_batch_sub>;
+      timer_ = self_->run_delayed(timeout_, [ptr = ptr_t{this}] { //
+        ptr->flush();
+      });
+    }
+  }
+
+  void on_complete() override {
+    in_ = nullptr;
+    completed_ = true;
+    flush();
+  }
+
+  // -- implementation of subscription_impl ------------------------------------
+
+  void request(size_t n) override {
+    demand_ += n;
+    if (count_ > 0 || completed_) {
+      using ptr_t = caf::intrusive_ptr<json_batch_sub>;
+      self_->delay_fn([ptr = ptr_t{this}] { ptr->flush(); });
+    }
+  }
+
+protected:
+  void clear() override {
+    timer_.dispose();
+    buf_.clear();
+    count_ = 0;
+  }
+
+private:
+  /// Emits the pending batch if the observer has demand for it. Otherwise, the
+  /// batch waits for the next call to `request`. Since we only request
+  /// `max_size` items at a time, waiting also stops the input.
+  void flush() {
+    if (!out_)
+      return;
+    if (count_ > 0) {
+      if (demand_ == 0)
+        return;
+      --demand_;
+      timer_.dispose();
+      buf_ += ']';
+      auto n = count_;
+      count_ = 0;
+      out_.on_next(caf::cow_string{std::move(buf_)});
+      buf_.clear();
+      if (in_)
+        in_.request(n);
+    }
+    if (completed_ && count_ == 0)
+      complete_out();
+  }
+
+  caf::scheduled_actor* self_;
+  size_t max_size_;
+  timespan timeout_;
+  caf::disposable timer_;
+  std::string buf_;
+  size_t count_ = 0;
+};
+
+/// Flow operator that applies @ref json_batch_sub to its input.
+class json_batch : public caf::flow::op::cold<caf::cow_string> {
+public:
+  using super = caf::flow::op::cold<caf::cow_string>;
+
+  using decorated_type = caf::flow::observable<caf::cow_string>;
+
+  json_batch(caf::scheduled_actor* self, decorated_type decorated,
+             size_t max_size, timespan timeout)
+    : super(self),
+      self_(self),
+      decorated_(std::move(decorated)),
+      max_size_(max_size),
+      timeout_(timeout) {
+    // nop
+  }
+
+  caf::disposable subscribe(caf::flow::observer<caf::cow_string> out) override {
+    if (!decorated_) {
+      out.on_error(make_error(caf::sec::too_many_observers,
+                              "json_batch may only be subscribed to once"));
+      return {};
+    }
+    auto sub = caf::make_counted<json_batch_sub>(self_, out, max_size_,
+                                                 timeout_);
+    out.on_subscribe(caf::flow::subscription{sub});
+    decorated_.subscribe(caf::flow::observer<caf::cow_string>{sub});
+    decorated_ = nullptr;
+    return sub->as_disposable();
+  }
+
+private:
+  caf::scheduled_actor* self_;
+  decorated_type decorated_;
+  size_t max_size_;
+  timespan timeout_;
+};
+
+} // namespace broker::internal
@@ -0,0 +1,110 @@
+#include "broker/internal/json_batch.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <caf/flow/item_publisher.hpp>
+#include <caf/scheduled_actor/flow.hpp>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace broker;
+using namespace std::literals;
+
+namespace {
+
+using string_list = std::vector<std::string>;
+
+using string_list_ptr = std::shared_ptr<string_list>;
+
+// Sends each incoming string through a json_batch and stores the batches.
+caf::behavior batcher_impl(caf::event_based_actor* self, string_list_ptr buf,
+                           size_t max_size, timespan timeout) {
+  using publisher_type = caf::flow::item_publisher<caf::cow_string>;
+  auto pub = std::make_shared<publisher_type>(self);
+  auto ptr = caf::make_counted<internal::json_batch>(self,
+                                                     pub->as_observable(),
+                                                     max_size, timeout);
+  caf::flow::observable<caf::cow_string>{ptr}.for_each(
+    [buf](const caf::cow_string& str) { buf->emplace_back(str.str()); });
+  return {
+    [pub](const std::string& str) { pub->push(caf::cow_string{str}); },
+  };
+}
+
+// Splits the JSON array `str` or returns a single "<error>" element.
+string_list split(std::string_view str) {
+  std::vector<std::string_view> elements;
+  string_list result;
+  if (!internal::split_batch_step::split(str.substr(1), elements)) {
+    result.emplace_back("<error>");
+    return result;
+  }
+  for (auto element : elements)
+    result.emplace_back(element);
+  return result;
+}
+
+struct fixture : base_fixture {
+  string_list_ptr buf = std::make_shared<string_list>();
+
+  caf::actor uut;
+
+  void init(size_t max_size, timespan timeout) {
+    uut = sys.spawn(batcher_impl, buf, max_size, timeout);
+    run();
+  }
+
+  ~fixture() override {
+    if (uut)
+      caf::anon_send_exit(uut, caf::exit_reason::user_shutdown);
+    run();
+  }
+
+  void push(std::initializer_list<const char*> items) {
+    for (auto item : items)
+      caf::anon_send(uut, std::string{item});
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(json_batch_tests, fixture)
+
+TEST(split_batch_step splits arrays at their top level commas) {
+  CHECK_EQUAL(split("[1,2,3]"), string_list({"1", "2", "3"}));
+  CHECK_EQUAL(split(R"([{"a":[1,2]}, "x,y"])"),
+              string_list({R"({"a":[1,2]})", R"( "x,y")"}));
+  CHECK_EQUAL(split(R"(["a\"],b", 1])"), string_list({R"("a\"],b")", " 1"}));
+  CHECK_EQUAL(split("[]"), string_list({}));
+  CHECK_EQUAL(split("[ ]"), string_list({}));
+  CHECK_EQUAL(split("[1] \n"), string_list({"1"}));
+}
+
+TEST(split_batch_step rejects malformed arrays) {
+  CHECK_EQUAL(split("[1,2"), string_list({"<error>"}));
+  CHECK_EQUAL(split("[1}]"), string_list({"<error>"}));
+  CHECK_EQUAL(split("[1] 2"), string_list({"<error>"}));
+  CHECK_EQUAL(split(R"(["unterminated])"), string_list({"<error>"}));
+}
+
+TEST(json_batch combines up to max_size messages per batch) {
+  init(3, timespan{1s});
+  push({"1", "2", "3", "4", "5", "6"});
+  run();
+  CHECK_EQUAL(*buf, string_list({"[1,2,3]", "[4,5,6]"}));
+}
+
+TEST(json_batch emits partial batches after the timeout) {
+  init(3, timespan{1s});
+  push({"1", "2"});
+  expect((std::string), from(_).to(uut));
+  expect((std::string), from(_).to(uut));
+  CHECK(buf->empty());
+  run();
+  CHECK_EQUAL(*buf, string_list({"[1,2]"}));
+}
+
+FIXTURE_SCOPE_END()
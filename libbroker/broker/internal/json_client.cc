@@ -7,12 +7,17 @@
 #include "broker/expected.hh"
 #include "broker/format/json.hh"
 #include "broker/internal/json.hh"
+#include "broker/internal/json_batch.hh"
 #include "broker/internal/type_id.hh"
+#include "broker/internal/web_socket.hh"
+#include "broker/internal/wire_format.hh"
 #include "broker/version.hh"
+#include "broker/zeek.hh"
 
 #include <caf/cow_string.hpp>
 #include <caf/cow_tuple.hpp>
 #include <caf/event_based_actor.hpp>
+#include <caf/json_array.hpp>
 #include <caf/json_object.hpp>
 #include <caf/json_value.hpp>
 #include <caf/scheduled_actor/flow.hpp>
@@ -24,6 +29,77 @@ namespace broker::internal {
 
 namespace {
 
+/// Parses a JSON array of non-negative integers.
+bool parse_index_path(const caf::json_value& val,
+                      event_projection::index_path& path) {
+  if (!val.is_array())
+    return false;
+  for (auto index : val.to_array()) {
+    if (!index.is_integer() || index.to_integer() < 0)
+      return false;
+    path.push_back(static_cast<size_t>(index.to_integer()));
+  }
+  return !path.empty();
+}
+
+/// Parses a data value in Broker's JSON representation.
+bool parse_data_value(const caf::json_value& val, std::optional<data>& result) {
+  if (!val.is_object())
+    return false;
+  std::vector<std::byte> buf;
+  if (json::data_message_to_binary(val.to_object(), buf))
+    return false;
+  auto msg = data_envelope::deserialize(endpoint_id::nil(), endpoint_id::nil(),
+                                        defaults::ttl, "", buf.data(),
+                                        buf.size());
+  if (!msg)
+    return false;
+  result = (*msg)->value().to_data();
+  return true;
+}
+
+/// Returns the value at `path` or `nil` if the path doesn't exist.
+variant resolve(const variant_list& args,
+                const event_projection::index_path& path) {
+  auto result = args.at(path.front());
+  for (size_t i = 1; i < path.size(); ++i) {
+    if (!result.is_list())
+      return variant{};
+    result = result.to_list().at(path[i]);
+  }
+  return result;
+}
+
+/// Parses the extended handshake, i.e., a JSON object with the fields
+/// `subscriptions` (mandatory), `batch-size`, `batch-timeout-us`, `projection`
+/// and `predicate` (optional).
+bool parse_handshake_object(std::string_view str, filter_type& filter,
+                            json_client_state& state) {
+  auto val = caf::json_value::parse(str);
+  if (!val || !val->is_object())
+    return false;
+  auto obj = val->to_object();
+  auto subs = obj.value("subscriptions");
+  if (!subs.is_array())
+    return false;
+  for (auto sub : subs.to_array()) {
+    if (!sub.is_string())
+      return false;
+    filter.emplace_back(std::string{sub.to_string()});
+  }
+  if (auto size = obj.value("batch-size"); size.is_integer()) {
+    if (size.to_integer() < 0)
+      return false;
+    state.batch_size = static_cast<size_t>(size.to_integer());
+  }
+  if (auto timeout = obj.value("batch-timeout-us"); timeout.is_integer()) {
+    if (timeout.to_integer() <= 0)
+      return false;
+    state.batch_timeout = std::chrono::microseconds{timeout.to_integer()};
+  }
+  return state.projection.parse(obj);
+}
+
 /// Catches errors by converting them into complete events instead.
 struct handshake_step {
   using input_type = caf::cow_string;
@@ -56,7 +132,8 @@ struct handshake_step {
     } else {
       filter_type filter;
       state->reader.load(item.str());
-      if (!state->reader.apply(filter)) {
+      if (!state->reader.apply(filter)
+          && !parse_handshake_object(item.str(), filter, *state)) {
         // Received malformed input: drop remaining input and quit.
         auto err = caf::make_error(caf::sec::invalid_argument,
                                    "first message must contain a filter");
@@ -86,14 +163,53 @@ struct handshake_step {
 
 } // namespace
 
+bool event_projection::parse(const caf::json_object& obj) {
+  if (auto xs = obj.value("projection"); xs.is_array()) {
+    for (auto path : xs.to_array())
+      if (!parse_index_path(path, paths.emplace_back()))
+        return false;
+  }
+  if (auto pred = obj.value("predicate"); pred.is_object()) {
+    auto pred_obj = pred.to_object();
+    if (!parse_index_path(pred_obj.value("path"), predicate_path)
+        || !parse_data_value(pred_obj.value("value"), predicate_value))
+      return false;
+  }
+  return true;
+}
+
+data_envelope_ptr event_projection::apply(const data_envelope_ptr& msg) const {
+  if (paths.empty() && !predicate_value)
+    return msg;
+  auto val = msg->value();
+  if (zeek::Message::type(val) != zeek::Message::Event)
+    return msg;
+  zeek::Event ev{val};
+  if (!ev.valid())
+    return msg;
+  auto args = ev.args();
+  if (predicate_value && *predicate_value != resolve(args, predicate_path))
+    return nullptr;
+  if (paths.empty())
+    return msg;
+  list_builder xs;
+  for (const auto& path : paths)
+    xs.add(resolve(args, path));
+  auto ts = ev.ts();
+  auto res = ts ? zeek::Event{ev.name(), xs, *ts} : zeek::Event{ev.name(), xs};
+  return data_envelope::make(msg->topic(), res.move_data());
+}
+
 json_client_state::json_client_state(caf::event_based_actor* selfptr,
                                      endpoint_id this_node, caf::actor core_hdl,
-                                     network_info ws_addr, in_t in, out_t out)
+                                     network_info ws_addr, in_t in, out_t out,
+                                     bool binary_mode)
   : self(selfptr),
     id(this_node),
     core(std::move(core_hdl)),
     addr(std::move(ws_addr)),
-    ctrl_msgs(selfptr) {
+    ctrl_msgs(selfptr),
+    binary(binary_mode) {
   reader.mapper(&mapper);
   using caf::cow_string;
   using caf::flow::observable;
@@ -112,6 +228,7 @@ json_client_state::json_client_state(caf::event_based_actor* selfptr,
     ->make_observable()
     .from_resource(std::move(in)) // Read all input text messages.
     .transform(handshake_step{this, std::move(out), core_pull}) // Calls init().
+    .transform(split_batch_step{})
     .do_finally([this] { ctrl_msgs.close(); })
     // Parse all JSON coming in and forward them to the core.
     .map([this, n = 0](const caf::cow_string& cow_str) mutable {
@@ -123,23 +240,51 @@ json_client_state::json_client_state(caf::event_based_actor* selfptr,
         auto json = render_error(enum_str(ec::deserialization_failed), ctx);
         ctrl_msgs.push(caf::cow_string{std::move(json)});
       };
-      // Parse the received JSON.
-      auto val = caf::json_value::parse_shallow(cow_str.str());
-      if (!val) {
-        send_error("contained malformed JSON -> ", to_string(val.error()));
-        return data_envelope_ptr{};
+      // Binary frames carry envelopes in Broker's native format. Only clients
+      // on the binary endpoint may send them.
+      const auto& str = cow_str.str();
+      if (binary && !str.empty()
+          && str.front() == web_socket::binary_frame_tag) {
+        auto bytes = reinterpret_cast<const std::byte*>(str.data()) + 1;
+        auto res = envelope::deserialize(bytes, str.size() - 1);
+        if (!res) {
+          send_error("contained invalid data -> ", to_string(res.error()));
+          return data_envelope_ptr{};
+        }
+        if ((*res)->type() != envelope_type::data) {
+          send_error("contained an envelope that is not a data message");
+          return data_envelope_ptr{};
+        }
+        auto [payload, payload_size] = (*res)->raw_bytes();
+        auto maybe_msg = data_envelope::deserialize(id, endpoint_id::nil(),
+                                                    defaults::ttl,
+                                                    (*res)->topic(), payload,
+                                                    payload_size);
+        if (!maybe_msg) {
+          send_error("caused an internal error -> ",
+                     to_string(maybe_msg.error()));
+          return data_envelope_ptr{};
+        }
+        return std::move(*maybe_msg);
       }
-      auto obj = val->to_object();
-      // Try to convert the JSON to our internal representation.
+      // Convert the received JSON to our internal representation.
       buf.clear();
-      if (auto err = internal::json::data_message_to_binary(obj, buf)) {
+      std::string type;
+      std::string topic;
+      auto err = internal::json::data_message_to_binary(cow_str.str(), type,
+                                                        topic, buf);
+      if (err == ec::invalid_json) {
+        send_error("contained malformed JSON -> ", to_string(err));
+        return data_envelope_ptr{};
+      }
+      if (err) {
         send_error("contained invalid data");
         return data_envelope_ptr{};
       }
       // Turn the binary data into a data envelope.
-      auto maybe_msg = data_envelope::deserialize(
-        id, endpoint_id::nil(), defaults::ttl,
-        caf::to_string(obj.value("topic").to_string()), buf.data(), buf.size());
+      auto maybe_msg = data_envelope::deserialize(id, endpoint_id::nil(),
+                                                  defaults::ttl, topic,
+                                                  buf.data(), buf.size());
       if (!maybe_msg) {
         send_error("caused an internal error -> ",
                    to_string(maybe_msg.error()));
@@ -159,8 +304,8 @@ json_client_state::~json_client_state() {
 std::string json_client_state::render_error(std::string_view code,
                                             std::string_view context) {
   using format::json::v1::append_field;
-  json_buf.clear();
-  auto out = std::back_inserter(json_buf);
+  std::string result;
+  auto out = std::back_inserter(result);
   *out++ = '{';
   out = append_field("type", "error", out);
   *out++ = ',';
@@ -168,13 +313,13 @@ std::string json_client_state::render_error(std::string_view code,
   *out++ = ',';
   out = append_field("context", context, out);
   *out++ = '}';
-  return std::string{json_buf.data(), json_buf.size()};
+  return result;
 }
 
 std::string json_client_state::render_ack() {
   using format::json::v1::append_field;
-  json_buf.clear();
-  auto out = std::back_inserter(json_buf);
+  std::string result;
+  auto out = std::back_inserter(result);
   *out++ = '{';
   out = append_field("type", "ack", out);
   *out++ = ',';
@@ -182,7 +327,7 @@ std::string json_client_state::render_ack() {
   *out++ = ',';
   out = append_field("version", version::string(), out);
   *out++ = '}';
-  return std::string{json_buf.data(), json_buf.size()};
+  return result;
 }
 
 void json_client_state::init(
@@ -194,15 +339,38 @@ void json_client_state::init(
     // Note: structured bindings with values confuses clang-tidy's leak checker.
     auto resources = make_spsc_buffer_resource<data_envelope_ptr>();
     auto& [core_pull2, core_push2] = resources;
+    // Note: the cow_string takes ownership of the std::string we render into.
+    //       Hence, each message costs a single allocation per client.
     auto core_json = //
       self->make_observable()
         .from_resource(core_pull2)
-        .map([this](const data_envelope_ptr& msg) -> caf::cow_string {
-          json_buf.clear();
-          format::json::v1::encode(msg, std::back_inserter(json_buf));
-          return caf::cow_string{std::string{json_buf.begin(), json_buf.end()}};
+        .map([this](const data_envelope_ptr& in) -> caf::cow_string {
+          // Note: an empty string drops the message in the filter below.
+          auto msg = projection.apply(in);
+          if (!msg)
+            return caf::cow_string{};
+          if (binary) {
+            bin_buf.clear();
+            if (!wire_format::v1::trait{}.convert(msg, bin_buf))
+              return caf::cow_string{};
+            std::string str;
+            str.reserve(bin_buf.size() + 1);
+            str.push_back(web_socket::binary_frame_tag);
+            auto first = reinterpret_cast<const char*>(bin_buf.data());
+            str.insert(str.end(), first, first + bin_buf.size());
+            return caf::cow_string{std::move(str)};
+          }
+          // Note: the envelope caches its JSON rendering. Clients that receive
+          // the same envelope only copy the string.
+          return caf::cow_string{std::string{msg->to_json()}};
         })
+        .filter([](const caf::cow_string& str) { return !str.str().empty(); })
         .as_observable();
+    if (batch_size > 1 && !binary) {
+      auto ptr = caf::make_counted<json_batch>(self, std::move(core_json),
+                                               batch_size, batch_timeout);
+      core_json = caf::flow::observable<caf::cow_string>{ptr};
+    }
     auto sub = ctrl_msgs.as_observable().merge(core_json).subscribe(out);
     subscriptions.push_back(std::move(sub));
     caf::anon_send(core, atom::attach_client_v, addr, "web-socket"s, filter,
@@ -1,23 +1,58 @@
 #pragma once
 
+#include "broker/data.hh"
+#include "broker/data_envelope.hh"
+#include "broker/defaults.hh"
 #include "broker/endpoint_id.hh"
 #include "broker/filter_type.hh"
 #include "broker/internal/json_type_mapper.hh"
 #include "broker/message.hh"
 #include "broker/network_info.hh"
+#include "broker/time.hh"
 
 #include <caf/actor.hpp>
+#include <caf/byte_buffer.hpp>
 #include <caf/async/spsc_buffer.hpp>
 #include <caf/fwd.hpp>
+#include <caf/json_object.hpp>
 #include <caf/json_reader.hpp>
 #include <caf/scheduled_actor/flow.hpp>
 #include <caf/scheduler/test_coordinator.hpp>
 
+#include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace broker::internal {
 
+/// Filters Zeek events and selects the arguments that a JSON client receives.
+struct event_projection {
+  /// Selects a value inside the arguments of a Zeek event by index. Each
+  /// index beyond the first selects an element of a nested list.
+  using index_path = std::vector<size_t>;
+
+  /// Selects the event arguments the client receives. Empty if the client
+  /// receives all arguments.
+  std::vector<index_path> paths;
+
+  /// Selects the event argument for `predicate_value`.
+  index_path predicate_path;
+
+  /// If set, the client only receives events with an argument at
+  /// `predicate_path` that is equal to this value.
+  std::optional<data> predicate_value;
+
+  /// Reads the optional fields `projection` and `predicate` of a handshake
+  /// object. Returns `false` if either field is malformed.
+  bool parse(const caf::json_object& obj);
+
+  /// Applies `paths` and `predicate_value` to Zeek events. Returns `msg`
+  /// unchanged for all other messages or `nullptr` if the predicate rejects
+  /// the event.
+  data_envelope_ptr apply(const data_envelope_ptr& msg) const;
+};
+
 class json_client_state {
 public:
   static inline const char* name = "broker.json-client";
@@ -27,7 +62,8 @@ public:
   using out_t = caf::async::producer_resource<caf::cow_string>;
 
   json_client_state(caf::event_based_actor* selfptr, endpoint_id this_node,
-                    caf::actor core, network_info addr, in_t in, out_t out);
+                    caf::actor core, network_info addr, in_t in, out_t out,
+                    bool binary_mode = false);
 
   ~json_client_state();
 
@@ -46,7 +82,21 @@ public:
   caf::json_reader reader;
   std::vector<caf::disposable> subscriptions;
   caf::flow::item_publisher<caf::cow_string> ctrl_msgs;
-  std::vector<char> json_buf;
+  caf::byte_buffer bin_buf;
+
+  /// Stores whether the client exchanges data messages in Broker's binary
+  /// format instead of JSON.
+  bool binary;
+
+  /// Maximum number of data messages per WebSocket frame. Values above 1
+  /// enable batching, i.e., the client receives JSON arrays of messages.
+  size_t batch_size = 0;
+
+  /// Maximum time a message waits for its batch to fill up.
+  timespan batch_timeout = defaults::web_socket::batch_timeout;
+
+  /// Filters and projects the Zeek events for the client.
+  event_projection projection;
 
   static std::string_view default_serialization_failed_error();
 
@@ -0,0 +1,104 @@
+#include "broker/internal/json_client.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <caf/json_value.hpp>
+
+#include <string_view>
+
+#include "broker/zeek.hh"
+
+using namespace broker;
+using namespace std::literals;
+
+using internal::event_projection;
+
+namespace {
+
+using index_path = event_projection::index_path;
+
+using path_list = std::vector<index_path>;
+
+// Parses the handshake object `str` into a projection.
+std::optional<event_projection> parse(std::string_view str) {
+  auto val = caf::json_value::parse(str);
+  if (!val || !val->is_object()) {
+    FAIL("invalid JSON object: " << str);
+  }
+  event_projection result;
+  if (!result.parse(val->to_object()))
+    return std::nullopt;
+  return result;
+}
+
+data_message make_event(const vector& args) {
+  zeek::Event ev{"ev", args, timestamp{12s}};
+  return data_envelope::make("/test", ev.move_data());
+}
+
+} // namespace
+
+TEST(event projections parse paths and predicates) {
+  auto uut = parse(R"({
+    "subscriptions": ["/test"],
+    "projection": [[0], [2, 1]],
+    "predicate": {"path": [1], "value": {"@data-type": "count", "data": 42}}
+  })");
+  REQUIRE(uut);
+  CHECK_EQUAL(uut->paths, path_list({{0}, {2, 1}}));
+  CHECK_EQUAL(uut->predicate_path, index_path({1}));
+  REQUIRE(uut->predicate_value);
+  CHECK_EQUAL(*uut->predicate_value, data{count{42}});
+}
+
+TEST(event projections are optional) {
+  auto uut = parse(R"({"subscriptions": ["/test"]})");
+  REQUIRE(uut);
+  CHECK(uut->paths.empty());
+  CHECK(!uut->predicate_value);
+}
+
+TEST(event projections reject malformed paths and predicates) {
+  CHECK(!parse(R"({"projection": [[-1]]})"));
+  CHECK(!parse(R"({"projection": [[]]})"));
+  CHECK(!parse(R"({"projection": [0]})"));
+  CHECK(!parse(R"({"projection": [["0"]]})"));
+  CHECK(!parse(R"({"predicate": {"path": [0]}})"));
+  CHECK(!parse(R"({"predicate": {"value": {"@data-type": "none"}}})"));
+  CHECK(!parse(R"({"predicate": {"path": [0], "value": 42}})"));
+  CHECK(!parse(R"({"predicate": {"path": [0], "value": {"data": 42}}})"));
+}
+
+TEST(event projections select the arguments of events) {
+  auto uut = parse(R"({"projection": [[2, 1], [0], [5], [0, 1]]})");
+  REQUIRE(uut);
+  auto msg = make_event(vector{count{1}, "x", vector{count{2}, count{3}}});
+  auto res = uut->apply(msg);
+  REQUIRE(res);
+  CHECK_EQUAL(res->topic(), "/test");
+  zeek::Event ev{res};
+  REQUIRE(ev.valid());
+  CHECK_EQUAL(ev.name(), "ev");
+  CHECK_EQUAL(ev.ts(), timestamp{12s});
+  CHECK_EQUAL(ev.args(), vector({count{3}, count{1}, data{}, data{}}));
+}
+
+TEST(event projections drop events that fail the predicate) {
+  auto uut = parse(R"({
+    "predicate": {"path": [1], "value": {"@data-type": "string", "data": "x"}}
+  })");
+  REQUIRE(uut);
+  auto match = make_event(vector{count{1}, "x"});
+  auto mismatch = make_event(vector{count{1}, "y"});
+  auto missing = make_event(vector{count{1}});
+  CHECK(uut->apply(match) == match);
+  CHECK(uut->apply(mismatch) == nullptr);
+  CHECK(uut->apply(missing) == nullptr);
+}
+
+TEST(event projections pass other messages unchanged) {
+  auto uut = parse(R"({"projection": [[0]]})");
+  REQUIRE(uut);
+  auto msg = data_envelope::make("/test", data{"hello"});
+  CHECK(uut->apply(msg) == msg);
+}
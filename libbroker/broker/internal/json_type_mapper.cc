@@ -2,6 +2,9 @@
 
 #include "broker/internal/type_id.hh"
 
+#include <array>
+#include <cstdint>
+
 namespace broker::internal {
 
 namespace {
@@ -30,19 +33,79 @@ constexpr tbl_entry tbl[] = {
   {caf::type_id_v<vector>, "vector"},
 };
 
+constexpr size_t tbl_size = std::size(tbl);
+
+/// Marks an empty slot in the lookup tables.
+constexpr uint8_t no_entry = 0xFF;
+
+// -- type ID to name ----------------------------------------------------------
+
+constexpr caf::type_id_t max_type_id() {
+  caf::type_id_t result = 0;
+  for (const auto& entry : tbl)
+    if (entry.type > result)
+      result = entry.type;
+  return result;
+}
+
+/// Maps each type ID up to the largest ID in `tbl` to its index in `tbl`.
+constexpr auto by_type = [] {
+  std::array<uint8_t, max_type_id() + 1> result{};
+  for (auto& slot : result)
+    slot = no_entry;
+  for (size_t i = 0; i < tbl_size; ++i)
+    result[tbl[i].type] = static_cast<uint8_t>(i);
+  return result;
+}();
+
+// -- name to type ID ----------------------------------------------------------
+
+/// Number of slots in the hash table for the names. Must be a power of two.
+constexpr size_t name_slots = 32;
+
+/// Hashes the first character, the last character and the length of `name`.
+/// No two names in `tbl` share the same hash value (see below).
+constexpr size_t name_hash(caf::string_view name) {
+  if (name.empty())
+    return 0;
+  auto first = static_cast<unsigned char>(name.front());
+  auto last = static_cast<unsigned char>(name.back());
+  return (first * 3u + last * 2u + name.size()) & (name_slots - 1);
+}
+
+/// Maps the hash of each name in `tbl` to its index in `tbl`.
+constexpr auto by_name = [] {
+  std::array<uint8_t, name_slots> result{};
+  for (auto& slot : result)
+    slot = no_entry;
+  for (size_t i = 0; i < tbl_size; ++i)
+    result[name_hash(tbl[i].name)] = static_cast<uint8_t>(i);
+  return result;
+}();
+
+constexpr bool name_hash_is_perfect() {
+  for (size_t i = 0; i < tbl_size; ++i)
+    if (by_name[name_hash(tbl[i].name)] != i)
+      return false;
+  return true;
+}
+
+static_assert(name_hash_is_perfect(),
+              "name_hash must map each name in tbl to a distinct slot");
+
 } // namespace
 
 caf::string_view json_type_mapper::operator()(caf::type_id_t type) const {
-  for (auto& entry : tbl)
-    if (entry.type == type)
-      return entry.name;
+  if (type < by_type.size())
+    if (auto index = by_type[type]; index != no_entry)
+      return tbl[index].name;
   return caf::query_type_name(type);
 }
 
 caf::type_id_t json_type_mapper::operator()(caf::string_view name) const {
-  for (auto& entry : tbl)
-    if (entry.name == name)
-      return entry.type;
+  if (auto index = by_name[name_hash(name)];
+      index != no_entry && tbl[index].name == name)
+    return tbl[index].type;
   return caf::query_type_id(name);
 }
 
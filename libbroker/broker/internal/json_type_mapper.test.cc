@@ -2,6 +2,8 @@
 
 #include "broker/broker-test.test.hh"
 
+#include "broker/internal/type_id.hh"
+
 #include <caf/json_reader.hpp>
 #include <caf/json_writer.hpp>
 
@@ -175,3 +177,24 @@ TEST(the JSON mapper enables custom type names in JSON output) {
   else
     auto str = to_string(writer.str());
 }
+
+TEST(the JSON mapper translates in both directions) {
+  internal::json_type_mapper mapper;
+  auto check_roundtrip = [&mapper](caf::type_id_t type, caf::string_view name) {
+    CHECK_EQ(mapper(type), name);
+    CHECK_EQ(mapper(name), type);
+  };
+  check_roundtrip(caf::type_id_v<data_message>, "data-message");
+  check_roundtrip(caf::type_id_v<none>, "none");
+  check_roundtrip(caf::type_id_v<count>, "count");
+  check_roundtrip(caf::type_id_v<std::string>, "string");
+  check_roundtrip(caf::type_id_v<subnet>, "subnet");
+  check_roundtrip(caf::type_id_v<timestamp>, "timestamp");
+  check_roundtrip(caf::type_id_v<timespan>, "timespan");
+  check_roundtrip(caf::type_id_v<vector>, "vector");
+  // Other types use the names of CAF.
+  CHECK_EQ(mapper(caf::type_id_v<int32_t>), caf::query_type_name(
+                                              caf::type_id_v<int32_t>));
+  CHECK_EQ(mapper("int32_t"), caf::query_type_id("int32_t"));
+  CHECK_EQ(mapper("no-such-type"), caf::invalid_type_id);
+}
@@ -0,0 +1,93 @@
+#include "broker/internal/log_histogram.hh"
+
+#include <cmath>
+#include <limits>
+
+namespace broker::internal {
+
+// -- constructors, destructors, and assignment operators ----------------------
+
+log_histogram::log_histogram(double resolution) noexcept
+  : resolution_(resolution), count_(0) {
+  for (auto& x : counts_)
+    x.store(0, std::memory_order_relaxed);
+}
+
+// -- modifiers ----------------------------------------------------------------
+
+void log_histogram::observe(double value, uint64_t n) noexcept {
+  constexpr auto max_units = std::numeric_limits<uint64_t>::max();
+  uint64_t units = 0;
+  if (auto scaled = value / resolution_; scaled >= 1) {
+    // Comparing against 2^64 as double avoids undefined behavior when
+    // converting values that exceed the range of uint64_t.
+    if (scaled >= 18446744073709551616.0)
+      units = max_units;
+    else
+      units = static_cast<uint64_t>(scaled);
+  }
+  counts_[index_of(units)].fetch_add(n, std::memory_order_relaxed);
+  count_.fetch_add(n, std::memory_order_relaxed);
+}
+
+void log_histogram::merge(const log_histogram& other) noexcept {
+  for (size_t index = 0; index < bucket_count; ++index)
+    if (auto n = other.count_at(index); n > 0)
+      counts_[index].fetch_add(n, std::memory_order_relaxed);
+  count_.fetch_add(other.count(), std::memory_order_relaxed);
+}
+
+void log_histogram::reset() noexcept {
+  for (auto& x : counts_)
+    x.store(0, std::memory_order_relaxed);
+  count_.store(0, std::memory_order_relaxed);
+}
+
+// -- quantiles ----------------------------------------------------------------
+
+double log_histogram::quantile(double q) const noexcept {
+  auto total = count();
+  if (total == 0)
+    return 0;
+  auto rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(total)));
+  if (rank == 0)
+    rank = 1;
+  uint64_t seen = 0;
+  for (size_t index = 0; index < bucket_count; ++index) {
+    seen += count_at(index);
+    if (seen >= rank) {
+      auto lower = static_cast<double>(lower_bound_of(index));
+      auto width = static_cast<double>(width_of(index));
+      return (lower + width / 2) * resolution_;
+    }
+  }
+  // Only reachable if observations arrive concurrently.
+  return static_cast<double>(lower_bound_of(bucket_count - 1)) * resolution_;
+}
+
+// -- bucket arithmetic --------------------------------------------------------
+
+size_t log_histogram::index_of(uint64_t units) noexcept {
+  if (units < sub_bucket_count)
+    return static_cast<size_t>(units);
+  auto msb = static_cast<size_t>(63 - __builtin_clzll(units));
+  auto shift = msb - sub_bucket_bits;
+  auto sub_index = static_cast<size_t>(units >> shift) - sub_bucket_count;
+  return (shift + 1) * sub_bucket_count + sub_index;
+}
+
+uint64_t log_histogram::lower_bound_of(size_t index) noexcept {
+  if (index < sub_bucket_count)
+    return index;
+  auto shift = index / sub_bucket_count - 1;
+  auto mantissa = index % sub_bucket_count + sub_bucket_count;
+  return uint64_t{mantissa} << shift;
+}
+
+uint64_t log_histogram::width_of(size_t index) noexcept {
+  if (index < sub_bucket_count)
+    return 1;
+  return uint64_t{1} << (index / sub_bucket_count - 1);
+}
+
+} // namespace broker::internal
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace broker::internal {
+
+/// A histogram with log-linear buckets in the style of HdrHistogram. Each
+/// power-of-two range of values maps to `sub_bucket_count` linear buckets.
+/// Hence, the relative error of a bucket stays below `1 / sub_bucket_count`
+/// regardless of the magnitude of the value. Recording an observation is a
+/// constant-time index computation plus an atomic increment and histograms
+/// with the same resolution merge by adding up their buckets.
+class log_histogram {
+public:
+  // -- constants --------------------------------------------------------------
+
+  /// Number of bits for the linear sub-buckets.
+  static constexpr size_t sub_bucket_bits = 4;
+
+  /// Number of linear sub-buckets per power of two.
+  static constexpr size_t sub_bucket_count = size_t{1} << sub_bucket_bits;
+
+  /// Number of buckets for covering all 64-bit values.
+  static constexpr size_t bucket_count = (65 - sub_bucket_bits)
+                                         * sub_bucket_count;
+
+  /// Default resolution: one nanosecond when observing seconds.
+  static constexpr double default_resolution = 1e-9;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// @param resolution The smallest distinguishable value. Observations map to
+  ///                   multiples of this value.
+  explicit log_histogram(double resolution = default_resolution) noexcept;
+
+  log_histogram(const log_histogram&) = delete;
+
+  log_histogram& operator=(const log_histogram&) = delete;
+
+  // -- properties -------------------------------------------------------------
+
+  double resolution() const noexcept {
+    return resolution_;
+  }
+
+  /// Returns the number of observations.
+  uint64_t count() const noexcept {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  /// Returns the number of observations in the bucket at `index`.
+  uint64_t count_at(size_t index) const noexcept {
+    return counts_[index].load(std::memory_order_relaxed);
+  }
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Records `n` observations of `value`. Negative values count as 0.
+  void observe(double value, uint64_t n = 1) noexcept;
+
+  /// Adds all observations of `other` to this histogram.
+  /// @pre `resolution() == other.resolution()`
+  void merge(const log_histogram& other) noexcept;
+
+  /// Drops all observations.
+  void reset() noexcept;
+
+  // -- quantiles --------------------------------------------------------------
+
+  /// Returns an estimate for the `q`-quantile of all observations, i.e., the
+  /// midpoint of the bucket that contains the observation at rank `q * count`.
+  /// Returns 0 if the histogram has no observations.
+  /// @pre `0 <= q && q <= 1`
+  double quantile(double q) const noexcept;
+
+  // -- bucket arithmetic ------------------------------------------------------
+
+  /// Returns the index of the bucket for `units` multiples of the resolution.
+  static size_t index_of(uint64_t units) noexcept;
+
+  /// Returns the smallest value (in multiples of the resolution) that maps to
+  /// the bucket at `index`.
+  static uint64_t lower_bound_of(size_t index) noexcept;
+
+  /// Returns the number of values that map to the bucket at `index`.
+  static uint64_t width_of(size_t index) noexcept;
+
+private:
+  double resolution_;
+
+  std::atomic<uint64_t> count_;
+
+  std::array<std::atomic<uint64_t>, bucket_count> counts_;
+};
+
+} // namespace broker::internal
@@ -0,0 +1,65 @@
+#include "broker/internal/log_histogram.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <cmath>
+
+using namespace broker;
+
+using internal::log_histogram;
+
+namespace {
+
+bool close_to(double x, double y) {
+  // Buckets have a relative error of at most 1 / sub_bucket_count.
+  return std::abs(x - y) <= y / log_histogram::sub_bucket_count;
+}
+
+} // namespace
+
+TEST(small values map to exact buckets) {
+  for (uint64_t units = 0; units < log_histogram::sub_bucket_count; ++units) {
+    auto index = log_histogram::index_of(units);
+    CHECK_EQUAL(index, units);
+    CHECK_EQUAL(log_histogram::lower_bound_of(index), units);
+    CHECK_EQUAL(log_histogram::width_of(index), 1u);
+  }
+}
+
+TEST(each value falls into the bucket that covers it) {
+  for (uint64_t units : {16ull, 17ull, 100ull, 1000ull, 123456789ull,
+                         0xFFFFFFFFFFFFFFFFull}) {
+    auto index = log_histogram::index_of(units);
+    REQUIRE_LESS(index, log_histogram::bucket_count);
+    auto lower = log_histogram::lower_bound_of(index);
+    CHECK_LESS_EQUAL(lower, units);
+    CHECK_LESS_EQUAL(units - lower, log_histogram::width_of(index) - 1);
+  }
+  CHECK_EQUAL(log_histogram::index_of(0xFFFFFFFFFFFFFFFFull),
+              log_histogram::bucket_count - 1);
+}
+
+TEST(quantiles stay within the relative error of the buckets) {
+  log_histogram hist{1e-6};
+  for (int i = 1; i <= 1000; ++i)
+    hist.observe(i * 1e-3);
+  CHECK_EQUAL(hist.count(), 1000u);
+  CHECK(close_to(hist.quantile(0.5), 0.5));
+  CHECK(close_to(hist.quantile(0.99), 0.99));
+  CHECK(close_to(hist.quantile(0.999), 0.999));
+  CHECK(close_to(hist.quantile(1), 1.0));
+}
+
+TEST(merging adds up the observations of two histograms) {
+  log_histogram hist1{1e-6};
+  log_histogram hist2{1e-6};
+  hist1.observe(0.001, 99);
+  hist2.observe(1.0);
+  hist1.merge(hist2);
+  CHECK_EQUAL(hist1.count(), 100u);
+  CHECK(close_to(hist1.quantile(0.5), 0.001));
+  CHECK(close_to(hist1.quantile(1), 1.0));
+  hist1.reset();
+  CHECK_EQUAL(hist1.count(), 0u);
+  CHECK_EQUAL(hist1.quantile(0.5), 0.0);
+}
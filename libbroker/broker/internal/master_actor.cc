@@ -1,5 +1,7 @@
 #include "broker/internal/logger.hh" // Needs to come before CAF includes.
 
+#include <iterator>
+
 #include <caf/actor.hpp>
 #include <caf/behavior.hpp>
 #include <caf/error.hpp>
@@ -13,10 +15,12 @@
 #include "broker/data.hh"
 #include "broker/defaults.hh"
 #include "broker/detail/abstract_backend.hh"
+#include "broker/detail/appliers.hh"
 #include "broker/detail/assert.hh"
 #include "broker/detail/die.hh"
 #include "broker/internal/master_actor.hh"
 #include "broker/internal/metric_factory.hh"
+#include "broker/internal/store_batch.hh"
 #include "broker/store.hh"
 #include "broker/time.hh"
 #include "broker/topic.hh"
@@ -40,6 +44,14 @@ auto to_caf_res(expected<T>&& x) {
     return caf::result<T>{std::move(native(x.error()))};
 }
 
+expected<data> query_value(const detail::abstract_backend& backend,
+                           const data& key, value_query op, const data& arg) {
+  auto x = backend.get(key);
+  if (!x)
+    return x;
+  return visit(detail::evaluator{op, arg}, *x);
+}
+
 } // namespace
 
 // -- metrics ------------------------------------------------------------------
@@ -63,15 +75,37 @@ master_state::master_state(
   super::init(output);
   clones_topic = store_name / topic::clone_suffix();
   backend = std::move(bp);
-  if (auto es = backend->expiries()) {
+  expiry_load_interval = caf::get_or(ptr->config(),
+                                     "broker.store.expiry-load-interval",
+                                     defaults::store::expiry_load_interval);
+  if (expiry_load_interval.count() > 0) {
+    BROKER_INFO("defer loading expiries for" << store_name);
+  } else if (auto es = backend->expiries()) {
     for (auto& [key, expire_time] : *es)
-      expirations.emplace(key, expire_time);
+      expirations.set(key, expire_time);
+    expiries_loaded_until = timestamp::max();
   } else {
     detail::die("failed to get master expiries while initializing");
   }
   if (auto entries = backend->size(); entries && *entries > 0) {
     metrics.entries->value(static_cast<int64_t>(*entries));
   }
+  snapshot_chunk_size = caf::get_or(ptr->config(),
+                                    "broker.store.snapshot-chunk-size",
+                                    defaults::store::snapshot_chunk_size);
+  output.replay_log_size(caf::get_or(ptr->config(),
+                                     "broker.store.replay-log-size",
+                                     defaults::store::replay_log_size));
+  output.max_window(caf::get_or(ptr->config(), "broker.store.max-window",
+                                defaults::store::max_window));
+  output.retransmit_broadcast_threshold(
+    caf::get_or(ptr->config(), "broker.store.retransmit-broadcast-threshold",
+                defaults::store::retransmit_broadcast_threshold));
+  max_expirations_per_tick = caf::get_or(
+    ptr->config(), "broker.store.max-expirations-per-tick",
+    defaults::store::max_expirations_per_tick);
+  coalesced.enabled(caf::get_or(ptr->config(), "broker.store.coalesce-updates",
+                                defaults::store::coalesce_updates));
   BROKER_INFO("attached master" << id << "to" << store_name);
 }
 
@@ -171,36 +205,79 @@ table master_state::status_snapshot() const {
 
 void master_state::tick() {
   BROKER_TRACE("");
+  tick_events();
+  flush_coalesced();
   output.tick();
   for (auto& kvp : inputs)
     kvp.second.tick();
   auto t = clock->now();
-  for (auto i = expirations.begin(); i != expirations.end();) {
-    if (t > i->second) {
-      const auto& key = i->first;
-      BROKER_INFO("EXPIRE" << key);
-      if (auto result = backend->expire(key, t); !result) {
-        BROKER_ERROR("EXPIRE" << key << "(FAILED)"
-                              << to_string(result.error()));
-      } else if (!*result) {
-        BROKER_INFO("EXPIRE" << key << "(IGNORE/STALE)");
-      } else {
-        expire_command cmd{key, id};
-        emit_expire_event(cmd);
-        broadcast(std::move(cmd));
-        metrics.entries->dec();
-      }
-      i = expirations.erase(i);
+  if (expiries_loaded_until != timestamp::max())
+    load_expiries(t + expiry_load_interval);
+  auto on_expire = [this, t](const data& key) {
+    BROKER_INFO("EXPIRE" << key);
+    if (auto result = backend->expire(key, t); !result) {
+      BROKER_ERROR("EXPIRE" << key << "(FAILED)" << to_string(result.error()));
+    } else if (!*result) {
+      BROKER_INFO("EXPIRE" << key << "(IGNORE/STALE)");
+    } else {
+      expire_command cmd{key, id};
+      emit_expire_event(cmd);
+      broadcast(std::move(cmd));
+      metrics.entries->dec();
+    }
+  };
+  expirations.expire(t, on_expire, max_expirations_per_tick);
+  // Commit modifications that the backend may have grouped since last tick.
+  if (auto res = backend->flush(); !res)
+    BROKER_ERROR("failed to flush the backend:" << res.error());
+  update_replication_metrics();
+}
+
+void master_state::update_replication_metrics() {
+  using fractional_seconds = std::chrono::duration<double>;
+  auto interval = std::chrono::duration_cast<fractional_seconds>(tick_interval);
+  auto now = output.tick_time();
+  for (auto& path : output.paths()) {
+    auto i = clone_metrics.find(path.hdl);
+    if (i == clone_metrics.end()) {
+      metric_factory factory{self->system()};
+      auto clone = to_string(path.hdl);
+      caf::telemetry::label_view labels[] = {{"name", store_name},
+                                             {"clone", clone}};
+      clone_metrics_t ms;
+      ms.lag = factory.store.replication_lag_family()->get_or_add(labels);
+      ms.delay = factory.store.replication_delay_family()->get_or_add(labels);
+      i = clone_metrics.emplace(path.hdl, ms).first;
+    }
+    auto lag = static_cast<int64_t>(output.seq() - path.acked);
+    i->second.lag->value(lag);
+    if (lag > 0) {
+      auto ticks = static_cast<double>(now.value - path.last_seen.value);
+      i->second.delay->value(ticks * interval.count());
     } else {
-      ++i;
+      i->second.delay->value(0);
     }
   }
 }
 
+void master_state::load_expiries(timestamp until) {
+  if (until <= expiries_loaded_until)
+    return;
+  auto es = backend->expiries_between(expiries_loaded_until, until);
+  if (!es) {
+    BROKER_ERROR("failed to load expiries:" << es.error());
+    return;
+  }
+  BROKER_DEBUG("loaded" << es->size() << "expiries for" << store_name);
+  for (auto& [key, expire_time] : *es)
+    expirations.set(key, expire_time);
+  expiries_loaded_until = until;
+}
+
 void master_state::set_expire_time(const data& key,
                                    const std::optional<timespan>& expiry) {
   if (expiry)
-    expirations.insert_or_assign(key, clock->now() + *expiry);
+    expirations.set(key, clock->now() + *expiry);
   else
     expirations.erase(key);
 }
@@ -218,15 +295,24 @@ void master_state::consume(put_command& x) {
   BROKER_INFO("PUT" << x.key << "->" << x.value << "with expiry"
                     << (x.expiry ? to_string(*x.expiry) : "none"));
   auto et = to_opt_timestamp(clock->now(), x.expiry);
-  auto old_value = backend->get(x.key);
+  // Only fetch the previous value if we need it for an update event.
+  expected<data> old_value{ec::no_such_key};
+  bool existed = false;
+  if (wants_event(x.key)) {
+    old_value = backend->get(x.key);
+    existed = static_cast<bool>(old_value);
+  } else if (auto res = backend->exists(x.key)) {
+    existed = *res;
+  }
   auto result = backend->put(x.key, x.value, et);
   if (!result) {
     BROKER_WARNING("failed to put" << x.key << "->" << x.value);
     return; // TODO: propagate failure? to all clones? as status msg?
   }
   set_expire_time(x.key, x.expiry);
-  if (old_value) {
-    emit_update_event(x, *old_value);
+  if (existed) {
+    if (old_value)
+      emit_update_event(x, *old_value);
   } else {
     emit_insert_event(x);
     metrics.entries->inc();
@@ -369,6 +455,87 @@ void master_state::consume(clear_command& x) {
   broadcast(x);
 }
 
+void master_state::consume(batch_command& x) {
+  BROKER_TRACE(BROKER_ARG(x));
+  BROKER_INFO("BATCH" << x.entries.size() << "entries");
+  if (auto res = backend->begin_transaction(); !res) {
+    BROKER_ERROR("failed to begin a transaction, dropping batch:"
+                 << res.error());
+    return;
+  }
+  // Hold back all events until the backend committed the transaction.
+  auto events_offset = pending_events.size();
+  auto publish_immediately = !batch_events;
+  batch_events = true;
+  std::vector<batch_entry> results;
+  results.reserve(x.entries.size());
+  pending_batch = &results;
+  for (auto& entry : x.entries)
+    std::visit([this](auto& cmd) { consume(cmd); }, entry);
+  pending_batch = nullptr;
+  batch_events = !publish_immediately;
+  if (auto res = backend->commit_transaction(); !res) {
+    BROKER_ERROR("failed to commit a transaction, dropping batch:"
+                 << res.error());
+    if (auto err = backend->abort_transaction(); !err)
+      BROKER_ERROR("failed to roll back the transaction:" << err.error());
+    pending_events.resize(events_offset);
+    resync();
+    return;
+  }
+  if (publish_immediately) {
+    auto first = pending_events.begin() + events_offset;
+    vector events{std::make_move_iterator(first),
+                  std::make_move_iterator(pending_events.end())};
+    pending_events.erase(first, pending_events.end());
+    for (auto& ev : events)
+      publish_event(std::move(get<vector>(ev)));
+  }
+  flush_batch(std::move(results), x.publisher);
+}
+
+void master_state::resync() {
+  expirations.clear();
+  if (expiries_loaded_until == timestamp::max()) {
+    if (auto es = backend->expiries()) {
+      for (auto& [key, expire_time] : *es)
+        expirations.set(key, expire_time);
+    } else {
+      BROKER_ERROR("failed to reload expiries:" << es.error());
+    }
+  } else {
+    // Loads the expiries again on the next tick.
+    expiries_loaded_until = timestamp::min();
+  }
+  if (auto entries = backend->size())
+    metrics.entries->value(static_cast<int64_t>(*entries));
+}
+
+void master_state::flush_batch(std::vector<batch_entry> xs,
+                               const entity_id& publisher) {
+  switch (xs.size()) {
+    case 0:
+      break;
+    case 1:
+      std::visit([this](auto& cmd) { broadcast(std::move(cmd)); }, xs[0]);
+      break;
+    default:
+      broadcast(batch_command{std::move(xs), publisher});
+  }
+}
+
+void master_state::flush_coalesced() {
+  if (coalesced.empty())
+    return;
+  auto xs = coalesced.take();
+  if (output.paths().empty())
+    return;
+  if (xs.size() == 1)
+    std::visit([this](auto& cmd) { send_to_clones(std::move(cmd)); }, xs[0]);
+  else
+    send_to_clones(batch_command{std::move(xs), id});
+}
+
 error master_state::consume_nil(consumer_type* src) {
   BROKER_TRACE("");
   // We lost a message from a writer. This is obviously bad, since we lost some
@@ -425,19 +592,49 @@ void master_state::send(producer_type*, const entity_id& whom,
                         channel_type::handshake msg) {
   auto i = open_handshakes.find(whom);
   if (i == open_handshakes.end()) {
-    auto ss = backend->snapshot();
-    if (!ss)
+    std::vector<command_message> msgs;
+    snapshot ss;
+    // Split large snapshots into chunks that precede the ACK. Visiting the
+    // backend entry by entry avoids materializing the full content in
+    // addition to the chunks.
+    auto size = backend->size();
+    if (!size)
+      detail::die("failed to snapshot master");
+    if (snapshot_chunk_size > 0 && *size > snapshot_chunk_size) {
+      uint64_t count = (*size - 1) / snapshot_chunk_size;
+      uint64_t index = 0;
+      auto res = backend->for_each([&](const data& key, const data& value) {
+        ss.emplace(key, value);
+        if (index < count && ss.size() == snapshot_chunk_size) {
+          msgs.emplace_back(make_command_message(
+            clones_topic,
+            internal_command{0, id, whom,
+                             snapshot_chunk_command{index++, count,
+                                                    std::move(ss)}}));
+          ss = snapshot{};
+          ss.reserve(snapshot_chunk_size);
+        }
+        return true;
+      });
+      if (!res)
+        detail::die("failed to snapshot master");
+    } else if (auto res = backend->snapshot()) {
+      ss = std::move(*res);
+    } else {
       detail::die("failed to snapshot master");
-    auto cmd = make_command_message(
+    }
+    msgs.emplace_back(make_command_message(
       clones_topic,
       internal_command{msg.offset, id, whom,
                        ack_clone_command{msg.offset, msg.heartbeat_interval,
-                                         std::move(*ss)}});
-    i = open_handshakes.emplace(whom, std::move(cmd)).first;
+                                         std::move(ss)}}));
+    i = open_handshakes.emplace(whom, std::move(msgs)).first;
   }
-  BROKER_DEBUG("send producer handshake with offset" << msg.offset << "to"
-                                                     << whom);
-  self->send(core, atom::publish_v, i->second, whom.endpoint);
+  BROKER_DEBUG("send producer handshake with offset"
+               << msg.offset << "to" << whom << "in" << i->second.size()
+               << "messages");
+  for (auto& cmd : i->second)
+    self->send(core, atom::publish_v, cmd, whom.endpoint);
 }
 
 void master_state::send(producer_type*, const entity_id& whom,
@@ -473,6 +670,12 @@ void master_state::drop(producer_type*, const entity_id& clone,
   BROKER_INFO("drop" << clone);
   open_handshakes.erase(clone);
   inputs.erase(clone);
+  // CAF has no API for removing metric instances. Hence, we only reset them.
+  if (auto i = clone_metrics.find(clone); i != clone_metrics.end()) {
+    i->second.lag->value(0);
+    i->second.delay->value(0);
+    clone_metrics.erase(i);
+  }
 }
 
 void master_state::handshake_completed(producer_type*, const entity_id& clone) {
@@ -481,6 +684,17 @@ void master_state::handshake_completed(producer_type*, const entity_id& clone) {
   open_handshakes.erase(clone);
 }
 
+void master_state::stamp(producer_type*, sequence_number_type seq,
+                         command_message& msg) {
+  // Commands that waited for space in the sending window carry an outdated
+  // sequence number.
+  if (get_command(msg).seq == seq)
+    return;
+  auto cmd = get_command(msg);
+  cmd.seq = seq;
+  msg = make_command_message(clones_topic, std::move(cmd));
+}
+
 // -- properties ---------------------------------------------------------------
 
 bool master_state::exists(const data& key) {
@@ -495,6 +709,24 @@ bool master_state::idle() const noexcept {
          && open_handshakes.empty();
 }
 
+bool master_state::quiescent(timestamp until) const noexcept {
+  if (!idle() || !pending_events.empty() || !coalesced.empty())
+    return false;
+  if (expiries_loaded_until < until)
+    return false;
+  auto next = expirations.next_expiry();
+  return !next || *next >= until;
+}
+
+void master_state::hibernate() {
+  super::hibernate();
+  output.compact();
+  for (auto& kvp : inputs)
+    kvp.second.compact();
+  open_handshakes.rehash(0);
+  backend->release_memory();
+}
+
 // -- initial behavior ---------------------------------------------------------
 
 caf::behavior master_state::make_behavior() {
@@ -505,11 +737,12 @@ caf::behavior master_state::make_behavior() {
     on_down_msg(msg.source, msg.reason);
   });
   // Schedule first tick.
-  send_later(self, tick_interval, caf::make_message(atom::tick_v));
+  schedule_tick();
   return super::make_behavior(
     // --- local communication -------------------------------------------------
     [this](atom::local, internal_command_variant& content) {
       BROKER_TRACE(BROKER_ARG(content));
+      wakeup();
       // Locally received message are already ordered and reliable. Hence, we
       // can process them immediately.
       auto tag = detail::tag_of(content);
@@ -528,9 +761,13 @@ caf::behavior master_state::make_behavior() {
         BROKER_ERROR("received unexpected command locally:" << content);
       }
     },
-    [this](atom::tick) {
-      tick();
-      send_later(self, tick_interval, caf::make_message(atom::tick_v));
+    [this](atom::tick, uint64_t generation) {
+      auto n = due_ticks(generation);
+      if (n == 0)
+        return;
+      for (size_t i = 0; i < n; ++i)
+        tick();
+      schedule_tick();
       if (!idle_callbacks.empty() && idle()) {
         for (auto& rp : idle_callbacks)
           rp.deliver(atom::ok_v);
@@ -554,6 +791,18 @@ caf::behavior master_state::make_behavior() {
       else
         return caf::make_message(native(x.error()), id);
     },
+    [this](atom::get, atom::keys, const data& first, const data& last,
+           count limit) -> caf::result<data> {
+      auto x = backend->range(first, last, limit);
+      BROKER_INFO("RANGE" << first << last << limit << "->" << x);
+      return to_caf_res(std::move(x));
+    },
+    [this](atom::get, atom::keys, const std::string& prefix,
+           count limit) -> caf::result<data> {
+      auto x = backend->keys_with_prefix(prefix, limit);
+      BROKER_INFO("KEYS_WITH_PREFIX" << prefix << limit << "->" << x);
+      return to_caf_res(std::move(x));
+    },
     [this](atom::exists, const data& key) -> caf::result<data> {
       auto x = backend->exists(key);
       BROKER_INFO("EXISTS" << key << "->" << x);
@@ -575,6 +824,22 @@ caf::behavior master_state::make_behavior() {
       BROKER_INFO("GET" << key << aspect << "->" << x);
       return to_caf_res(std::move(x));
     },
+    [this](atom::get, const data& key, value_query op,
+           const data& arg) -> caf::result<data> {
+      auto x = query_value(*backend, key, op, arg);
+      BROKER_INFO("QUERY" << key << op << arg << "->" << x);
+      return to_caf_res(std::move(x));
+    },
+    [this](atom::get, const data& key, value_query op, const data& arg,
+           request_id id) {
+      auto x = query_value(*backend, key, op, arg);
+      BROKER_INFO("QUERY" << key << op << arg << "with id:" << id << "->"
+                          << x);
+      if (x)
+        return caf::make_message(std::move(*x), id);
+      else
+        return caf::make_message(native(x.error()), id);
+    },
     [this](atom::get, const data& key, request_id id) {
       auto x = backend->get(key);
       BROKER_INFO("GET" << key << "with id:" << id << "->" << x);
@@ -583,6 +848,19 @@ caf::behavior master_state::make_behavior() {
       else
         return caf::make_message(native(x.error()), id);
     },
+    [this](atom::get, const std::vector<data>& keys) -> caf::result<data> {
+      auto x = backend->get_many(keys);
+      BROKER_INFO("GET_MANY" << keys << "->" << x);
+      return to_caf_res(std::move(x));
+    },
+    [this](atom::get, const std::vector<data>& keys, request_id id) {
+      auto x = backend->get_many(keys);
+      BROKER_INFO("GET_MANY" << keys << "with id:" << id << "->" << x);
+      if (x)
+        return caf::make_message(std::move(*x), id);
+      else
+        return caf::make_message(native(x.error()), id);
+    },
     [this](atom::get, const data& key, const data& value, request_id id) {
       auto x = backend->get(key, value);
       BROKER_INFO("GET" << key << "->" << value << "with id:" << id << "->"
@@ -592,6 +870,22 @@ caf::behavior master_state::make_behavior() {
       else
         return caf::make_message(std::move(native(x.error())), id);
     },
+    [this](atom::get, const store_request_batch_ptr& batch) {
+      auto result = std::make_shared<store_response_batch>();
+      auto& responses = result->responses;
+      responses.reserve(batch->size());
+      for (const auto& req : batch->requests) {
+        if (req.op == store_request_batch::kind::get) {
+          responses.push_back(store::response{backend->get(req.key), req.id});
+        } else if (auto x = backend->exists(req.key)) {
+          responses.push_back(store::response{data{*x}, req.id});
+        } else {
+          responses.push_back(store::response{std::move(x.error()), req.id});
+        }
+      }
+      BROKER_INFO("BATCH with" << batch->size() << "requests");
+      return caf::make_message(std::move(result));
+    },
     [this](atom::get, atom::name) { return store_name; },
     [this](atom::await, atom::idle) -> caf::result<atom::ok> {
       if (idle())
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 #include <caf/actor.hpp>
 #include <caf/behavior.hpp>
@@ -10,10 +12,12 @@
 
 #include "broker/data.hh"
 #include "broker/detail/abstract_backend.hh"
+#include "broker/detail/expiration_index.hh"
 #include "broker/endpoint.hh"
 #include "broker/entity_id.hh"
 #include "broker/fwd.hh"
 #include "broker/internal/store_actor.hh"
+#include "broker/internal/update_coalescer.hh"
 #include "broker/internal_command.hh"
 #include "broker/topic.hh"
 
@@ -43,12 +47,47 @@ public:
     caf::telemetry::int_gauge* entries = nullptr;
   };
 
+  /// Bundles the replication metrics for a single clone.
+  struct clone_metrics_t {
+    /// Number of events the clone did not acknowledge yet.
+    caf::telemetry::int_gauge* lag = nullptr;
+
+    /// Seconds since the clone acknowledged an event while lagging behind.
+    caf::telemetry::dbl_gauge* delay = nullptr;
+  };
+
   template <class T>
   void broadcast(T&& cmd) {
     BROKER_TRACE(BROKER_ARG(cmd));
+    // Collect the command instead if we are currently processing a batch.
+    if constexpr (std::is_constructible_v<batch_entry, std::decay_t<T>>) {
+      if (pending_batch) {
+        pending_batch->emplace_back(std::forward<T>(cmd));
+        return;
+      }
+    }
     // Suppress message if no one is listening.
     if (output.paths().empty())
       return;
+    // Merge redundant modifications until the next tick if configured.
+    if (coalesced.enabled()) {
+      if constexpr (std::is_constructible_v<batch_entry, std::decay_t<T>>) {
+        coalesced.push(std::forward<T>(cmd));
+        return;
+      } else if constexpr (std::is_same_v<T, batch_command>) {
+        for (auto& entry : cmd.entries)
+          std::visit([this](auto& x) { coalesced.push(std::move(x)); }, entry);
+        return;
+      } else {
+        flush_coalesced();
+      }
+    }
+    send_to_clones(std::forward<T>(cmd));
+  }
+
+  /// Sends a command to all clones without buffering.
+  template <class T>
+  void send_to_clones(T&& cmd) {
     auto seq = output.next_seq();
     auto msg = make_command_message(clones_topic,
                                     internal_command{seq, id, entity_id::nil(),
@@ -72,10 +111,21 @@ public:
 
   table status_snapshot() const override;
 
+  bool quiescent(timestamp until) const noexcept override;
+
+  void hibernate() override;
+
   void tick();
 
+  /// Updates the replication lag and delay of all clones.
+  void update_replication_metrics();
+
   void set_expire_time(const data& key, const std::optional<timespan>& expiry);
 
+  /// Adds all keys from the backend that expire before `until` to
+  /// `expirations` unless loaded previously.
+  void load_expiries(timestamp until);
+
   // -- callbacks for the consumer ---------------------------------------------
 
   void consume(consumer_type* src, command_message& cmd);
@@ -92,6 +142,18 @@ public:
 
   void consume(clear_command& cmd);
 
+  void consume(batch_command& cmd);
+
+  /// Broadcasts the commands of a batch, sending a single command as-is.
+  void flush_batch(std::vector<batch_entry> xs, const entity_id& publisher);
+
+  /// Restores the expiration index and metrics from the backend after
+  /// discarding a transaction.
+  void resync();
+
+  /// Sends all commands in `coalesced` to the clones.
+  void flush_coalesced();
+
   template <class T>
   void consume(T& cmd) {
     BROKER_ERROR("master got unexpected command:" << cmd);
@@ -121,6 +183,8 @@ public:
 
   void handshake_completed(producer_type*, const entity_id&);
 
+  void stamp(producer_type*, sequence_number_type, command_message&);
+
   // -- properties -------------------------------------------------------------
 
   bool exists(const data& key);
@@ -141,15 +205,40 @@ public:
   /// Maps senders to manager objects for incoming commands.
   std::unordered_map<entity_id, consumer_type> inputs;
 
-  /// Maps senders to manager objects for incoming commands.
-  std::unordered_map<entity_id, command_message> open_handshakes;
+  /// Maps clones to the handshake messages for them, i.e., all snapshot chunks
+  /// followed by the ACK.
+  std::unordered_map<entity_id, std::vector<command_message>> open_handshakes;
 
-  /// Maps senders to manager objects for incoming commands.
-  std::unordered_map<data, timestamp> expirations;
+  /// Caches the configuration parameter `broker.store.snapshot-chunk-size`.
+  size_t snapshot_chunk_size = defaults::store::snapshot_chunk_size;
+
+  /// Keeps track of when keys expire, sorted by expiration time.
+  detail::expiration_index expirations;
+
+  /// Caches the configuration parameter
+  /// `broker.store.max-expirations-per-tick`.
+  size_t max_expirations_per_tick = defaults::store::max_expirations_per_tick;
+
+  /// Caches the configuration parameter `broker.store.expiry-load-interval`.
+  timespan expiry_load_interval = defaults::store::expiry_load_interval;
+
+  /// Stores up to which point in time `expirations` contains all keys from the
+  /// backend.
+  timestamp expiries_loaded_until = timestamp::min();
 
   /// Caches pointers to the metric instances.
   metrics_t metrics;
 
+  /// Caches pointers to the replication metrics of each clone.
+  std::unordered_map<entity_id, clone_metrics_t> clone_metrics;
+
+  /// Collects outgoing commands while processing a batch.
+  std::vector<batch_entry>* pending_batch = nullptr;
+
+  /// Merges redundant outgoing modifications within a tick if
+  /// `broker.store.coalesce-updates` is enabled.
+  update_coalescer<batch_entry> coalesced;
+
   /// Gives this actor a recognizable name in log files.
   static inline constexpr const char* name = "broker.master";
 };
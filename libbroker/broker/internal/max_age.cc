@@ -0,0 +1,57 @@
+#include "broker/internal/max_age.hh"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace broker::internal {
+
+bool max_age_rule::parse(std::string_view str, max_age_rule& result) {
+  auto eq = str.rfind('=');
+  if (eq == std::string_view::npos || eq == 0)
+    return false;
+  std::string num{str.substr(eq + 1)};
+  char* end = nullptr;
+  auto value = std::strtod(num.c_str(), &end);
+  if (end == num.c_str() || value <= 0)
+    return false;
+  std::string_view unit{end};
+  double factor = 0;
+  if (unit == "ms")
+    factor = 1e6;
+  else if (unit == "s")
+    factor = 1e9;
+  else if (unit == "min")
+    factor = 60e9;
+  else if (unit == "h")
+    factor = 3600e9;
+  else
+    return false;
+  result.prefix = std::string{str.substr(0, eq)};
+  result.max_age = timespan{static_cast<int64_t>(value * factor)};
+  return true;
+}
+
+max_age_table::max_age_table(std::vector<max_age_rule> rules)
+  : rules_(std::move(rules)) {
+  std::stable_sort(rules_.begin(), rules_.end(),
+                   [](const max_age_rule& x, const max_age_rule& y) {
+                     return x.prefix.size() > y.prefix.size();
+                   });
+}
+
+const max_age_rule*
+max_age_table::find(std::string_view topic) const noexcept {
+  for (const auto& x : rules_)
+    if (topic.compare(0, x.prefix.size(), x.prefix) == 0)
+      return &x;
+  return nullptr;
+}
+
+void max_age_table::apply(const node_message& msg) const noexcept {
+  if (get_type(msg) != envelope_type::data || msg->has_deadline())
+    return;
+  if (auto* rule = find(msg->topic()))
+    msg->expire_after(rule->max_age);
+}
+
+} // namespace broker::internal
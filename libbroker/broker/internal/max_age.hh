@@ -0,0 +1,54 @@
+#pragma once
+
+#include "broker/message.hh"
+#include "broker/time.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace broker::internal {
+
+/// Limits how long data messages on topics with a common prefix may wait in
+/// the queues of an endpoint.
+struct max_age_rule {
+  /// Selects all topics that start with this prefix.
+  std::string prefix;
+
+  /// Maximum time between entering the core and leaving a queue.
+  timespan max_age{0};
+
+  /// Parses a rule from a string in the format `<prefix>=<number><unit>`,
+  /// where the unit is one of `ms`, `s`, `min` or `h`.
+  static bool parse(std::string_view str, max_age_rule& result);
+};
+
+/// Maps topics to their maximum age. A topic uses the rule with the longest
+/// matching prefix.
+class max_age_table {
+public:
+  explicit max_age_table(std::vector<max_age_rule> rules);
+
+  /// Returns the rule for `topic` or `nullptr`.
+  const max_age_rule* find(std::string_view topic) const noexcept;
+
+  /// Assigns a deadline to `msg` if it is a data message without deadline and
+  /// its topic has a maximum age. Keeps deadlines set by the publisher.
+  void apply(const node_message& msg) const noexcept;
+
+  size_t size() const noexcept {
+    return rules_.size();
+  }
+
+private:
+  /// Sorted by descending prefix length for finding the longest match first.
+  std::vector<max_age_rule> rules_;
+};
+
+/// @relates max_age_table
+using max_age_table_ptr = std::shared_ptr<max_age_table>;
+
+} // namespace broker::internal
@@ -0,0 +1,71 @@
+#include "broker/internal/max_age.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <thread>
+
+using namespace broker;
+using namespace std::literals;
+
+using internal::max_age_rule;
+using internal::max_age_table;
+
+namespace {
+
+max_age_rule parse(std::string_view str) {
+  max_age_rule result;
+  if (!max_age_rule::parse(str, result))
+    FAIL("failed to parse " << str);
+  return result;
+}
+
+} // namespace
+
+TEST(rules have a string representation) {
+  auto x = parse("zeek/telemetry=30s");
+  CHECK_EQUAL(x.prefix, "zeek/telemetry");
+  CHECK(x.max_age == 30s);
+  CHECK(parse("a=250ms").max_age == 250ms);
+  CHECK(parse("a=1.5min").max_age == 90s);
+  CHECK(parse("a=2h").max_age == 2h);
+  max_age_rule tmp;
+  CHECK(!max_age_rule::parse("zeek", tmp));
+  CHECK(!max_age_rule::parse("=1s", tmp));
+  CHECK(!max_age_rule::parse("a=1", tmp));
+  CHECK(!max_age_rule::parse("a=0s", tmp));
+  CHECK(!max_age_rule::parse("a=1d", tmp));
+  CHECK(!max_age_rule::parse("a=s", tmp));
+}
+
+TEST(topics use the rule with the longest prefix) {
+  max_age_table uut{{parse("zeek=1h"), parse("zeek/telemetry=30s")}};
+  CHECK(uut.find("zeek/telemetry/cpu")->max_age == 30s);
+  CHECK(uut.find("zeek/events")->max_age == 1h);
+  CHECK(uut.find("other") == nullptr);
+}
+
+TEST(the table assigns deadlines to data messages) {
+  max_age_table uut{{parse("stale=1ms"), parse("fresh=1h")}};
+  node_message stale = make_data_message("stale/x", data{1});
+  node_message fresh = make_data_message("fresh/x", data{1});
+  node_message other = make_data_message("other", data{1});
+  uut.apply(stale);
+  uut.apply(fresh);
+  uut.apply(other);
+  CHECK(stale->has_deadline());
+  CHECK(fresh->has_deadline());
+  CHECK(!other->has_deadline());
+  std::this_thread::sleep_for(2ms);
+  CHECK(stale->expired());
+  CHECK(!fresh->expired());
+  CHECK(!other->expired());
+}
+
+TEST(deadlines of the publisher take precedence) {
+  max_age_table uut{{parse("x=1ms")}};
+  node_message msg = make_data_message("x", data{1});
+  msg->expire_after(1h);
+  uut.apply(msg);
+  std::this_thread::sleep_for(2ms);
+  CHECK(!msg->expired());
+}
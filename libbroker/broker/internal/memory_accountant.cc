@@ -0,0 +1,48 @@
+#include "broker/internal/memory_accountant.hh"
+
+namespace broker::internal {
+
+size_t memory_accountant::footprint(const node_message& msg) noexcept {
+  // Approximates the fixed overhead of an envelope with the size of the
+  // smallest envelope type.
+  return sizeof(envelope) + msg->topic().size() + msg->raw_bytes().second;
+}
+
+bool memory_accountant::admits(const node_message& msg, size_t bytes) noexcept {
+  if (budget_ == 0 || get_type(msg) != envelope_type::data)
+    return true;
+  auto* cls = qos_ ? qos_->find(msg->topic()) : nullptr;
+  auto limit = budget_;
+  if (cls != nullptr) {
+    if (cls->priority == qos_priority::critical)
+      return true;
+    if (cls->priority == qos_priority::bulk)
+      limit /= 2;
+  }
+  if (held_ + bytes <= limit)
+    return true;
+  ++shed_;
+  if (shed_counter_)
+    shed_counter_->inc();
+  if (cls != nullptr) {
+    ++cls->budget_dropped;
+    if (cls->budget_counter)
+      cls->budget_counter->inc();
+  }
+  return false;
+}
+
+void memory_accountant::charge(size_t bytes) noexcept {
+  held_ += bytes;
+  if (held_gauge_)
+    held_gauge_->inc(static_cast<int64_t>(bytes));
+}
+
+void memory_accountant::discharge(size_t bytes) noexcept {
+  auto n = bytes < held_ ? bytes : held_;
+  held_ -= n;
+  if (held_gauge_)
+    held_gauge_->dec(static_cast<int64_t>(n));
+}
+
+} // namespace broker::internal
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "broker/internal/qos.hh"
+#include "broker/message.hh"
+
+#include <caf/telemetry/counter.hpp>
+#include <caf/telemetry/gauge.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace broker::internal {
+
+/// Keeps track of how many bytes an endpoint holds in its peer buffers and
+/// enforces an optional budget on them. Once the buffered messages exceed the
+/// budget, the accountant sheds new data messages but still admits control
+/// messages, because dropping these would break routing and the channels of
+/// data stores. The QoS class of a data message may lower or lift the limit
+/// (see @ref qos_priority).
+/// @note Only the core may access the accountant.
+class memory_accountant {
+public:
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// @param budget Maximum number of bytes in all buffers (0 = unlimited).
+  /// @param held Mirrors the currently held bytes. May be `nullptr`.
+  /// @param shed Counts shed messages. May be `nullptr`.
+  memory_accountant(size_t budget, caf::telemetry::int_gauge* held,
+                    caf::telemetry::int_counter* shed) noexcept
+    : budget_(budget), held_gauge_(held), shed_counter_(shed) {
+    // nop
+  }
+
+  // -- properties -------------------------------------------------------------
+
+  /// Returns the maximum number of held bytes or 0 if unlimited.
+  size_t budget() const noexcept {
+    return budget_;
+  }
+
+  /// Returns the number of currently held bytes.
+  size_t held() const noexcept {
+    return held_;
+  }
+
+  /// Returns how many messages the accountant rejected.
+  size_t shed() const noexcept {
+    return shed_;
+  }
+
+  /// Assigns the QoS classes for looking up the priority of data messages.
+  void qos(qos_table_ptr ptr) noexcept {
+    qos_ = std::move(ptr);
+  }
+
+  // -- accounting -------------------------------------------------------------
+
+  /// Estimates how many bytes `msg` occupies, based on the size of its topic
+  /// and of its serialized content.
+  static size_t footprint(const node_message& msg) noexcept;
+
+  /// Checks whether buffering `msg` with the given footprint stays within
+  /// the budget for its priority. Always admits control messages.
+  /// @returns `false` if the caller must drop `msg`.
+  bool admits(const node_message& msg, size_t bytes) noexcept;
+
+  /// Adds `bytes` to the held memory.
+  void charge(size_t bytes) noexcept;
+
+  /// Removes `bytes` from the held memory.
+  void discharge(size_t bytes) noexcept;
+
+private:
+  size_t budget_;
+  size_t held_ = 0;
+  size_t shed_ = 0;
+  caf::telemetry::int_gauge* held_gauge_;
+  caf::telemetry::int_counter* shed_counter_;
+  qos_table_ptr qos_;
+};
+
+/// @relates memory_accountant
+using memory_accountant_ptr = std::shared_ptr<memory_accountant>;
+
+} // namespace broker::internal
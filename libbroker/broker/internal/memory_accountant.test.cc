@@ -0,0 +1,61 @@
+#include "broker/internal/memory_accountant.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <array>
+
+using namespace broker;
+
+using internal::memory_accountant;
+
+namespace {
+
+node_message make_ping() {
+  std::array<std::byte, 4> token{};
+  return make_ping_message(endpoint_id::random(), endpoint_id::random(),
+                           token.data(), token.size());
+}
+
+} // namespace
+
+TEST(the footprint covers topic and payload) {
+  node_message small = make_data_message("foo", data{1});
+  node_message large = make_data_message("foo", data{std::string(1000, 'x')});
+  auto small_bytes = memory_accountant::footprint(small);
+  auto large_bytes = memory_accountant::footprint(large);
+  CHECK_GREATER(small_bytes, 3u);
+  CHECK_GREATER_EQUAL(large_bytes, small_bytes + 1000);
+}
+
+TEST(charging and discharging updates the held bytes) {
+  memory_accountant uut{0, nullptr, nullptr};
+  uut.charge(100);
+  uut.charge(50);
+  CHECK_EQUAL(uut.held(), 150u);
+  uut.discharge(100);
+  CHECK_EQUAL(uut.held(), 50u);
+  uut.discharge(100);
+  CHECK_EQUAL(uut.held(), 0u);
+}
+
+TEST(an unlimited accountant admits everything) {
+  memory_accountant uut{0, nullptr, nullptr};
+  node_message msg = make_data_message("foo", data{1});
+  uut.charge(1'000'000);
+  CHECK(uut.admits(msg, 1'000'000));
+  CHECK_EQUAL(uut.shed(), 0u);
+}
+
+TEST(exceeding the budget sheds data messages only) {
+  memory_accountant uut{100, nullptr, nullptr};
+  node_message msg = make_data_message("foo", data{1});
+  CHECK(uut.admits(msg, 60));
+  uut.charge(60);
+  CHECK(uut.admits(msg, 40));
+  CHECK(!uut.admits(msg, 41));
+  CHECK_EQUAL(uut.shed(), 1u);
+  CHECK(uut.admits(make_ping(), 41));
+  CHECK_EQUAL(uut.shed(), 1u);
+  uut.discharge(60);
+  CHECK(uut.admits(msg, 41));
+}
@@ -1,7 +1,12 @@
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <map>
 #include <memory>
 
 #include "broker/internal/metric_collector.hh"
 
+#include "broker/detail/hash.hh"
 #include "broker/internal/logger.hh"
 
 namespace ct = caf::telemetry;
@@ -108,6 +113,26 @@ public:
     f.append_histogram(this->parent_, this, buf_span, sum_);
   }
 
+  void merge_into(log_histogram& dst, double& sum) const override {
+    // We only know the bucket boundaries for remote histograms. Hence, we
+    // attribute all observations of a bucket to its upper bound, which errs on
+    // the side of overestimating latencies. The implicit "infinite" bucket has
+    // no finite upper bound, so its observations go to the last finite one.
+    using limits = std::numeric_limits<T>;
+    auto last_bound = T{0};
+    for (auto [upper_bound, count] : buckets_) {
+      auto unbounded = upper_bound == limits::max()
+                       || (limits::has_infinity
+                           && upper_bound == limits::infinity());
+      if (!unbounded)
+        last_bound = upper_bound;
+      if (count > 0)
+        dst.observe(static_cast<double>(last_bound),
+                    static_cast<uint64_t>(count));
+    }
+    sum += static_cast<double>(sum_);
+  }
+
 private:
   std::vector<std::pair<T, int64_t>> buckets_;
   T sum_ = 0;
@@ -127,6 +152,11 @@ metric_collector::remote_metric::~remote_metric() {
   // nop
 }
 
+void metric_collector::remote_metric::merge_into(log_histogram&,
+                                                 double&) const {
+  // nop
+}
+
 // --- constructors and destructors --------------------------------------------
 
 metric_collector::metric_collector() {
@@ -169,13 +199,15 @@ size_t metric_collector::insert_or_update(const std::string& endpoint_name,
                                           caf::span<const data> rows) {
   using caf::telemetry::metric_type;
   auto res = size_t{0};
-  if (advance_time(endpoint_name, ts))
+  if (advance_time(endpoint_name, ts)) {
+    auto& cache = series_[endpoint_name];
     for (const auto& row_data : rows)
       if (auto mv = metric_view{row_data})
-        if (auto ptr = instance(endpoint_name, mv)) {
+        if (auto ptr = cached_instance(cache, endpoint_name, mv)) {
           ptr->update(mv);
           ++res;
         }
+  }
   return res;
 }
 
@@ -186,15 +218,24 @@ std::string_view metric_collector::prometheus_text() {
         for (auto& instance : scope.instances)
           instance->append_to(generator_);
     generator_.end_scrape();
+    if (!quantiles_.empty()) {
+      auto res = generator_.str();
+      text_.assign(res.data(), res.size());
+      append_summaries(text_);
+    }
   }
+  if (!quantiles_.empty())
+    return text_;
   auto res = generator_.str();
   return {res.data(), res.size()};
 }
 
 void metric_collector::clear() {
   label_names_.clear();
+  text_.clear();
   prefixes_.clear();
   last_seen_.clear();
+  series_.clear();
   generator_.reset();
 }
 
@@ -213,6 +254,109 @@ bool metric_collector::advance_time(const std::string& endpoint_name,
   }
 }
 
+// -- rendering ----------------------------------------------------------------
+
+namespace {
+
+struct merged_series {
+  log_histogram hist;
+  double sum = 0;
+};
+
+void append_number(std::string& out, double value) {
+  char buf[32];
+  auto n = std::snprintf(buf, sizeof(buf), "%.9g", value);
+  out.append(buf, static_cast<size_t>(n));
+}
+
+// Builds the metric name the same way as the CAF collector does.
+void append_metric_name(std::string& out, const ct::metric_family& family) {
+  auto append_sanitized = [&out](std::string_view str) {
+    for (auto c : str)
+      out += c == '-' || c == '.' ? '_' : c;
+  };
+  append_sanitized(family.prefix());
+  out += '_';
+  append_sanitized(family.name());
+  if (family.unit() != "1") {
+    out += '_';
+    append_sanitized(family.unit());
+  }
+  out += "_merged";
+}
+
+} // namespace
+
+void metric_collector::append_summaries(std::string& out) {
+  using ct::metric_type;
+  std::string fqn;
+  for (auto& [prefix, names] : prefixes_) {
+    for (auto& [name, scope] : names) {
+      auto type = scope.family->type();
+      if (type != metric_type::int_histogram
+          && type != metric_type::dbl_histogram)
+        continue;
+      // Group the instances by all labels except "endpoint".
+      std::map<std::string, merged_series> groups;
+      for (auto& instance : scope.instances) {
+        std::string key;
+        for (auto& lbl : instance->labels()) {
+          if (lbl.name() == "endpoint")
+            continue;
+          if (!key.empty())
+            key += ',';
+          key.append(lbl.name().data(), lbl.name().size());
+          key += "=\"";
+          key.append(lbl.value().data(), lbl.value().size());
+          key += '"';
+        }
+        auto& series = groups[key];
+        instance->merge_into(series.hist, series.sum);
+      }
+      fqn.clear();
+      append_metric_name(fqn, *scope.family);
+      out += "# HELP ";
+      out += fqn;
+      out += ' ';
+      out += scope.family->helptext();
+      out += " Merged across all endpoints.\n# TYPE ";
+      out += fqn;
+      out += " summary\n";
+      for (auto& [labels, series] : groups) {
+        for (auto q : quantiles_) {
+          out += fqn;
+          out += '{';
+          if (!labels.empty()) {
+            out += labels;
+            out += ',';
+          }
+          out += "quantile=\"";
+          append_number(out, q);
+          out += "\"} ";
+          append_number(out, series.hist.quantile(q));
+          out += '\n';
+        }
+        auto append_prefix = [&](std::string_view suffix) {
+          out += fqn;
+          out += suffix;
+          if (!labels.empty()) {
+            out += '{';
+            out += labels;
+            out += '}';
+          }
+          out += ' ';
+        };
+        append_prefix("_sum");
+        append_number(out, series.sum);
+        out += '\n';
+        append_prefix("_count");
+        out += std::to_string(series.hist.count());
+        out += '\n';
+      }
+    }
+  }
+}
+
 // -- lookups ----------------------------------------------------------------
 
 void metric_collector::labels_for(const std::string& endpoint_name,
@@ -313,4 +457,26 @@ metric_collector::instance(const std::string& endpoint_name, metric_view mv) {
   }
 }
 
+metric_collector::remote_metric*
+metric_collector::cached_instance(series_cache& cache,
+                                  const std::string& endpoint_name,
+                                  metric_view mv) {
+  size_t hash = 0;
+  detail::hash_combine(hash, mv.prefix());
+  detail::hash_combine(hash, mv.name());
+  detail::hash_combine(hash, detail::fnv_hash(mv.labels()));
+  auto [first, last] = cache.equal_range(hash);
+  for (auto i = first; i != last; ++i) {
+    auto& entry = i->second;
+    if (entry.name == mv.name() && entry.prefix == mv.prefix()
+        && entry.labels == mv.labels())
+      return entry.instance;
+  }
+  auto ptr = instance(endpoint_name, mv);
+  if (ptr != nullptr)
+    cache.emplace(hash,
+                  cached_series{mv.prefix(), mv.name(), mv.labels(), ptr});
+  return ptr;
+}
+
 } // namespace broker::internal
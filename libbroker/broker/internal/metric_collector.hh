@@ -1,7 +1,9 @@
 #pragma once
 
 #include <set>
+#include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -14,6 +16,7 @@
 
 #include "broker/data.hh"
 #include "broker/detail/assert.hh"
+#include "broker/internal/log_histogram.hh"
 #include "broker/internal/metric_view.hh"
 #include "broker/time.hh"
 #include "broker/topic.hh"
@@ -48,6 +51,10 @@ public:
 
     virtual void append_to(caf::telemetry::collector::prometheus&) = 0;
 
+    /// Adds the observations of a histogram to `dst` and its sum to `sum`.
+    /// Does nothing for other metric types.
+    virtual void merge_into(log_histogram& dst, double& sum) const;
+
   protected:
     const caf::telemetry::metric_family* parent_;
   };
@@ -144,6 +151,18 @@ public:
   /// Returns the recorded metrics in the Prometheus text format.
   [[nodiscard]] std::string_view prometheus_text();
 
+  /// Configures which quantiles the collector reports for histograms. For
+  /// each histogram, the collector merges the observations of all endpoints
+  /// and reports the quantiles as a Prometheus summary with the suffix
+  /// `_merged`. An empty list (the default) disables the summaries.
+  void quantiles(std::vector<double> xs) {
+    quantiles_ = std::move(xs);
+  }
+
+  const std::vector<double>& quantiles() const noexcept {
+    return quantiles_;
+  }
+
   void clear();
 
 private:
@@ -160,11 +179,28 @@ private:
 
   using prefix_map = std::unordered_map<std::string, name_map>;
 
+  /// Identifies a single series of an endpoint and points to its instance.
+  struct cached_series {
+    std::string prefix;
+    std::string name;
+    table labels;
+    remote_metric* instance;
+  };
+
+  /// Maps the combined hash of prefix, name and labels to cached series.
+  using series_cache = std::unordered_multimap<size_t, cached_series>;
+
   // -- time management --------------------------------------------------------
 
   /// Tries to advance the last-seen-time for given endpoint.
   bool advance_time(const std::string& endpoint_name, timestamp current_time);
 
+  // -- rendering --------------------------------------------------------------
+
+  /// Appends a Prometheus summary with the configured quantiles for each
+  /// histogram to `out`, merging the observations of all endpoints.
+  void append_summaries(std::string& out);
+
   // -- lookups ----------------------------------------------------------------
 
   /// Extracts the names for all label dimensions from `mv`.
@@ -177,6 +213,12 @@ private:
   /// Retrieves or lazily creates a metric object for `mv`.
   remote_metric* instance(const std::string& endpoint_name, metric_view mv);
 
+  /// Retrieves the metric object for `mv` from `cache`, falling back to
+  /// `instance` for series that the endpoint did not report before.
+  remote_metric* cached_instance(series_cache& cache,
+                                 const std::string& endpoint_name,
+                                 metric_view mv);
+
   /// Caches labels (key/value pairs) for instance lookups.
   std::vector<caf::telemetry::label_view> labels_;
 
@@ -189,9 +231,20 @@ private:
   /// Stores last-seen-times by endpoints.
   std::unordered_map<std::string, timestamp> last_seen_;
 
+  /// Caches the instances of each endpoint. Imports arrive periodically with
+  /// the same series over and over again. The cache allows us to skip the
+  /// lookups in `prefixes_`, including the label comparisons.
+  std::unordered_map<std::string, series_cache> series_;
+
   /// Generates Prometheus-formatted text.
   caf::telemetry::collector::prometheus generator_;
 
+  /// Stores the quantiles for the merged histogram summaries.
+  std::vector<double> quantiles_;
+
+  /// Stores the output of the generator plus the merged histogram summaries.
+  std::string text_;
+
   /// Caches the string "endpoint" as a broker::data instance. Having this as a
   /// member avoids constructing this object each time in `labels_for`.
   data ep_key_ = data{"endpoint"};
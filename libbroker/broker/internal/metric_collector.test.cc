@@ -4,6 +4,8 @@
 
 #include "broker/internal/metric_exporter.hh"
 
+#include <limits>
+
 namespace atom = broker::internal::atom;
 
 using namespace broker;
@@ -175,4 +177,63 @@ TEST(a collector consumes the output of an exporter) {
     R"(foo_h2_seconds_count{endpoint="exporter-1",sys="broker"} 1)");
 }
 
+TEST(a collector optionally merges histograms into summaries) {
+  collector.quantiles({0.5, 0.99});
+  foo_h1->observe(16);
+  foo_h2->observe(32.0);
+  sched.advance_time(2s);
+  sched.run();
+  auto prom_txt = collector.prometheus_text();
+  PROM_CONTAINS("# TYPE foo_h1_seconds_merged summary");
+  PROM_CONTAINS(R"(foo_h1_seconds_merged{sys="broker",quantile="0.5"} 1)");
+  PROM_CONTAINS(R"(foo_h1_seconds_merged{sys="broker",quantile="0.99"} 1)");
+  PROM_CONTAINS(R"(foo_h1_seconds_merged_sum{sys="broker"} 16)");
+  PROM_CONTAINS(R"(foo_h1_seconds_merged_count{sys="broker"} 1)");
+  PROM_CONTAINS("# TYPE foo_h2_seconds_merged summary");
+  PROM_CONTAINS(R"(foo_h2_seconds_merged_sum{sys="broker"} 32)");
+  PROM_CONTAINS(R"(foo_h2_seconds_merged_count{sys="broker"} 1)");
+  MESSAGE("the collector still reports the per-endpoint histograms");
+  PROM_CONTAINS(
+    R"(foo_h1_seconds_count{endpoint="exporter-1",sys="broker"} 1)");
+}
+
+TEST(repeated imports update the same series) {
+  auto row = [](std::string_view endpoint, timestamp ts, std::string op,
+                integer value) {
+    return vector{vector{std::string{endpoint}, ts},
+                  vector{"bar", "g", "gauge", "1", "Gauge!", false,
+                         table{{"op", std::move(op)}}, value}};
+  };
+  auto t0 = broker::now();
+  auto t1 = t0 + 1s;
+  CHECK_EQUAL(collector.insert_or_update(row("ep-1", t0, "get", 1)), 1u);
+  CHECK_EQUAL(collector.insert_or_update(row("ep-2", t0, "get", 2)), 1u);
+  CHECK_EQUAL(collector.insert_or_update(row("ep-1", t1, "get", 3)), 1u);
+  CHECK_EQUAL(collector.insert_or_update(row("ep-1", t1 + 1s, "put", 4)), 1u);
+  MESSAGE("the collector drops rows that are older than the last update");
+  CHECK_EQUAL(collector.insert_or_update(row("ep-2", t0, "get", 5)), 0u);
+  auto prom_txt = collector.prometheus_text();
+  PROM_CONTAINS(R"(bar_g{endpoint="ep-1",op="get"} 3)");
+  PROM_CONTAINS(R"(bar_g{endpoint="ep-1",op="put"} 4)");
+  PROM_CONTAINS(R"(bar_g{endpoint="ep-2",op="get"} 2)");
+}
+
+TEST(merged summaries add up the observations of all endpoints) {
+  collector.quantiles({0.5});
+  auto row = [](std::string_view endpoint, integer count) {
+    auto bucket = [](integer ub, integer n) { return data{vector{ub, n}}; };
+    auto buckets = vector{bucket(10, count), bucket(100, 0),
+                          bucket(std::numeric_limits<integer>::max(), 0),
+                          data{integer{10} * count}};
+    return vector{vector{std::string{endpoint}, broker::now()},
+                  vector{"bar", "h", "histogram", "1", "Histogram!", false,
+                         table{{"op", "get"}}, std::move(buckets)}};
+  };
+  CHECK_EQUAL(collector.insert_or_update(row("ep-1", 3)), 1u);
+  CHECK_EQUAL(collector.insert_or_update(row("ep-2", 4)), 1u);
+  auto prom_txt = collector.prometheus_text();
+  PROM_CONTAINS(R"(bar_h_merged_sum{op="get"} 70)");
+  PROM_CONTAINS(R"(bar_h_merged_count{op="get"} 7)");
+}
+
 FIXTURE_SCOPE_END()
@@ -26,6 +26,7 @@ namespace broker::internal {
 struct metric_exporter_params {
   std::vector<std::string> selected_prefixes;
   caf::timespan interval = caf::timespan{0};
+  caf::timespan full_refresh_interval = caf::timespan{0};
   topic target;
   std::string id;
   static metric_exporter_params from(const caf::actor_system_config& cfg);
@@ -41,10 +42,12 @@ public:
 
   metric_exporter_state(Self* self, caf::actor core,
                         std::vector<std::string> selected_prefixes,
-                        caf::timespan interval, topic target, std::string id)
+                        caf::timespan interval, topic target, std::string id,
+                        caf::timespan full_refresh_interval = caf::timespan{0})
     : self(self),
       core(std::move(core)),
       interval(interval),
+      full_refresh_interval(full_refresh_interval),
       target(std::move(target)),
       proc_importer(self->system().metrics()),
       impl(std::move(selected_prefixes), std::move(id)) {
@@ -56,7 +59,8 @@ public:
     : metric_exporter_state(self, std::move(core),
                             std::move(params.selected_prefixes),
                             params.interval, std::move(params.target),
-                            std::move(params.id)) {
+                            std::move(params.id),
+                            params.full_refresh_interval) {
     // nop
   }
 
@@ -77,7 +81,7 @@ public:
           proc_importer.update();
           impl.scrape(self->system().metrics());
           // Send nothing if we only have meta data (or nothing) to send.
-          if (const auto& rows = impl.rows(); rows.size() > 1)
+          if (const auto& rows = rows_for_tick(); rows.size() > 1)
             self->send(core, atom::publish_v, make_data_message(target, rows));
           auto t = detail::next_tick(tick_init, self->clock().now(), interval);
           self->scheduled_send(self, t, caf::tick_atom_v);
@@ -110,6 +114,22 @@ public:
     return running_;
   }
 
+  /// Selects the rows for publishing after scraping the metrics. In delta
+  /// mode, i.e., with a full refresh interval, publishes only the changed rows
+  /// unless the full refresh interval has passed.
+  const vector& rows_for_tick() {
+    if (full_refresh_interval.count() == 0)
+      return impl.rows();
+    // Note: always calling changed_rows() keeps the scraper in sync with what
+    //       subscribers have seen.
+    const auto& delta = impl.changed_rows();
+    auto now = self->clock().now();
+    if (now - last_full_refresh < full_refresh_interval)
+      return delta;
+    last_full_refresh = now;
+    return impl.rows();
+  }
+
   /// Starts the timed loop if the exporter hasn't been running yet and all
   /// preconditions are met.
   void cold_boot() {
@@ -117,6 +137,7 @@ public:
       BROKER_INFO("start publishing metrics to topic" << target);
       impl.scrape(self->system().metrics());
       tick_init = self->clock().now();
+      last_full_refresh = tick_init;
       self->scheduled_send(self, tick_init + interval, caf::tick_atom_v);
       running_ = true;
     }
@@ -171,9 +192,16 @@ public:
   /// Configures how frequent the exporter collects metrics from the system.
   caf::timespan interval;
 
+  /// Configures how frequent the exporter publishes all metrics when sending
+  /// only changed metrics in between. A value of 0 disables delta exports.
+  caf::timespan full_refresh_interval;
+
   /// Caches the time point of our initialization for scheduling ticks.
   caf::actor_clock::time_point tick_init;
 
+  /// Stores when the exporter has published all metrics for the last time.
+  caf::actor_clock::time_point last_full_refresh;
+
   /// Configures the topic for periodically publishing scrape results to.
   topic target;
 
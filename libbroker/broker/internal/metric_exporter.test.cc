@@ -226,4 +226,42 @@ TEST(the exporter allows changing the prefix selection at runtime) {
   CHECK_EQUAL(rows().size(), 4u);
 }
 
+TEST(the exporter publishes only changed metrics between full refreshes) {
+  auto published = [this] {
+    return get_data(core_state().last_message).to_data();
+  };
+  auto published_rows = [&published] {
+    auto xs = published();
+    if (auto vec = get_if<vector>(xs))
+      return vec->size();
+    return size_t{0};
+  };
+  state().full_refresh_interval = 6s;
+  MESSAGE("the first delta contains all metrics");
+  sched.advance_time(2s);
+  expect((caf::tick_atom), to(aut));
+  expect((atom::publish, data_message), from(aut).to(core));
+  CHECK_EQUAL(published_rows(), 3u);
+  MESSAGE("deltas only contain the metrics that have changed");
+  foo_bar->inc();
+  sched.advance_time(2s);
+  expect((caf::tick_atom), to(aut));
+  expect((atom::publish, data_message), from(aut).to(core));
+  if (CHECK(published_rows() == 2u)) {
+    auto xs = published();
+    CHECK_EQUAL(get<vector>(xs)[1],
+                (metric_row{"foo", "bar", "gauge", "1", "FooBar!", false,
+                            table{}, data{1}}));
+  }
+  MESSAGE("the exporter publishes all metrics once per refresh interval");
+  sched.advance_time(2s);
+  expect((caf::tick_atom), to(aut));
+  expect((atom::publish, data_message), from(aut).to(core));
+  CHECK_EQUAL(published_rows(), 3u);
+  MESSAGE("the exporter publishes nothing if no metric has changed");
+  sched.advance_time(2s);
+  expect((caf::tick_atom), to(aut));
+  disallow((atom::publish, data_message), from(aut).to(core));
+}
+
 FIXTURE_SCOPE_END()
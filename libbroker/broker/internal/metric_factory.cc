@@ -79,6 +79,150 @@ core_t::buffered_messages_t core_t::buffered_messages_instances() {
   };
 }
 
+int_counter* core_t::dropped_messages_instance() {
+  return reg_->counter_singleton(
+    "broker", "dropped-messages",
+    "Total number of messages dropped because peers could not keep up.", "1",
+    true);
+}
+
+int_gauge* core_t::buffered_bytes_instance() {
+  return reg_->gauge_singleton(
+    "broker", "buffered-bytes",
+    "Number of bytes currently held in the output buffers of peers.", "bytes");
+}
+
+int_counter* core_t::shed_messages_instance() {
+  return reg_->counter_singleton(
+    "broker", "shed-messages",
+    "Total number of data messages shed because of the memory budget.", "1",
+    true);
+}
+
+int_counter* core_t::expired_messages_instance() {
+  return reg_->counter_singleton(
+    "broker", "expired-messages",
+    "Total number of data messages dropped because they exceeded their "
+    "maximum age.",
+    "1", true);
+}
+
+int_counter_family* core_t::qos_dropped_messages_family() {
+  return reg_->counter_family("broker", "qos-dropped-messages",
+                              {"class", "reason"},
+                              "Total number of data messages dropped per QoS "
+                              "class.",
+                              "1", true);
+}
+
+int_counter_family* core_t::peer_messages_family() {
+  return reg_->counter_family("broker", "peer-messages",
+                              {"direction", "type"},
+                              "Total number of messages exchanged with peers.",
+                              "1", true);
+}
+
+int_counter_family* core_t::peer_bytes_family() {
+  return reg_->counter_family("broker", "peer-bytes",
+                              {"direction", "type"},
+                              "Total number of bytes exchanged with peers.",
+                              "bytes", true);
+}
+
+dbl_histogram_family* core_t::peer_rtt_family() {
+  double buckets[] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, //
+    0.05,   0.1,   0.25,   0.5,   1.0,  2.5,   //
+  };
+  return reg_->histogram_family<double>("broker", "peer-rtt", {"peer"},
+                                        buckets,
+                                        "Round-trip time to a peer.",
+                                        "seconds");
+}
+
+dbl_histogram_family* core_t::message_latency_family() {
+  double buckets[] = {
+    0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005, //
+    0.001,   0.0025,   0.005,   0.01,   0.025,   0.05,   //
+    0.1,     0.25,     0.5,     1.0,                     //
+  };
+  return reg_->histogram_family<double>(
+    "broker", "message-latency", {"stage"}, buckets,
+    "Time between receiving a data message and processing it.", "seconds");
+}
+
+core_t::message_latency_t core_t::message_latency_instances() {
+  auto fm = message_latency_family();
+  return {
+    fm->get_or_add({{"stage", "merge"}}),
+    fm->get_or_add({{"stage", "peer-write"}}),
+    fm->get_or_add({{"stage", "delivery"}}),
+  };
+}
+
+int_counter_family* core_t::topic_messages_family() {
+  return reg_->counter_family("broker", "topic-messages", {"prefix"},
+                              "Total number of processed messages per topic "
+                              "prefix.",
+                              "1", true);
+}
+
+int_counter_family* core_t::topic_bytes_family() {
+  return reg_->counter_family("broker", "topic-bytes", {"prefix"},
+                              "Total number of processed bytes per topic "
+                              "prefix.",
+                              "bytes", true);
+}
+
+int_gauge_family* core_t::flow_demand_family() {
+  return reg_->gauge_family("broker", "flow-demand", {"stage"},
+                            "Number of items a flow stage may emit without "
+                            "receiving more demand.");
+}
+
+dbl_counter_family* core_t::flow_stalled_family() {
+  return reg_->counter_family<double>("broker", "flow-stalled", {"stage"},
+                                      "Time a flow stage spent without demand.",
+                                      "seconds", true);
+}
+
+core_t::flow_stages_t core_t::flow_stage_instances() {
+  auto demand = flow_demand_family();
+  auto stalled = flow_stalled_family();
+  auto get = [&](std::string_view stage) {
+    return flow_stage_t{demand->get_or_add({{"stage", stage}}),
+                        stalled->get_or_add({{"stage", stage}})};
+  };
+  return {
+    get("central-merge"),
+    get("peer-out"),
+    get("client-out"),
+    get("store-in"),
+  };
+}
+
+int_counter_family* core_t::subscriber_queue_resizes_family() {
+  return reg_->counter_family("broker", "subscriber-queue-resizes",
+                              {"direction"},
+                              "Total number of resized subscriber queues.",
+                              "1", true);
+}
+
+core_t::subscriber_queue_resizes_t
+core_t::subscriber_queue_resizes_instances() {
+  auto fm = subscriber_queue_resizes_family();
+  return {
+    fm->get_or_add({{"direction", "grow"}}),
+    fm->get_or_add({{"direction", "shrink"}}),
+  };
+}
+
+int_gauge* core_t::subscriber_queue_high_water_mark_instance() {
+  return reg_->gauge_singleton(
+    "broker", "subscriber-queue-high-water-mark",
+    "Highest number of messages buffered in a subscriber queue.");
+}
+
 // -- store metrics ------------------------------------------------------------
 
 using store_t = metric_factory::store_t;
@@ -93,8 +237,8 @@ int_gauge* store_t::input_channels_instance(std::string_view name) {
 }
 
 int_gauge_family* store_t::out_of_order_updates_family() {
-  return reg_->gauge_family("broker", "store-input-channels", {"name"},
-                            "Number of active input channels in a data store.");
+  return reg_->gauge_family("broker", "store-out-of-order-updates", {"name"},
+                            "Number of out-of-order data store updates.");
 }
 
 int_gauge* store_t::out_of_order_updates_instance(std::string_view name) {
@@ -139,6 +283,74 @@ int_gauge* store_t::unacknowledged_updates_instance(std::string_view name) {
   return unacknowledged_updates_family()->get_or_add({{"name", name}});
 }
 
+int_counter_family* store_t::nacks_family() {
+  return reg_->counter_family("broker", "store-nacks", {"name"},
+                              "Number of received NACK messages.", "1", true);
+}
+
+int_counter* store_t::nacks_instance(std::string_view name) {
+  return nacks_family()->get_or_add({{"name", name}});
+}
+
+int_counter_family* store_t::retransmissions_family() {
+  return reg_->counter_family("broker", "store-retransmissions", {"name"},
+                              "Number of retransmitted data store updates.",
+                              "1", true);
+}
+
+int_counter* store_t::retransmissions_instance(std::string_view name) {
+  return retransmissions_family()->get_or_add({{"name", name}});
+}
+
+int_gauge_family* store_t::replication_lag_family() {
+  return reg_->gauge_family("broker", "store-replication-lag",
+                            {"name", "clone"},
+                            "Number of updates a clone did not acknowledge.");
+}
+
+dbl_gauge_family* store_t::replication_delay_family() {
+  return reg_->gauge_family<double>(
+    "broker", "store-replication-delay", {"name", "clone"},
+    "Time since a lagging clone acknowledged an update.", "seconds");
+}
+
+dbl_histogram_family* store_t::snapshot_duration_family() {
+  double buckets[] = {
+    0.001, 0.01, 0.1, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0,
+  };
+  return reg_->histogram_family<double>(
+    "broker", "store-snapshot-duration", {"name"}, buckets,
+    "Time until a clone received the snapshot of its master.", "seconds");
+}
+
+dbl_histogram* store_t::snapshot_duration_instance(std::string_view name) {
+  return snapshot_duration_family()->get_or_add({{"name", name}});
+}
+
+dbl_histogram_family* store_t::backend_latency_family() {
+  double buckets[] = {
+    0.000001, 0.0000025, 0.000005, 0.00001, 0.000025, 0.00005, //
+    0.0001,   0.00025,   0.0005,   0.001,   0.0025,   0.005,   //
+    0.01,     0.1,                                             //
+  };
+  return reg_->histogram_family<double>(
+    "broker", "store-backend-latency", {"name", "backend", "op"}, buckets,
+    "Time for running an operation on a data store backend.", "seconds");
+}
+
+store_t::backend_latency_t
+store_t::backend_latency_instances(std::string_view name,
+                                   std::string_view backend) {
+  auto fm = backend_latency_family();
+  auto get = [&](std::string_view op) {
+    return fm->get_or_add({{"name", name}, {"backend", backend}, {"op", op}});
+  };
+  return {
+    get("put"), get("add"), get("subtract"), get("erase"), get("expire"),
+    get("get"),
+  };
+}
+
 // --- constructors ------------------------------------------------------------
 
 metric_factory::metric_factory(caf::actor_system& sys) noexcept
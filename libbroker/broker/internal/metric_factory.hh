@@ -96,6 +96,122 @@ public:
     /// Returns all instances of `broker.buffered-messages`.
     buffered_messages_t buffered_messages_instances();
 
+    /// Counts how many messages Broker has dropped in total because peers
+    /// could not keep up.
+    int_counter* dropped_messages_instance();
+
+    /// Keeps track of how many bytes Broker holds in the output buffers of its
+    /// peers.
+    int_gauge* buffered_bytes_instance();
+
+    /// Counts how many data messages Broker has shed in total because its
+    /// buffers exceeded the memory budget.
+    int_counter* shed_messages_instance();
+
+    /// Counts how many data messages Broker has dropped in total because they
+    /// exceeded their maximum age.
+    int_counter* expired_messages_instance();
+
+    /// Counts how many data messages Broker has dropped per QoS class.
+    ///
+    /// Label dimensions: `class` (topic prefix of the class) and `reason`
+    /// ('rate' for exceeding the rate limit or 'budget' for exceeding the
+    /// memory budget).
+    int_counter_family* qos_dropped_messages_family();
+
+    /// Counts how many messages Broker has exchanged with all of its peers.
+    ///
+    /// Label dimensions: `direction` ('in' or 'out') and `type` ('data',
+    /// 'command', 'routing-update', 'ping', or 'pong').
+    int_counter_family* peer_messages_family();
+
+    /// Counts how many bytes Broker has exchanged with all of its peers.
+    ///
+    /// Label dimensions: `direction` ('in' or 'out') and `type` ('data',
+    /// 'command', 'routing-update', 'ping', or 'pong').
+    int_counter_family* peer_bytes_family();
+
+    /// Samples the round-trip time to each peer.
+    ///
+    /// Label dimensions: `peer` (endpoint ID).
+    dbl_histogram_family* peer_rtt_family();
+
+    /// Samples how long data messages spend in the core, measured from the
+    /// point where the core receives a message from a local publisher or a
+    /// peer.
+    ///
+    /// Label dimensions: `stage` ('merge' for reaching the central merge point,
+    /// 'peer-write' for reaching the output buffer of a peer, or 'delivery'
+    /// for reaching a local subscriber).
+    dbl_histogram_family* message_latency_family();
+
+    struct message_latency_t {
+      dbl_histogram* merge;
+      dbl_histogram* peer_write;
+      dbl_histogram* delivery;
+    };
+
+    /// Returns all instances of `broker.message-latency`.
+    message_latency_t message_latency_instances();
+
+    /// Counts how many messages Broker has processed per topic prefix. Only
+    /// available if the core counts traffic per topic.
+    ///
+    /// Label dimensions: `prefix` (first levels of the topic).
+    int_counter_family* topic_messages_family();
+
+    /// Counts how many bytes Broker has processed per topic prefix. Only
+    /// available if the core counts traffic per topic.
+    ///
+    /// Label dimensions: `prefix` (first levels of the topic).
+    int_counter_family* topic_bytes_family();
+
+    /// Keeps track of the outstanding demand at the flow stages in the core.
+    ///
+    /// Label dimensions: `stage` ('central-merge', 'peer-out', 'client-out', or
+    /// 'store-in').
+    int_gauge_family* flow_demand_family();
+
+    /// Accumulates how long the flow stages in the core had no demand left,
+    /// i.e., how long downstream stages back-pressured them.
+    ///
+    /// Label dimensions: `stage` ('central-merge', 'peer-out', 'client-out', or
+    /// 'store-in').
+    dbl_counter_family* flow_stalled_family();
+
+    struct flow_stage_t {
+      int_gauge* demand;
+      dbl_counter* stalled;
+    };
+
+    struct flow_stages_t {
+      flow_stage_t central_merge;
+      flow_stage_t peer_out;
+      flow_stage_t client_out;
+      flow_stage_t store_in;
+    };
+
+    /// Returns all instances of `broker.flow-demand` and `broker.flow-stalled`.
+    flow_stages_t flow_stage_instances();
+
+    /// Counts how often subscribers with adaptive queue sizing resized their
+    /// queue.
+    ///
+    /// Label dimensions: `direction` ('grow' or 'shrink').
+    int_counter_family* subscriber_queue_resizes_family();
+
+    struct subscriber_queue_resizes_t {
+      int_counter* grow;
+      int_counter* shrink;
+    };
+
+    /// Returns all instances of `broker.subscriber-queue-resizes`.
+    subscriber_queue_resizes_t subscriber_queue_resizes_instances();
+
+    /// Keeps track of the highest number of messages that any subscriber with
+    /// adaptive queue sizing had in its queue.
+    int_gauge* subscriber_queue_high_water_mark_instance();
+
   private:
     caf::telemetry::metric_registry* reg_;
   };
@@ -151,6 +267,59 @@ public:
     /// given data store.
     int_gauge* unacknowledged_updates_instance(std::string_view name);
 
+    /// Counts how many NACK messages a data store has received from clones.
+    int_counter_family* nacks_family();
+
+    /// Returns an instance of `broker.store-nacks` for the given data store.
+    int_counter* nacks_instance(std::string_view name);
+
+    /// Counts how many updates a data store has sent again after a NACK.
+    int_counter_family* retransmissions_family();
+
+    /// Returns an instance of `broker.store-retransmissions` for the given
+    /// data store.
+    int_counter* retransmissions_instance(std::string_view name);
+
+    /// Keeps track of how many updates a clone has not acknowledged yet.
+    ///
+    /// Label dimensions: `name` (store name) and `clone` (entity ID).
+    int_gauge_family* replication_lag_family();
+
+    /// Keeps track of how long a clone with unacknowledged updates did not
+    /// acknowledge any update.
+    ///
+    /// Label dimensions: `name` (store name) and `clone` (entity ID).
+    dbl_gauge_family* replication_delay_family();
+
+    /// Samples how long it takes for a clone to receive the full snapshot
+    /// from its master.
+    dbl_histogram_family* snapshot_duration_family();
+
+    /// Returns an instance of `broker.store-snapshot-duration` for the given
+    /// data store.
+    dbl_histogram* snapshot_duration_instance(std::string_view name);
+
+    /// Samples how long operations on a data store backend take.
+    ///
+    /// Label dimensions: `name` (store name), `backend` ('memory', 'sqlite',
+    /// or 'mmap') and `op` ('put', 'add', 'subtract', 'erase', 'expire', or
+    /// 'get').
+    dbl_histogram_family* backend_latency_family();
+
+    struct backend_latency_t {
+      dbl_histogram* put;
+      dbl_histogram* add;
+      dbl_histogram* subtract;
+      dbl_histogram* erase;
+      dbl_histogram* expire;
+      dbl_histogram* get;
+    };
+
+    /// Returns all instances of `broker.store-backend-latency` for the given
+    /// data store.
+    backend_latency_t backend_latency_instances(std::string_view name,
+                                                std::string_view backend);
+
   private:
     caf::telemetry::metric_registry* reg_;
   };
@@ -11,6 +11,7 @@
 #include "broker/detail/assert.hh"
 #include "broker/detail/next_tick.hh"
 #include "broker/internal/logger.hh"
+#include "broker/internal/metric_view.hh"
 #include "broker/message.hh"
 
 namespace ct = caf::telemetry;
@@ -96,6 +97,29 @@ void metric_scraper::scrape(caf::telemetry::metric_registry& registry) {
 void metric_scraper::id(std::string new_id) {
   id_ = std::move(new_id);
   rows_.clear(); // Force re-creation of the meta information on next scrape.
+  last_values_.clear(); // Subscribers see a new endpoint.
+}
+
+const vector& metric_scraper::changed_rows() {
+  changed_rows_.clear();
+  if (rows_.empty())
+    return changed_rows_;
+  changed_rows_.emplace_back(rows_[0]);
+  for (auto i = rows_.begin() + 1; i != rows_.end(); ++i) {
+    auto mv = metric_view{*i};
+    if (!mv)
+      continue;
+    auto key = data{vector{data{mv.prefix()}, data{mv.name()},
+                           data{mv.labels()}}};
+    auto [j, added] = last_values_.try_emplace(std::move(key), mv.value());
+    if (added) {
+      changed_rows_.emplace_back(*i);
+    } else if (j->second != mv.value()) {
+      j->second = mv.value();
+      changed_rows_.emplace_back(*i);
+    }
+  }
+  return changed_rows_;
 }
 
 void metric_scraper::operator()(const ct::metric_family* family,
@@ -5,6 +5,8 @@
 
 #include <caf/telemetry/metric_registry.hpp>
 
+#include <unordered_map>
+
 namespace broker::internal {
 
 /// Scrapes local CAF metrics and encodes them into `data` objects (for
@@ -43,6 +45,10 @@ public:
     return rows_;
   }
 
+  /// Returns the meta data row plus all rows from the last scrape that differ
+  /// from the previous call to this function (or did not exist yet).
+  const vector& changed_rows();
+
   /// Checks whether `selected_prefixes` is empty (an empty filter means *select
   /// all*) or `family->prefix()` is in `selected_prefixes`.
   bool selected(const caf::telemetry::metric_family* family);
@@ -108,6 +114,13 @@ private:
   /// Contains the result for the last scraping run as data rows. The first row
   /// is reserved for meta data (scraper ID plus timestamp).
   vector rows_;
+
+  /// Contains the result of the last call to `changed_rows()`.
+  vector changed_rows_;
+
+  /// Maps prefix, name and labels of each metric to the value it had at the
+  /// last call to `changed_rows()`.
+  std::unordered_map<data, data> last_values_;
 };
 
 } // namespace broker::internal
@@ -0,0 +1,312 @@
+#pragma once
+
+#include "broker/internal/flow_sub.hh"
+#include "broker/internal/memory_accountant.hh"
+#include "broker/message.hh"
+
+#include <caf/disposable.hpp>
+#include <caf/flow/op/cold.hpp>
+#include <caf/intrusive_ptr.hpp>
+#include <caf/scheduled_actor.hpp>
+#include <caf/sec.hpp>
+#include <caf/telemetry/counter.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string_view>
+
+namespace broker::internal {
+
+/// Selects what an @ref overflow_buffer does with new items when running out
+/// of space.
+enum class overflow_policy {
+  /// Drops the new item.
+  drop_newest,
+  /// Drops the oldest item in the buffer to make room for the new item.
+  drop_oldest,
+  /// Aborts the flow with an error.
+  disconnect,
+};
+
+/// @relates overflow_policy
+inline bool from_string(std::string_view str, overflow_policy& result) {
+  if (str == "drop-newest") {
+    result = overflow_policy::drop_newest;
+    return true;
+  }
+  if (str == "drop-oldest") {
+    result = overflow_policy::drop_oldest;
+    return true;
+  }
+  if (str == "disconnect") {
+    result = overflow_policy::disconnect;
+    return true;
+  }
+  return false;
+}
+
+/// Bundles counters that give insight into how many items a buffer dropped
+/// and how many items (and bytes) it currently holds.
+struct overflow_buffer_stats {
+  int64_t dropped = 0;
+  int64_t buffered = 0;
+  int64_t bytes = 0;
+};
+
+/// @relates overflow_buffer_stats
+using overflow_buffer_stats_ptr = std::shared_ptr<overflow_buffer_stats>;
+
+template <class T>
+class overflow_buffer_sub : public flow_sub<T> {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using super = flow_sub<T>;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  overflow_buffer_sub(caf::flow::coordinator* ctx, caf::flow::observer<T> out,
+                      size_t capacity, overflow_policy policy,
+                      overflow_buffer_stats_ptr stats,
+                      caf::telemetry::int_counter* dropped,
+                      memory_accountant_ptr memory)
+    : super(ctx, std::move(out), capacity),
+      capacity_(capacity),
+      policy_(policy),
+      stats_(std::move(stats)),
+      dropped_(dropped),
+      memory_(std::move(memory)) {
+    // nop
+  }
+
+  // -- implementation of observer_impl<T> -------------------------------------
+
+  void on_next(const T& item) override {
+    if (!out_)
+      return;
+    // Signal new demand for each received item. Hence, the input never waits
+    // for our observer, regardless how slow it consumes the items.
+    in_.request(1);
+    if (demand_ > 0 && buf_.empty()) {
+      --demand_;
+      out_.on_next(item);
+      return;
+    }
+    auto bytes = memory_ ? memory_accountant::footprint(item) : size_t{0};
+    if (memory_ && !memory_->admits(item, bytes)) {
+      // Shedding due to the memory budget never disconnects the peer.
+      count_dropped();
+      return;
+    }
+    // Control messages and store commands bypass the capacity, because
+    // dropping these would break routing and the channels of data stores.
+    if (buf_.size() < capacity_ || !sheddable(item)) {
+      push(item, bytes);
+      return;
+    }
+    switch (policy_) {
+      case overflow_policy::drop_newest:
+        count_dropped();
+        break;
+      case overflow_policy::drop_oldest: {
+        count_dropped();
+        auto i = std::find_if(buf_.begin(), buf_.end(),
+                              [](const T& x) { return sheddable(x); });
+        if (i != buf_.end()) {
+          erase(i);
+          push(item, bytes);
+        }
+        break;
+      }
+      default: { // overflow_policy::disconnect
+        count_dropped();
+        clear();
+        in_.dispose();
+        in_ = nullptr;
+        auto tmp = std::move(out_);
+        tmp.on_error(caf::make_error(caf::sec::backpressure_overflow));
+      }
+    }
+  }
+
+  void on_complete() override {
+    in_ = nullptr;
+    completed_ = true;
+    if (buf_.empty())
+      complete_out();
+  }
+
+  // -- implementation of subscription_impl ------------------------------------
+
+  void request(size_t n) override {
+    demand_ += n;
+    if (!buf_.empty() && !drain_scheduled_) {
+      drain_scheduled_ = true;
+      ctx_->delay_fn([ptr = caf::intrusive_ptr<overflow_buffer_sub>{this}] {
+        ptr->drain();
+      });
+    }
+  }
+
+protected:
+  /// Drops all buffered items.
+  void clear() override {
+    while (!buf_.empty())
+      pop();
+  }
+
+private:
+  using super::complete_out;
+  using super::completed_;
+  using super::ctx_;
+  using super::demand_;
+  using super::in_;
+  using super::out_;
+
+  /// Appends `item` to the buffer.
+  void push(const T& item, size_t bytes) {
+    buf_.push_back(item);
+    ++stats_->buffered;
+    if (memory_) {
+      stats_->bytes += static_cast<int64_t>(bytes);
+      memory_->charge(bytes);
+    }
+  }
+
+  /// Checks whether the buffer may drop `item` when running out of space.
+  static bool sheddable(const T& item) noexcept {
+    return get_type(item) == envelope_type::data;
+  }
+
+  /// Removes and returns the first item in the buffer.
+  T pop() {
+    auto item = std::move(buf_.front());
+    buf_.pop_front();
+    discharge(item);
+    return item;
+  }
+
+  /// Removes the item at `pos` from the buffer.
+  void erase(typename std::deque<T>::iterator pos) {
+    discharge(*pos);
+    buf_.erase(pos);
+  }
+
+  /// Updates the stats after removing `item` from the buffer.
+  void discharge(const T& item) {
+    --stats_->buffered;
+    if (memory_) {
+      auto bytes = memory_accountant::footprint(item);
+      stats_->bytes -= static_cast<int64_t>(bytes);
+      memory_->discharge(bytes);
+    }
+  }
+
+  void count_dropped() {
+    ++stats_->dropped;
+    if (dropped_)
+      dropped_->inc();
+  }
+
+  /// Ships buffered items to the observer as long as it has demand.
+  void drain() {
+    drain_scheduled_ = false;
+    while (out_ && demand_ > 0 && !buf_.empty()) {
+      auto item = pop();
+      // Messages that waited past their deadline are not worth sending.
+      if (item->expired()) {
+        count_dropped();
+        continue;
+      }
+      --demand_;
+      out_.on_next(item);
+    }
+    if (completed_ && buf_.empty())
+      complete_out();
+  }
+
+  size_t capacity_;
+  overflow_policy policy_;
+  overflow_buffer_stats_ptr stats_;
+  caf::telemetry::int_counter* dropped_;
+  memory_accountant_ptr memory_;
+  std::deque<T> buf_;
+  bool drain_scheduled_ = false;
+};
+
+/// Decouples an observer from its input by buffering up to `capacity` items.
+/// Unlike regular back-pressure, the buffer never stops pulling from its input.
+/// Once the buffer is full, the policy decides how to handle new data messages.
+/// Control messages and store commands always enter the buffer. With a
+/// @ref memory_accountant, the buffer also sheds items that exceed the memory
+/// budget of the endpoint.
+template <class T>
+class overflow_buffer : public caf::flow::op::cold<T> {
+public:
+  using super = caf::flow::op::cold<T>;
+
+  using decorated_type = caf::flow::observable<T>;
+
+  overflow_buffer(decorated_type decorated, size_t capacity,
+                  overflow_policy policy, overflow_buffer_stats_ptr stats,
+                  caf::telemetry::int_counter* dropped,
+                  memory_accountant_ptr memory)
+    : super(decorated.ctx()),
+      decorated_(std::move(decorated)),
+      capacity_(capacity),
+      policy_(policy),
+      stats_(std::move(stats)),
+      dropped_(dropped),
+      memory_(std::move(memory)) {
+    // nop
+  }
+
+  caf::disposable subscribe(caf::flow::observer<T> out) override {
+    if (!decorated_) {
+      auto err = make_error(caf::sec::too_many_observers,
+                            "overflow_buffer may only be subscribed to once");
+      out.on_error(err);
+      return {};
+    }
+    using sub_t = overflow_buffer_sub<T>;
+    auto sub = caf::make_counted<sub_t>(this->ctx(), out, capacity_, policy_,
+                                        std::move(stats_), dropped_,
+                                        std::move(memory_));
+    out.on_subscribe(caf::flow::subscription{sub});
+    decorated_.subscribe(caf::flow::observer<T>{sub});
+    decorated_ = nullptr;
+    return sub->as_disposable();
+  }
+
+private:
+  decorated_type decorated_;
+  size_t capacity_;
+  overflow_policy policy_;
+  overflow_buffer_stats_ptr stats_;
+  caf::telemetry::int_counter* dropped_;
+  memory_accountant_ptr memory_;
+};
+
+/// Utility class for adding an @ref overflow_buffer to an `observable`.
+struct add_overflow_buffer_t {
+  size_t capacity;
+  overflow_policy policy;
+  overflow_buffer_stats_ptr stats;
+  caf::telemetry::int_counter* dropped;
+  memory_accountant_ptr memory;
+
+  template <class Observable>
+  auto operator()(Observable&& input) const {
+    using obs_t = typename std::decay_t<Observable>;
+    using val_t = typename obs_t::output_type;
+    using impl_t = overflow_buffer<val_t>;
+    auto obs = std::forward<Observable>(input).as_observable();
+    auto ptr = caf::make_counted<impl_t>(std::move(obs), capacity, policy,
+                                         stats, dropped, memory);
+    return caf::flow::observable<val_t>{ptr};
+  }
+};
+
+} // namespace broker::internal
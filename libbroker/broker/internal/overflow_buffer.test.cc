@@ -0,0 +1,108 @@
+#include "broker/internal/overflow_buffer.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include "broker/flow_test_util.test.hh"
+
+using namespace broker;
+
+using internal::memory_accountant;
+using internal::overflow_buffer_stats;
+using internal::overflow_policy;
+
+namespace {
+
+struct fixture : flow_fixture<internal::overflow_buffer_sub<node_message>> {
+  std::shared_ptr<overflow_buffer_stats> stats =
+    std::make_shared<overflow_buffer_stats>();
+
+  std::shared_ptr<memory_accountant> memory;
+
+  void init(size_t capacity, overflow_policy policy) {
+    flow_fixture::init(capacity, policy, stats, nullptr, memory);
+  }
+
+  /// Creates an accountant with a budget for `n` data messages from
+  /// `push_data` with single-character labels.
+  void set_budget(size_t n) {
+    node_message msg = make_data_message("a", data{"a"});
+    auto budget = n * memory_accountant::footprint(msg);
+    memory = std::make_shared<memory_accountant>(budget, nullptr, nullptr);
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(overflow_buffer_tests, fixture)
+
+TEST(drop newest sheds only data messages) {
+  init(2, overflow_policy::drop_newest);
+  push_data("a");
+  push_data("b");
+  push_data("c");
+  push_command("x");
+  CHECK_EQUAL(stats->dropped, 1);
+  CHECK_EQUAL(stats->buffered, 3);
+  CHECK_EQUAL(drain(), string_list({"a", "b", "x"}));
+}
+
+TEST(drop oldest replaces the oldest data message) {
+  init(2, overflow_policy::drop_oldest);
+  push_command("x");
+  push_data("a");
+  push_command("y");
+  push_data("b");
+  CHECK_EQUAL(stats->dropped, 1);
+  CHECK_EQUAL(stats->buffered, 3);
+  CHECK_EQUAL(drain(), string_list({"x", "y", "b"}));
+}
+
+TEST(drop oldest sheds new data if the buffer holds no data messages) {
+  init(1, overflow_policy::drop_oldest);
+  push_command("x");
+  push_command("y");
+  push_data("a");
+  CHECK_EQUAL(stats->dropped, 1);
+  CHECK_EQUAL(drain(), string_list({"x", "y"}));
+}
+
+TEST(disconnect only triggers on data messages) {
+  init(1, overflow_policy::disconnect);
+  push_data("a");
+  push_command("x");
+  CHECK(!out->failed);
+  CHECK_EQUAL(stats->buffered, 2);
+  push_data("b");
+  CHECK(out->failed);
+}
+
+TEST(without a memory budget only the capacity limits the buffer) {
+  set_budget(0);
+  init(10, overflow_policy::drop_newest);
+  push_data("a");
+  push_data("b");
+  push_data("c");
+  CHECK_EQUAL(memory->shed(), 0u);
+  CHECK_EQUAL(drain(), string_list({"a", "b", "c"}));
+}
+
+TEST(a memory budget sheds data messages that exceed it) {
+  set_budget(2);
+  init(10, overflow_policy::drop_newest);
+  push_data("a");
+  push_data("b");
+  push_data("c");
+  push_command("x");
+  MESSAGE("the buffer sheds data past the budget but still admits commands");
+  CHECK_EQUAL(memory->shed(), 1u);
+  CHECK_EQUAL(stats->dropped, 1);
+  CHECK_EQUAL(drain(), string_list({"a", "b", "x"}));
+  MESSAGE("draining the buffer returns its bytes to the budget");
+  CHECK_EQUAL(memory->held(), 0u);
+  push_data("d");
+  push_data("e");
+  CHECK_EQUAL(memory->shed(), 1u);
+  CHECK_EQUAL(drain(), string_list({"d", "e"}));
+}
+
+FIXTURE_SCOPE_END()
@@ -5,6 +5,7 @@
 #include "broker/format/bin.hh"
 #include "broker/internal/killswitch.hh"
 #include "broker/internal/logger.hh"
+#include "broker/internal/tracer.hh"
 #include "broker/internal/type_id.hh"
 #include "broker/ping_envelope.hh"
 #include "broker/topic.hh"
@@ -113,6 +114,60 @@ public:
 
 } // namespace
 
+void peer_traffic_stats::count(const node_message& msg) {
+  // Fixed part of an envelope in the native wire format: sender (16 bytes),
+  // receiver (16 bytes), message type (1 byte), TTL (2 bytes) and topic length
+  // (2 bytes).
+  constexpr int64_t header_size = 37;
+  auto index = static_cast<size_t>(get_type(msg));
+  if (index >= messages.size())
+    return;
+  auto size = header_size + static_cast<int64_t>(msg->topic().size())
+              + static_cast<int64_t>(msg->raw_bytes().second);
+  ++messages[index];
+  bytes[index] += size;
+  if (deferred)
+    return;
+  if (auto* ptr = message_counters[index])
+    ptr->inc();
+  if (auto* ptr = byte_counters[index])
+    ptr->inc(size);
+  if (sample_ages != nullptr && msg->sampled())
+    sample_ages->observe(msg->sample_age());
+}
+
+void peer_traffic_stats::sync_counters() {
+  for (size_t index = 0; index < messages.size(); ++index) {
+    if (auto delta = messages[index] - synced_messages[index]; delta > 0) {
+      if (auto* ptr = message_counters[index])
+        ptr->inc(delta);
+      synced_messages[index] = messages[index];
+    }
+    if (auto delta = bytes[index] - synced_bytes[index]; delta > 0) {
+      if (auto* ptr = byte_counters[index])
+        ptr->inc(delta);
+      synced_bytes[index] = bytes[index];
+    }
+  }
+}
+
+void peer_latency_stats::add(timespan sample) {
+  last_rtt = sample;
+  if (samples++ == 0) {
+    rtt = sample;
+    jitter = sample / 2;
+  } else {
+    auto delta = rtt > sample ? rtt - sample : sample - rtt;
+    jitter = (3 * jitter + delta) / 4;
+    rtt = (7 * rtt + sample) / 8;
+  }
+  if (histogram) {
+    using fractional_seconds = std::chrono::duration<double>;
+    histogram->observe(std::chrono::duration_cast<fractional_seconds>(sample)
+                         .count());
+  }
+}
+
 void peering::on_bye_ack() {
   in_.dispose();
   out_.dispose();
@@ -161,8 +216,22 @@ peering::setup(caf::scheduled_actor* self, node_consumer_res in_res,
   // Construct the BYE message that we emit at the end.
   bye_id_ = self->new_u64_id();
   auto bye_msg = make_bye_message();
+  // Decouple slow peers from the central merge point if configured.
+  if (buffer_capacity_ > 0)
+    src = std::move(src).compose(
+      add_overflow_buffer_t{buffer_capacity_, overflow_policy_, overflow_stats_,
+                            dropped_, memory_});
+  // Let control messages overtake data if configured.
+  if (priority_window_ > 0)
+    src = std::move(src).compose(
+      add_priority_lanes_t{priority_window_, make_bye_token()});
   // Inject our kill switch to allow us to cancel this peering later on.
   src //
+    .do_on_next([stats = output_traffic_,
+                 pid = peer_id_](const node_message& msg) {
+      stats->count(msg);
+      BROKER_TRACE_EVENT(peer_out, msg.get(), pid);
+    })
     .compose(add_flow_scope_t{output_stats_})
     .compose(inject_killswitch_t{&out_})
     .subscribe(std::move(out_res));
@@ -176,6 +245,9 @@ peering::setup(caf::scheduled_actor* self, node_consumer_res in_res,
         .on_error_complete()
         .compose(add_flow_scope_t{input_stats_})
         .compose(inject_killswitch_t{&in_})
+        .do_on_next([stats = input_traffic_](const node_message& msg) {
+          stats->count(msg);
+        })
         .do_on_next([ptr = shared_from_this(), token = make_bye_token()](
                       const node_message& msg) mutable {
           // When unpeering, we send a BYE ping message. When
@@ -1,11 +1,14 @@
 #pragma once
 
 #include "broker/detail/prefix_matcher.hh"
+#include "broker/detail/subscription_index.hh"
 #include "broker/endpoint.hh"
 #include "broker/internal/connector.hh"
 #include "broker/internal/connector_adapter.hh"
 #include "broker/internal/flow_scope.hh"
 #include "broker/internal/fwd.hh"
+#include "broker/internal/overflow_buffer.hh"
+#include "broker/internal/priority_lanes.hh"
 #include "broker/message.hh"
 
 #include <caf/disposable.hpp>
@@ -14,11 +17,75 @@
 #include <caf/make_counted.hpp>
 #include <caf/telemetry/counter.hpp>
 #include <caf/telemetry/gauge.hpp>
+#include <caf/telemetry/histogram.hpp>
 
+#include <array>
+#include <cstdint>
 #include <memory>
 
 namespace broker::internal {
 
+/// Counts messages and bytes per message type for one direction of a peering.
+/// Indexes are according to `packed_message_type`.
+struct peer_traffic_stats {
+  /// Number of messages per type.
+  std::array<int64_t, 6> messages{};
+
+  /// Number of bytes per type, i.e., the size of the messages in the native
+  /// wire format.
+  std::array<int64_t, 6> bytes{};
+
+  /// Optional metric instances that mirror `messages`.
+  std::array<caf::telemetry::int_counter*, 6> message_counters{};
+
+  /// Optional metric instances that mirror `bytes`.
+  std::array<caf::telemetry::int_counter*, 6> byte_counters{};
+
+  /// Optional histogram for the age of sampled messages.
+  caf::telemetry::dbl_histogram* sample_ages = nullptr;
+
+  /// If `true`, `count` only updates `messages` and `bytes` and leaves updating
+  /// the metric instances to `sync_counters`.
+  bool deferred = false;
+
+  /// Stores the values of `messages` at the last call to `sync_counters`.
+  std::array<int64_t, 6> synced_messages{};
+
+  /// Stores the values of `bytes` at the last call to `sync_counters`.
+  std::array<int64_t, 6> synced_bytes{};
+
+  /// Accounts for `msg`.
+  void count(const node_message& msg);
+
+  /// Adds all changes since the last call to the metric instances.
+  void sync_counters();
+};
+
+/// @relates peer_traffic_stats
+using peer_traffic_stats_ptr = std::shared_ptr<peer_traffic_stats>;
+
+/// Keeps track of the round-trip time to a peer. Uses the estimators from RFC
+/// 6298 for smoothing the RTT and its variation (jitter).
+struct peer_latency_stats {
+  /// Number of RTT samples so far.
+  size_t samples = 0;
+
+  /// The most recent RTT sample.
+  timespan last_rtt{0};
+
+  /// The smoothed RTT.
+  timespan rtt{0};
+
+  /// The smoothed RTT variation.
+  timespan jitter{0};
+
+  /// Optional metric instance for recording all samples.
+  caf::telemetry::dbl_histogram* histogram = nullptr;
+
+  /// Adds a new RTT sample.
+  void add(timespan sample);
+};
+
 class peering : public std::enable_shared_from_this<peering> {
 public:
   // ASCII sequence 'BYE' followed by our 64-bit bye ID.
@@ -31,7 +98,10 @@ public:
       id_(id),
       peer_id_(peer_id),
       input_stats_(std::make_shared<flow_scope_stats>()),
-      output_stats_(std::make_shared<flow_scope_stats>()) {
+      output_stats_(std::make_shared<flow_scope_stats>()),
+      overflow_stats_(std::make_shared<overflow_buffer_stats>()),
+      input_traffic_(std::make_shared<peer_traffic_stats>()),
+      output_traffic_(std::make_shared<peer_traffic_stats>()) {
     // nop
   }
 
@@ -55,6 +125,27 @@ public:
   /// `peer_removed` message. Otherwise, `peer_disconnected`.
   node_message status_msg();
 
+  /// Decouples the output of this peer from its input by buffering up to
+  /// `capacity` messages. Once the buffer overflows, the peering applies
+  /// `policy` instead of slowing down the input. Passing 0 for `capacity`
+  /// disables the buffer. The buffer charges its messages to `memory`.
+  /// @pre `setup` was not called yet.
+  void enable_overflow_buffer(size_t capacity, overflow_policy policy,
+                              caf::telemetry::int_counter* dropped,
+                              memory_accountant_ptr memory = nullptr) noexcept {
+    buffer_capacity_ = capacity;
+    overflow_policy_ = policy;
+    dropped_ = dropped;
+    memory_ = std::move(memory);
+  }
+
+  /// Lets control messages to this peer overtake up to `window` pending data
+  /// messages. Passing 0 for `window` disables priority lanes.
+  /// @pre `setup` was not called yet.
+  void enable_priority_lanes(size_t window) noexcept {
+    priority_window_ = window;
+  }
+
   /// Sets up the pipeline for this peer.
   caf::flow::observable<node_message>
   setup(caf::scheduled_actor* self, node_consumer_res in_res,
@@ -104,6 +195,43 @@ public:
     *filter_ = std::move(new_filter);
   }
 
+  /// Applies an incremental change to the filter of the peer.
+  void filter(const filter_delta& delta) {
+    filter_apply(*filter_, delta);
+  }
+
+  /// Returns the version of the filter or 0 if the version is unknown, e.g.,
+  /// because we have received the filter during the handshake.
+  lamport_timestamp filter_version() const noexcept {
+    return filter_version_;
+  }
+
+  /// Sets the version of the filter.
+  void filter_version(lamport_timestamp new_version) noexcept {
+    filter_version_ = new_version;
+  }
+
+  /// Returns whether we have asked the peer for a full snapshot of its filter
+  /// and still wait for the response.
+  bool awaits_filter_snapshot() const noexcept {
+    return awaits_filter_snapshot_;
+  }
+
+  /// Sets whether we wait for a full snapshot of the filter.
+  void awaits_filter_snapshot(bool new_value) noexcept {
+    awaits_filter_snapshot_ = new_value;
+  }
+
+  /// Returns the handle of this peer in the subscription index of the core.
+  detail::subscription_index::handle_type subscription_handle() const noexcept {
+    return subscription_handle_;
+  }
+
+  /// Sets the handle of this peer in the subscription index of the core.
+  void subscription_handle(detail::subscription_index::handle_type hdl) {
+    subscription_handle_ = hdl;
+  }
+
   /// Returns a status object that keeps track of input messages from the peer.
   flow_scope_stats_ptr input_stats() const {
     return input_stats_;
@@ -114,6 +242,31 @@ public:
     return output_stats_;
   }
 
+  /// Returns a status object that keeps track of dropped output messages.
+  overflow_buffer_stats_ptr overflow_stats() const {
+    return overflow_stats_;
+  }
+
+  /// Returns the per-type message and byte counts for messages from the peer.
+  peer_traffic_stats_ptr input_traffic() const {
+    return input_traffic_;
+  }
+
+  /// Returns the per-type message and byte counts for messages to the peer.
+  peer_traffic_stats_ptr output_traffic() const {
+    return output_traffic_;
+  }
+
+  /// Returns the round-trip time measurements for the peer.
+  peer_latency_stats& latency() noexcept {
+    return latency_;
+  }
+
+  /// @copydoc latency
+  const peer_latency_stats& latency() const noexcept {
+    return latency_;
+  }
+
 private:
   /// Indicates whether we have explicitly removed this connection by sending a
   /// BYE message to the peer.
@@ -125,6 +278,15 @@ private:
   /// Stores the subscriptions of the remote peer.
   std::shared_ptr<filter_type> filter_;
 
+  /// Stores the version of `filter_`.
+  lamport_timestamp filter_version_{0};
+
+  /// Stores whether we have requested a full snapshot of the peer filter.
+  bool awaits_filter_snapshot_ = false;
+
+  /// Identifies this peer in the subscription index of the core.
+  detail::subscription_index::handle_type subscription_handle_ = 0;
+
   /// Handle for aborting inputs.
   caf::disposable in_;
 
@@ -150,6 +312,33 @@ private:
 
   /// .
   flow_scope_stats_ptr output_stats_;
+
+  /// Counts how many messages the overflow buffer dropped.
+  overflow_buffer_stats_ptr overflow_stats_;
+
+  /// Counts messages and bytes that we have received from the peer.
+  peer_traffic_stats_ptr input_traffic_;
+
+  /// Counts messages and bytes that we have sent to the peer.
+  peer_traffic_stats_ptr output_traffic_;
+
+  /// Stores the round-trip time measurements.
+  peer_latency_stats latency_;
+
+  /// Maximum number of buffered output messages (0 = disabled).
+  size_t buffer_capacity_ = 0;
+
+  /// Selects what happens when the output buffer overflows.
+  overflow_policy overflow_policy_ = overflow_policy::disconnect;
+
+  /// Counts dropped messages across all peers.
+  caf::telemetry::int_counter* dropped_ = nullptr;
+
+  /// Keeps track of the memory in the output buffers of all peers.
+  memory_accountant_ptr memory_;
+
+  /// Number of pending messages that control messages may overtake.
+  size_t priority_window_ = 0;
 };
 
 using peering_ptr = std::shared_ptr<peering>;
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "broker/internal/flow_sub.hh"
+#include "broker/message.hh"
+
+#include <caf/disposable.hpp>
+#include <caf/flow/op/cold.hpp>
+#include <caf/intrusive_ptr.hpp>
+#include <caf/scheduled_actor.hpp>
+#include <caf/sec.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+namespace broker::internal {
+
+/// Pulls up to `window` messages ahead of the demand of its observer and sorts
+/// them into two lanes: control messages (routing updates, pings, pongs and
+/// commands) and data messages. When the observer signals demand, control
+/// messages overtake pending data messages. Each lane preserves the order of
+/// its messages. The BYE ping of a peering travels in the data lane, because
+/// it must not overtake any message.
+class priority_lanes_sub : public flow_sub<node_message> {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using super = flow_sub<node_message>;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  priority_lanes_sub(caf::flow::coordinator* ctx,
+                     caf::flow::observer<node_message> out, size_t window,
+                     std::vector<std::byte> bye_token)
+    : super(ctx, std::move(out), window), bye_token_(std::move(bye_token)) {
+    // nop
+  }
+
+  // -- implementation of observer_impl<node_message> --------------------------
+
+  void on_next(const node_message& item) override {
+    if (!out_)
+      return;
+    if (demand_ > 0 && control_.empty() && data_.empty()) {
+      --demand_;
+      out_.on_next(item);
+      in_.request(1);
+      return;
+    }
+    if (get_type(item) == packed_message_type::data || is_bye(item))
+      data_.push_back(item);
+    else
+      control_.push_back(item);
+  }
+
+  void on_complete() override {
+    in_ = nullptr;
+    completed_ = true;
+    if (control_.empty() && data_.empty())
+      complete_out();
+  }
+
+  // -- implementation of subscription_impl ------------------------------------
+
+  void request(size_t n) override {
+    demand_ += n;
+    if ((!control_.empty() || !data_.empty() || completed_)
+        && !drain_scheduled_) {
+      drain_scheduled_ = true;
+      ctx_->delay_fn([ptr = caf::intrusive_ptr<priority_lanes_sub>{this}] {
+        ptr->drain();
+      });
+    }
+  }
+
+protected:
+  void clear() override {
+    control_.clear();
+    data_.clear();
+  }
+
+private:
+  /// Checks whether `item` is the BYE ping of the peering.
+  bool is_bye(const node_message& item) const noexcept {
+    if (get_type(item) != packed_message_type::ping)
+      return false;
+    auto [bytes, size] = item->raw_bytes();
+    return std::equal(bytes, bytes + size, bye_token_.begin(),
+                      bye_token_.end());
+  }
+
+  /// Ships buffered messages to the observer, control messages first.
+  void drain() {
+    drain_scheduled_ = false;
+    size_t shipped = 0;
+    while (out_ && demand_ > 0) {
+      auto& lane = !control_.empty() ? control_ : data_;
+      if (lane.empty())
+        break;
+      --demand_;
+      ++shipped;
+      auto item = std::move(lane.front());
+      lane.pop_front();
+      out_.on_next(item);
+    }
+    if (shipped > 0 && in_)
+      in_.request(shipped);
+    if (completed_ && control_.empty() && data_.empty())
+      complete_out();
+  }
+
+  std::vector<std::byte> bye_token_;
+  std::deque<node_message> control_;
+  std::deque<node_message> data_;
+  bool drain_scheduled_ = false;
+};
+
+/// Lets control messages overtake data messages that wait for the observer.
+class priority_lanes : public caf::flow::op::cold<node_message> {
+public:
+  using super = caf::flow::op::cold<node_message>;
+
+  using decorated_type = caf::flow::observable<node_message>;
+
+  priority_lanes(decorated_type decorated, size_t window,
+                 std::vector<std::byte> bye_token)
+    : super(decorated.ctx()),
+      decorated_(std::move(decorated)),
+      window_(window),
+      bye_token_(std::move(bye_token)) {
+    // nop
+  }
+
+  caf::disposable subscribe(caf::flow::observer<node_message> out) override {
+    if (!decorated_) {
+      out.on_error(make_error(caf::sec::too_many_observers,
+                              "priority_lanes may only be subscribed to once"));
+      return {};
+    }
+    auto sub = caf::make_counted<priority_lanes_sub>(this->ctx(), out, window_,
+                                                     std::move(bye_token_));
+    out.on_subscribe(caf::flow::subscription{sub});
+    decorated_.subscribe(caf::flow::observer<node_message>{sub});
+    decorated_ = nullptr;
+    return sub->as_disposable();
+  }
+
+private:
+  decorated_type decorated_;
+  size_t window_;
+  std::vector<std::byte> bye_token_;
+};
+
+/// Utility class for adding @ref priority_lanes to an `observable`.
+struct add_priority_lanes_t {
+  size_t window;
+  std::vector<std::byte> bye_token;
+
+  template <class Observable>
+  auto operator()(Observable&& input) const {
+    auto obs = std::forward<Observable>(input).as_observable();
+    auto ptr = caf::make_counted<priority_lanes>(std::move(obs), window,
+                                                 bye_token);
+    return caf::flow::observable<node_message>{ptr};
+  }
+};
+
+} // namespace broker::internal
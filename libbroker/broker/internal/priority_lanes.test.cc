@@ -0,0 +1,80 @@
+#include "broker/internal/priority_lanes.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include "broker/flow_test_util.test.hh"
+
+using namespace broker;
+
+namespace {
+
+struct fixture : flow_fixture<internal::priority_lanes_sub> {
+  fixture() {
+    init(4, to_bytes("bye"));
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(priority_lanes_tests, fixture)
+
+TEST(control messages overtake pending data messages) {
+  push_data("a");
+  push_command("x");
+  push_data("b");
+  push_command("y");
+  CHECK(out->labels.empty());
+  CHECK_EQUAL(drain(), string_list({"x", "y", "a", "b"}));
+}
+
+TEST(messages bypass the lanes while the observer has demand) {
+  uut->request(2);
+  push_data("a");
+  push_command("x");
+  CHECK_EQUAL(out->labels, string_list({"a", "x"}));
+  push_data("b");
+  push_command("y");
+  CHECK_EQUAL(drain(), string_list({"a", "x", "y", "b"}));
+}
+
+TEST(the BYE ping never overtakes data messages) {
+  push_data("a");
+  push_ping("bye");
+  push_ping("ping");
+  push_command("x");
+  CHECK_EQUAL(drain(), string_list({"ping", "x", "a", "bye"}));
+}
+
+TEST(the lanes pull at most window messages ahead of the demand) {
+  CHECK_EQUAL(in->requested, 4u);
+  push_data("a");
+  push_data("b");
+  push_data("c");
+  push_data("d");
+  CHECK_EQUAL(in->requested, 4u);
+  CHECK_EQUAL(drain(2), string_list({"a", "b"}));
+  CHECK_EQUAL(in->requested, 6u);
+}
+
+TEST(completion waits for all pending messages) {
+  push_data("a");
+  push_command("x");
+  uut->on_complete();
+  CHECK(!out->completed);
+  CHECK_EQUAL(drain(1), string_list({"x"}));
+  CHECK(!out->completed);
+  CHECK_EQUAL(drain(1), string_list({"a"}));
+  CHECK(out->completed);
+}
+
+TEST(disposing drops pending messages and cancels the input) {
+  push_data("a");
+  push_command("x");
+  uut->dispose();
+  ctx->run();
+  CHECK(in->disposed());
+  CHECK(out->completed);
+  CHECK(out->labels.empty());
+}
+
+FIXTURE_SCOPE_END()
@@ -1,5 +1,6 @@
 #include "broker/internal/prometheus.hh"
 
+#include <algorithm>
 #include <memory>
 #include <string_view>
 
@@ -7,7 +8,9 @@
 #include <caf/string_algorithms.hpp>
 
 #include "broker/internal/logger.hh"
+#include "broker/defaults.hh"
 #include "broker/internal/metric_exporter.hh"
+#include "broker/internal/tracer.hh"
 #include "broker/message.hh"
 
 using namespace std::literals;
@@ -21,12 +24,29 @@ using std::string_view;
 // Cap incoming HTTP requests.
 constexpr size_t max_request_size = 512ul * 1024ul;
 
+// Maximum number of bytes we pass to a connection at once when writing a
+// response. Writing large responses in chunks keeps the write buffers small.
+constexpr size_t response_chunk_size = 64ul * 1024ul;
+
 // A GET request for Prometheus metrics.
 constexpr string_view prom_request_start = "GET /metrics HTTP/1.";
 
 // A GET request for JSON-formatted status snapshots.
 constexpr string_view status_request_start = "GET /v1/status/json HTTP/1.";
 
+#ifdef BROKER_ENABLE_TRACING
+
+// POST requests for starting and stopping hot-path tracing.
+constexpr string_view trace_start_request_start =
+  "POST /v1/trace/start HTTP/1.";
+
+constexpr string_view trace_stop_request_start = "POST /v1/trace/stop HTTP/1.";
+
+// A GET request for retrieving hot-path traces.
+constexpr string_view trace_json_request_start = "GET /v1/trace/json HTTP/1.";
+
+#endif
+
 // HTTP response for requests that exceed the size limit.
 constexpr string_view request_too_large =
   "HTTP/1.1 413 Request Entity Too Large\r\n"
@@ -55,6 +75,10 @@ prometheus_actor::prometheus_actor(caf::actor_config& cfg,
   : super(cfg), core_(std::move(core)) {
   filter_ = caf::get_or(config(), "broker.metrics.import.topics",
                         filter_type{});
+  collector_.quantiles(caf::get_or(config(), "broker.metrics.import.quantiles",
+                                   std::vector<double>{}));
+  status_max_age_ = caf::get_or(config(), "broker.metrics.status-max-age",
+                                defaults::metrics::status_max_age);
   add_doorman(std::move(ptr));
 }
 
@@ -62,6 +86,7 @@ prometheus_actor::prometheus_actor(caf::actor_config& cfg,
 
 void prometheus_actor::on_exit() {
   requests_.clear();
+  status_waiters_.clear();
   core_ = nullptr;
   exporter_.reset();
 }
@@ -90,7 +115,8 @@ caf::behavior prometheus_actor::make_behavior() {
     [this](const caf::io::new_data_msg& msg) {
       // Ignore data we're no longer interested in.
       auto iter = requests_.find(msg.handle);
-      if (iter == requests_.end() || iter->second.async_id != 0)
+      if (iter == requests_.end() || iter->second.async_id != 0
+          || iter->second.payload != nullptr)
         return;
       auto& req = iter->second.buf;
       if (req.size() + msg.buf.size() > max_request_size) {
@@ -115,6 +141,26 @@ caf::behavior prometheus_actor::make_behavior() {
         on_status_request(msg.handle);
         return;
       }
+#ifdef BROKER_ENABLE_TRACING
+      if (caf::starts_with(req_str, trace_start_request_start)) {
+        BROKER_INFO("start hot-path tracing");
+        tracer::enable(caf::get_or(config(), "broker.tracing.buffer-size",
+                                   defaults::tracing::buffer_size));
+        on_trace_request(msg.handle, "{}\n");
+        return;
+      }
+      if (caf::starts_with(req_str, trace_stop_request_start)) {
+        BROKER_INFO("stop hot-path tracing");
+        tracer::disable();
+        on_trace_request(msg.handle, "{}\n");
+        return;
+      }
+      if (caf::starts_with(req_str, trace_json_request_start)) {
+        BROKER_DEBUG("serve HTTP request for /v1/trace/json");
+        on_trace_request(msg.handle, tracer::chrome_trace_json());
+        return;
+      }
+#endif
       BROKER_DEBUG("reject unsupported HTTP request: "
                    << std::string{req_str.substr(0, req_str.find("\r\n"sv))});
       write(msg.handle, caf::as_bytes(caf::make_span(request_not_supported)));
@@ -125,6 +171,13 @@ caf::behavior prometheus_actor::make_behavior() {
       requests_[msg.handle].buf.reserve(max_request_size);
       configure_read(msg.handle, caf::io::receive_policy::at_most(1024));
     },
+    [this](const caf::io::data_transferred_msg& msg) {
+      // Write the next chunk once the connection has written the previous one.
+      auto iter = requests_.find(msg.handle);
+      if (iter != requests_.end() && iter->second.payload != nullptr
+          && msg.remaining == 0)
+        write_next_chunk(msg.handle, iter->second);
+    },
     [this](const caf::io::connection_closed_msg& msg) {
       requests_.erase(msg.handle);
       if (num_connections() + num_doormen() == 0)
@@ -171,26 +224,84 @@ void prometheus_actor::on_metrics_request(caf::io::connection_handle hdl) {
   }
   collector_.insert_or_update(exporter_->impl.rows());
   auto text = collector_.prometheus_text();
-  auto payload = caf::as_bytes(caf::make_span(text));
+  auto iter = requests_.find(hdl);
+  if (iter == requests_.end())
+    return;
+  // The text of the collector changes on the next scrape. Hence, we copy it to
+  // a buffer that remains valid until we have streamed it to the client.
+  if (prom_buf_ == nullptr || prom_buf_.use_count() > 1)
+    prom_buf_ = std::make_shared<std::string>();
+  prom_buf_->assign(text.data(), text.size());
+  auto& req = iter->second;
+  req.payload = prom_buf_;
+  req.offset = 0;
+  auto& dst = wr_buf(hdl);
+  dst.insert(dst.end(), hdr.begin(), hdr.end());
+  ack_writes(hdl, true);
+  write_next_chunk(hdl, req);
+}
+
+void prometheus_actor::write_next_chunk(caf::io::connection_handle hdl,
+                                        request_state& req) {
+  BROKER_ASSERT(req.payload != nullptr);
+  const auto& str = *req.payload;
+  auto n = std::min(response_chunk_size, str.size() - req.offset);
+  auto chunk = caf::as_bytes(caf::make_span(str.data() + req.offset, n));
+  auto& dst = wr_buf(hdl);
+  dst.insert(dst.end(), chunk.begin(), chunk.end());
+  req.offset += n;
+  if (req.offset == str.size())
+    flush_and_close(hdl);
+  else
+    flush(hdl);
+}
+
+#ifdef BROKER_ENABLE_TRACING
+
+void prometheus_actor::on_trace_request(caf::io::connection_handle hdl,
+                                        std::string_view json) {
+  auto hdr = caf::as_bytes(caf::make_span(request_ok_json));
+  auto payload = caf::as_bytes(caf::make_span(json));
   auto& dst = wr_buf(hdl);
   dst.insert(dst.end(), hdr.begin(), hdr.end());
   dst.insert(dst.end(), payload.begin(), payload.end());
   flush_and_close(hdl);
 }
 
+#endif
+
 void prometheus_actor::on_status_request(caf::io::connection_handle hdl) {
   auto aid = new_u64_id();
+  requests_[hdl].async_id = aid;
+  // Serve the cached snapshot unless it exceeds the staleness bound.
+  if (status_max_age_.count() > 0 && status_updated_
+      && clock_type::now() - *status_updated_ <= status_max_age_) {
+    write_status(hdl);
+    return;
+  }
+  // Let all requests that arrive in the meantime share one snapshot.
+  status_waiters_.emplace_back(hdl, aid);
+  if (status_waiters_.size() > 1)
+    return;
   request(core_, 5s, atom::get_v, atom::status_v)
     .then(
-      [this, hdl, aid](const table& tbl) { //
-        on_status_request_cb(hdl, aid, tbl);
+      [this](const table& tbl) { //
+        on_status_request_cb(tbl, true);
       },
-      [this, hdl, aid](const caf::error& what) {
+      [this](const caf::error& what) {
         table tbl;
         tbl.emplace(data{"error"s}, data{caf::to_string(what)});
-        on_status_request_cb(hdl, aid, tbl);
+        on_status_request_cb(tbl, false);
       });
-  requests_[hdl].async_id = aid;
+}
+
+void prometheus_actor::write_status(caf::io::connection_handle hdl) {
+  auto hdr = caf::as_bytes(caf::make_span(request_ok_json));
+  auto payload = caf::as_bytes(caf::make_span(json_buf_));
+  auto& dst = wr_buf(hdl);
+  dst.insert(dst.end(), hdr.begin(), hdr.end());
+  dst.insert(dst.end(), payload.begin(), payload.end());
+  flush_and_close(hdl);
 }
 
 namespace {
@@ -334,28 +445,26 @@ private:
 
 } // namespace
 
-void prometheus_actor::on_status_request_cb(caf::io::connection_handle hdl,
-                                            uint64_t async_id,
-                                            const table& res) {
-  // Sanity checking.
-  auto iter = requests_.find(hdl);
-  if (iter == requests_.end())
-    return;
-  auto& req = iter->second;
-  if (req.async_id != async_id)
-    return;
-  // Generate JSON output.
+void prometheus_actor::on_status_request_cb(const table& res, bool cache) {
+  // Generate JSON output once for all waiting requests. The buffer doubles
+  // as cache for subsequent requests.
   json_buf_.clear();
   jsonizer f{json_buf_};
   f(res);
   json_buf_.push_back('\n');
-  // Send result and close connection.
-  auto hdr = caf::as_bytes(caf::make_span(request_ok_json));
-  auto payload = caf::as_bytes(caf::make_span(json_buf_));
-  auto& dst = wr_buf(hdl);
-  dst.insert(dst.end(), hdr.begin(), hdr.end());
-  dst.insert(dst.end(), payload.begin(), payload.end());
-  flush_and_close(hdl);
+  if (cache)
+    status_updated_ = clock_type::now();
+  else
+    status_updated_ = std::nullopt;
+  // Send result and close connections.
+  auto waiters = std::move(status_waiters_);
+  status_waiters_.clear();
+  for (auto& [hdl, async_id] : waiters) {
+    // Skip connections that went away or started a new request.
+    if (auto iter = requests_.find(hdl);
+        iter != requests_.end() && iter->second.async_id == async_id)
+      write_status(hdl);
+  }
 }
 
 } // namespace broker::internal
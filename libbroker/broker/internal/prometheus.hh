@@ -1,6 +1,12 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <caf/actor.hpp>
@@ -12,6 +18,7 @@
 #include "broker/internal/metric_collector.hh"
 #include "broker/internal/metric_exporter.hh"
 #include "broker/internal/metric_scraper.hh"
+#include "broker/time.hh"
 
 namespace broker::internal {
 
@@ -28,9 +35,15 @@ public:
 
   using exporter_state_type = metric_exporter_state<super>;
 
+  using clock_type = std::chrono::steady_clock;
+
   struct request_state {
     uint64_t async_id = 0;
     caf::byte_buffer buf;
+    /// Points to the response while streaming it to the client.
+    std::shared_ptr<const std::string> payload;
+    /// Stores how many bytes of `payload` we have written so far.
+    size_t offset = 0;
   };
 
   // -- constructors, destructors, and assignment operators --------------------
@@ -51,10 +64,24 @@ private:
 
   void on_metrics_request(caf::io::connection_handle hdl);
 
+  /// Writes the next chunk of `req.payload` to the connection and closes the
+  /// connection after writing the last chunk.
+  void write_next_chunk(caf::io::connection_handle hdl, request_state& req);
+
   void on_status_request(caf::io::connection_handle hdl);
 
-  void on_status_request_cb(caf::io::connection_handle hdl, uint64_t async_id,
-                            const table& res);
+#ifdef BROKER_ENABLE_TRACING
+  /// Responds to a request of the tracing API with `json` and closes the
+  /// connection.
+  void on_trace_request(caf::io::connection_handle hdl, std::string_view json);
+#endif
+
+  /// Renders `res` and sends it to all waiting requests.
+  /// @param cache Whether to serve `res` to subsequent requests.
+  void on_status_request_cb(const table& res, bool cache);
+
+  /// Sends the rendered status snapshot and closes the connection.
+  void write_status(caf::io::connection_handle hdl);
 
   /// Caches input per open connection for parsing the HTTP header.
   std::unordered_map<caf::io::connection_handle, request_state> requests_;
@@ -72,8 +99,24 @@ private:
   /// "broker.metrics.export.topic".
   std::unique_ptr<exporter_state_type> exporter_;
 
-  /// Buffer for writing JSON output.
+  /// Buffer for writing JSON output. Holds the last status snapshot.
   std::vector<char> json_buf_;
+
+  /// Time of the last status snapshot in `json_buf_` or `nullopt` if the
+  /// buffer holds no valid snapshot.
+  std::optional<clock_type::time_point> status_updated_;
+
+  /// Maximum age of a cached status snapshot. A value of 0 disables caching.
+  timespan status_max_age_;
+
+  /// Connections that wait for the core to deliver a status snapshot.
+  std::vector<std::pair<caf::io::connection_handle, uint64_t>>
+    status_waiters_;
+
+  /// Buffer for the Prometheus text output. Connections share this buffer
+  /// while streaming the response. We re-use it for the next response unless
+  /// a client is still reading from it.
+  std::shared_ptr<std::string> prom_buf_;
 };
 
 } // namespace broker::internal
@@ -0,0 +1,56 @@
+#include "broker/internal/publish_credit.hh"
+
+namespace broker::internal {
+
+publish_credit::publish_credit(size_t capacity, policy mode)
+  : capacity_(capacity), mode_(mode) {
+  // nop
+}
+
+bool publish_credit::acquire() {
+  if (try_acquire())
+    return true;
+  if (mode_ == policy::drop) {
+    ++dropped_;
+    return false;
+  }
+  std::unique_lock guard{mtx_};
+  ++waiters_;
+  cv_.wait(guard, [this] { return try_acquire(); });
+  --waiters_;
+  return true;
+}
+
+bool publish_credit::try_acquire() noexcept {
+  if (closed_)
+    return true;
+  auto n = in_flight_.load();
+  do {
+    if (n >= capacity_)
+      return false;
+  } while (!in_flight_.compare_exchange_weak(n, n + 1));
+  return true;
+}
+
+void publish_credit::release(size_t n) noexcept {
+  if (closed_)
+    return;
+  // Note: blocked callers register as waiters before checking for credit.
+  //       Hence, they either see the new credit or we see them waiting.
+  auto cur = in_flight_.load();
+  while (!in_flight_.compare_exchange_weak(cur, cur > n ? cur - n : 0)) {
+    // repeat
+  }
+  if (waiters_ > 0) {
+    std::lock_guard guard{mtx_};
+    cv_.notify_all();
+  }
+}
+
+void publish_credit::close() noexcept {
+  closed_ = true;
+  std::lock_guard guard{mtx_};
+  cv_.notify_all();
+}
+
+} // namespace broker::internal
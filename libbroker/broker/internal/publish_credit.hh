@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+namespace broker::internal {
+
+/// Bounds the number of messages that the endpoint sends to the core as
+/// asynchronous messages but the core did not process yet. Each message takes
+/// one credit from the endpoint and the core gives the credit back after
+/// handling the message.
+class publish_credit {
+public:
+  /// Configures what `acquire` does when running out of credit.
+  enum class policy {
+    /// Blocks the caller until the core returns credit.
+    block,
+    /// Rejects the message.
+    drop,
+  };
+
+  publish_credit(size_t capacity, policy mode);
+
+  /// Takes one credit, blocking or failing if none is available depending on
+  /// the policy.
+  /// @returns `true` if the caller may send the message, `false` if the caller
+  ///          must drop it.
+  bool acquire();
+
+  /// Takes one credit if available. Never blocks.
+  bool try_acquire() noexcept;
+
+  /// Returns `n` credits and wakes up blocked callers.
+  void release(size_t n = 1) noexcept;
+
+  /// Disables the limit, e.g., when the core shuts down and will never return
+  /// the credit of messages in its mailbox.
+  void close() noexcept;
+
+  /// Returns the number of messages that did not get credit back yet.
+  size_t in_flight() const noexcept {
+    return in_flight_.load();
+  }
+
+  /// Returns how many messages `acquire` rejected.
+  size_t dropped() const noexcept {
+    return dropped_.load();
+  }
+
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+private:
+  size_t capacity_;
+  policy mode_;
+  std::atomic<size_t> in_flight_{0};
+  std::atomic<size_t> dropped_{0};
+  std::atomic<size_t> waiters_{0};
+  std::atomic<bool> closed_{false};
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
+
+/// @relates publish_credit
+inline bool from_string(std::string_view str, publish_credit::policy& result) {
+  if (str == "block") {
+    result = publish_credit::policy::block;
+    return true;
+  }
+  if (str == "drop") {
+    result = publish_credit::policy::drop;
+    return true;
+  }
+  return false;
+}
+
+using publish_credit_ptr = std::shared_ptr<publish_credit>;
+
+} // namespace broker::internal
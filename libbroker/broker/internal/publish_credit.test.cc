@@ -0,0 +1,66 @@
+#include "broker/internal/publish_credit.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <thread>
+
+using namespace broker;
+
+using internal::publish_credit;
+
+TEST(credit runs out after reaching the capacity) {
+  publish_credit credit{2, publish_credit::policy::block};
+  CHECK(credit.try_acquire());
+  CHECK(credit.try_acquire());
+  CHECK(!credit.try_acquire());
+  CHECK_EQUAL(credit.in_flight(), 2u);
+  credit.release();
+  CHECK_EQUAL(credit.in_flight(), 1u);
+  CHECK(credit.try_acquire());
+}
+
+TEST(releasing never underflows) {
+  publish_credit credit{2, publish_credit::policy::block};
+  CHECK(credit.try_acquire());
+  credit.release(5);
+  CHECK_EQUAL(credit.in_flight(), 0u);
+}
+
+TEST(the drop policy rejects messages without credit) {
+  publish_credit credit{1, publish_credit::policy::drop};
+  CHECK(credit.acquire());
+  CHECK(!credit.acquire());
+  CHECK(!credit.acquire());
+  CHECK_EQUAL(credit.dropped(), 2u);
+  credit.release();
+  CHECK(credit.acquire());
+  CHECK_EQUAL(credit.dropped(), 2u);
+}
+
+TEST(the block policy waits for credit) {
+  publish_credit credit{1, publish_credit::policy::block};
+  CHECK(credit.acquire());
+  std::thread releaser{[&credit] { credit.release(); }};
+  CHECK(credit.acquire());
+  releaser.join();
+  CHECK_EQUAL(credit.in_flight(), 1u);
+  CHECK_EQUAL(credit.dropped(), 0u);
+}
+
+TEST(closing disables the limit) {
+  publish_credit credit{1, publish_credit::policy::block};
+  CHECK(credit.acquire());
+  std::thread closer{[&credit] { credit.close(); }};
+  CHECK(credit.acquire());
+  closer.join();
+  CHECK(credit.try_acquire());
+}
+
+TEST(policies have string representations) {
+  auto mode = publish_credit::policy::block;
+  CHECK(from_string("drop", mode));
+  CHECK(mode == publish_credit::policy::drop);
+  CHECK(from_string("block", mode));
+  CHECK(mode == publish_credit::policy::block);
+  CHECK(!from_string("wait", mode));
+}
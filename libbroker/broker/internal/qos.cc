@@ -0,0 +1,127 @@
+#include "broker/internal/qos.hh"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std::literals;
+
+namespace broker::internal {
+
+namespace {
+
+bool parse_number(std::string_view str, double& result) {
+  if (str.empty())
+    return false;
+  std::string tmp{str};
+  char* end = nullptr;
+  result = std::strtod(tmp.c_str(), &end);
+  return end == tmp.c_str() + tmp.size() && result >= 0;
+}
+
+} // namespace
+
+std::string_view to_string(qos_priority x) noexcept {
+  switch (x) {
+    case qos_priority::bulk:
+      return "bulk";
+    case qos_priority::critical:
+      return "critical";
+    default:
+      return "normal";
+  }
+}
+
+bool qos_class::take(clock_type::time_point now) noexcept {
+  if (rate <= 0)
+    return true;
+  if (refilled == clock_type::time_point{}) {
+    tokens = burst;
+  } else if (now > refilled) {
+    auto elapsed = std::chrono::duration<double>{now - refilled}.count();
+    tokens = std::min(burst, tokens + elapsed * rate);
+  }
+  refilled = now;
+  if (tokens < 1)
+    return false;
+  tokens -= 1;
+  return true;
+}
+
+bool qos_class::parse(std::string_view str, qos_class& result) {
+  auto eq = str.rfind('=');
+  if (eq == std::string_view::npos || eq == 0)
+    return false;
+  result = qos_class{};
+  result.prefix = std::string{str.substr(0, eq)};
+  auto rest = str.substr(eq + 1);
+  auto next = [&rest] {
+    auto pos = rest.find(':');
+    auto field = rest.substr(0, pos);
+    rest = pos == std::string_view::npos ? std::string_view{}
+                                         : rest.substr(pos + 1);
+    return field;
+  };
+  if (!from_string(next(), result.priority))
+    return false;
+  if (!rest.empty() && !parse_number(next(), result.rate))
+    return false;
+  result.burst = result.rate;
+  if (!rest.empty() && !parse_number(next(), result.burst))
+    return false;
+  return rest.empty() && (result.rate == 0 || result.burst >= 1);
+}
+
+qos_table::qos_table(std::vector<qos_class> classes,
+                     metric_factory::int_counter_family* family)
+  : classes_(std::move(classes)) {
+  std::stable_sort(classes_.begin(), classes_.end(),
+                   [](const qos_class& x, const qos_class& y) {
+                     return x.prefix.size() > y.prefix.size();
+                   });
+  if (family == nullptr)
+    return;
+  for (auto& x : classes_) {
+    x.rate_counter = family->get_or_add({{"class", x.prefix},
+                                         {"reason", "rate"}});
+    x.budget_counter = family->get_or_add({{"class", x.prefix},
+                                           {"reason", "budget"}});
+  }
+}
+
+qos_class* qos_table::find(std::string_view topic) noexcept {
+  for (auto& x : classes_)
+    if (topic.compare(0, x.prefix.size(), x.prefix) == 0)
+      return &x;
+  return nullptr;
+}
+
+bool qos_table::admit(const node_message& msg,
+                      clock_type::time_point now) noexcept {
+  if (get_type(msg) != envelope_type::data)
+    return true;
+  auto* cls = find(msg->topic());
+  if (cls == nullptr || cls->take(now))
+    return true;
+  ++cls->rate_dropped;
+  if (cls->rate_counter)
+    cls->rate_counter->inc();
+  return false;
+}
+
+vector qos_table::snapshot() const {
+  vector result;
+  result.reserve(classes_.size());
+  for (const auto& x : classes_) {
+    table entry;
+    entry.emplace("prefix"s, x.prefix);
+    entry.emplace("priority"s, std::string{to_string(x.priority)});
+    entry.emplace("rate"s, x.rate);
+    entry.emplace("burst"s, x.burst);
+    entry.emplace("rate-dropped"s, x.rate_dropped);
+    entry.emplace("budget-dropped"s, x.budget_dropped);
+    result.emplace_back(std::move(entry));
+  }
+  return result;
+}
+
+} // namespace broker::internal
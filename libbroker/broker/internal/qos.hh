@@ -0,0 +1,124 @@
+#pragma once
+
+#include "broker/data.hh"
+#include "broker/internal/metric_factory.hh"
+#include "broker/message.hh"
+
+#include <caf/telemetry/counter.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace broker::internal {
+
+/// Decides which data messages survive when Broker runs out of resources.
+enum class qos_priority {
+  /// Sheds messages as soon as the peer buffers hold half of the memory
+  /// budget.
+  bulk,
+  /// Sheds messages once the peer buffers exhaust the memory budget.
+  normal,
+  /// Never sheds messages because of the memory budget.
+  critical,
+};
+
+/// @relates qos_priority
+inline bool from_string(std::string_view str, qos_priority& result) {
+  if (str == "bulk") {
+    result = qos_priority::bulk;
+    return true;
+  }
+  if (str == "normal") {
+    result = qos_priority::normal;
+    return true;
+  }
+  if (str == "critical") {
+    result = qos_priority::critical;
+    return true;
+  }
+  return false;
+}
+
+/// @relates qos_priority
+std::string_view to_string(qos_priority x) noexcept;
+
+/// A class of data messages that share a topic prefix, a priority and an
+/// optional rate limit.
+struct qos_class {
+  using clock_type = std::chrono::steady_clock;
+
+  /// Selects all topics that start with this prefix.
+  std::string prefix;
+
+  qos_priority priority = qos_priority::normal;
+
+  /// Maximum number of messages per second (0 = unlimited).
+  double rate = 0;
+
+  /// Maximum number of messages above `rate` in a burst.
+  double burst = 0;
+
+  /// Available tokens of the token bucket.
+  double tokens = 0;
+
+  /// Last time the token bucket got refilled.
+  clock_type::time_point refilled;
+
+  /// Counts messages that exceeded the rate limit.
+  int64_t rate_dropped = 0;
+
+  /// Counts messages that the memory budget shed.
+  int64_t budget_dropped = 0;
+
+  caf::telemetry::int_counter* rate_counter = nullptr;
+
+  caf::telemetry::int_counter* budget_counter = nullptr;
+
+  /// Takes a token from the bucket.
+  /// @returns `false` if the message exceeds the rate limit.
+  bool take(clock_type::time_point now) noexcept;
+
+  /// Parses a class from a string in the format
+  /// `<prefix>=<priority>[:<rate>[:<burst>]]`. The burst defaults to the rate.
+  static bool parse(std::string_view str, qos_class& result);
+};
+
+/// Maps topics to QoS classes. A topic belongs to the class with the longest
+/// matching prefix. Topics without a matching class have normal priority and
+/// no rate limit.
+class qos_table {
+public:
+  using clock_type = qos_class::clock_type;
+
+  /// Labels the metrics of each class and registers them in `family`.
+  qos_table(std::vector<qos_class> classes,
+            metric_factory::int_counter_family* family);
+
+  /// Returns the class for `topic` or `nullptr`.
+  qos_class* find(std::string_view topic) noexcept;
+
+  /// Checks whether `msg` stays within the rate limit of its class. Always
+  /// admits control messages.
+  bool admit(const node_message& msg, clock_type::time_point now) noexcept;
+
+  /// Returns a list with the configuration and counters of each class.
+  vector snapshot() const;
+
+  size_t size() const noexcept {
+    return classes_.size();
+  }
+
+private:
+  /// Sorted by descending prefix length for finding the longest match first.
+  std::vector<qos_class> classes_;
+};
+
+/// @relates qos_table
+using qos_table_ptr = std::shared_ptr<qos_table>;
+
+} // namespace broker::internal
@@ -0,0 +1,106 @@
+#include "broker/internal/qos.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include "broker/internal/memory_accountant.hh"
+
+#include <array>
+
+using namespace broker;
+using namespace std::literals;
+
+using internal::memory_accountant;
+using internal::qos_class;
+using internal::qos_priority;
+using internal::qos_table;
+
+namespace {
+
+qos_class parse(std::string_view str) {
+  qos_class result;
+  if (!qos_class::parse(str, result))
+    FAIL("failed to parse " << str);
+  return result;
+}
+
+std::vector<qos_class> parse_all(std::vector<std::string_view> strs) {
+  std::vector<qos_class> result;
+  for (auto str : strs)
+    result.emplace_back(parse(str));
+  return result;
+}
+
+} // namespace
+
+TEST(classes have a string representation) {
+  auto x = parse("zeek/diag=bulk:100:200");
+  CHECK_EQUAL(x.prefix, "zeek/diag");
+  CHECK(x.priority == qos_priority::bulk);
+  CHECK_EQUAL(x.rate, 100.0);
+  CHECK_EQUAL(x.burst, 200.0);
+  auto y = parse("zeek/cluster=critical");
+  CHECK(y.priority == qos_priority::critical);
+  CHECK_EQUAL(y.rate, 0.0);
+  auto z = parse("a=normal:10");
+  CHECK_EQUAL(z.burst, 10.0);
+  qos_class tmp;
+  CHECK(!qos_class::parse("zeek/diag", tmp));
+  CHECK(!qos_class::parse("=bulk", tmp));
+  CHECK(!qos_class::parse("a=urgent", tmp));
+  CHECK(!qos_class::parse("a=bulk:fast", tmp));
+  CHECK(!qos_class::parse("a=bulk:-1", tmp));
+  CHECK(!qos_class::parse("a=bulk:1:2:3", tmp));
+  CHECK(!qos_class::parse("a=bulk:10:0.5", tmp));
+}
+
+TEST(topics belong to the class with the longest prefix) {
+  qos_table uut{parse_all({"zeek=normal", "zeek/diag=bulk",
+                           "zeek/diag/critical=critical"}),
+                nullptr};
+  CHECK(uut.find("zeek/events")->prefix == "zeek");
+  CHECK(uut.find("zeek/diag/stats")->prefix == "zeek/diag");
+  CHECK(uut.find("zeek/diag/critical/x")->prefix == "zeek/diag/critical");
+  CHECK(uut.find("other") == nullptr);
+}
+
+TEST(the token bucket limits the rate of data messages) {
+  qos_table uut{parse_all({"diag=bulk:10:2"}), nullptr};
+  auto t0 = qos_table::clock_type::now();
+  node_message msg = make_data_message("diag/x", data{1});
+  // The bucket starts full.
+  CHECK(uut.admit(msg, t0));
+  CHECK(uut.admit(msg, t0));
+  CHECK(!uut.admit(msg, t0));
+  // After 100ms, the bucket has one new token.
+  CHECK(uut.admit(msg, t0 + 100ms));
+  CHECK(!uut.admit(msg, t0 + 100ms));
+  // Other topics and control messages are not limited.
+  std::array<std::byte, 4> token{};
+  node_message ping = make_ping_message(endpoint_id::random(),
+                                        endpoint_id::random(), token.data(),
+                                        token.size());
+  node_message other = make_data_message("other", data{1});
+  for (int i = 0; i < 10; ++i) {
+    CHECK(uut.admit(ping, t0));
+    CHECK(uut.admit(other, t0));
+  }
+  CHECK_EQUAL(uut.find("diag")->rate_dropped, 2);
+}
+
+TEST(priorities adjust the memory budget) {
+  auto qos = std::make_shared<qos_table>(parse_all({"bulk=bulk",
+                                                    "critical=critical"}),
+                                         nullptr);
+  memory_accountant uut{100, nullptr, nullptr};
+  uut.qos(qos);
+  node_message bulk = make_data_message("bulk/x", data{1});
+  node_message normal = make_data_message("normal/x", data{1});
+  node_message critical = make_data_message("critical/x", data{1});
+  uut.charge(60);
+  CHECK(!uut.admits(bulk, 1));
+  CHECK(uut.admits(normal, 40));
+  CHECK(!uut.admits(normal, 41));
+  CHECK(uut.admits(critical, 1000));
+  CHECK_EQUAL(uut.shed(), 2u);
+  CHECK_EQUAL(qos->find("bulk/x")->budget_dropped, 1);
+}
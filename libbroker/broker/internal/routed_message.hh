@@ -0,0 +1,85 @@
+#pragma once
+
+#include "broker/message.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace broker::internal {
+
+/// A set of peer slots, i.e., subscription handles of peers, that should
+/// receive a message. The first 64 slots are stored inline. Larger slots
+/// spill into a heap-allocated extension that all copies share.
+class destination_mask {
+public:
+  /// Number of slots that fit into the inline storage.
+  static constexpr size_t inline_slots = 64;
+
+  /// Returns whether `slot` is part of the set.
+  bool test(size_t slot) const noexcept {
+    if (slot < inline_slots)
+      return (bits_ >> slot) & 1u;
+    auto index = slot / inline_slots - 1;
+    return ext_ && index < ext_->size()
+           && (((*ext_)[index] >> (slot % inline_slots)) & 1u);
+  }
+
+  /// Adds `slot` to the set.
+  /// @pre no other mask shares the extension of this mask.
+  void set(size_t slot) {
+    if (slot < inline_slots) {
+      bits_ |= uint64_t{1} << slot;
+      return;
+    }
+    auto index = slot / inline_slots - 1;
+    if (!ext_)
+      ext_ = std::make_shared<std::vector<uint64_t>>();
+    if (index >= ext_->size())
+      ext_->resize(index + 1);
+    (*ext_)[index] |= uint64_t{1} << (slot % inline_slots);
+  }
+
+  /// Removes `slot` from the set.
+  /// @pre no other mask shares the extension of this mask.
+  void reset(size_t slot) noexcept {
+    if (slot < inline_slots) {
+      bits_ &= ~(uint64_t{1} << slot);
+      return;
+    }
+    auto index = slot / inline_slots - 1;
+    if (ext_ && index < ext_->size())
+      (*ext_)[index] &= ~(uint64_t{1} << (slot % inline_slots));
+  }
+
+  /// Returns whether the set is empty.
+  bool none() const noexcept {
+    if (bits_ != 0)
+      return false;
+    if (ext_)
+      for (auto word : *ext_)
+        if (word != 0)
+          return false;
+    return true;
+  }
+
+private:
+  uint64_t bits_ = 0;
+  std::shared_ptr<std::vector<uint64_t>> ext_;
+};
+
+/// A message that passed the central merge point of the core, bundled with the
+/// precomputed sets of peers and local subscribers that receive it.
+struct routed_message {
+  /// The message itself.
+  node_message msg;
+
+  /// The peers that receive `msg`.
+  destination_mask peers;
+
+  /// The local subscribers that receive `msg`.
+  destination_mask locals;
+};
+
+} // namespace broker::internal
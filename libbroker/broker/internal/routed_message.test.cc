@@ -0,0 +1,60 @@
+#include "broker/internal/routed_message.hh"
+
+#include "broker/broker-test.test.hh"
+
+using namespace broker;
+
+using internal::destination_mask;
+
+TEST(destination masks start empty) {
+  destination_mask uut;
+  CHECK(uut.none());
+  CHECK(!uut.test(0));
+  CHECK(!uut.test(63));
+  CHECK(!uut.test(64));
+  CHECK(!uut.test(1000));
+}
+
+TEST(destination masks store the first slots inline) {
+  destination_mask uut;
+  uut.set(0);
+  uut.set(63);
+  CHECK(uut.test(0));
+  CHECK(!uut.test(1));
+  CHECK(uut.test(63));
+  CHECK(!uut.test(64));
+  uut.reset(0);
+  CHECK(!uut.test(0));
+  CHECK(!uut.none());
+  uut.reset(63);
+  CHECK(uut.none());
+}
+
+TEST(destination masks spill larger slots into an extension) {
+  destination_mask uut;
+  uut.set(64);
+  uut.set(200);
+  CHECK(!uut.none());
+  CHECK(uut.test(64));
+  CHECK(uut.test(200));
+  CHECK(!uut.test(0));
+  CHECK(!uut.test(65));
+  CHECK(!uut.test(199));
+  CHECK(!uut.test(1000));
+  uut.reset(64);
+  uut.reset(200);
+  CHECK(uut.none());
+  MESSAGE("resetting a slot beyond the extension has no effect");
+  uut.reset(1000);
+  CHECK(uut.none());
+}
+
+TEST(copies of destination masks see the same slots) {
+  destination_mask uut;
+  uut.set(3);
+  uut.set(130);
+  auto copy = uut;
+  CHECK(copy.test(3));
+  CHECK(copy.test(130));
+  CHECK(!copy.test(4));
+}
@@ -80,11 +80,23 @@ void store_actor_state::init(endpoint_id this_endpoint, endpoint::clock* clock,
   auto& cfg = self->system().config();
   tick_interval = caf::get_or(cfg, "broker.store.tick-interval",
                               defaults::store::tick_interval);
+  idle_ticks = std::max(caf::get_or(cfg, "broker.store.idle-ticks",
+                                    defaults::store::idle_ticks),
+                        size_t{1});
+  hibernate_after = caf::get_or(cfg, "broker.store.hibernate-after",
+                                defaults::store::hibernate_after);
+  batch_events = caf::get_or(cfg, "broker.store.batch-events",
+                             defaults::store::batch_events);
+  on_demand_events = caf::get_or(cfg, "broker.store.on-demand-events",
+                                 defaults::store::on_demand_events);
   self //
     ->make_observable()
     .from_resource(std::move(in_res))
     .subscribe(caf::flow::make_observer(
-      [this](const command_message& msg) { dispatch(msg); },
+      [this](const command_message& msg) {
+        wakeup();
+        dispatch(msg);
+      },
       [this](const caf::error& what) { self->quit(what); },
       [this] { self->quit(); }));
   out.as_observable().subscribe(std::move(out_res));
@@ -92,13 +104,69 @@ void store_actor_state::init(endpoint_id this_endpoint, endpoint::clock* clock,
 
 // -- event signaling ----------------------------------------------------------
 
+bool store_actor_state::wants_event(const data& key) const {
+  if (on_demand_events && !has_event_subscribers)
+    return false;
+  if (event_key_prefixes.empty())
+    return true;
+  auto str = get_if<std::string>(key);
+  if (str == nullptr)
+    return false;
+  auto has_prefix = [str](const std::string& prefix) {
+    return str->compare(0, prefix.size(), prefix) == 0;
+  };
+  return std::any_of(event_key_prefixes.begin(), event_key_prefixes.end(),
+                     has_prefix);
+}
+
+void store_actor_state::update_event_key_prefixes() {
+  event_key_prefixes.clear();
+  for (const auto& [ptr, prefixes] : event_filters) {
+    if (prefixes.empty()) {
+      event_key_prefixes.clear();
+      return;
+    }
+    event_key_prefixes.insert(event_key_prefixes.end(), prefixes.begin(),
+                              prefixes.end());
+  }
+  std::sort(event_key_prefixes.begin(), event_key_prefixes.end());
+  auto e = std::unique(event_key_prefixes.begin(), event_key_prefixes.end());
+  event_key_prefixes.erase(e, event_key_prefixes.end());
+}
+
+void store_actor_state::publish_event(vector&& xs) {
+  if (batch_events) {
+    pending_events.emplace_back(std::move(xs));
+    return;
+  }
+  self->send(core, atom::publish_v, atom::local_v,
+             make_data_message(dst, data{std::move(xs)}));
+}
+
+void store_actor_state::tick_events() {
+  if (!pending_events.empty()) {
+    vector xs;
+    xs.reserve(3);
+    xs.emplace_back("batch"s);
+    xs.emplace_back(store_name);
+    xs.emplace_back(std::move(pending_events));
+    pending_events = vector{};
+    self->send(core, atom::publish_v, atom::local_v,
+               make_data_message(dst, data{std::move(xs)}));
+  }
+  if (on_demand_events)
+    self->request(core, caf::infinite, atom::get_v, atom::subscriptions_v, dst)
+      .then([this](bool value) { has_event_subscribers = value; });
+}
+
 void store_actor_state::emit_insert_event(const data& key, const data& value,
                                           const std::optional<timespan>& expiry,
                                           const entity_id& publisher) {
+  if (!wants_event(key))
+    return;
   vector xs;
   fill_vector(xs, "insert"s, store_name, key, value, expiry, publisher);
-  self->send(core, atom::publish_v, atom::local_v,
-             make_data_message(dst, data{std::move(xs)}));
+  publish_event(std::move(xs));
 }
 
 void store_actor_state::emit_update_event(const data& key,
@@ -106,27 +174,30 @@ void store_actor_state::emit_update_event(const data& key,
                                           const data& new_value,
                                           const std::optional<timespan>& expiry,
                                           const entity_id& publisher) {
+  if (!wants_event(key))
+    return;
   vector xs;
   fill_vector(xs, "update"s, store_name, key, old_value, new_value, expiry,
               publisher);
-  self->send(core, atom::publish_v, atom::local_v,
-             make_data_message(dst, data{std::move(xs)}));
+  publish_event(std::move(xs));
 }
 
 void store_actor_state::emit_erase_event(const data& key,
                                          const entity_id& publisher) {
+  if (!wants_event(key))
+    return;
   vector xs;
   fill_vector(xs, "erase"s, store_name, key, publisher);
-  self->send(core, atom::publish_v, atom::local_v,
-             make_data_message(dst, data{std::move(xs)}));
+  publish_event(std::move(xs));
 }
 
 void store_actor_state::emit_expire_event(const data& key,
                                           const entity_id& publisher) {
+  if (!wants_event(key))
+    return;
   vector xs;
   fill_vector(xs, "expire"s, store_name, key, publisher);
-  self->send(core, atom::publish_v, atom::local_v,
-             make_data_message(dst, data{std::move(xs)}));
+  publish_event(std::move(xs));
 }
 
 // -- callbacks for the behavior -----------------------------------------------
@@ -147,6 +218,59 @@ void store_actor_state::on_down_msg(const caf::actor_addr& source,
   }
 }
 
+// -- tick scheduling ----------------------------------------------------------
+
+void store_actor_state::schedule_tick() {
+  last_tick = clock->now();
+  auto ticks = size_t{1};
+  if (idle_ticks > 1 && idle_callbacks.empty()) {
+    auto n = static_cast<timespan::rep>(idle_ticks);
+    if (quiescent(last_tick + tick_interval * n))
+      ticks = idle_ticks;
+  }
+  scheduled_ticks = ticks;
+  sleeping = ticks > 1;
+  if (!sleeping) {
+    idle_since.reset();
+    hibernating = false;
+  } else if (!idle_since) {
+    idle_since = last_tick;
+  } else if (!hibernating && hibernate_after.count() > 0
+             && last_tick - *idle_since >= hibernate_after) {
+    BROKER_DEBUG(store_name << "hibernates");
+    hibernating = true;
+    hibernate();
+  }
+  auto delay = tick_interval * static_cast<timespan::rep>(ticks);
+  send_later(self, delay, caf::make_message(atom::tick_v, ++tick_generation));
+}
+
+void store_actor_state::wakeup() {
+  if (!sleeping)
+    return;
+  sleeping = false;
+  idle_since.reset();
+  hibernating = false;
+  send_later(self, tick_interval,
+             caf::make_message(atom::tick_v, ++tick_generation));
+}
+
+void store_actor_state::hibernate() {
+  pending_events.shrink_to_fit();
+  local_requests.rehash(0);
+  idle_callbacks.shrink_to_fit();
+}
+
+size_t store_actor_state::due_ticks(uint64_t generation) const noexcept {
+  if (generation != tick_generation)
+    return 0;
+  // After an early wakeup, we only run the ticks that actually passed.
+  auto elapsed = (clock->now() - last_tick) / tick_interval;
+  if (elapsed < 1)
+    return 1;
+  return std::min(static_cast<size_t>(elapsed), scheduled_ticks);
+}
+
 // -- convenience functions ----------------------------------------------------
 
 void store_actor_state::send_later(const caf::actor& hdl, timespan delay,
@@ -113,15 +113,42 @@ public:
       [this](atom::decrement, const detail::shared_store_state_ptr& ptr) {
         auto& xs = attached_states;
         if (auto i = xs.find(ptr); i != xs.end())
-          if (--(i->second) == 0)
+          if (--(i->second) == 0) {
             xs.erase(i);
+            if (event_filters.erase(ptr) > 0)
+              update_event_key_prefixes();
+          }
       },
       [this](atom::get, atom::status) { return status_snapshot(); },
+      [this](atom::subscribe, atom::keys, detail::shared_store_state_ptr ptr,
+             const vector& prefixes) {
+        if (attached_states.count(ptr) == 0)
+          return;
+        auto& xs = event_filters[std::move(ptr)];
+        xs.clear();
+        for (const auto& prefix : prefixes)
+          if (auto str = get_if<std::string>(prefix))
+            xs.emplace_back(*str);
+        update_event_key_prefixes();
+      },
     };
   }
 
   // -- event signaling --------------------------------------------------------
 
+  /// Returns whether the state should emit an event for `key`.
+  bool wants_event(const data& key) const;
+
+  /// Recomputes `event_key_prefixes` from `event_filters`.
+  void update_event_key_prefixes();
+
+  /// Publishes all batched events and, if configured, asks the core whether
+  /// any local subscriber still listens to store events. Called once per tick.
+  void tick_events();
+
+  /// Publishes an event or adds it to `pending_events`.
+  void publish_event(vector&& xs);
+
   /// Emits an `insert` event to topics::store_events subscribers.
   void emit_insert_event(const data& key, const data& value,
                          const std::optional<timespan>& expiry,
@@ -168,6 +195,27 @@ public:
     emit_expire_event(msg.key, msg.publisher);
   }
 
+  // -- tick scheduling --------------------------------------------------------
+
+  /// Schedules the next tick. Skips up to `idle_ticks` ticks at once if the
+  /// store has no work to do until then.
+  void schedule_tick();
+
+  /// Makes sure that a store that skips ticks wakes up after one tick
+  /// interval again. Called on each incoming message or local command.
+  void wakeup();
+
+  /// Returns how many ticks to run for a tick message with `generation` or 0
+  /// if the message is stale.
+  size_t due_ticks(uint64_t generation) const noexcept;
+
+  /// Checks whether the store has no pending work before `until`.
+  virtual bool quiescent(timestamp until) const noexcept = 0;
+
+  /// Releases memory that the store only needs while active. Called once
+  /// after the store had no pending work for `hibernate_after`.
+  virtual void hibernate();
+
   // -- callbacks for the behavior ---------------------------------------------
 
   virtual void dispatch(const command_message& msg) = 0;
@@ -225,6 +273,31 @@ public:
   /// Caches the configuration parameter `broker.store.tick-interval`.
   caf::timespan tick_interval;
 
+  /// Caches the configuration parameter `broker.store.idle-ticks`.
+  size_t idle_ticks = defaults::store::idle_ticks;
+
+  /// Identifies the currently scheduled tick message. The store ignores tick
+  /// messages with any other generation.
+  uint64_t tick_generation = 0;
+
+  /// Stores when the store scheduled its last tick message.
+  timestamp last_tick;
+
+  /// Stores how many ticks the scheduled tick message covers.
+  size_t scheduled_ticks = 1;
+
+  /// Stores whether the store currently skips ticks.
+  bool sleeping = false;
+
+  /// Caches the configuration parameter `broker.store.hibernate-after`.
+  timespan hibernate_after = defaults::store::hibernate_after;
+
+  /// Stores since when the store has no pending work.
+  std::optional<timestamp> idle_since;
+
+  /// Stores whether the store released its memory for the current idle time.
+  bool hibernating = false;
+
   /// Stores the name, i.e., the prefix of the topic.
   std::string store_name;
 
@@ -237,6 +310,28 @@ public:
   /// Destination for emitted events.
   topic dst;
 
+  /// Caches the configuration parameter `broker.store.batch-events`.
+  bool batch_events = false;
+
+  /// Caches the configuration parameter `broker.store.on-demand-events`.
+  bool on_demand_events = false;
+
+  /// Stores whether any local subscriber listens to `dst`. Only updated when
+  /// `on_demand_events` is `true`.
+  bool has_event_subscribers = true;
+
+  /// Stores the key prefixes that each attached store object selected via
+  /// `store::filter_events`. An empty list selects all keys.
+  std::unordered_map<detail::shared_store_state_ptr, std::vector<std::string>>
+    event_filters;
+
+  /// Restricts events to string keys that begin with one of the prefixes. An
+  /// empty list selects all keys. Contains the union of all `event_filters`.
+  std::vector<std::string> event_key_prefixes;
+
+  /// Collects events until the next tick if `batch_events` is `true`.
+  vector pending_events;
+
   /// Stores requests from local actors.
   std::unordered_map<local_request_key, caf::response_promise> local_requests;
 
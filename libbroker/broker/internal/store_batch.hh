@@ -0,0 +1,48 @@
+#pragma once
+
+#include "broker/data.hh"
+#include "broker/internal_command.hh"
+#include "broker/store.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace broker::internal {
+
+/// Stores the modifications of a @ref store::batch.
+struct store_batch_entries {
+  std::vector<batch_entry> entries;
+};
+
+/// Bundles the requests of a pipelined @ref store::proxy into a single message
+/// to the store actor.
+struct store_request_batch {
+  /// Selects the operation for a single request.
+  enum class kind : uint8_t {
+    get,
+    exists,
+  };
+
+  /// A single request in the batch.
+  struct request {
+    kind op;
+    data key;
+    request_id id;
+  };
+
+  /// Stores all requests in the order of their creation.
+  std::vector<request> requests;
+
+  size_t size() const noexcept {
+    return requests.size();
+  }
+};
+
+/// Bundles all responses to a @ref store_request_batch in the order of the
+/// requests.
+struct store_response_batch {
+  std::vector<store::response> responses;
+};
+
+} // namespace broker::internal
@@ -0,0 +1,398 @@
+#include "broker/internal/topic_log.hh"
+
+#include "broker/config.hh"
+#include "broker/detail/filesystem.hh"
+#include "broker/detail/prefix_matcher.hh"
+#include "broker/internal/logger.hh"
+#include "broker/internal/wire_format.hh"
+
+#include <caf/byte_span.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#ifndef BROKER_WINDOWS
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace broker::internal {
+
+namespace {
+
+// Identifies segment files of a topic log.
+constexpr char magic[] = {'B', 'R', 'T', 'O', 'P', 'L', 'G', '1'};
+
+static_assert(sizeof(magic) == topic_log::file_header_size);
+
+int64_t unix_time_ns() {
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+std::string head_file_name(const std::string& directory) {
+  auto result = directory;
+  if (!result.empty() && result.back() != '/')
+    result += '/';
+  result += "head";
+  return result;
+}
+
+} // namespace
+
+/// A memory-mapped segment file.
+struct topic_log::segment {
+  uint64_t seq = 0;
+  int fd = -1;
+  std::byte* buf = nullptr;
+  size_t capacity = 0;
+
+  /// Position of the end marker.
+  size_t size = 0;
+
+  /// Number of frames in this segment.
+  size_t frames = 0;
+
+  /// Offset of the first frame if `frames > 0`.
+  uint64_t first_offset = 0;
+
+  /// Offset of the last frame if `frames > 0`.
+  uint64_t last_offset = 0;
+
+  /// Timestamp of the last frame if `frames > 0`.
+  int64_t last_timestamp = 0;
+
+  ~segment() {
+    close();
+  }
+
+  bool empty() const noexcept {
+    return frames == 0;
+  }
+
+  /// Reads the header of the frame at `pos`. Returns `false` at the end.
+  bool read_frame(size_t pos, uint32_t& len, uint64_t& offset,
+                  int64_t& ts) const noexcept {
+    if (pos + frame_header_size > capacity)
+      return false;
+    memcpy(&len, buf + pos, 4);
+    if (len == 0 || pos + frame_header_size + len > capacity)
+      return false;
+    memcpy(&offset, buf + pos + 4, 8);
+    memcpy(&ts, buf + pos + 12, 8);
+    return true;
+  }
+
+  /// Checks whether a frame with a payload of `len` bytes still fits.
+  bool fits(size_t len) const noexcept {
+    return size + frame_header_size + len <= capacity;
+  }
+
+  /// Stores a frame at the end of the segment.
+  /// @pre `fits(len)`
+  void write_frame(const std::byte* payload, uint32_t len, uint64_t offset,
+                   int64_t ts) noexcept {
+    auto* ptr = buf + size;
+    memcpy(ptr + 4, &offset, 8);
+    memcpy(ptr + 12, &ts, 8);
+    memcpy(ptr + frame_header_size, payload, len);
+    // Write the size last to make the frame visible only once complete.
+    memcpy(ptr, &len, 4);
+    size += frame_header_size + len;
+    if (frames++ == 0)
+      first_offset = offset;
+    last_offset = offset;
+    last_timestamp = ts;
+  }
+
+#ifndef BROKER_WINDOWS
+
+  /// Creates a new segment file with `new_capacity` bytes.
+  bool create(const std::string& path, size_t new_capacity) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      BROKER_ERROR("failed to create segment file:" << path << ":"
+                                                    << strerror(errno));
+      return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(new_capacity)) != 0) {
+      BROKER_ERROR("failed to resize segment file:" << path << ":"
+                                                    << strerror(errno));
+      close();
+      return false;
+    }
+    if (!map(new_capacity)) {
+      close();
+      return false;
+    }
+    memcpy(buf, magic, file_header_size);
+    size = file_header_size;
+    return true;
+  }
+
+  /// Maps an existing segment file and scans its frames.
+  bool recover(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+      BROKER_ERROR("failed to open segment file:" << path << ":"
+                                                  << strerror(errno));
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0
+        || static_cast<size_t>(st.st_size) <= file_header_size
+        || !map(static_cast<size_t>(st.st_size))
+        || memcmp(buf, magic, file_header_size) != 0) {
+      BROKER_ERROR("not a valid segment file:" << path);
+      close();
+      return false;
+    }
+    size = file_header_size;
+    uint32_t len = 0;
+    uint64_t offset = 0;
+    int64_t ts = 0;
+    while (read_frame(size, len, offset, ts)) {
+      if (frames++ == 0)
+        first_offset = offset;
+      last_offset = offset;
+      last_timestamp = ts;
+      size += frame_header_size + len;
+    }
+    return true;
+  }
+
+  void close() {
+    if (buf != nullptr) {
+      munmap(buf, capacity);
+      buf = nullptr;
+    }
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+    capacity = 0;
+  }
+
+  bool map(size_t new_capacity) {
+    auto* ptr = mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd, 0);
+    if (ptr == MAP_FAILED) {
+      BROKER_ERROR("failed to map segment file:" << strerror(errno));
+      return false;
+    }
+    buf = static_cast<std::byte*>(ptr);
+    capacity = new_capacity;
+    return true;
+  }
+
+#else // BROKER_WINDOWS
+
+  bool create(const std::string& path, size_t) {
+    BROKER_ERROR("topic log not available on Windows:" << path);
+    return false;
+  }
+
+  bool recover(const std::string& path) {
+    BROKER_ERROR("topic log not available on Windows:" << path);
+    return false;
+  }
+
+  void close() {
+    // nop
+  }
+
+#endif // BROKER_WINDOWS
+};
+
+topic_log::topic_log(std::string directory, filter_type topics,
+                     size_t segment_size, size_t max_size, timespan max_age)
+  : directory_(std::move(directory)),
+    topics_(std::move(topics)),
+    segment_size_(std::max(segment_size, file_header_size + frame_header_size)),
+    max_segments_(std::max(max_size / segment_size_, size_t{1})),
+    max_age_(max_age) {
+  // nop
+}
+
+topic_log::~topic_log() {
+  // nop
+}
+
+uint64_t topic_log::first_offset() const {
+  std::lock_guard guard{mtx_};
+  for (const auto& seg : segments_)
+    if (!seg->empty())
+      return seg->first_offset;
+  return next_offset_;
+}
+
+uint64_t topic_log::next_offset() const {
+  std::lock_guard guard{mtx_};
+  return next_offset_;
+}
+
+size_t topic_log::num_segments() const {
+  std::lock_guard guard{mtx_};
+  return segments_.size();
+}
+
+std::string topic_log::file_name(const std::string& directory, uint64_t seq) {
+  // Pad the sequence number to keep lexicographic and chronological order
+  // consistent.
+  auto num = std::to_string(seq);
+  if (num.size() < 6)
+    num.insert(0, 6 - num.size(), '0');
+  auto result = directory;
+  if (!result.empty() && result.back() != '/')
+    result += '/';
+  result += "segment-";
+  result += num;
+  result += ".log";
+  return result;
+}
+
+bool topic_log::open() {
+  std::lock_guard guard{mtx_};
+  if (!detail::is_directory(directory_) && !detail::mkdirs(directory_)) {
+    BROKER_WARNING("cannot create topic log directory" << directory_);
+    return false;
+  }
+  // Pick up where a previous run left off.
+  if (auto head = head_file_name(directory_); detail::is_file(head)) {
+    auto str = detail::read(head);
+    next_seq_ = std::strtoull(str.c_str(), nullptr, 10);
+  }
+  for (;;) {
+    auto fname = file_name(directory_, next_seq_);
+    if (!detail::is_file(fname))
+      break;
+    auto seg = std::make_unique<segment>();
+    seg->seq = next_seq_++;
+    if (!seg->recover(fname))
+      return false;
+    if (!seg->empty())
+      next_offset_ = seg->last_offset + 1;
+    segments_.emplace_back(std::move(seg));
+  }
+  if (segments_.empty())
+    return roll();
+  BROKER_DEBUG("recovered" << segments_.size() << "segments with offsets up to"
+                           << next_offset_);
+  return true;
+}
+
+bool topic_log::append(const node_message& msg) {
+  if (get_type(msg) != envelope_type::data
+      || !detail::prefix_matcher{}(topics_, msg->topic()))
+    return false;
+  buf_.clear();
+  wire_format::v1::trait trait;
+  if (!trait.convert(msg, buf_)) {
+    BROKER_WARNING("unable to serialize a message for the topic log");
+    return false;
+  }
+  auto len = buf_.size();
+  if (len > std::numeric_limits<uint32_t>::max()
+      || file_header_size + frame_header_size + len > segment_size_) {
+    BROKER_WARNING("message too large for the topic log:" << len << "bytes");
+    return false;
+  }
+  auto now = unix_time_ns();
+  std::lock_guard guard{mtx_};
+  if (segments_.empty() || !segments_.back()->fits(len)) {
+    if (!roll())
+      return false;
+  }
+  segments_.back()->write_frame(reinterpret_cast<const std::byte*>(
+                                  buf_.data()),
+                                static_cast<uint32_t>(len), next_offset_++,
+                                now);
+  trim(now);
+  return true;
+}
+
+size_t topic_log::replay(const filter_type& filter, uint64_t& offset,
+                         std::vector<data_message>& out, size_t max) const {
+  size_t result = 0;
+  wire_format::v1::trait trait;
+  std::lock_guard guard{mtx_};
+  for (const auto& seg : segments_) {
+    if (result == max)
+      break;
+    if (seg->empty() || seg->last_offset < offset)
+      continue;
+    auto pos = file_header_size;
+    uint32_t len = 0;
+    uint64_t frame_offset = 0;
+    int64_t ts = 0;
+    while (result < max && seg->read_frame(pos, len, frame_offset, ts)) {
+      auto payload = seg->buf + pos + frame_header_size;
+      pos += frame_header_size + len;
+      if (frame_offset < offset)
+        continue;
+      offset = frame_offset + 1;
+      // Decode the frame straight from the mapped file.
+      auto first = reinterpret_cast<const caf::byte*>(payload);
+      node_message msg;
+      if (!trait.convert(caf::const_byte_span{first, len}, msg)
+          || get_type(msg) != envelope_type::data) {
+        BROKER_WARNING("skip an invalid frame in the topic log at offset"
+                       << frame_offset);
+        continue;
+      }
+      if (!detail::prefix_matcher{}(filter, msg->topic()))
+        continue;
+      out.emplace_back(msg->as_data());
+      ++result;
+    }
+  }
+  return result;
+}
+
+bool topic_log::roll() {
+  auto seg = std::make_unique<segment>();
+  seg->seq = next_seq_++;
+  auto fname = file_name(directory_, seg->seq);
+  if (!seg->create(fname, segment_size_)) {
+    BROKER_WARNING("cannot open segment file" << fname);
+    return false;
+  }
+  segments_.emplace_back(std::move(seg));
+  if (segments_.size() == 1)
+    write_head();
+  return true;
+}
+
+void topic_log::trim(int64_t now) {
+  auto removed = false;
+  auto expired = [this, now](const segment& seg) {
+    return max_age_.count() > 0 && !seg.empty()
+           && now - seg.last_timestamp > max_age_.count();
+  };
+  // Never remove the current segment.
+  while (segments_.size() > 1
+         && (segments_.size() > max_segments_ || expired(*segments_.front()))) {
+    auto fname = file_name(directory_, segments_.front()->seq);
+    segments_.pop_front();
+    detail::remove(fname);
+    removed = true;
+  }
+  if (removed)
+    write_head();
+}
+
+void topic_log::write_head() {
+  std::ofstream out{head_file_name(directory_), std::ios::trunc};
+  out << segments_.front()->seq << '\n';
+  if (!out)
+    BROKER_WARNING("unable to write the head of the topic log");
+}
+
+} // namespace broker::internal
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "broker/filter_type.hh"
+#include "broker/message.hh"
+#include "broker/time.hh"
+
+#include <caf/byte_buffer.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace broker::internal {
+
+/// An append-only log that retains data messages on selected topics, so that
+/// subscribers can replay what they missed. The log stores messages in
+/// memory-mapped segment files of fixed size: appending copies the serialized
+/// envelope into the current segment and replaying decodes the messages
+/// straight from the mapped memory.
+///
+/// Segment files start with an 8-byte magic number, followed by one frame per
+/// message. Each frame consists of a 4-byte payload size, an 8-byte offset, an
+/// 8-byte timestamp (nanoseconds since the UNIX epoch) and the envelope in
+/// Broker's wire format. All integers use the byte order of the host. The
+/// segments are zero-filled on creation, so a size of 0 marks the end. The
+/// file `head` tracks the oldest segment for recovering the log after a
+/// restart.
+///
+/// @note Only one thread may append, but other threads may replay
+///       concurrently.
+class topic_log {
+public:
+  // -- constants --------------------------------------------------------------
+
+  static constexpr size_t file_header_size = 8;
+
+  static constexpr size_t frame_header_size = 20;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// @param directory Path for storing the segment files.
+  /// @param topics Selects the retained topics.
+  /// @param segment_size Size of each segment file in bytes.
+  /// @param max_size Maximum number of bytes in all segments. The log removes
+  ///                 the oldest segment when exceeding this limit.
+  /// @param max_age Maximum age of a segment, measured by its newest message.
+  ///                A value of 0 disables time-based retention.
+  topic_log(std::string directory, filter_type topics, size_t segment_size,
+            size_t max_size, timespan max_age);
+
+  topic_log(const topic_log&) = delete;
+
+  topic_log& operator=(const topic_log&) = delete;
+
+  ~topic_log();
+
+  // -- properties -------------------------------------------------------------
+
+  const std::string& directory() const noexcept {
+    return directory_;
+  }
+
+  /// Returns the offset of the oldest retained message.
+  uint64_t first_offset() const;
+
+  /// Returns the offset that the next message receives.
+  uint64_t next_offset() const;
+
+  /// Returns the number of segment files on disk.
+  size_t num_segments() const;
+
+  /// Returns the name of the segment file with sequence number `seq`.
+  static std::string file_name(const std::string& directory, uint64_t seq);
+
+  // -- writing ----------------------------------------------------------------
+
+  /// Recovers the segments of a previous run and opens the current segment.
+  /// @returns `false` if the log cannot open a file in its directory.
+  bool open();
+
+  /// Appends `msg` if it is a data message on one of the retained topics.
+  /// @returns `true` if the log stored `msg`, `false` otherwise.
+  bool append(const node_message& msg);
+
+  // -- reading ----------------------------------------------------------------
+
+  /// Appends up to `max` messages that match `filter` to `out`, starting at
+  /// `offset`. Afterwards, `offset` points past the last visited message.
+  /// Starting before the oldest retained message starts at the oldest one.
+  /// @returns the number of messages added to `out`.
+  size_t replay(const filter_type& filter, uint64_t& offset,
+                std::vector<data_message>& out, size_t max) const;
+
+private:
+  struct segment;
+
+  using segment_ptr = std::unique_ptr<segment>;
+
+  /// Opens the next segment file.
+  bool roll();
+
+  /// Removes segments that exceed the size or time bounds.
+  void trim(int64_t now);
+
+  /// Stores the sequence number of the oldest segment in `head`.
+  void write_head();
+
+  std::string directory_;
+  filter_type topics_;
+  size_t segment_size_;
+  size_t max_segments_;
+  timespan max_age_;
+
+  mutable std::mutex mtx_;
+  std::deque<segment_ptr> segments_;
+  uint64_t next_seq_ = 0;
+  uint64_t next_offset_ = 0;
+
+  /// Scratch space for serializing messages in `append`.
+  caf::byte_buffer buf_;
+};
+
+/// @relates topic_log
+using topic_log_ptr = std::shared_ptr<topic_log>;
+
+} // namespace broker::internal
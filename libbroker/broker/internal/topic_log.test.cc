@@ -0,0 +1,164 @@
+#include "broker/internal/topic_log.hh"
+
+#include "broker/broker-test.test.hh"
+#include "broker/temp_directory.test.hh"
+
+#include "broker/detail/filesystem.hh"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace broker;
+using namespace std::literals;
+
+using internal::topic_log;
+
+namespace {
+
+struct fixture : temp_directory_fixture {
+  /// Replays everything from `offset` and returns the values.
+  std::vector<data> replay_all(const topic_log& uut, uint64_t& offset,
+                               const filter_type& filter = {"foo"}) {
+    std::vector<data_message> msgs;
+    while (uut.replay(filter, offset, msgs, 16) > 0) {
+      // Repeat until reaching the end of the log.
+    }
+    std::vector<data> result;
+    for (const auto& msg : msgs)
+      result.emplace_back(get_data(msg).to_data());
+    return result;
+  }
+
+  /// Replays a single message at `offset` and returns its topic and value.
+  std::pair<std::string, data> lookup(const topic_log& uut, uint64_t& offset,
+                                      const filter_type& filter = {"foo"}) {
+    std::vector<data_message> msgs;
+    if (uut.replay(filter, offset, msgs, 1) != 1) {
+      FAIL("no message at offset " << offset);
+    }
+    auto& msg = msgs.front();
+    return {std::string{get_topic(msg)}, get_data(msg).to_data()};
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(topic_log_tests, fixture)
+
+TEST(segment names sort in the order of their sequence numbers) {
+  CHECK_EQUAL(topic_log::file_name("/tmp", 7), "/tmp/segment-000007.log");
+  CHECK_EQUAL(topic_log::file_name("/tmp/", 1234567),
+              "/tmp/segment-1234567.log");
+}
+
+TEST(the log retains messages on selected topics only) {
+  topic_log uut{path, {"foo"}, 4096, 1024 * 1024, timespan{0}};
+  REQUIRE(uut.open());
+  CHECK(uut.append(make_msg("foo/a", 1)));
+  CHECK(!uut.append(make_msg("bar", 2)));
+  CHECK(uut.append(make_msg("foo/b", 3)));
+  CHECK_EQUAL(uut.next_offset(), 2u);
+  uint64_t offset = 0;
+  CHECK_EQUAL(replay_all(uut, offset), (std::vector<data>{count{1}, count{3}}));
+  CHECK_EQUAL(offset, 2u);
+  // Replaying from the end only returns new messages.
+  CHECK(uut.append(make_msg("foo/c", 4)));
+  CHECK_EQUAL(replay_all(uut, offset), (std::vector<data>{count{4}}));
+  // Replaying applies the filter of the subscriber.
+  offset = 0;
+  CHECK_EQUAL(replay_all(uut, offset, {"foo/b"}),
+              (std::vector<data>{count{3}}));
+  CHECK_EQUAL(offset, 3u);
+}
+
+TEST(the log retains each selected topic prefix) {
+  topic_log uut{path, {"foo", "bar/x"}, 4096, 1024 * 1024, timespan{0}};
+  REQUIRE(uut.open());
+  CHECK(uut.append(make_msg("foo/a", 1)));
+  CHECK(uut.append(make_msg("bar/x/a", 2)));
+  CHECK(!uut.append(make_msg("bar/y", 3)));
+  CHECK(!uut.append(make_msg("baz", 4)));
+  CHECK(uut.append(make_msg("bar/x", 5)));
+  CHECK_EQUAL(uut.next_offset(), 3u);
+  MESSAGE("subscribers replay only the topics they ask for");
+  uint64_t offset = 0;
+  CHECK_EQUAL(replay_all(uut, offset, {"bar/x"}),
+              (std::vector<data>{count{2}, count{5}}));
+  offset = 0;
+  CHECK_EQUAL(replay_all(uut, offset, {"foo", "bar"}),
+              (std::vector<data>{count{1}, count{2}, count{5}}));
+  offset = 0;
+  CHECK(replay_all(uut, offset, {"baz"}).empty());
+  CHECK_EQUAL(offset, 3u);
+}
+
+TEST(replaying from an offset looks up the message at that offset) {
+  topic_log uut{path, {"foo"}, 4096, 1024 * 1024, timespan{0}};
+  REQUIRE(uut.open());
+  for (count i = 0; i < 10; ++i)
+    CHECK(uut.append(make_msg(i % 2 == 0 ? "foo/even" : "foo/odd", i)));
+  uint64_t offset = 5;
+  CHECK_EQUAL(lookup(uut, offset),
+              std::make_pair("foo/odd"s, data{count{5}}));
+  CHECK_EQUAL(offset, 6u);
+  CHECK_EQUAL(lookup(uut, offset),
+              std::make_pair("foo/even"s, data{count{6}}));
+  CHECK_EQUAL(offset, 7u);
+  MESSAGE("the lookup skips messages that do not match the filter");
+  offset = 2;
+  CHECK_EQUAL(lookup(uut, offset, {"foo/odd"}),
+              std::make_pair("foo/odd"s, data{count{3}}));
+  CHECK_EQUAL(offset, 4u);
+  MESSAGE("looking up the next offset finds nothing yet");
+  offset = uut.next_offset();
+  std::vector<data_message> msgs;
+  CHECK_EQUAL(uut.replay({"foo"}, offset, msgs, 1), 0u);
+  CHECK_EQUAL(offset, 10u);
+  CHECK(uut.append(make_msg("foo/even", 10)));
+  CHECK_EQUAL(lookup(uut, offset),
+              std::make_pair("foo/even"s, data{count{10}}));
+}
+
+TEST(the log removes the oldest segments when exceeding its size) {
+  topic_log uut{path, {"foo"}, 256, 1024, timespan{0}};
+  REQUIRE(uut.open());
+  for (count i = 0; i < 100; ++i)
+    CHECK(uut.append(make_msg("foo", i)));
+  CHECK_EQUAL(uut.num_segments(), 4u);
+  CHECK_GREATER(uut.first_offset(), 0u);
+  CHECK(!detail::is_file(topic_log::file_name(path, 0)));
+  // Starting before the first offset starts at the oldest message.
+  uint64_t offset = 0;
+  auto xs = replay_all(uut, offset);
+  REQUIRE(!xs.empty());
+  CHECK_EQUAL(xs.front(), data{count{uut.first_offset()}});
+  CHECK_EQUAL(xs.back(), data{count{99}});
+}
+
+TEST(the log removes segments that exceed the maximum age) {
+  topic_log uut{path, {"foo"}, 256, 1024 * 1024, 1ns};
+  REQUIRE(uut.open());
+  for (count i = 0; i < 100; ++i)
+    CHECK(uut.append(make_msg("foo", i)));
+  CHECK_EQUAL(uut.num_segments(), 1u);
+}
+
+TEST(the log recovers its segments after a restart) {
+  {
+    topic_log uut{path, {"foo"}, 256, 1024, timespan{0}};
+    REQUIRE(uut.open());
+    for (count i = 0; i < 100; ++i)
+      CHECK(uut.append(make_msg("foo", i)));
+  }
+  topic_log uut{path, {"foo"}, 256, 1024, timespan{0}};
+  REQUIRE(uut.open());
+  CHECK_EQUAL(uut.num_segments(), 4u);
+  CHECK_EQUAL(uut.next_offset(), 100u);
+  CHECK(uut.append(make_msg("foo", 100)));
+  uint64_t offset = 99;
+  CHECK_EQUAL(replay_all(uut, offset),
+              (std::vector<data>{count{99}, count{100}}));
+}
+
+FIXTURE_SCOPE_END()
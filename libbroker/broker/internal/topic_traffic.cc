@@ -0,0 +1,88 @@
+#include "broker/internal/topic_traffic.hh"
+
+#include <algorithm>
+
+using namespace std::literals;
+
+namespace broker::internal {
+
+topic_traffic::topic_traffic(size_t depth, size_t max_prefixes,
+                             counter_family* messages, counter_family* bytes)
+  : depth_(depth),
+    max_prefixes_(max_prefixes),
+    message_family_(messages),
+    byte_family_(bytes) {
+  // nop
+}
+
+void topic_traffic::count(std::string_view topic, size_t bytes) {
+  auto& x = entry_for(prefix_of(topic));
+  auto n = static_cast<int64_t>(bytes);
+  ++x.messages;
+  x.bytes += n;
+  if (x.message_counter != nullptr)
+    x.message_counter->inc();
+  if (x.byte_counter != nullptr)
+    x.byte_counter->inc(n);
+}
+
+std::string_view
+topic_traffic::prefix_of(std::string_view topic) const noexcept {
+  auto pos = size_t{0};
+  for (size_t level = 0; level < depth_; ++level) {
+    pos = topic.find('/', pos);
+    if (pos == std::string_view::npos)
+      return topic;
+    if (level + 1 < depth_)
+      ++pos;
+  }
+  return topic.substr(0, pos);
+}
+
+std::vector<std::pair<std::string, topic_traffic::entry>>
+topic_traffic::top(size_t k) const {
+  std::vector<std::pair<std::string, entry>> result{entries_.begin(),
+                                                    entries_.end()};
+  auto greater = [](const auto& x, const auto& y) {
+    return x.second.bytes > y.second.bytes;
+  };
+  if (k < result.size()) {
+    std::partial_sort(result.begin(), result.begin() + k, result.end(),
+                      greater);
+    result.resize(k);
+  } else {
+    std::sort(result.begin(), result.end(), greater);
+  }
+  return result;
+}
+
+vector topic_traffic::top_snapshot(size_t k) const {
+  vector result;
+  for (auto& [prefix, x] : top(k)) {
+    table entry;
+    entry.emplace("prefix"s, prefix);
+    entry.emplace("messages"s, x.messages);
+    entry.emplace("bytes"s, x.bytes);
+    result.emplace_back(std::move(entry));
+  }
+  return result;
+}
+
+topic_traffic::entry& topic_traffic::entry_for(std::string_view prefix) {
+  if (auto i = entries_.find(prefix); i != entries_.end())
+    return i->second;
+  // Reserve one slot for the pseudo prefix.
+  if (entries_.size() + 1 >= max_prefixes_)
+    prefix = other_prefix;
+  auto [i, added] = entries_.try_emplace(std::string{prefix});
+  if (added) {
+    if (message_family_ != nullptr)
+      i->second.message_counter = message_family_->get_or_add(
+        {{"prefix", prefix}});
+    if (byte_family_ != nullptr)
+      i->second.byte_counter = byte_family_->get_or_add({{"prefix", prefix}});
+  }
+  return i->second;
+}
+
+} // namespace broker::internal
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "broker/data.hh"
+#include "broker/internal/metric_factory.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace broker::internal {
+
+/// Counts messages and bytes per topic prefix. The prefix of a topic consists
+/// of its first `depth` levels, e.g., "zeek/events" for the topic
+/// "zeek/events/conn" with a depth of 2. To bound the cardinality, the stats
+/// track at most `max_prefixes` prefixes and count all messages with other
+/// prefixes under the pseudo prefix "<other>".
+class topic_traffic {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using counter_family = metric_factory::int_counter_family;
+
+  struct entry {
+    int64_t messages = 0;
+    int64_t bytes = 0;
+    caf::telemetry::int_counter* message_counter = nullptr;
+    caf::telemetry::int_counter* byte_counter = nullptr;
+  };
+
+  // -- constants --------------------------------------------------------------
+
+  /// The pseudo prefix for all topics that exceed `max_prefixes`.
+  static constexpr std::string_view other_prefix = "<other>";
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// @param depth Number of topic levels that make up a prefix.
+  /// @param max_prefixes Maximum number of distinct prefixes.
+  /// @param messages Optional family for counting messages per prefix.
+  /// @param bytes Optional family for counting bytes per prefix.
+  topic_traffic(size_t depth, size_t max_prefixes,
+                counter_family* messages = nullptr,
+                counter_family* bytes = nullptr);
+
+  // -- properties -------------------------------------------------------------
+
+  size_t depth() const noexcept {
+    return depth_;
+  }
+
+  /// Returns the number of distinct prefixes, including "<other>".
+  size_t size() const noexcept {
+    return entries_.size();
+  }
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Counts a message on `topic` with a size of `bytes`.
+  void count(std::string_view topic, size_t bytes);
+
+  // -- queries ----------------------------------------------------------------
+
+  /// Returns the prefix of `topic`.
+  std::string_view prefix_of(std::string_view topic) const noexcept;
+
+  /// Returns the `k` prefixes with the most bytes in descending order.
+  std::vector<std::pair<std::string, entry>> top(size_t k) const;
+
+  /// Returns the `k` prefixes with the most bytes as a list of tables.
+  vector top_snapshot(size_t k) const;
+
+private:
+  entry& entry_for(std::string_view prefix);
+
+  size_t depth_;
+
+  size_t max_prefixes_;
+
+  counter_family* message_family_;
+
+  counter_family* byte_family_;
+
+  std::map<std::string, entry, std::less<>> entries_;
+};
+
+} // namespace broker::internal
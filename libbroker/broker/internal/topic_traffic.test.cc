@@ -0,0 +1,51 @@
+#include "broker/internal/topic_traffic.hh"
+
+#include "broker/broker-test.test.hh"
+
+using namespace broker;
+using namespace std::literals;
+
+using internal::topic_traffic;
+
+TEST(prefixes consist of the first levels of a topic) {
+  topic_traffic uut{2, 10};
+  CHECK_EQUAL(uut.prefix_of("zeek/events/conn"), "zeek/events"sv);
+  CHECK_EQUAL(uut.prefix_of("zeek/events"), "zeek/events"sv);
+  CHECK_EQUAL(uut.prefix_of("zeek"), "zeek"sv);
+  topic_traffic uut1{1, 10};
+  CHECK_EQUAL(uut1.prefix_of("zeek/events/conn"), "zeek"sv);
+}
+
+TEST(the stats aggregate messages and bytes per prefix) {
+  topic_traffic uut{2, 10};
+  uut.count("zeek/events/conn", 100);
+  uut.count("zeek/events/dns", 50);
+  uut.count("zeek/logs/conn", 10);
+  CHECK_EQUAL(uut.size(), 2u);
+  auto xs = uut.top(10);
+  if (CHECK(xs.size() == 2u)) {
+    CHECK_EQUAL(xs[0].first, "zeek/events");
+    CHECK_EQUAL(xs[0].second.messages, 2);
+    CHECK_EQUAL(xs[0].second.bytes, 150);
+    CHECK_EQUAL(xs[1].first, "zeek/logs");
+    CHECK_EQUAL(xs[1].second.bytes, 10);
+  }
+  CHECK_EQUAL(uut.top(1).size(), 1u);
+}
+
+TEST(the stats map all prefixes beyond the limit to a pseudo prefix) {
+  topic_traffic uut{1, 3};
+  uut.count("a/x", 1);
+  uut.count("b/x", 1);
+  uut.count("c/x", 1);
+  uut.count("d/x", 1);
+  uut.count("a/y", 5);
+  CHECK_EQUAL(uut.size(), 3u);
+  auto xs = uut.top(3);
+  if (CHECK(xs.size() == 3u)) {
+    CHECK_EQUAL(xs[0].first, "a");
+    CHECK_EQUAL(xs[0].second.messages, 2);
+    CHECK_EQUAL(xs[1].first, std::string{topic_traffic::other_prefix});
+    CHECK_EQUAL(xs[1].second.messages, 2);
+  }
+}
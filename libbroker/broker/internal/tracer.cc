@@ -0,0 +1,220 @@
+#include "broker/internal/tracer.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+namespace broker::internal {
+
+namespace {
+
+/// A ring buffer with a single writer: the thread that owns it. Readers copy
+/// the slots and discard all slots that the writer may have overridden while
+/// copying.
+struct trace_ring {
+  trace_ring(size_t capacity, uint32_t thread)
+    : slots(capacity), thread(thread) {
+    // nop
+  }
+
+  std::vector<trace_event> slots;
+  std::atomic<uint64_t> head{0};
+  uint32_t thread;
+};
+
+using trace_ring_ptr = std::shared_ptr<trace_ring>;
+
+struct trace_registry {
+  std::mutex mtx;
+  std::vector<trace_ring_ptr> rings;
+  size_t buffer_size = 0;
+  uint32_t next_thread = 0;
+  /// Increases whenever the rings become invalid. Threads compare this value
+  /// with their local copy to detect when they need to allocate a new ring.
+  std::atomic<uint64_t> generation{1};
+};
+
+trace_registry& registry() {
+  static trace_registry instance;
+  return instance;
+}
+
+struct local_trace_ring {
+  trace_ring_ptr ptr;
+  uint64_t generation = 0;
+};
+
+thread_local local_trace_ring this_thread_ring;
+
+trace_ring* ring_for_this_thread() noexcept {
+  auto& reg = registry();
+  auto& local = this_thread_ring;
+  auto gen = reg.generation.load(std::memory_order_acquire);
+  if (local.generation == gen)
+    return local.ptr.get();
+  // Note: the tracer must not throw on the hot path. Hence, a failure to
+  //       allocate a ring stops tracing on this thread until the next call to
+  //       `tracer::enable` or `tracer::clear`.
+  try {
+    std::lock_guard guard{reg.mtx};
+    local.generation = reg.generation.load(std::memory_order_relaxed);
+    local.ptr = nullptr;
+    if (reg.buffer_size > 0) {
+      auto ptr = std::make_shared<trace_ring>(reg.buffer_size,
+                                              reg.next_thread);
+      reg.rings.emplace_back(ptr);
+      ++reg.next_thread;
+      local.ptr = std::move(ptr);
+    }
+  } catch (...) {
+    local.generation = gen;
+    local.ptr = nullptr;
+  }
+  return local.ptr.get();
+}
+
+int64_t now_ns() noexcept {
+  using namespace std::chrono;
+  auto ts = steady_clock::now().time_since_epoch();
+  return duration_cast<nanoseconds>(ts).count();
+}
+
+void append_escaped(std::string& out, std::string_view str) {
+  for (auto ch : str) {
+    switch (ch) {
+      case '"':
+      case '\\':
+        out += '\\';
+        [[fallthrough]];
+      default:
+        out += ch;
+    }
+  }
+}
+
+} // namespace
+
+std::atomic<bool> tracer::enabled_{false};
+
+std::string_view to_string(trace_stage x) noexcept {
+  switch (x) {
+    case trace_stage::publish:
+      return "publish";
+    case trace_stage::peer_in:
+      return "peer-in";
+    case trace_stage::client_in:
+      return "client-in";
+    case trace_stage::merge:
+      return "merge";
+    case trace_stage::peer_out:
+      return "peer-out";
+    case trace_stage::delivery:
+      return "delivery";
+    default:
+      return "???";
+  }
+}
+
+void tracer::enable(size_t buffer_size) {
+  auto& reg = registry();
+  {
+    std::lock_guard guard{reg.mtx};
+    reg.rings.clear();
+    reg.buffer_size = buffer_size;
+    reg.generation.fetch_add(1, std::memory_order_release);
+  }
+  enabled_.store(buffer_size > 0, std::memory_order_relaxed);
+}
+
+void tracer::disable() noexcept {
+  enabled_.store(false, std::memory_order_relaxed);
+}
+
+void tracer::record(trace_stage stage, const void* msg,
+                    const endpoint_id& peer) noexcept {
+  auto* ring = ring_for_this_thread();
+  if (ring == nullptr)
+    return;
+  auto pos = ring->head.load(std::memory_order_relaxed);
+  auto& slot = ring->slots[pos % ring->slots.size()];
+  slot.timestamp = now_ns();
+  slot.message = reinterpret_cast<uintptr_t>(msg);
+  slot.peer = peer;
+  slot.thread = ring->thread;
+  slot.stage = stage;
+  ring->head.store(pos + 1, std::memory_order_release);
+}
+
+void tracer::clear() {
+  auto& reg = registry();
+  std::lock_guard guard{reg.mtx};
+  reg.rings.clear();
+  reg.generation.fetch_add(1, std::memory_order_release);
+}
+
+std::vector<trace_event> tracer::events() {
+  std::vector<trace_ring_ptr> rings;
+  {
+    auto& reg = registry();
+    std::lock_guard guard{reg.mtx};
+    rings = reg.rings;
+  }
+  std::vector<trace_event> result;
+  for (auto& ring : rings) {
+    auto cap = static_cast<uint64_t>(ring->slots.size());
+    auto last = ring->head.load(std::memory_order_acquire);
+    auto first = last > cap ? last - cap : uint64_t{0};
+    auto offset = result.size();
+    for (auto pos = first; pos < last; ++pos)
+      result.emplace_back(ring->slots[pos % cap]);
+    // Drop events that the writer may have overridden in the meantime.
+    auto now = ring->head.load(std::memory_order_acquire);
+    if (auto valid_first = now > cap ? now - cap : uint64_t{0};
+        valid_first > first) {
+      auto n = std::min(valid_first - first, last - first);
+      auto i = result.begin() + static_cast<ptrdiff_t>(offset);
+      result.erase(i, i + static_cast<ptrdiff_t>(n));
+    }
+  }
+  std::stable_sort(result.begin(), result.end(),
+                   [](const trace_event& x, const trace_event& y) {
+                     return x.timestamp < y.timestamp;
+                   });
+  return result;
+}
+
+std::string tracer::chrome_trace_json() {
+  auto xs = events();
+  std::string result;
+  result.reserve(xs.size() * 128 + 32);
+  result += R"({"traceEvents":[)";
+  auto t0 = xs.empty() ? int64_t{0} : xs.front().timestamp;
+  char buf[128];
+  for (size_t index = 0; index < xs.size(); ++index) {
+    const auto& x = xs[index];
+    if (index > 0)
+      result += ',';
+    // Chrome traces use microseconds as timestamps.
+    auto ts = static_cast<double>(x.timestamp - t0) / 1000.0;
+    result += R"({"name":")";
+    append_escaped(result, to_string(x.stage));
+    snprintf(buf, sizeof(buf),
+             R"(","ph":"i","s":"t","pid":1,"tid":%u,"ts":%.3f,)"
+             R"("args":{"msg":"0x%llx")",
+             static_cast<unsigned>(x.thread), ts,
+             static_cast<unsigned long long>(x.message));
+    result += buf;
+    if (x.peer) {
+      result += R"(,"peer":")";
+      append_escaped(result, to_string(x.peer));
+      result += '"';
+    }
+    result += "}}";
+  }
+  result += "]}\n";
+  return result;
+}
+
+} // namespace broker::internal
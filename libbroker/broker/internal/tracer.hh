@@ -0,0 +1,107 @@
+#pragma once
+
+#include "broker/config.hh"
+#include "broker/endpoint_id.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace broker::internal {
+
+/// Identifies the place in the core where the tracer recorded an event.
+enum class trace_stage : uint8_t {
+  /// A local publisher or the endpoint itself published the message.
+  publish,
+  /// A peer sent the message to this endpoint.
+  peer_in,
+  /// A WebSocket client sent the message to this endpoint.
+  client_in,
+  /// The message reached the central merge point.
+  merge,
+  /// The message entered the output of a peer.
+  peer_out,
+  /// The message reached the local subscribers.
+  delivery,
+};
+
+/// @relates trace_stage
+std::string_view to_string(trace_stage x) noexcept;
+
+/// A fixed-size record for a message passing through a stage of the core.
+struct trace_event {
+  /// Nanoseconds since the epoch of the steady clock.
+  int64_t timestamp;
+
+  /// Identifies the message by the address of its envelope.
+  uint64_t message;
+
+  /// Identifies the peer that sent or receives the message, if any.
+  endpoint_id peer;
+
+  /// Identifies the thread that recorded the event.
+  uint32_t thread;
+
+  /// Identifies the stage of the core that recorded the event.
+  trace_stage stage;
+};
+
+/// Records trace events into per-thread ring buffers. Writing an event never
+/// blocks or allocates, except for the first event of a thread after enabling
+/// the tracer. Each ring buffer keeps the most recent events of its thread.
+class tracer {
+public:
+  /// Starts recording with ring buffers for `buffer_size` events per thread.
+  /// Discards all previously recorded events.
+  static void enable(size_t buffer_size);
+
+  /// Stops recording. Keeps all recorded events until calling `enable` or
+  /// `clear` again.
+  static void disable() noexcept;
+
+  /// Queries whether the tracer currently records events.
+  static bool enabled() noexcept {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /// Records an event for `msg` entering `stage`.
+  static void record(trace_stage stage, const void* msg,
+                     const endpoint_id& peer) noexcept;
+
+  /// Discards all recorded events.
+  static void clear();
+
+  /// Returns the recorded events of all threads, sorted by timestamp.
+  static std::vector<trace_event> events();
+
+  /// Renders the recorded events in the Chrome trace event format, which
+  /// Perfetto and `chrome://tracing` can load.
+  static std::string chrome_trace_json();
+
+private:
+  static std::atomic<bool> enabled_;
+};
+
+} // namespace broker::internal
+
+/// Records a trace event if Broker was built with tracing support and the
+/// tracer is enabled. Otherwise, the compiler still type-checks the arguments
+/// but discards the call.
+#ifdef BROKER_ENABLE_TRACING
+#  define BROKER_TRACE_EVENT(stage, msg, peer)                                 \
+    do {                                                                       \
+      if (broker::internal::tracer::enabled())                                 \
+        broker::internal::tracer::record(                                      \
+          broker::internal::trace_stage::stage, msg, peer);                    \
+    } while (false)
+#else
+#  define BROKER_TRACE_EVENT(stage, msg, peer)                                 \
+    do {                                                                       \
+      if constexpr (false)                                                     \
+        broker::internal::tracer::record(                                      \
+          broker::internal::trace_stage::stage, msg, peer);                    \
+    } while (false)
+#endif
@@ -0,0 +1,70 @@
+#include "broker/internal/tracer.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include <thread>
+
+using namespace broker;
+
+using internal::trace_stage;
+using internal::tracer;
+
+namespace {
+
+struct fixture {
+  int msg1 = 0;
+  int msg2 = 0;
+
+  ~fixture() {
+    tracer::disable();
+    tracer::clear();
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(tracer_tests, fixture)
+
+TEST(the tracer records nothing while disabled) {
+  tracer::enable(8);
+  tracer::disable();
+  CHECK(!tracer::enabled());
+  BROKER_TRACE_EVENT(merge, &msg1, endpoint_id{});
+  CHECK(tracer::events().empty());
+}
+
+TEST(the tracer keeps the most recent events per thread) {
+  tracer::enable(4);
+  for (int i = 0; i < 6; ++i)
+    tracer::record(trace_stage::publish, &msg1, endpoint_id{});
+  tracer::record(trace_stage::merge, &msg2, endpoint_id{});
+  std::thread t{[this] {
+    tracer::record(trace_stage::peer_out, &msg2, endpoint_id{});
+  }};
+  t.join();
+  auto events = tracer::events();
+  if (CHECK(events.size() == 5u)) {
+    CHECK(events[3].stage == trace_stage::merge);
+    CHECK(events[4].stage == trace_stage::peer_out);
+    CHECK_NOT_EQUAL(events[3].thread, events[4].thread);
+    CHECK_EQUAL(events[4].message, reinterpret_cast<uintptr_t>(&msg2));
+  }
+}
+
+TEST(enabling the tracer discards previous events) {
+  tracer::enable(4);
+  tracer::record(trace_stage::publish, &msg1, endpoint_id{});
+  tracer::enable(4);
+  CHECK(tracer::events().empty());
+}
+
+TEST(the tracer renders events in the Chrome trace event format) {
+  tracer::enable(4);
+  CHECK_EQUAL(tracer::chrome_trace_json(), "{\"traceEvents\":[]}\n");
+  tracer::record(trace_stage::delivery, &msg1, endpoint_id{});
+  auto json = tracer::chrome_trace_json();
+  CHECK_NOT_EQUAL(json.find("\"name\":\"delivery\""), std::string::npos);
+  CHECK_NOT_EQUAL(json.find("\"ph\":\"i\""), std::string::npos);
+}
+
+FIXTURE_SCOPE_END()
@@ -121,6 +121,7 @@ CAF_BEGIN_TYPE_ID_BLOCK(broker_internal, caf::first_custom_type_id)
   BROKER_ADD_TYPE_ID((broker::attach_writer_command))
   BROKER_ADD_TYPE_ID((broker::backend))
   BROKER_ADD_TYPE_ID((broker::backend_options))
+  BROKER_ADD_TYPE_ID((broker::batch_command))
   BROKER_ADD_TYPE_ID((broker::clear_command))
   BROKER_ADD_TYPE_ID((broker::command_envelope_ptr))
   BROKER_ADD_TYPE_ID((broker::cumulative_ack_command))
@@ -140,10 +141,13 @@ CAF_BEGIN_TYPE_ID_BLOCK(broker_internal, caf::first_custom_type_id)
   BROKER_ADD_TYPE_ID((broker::internal::connector_event_id))
   BROKER_ADD_TYPE_ID((broker::internal::data_consumer_res))
   BROKER_ADD_TYPE_ID((broker::internal::data_producer_res))
+  BROKER_ADD_TYPE_ID((broker::internal::encoded_batch_ptr))
   BROKER_ADD_TYPE_ID((broker::internal::node_consumer_res))
   BROKER_ADD_TYPE_ID((broker::internal::node_producer_res))
   BROKER_ADD_TYPE_ID((broker::internal::pending_connection_ptr))
   BROKER_ADD_TYPE_ID((broker::internal::retry_state))
+  BROKER_ADD_TYPE_ID((broker::internal::store_request_batch_ptr))
+  BROKER_ADD_TYPE_ID((broker::internal::store_response_batch_ptr))
   BROKER_ADD_TYPE_ID((broker::internal_command))
   BROKER_ADD_TYPE_ID((broker::internal_command_variant))
   BROKER_ADD_TYPE_ID((broker::keepalive_command))
@@ -160,11 +164,13 @@ CAF_BEGIN_TYPE_ID_BLOCK(broker_internal, caf::first_custom_type_id)
   BROKER_ADD_TYPE_ID((broker::set))
   BROKER_ADD_TYPE_ID((broker::shutdown_options))
   BROKER_ADD_TYPE_ID((broker::snapshot))
+  BROKER_ADD_TYPE_ID((broker::snapshot_chunk_command))
   BROKER_ADD_TYPE_ID((broker::status))
   BROKER_ADD_TYPE_ID((broker::subnet))
   BROKER_ADD_TYPE_ID((broker::subtract_command))
   BROKER_ADD_TYPE_ID((broker::table))
   BROKER_ADD_TYPE_ID((broker::topic))
+  BROKER_ADD_TYPE_ID((broker::value_query))
   BROKER_ADD_TYPE_ID((broker::vector))
 
   // -- STD/CAF type announcements ---------------------------------------------
@@ -253,9 +259,12 @@ CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::command_consumer_res)
 CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::command_producer_res)
 CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::data_consumer_res)
 CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::data_producer_res)
+CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::encoded_batch_ptr)
 CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::node_consumer_res)
 CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::node_producer_res)
 CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::pending_connection_ptr)
+CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::store_request_batch_ptr)
+CAF_ALLOW_UNSAFE_MESSAGE_TYPE(broker::internal::store_response_batch_ptr)
 
 CAF_ALLOW_UNSAFE_MESSAGE_TYPE(std::shared_ptr<broker::filter_type>)
 CAF_ALLOW_UNSAFE_MESSAGE_TYPE(std::shared_ptr<std::promise<void>>)
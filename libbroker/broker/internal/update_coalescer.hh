@@ -0,0 +1,139 @@
+#pragma once
+
+#include "broker/data.hh"
+#include "broker/detail/flat_hash_map.hh"
+#include "broker/internal_command.hh"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace broker::internal {
+
+/// Buffers store modifications and merges redundant modifications of the same
+/// key. A `put`, `erase` or `expire` replaces any buffered modification of the
+/// same key (last writer wins) and consecutive `add` or `subtract` operations
+/// with numbers of the same type collapse into a single operation. All other
+/// commands act as barriers, i.e., the coalescer never merges modifications
+/// across them. Applying the buffered commands in order always produces the
+/// same state as applying the original sequence.
+/// @tparam Variant A `std::variant` for storing the buffered commands.
+template <class Variant>
+class update_coalescer {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using buffer_type = std::vector<Variant>;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// @param enabled If `false`, the coalescer only appends to its buffer.
+  explicit update_coalescer(bool enabled = false) : enabled_(enabled) {
+    // nop
+  }
+
+  // -- properties -------------------------------------------------------------
+
+  bool enabled() const noexcept {
+    return enabled_;
+  }
+
+  void enabled(bool value) noexcept {
+    enabled_ = value;
+    index_.clear();
+  }
+
+  bool empty() const noexcept {
+    return buf_.empty();
+  }
+
+  size_t size() const noexcept {
+    return buf_.size();
+  }
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Adds `cmd` to the buffer, merging it with a previous modification of the
+  /// same key if possible.
+  template <class T>
+  void push(T&& cmd) {
+    using cmd_type = std::decay_t<T>;
+    if (!enabled_) {
+      buf_.emplace_back(std::forward<T>(cmd));
+      return;
+    }
+    if constexpr (std::is_same_v<cmd_type, put_command>
+                  || std::is_same_v<cmd_type, erase_command>
+                  || std::is_same_v<cmd_type, expire_command>) {
+      auto h = index_.hash_code(cmd.key);
+      if (auto i = index_.find(cmd.key, h); i != index_.end()) {
+        buf_[i->second] = std::forward<T>(cmd);
+        return;
+      }
+      index_.try_emplace_hashed(h, cmd.key, buf_.size());
+      buf_.emplace_back(std::forward<T>(cmd));
+    } else if constexpr (std::is_same_v<cmd_type, add_command>
+                         || std::is_same_v<cmd_type, subtract_command>) {
+      auto h = index_.hash_code(cmd.key);
+      if (auto i = index_.find(cmd.key, h); i != index_.end()) {
+        if (auto* prev = std::get_if<cmd_type>(&buf_[i->second]);
+            prev && merge(*prev, cmd))
+          return;
+        i->second = buf_.size();
+      } else {
+        index_.try_emplace_hashed(h, cmd.key, buf_.size());
+      }
+      buf_.emplace_back(std::forward<T>(cmd));
+    } else {
+      index_.clear();
+      buf_.emplace_back(std::forward<T>(cmd));
+    }
+  }
+
+  /// Returns all buffered commands and clears the buffer.
+  buffer_type take() {
+    index_.clear();
+    buffer_type result;
+    result.swap(buf_);
+    return result;
+  }
+
+private:
+  /// Adds the amount of `y` to `x` if both carry numbers of the same type.
+  template <class T>
+  static bool merge_amounts(data& x, const data& y) {
+    auto* lhs = get_if<T>(x);
+    auto* rhs = get_if<T>(y);
+    if (lhs == nullptr || rhs == nullptr)
+      return false;
+    x = data{*lhs + *rhs};
+    return true;
+  }
+
+  template <class Command>
+  static bool merge(Command& x, const Command& y) {
+    if constexpr (std::is_same_v<Command, add_command>) {
+      if (x.init_type != y.init_type)
+        return false;
+    }
+    if (x.publisher != y.publisher)
+      return false;
+    if (!merge_amounts<count>(x.value, y.value)
+        && !merge_amounts<integer>(x.value, y.value)
+        && !merge_amounts<real>(x.value, y.value))
+      return false;
+    x.expiry = y.expiry;
+    return true;
+  }
+
+  bool enabled_;
+
+  buffer_type buf_;
+
+  /// Maps keys to the position of their most recent modification since the
+  /// last barrier.
+  detail::flat_hash_map<data, size_t> index_;
+};
+
+} // namespace broker::internal
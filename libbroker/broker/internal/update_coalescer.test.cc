@@ -0,0 +1,73 @@
+#include "broker/internal/update_coalescer.hh"
+
+#include "broker/broker-test.test.hh"
+
+using namespace broker;
+
+namespace {
+
+using coalescer_type = internal::update_coalescer<batch_entry>;
+
+put_command make_put(data key, data value) {
+  return put_command{std::move(key), std::move(value), std::nullopt,
+                     entity_id{}};
+}
+
+add_command make_add(data key, data value) {
+  auto init_type = value.get_type();
+  return add_command{std::move(key), std::move(value), init_type,
+                     std::nullopt, entity_id{}};
+}
+
+struct fixture {
+  coalescer_type uut{true};
+};
+
+} // namespace
+
+FIXTURE_SCOPE(update_coalescer_tests, fixture)
+
+TEST(a disabled coalescer keeps all commands) {
+  coalescer_type passthrough;
+  passthrough.push(make_put("a", 1));
+  passthrough.push(make_put("a", 2));
+  CHECK_EQUAL(passthrough.size(), 2u);
+}
+
+TEST(the last put for a key wins) {
+  uut.push(make_put("a", 1));
+  uut.push(make_put("b", 1));
+  uut.push(make_put("a", 2));
+  auto xs = uut.take();
+  REQUIRE_EQUAL(xs.size(), 2u);
+  CHECK_EQUAL(std::get<put_command>(xs[0]).value, data{2});
+  CHECK_EQUAL(std::get<put_command>(xs[1]).key, data{"b"});
+  CHECK(uut.empty());
+}
+
+TEST(erase replaces a buffered put) {
+  uut.push(make_put("a", 1));
+  uut.push(erase_command{data{"a"}, entity_id{}});
+  auto xs = uut.take();
+  REQUIRE_EQUAL(xs.size(), 1u);
+  CHECK(std::holds_alternative<erase_command>(xs[0]));
+}
+
+TEST(additions of the same type collapse into one) {
+  uut.push(make_add("a", count{1}));
+  uut.push(make_add("a", count{2}));
+  uut.push(make_add("a", integer{3}));
+  auto xs = uut.take();
+  REQUIRE_EQUAL(xs.size(), 2u);
+  CHECK_EQUAL(std::get<add_command>(xs[0]).value, data{count{3}});
+  CHECK_EQUAL(std::get<add_command>(xs[1]).value, data{integer{3}});
+}
+
+TEST(clear acts as a barrier) {
+  uut.push(make_put("a", 1));
+  uut.push(clear_command{entity_id{}});
+  uut.push(make_put("a", 2));
+  CHECK_EQUAL(uut.size(), 3u);
+}
+
+FIXTURE_SCOPE_END()
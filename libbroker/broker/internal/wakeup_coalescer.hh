@@ -0,0 +1,175 @@
+#pragma once
+
+#include "broker/internal/flow_sub.hh"
+#include "broker/time.hh"
+
+#include <caf/disposable.hpp>
+#include <caf/flow/op/cold.hpp>
+#include <caf/intrusive_ptr.hpp>
+#include <caf/scheduled_actor.hpp>
+#include <caf/sec.hpp>
+
+#include <cstddef>
+#include <deque>
+
+namespace broker::internal {
+
+template <class T>
+class wakeup_coalescer_sub : public flow_sub<T> {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using super = flow_sub<T>;
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  wakeup_coalescer_sub(caf::scheduled_actor* self,
+                       caf::flow::observer<T> out, size_t batch_size,
+                       timespan delay)
+    : super(self, std::move(out), 0),
+      self_(self),
+      batch_size_(batch_size),
+      delay_(delay) {
+    // nop
+  }
+
+  // -- implementation of observer_impl<T> -------------------------------------
+
+  void on_next(const T& item) override {
+    if (!out_)
+      return;
+    buf_.push_back(item);
+    if (buf_.size() >= batch_size_) {
+      flush();
+      return;
+    }
+    if (buf_.size() == 1) {
+      using ptr_t = caf::intrusive_ptr<wakeup_coalescer_sub>;
+      timer_ = self_->run_delayed(delay_, [ptr = ptr_t{this}] { //
+        ptr->flush();
+      });
+    }
+  }
+
+  void on_complete() override {
+    in_ = nullptr;
+    flush();
+    complete_out();
+  }
+
+  void on_subscribe(caf::flow::subscription in) override {
+    if (!in_ && out_) {
+      in_ = std::move(in);
+      if (demand_ > 0) {
+        in_.request(demand_);
+        demand_ = 0;
+      }
+    } else {
+      in.dispose();
+    }
+  }
+
+  // -- implementation of subscription_impl ------------------------------------
+
+  void request(size_t n) override {
+    // We pass the demand through. Hence, we never hold more items than our
+    // observer asked for and can always ship all buffered items at once.
+    if (in_)
+      in_.request(n);
+    else
+      demand_ += n;
+  }
+
+protected:
+  /// Drops all buffered items.
+  void clear() override {
+    timer_.dispose();
+    buf_.clear();
+  }
+
+private:
+  using super::complete_out;
+  using super::demand_;
+  using super::in_;
+  using super::out_;
+
+  /// Ships all buffered items to the observer.
+  void flush() {
+    timer_.dispose();
+    while (out_ && !buf_.empty()) {
+      auto item = std::move(buf_.front());
+      buf_.pop_front();
+      out_.on_next(item);
+    }
+  }
+
+  caf::scheduled_actor* self_;
+  size_t batch_size_;
+  timespan delay_;
+  std::deque<T> buf_;
+  caf::disposable timer_;
+};
+
+/// Holds back items until `batch_size` items are pending or the first pending
+/// item waited for `delay`. Shipping the items in one go lets the observer
+/// process them all after a single wakeup, e.g., when the observer writes them
+/// to the buffer of a subscriber, which signals its consumer only when going
+/// from empty to non-empty.
+template <class T>
+class wakeup_coalescer : public caf::flow::op::cold<T> {
+public:
+  using super = caf::flow::op::cold<T>;
+
+  using decorated_type = caf::flow::observable<T>;
+
+  wakeup_coalescer(caf::scheduled_actor* self, decorated_type decorated,
+                   size_t batch_size, timespan delay)
+    : super(self),
+      self_(self),
+      decorated_(std::move(decorated)),
+      batch_size_(batch_size),
+      delay_(delay) {
+    // nop
+  }
+
+  caf::disposable subscribe(caf::flow::observer<T> out) override {
+    if (!decorated_) {
+      auto err = make_error(caf::sec::too_many_observers,
+                            "wakeup_coalescer may only be subscribed to once");
+      out.on_error(err);
+      return {};
+    }
+    using sub_t = wakeup_coalescer_sub<T>;
+    auto sub = caf::make_counted<sub_t>(self_, out, batch_size_, delay_);
+    out.on_subscribe(caf::flow::subscription{sub});
+    decorated_.subscribe(caf::flow::observer<T>{sub});
+    decorated_ = nullptr;
+    return sub->as_disposable();
+  }
+
+private:
+  caf::scheduled_actor* self_;
+  decorated_type decorated_;
+  size_t batch_size_;
+  timespan delay_;
+};
+
+/// Utility class for adding a @ref wakeup_coalescer to an `observable`.
+struct add_wakeup_coalescer_t {
+  caf::scheduled_actor* self;
+  size_t batch_size;
+  timespan delay;
+
+  template <class Observable>
+  auto operator()(Observable&& input) const {
+    using obs_t = typename std::decay_t<Observable>;
+    using val_t = typename obs_t::output_type;
+    using impl_t = wakeup_coalescer<val_t>;
+    auto obs = std::forward<Observable>(input).as_observable();
+    auto ptr = caf::make_counted<impl_t>(self, std::move(obs), batch_size,
+                                         delay);
+    return caf::flow::observable<val_t>{ptr};
+  }
+};
+
+} // namespace broker::internal
@@ -0,0 +1,110 @@
+#include "broker/internal/wakeup_coalescer.hh"
+
+#include "broker/broker-test.test.hh"
+#include "broker/flow_test_util.test.hh"
+
+#include <caf/event_based_actor.hpp>
+
+#include "broker/internal/type_id.hh"
+
+using namespace broker;
+
+using namespace std::literals;
+
+namespace atom = broker::internal::atom;
+
+namespace {
+
+constexpr size_t batch_size = 3;
+
+constexpr timespan delay = 10ms;
+
+// The coalescer runs its timer on an actor. Hence, the fixture hosts an actor
+// on the test coordinator instead of running on a scoped coordinator.
+struct fixture : base_fixture,
+                 flow_test_base<internal::wakeup_coalescer_sub<node_message>> {
+  caf::actor hdl;
+
+  fixture() {
+    hdl = sys.spawn([](caf::event_based_actor*) -> caf::behavior {
+      return {
+        [](atom::tick) {
+          // nop
+        },
+      };
+    });
+    sched.run();
+    init(&deref<caf::event_based_actor>(hdl), batch_size, delay);
+  }
+
+  ~fixture() {
+    caf::anon_send_exit(hdl, caf::exit_reason::user_shutdown);
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(wakeup_coalescer_tests, fixture)
+
+TEST(the coalescer passes the demand of its observer to the input) {
+  CHECK_EQUAL(in->requested, 0u);
+  uut->request(5);
+  CHECK_EQUAL(in->requested, 5u);
+  uut->request(2);
+  CHECK_EQUAL(in->requested, 7u);
+}
+
+TEST(the coalescer ships all pending items once the batch is full) {
+  uut->request(10);
+  push_data("a");
+  push_command("x");
+  CHECK(take().empty());
+  push_data("b");
+  CHECK_EQUAL(take(), string_list({"a", "x", "b"}));
+  MESSAGE("the next batch starts out empty");
+  push_data("c");
+  CHECK(take().empty());
+}
+
+TEST(the coalescer ships pending items after the delay) {
+  uut->request(10);
+  push_data("a");
+  run(delay / 2);
+  push_data("b");
+  CHECK(take().empty());
+  MESSAGE("the delay starts with the first pending item");
+  run(delay / 2);
+  CHECK_EQUAL(take(), string_list({"a", "b"}));
+  MESSAGE("shipping early cancels the timer");
+  push_data("c");
+  push_data("d");
+  push_data("e");
+  CHECK_EQUAL(take(), string_list({"c", "d", "e"}));
+  run(delay);
+  CHECK(take().empty());
+}
+
+TEST(completing the input ships pending items before completing) {
+  uut->request(10);
+  push_data("a");
+  push_data("b");
+  uut->on_complete();
+  CHECK_EQUAL(take(), string_list({"a", "b"}));
+  CHECK(out->completed);
+  CHECK(!out->failed);
+}
+
+TEST(disposing drops pending items and cancels the input) {
+  uut->request(10);
+  push_data("a");
+  uut->dispose();
+  CHECK(in->disposed());
+  run(delay);
+  CHECK(take().empty());
+  MESSAGE("items arriving after disposing never reach the observer");
+  push_data("b");
+  run(delay);
+  CHECK(take().empty());
+}
+
+FIXTURE_SCOPE_END()
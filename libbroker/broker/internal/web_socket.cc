@@ -24,20 +24,33 @@ namespace broker::internal::web_socket {
 struct trait_t {
   using value_type = caf::cow_string;
 
+  /// Enables binary frames for messages that start with `binary_frame_tag`.
+  /// Otherwise, we use text messages exclusively.
+  bool binary = false;
+
   caf::error init(const caf::settings&) {
     return caf::none;
   }
 
-  bool converts_to_binary(const caf::cow_string&) {
-    return false; // We use text messages exclusively.
+  bool converts_to_binary(const caf::cow_string& str) {
+    const auto& x = str.str();
+    return binary && !x.empty() && x.front() == binary_frame_tag;
   }
 
-  bool convert(const caf::cow_string&, caf::byte_buffer&) {
-    return false; // Never serialize to binary.
+  bool convert(const caf::cow_string& str, caf::byte_buffer& buf) {
+    auto first = reinterpret_cast<const caf::byte*>(str.str().data());
+    buf.insert(buf.end(), first + 1, first + str.str().size());
+    return true;
   }
 
-  bool convert(caf::const_byte_span, caf::cow_string&) {
-    return false; // Reject binary messages.
+  bool convert(caf::const_byte_span bytes, caf::cow_string& str) {
+    if (!binary)
+      return false; // Reject binary messages.
+    auto first = reinterpret_cast<const char*>(bytes.data());
+    auto& x = str.unshared();
+    x.push_back(binary_frame_tag);
+    x.insert(x.end(), first, first + bytes.size());
+    return true;
   }
 
   bool convert(const caf::cow_string& str, std::vector<char>& buf) {
@@ -113,10 +126,11 @@ expected<uint16_t> launch(caf::actor_system& sys,
                           const openssl_options_ptr& ssl_cfg, std::string addr,
                           uint16_t port, bool reuse_addr,
                           const std::string& allowed_path,
+                          const std::string& binary_path,
                           on_connect_t on_connect) {
   BROKER_DEBUG("launch WebSocket server:"
                << BROKER_ARG(addr) << BROKER_ARG(port) << BROKER_ARG(reuse_addr)
-               << BROKER_ARG(allowed_path));
+               << BROKER_ARG(allowed_path) << BROKER_ARG(binary_path));
   using namespace std::literals;
   // Open up the port.
   caf::uri::authority_type auth;
@@ -139,16 +153,17 @@ expected<uint16_t> launch(caf::actor_system& sys,
   using producer_res_t = caf::async::producer_resource<caf::cow_string>;
   using res_t =
     caf::expected<std::tuple<consumer_res_t, producer_res_t, trait_t>>;
-  auto on_request = [cb = std::move(on_connect),
-                     allowed_path](const caf::settings& hdr) {
+  auto on_request = [cb = std::move(on_connect), allowed_path,
+                     binary_path](const caf::settings& hdr) {
     auto path = caf::get_or(hdr, "web-socket.path", "");
-    if (path == allowed_path) {
+    auto binary = !binary_path.empty() && path == binary_path;
+    if (path == allowed_path || binary) {
       using caf::async::make_spsc_buffer_resource;
       auto [pull1, push1] = make_spsc_buffer_resource<caf::cow_string>();
       auto [pull2, push2] = make_spsc_buffer_resource<caf::cow_string>();
       connect_event_t ev{std::move(pull2), std::move(push1)};
       cb(hdr, ev);
-      return res_t{std::make_tuple(pull1, push2, trait_t{})};
+      return res_t{std::make_tuple(pull1, push2, trait_t{binary})};
     } else {
       BROKER_INFO("rejected JSON client on invalid path" << path);
       return res_t{caf::make_error(caf::sec::invalid_argument,
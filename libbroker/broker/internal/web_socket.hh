@@ -15,6 +15,11 @@ using push_t = caf::async::producer_resource<caf::cow_string>;
 
 using connect_event_t = std::pair<pull_t, push_t>;
 
+/// Prefix for messages that travel in binary WebSocket frames. The WebSocket
+/// layer strips the tag when sending and adds it when receiving. JSON text
+/// never starts with a NUL byte.
+constexpr char binary_frame_tag = '\0';
+
 using on_connect_t =
   std::function<void(const caf::settings&, connect_event_t&)>;
 
@@ -22,6 +27,7 @@ expected<uint16_t> launch(caf::actor_system& sys,
                           const openssl_options_ptr& ssl_cfg, std::string addr,
                           uint16_t port, bool reuse_addr,
                           const std::string& allowed_path,
+                          const std::string& binary_path,
                           on_connect_t on_connect);
 
 } // namespace broker::internal::web_socket
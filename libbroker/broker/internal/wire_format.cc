@@ -86,42 +86,46 @@ std::pair<ec, std::string_view> check(const drop_conn_msg& x) {
 
 namespace v1 {
 
+namespace {
+
+/// Size of the fixed part of a serialized envelope: sender (16 bytes), receiver
+/// (16 bytes), message type (1 byte), TTL (2 bytes) and topic length (2 bytes).
+constexpr size_t envelope_header_size = 37;
+
+} // namespace
+
 bool trait::convert(const envelope_ptr& msg, caf::byte_buffer& buf) {
   if (!msg) {
     BROKER_ERROR("cannot serialize a null envelope");
     return false;
   }
   BROKER_DEBUG("serialize envelope:" << *msg);
+  auto str = msg->topic();
+  if (str.size() > 0xFFFF) {
+    BROKER_ERROR("topic exceeds maximum size of 65,535 characters");
+    last_error_ = make_error(caf::sec::invalid_argument,
+                             "topic exceeds maximum size of 65,535 characters");
+    return false;
+  }
+  auto [payload, payload_size] = msg->raw_bytes();
+  // Reserve the space for the entire frame up front. The header is small, but
+  // the payload may be large. Hence, we append topic and payload as blocks
+  // instead of going through the output iterator byte by byte. The payload
+  // itself remains shared between all peers that receive this envelope.
+  buf.reserve(buf.size() + envelope_header_size + str.size() + payload_size);
   format::bin::v1::encoder sink{std::back_inserter(buf)};
-  auto write_topic = [&msg, &sink, this] {
-    auto str = msg->topic();
-    if (str.size() > 0xFFFF) {
-      BROKER_ERROR("topic exceeds maximum size of 65,535 characters");
-      last_error_ =
-        make_error(caf::sec::invalid_argument,
-                   "topic exceeds maximum size of 65,535 characters");
-      return false;
-    }
-    if (!sink.apply(static_cast<uint16_t>(str.size()))) {
-      BROKER_ERROR("failed to write topic size");
-      return false;
-    }
-    auto first = reinterpret_cast<const caf::byte*>(str.data());
-    sink.append(first, first + str.size());
-    return true;
-  };
-  auto write_payload = [&msg, &sink] {
-    auto [data, size] = msg->raw_bytes();
-    auto first = reinterpret_cast<const caf::byte*>(data);
-    sink.append(first, first + size);
-    return true;
-  };
-  return sink.apply(msg->sender())      //
-         && sink.apply(msg->receiver()) //
-         && sink.apply(msg->type())     //
-         && sink.apply(msg->ttl())      //
-         && write_topic()               //
-         && write_payload();
+  auto ok = sink.apply(msg->sender()) && sink.apply(msg->receiver())
+            && sink.apply(msg->type()) && sink.apply(msg->ttl())
+            && sink.apply(static_cast<uint16_t>(str.size()));
+  if (!ok) {
+    BROKER_ERROR("failed to write envelope header");
+    return false;
+  }
+  auto topic_first = reinterpret_cast<const caf::byte*>(str.data());
+  buf.insert(buf.end(), topic_first, topic_first + str.size());
+  auto payload_first = reinterpret_cast<const caf::byte*>(payload);
+  buf.insert(buf.end(), payload_first, payload_first + payload_size);
+  return true;
 }
 
 bool trait::convert(caf::const_byte_span bytes, envelope_ptr& msg) {
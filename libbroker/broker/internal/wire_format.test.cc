@@ -74,3 +74,74 @@ TEST(the wire format can encode and decode a data envelope) {
   CHECK(uut.convert(res, out));
   CHECK_EQ(out, caf::byte_buffer(caf_bytes.begin(), caf_bytes.end()));
 }
+
+TEST(the wire format can encode and decode a routing update delta) {
+  internal::wire_format::v1::trait uut;
+  auto sender = endpoint_id::random(1);
+  auto receiver = endpoint_id::random(2);
+  auto delta = filter_delta{lamport_timestamp{3}, lamport_timestamp{4},
+                            filter_type{"/bar", "/foo"}, filter_type{"/baz"}};
+  auto msg = routing_update_envelope::make(delta)->with(sender, receiver);
+  MESSAGE("serialization");
+  caf::byte_buffer buf;
+  CHECK(uut.convert(msg, buf));
+  MESSAGE("deserialization");
+  envelope_ptr res;
+  CHECK(uut.convert(caf::as_bytes(caf::make_span(buf)), res));
+  if (!CHECK(res != nullptr))
+    return;
+  CHECK_EQUAL(res->sender(), sender);
+  CHECK_EQUAL(res->receiver(), receiver);
+  CHECK_EQUAL(res->type(), envelope_type::routing_update);
+  auto update = res->as_routing_update();
+  CHECK(update->is_delta());
+  auto decoded = update->delta();
+  if (!CHECK(decoded.has_value()))
+    return;
+  CHECK_EQUAL(decoded->base, delta.base);
+  CHECK_EQUAL(decoded->version, delta.version);
+  CHECK_EQUAL(decoded->added, delta.added);
+  CHECK_EQUAL(decoded->removed, delta.removed);
+  CHECK(!decoded->is_snapshot_request());
+}
+
+TEST(the wire format distinguishes snapshot requests from snapshots) {
+  internal::wire_format::v1::trait uut;
+  auto sender = endpoint_id::random(1);
+  auto receiver = endpoint_id::random(2);
+  auto decode = [&](const filter_delta& delta) -> std::optional<filter_delta> {
+    auto msg = routing_update_envelope::make(delta)->with(sender, receiver);
+    caf::byte_buffer buf;
+    envelope_ptr res;
+    if (!uut.convert(msg, buf)
+        || !uut.convert(caf::as_bytes(caf::make_span(buf)), res))
+      return std::nullopt;
+    return res->as_routing_update()->delta();
+  };
+  auto request = decode(filter_delta::make_snapshot_request());
+  if (CHECK(request.has_value()))
+    CHECK(request->is_snapshot_request());
+  auto snapshot = decode(filter_delta::make_snapshot(lamport_timestamp{0}, {}));
+  if (CHECK(snapshot.has_value())) {
+    CHECK(snapshot->is_snapshot());
+    CHECK(!snapshot->is_snapshot_request());
+  }
+}
+
+TEST(serializing an envelope appends to existing buffer content) {
+  internal::wire_format::v1::trait uut;
+  auto bytes = hex2bytes(data_hex);
+  auto caf_bytes = caf::as_bytes(caf::make_span(bytes));
+  envelope_ptr msg;
+  CHECK(uut.convert(caf_bytes, msg));
+  if (!CHECK(msg != nullptr))
+    return;
+  auto forwarded = msg->with(msg->sender(), msg->receiver(), 15);
+  caf::byte_buffer out{caf::byte{0xAB}};
+  CHECK(uut.convert(forwarded, out));
+  auto expected = caf::byte_buffer{caf::byte{0xAB}};
+  expected.insert(expected.end(), caf_bytes.begin(), caf_bytes.end());
+  expected[1 + 33] = caf::byte{0};
+  expected[1 + 34] = caf::byte{15};
+  CHECK_EQ(out, expected);
+}
@@ -4,6 +4,7 @@
 #include <unordered_map>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #include "broker/data.hh"
 #include "broker/entity_id.hh"
@@ -192,6 +193,29 @@ bool inspect(Inspector& f, clear_command& x) {
     .fields(f.field("publisher", x.publisher));
 }
 
+/// Stores a single modification in a @ref batch_command.
+using batch_entry = std::variant<put_command, erase_command, expire_command,
+                                 add_command, subtract_command, clear_command>;
+
+/// Groups multiple modifications into a single command. The master applies
+/// all modifications in order as a single unit and forwards the results to its
+/// clones in a single batch.
+struct batch_command {
+  std::vector<batch_entry> entries;
+  entity_id publisher;
+  static constexpr auto tag = command_tag::action;
+};
+
+/// @relates batch_command
+template <class Inspector>
+bool inspect(Inspector& f, batch_command& x) {
+  return f //
+    .object(x)
+    .pretty_name("batch")
+    .fields(f.field("entries", x.entries), //
+            f.field("publisher", x.publisher));
+}
+
 // -- unicast: one-to-one communication between clones and the master ----------
 
 /// Causes the master to add a store writer to its list of inputs. Also acts as
@@ -231,6 +255,29 @@ bool inspect(Inspector& f, ack_clone_command& x) {
             f.field("state", x.state));
 }
 
+/// Transfers a part of the initial snapshot to a clone. The master sends all
+/// chunks before the @ref ack_clone_command, which carries the final part of
+/// the snapshot.
+struct snapshot_chunk_command {
+  /// Position of this chunk in the sequence of chunks, starting at 0.
+  uint64_t index;
+  /// Total number of chunks that precede the ACK.
+  uint64_t count;
+  snapshot state;
+  static constexpr auto tag = command_tag::producer_control;
+};
+
+/// @relates snapshot_chunk_command
+template <class Inspector>
+bool inspect(Inspector& f, snapshot_chunk_command& x) {
+  return f //
+    .object(x)
+    .pretty_name("snapshot_chunk")
+    .fields(f.field("index", x.index), //
+            f.field("count", x.count), //
+            f.field("state", x.state));
+}
+
 /// Informs the receiver that the sender successfully handled all messages up to
 /// a certain sequence number.
 struct cumulative_ack_command {
@@ -299,7 +346,8 @@ using internal_command_variant =
                erase_command, expire_command, add_command, subtract_command,
                clear_command, attach_writer_command, keepalive_command,
                cumulative_ack_command, nack_command, ack_clone_command,
-               retransmit_failed_command>;
+               retransmit_failed_command, batch_command,
+               snapshot_chunk_command>;
 
 class internal_command {
 public:
@@ -318,6 +366,8 @@ public:
     nack_command,
     ack_clone_command,
     retransmit_failed_command,
+    batch_command,
+    snapshot_chunk_command,
   };
 
   /// A sender-specific sequence ID for establishing ordering on the messages.
@@ -361,6 +411,8 @@ constexpr command_tag command_tag_by_type[] = {
   nack_command::tag,
   ack_clone_command::tag,
   retransmit_failed_command::tag,
+  batch_command::tag,
+  snapshot_chunk_command::tag,
 };
 
 inline command_tag tag_of(const internal_command_variant& x) {
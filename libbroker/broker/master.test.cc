@@ -1,17 +1,21 @@
 #include "broker/store.hh"
 
 #include "broker/broker-test.test.hh"
+#include "broker/store_fixture.test.hh"
 
 #include <chrono>
 #include <regex>
+#include <thread>
 
 #include "broker/backend.hh"
 #include "broker/data.hh"
 #include "broker/defaults.hh"
+#include "broker/detail/store_state.hh"
 #include "broker/endpoint.hh"
 #include "broker/error.hh"
 #include "broker/filter_type.hh"
 #include "broker/internal/clone_actor.hh"
+#include "broker/internal/core_actor.hh"
 #include "broker/internal/master_actor.hh"
 #include "broker/internal/native.hh"
 #include "broker/internal/type_id.hh"
@@ -172,6 +176,403 @@ TEST(local_master) {
   caf::anon_send_exit(core, caf::exit_reason::user_shutdown);
 }
 
+TEST(local_master_batch) {
+  auto core = native(ep.core());
+  run(tick_interval);
+  sched.inline_next_enqueue(); // ep.attach talks to the core (blocking)
+  auto expected_ds = ep.attach_master("foo", backend::memory);
+  REQUIRE(expected_ds.engaged());
+  auto& ds = *expected_ds;
+  run(tick_interval);
+  // apply several modifications at once
+  store::batch xs;
+  xs.put("a", 1);
+  xs.put("b", "two");
+  xs.increment("c", count{3});
+  xs.erase("a");
+  CHECK_EQUAL(xs.size(), 4u);
+  ds.apply(std::move(xs));
+  run(tick_interval);
+  // read back what we have written
+  sched.inline_next_enqueue(); // ds.get talks to the master_actor (blocking)
+  CHECK_EQUAL(error_of(ds.get("a")), ec::no_such_key);
+  sched.inline_next_enqueue();
+  CHECK_EQUAL(value_of(ds.get("b")), data{"two"});
+  sched.inline_next_enqueue();
+  CHECK_EQUAL(value_of(ds.get("c")), data{count{3}});
+  // check log
+  run(tick_interval);
+  CHECK_EQUAL(log, pattern_list({
+                     "insert\\(foo, a, 1, .+\\)",
+                     "insert\\(foo, b, two, .+\\)",
+                     "insert\\(foo, c, 3, .+\\)",
+                     "erase\\(foo, a, .+\\)",
+                   }));
+  // done
+  caf::anon_send_exit(core, caf::exit_reason::user_shutdown);
+}
+
+TEST(local_master_filtered_events) {
+  auto core = native(ep.core());
+  run(tick_interval);
+  sched.inline_next_enqueue(); // ep.attach talks to the core (blocking)
+  auto expected_ds = ep.attach_master("foo", backend::memory);
+  REQUIRE(expected_ds.engaged());
+  auto& ds = *expected_ds;
+  run(tick_interval);
+  // only keys that begin with "a" produce events
+  ds.filter_events({"a"});
+  ds.put("apple", 1);
+  ds.put("banana", 2);
+  ds.put(42, 3);
+  ds.erase("apple");
+  run(tick_interval);
+  sched.inline_next_enqueue();
+  CHECK_EQUAL(value_of(ds.get("banana")), data{2});
+  // check log
+  run(tick_interval);
+  CHECK_EQUAL(log, pattern_list({
+                     "insert\\(foo, apple, 1, .+\\)",
+                     "erase\\(foo, apple, .+\\)",
+                   }));
+  // done
+  caf::anon_send_exit(core, caf::exit_reason::user_shutdown);
+}
+
+TEST(local_master_filtered_events_per_handle) {
+  auto core = native(ep.core());
+  run(tick_interval);
+  sched.inline_next_enqueue(); // ep.attach talks to the core (blocking)
+  auto expected_ds = ep.attach_master("foo", backend::memory);
+  REQUIRE(expected_ds.engaged());
+  auto& ds = *expected_ds;
+  run(tick_interval);
+  ds.filter_events({"a"});
+  {
+    // a second handle for the same master adds its prefixes to the filter
+    sched.inline_next_enqueue();
+    auto expected_ds2 = ep.attach_master("foo", backend::memory);
+    REQUIRE(expected_ds2.engaged());
+    auto& ds2 = *expected_ds2;
+    run(tick_interval);
+    ds2.filter_events({"b"});
+    ds.put("apple", 1);
+    ds.put("banana", 2);
+    ds.put("cherry", 3);
+    run(tick_interval);
+  }
+  // destroying the second handle drops its prefixes again
+  run(tick_interval);
+  ds.put("blueberry", 4);
+  ds.put("avocado", 5);
+  run(tick_interval);
+  CHECK_EQUAL(log, pattern_list({
+                     "insert\\(foo, apple, 1, .+\\)",
+                     "insert\\(foo, banana, 2, .+\\)",
+                     "insert\\(foo, avocado, 5, .+\\)",
+                   }));
+  // done
+  caf::anon_send_exit(core, caf::exit_reason::user_shutdown);
+}
+
+FIXTURE_SCOPE_END()
+
+namespace {
+
+/// Hosts a clone without a master. The tests play the role of the master by
+/// feeding updates to the clone state directly.
+struct clone_fixture : base_fixture {
+  caf::actor clone;
+
+  clone_fixture() {
+    using caf::async::make_spsc_buffer_resource;
+    auto clock = deref<internal::core_actor>(native(ep.core())).state.clock;
+    auto [con1, prod1] = make_spsc_buffer_resource<command_message>();
+    auto [con2, prod2] = make_spsc_buffer_resource<command_message>();
+    in = prod1;
+    out = con2;
+    clone = sys.spawn<internal::clone_actor_type>(
+      ids['A'], "foo", caf::timespan{0}, std::string{},
+      caf::actor_cast<caf::actor>(self), clock, con1, prod2);
+    sched.run();
+    // Same as setting broker.store.optimistic-writes.
+    state().optimistic_writes = 1h;
+  }
+
+  ~clone_fixture() {
+    caf::anon_send_exit(clone, caf::exit_reason::user_shutdown);
+    sched.run();
+  }
+
+  internal::clone_state& state() {
+    return deref<internal::clone_actor_type>(clone).state;
+  }
+
+  /// Sends a write to the clone as a frontend would.
+  void write(internal_command_variant cmd) {
+    caf::anon_send(clone, atom::local_v, std::move(cmd));
+    sched.run();
+  }
+
+  /// Applies an update from the master.
+  template <class Command>
+  void update(Command cmd) {
+    state().consume(cmd);
+  }
+
+  /// Returns what a frontend reads for `key` or `nil` for a missing key.
+  data read(const data& key) {
+    if (auto val = state().lookup(key))
+      return *val;
+    return data{};
+  }
+
+  /// Simulates the handshake with a master.
+  void handshake() {
+    auto master = entity_id{ids['B'], 1};
+    state().master_id = master;
+    state().input.handle_handshake(master, 0, 5);
+  }
+
+  /// Runs long enough for the clone to tick at least once, even while idle.
+  void tick() {
+    using defaults::store::idle_ticks;
+    using defaults::store::tick_interval;
+    run(tick_interval * static_cast<caf::timespan::rep>(idle_ticks));
+  }
+
+  /// Returns how many writes to `key` wait for confirmation.
+  size_t pending(const data& key) {
+    auto& overlay = state().overlay;
+    if (auto i = overlay.find(key); i != overlay.end())
+      return i->second.size();
+    return 0;
+  }
+
+  caf::async::producer_resource<command_message> in;
+  caf::async::consumer_resource<command_message> out;
+};
+
+put_command put(data key, data value) {
+  return put_command{std::move(key), std::move(value), std::nullopt,
+                     entity_id{}};
+}
+
+erase_command erase(data key) {
+  return erase_command{std::move(key), entity_id{}};
+}
+
+} // namespace
+
+FIXTURE_SCOPE(optimistic_writes, clone_fixture)
+
+TEST(clones read their own writes before the master confirms them) {
+  write(put("a", 1));
+  write(put("b", 2));
+  write(erase("b"));
+  CHECK_EQUAL(read("a"), data{1});
+  CHECK_EQUAL(read("b"), data{});
+  CHECK_EQUAL(pending("a"), 1u);
+  CHECK_EQUAL(pending("b"), 2u);
+  CHECK(state().store.empty());
+}
+
+TEST(each update from the master confirms the oldest pending write) {
+  write(put("a", 1));
+  write(put("a", 2));
+  MESSAGE("the echo of the first write keeps the second one visible");
+  update(put("a", 1));
+  CHECK_EQUAL(read("a"), data{2});
+  CHECK_EQUAL(pending("a"), 1u);
+  update(put("a", 2));
+  CHECK_EQUAL(read("a"), data{2});
+  CHECK_EQUAL(pending("a"), 0u);
+  MESSAGE("erasing a key works the same way");
+  write(erase("a"));
+  CHECK_EQUAL(read("a"), data{});
+  update(erase("a"));
+  CHECK_EQUAL(read("a"), data{});
+  CHECK(state().overlay.empty());
+}
+
+TEST(writes from other clones override pending writes) {
+  write(put("a", 1));
+  write(put("a", 2));
+  update(put("a", 3));
+  CHECK_EQUAL(read("a"), data{3});
+  CHECK(state().overlay.empty());
+}
+
+TEST(clones drop writes that the master fails to confirm in time) {
+  state().optimistic_writes = 1ms;
+  write(put("a", 1));
+  CHECK_EQUAL(read("a"), data{1});
+  std::this_thread::sleep_for(2ms);
+  run(defaults::store::tick_interval);
+  CHECK_EQUAL(read("a"), data{});
+  CHECK(state().overlay.empty());
+}
+
+TEST(clearing the store or a new snapshot resets all pending writes) {
+  MESSAGE("local clear");
+  write(put("a", 1));
+  write(clear_command{entity_id{}});
+  CHECK(state().overlay.empty());
+  MESSAGE("clear from the master");
+  write(put("a", 1));
+  update(clear_command{entity_id{}});
+  CHECK(state().overlay.empty());
+  CHECK_EQUAL(read("a"), data{});
+  MESSAGE("new snapshot from the master");
+  write(put("a", 1));
+  state().set_store({{data{"b"}, data{2}}});
+  CHECK(state().overlay.empty());
+  CHECK_EQUAL(read("a"), data{});
+  CHECK_EQUAL(read("b"), data{2});
+}
+
+TEST(writes with unpredictable results clear pending writes) {
+  state().set_store({{data{"a"}, data{count{1}}}});
+  write(put("a", count{5}));
+  CHECK_EQUAL(read("a"), data{count{5}});
+  write(add_command{"a", data{count{1}}, data::type::count, std::nullopt,
+                    entity_id{}});
+  CHECK_EQUAL(pending("a"), 0u);
+  CHECK_EQUAL(read("a"), data{count{1}});
+  write(put("a", count{5}));
+  write(subtract_command{"a", data{count{1}}, std::nullopt, entity_id{}});
+  CHECK_EQUAL(pending("a"), 0u);
+  write(put("a", count{5}));
+  write(put_unique_command{"a", data{count{7}}, std::nullopt,
+                           entity_id{ids['B'], 1}, request_id{1}, entity_id{}});
+  CHECK_EQUAL(pending("a"), 0u);
+  CHECK_EQUAL(read("a"), data{count{1}});
+}
+
+FIXTURE_SCOPE_END()
+
+FIXTURE_SCOPE(local_reads, clone_fixture)
+
+TEST(clones publish their content to frontends for local reads) {
+  // Same as setting broker.store.local-reads.
+  state().local_reads = true;
+  auto frontend = std::make_shared<detail::store_state>();
+  caf::anon_send(clone, atom::increment_v,
+                 detail::shared_store_state_ptr{frontend});
+  sched.run();
+  MESSAGE("without a master, frontends read through the clone");
+  tick();
+  CHECK(frontend->local_view() == nullptr);
+  MESSAGE("after the handshake, frontends read through the view");
+  handshake();
+  state().set_store({{data{"a"}, data{1}}});
+  tick();
+  auto view = frontend->local_view();
+  REQUIRE(view != nullptr);
+  CHECK_EQUAL(view->size(), 1u);
+  CHECK_EQUAL(view->at(data{"a"}), data{1});
+  MESSAGE("updates from the master and local writes replace the view");
+  update(put("a", 2));
+  write(put("b", 3));
+  tick();
+  auto new_view = frontend->local_view();
+  REQUIRE(new_view != nullptr);
+  CHECK_EQUAL(new_view->at(data{"a"}), data{2});
+  CHECK_EQUAL(new_view->at(data{"b"}), data{3});
+  MESSAGE("readers holding the old view still see the old content");
+  CHECK_EQUAL(view->size(), 1u);
+  CHECK_EQUAL(view->at(data{"a"}), data{1});
+  MESSAGE("losing the master disables local reads");
+  state().input.handle_retransmit_failed(state().input.next_seq());
+  CHECK(!state().has_master());
+  tick();
+  CHECK(frontend->local_view() == nullptr);
+}
+
+FIXTURE_SCOPE_END()
+
+FIXTURE_SCOPE(store_master_and_clones, store_fixture)
+
+TEST(masters send large snapshots to new clones in chunks) {
+  spawn_master({{data{"a"}, data{1}},
+                {data{"b"}, data{2}},
+                {data{"c"}, data{3}},
+                {data{"d"}, data{4}},
+                {data{"e"}, data{5}}});
+  CHECK_EQUAL(master_state().snapshot_chunk_size, 2u);
+  auto clone = spawn_clone('B');
+  pump();
+  MESSAGE("two chunks with two entries each precede the ACK");
+  CHECK_EQUAL(num_routed<snapshot_chunk_command>(), 2u);
+  CHECK_EQUAL(num_routed<ack_clone_command>(), 1u);
+  REQUIRE(clone_state(clone).has_master());
+  CHECK_EQUAL(clone_state(clone).store.size(), 5u);
+  CHECK_EQUAL(read(clone, "a"), data{1});
+  CHECK_EQUAL(read(clone, "c"), data{3});
+  CHECK_EQUAL(read(clone, "e"), data{5});
+  MESSAGE("the clone receives updates after the snapshot");
+  put("f", 6);
+  pump();
+  CHECK_EQUAL(read(clone, "f"), data{6});
+}
+
+TEST(partial clones ignore keys outside of their prefix) {
+  spawn_master({{data{"a/1"}, data{1}},
+                {data{"b/1"}, data{2}},
+                {data{"a/2"}, data{3}},
+                {data{42}, data{4}}});
+  auto partial = spawn_clone('B', "a/");
+  auto full = spawn_clone('C');
+  pump();
+  REQUIRE(clone_state(partial).has_master());
+  REQUIRE(clone_state(full).has_master());
+  CHECK_EQUAL(clone_state(partial).store.size(), 2u);
+  CHECK_EQUAL(read(partial, "a/1"), data{1});
+  CHECK_EQUAL(read(partial, "a/2"), data{3});
+  CHECK_EQUAL(read(partial, "b/1"), data{});
+  CHECK_EQUAL(clone_state(full).store.size(), 4u);
+  MESSAGE("updates outside of the prefix only reach the full clone");
+  put("a/3", 5);
+  put("b/2", 6);
+  put(23, 7);
+  pump();
+  CHECK_EQUAL(read(partial, "a/3"), data{5});
+  CHECK_EQUAL(read(partial, "b/2"), data{});
+  CHECK_EQUAL(read(partial, 23), data{});
+  CHECK_EQUAL(clone_state(partial).store.size(), 3u);
+  CHECK_EQUAL(clone_state(full).store.size(), 7u);
+}
+
+TEST(masters read the size of the replay log from the configuration) {
+  spawn_master({});
+  CHECK_EQUAL(master_state().output.replay_log_size(), 8u);
+  MESSAGE("the log keeps events while no clone is attached");
+  put("a", 1);
+  put("b", 2);
+  put("c", 3);
+  pump();
+  CHECK_EQUAL(master_state().output.replay_log().size(), 3u);
+  MESSAGE("a clone that resumes at an offset in the log gets the events");
+  auto who = entity_id{ids['B'], 1};
+  master_state().dispatch(make_command_message(
+    master_topic,
+    internal_command{0, who, master_state().id, nack_command{{2}}}));
+  routed.clear();
+  pump();
+  CHECK_EQUAL(num_routed<put_command>(), 2u);
+  CHECK_EQUAL(num_routed<retransmit_failed_command>(), 0u);
+  MESSAGE("offsets before the log fail");
+  master_state().output.replay_log_size(1);
+  auto late = entity_id{ids['C'], 1};
+  master_state().dispatch(make_command_message(
+    master_topic,
+    internal_command{0, late, master_state().id, nack_command{{1}}}));
+  routed.clear();
+  pump();
+  CHECK_EQUAL(num_routed<put_command>(), 0u);
+  CHECK_EQUAL(num_routed<retransmit_failed_command>(), 1u);
+}
+
 FIXTURE_SCOPE_END()
 
 /*
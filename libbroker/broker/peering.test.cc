@@ -9,7 +9,9 @@
 #include <condition_variable>
 #include <future>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 #define SYNC_CHECK(stmt)                                                       \
@@ -58,10 +60,7 @@ static constexpr bool disable_ssl = true;
 static constexpr bool enable_ssl = false;
 
 configuration make_config(const char* test_name, size_t endpoint_nr,
-                          bool disable_ssl) {
-  broker_options opts;
-  opts.disable_forwarding = true;
-  opts.disable_ssl = disable_ssl;
+                          broker_options opts) {
   configuration cfg{opts};
   cfg.set("caf.scheduler.max-threads", 2);
   cfg.set("caf.logger.console.verbosity", "quiet");
@@ -77,6 +76,14 @@ configuration make_config(const char* test_name, size_t endpoint_nr,
   return cfg;
 }
 
+configuration make_config(const char* test_name, size_t endpoint_nr,
+                          bool disable_ssl) {
+  broker_options opts;
+  opts.disable_forwarding = true;
+  opts.disable_ssl = disable_ssl;
+  return make_config(test_name, endpoint_nr, opts);
+}
+
 std::mutex print_mtx;
 
 template <class... Ts>
@@ -173,6 +180,21 @@ std::vector<std::string> sort(std::vector<std::string> xs) {
   return xs;
 }
 
+/// Opens a port on localhost for `ep`.
+uint16_t listen_local(endpoint& ep) {
+  auto port = ep.listen("127.0.0.1", 0);
+  if (port == 0)
+    hard_error("endpoint ", to_string(ep.node_id()), " failed to open a port");
+  return port;
+}
+
+/// Lets `ep` peer with the endpoint that listens on `port` on localhost.
+void peer_local(endpoint& ep, uint16_t port) {
+  if (!ep.peer("127.0.0.1", port, 0s))
+    hard_error("endpoint ", to_string(ep.node_id()), " failed to peer on port ",
+               port);
+}
+
 std::vector<std::string> grep_hello(std::vector<data_message> xs) {
   auto str = "hello"s;
   std::vector<std::string> result;
@@ -402,6 +424,79 @@ TEST(the master may appear after launching the clones) {
     hdl.join();
 }
 
+TEST(clones stay in sync with a small sending window) {
+  MESSAGE("initialize state");
+  static constexpr size_t num_keys = 32;
+  barrier listening{num_endpoints};
+  barrier peered{num_endpoints};
+  barrier attached{num_endpoints};
+  barrier written_to_store{num_endpoints};
+  MESSAGE("spin up threads");
+  for (size_t index = 0; index != num_endpoints; ++index) {
+    threads[index] = std::thread{[&, index] {
+      auto cfg = make_config("small-window", index, disable_ssl);
+      // Forces the master to hold back most of its commands.
+      cfg.set("broker.store.max-window", 2);
+      endpoint ep{std::move(cfg)};
+      *ep_ids[index] = ep.node_id();
+      store services;
+      if (index == 0) {
+        if (auto maybe_services = ep.attach_master("zeek/known/services",
+                                                   backend::memory)) {
+          services = std::move(*maybe_services);
+        } else {
+          SYNC_CHECK_FAILED("attach_master failed: ",
+                            to_string(maybe_services.error()));
+        }
+      }
+      auto port = ep.listen();
+      if (port == 0)
+        hard_error("endpoint ", to_string(ep.node_id()),
+                   " failed to open a port");
+      ports[index] = port;
+      std::map<endpoint_id, std::future<bool>> peer_results;
+      listening.arrive_and_wait();
+      for (size_t i = 0; i != num_endpoints; ++i) {
+        if (i != index) {
+          auto p = ports[i].load();
+          peer_results.emplace(*ep_ids[i], ep.peer_async("localhost", p, 1s));
+        }
+      }
+      for (auto& [other_id, res] : peer_results) {
+        if (!res.get()) {
+          SYNC_CHECK_FAILED("endpoint ", to_string(ep.node_id()),
+                            " failed to connect to ", to_string(other_id));
+        }
+      }
+      peered.arrive_and_wait();
+      if (index != 0) {
+        if (auto maybe_services = ep.attach_clone("zeek/known/services", 0.5);
+            SYNC_CHECK(maybe_services)) {
+          services = std::move(*maybe_services);
+          SYNC_CHECK(services.await_idle());
+        }
+        attached.arrive_and_wait();
+        written_to_store.arrive_and_wait();
+        SYNC_CHECK(services.await_idle());
+        for (size_t i = 0; i != num_keys; ++i) {
+          if (auto val = services.get("key-" + std::to_string(i));
+              SYNC_CHECK(val) && SYNC_CHECK(is<integer>(*val)))
+            SYNC_CHECK_EQUAL(get<integer>(*val), static_cast<integer>(i));
+        }
+      } else {
+        attached.arrive_and_wait();
+        for (size_t i = 0; i != num_keys; ++i)
+          services.put("key-" + std::to_string(i), static_cast<integer>(i));
+        // The master only becomes idle after all clones ACKed all commands.
+        SYNC_CHECK(services.await_idle());
+        written_to_store.arrive_and_wait();
+      }
+    }};
+  }
+  for (auto& hdl : threads)
+    hdl.join();
+}
+
 TEST(only one put_unique may pass) {
   MESSAGE("initialize state");
   barrier listening{num_endpoints};
@@ -566,3 +661,150 @@ SCENARIO("handshake fails if only one side enables encryption") {
 }
 
 FIXTURE_SCOPE_END()
+
+// -- configuration options of the peering layer -------------------------------
+
+namespace {
+
+/// Connects three endpoints to a triangle, publishes `num` messages at the
+/// first endpoint and returns how many messages reach the subscriber at the
+/// third endpoint.
+size_t publish_in_triangle(const char* test_name, size_t duplicate_cache_size,
+                           size_t num) {
+  broker_options opts;
+  opts.disable_ssl = true;
+  opts.ttl = 4;
+  std::vector<std::unique_ptr<endpoint>> eps;
+  for (size_t index = 0; index != 3; ++index) {
+    auto cfg = make_config(test_name, index, opts);
+    cfg.set("broker.duplicate-cache-size", duplicate_cache_size);
+    eps.emplace_back(std::make_unique<endpoint>(std::move(cfg)));
+  }
+  auto sub = eps[2]->make_subscriber({"foo/bar"});
+  auto port1 = listen_local(*eps[1]);
+  auto port2 = listen_local(*eps[2]);
+  peer_local(*eps[0], port1);
+  peer_local(*eps[0], port2);
+  peer_local(*eps[1], port2);
+  if (!eps[0]->await_peer(eps[2]->node_id())
+      || !eps[1]->await_peer(eps[2]->node_id()))
+    hard_error("subscriptions of the third endpoint failed to propagate");
+  for (size_t i = 0; i != num; ++i)
+    eps[0]->publish("foo/bar", data{static_cast<count>(i)});
+  auto result = sub.get(num, 1s).size();
+  // Give copies via the longer paths some time to arrive.
+  std::this_thread::sleep_for(200ms);
+  return result + sub.poll().size();
+}
+
+} // namespace
+
+TEST(duplicate caches drop copies of messages in meshed topologies) {
+  MESSAGE("without a duplicate cache, messages travel along all paths");
+  CHECK_GREATER(publish_in_triangle("duplicate-cache-off", 0, 10), 10u);
+  MESSAGE("with a duplicate cache, each message arrives exactly once");
+  CHECK_EQUAL(publish_in_triangle("duplicate-cache-on", 128, 10), 10u);
+}
+
+TEST(draining peers on shutdown delivers all published messages) {
+  static constexpr size_t num = 100;
+  broker_options opts;
+  opts.disable_ssl = true;
+  opts.disable_forwarding = true;
+  endpoint receiver{make_config("drain-peers", 1, opts)};
+  auto sub = receiver.make_subscriber({"foo/bar"});
+  auto port = listen_local(receiver);
+  {
+    endpoint sender{make_config("drain-peers", 0, opts)};
+    sender.drain_peers_on_shutdown(true);
+    peer_local(sender, port);
+    REQUIRE(sender.await_peer(receiver.node_id()));
+    for (size_t i = 0; i != num; ++i)
+      sender.publish("foo/bar", data{static_cast<count>(i)});
+    // Leaving the scope shuts down the sender right after publishing.
+  }
+  auto msgs = sub.get(num, 5s);
+  REQUIRE_EQUAL(msgs.size(), num);
+  for (size_t i = 0; i != num; ++i)
+    CHECK_EQUAL(get_data(msgs[i]).to_data(), data{static_cast<count>(i)});
+}
+
+TEST(qos classes limit the rate of data messages per topic prefix) {
+  static constexpr size_t num = 50;
+  broker_options opts;
+  opts.disable_ssl = true;
+  opts.disable_forwarding = true;
+  auto cfg = make_config("qos-classes", 0, opts);
+  // Admits a burst of five messages on "foo" and one message per second
+  // afterwards. Topics without a class have no limit.
+  cfg.set("broker.qos.classes", std::vector<std::string>{"foo=normal:1:5"});
+  endpoint sender{std::move(cfg)};
+  endpoint receiver{make_config("qos-classes", 1, opts)};
+  auto sub = receiver.make_subscriber({"foo", "bar"});
+  peer_local(sender, listen_local(receiver));
+  REQUIRE(sender.await_peer(receiver.node_id()));
+  for (size_t i = 0; i != num; ++i)
+    sender.publish("foo/x", data{static_cast<count>(i)});
+  for (size_t i = 0; i != num; ++i)
+    sender.publish("bar/x", data{static_cast<count>(i)});
+  MESSAGE("the messages on bar mark the end of the messages on foo");
+  size_t foo = 0;
+  size_t bar = 0;
+  while (bar < num) {
+    auto msg = sub.get(5s);
+    if (!msg)
+      break;
+    if (get_topic(*msg).rfind("foo", 0) == 0)
+      ++foo;
+    else
+      ++bar;
+  }
+  CHECK_EQUAL(bar, num);
+  CHECK_GREATER_EQUAL(foo, 5u);
+  CHECK_LESS(foo, 10u);
+}
+
+namespace {
+
+/// Counts how often an endpoint fails to reach a closed port within `window`
+/// when retrying every 10ms.
+size_t count_connection_failures(const char* test_name,
+                                 timespan max_retry_interval,
+                                 timespan window) {
+  broker_options opts;
+  opts.disable_ssl = true;
+  opts.disable_forwarding = true;
+  uint16_t port = 0;
+  {
+    // Picks a port that no endpoint listens on after leaving the scope.
+    endpoint tmp{make_config(test_name, 1, opts)};
+    port = listen_local(tmp);
+  }
+  opts.max_retry_interval = max_retry_interval;
+  endpoint ep{make_config(test_name, 0, opts)};
+  auto sub = ep.make_status_subscriber();
+  ep.peer_nosync("127.0.0.1", port, 10ms);
+  size_t result = 0;
+  auto deadline = broker::now() + window;
+  while (broker::now() < deadline) {
+    auto msg = sub.get(deadline);
+    if (auto err = std::get_if<error>(&msg);
+        err && *err == ec::peer_unavailable)
+      ++result;
+  }
+  return result;
+}
+
+} // namespace
+
+TEST(connection retries back off up to the maximum retry interval) {
+  auto fixed = count_connection_failures("max-retry-off", timespan{0}, 500ms);
+  auto backoff = count_connection_failures("max-retry-on", 1s, 500ms);
+  MESSAGE(fixed << " failures with fixed retries, " << backoff
+                << " failures with backoff");
+  MESSAGE("without backoff, the endpoint retries every 10ms");
+  CHECK_GREATER(fixed, 15u);
+  MESSAGE("with backoff, the intervals double after each failure");
+  CHECK_LESS(backoff, 10u);
+  CHECK_LESS(backoff, fixed);
+}
@@ -54,10 +54,11 @@ std::string_view ping_envelope::topic() const noexcept {
 }
 
 envelope_ptr ping_envelope::with(endpoint_id new_sender,
-                                 endpoint_id new_receiver) const {
+                                 endpoint_id new_receiver,
+                                 uint16_t new_ttl) const {
   using decorator_ptr = intrusive_ptr<envelope::decorator<ping_envelope>>;
   return decorator_ptr::make(intrusive_ptr{new_ref, this}, new_sender,
-                             new_receiver);
+                             new_receiver, new_ttl);
 }
 
 std::string ping_envelope::stringify() const {
@@ -79,9 +80,9 @@ ping_envelope_ptr ping_envelope::make(const endpoint_id& sender,
 expected<envelope_ptr> ping_envelope::deserialize(
   const endpoint_id& sender, const endpoint_id& receiver, uint16_t ttl,
   std::string_view topic_str, const std::byte* payload, size_t payload_size) {
-  using impl_ptr = intrusive_ptr<envelope::deserialized<ping_envelope>>;
-  return impl_ptr::make(sender, receiver, ttl, topic_str, payload,
-                        payload_size);
+  using impl = envelope::deserialized<ping_envelope>;
+  return impl::make<impl>(sender, receiver, ttl, topic_str, payload,
+                          payload_size, 0);
 }
 
 } // namespace broker
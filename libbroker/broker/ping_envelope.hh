@@ -11,8 +11,10 @@ public:
 
   std::string_view topic() const noexcept override;
 
-  envelope_ptr with(endpoint_id new_sender,
-                    endpoint_id new_receiver) const final;
+  using envelope::with;
+
+  envelope_ptr with(endpoint_id new_sender, endpoint_id new_receiver,
+                    uint16_t new_ttl) const final;
 
   std::string stringify() const override;
 
@@ -1,14 +1,18 @@
 #include "broker/publisher.hh"
 
+#include <algorithm>
+#include <functional>
 #include <future>
 #include <numeric>
 
+#include <caf/actor_system_config.hpp>
 #include <caf/flow/observable.hpp>
 #include <caf/scheduled_actor/flow.hpp>
 #include <caf/send.hpp>
 
 #include "broker/builder.hh"
 #include "broker/data.hh"
+#include "broker/defaults.hh"
 #include "broker/detail/assert.hh"
 #include "broker/detail/flare.hh"
 #include "broker/endpoint.hh"
@@ -48,6 +52,12 @@ public:
     return *buf_;
   }
 
+  /// Signals demand only once it reaches `n`.
+  void wakeup_threshold(size_t n) {
+    guard_type guard{mtx_};
+    threshold_ = std::clamp(n, size_t{1}, buf_->capacity());
+  }
+
   void on_consumer_ready() override {
     BROKER_TRACE("");
   }
@@ -64,14 +74,27 @@ public:
     BROKER_TRACE(BROKER_ARG(demand));
     BROKER_ASSERT(demand > 0);
     guard_type guard{mtx_};
-    if (demand_ == 0) {
-      demand_ = demand;
+    demand_ += demand;
+    // Wake up the publisher only once the demand reaches the threshold. This
+    // saves wakeups when the consumer signals demand in small increments.
+    if (!signaled_ && demand_ >= threshold_) {
+      signaled_ = true;
       fx_.fire();
-    } else {
-      demand_ += demand;
+      // Call the user-defined callback without holding the lock, because the
+      // callback may call `try_push`.
+      if (demand_cb_) {
+        auto cb = demand_cb_;
+        guard.unlock();
+        cb();
+      }
     }
   }
 
+  void on_demand(std::function<void()> f) {
+    guard_type guard{mtx_};
+    demand_cb_ = std::move(f);
+  }
+
   void ref_producer() const noexcept override {
     ref();
   }
@@ -115,6 +138,7 @@ public:
     } else {
       auto n = demand_;
       demand_ = 0;
+      signaled_ = false;
       fx_.extinguish();
       guard.unlock();
       buf_->push(items.subspan(0, n));
@@ -122,6 +146,26 @@ public:
     }
   }
 
+  /// Pushes as many items as the current demand allows without blocking.
+  /// @returns the number of pushed items.
+  size_t try_push(caf::span<const value_type> items) {
+    BROKER_TRACE(BROKER_ARG2("items.size", items.size()));
+    if (items.empty())
+      return 0;
+    guard_type guard{mtx_};
+    if (cancelled_ || demand_ == 0)
+      return 0;
+    auto n = std::min(items.size(), demand_);
+    demand_ -= n;
+    if (demand_ == 0) {
+      signaled_ = false;
+      fx_.extinguish();
+    }
+    guard.unlock();
+    buf_->push(items.subspan(0, n));
+    return n;
+  }
+
   friend void intrusive_ptr_add_ref(const publisher_queue* ptr) noexcept {
     ptr->ref();
   }
@@ -143,8 +187,17 @@ private:
   /// Stores how many demand we currently have from the consumer.
   size_t demand_ = 0;
 
+  /// Minimum demand before firing the flare.
+  size_t threshold_ = 1;
+
+  /// Stores whether we fired the flare since the demand dropped to zero.
+  bool signaled_ = false;
+
   /// Stores whether the consumer stopped receiving data.
   bool cancelled_ = false;
+
+  /// Runs whenever the demand goes up from zero.
+  std::function<void()> demand_cb_;
 };
 
 namespace {
@@ -190,6 +243,10 @@ publisher publisher::make(endpoint& ep, topic t) {
   auto buf = prod_res.try_open();
   BROKER_ASSERT(buf != nullptr);
   auto qptr = caf::make_counted<detail::publisher_queue>(buf);
+  internal::endpoint_access access{&ep};
+  qptr->wakeup_threshold(caf::get_or(access.cfg(),
+                                     "broker.publisher.wakeup-threshold",
+                                     defaults::publisher::wakeup_threshold));
   buf->set_producer(qptr);
   return publisher{detail::make_opaque(std::move(qptr)), std::move(t)};
 }
@@ -223,7 +280,7 @@ void publisher::drop_all_on_destruction() {
 void publisher::publish(const data& x) {
   auto msg = make_data_message(topic_, x);
   BROKER_DEBUG("publishing" << msg);
-  dptr(queue_)->push(caf::make_span(&msg, 1));
+  push(&msg, 1);
 }
 
 void publisher::publish(const std::vector<data>& xs) {
@@ -236,22 +293,57 @@ void publisher::publish(const std::vector<data>& xs) {
   for (auto& msg : msgs)
     BROKER_DEBUG("publishing" << msg);
 #endif
-  dptr(queue_)->push(msgs);
+  push(msgs.data(), msgs.size());
 }
 
 void publisher::publish(set_builder&& x) {
   auto msg = std::move(x).build_envelope(topic_.string());
-  dptr(queue_)->push(caf::make_span(&msg, 1));
+  push(&msg, 1);
 }
 
 void publisher::publish(table_builder&& x) {
   auto msg = std::move(x).build_envelope(topic_.string());
-  dptr(queue_)->push(caf::make_span(&msg, 1));
+  push(&msg, 1);
 }
 
 void publisher::publish(list_builder&& x) {
   auto msg = std::move(x).build_envelope(topic_.string());
-  dptr(queue_)->push(caf::make_span(&msg, 1));
+  push(&msg, 1);
+}
+
+size_t publisher::try_publish(const data& x) {
+  auto msg = make_data_message(topic_, x);
+  return dptr(queue_)->try_push(caf::make_span(&msg, 1));
+}
+
+size_t publisher::try_publish(const std::vector<data>& xs) {
+  // The demand can only grow while we build the messages, since the publisher
+  // is the only producer. Hence, skip building messages we can't send anyway.
+  auto n = std::min(xs.size(), demand());
+  if (n == 0)
+    return 0;
+  std::vector<data_message> msgs;
+  msgs.reserve(n);
+  for (size_t i = 0; i < n; ++i)
+    msgs.push_back(make_data_message(topic_, xs[i]));
+  return dptr(queue_)->try_push(msgs);
+}
+
+void publisher::on_demand(std::function<void()> f) {
+  dptr(queue_)->on_demand(std::move(f));
+}
+
+void publisher::push(const data_message* xs, size_t num) {
+  auto items = caf::make_span(xs, num);
+  if (policy_ == overflow_policy::block) {
+    dptr(queue_)->push(items);
+    return;
+  }
+  auto n = dptr(queue_)->try_push(items);
+  if (n < num) {
+    BROKER_DEBUG("drop" << (num - n) << "messages: no demand");
+    dropped_ += num - n;
+  }
 }
 
 void publisher::reset() {
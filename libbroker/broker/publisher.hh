@@ -8,6 +8,7 @@
 
 #include <chrono>
 #include <cstddef>
+#include <functional>
 #include <vector>
 
 namespace broker {
@@ -19,12 +20,22 @@ public:
 
   friend class endpoint;
 
+  friend class shared_publisher;
+
   // --- nested types ----------------------------------------------------------
 
   using value_type = data_message;
 
   using guard_type = std::unique_lock<std::mutex>;
 
+  /// Configures how `publish` behaves if the core has no demand.
+  enum class overflow_policy {
+    /// Blocks the caller until the core signals demand.
+    block,
+    /// Drops all messages that exceed the current demand.
+    drop,
+  };
+
   // --- constructors and destructors ------------------------------------------
 
   publisher(publisher&&) = default;
@@ -58,15 +69,35 @@ public:
   size_t free_capacity() const;
 
   /// Returns a file handle for integrating this publisher into a `select` or
-  /// `poll` loop.
+  /// `poll` loop. The handle becomes ready whenever the core signals demand.
   detail::native_socket fd() const;
 
+  /// Returns the current overflow policy.
+  overflow_policy policy() const noexcept {
+    return policy_;
+  }
+
+  /// Returns how many messages `publish` dropped due to the overflow policy.
+  size_t dropped() const noexcept {
+    return dropped_;
+  }
+
   // --- mutators --------------------------------------------------------------
 
   /// Forces the publisher to drop all remaining items from the queue when the
   /// destructor gets called.
   void drop_all_on_destruction();
 
+  /// Sets the overflow policy for all `publish` member functions.
+  void policy(overflow_policy value) noexcept {
+    policy_ = value;
+  }
+
+  /// Installs a callback that runs whenever the demand of the core increases
+  /// from zero. The callback runs in a thread of the Broker core and thus must
+  /// return quickly.
+  void on_demand(std::function<void()> f);
+
   // --- messaging -------------------------------------------------------------
 
   /// Sends `x` to all subscribers.
@@ -84,6 +115,16 @@ public:
   /// Sends `x` to all subscribers.
   void publish(list_builder&& x);
 
+  /// Sends `x` to all subscribers if the core has demand. Never blocks.
+  /// @returns 1 if the publisher accepted `x`, 0 otherwise.
+  size_t try_publish(const data& x);
+
+  /// Sends as many items of `xs` to all subscribers as the current demand of
+  /// the core allows. Never blocks.
+  /// @returns the number of accepted items, i.e., the publisher accepted all
+  ///          items of `xs` before that position.
+  size_t try_publish(const std::vector<data>& xs);
+
   // --- miscellaneous ---------------------------------------------------------
 
   /// Release any state held by the object, rendering it invalid.
@@ -102,9 +143,14 @@ private:
   // -- force users to use `endpoint::make_publsiher` -------------------------
   publisher(detail::opaque_ptr q, topic t);
 
+  /// Pushes pre-built messages to the queue, blocking if necessary.
+  void push(const data_message* xs, size_t num);
+
   detail::opaque_ptr queue_;
   topic topic_;
   bool drop_on_destruction_ = false;
+  overflow_policy policy_ = overflow_policy::block;
+  size_t dropped_ = 0;
 };
 
 } // namespace broker
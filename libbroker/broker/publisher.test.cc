@@ -23,6 +23,10 @@
 #include "broker/message.hh"
 #include "broker/topic.hh"
 
+#include <algorithm>
+#include <atomic>
+#include <map>
+
 using broker::internal::native;
 using std::cout;
 using std::endl;
@@ -37,6 +41,11 @@ namespace {
 
 struct no_state {};
 
+struct partition_state {
+  size_t id = 0;
+  std::shared_ptr<std::vector<std::vector<count>>> logs;
+};
+
 } // namespace
 
 FIXTURE_SCOPE(publisher_tests, net_fixture<base_fixture>)
@@ -82,6 +91,121 @@ TEST(publishers make data available to remote subscribers) {
   mars.ep.stop(mars_sub);
 }
 
+TEST(subscribers may consume messages in batches) {
+  auto batches = std::make_shared<std::vector<size_t>>();
+  auto received = std::make_shared<std::vector<data_message>>();
+  auto sub = earth.ep.subscribe(
+    {"foo"},
+    [batches, received](span<const data_message> msgs) {
+      batches->push_back(msgs.size());
+      received->insert(received->end(), msgs.begin(), msgs.end());
+    });
+  run();
+  bridge(earth, mars);
+  auto pub = mars.ep.make_publisher("foo");
+  run();
+  for (count i = 0; i < 10; ++i)
+    pub.publish(data{i});
+  run();
+  REQUIRE_EQUAL(received->size(), 10u);
+  for (count i = 0; i < 10; ++i)
+    CHECK_EQUAL(get_data(received->at(i)), data{i});
+  MESSAGE("the sink sees fewer calls than messages");
+  CHECK_LESS(batches->size(), 10u);
+  earth.ep.stop(sub);
+}
+
+TEST(parallel subscribers retain the order per key) {
+  auto logs = std::make_shared<std::vector<std::vector<count>>>();
+  auto sub = earth.ep.subscribe_parallel(
+    {"foo"}, 3,
+    [](const data_message& msg) { return get<count>(get_data(msg)) % 4; },
+    [logs](partition_state& st) {
+      st.id = logs->size();
+      st.logs = logs;
+      logs->emplace_back();
+    },
+    [](partition_state& st, const data_message& msg) {
+      (*st.logs)[st.id].push_back(get<count>(get_data(msg)));
+    },
+    [](partition_state&, const error&) {});
+  REQUIRE_EQUAL(logs->size(), 3u);
+  run();
+  bridge(earth, mars);
+  auto pub = mars.ep.make_publisher("foo");
+  run();
+  for (count i = 0; i < 20; ++i)
+    pub.publish(data{i});
+  run();
+  MESSAGE("each key goes to exactly one worker and retains its order");
+  size_t total = 0;
+  std::map<count, size_t> owners;
+  for (size_t id = 0; id < logs->size(); ++id) {
+    const auto& xs = (*logs)[id];
+    total += xs.size();
+    CHECK(std::is_sorted(xs.begin(), xs.end()));
+    for (auto x : xs) {
+      auto i = owners.emplace(x % 4, id).first;
+      CHECK_EQUAL(i->second, id);
+    }
+  }
+  CHECK_EQUAL(total, 20u);
+  CHECK_EQUAL(owners.size(), 4u);
+  earth.ep.stop(sub);
+}
+
+TEST(publish_all drivers may fill buffers in place) {
+  auto received = std::make_shared<std::vector<count>>();
+  auto sub = earth.ep.subscribe({"foo"}, [received](const data_message& msg) {
+    received->push_back(get<count>(get_data(msg)));
+  });
+  run();
+  bridge(earth, mars);
+  run();
+  auto src = mars.ep.publish_all(
+    [](count& next) { next = 0; },
+    [](count& next, span<data_message> buf) {
+      size_t n = 0;
+      for (; n < buf.size() && next < 2000; ++n)
+        buf[n] = make_data_message("foo", data{next++});
+      return n;
+    },
+    [](const count& next) { return next == 2000; });
+  run();
+  REQUIRE_EQUAL(received->size(), 2000u);
+  for (count i = 0; i < 2000; ++i)
+    CHECK_EQUAL(received->at(i), i);
+  earth.ep.stop(sub);
+  mars.ep.stop(src);
+}
+
+TEST(try_publish never blocks and drops excess messages on request) {
+  bridge(earth, mars);
+  auto pub = mars.ep.make_publisher("foo");
+  run();
+  auto initial_demand = pub.demand();
+  REQUIRE_GREATER_EQUAL(initial_demand, 2u);
+  MESSAGE("try_publish accepts messages only while the core has demand");
+  std::vector<data> xs;
+  for (count i = 0; i < initial_demand + 5; ++i)
+    xs.emplace_back(i);
+  CHECK_EQUAL(pub.try_publish(xs), initial_demand);
+  CHECK_EQUAL(pub.demand(), 0u);
+  CHECK_EQUAL(pub.try_publish(data{"bar"}), 0u);
+  MESSAGE("the drop policy makes publish discard messages without demand");
+  pub.policy(publisher::overflow_policy::drop);
+  pub.publish(data{"bar"});
+  pub.publish(xs);
+  CHECK_EQUAL(pub.dropped(), xs.size() + 1);
+  MESSAGE("the demand callback fires once the core consumed the messages");
+  auto notifications = std::make_shared<std::atomic<size_t>>(0);
+  pub.on_demand([notifications] { ++*notifications; });
+  run();
+  CHECK_GREATER(notifications->load(), 0u);
+  CHECK_EQUAL(pub.demand(), initial_demand);
+  CHECK_EQUAL(pub.try_publish(data{"bar"}), 1u);
+}
+
 FIXTURE_SCOPE_END()
 
 // This regression test requires a non-deterministic setup since it checks that
@@ -118,6 +118,23 @@ TEST(long prefix) {
                     {make_pair("this:key:has:a:long:common:prefix:2", 2)}));
 }
 
+TEST(prefix_of only reports full prefix matches for long partials) {
+  test_radix_tree rt{
+    {"zeek/event/long", 1},
+    {"zeek/event/long/prefix/a", 2},
+    {"zeek/event/long/prefix/b", 3},
+  };
+  CHECK(rt.prefix_of("zeek/event/lonx").empty());
+  CHECK(check_match(rt.prefix_of("zeek/event/long/prefix/c"),
+                    {make_pair("zeek/event/long", 1)}));
+  std::set<pair<string, int>> visited;
+  rt.for_each_prefix_of("zeek/event/long/prefix/abc",
+                        [&visited](const auto& kvp) { visited.emplace(kvp); });
+  std::set<pair<string, int>> expected{make_pair("zeek/event/long", 1),
+                                       make_pair("zeek/event/long/prefix/a", 2)};
+  CHECK(visited == expected);
+}
+
 TEST(prefix_of) {
   test_radix_tree t{make_pair("one", 1)};
 
@@ -8,12 +8,65 @@
 #include <caf/binary_serializer.hpp>
 #include <caf/byte_buffer.hpp>
 
+#include <cstring>
+
 using namespace std::literals;
 
 namespace binfmt = broker::format::bin::v1;
 
 namespace broker {
 
+namespace {
+
+/// Marks a delta as a request for a full snapshot.
+constexpr uint8_t snapshot_request_flag = 0x01;
+
+template <class OutIter>
+OutIter write_topics(const std::vector<broker::topic>& entries, OutIter out) {
+  out = binfmt::write_varbyte(entries.size(), out);
+  for (auto& entry : entries) {
+    const auto& str = entry.string();
+    out = binfmt::write_varbyte(str.size(), out);
+    for (auto c : str)
+      *out++ = static_cast<std::byte>(c);
+  }
+  return out;
+}
+
+bool read_topics(binfmt::const_byte_pointer& pos,
+                 binfmt::const_byte_pointer end,
+                 std::vector<broker::topic>& entries) {
+  auto num_entries = size_t{0};
+  if (!binfmt::read_varbyte(pos, end, num_entries))
+    return false;
+  // Each entry needs at least one byte for its size.
+  if (num_entries > static_cast<size_t>(end - pos))
+    return false;
+  entries.reserve(num_entries);
+  for (size_t i = 0; i < num_entries; ++i) {
+    auto len = size_t{0};
+    if (!binfmt::read_varbyte(pos, end, len)
+        || len > static_cast<size_t>(end - pos))
+      return false;
+    entries.emplace_back(std::string{reinterpret_cast<const char*>(pos), len});
+    pos += len;
+  }
+  return true;
+}
+
+bool read_version(binfmt::const_byte_pointer& pos,
+                  binfmt::const_byte_pointer end, lamport_timestamp& result) {
+  if (end - pos < static_cast<ptrdiff_t>(sizeof(uint64_t)))
+    return false;
+  auto tmp = uint64_t{0};
+  memcpy(&tmp, pos, sizeof(tmp));
+  result.value = binfmt::from_network_order(tmp);
+  pos += sizeof(tmp);
+  return true;
+}
+
+} // namespace
+
 std::string_view routing_update_iterator::operator*() const {
   auto len = size_t{0};
   auto ptr = pos_;
@@ -41,16 +94,44 @@ std::string_view routing_update_envelope::topic() const noexcept {
 }
 
 envelope_ptr routing_update_envelope::with(endpoint_id new_sender,
-                                           endpoint_id new_receiver) const {
+                                           endpoint_id new_receiver,
+                                           uint16_t new_ttl) const {
   using decorator_ptr =
     intrusive_ptr<envelope::decorator<routing_update_envelope>>;
   return decorator_ptr::make(intrusive_ptr{new_ref, this}, new_sender,
-                             new_receiver);
+                             new_receiver, new_ttl);
 }
 
 std::string routing_update_envelope::stringify() const {
   auto result = "routing_update("s;
   result += topic();
+  if (is_delta()) {
+    auto append_all = [&result](const std::vector<broker::topic>& entries) {
+      result += '{';
+      for (size_t i = 0; i < entries.size(); ++i) {
+        if (i > 0)
+          result += ", ";
+        result += entries[i].string();
+      }
+      result += '}';
+    };
+    if (auto dt = delta(); dt && dt->is_snapshot_request()) {
+      result += ", snapshot-request)";
+    } else if (dt) {
+      result += ", ";
+      result += std::to_string(dt->base.value);
+      result += ", ";
+      result += std::to_string(dt->version.value);
+      result += ", ";
+      append_all(dt->added);
+      result += ", ";
+      append_all(dt->removed);
+      result += ')';
+    } else {
+      result += ", <invalid>)";
+    }
+    return result;
+  }
   result += ", {";
   if (filter_size() > 0) {
     auto i = begin();
@@ -83,17 +164,43 @@ routing_update_iterator routing_update_envelope::begin() const noexcept {
   return routing_update_iterator{ptr, data + data_size};
 }
 
+std::optional<filter_delta> routing_update_envelope::delta() const {
+  if (!is_delta())
+    return std::nullopt;
+  // Format: flags, base version, new version, added topics, removed topics.
+  auto [data, data_size] = raw_bytes();
+  auto pos = binfmt::const_byte_pointer{data};
+  auto end = pos + data_size;
+  if (pos == end)
+    return std::nullopt;
+  auto flags = static_cast<uint8_t>(*pos++);
+  if ((flags & ~snapshot_request_flag) != 0)
+    return std::nullopt;
+  filter_delta result;
+  result.snapshot_request = (flags & snapshot_request_flag) != 0;
+  if (!read_version(pos, end, result.base)
+      || !read_version(pos, end, result.version)
+      || !read_topics(pos, end, result.added)
+      || !read_topics(pos, end, result.removed) || pos != end)
+    return std::nullopt;
+  return result;
+}
+
 namespace {
 
 class default_routing_update_envelope : public routing_update_envelope {
 public:
   using byte_buffer = std::vector<std::byte>;
 
-  explicit default_routing_update_envelope(byte_buffer payload)
-    : payload_(std::move(payload)) {
+  default_routing_update_envelope(byte_buffer payload, bool is_delta)
+    : payload_(std::move(payload)), is_delta_(is_delta) {
     // nop
   }
 
+  std::string_view topic() const noexcept override {
+    return is_delta_ ? delta_topic : broker::topic::reserved;
+  }
+
   std::pair<const std::byte*, size_t> raw_bytes() const noexcept override {
     return {payload_.data(), payload_.size()};
   }
@@ -103,6 +210,9 @@ private:
   /// allows us to skip over entries for filter_at() calls. The jump table has
   /// `size_` entries, with each entry having four bytes (uint32_t).
   std::vector<std::byte> payload_;
+
+  /// Stores whether `payload_` contains a delta.
+  bool is_delta_;
 };
 
 using default_routing_update_envelope_ptr =
@@ -112,17 +222,24 @@ using default_routing_update_envelope_ptr =
 
 routing_update_envelope_ptr
 routing_update_envelope::make(const std::vector<broker::topic>& entries) {
+  std::vector<std::byte> bytes;
+  bytes.reserve(64);
+  write_topics(entries, std::back_inserter(bytes));
+  return default_routing_update_envelope_ptr::make(std::move(bytes), false);
+}
+
+routing_update_envelope_ptr
+routing_update_envelope::make(const filter_delta& delta) {
   std::vector<std::byte> bytes;
   bytes.reserve(64);
   auto iter = std::back_inserter(bytes);
-  binfmt::write_varbyte(entries.size(), iter);
-  for (auto& entry : entries) {
-    const auto& str = entry.string();
-    binfmt::write_varbyte(str.size(), iter);
-    for (auto c : str)
-      *iter++ = static_cast<std::byte>(c);
-  }
-  return default_routing_update_envelope_ptr::make(std::move(bytes));
+  auto flags = delta.snapshot_request ? snapshot_request_flag : uint8_t{0};
+  *iter++ = static_cast<std::byte>(flags);
+  iter = binfmt::write_unsigned(delta.base.value, iter);
+  iter = binfmt::write_unsigned(delta.version.value, iter);
+  iter = write_topics(delta.added, iter);
+  write_topics(delta.removed, iter);
+  return default_routing_update_envelope_ptr::make(std::move(bytes), true);
 }
 
 namespace {
@@ -137,6 +254,8 @@ public:
 
   error parse() {
     // TODO: sanity check the filter data.
+    if (is_delta() && !delta())
+      return make_error(ec::invalid_data, "invalid routing update delta");
     return error{};
   }
 };
@@ -146,9 +265,9 @@ public:
 expected<envelope_ptr> routing_update_envelope::deserialize(
   const endpoint_id& sender, const endpoint_id& receiver, uint16_t ttl,
   std::string_view topic_str, const std::byte* payload, size_t payload_size) {
-  using impl_ptr = intrusive_ptr<deserialized_routing_update_envelope>;
-  auto result = impl_ptr::make(sender, receiver, ttl, topic_str, payload,
-                               payload_size);
+  using impl = deserialized_routing_update_envelope;
+  auto result = impl::make<impl>(sender, receiver, ttl, topic_str, payload,
+                                 payload_size, 0);
   if (auto err = result->parse())
     return err;
   return {std::move(result)};
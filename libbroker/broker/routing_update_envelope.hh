@@ -2,10 +2,12 @@
 
 #include "broker/endpoint_id.hh"
 #include "broker/envelope.hh"
+#include "broker/filter_type.hh"
 
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <optional>
 #include <string_view>
 
 namespace broker {
@@ -78,33 +80,56 @@ inline bool operator!=(const routing_update_iterator& iter,
   return !iter.at_end();
 }
 
-/// Wraps a filter update. The associated topic is always `topic::reserved`.
+/// Wraps a filter update. The associated topic is `topic::reserved` for full
+/// filters and `delta_topic` for incremental updates.
 class routing_update_envelope : public envelope {
 public:
+  /// The topic for routing updates that carry a @ref filter_delta.
+  static constexpr std::string_view delta_topic = "<$>/delta";
+
   envelope_type type() const noexcept final;
 
   std::string_view topic() const noexcept override;
 
-  envelope_ptr with(endpoint_id new_sender,
-                    endpoint_id new_receiver) const override;
+  using envelope::with;
+
+  envelope_ptr with(endpoint_id new_sender, endpoint_id new_receiver,
+                    uint16_t new_ttl) const override;
 
   std::string stringify() const override;
 
+  /// Returns whether this envelope carries a @ref filter_delta instead of a
+  /// full filter.
+  bool is_delta() const noexcept {
+    return topic() == delta_topic;
+  }
+
   /// Returns the number of entries in the filter.
+  /// @pre `!is_delta()`
   size_t filter_size() const noexcept;
 
   /// Returns an iterator to the first entry in the filter.
+  /// @pre `!is_delta()`
   routing_update_iterator begin() const noexcept;
 
   /// Returns the past-the-end iterator for the filter.
+  /// @pre `!is_delta()`
   routing_update_sentinel end() const noexcept {
     return {};
   }
 
+  /// Decodes the delta in this envelope.
+  /// @returns the decoded delta or `std::nullopt` if this envelope carries a
+  ///          full filter or if the payload is malformed.
+  std::optional<filter_delta> delta() const;
+
   /// Creates a new routing_update envelope from the arguments.
   static routing_update_envelope_ptr
   make(const std::vector<broker::topic>& entries);
 
+  /// Creates a new routing_update envelope for an incremental update.
+  static routing_update_envelope_ptr make(const filter_delta& delta);
+
   /// Attempts to deserialize an envelope from the given message in Broker's
   /// write format.
   static expected<envelope_ptr>
@@ -0,0 +1,184 @@
+#include "broker/sharded_store.hh"
+
+#include "broker/detail/key_collector.hh"
+#include "broker/error.hh"
+
+#include <functional>
+#include <utility>
+
+namespace broker {
+
+namespace {
+
+// Merges the key vectors returned by `fn` for each shard.
+template <class F>
+expected<data> merge_keys(const std::vector<store>& shards, size_t limit,
+                          F fn) {
+  auto collector = detail::make_key_collector([](const data&) { return true; },
+                                              limit);
+  for (const auto& shard : shards) {
+    auto xs = fn(shard);
+    if (!xs)
+      return xs;
+    if (auto* keys = get_if<vector>(*xs))
+      for (const auto& key : *keys)
+        collector.add(key);
+  }
+  return std::move(collector).result();
+}
+
+} // namespace
+
+// -- constructors, destructors, and assignment operators ----------------------
+
+sharded_store::sharded_store(std::vector<store> shards)
+  : shards_(std::move(shards)) {
+  // nop
+}
+
+// -- static utility functions -------------------------------------------------
+
+std::string sharded_store::shard_name(const std::string& name, size_t index) {
+  auto result = name;
+  result += '/';
+  result += std::to_string(index);
+  return result;
+}
+
+// -- properties ---------------------------------------------------------------
+
+bool sharded_store::initialized() const noexcept {
+  if (shards_.empty())
+    return false;
+  for (const auto& shard : shards_)
+    if (!shard.initialized())
+      return false;
+  return true;
+}
+
+size_t sharded_store::shard_index(const data& key) const noexcept {
+  // Note: all parties must map keys to the same shards. Hence, we stick to
+  //       the FNV hash instead of std::hash, which may change between
+  //       releases.
+  return detail::fnv_hash(key) % shards_.size();
+}
+
+// -- lookups ------------------------------------------------------------------
+
+#define CHECK_SHARDS()                                                         \
+  do {                                                                         \
+    if (shards_.empty())                                                       \
+      return make_error(ec::bad_member_function_call,                          \
+                        "sharded store has no shards");                        \
+  } while (false)
+
+expected<data> sharded_store::exists(data key) const {
+  CHECK_SHARDS();
+  const auto& shard = shard_for(key);
+  return shard.exists(std::move(key));
+}
+
+expected<data> sharded_store::get(data key) const {
+  CHECK_SHARDS();
+  const auto& shard = shard_for(key);
+  return shard.get(std::move(key));
+}
+
+expected<data> sharded_store::put_unique(data key, data value,
+                                         std::optional<timespan> expiry) {
+  CHECK_SHARDS();
+  auto& shard = shard_for(key);
+  return shard.put_unique(std::move(key), std::move(value), expiry);
+}
+
+expected<data> sharded_store::get_index_from_value(data key,
+                                                   data index) const {
+  CHECK_SHARDS();
+  const auto& shard = shard_for(key);
+  return shard.get_index_from_value(std::move(key), std::move(index));
+}
+
+expected<data> sharded_store::query_value(data key, value_query op,
+                                          data arg) const {
+  CHECK_SHARDS();
+  const auto& shard = shard_for(key);
+  return shard.query_value(std::move(key), op, std::move(arg));
+}
+
+expected<data> sharded_store::keys() const {
+  CHECK_SHARDS();
+  set result;
+  for (const auto& shard : shards_) {
+    auto xs = shard.keys();
+    if (!xs)
+      return xs;
+    if (auto* keys = get_if<set>(*xs))
+      result.merge(*keys);
+  }
+  return data{std::move(result)};
+}
+
+expected<data> sharded_store::range(data first, data last,
+                                    size_t limit) const {
+  CHECK_SHARDS();
+  return merge_keys(shards_, limit, [&](const store& shard) {
+    return shard.range(first, last, limit);
+  });
+}
+
+expected<data> sharded_store::keys_with_prefix(std::string prefix,
+                                               size_t limit) const {
+  CHECK_SHARDS();
+  return merge_keys(shards_, limit, [&](const store& shard) {
+    return shard.keys_with_prefix(prefix, limit);
+  });
+}
+
+#undef CHECK_SHARDS
+
+// -- modifiers ----------------------------------------------------------------
+
+void sharded_store::put(data key, data value, std::optional<timespan> expiry) {
+  if (!shards_.empty()) {
+    auto& shard = shard_for(key);
+    shard.put(std::move(key), std::move(value), expiry);
+  }
+}
+
+void sharded_store::erase(data key) {
+  if (!shards_.empty()) {
+    auto& shard = shard_for(key);
+    shard.erase(std::move(key));
+  }
+}
+
+void sharded_store::clear() {
+  for (auto& shard : shards_)
+    shard.clear();
+}
+
+void sharded_store::increment(data key, data amount,
+                              std::optional<timespan> expiry) {
+  if (!shards_.empty()) {
+    auto& shard = shard_for(key);
+    shard.increment(std::move(key), std::move(amount), expiry);
+  }
+}
+
+void sharded_store::decrement(data key, data amount,
+                              std::optional<timespan> expiry) {
+  if (!shards_.empty()) {
+    auto& shard = shard_for(key);
+    shard.decrement(std::move(key), std::move(amount), expiry);
+  }
+}
+
+void sharded_store::append(data key, data str,
+                           std::optional<timespan> expiry) {
+  if (!shards_.empty()) {
+    auto& shard = shard_for(key);
+    shard.append(std::move(key), std::move(str), expiry);
+  }
+}
+
+} // namespace broker
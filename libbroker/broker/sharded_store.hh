@@ -0,0 +1,134 @@
+#pragma once
+
+#include "broker/data.hh"
+#include "broker/expected.hh"
+#include "broker/fwd.hh"
+#include "broker/store.hh"
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace broker {
+
+/// A logical key-value store that partitions its keys across several regular
+/// stores (shards). Each shard has its own master actor, which allows the
+/// shards to process operations in parallel. Masters for the shards may reside
+/// on different endpoints. A `sharded_store` routes each operation to the
+/// shard that owns the key, i.e., the shard at index `hash(key) % N`.
+/// @note All parties must agree on the number of shards.
+class sharded_store {
+public:
+  // -- constructors, destructors, and assignment operators --------------------
+
+  sharded_store() = default;
+
+  /// Constructs a sharded store from its shards.
+  /// @param shards The stores for the individual shards, ordered by index.
+  explicit sharded_store(std::vector<store> shards);
+
+  sharded_store(const sharded_store&) = default;
+
+  sharded_store(sharded_store&&) noexcept = default;
+
+  sharded_store& operator=(const sharded_store&) = default;
+
+  sharded_store& operator=(sharded_store&&) noexcept = default;
+
+  // -- static utility functions -----------------------------------------------
+
+  /// Returns the name of the store for the shard at `index`.
+  static std::string shard_name(const std::string& name, size_t index);
+
+  // -- properties -------------------------------------------------------------
+
+  /// Returns whether all shards are fully initialized.
+  bool initialized() const noexcept;
+
+  /// Returns whether all shards are fully initialized.
+  explicit operator bool() const noexcept {
+    return initialized();
+  }
+
+  /// Returns the number of shards.
+  size_t num_shards() const noexcept {
+    return shards_.size();
+  }
+
+  /// Returns all shards, ordered by index.
+  const std::vector<store>& shards() const noexcept {
+    return shards_;
+  }
+
+  /// Returns the index of the shard that owns `key`.
+  /// @pre `num_shards() > 0`
+  size_t shard_index(const data& key) const noexcept;
+
+  /// Returns the shard that owns `key`.
+  /// @pre `num_shards() > 0`
+  store& shard_for(const data& key) {
+    return shards_[shard_index(key)];
+  }
+
+  /// @copydoc shard_for
+  const store& shard_for(const data& key) const {
+    return shards_[shard_index(key)];
+  }
+
+  // -- lookups ----------------------------------------------------------------
+
+  /// Checks whether a key exists in the store.
+  expected<data> exists(data key) const;
+
+  /// Retrieves a value.
+  expected<data> get(data key) const;
+
+  /// Inserts a value if the key does not already exist.
+  expected<data> put_unique(data key, data value,
+                            std::optional<timespan> expiry = {});
+
+  /// For container values, retrieves a specific index from the value.
+  expected<data> get_index_from_value(data key, data index) const;
+
+  /// Evaluates a query on the value for a key. Has the same semantics as
+  /// `store::query_value`.
+  expected<data> query_value(data key, value_query op,
+                             data arg = data{}) const;
+
+  /// Retrieves the keys of all shards, returned as a set.
+  expected<data> keys() const;
+
+  /// Retrieves keys of all shards in ascending order. Has the same semantics as
+  /// `store::range`.
+  expected<data> range(data first, data last, size_t limit) const;
+
+  /// Retrieves string keys of all shards that begin with `prefix` in ascending
+  /// order.
+  expected<data> keys_with_prefix(std::string prefix, size_t limit = 0) const;
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Inserts or updates a value.
+  void put(data key, data value, std::optional<timespan> expiry = {});
+
+  /// Removes the value associated with a given key.
+  void erase(data key);
+
+  /// Empties out all shards.
+  void clear();
+
+  /// Increments a value by a given amount.
+  void increment(data key, data amount, std::optional<timespan> expiry = {});
+
+  /// Decrements a value by a given amount.
+  void decrement(data key, data amount, std::optional<timespan> expiry = {});
+
+  /// Appends a string to another one.
+  void append(data key, data str, std::optional<timespan> expiry = {});
+
+private:
+  std::vector<store> shards_;
+};
+
+} // namespace broker
@@ -0,0 +1,137 @@
+#include "broker/shared_publisher.hh"
+
+#include <atomic>
+#include <thread>
+
+#include "broker/data.hh"
+#include "broker/detail/mpsc_ring.hh"
+#include "broker/endpoint.hh"
+#include "broker/internal/logger.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+namespace broker {
+
+struct shared_publisher::impl {
+  impl(publisher pub, topic t, size_t ring_size)
+    : pub(std::move(pub)), dst(std::move(t)), ring(ring_size) {
+    batch.reserve(ring.capacity());
+  }
+
+  /// Appends `msg` to the ring, draining it whenever it fills up.
+  void push(data_message msg) {
+    while (!ring.try_push(msg)) {
+      if (!drain())
+        std::this_thread::yield();
+    }
+  }
+
+  /// Forwards all messages from the ring to the publisher.
+  /// @returns `true` if this thread drained the ring, `false` if another
+  ///          thread was already draining it.
+  bool drain() {
+    // The fences pair the store to the ring with the check of the flag: either
+    // the draining thread sees our message after resetting the flag or we
+    // acquire the flag and forward the message ourselves.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool result = false;
+    while (!draining.exchange(true, std::memory_order_acquire)) {
+      result = true;
+      data_message msg;
+      while (ring.try_pop(msg))
+        batch.emplace_back(std::move(msg));
+      if (!batch.empty()) {
+        BROKER_DEBUG("forward batch of" << batch.size() << "messages");
+        pub.push(batch.data(), batch.size());
+        batch.clear();
+      }
+      draining.store(false, std::memory_order_release);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!ring.has_next())
+        break;
+    }
+    return result;
+  }
+
+  publisher pub;
+
+  /// Stores the topic for all messages.
+  topic dst;
+
+  detail::mpsc_ring<data_message> ring;
+
+  /// Stores whether a thread currently drains the ring.
+  std::atomic<bool> draining{false};
+
+  /// Holds messages while forwarding them. Only the draining thread may access
+  /// this buffer.
+  std::vector<data_message> batch;
+};
+
+// --- constructors and destructors --------------------------------------------
+
+shared_publisher::shared_publisher(std::unique_ptr<impl> ptr)
+  : impl_(std::move(ptr)) {
+  // nop
+}
+
+shared_publisher::shared_publisher(shared_publisher&&) noexcept = default;
+
+shared_publisher&
+shared_publisher::operator=(shared_publisher&&) noexcept = default;
+
+shared_publisher::~shared_publisher() {
+  reset();
+}
+
+// --- factories ---------------------------------------------------------------
+
+shared_publisher shared_publisher::make(endpoint& ep, topic t,
+                                        size_t ring_size) {
+  auto pub = publisher::make(ep, t);
+  return shared_publisher{
+    std::make_unique<impl>(std::move(pub), std::move(t), ring_size)};
+}
+
+// --- accessors ---------------------------------------------------------------
+
+size_t shared_publisher::demand() const {
+  return impl_->pub.demand();
+}
+
+size_t shared_publisher::buffered() const {
+  return impl_->pub.buffered();
+}
+
+size_t shared_publisher::capacity() const {
+  return impl_->pub.capacity();
+}
+
+// --- messaging ---------------------------------------------------------------
+
+void shared_publisher::publish(const data& x) {
+  impl_->push(make_data_message(impl_->dst, x));
+  impl_->drain();
+}
+
+void shared_publisher::publish(const std::vector<data>& xs) {
+  for (auto& x : xs)
+    impl_->push(make_data_message(impl_->dst, x));
+  impl_->drain();
+}
+
+void shared_publisher::flush() {
+  impl_->drain();
+}
+
+// --- miscellaneous -----------------------------------------------------------
+
+void shared_publisher::reset() {
+  if (impl_) {
+    impl_->drain();
+    impl_->pub.reset();
+    impl_.reset();
+  }
+}
+
+} // namespace broker
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "broker/defaults.hh"
+#include "broker/fwd.hh"
+#include "broker/publisher.hh"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace broker {
+
+/// A publisher that multiple threads may use concurrently. Producers build
+/// their messages in parallel and append them to a lock-free ring. Whichever
+/// producer finds the ring unattended drains it and forwards all pending
+/// messages as a single batch. All threads share a single flow into the core.
+class shared_publisher {
+public:
+  // --- friend declarations ---------------------------------------------------
+
+  friend class endpoint;
+
+  // --- constructors and destructors ------------------------------------------
+
+  shared_publisher(shared_publisher&&) noexcept;
+
+  shared_publisher& operator=(shared_publisher&&) noexcept;
+
+  ~shared_publisher();
+
+  // --- factories -------------------------------------------------------------
+
+  static shared_publisher make(endpoint& ep, topic t, size_t ring_size);
+
+  // --- accessors -------------------------------------------------------------
+
+  /// @copydoc publisher::demand
+  size_t demand() const;
+
+  /// @copydoc publisher::buffered
+  size_t buffered() const;
+
+  /// @copydoc publisher::capacity
+  size_t capacity() const;
+
+  // --- messaging -------------------------------------------------------------
+
+  /// Sends `x` to all subscribers. Safe to call from multiple threads.
+  void publish(const data& x);
+
+  /// Sends `xs` to all subscribers. Safe to call from multiple threads.
+  void publish(const std::vector<data>& xs);
+
+  /// Forwards all messages in the ring to the core unless another thread is
+  /// already doing so.
+  void flush();
+
+  // --- miscellaneous ---------------------------------------------------------
+
+  /// @copydoc publisher::reset
+  /// @pre No other thread uses this object.
+  void reset();
+
+private:
+  struct impl;
+
+  explicit shared_publisher(std::unique_ptr<impl> ptr);
+
+  std::unique_ptr<impl> impl_;
+};
+
+} // namespace broker
@@ -0,0 +1,56 @@
+#include "broker/shared_publisher.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include "broker/endpoint.hh"
+
+#include <thread>
+
+using namespace broker;
+
+FIXTURE_SCOPE(shared_publisher_tests, net_fixture<base_fixture>)
+
+TEST(shared publishers make data available to remote subscribers) {
+  auto sub = earth.ep.make_subscriber({"foo"});
+  run();
+  bridge(earth, mars);
+  auto pub = mars.ep.make_shared_publisher("foo", 16);
+  run();
+  for (count i = 0; i < 10; ++i)
+    pub.publish(data{i});
+  pub.publish(std::vector<data>{data{count{10}}, data{count{11}}});
+  run();
+  auto msgs = sub.poll();
+  REQUIRE_EQUAL(msgs.size(), 12u);
+  for (count i = 0; i < 12; ++i)
+    CHECK_EQUAL(get_data(msgs[i]).to_data(), data{i});
+}
+
+FIXTURE_SCOPE_END()
+
+// Uses real threads and endpoints, since the deterministic fixture runs all
+// actors on the test thread.
+TEST(multiple threads may publish concurrently) {
+  constexpr size_t num_threads = 4;
+  constexpr size_t values_per_thread = 500;
+  endpoint ep1;
+  endpoint ep2;
+  auto sub = ep1.make_subscriber({topic{"/test"}});
+  REQUIRE(ep1.await_filter_entry(topic{"/test"}));
+  auto port = ep1.listen("127.0.0.1", 0);
+  ep2.peer("127.0.0.1", port);
+  REQUIRE(ep1.await_peer(ep2.node_id()));
+  REQUIRE(ep2.await_peer(ep1.node_id()));
+  auto pub = ep2.make_shared_publisher(topic{"/test"}, 32);
+  std::vector<std::thread> threads;
+  for (size_t id = 0; id < num_threads; ++id)
+    threads.emplace_back([&pub] {
+      for (size_t i = 0; i < values_per_thread; ++i)
+        pub.publish(data{count{i}});
+    });
+  for (auto& hdl : threads)
+    hdl.join();
+  auto msgs = sub.get(num_threads * values_per_thread);
+  CHECK_EQUAL(msgs.size(), num_threads * values_per_thread);
+  CHECK(sub.poll().empty());
+}
@@ -5,6 +5,7 @@ namespace {
 static constexpr const char* shutdown_options_strings[] = {
   "nullopt",
   "await_stores_on_shutdown",
+  "drain_peers_on_shutdown",
 };
 
 void append(std::string& result, broker::shutdown_options::flag flag) {
@@ -19,7 +20,8 @@ namespace broker {
 
 std::string to_string(shutdown_options options) {
   std::string result = "shutdown_options(";
-  for (auto flag : {shutdown_options::await_stores_on_shutdown})
+  for (auto flag : {shutdown_options::await_stores_on_shutdown,
+                    shutdown_options::drain_peers_on_shutdown})
     if (options.contains(flag))
       append(result, flag);
   result += ')';
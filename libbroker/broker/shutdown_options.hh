@@ -1,5 +1,8 @@
 #pragma once
 
+#include "broker/defaults.hh"
+#include "broker/time.hh"
+
 #include <cstdint>
 #include <string>
 
@@ -9,6 +12,7 @@ class shutdown_options {
 public:
   enum flag {
     await_stores_on_shutdown = 0x01,
+    drain_peers_on_shutdown = 0x02,
   };
 
   constexpr bool contains(flag f) const noexcept {
@@ -23,13 +27,26 @@ public:
     flags_ &= ~static_cast<uint8_t>(f);
   }
 
+  /// Returns how long the core waits for buffered messages to reach its peers
+  /// before sending the BYE message when `drain_peers_on_shutdown` is set.
+  constexpr timespan drain_timeout() const noexcept {
+    return drain_timeout_;
+  }
+
+  /// Sets the maximum time for draining buffered messages on shutdown.
+  constexpr void drain_timeout(timespan value) noexcept {
+    drain_timeout_ = value;
+  }
+
   template <class Inspector>
   friend auto inspect(Inspector& f, shutdown_options& x) {
-    return f.object(x).fields(f.field("flags", x.flags_));
+    return f.object(x).fields(f.field("flags", x.flags_),
+                              f.field("drain-timeout", x.drain_timeout_));
   }
 
 private:
   uint8_t flags_ = 0;
+  timespan drain_timeout_ = defaults::drain_timeout;
 };
 
 std::string to_string(shutdown_options options);
@@ -1,5 +1,7 @@
 #include "broker/store.hh"
 
+#include <algorithm>
+#include <memory>
 #include <optional>
 #include <string>
 #include <utility>
@@ -17,6 +19,7 @@
 #include "broker/internal/flare_actor.hh"
 #include "broker/internal/logger.hh"
 #include "broker/internal/native.hh"
+#include "broker/internal/store_batch.hh"
 #include "broker/internal/type_id.hh"
 #include "broker/internal_command.hh"
 
@@ -108,6 +111,27 @@ auto& dref(detail::shared_store_state_ptr& state) {
   return dref(*state);
 }
 
+/// Returns the content that a clone published for local reads, if any.
+std::shared_ptr<const snapshot>
+local_view(const detail::weak_store_state_ptr& state) {
+  if (auto ptr = state.lock())
+    return ptr->local_view();
+  return nullptr;
+}
+
+/// Adds a request to the pending batch of a pipelined proxy.
+/// @returns `true` if the batch reached `max_size`, `false` otherwise.
+bool enqueue(internal::store_request_batch_ptr& batch, size_t max_size,
+             internal::store_request_batch::kind op, data key,
+             request_id id) {
+  if (!batch) {
+    batch = std::make_shared<internal::store_request_batch>();
+    batch->requests.reserve(max_size);
+  }
+  batch->requests.push_back({op, std::move(key), id});
+  return batch->size() >= max_size;
+}
+
 } // namespace
 
 } // namespace broker
@@ -235,6 +259,13 @@ store::proxy::proxy(store& s) {
 
 request_id store::proxy::exists(data key) {
   if (frontend_) {
+    if (max_batch_size_ > 0) {
+      using kind = internal::store_request_batch::kind;
+      auto id = ++id_;
+      if (enqueue(pending_, max_batch_size_, kind::exists, std::move(key), id))
+        flush();
+      return id;
+    }
     send_as(native(proxy_), native(frontend_), atom::exists_v, std::move(key),
             ++id_);
     return id_;
@@ -245,6 +276,13 @@ request_id store::proxy::exists(data key) {
 
 request_id store::proxy::get(data key) {
   if (frontend_) {
+    if (max_batch_size_ > 0) {
+      using kind = internal::store_request_batch::kind;
+      auto id = ++id_;
+      if (enqueue(pending_, max_batch_size_, kind::get, std::move(key), id))
+        flush();
+      return id;
+    }
     send_as(native(proxy_), native(frontend_), atom::get_v, std::move(key),
             ++id_);
     return id_;
@@ -253,6 +291,16 @@ request_id store::proxy::get(data key) {
   }
 }
 
+request_id store::proxy::get_many(std::vector<data> keys) {
+  if (frontend_) {
+    send_as(native(proxy_), native(frontend_), atom::get_v, std::move(keys),
+            ++id_);
+    return id_;
+  } else {
+    return 0;
+  }
+}
+
 request_id store::proxy::put_unique(data key, data val,
                                     std::optional<timespan> expiry) {
   BROKER_TRACE(BROKER_ARG(key) << BROKER_ARG(val) << BROKER_ARG(expiry)
@@ -281,6 +329,14 @@ request_id store::proxy::get_index_from_value(data key, data index) {
   return id_;
 }
 
+request_id store::proxy::query_value(data key, value_query op, data arg) {
+  if (!frontend_)
+    return 0;
+  send_as(native(proxy_), native(frontend_), atom::get_v, std::move(key), op,
+          std::move(arg), ++id_);
+  return id_;
+}
+
 request_id store::proxy::keys() {
   if (!frontend_)
     return 0;
@@ -302,17 +358,48 @@ mailbox store::proxy::mailbox() {
   return make_mailbox(caf::actor_cast<internal::flare_actor*>(native(proxy_)));
 }
 
+void store::proxy::pipeline(size_t max_batch_size) {
+  max_batch_size_ = max_batch_size;
+  if (max_batch_size == 0)
+    flush();
+}
+
+void store::proxy::flush() {
+  if (!frontend_ || !pending_)
+    return;
+  auto batch = std::move(pending_);
+  BROKER_DEBUG("proxy" << native(proxy_).id() << "sends a batch of"
+                       << batch->size() << "requests to" << frontend_id());
+  send_as(native(proxy_), native(frontend_), atom::get_v, std::move(batch));
+}
+
 store::response store::proxy::receive() {
   BROKER_TRACE("");
-  auto resp = response{error{}, 0};
+  flush();
+  while (buffered_.empty())
+    receive_batch();
+  auto resp = std::move(buffered_.front());
+  buffered_.pop_front();
+  BROKER_DEBUG("proxy" << native(proxy_).id() << "received a response for ID"
+                       << resp.id << "from" << frontend_id() << "->"
+                       << resp.answer);
+  return resp;
+}
+
+void store::proxy::receive_batch() {
   auto fa = caf::actor_cast<internal::flare_actor*>(native(proxy_));
   fa->receive(
-    [&resp, fa](data& x, request_id id) {
-      resp = {std::move(x), id};
+    [this, fa](data& x, request_id id) {
+      buffered_.push_back(response{std::move(x), id});
       fa->extinguish_one();
     },
-    [&resp, fa](caf::error& err, request_id id) {
-      resp = {facade(err), id};
+    [this, fa](caf::error& err, request_id id) {
+      buffered_.push_back(response{facade(err), id});
+      fa->extinguish_one();
+    },
+    [this, fa](internal::store_response_batch_ptr& batch) {
+      for (auto& resp : batch->responses)
+        buffered_.push_back(std::move(resp));
       fa->extinguish_one();
     },
     caf::others >> [&](caf::message& x) -> caf::skippable_result {
@@ -329,13 +416,9 @@ store::response store::proxy::receive() {
       // would always return `true`.
       fa->extinguish_one();
       auto err = caf::make_error(caf::sec::unexpected_message);
-      resp.answer = facade(err);
+      buffered_.push_back(response{facade(err), 0});
       return err;
     });
-  BROKER_DEBUG("proxy" << native(proxy_).id() << "received a response for ID"
-                       << resp.id << "from" << frontend_id() << "->"
-                       << resp.answer);
-  return resp;
 }
 
 entity_id store::proxy::frontend_id() const noexcept {
@@ -352,6 +435,23 @@ std::vector<store::response> store::proxy::receive(size_t n) {
   return rval;
 }
 
+std::vector<store::response> store::proxy::receive_many(size_t max) {
+  BROKER_TRACE(BROKER_ARG(max));
+  flush();
+  while (buffered_.empty())
+    receive_batch();
+  while ((max == 0 || buffered_.size() < max) && mailbox().size() > 0)
+    receive_batch();
+  auto n = max == 0 ? buffered_.size() : std::min(max, buffered_.size());
+  std::vector<store::response> rval;
+  rval.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    rval.emplace_back(std::move(buffered_.front()));
+    buffered_.pop_front();
+  }
+  return rval;
+}
+
 std::string store::name() const {
   if (auto ptr = state_.lock())
     return dref(ptr).name;
@@ -361,14 +461,33 @@ std::string store::name() const {
 
 expected<data> store::exists(data key) const {
   BROKER_TRACE(BROKER_ARG(key));
+  if (auto view = local_view(state_))
+    return data{view->count(key) != 0};
   return fetch(atom::exists_v, std::move(key));
 }
 
 expected<data> store::get(data key) const {
   BROKER_TRACE(BROKER_ARG(key));
+  if (auto view = local_view(state_)) {
+    if (auto i = view->find(key); i != view->end())
+      return i->second;
+    return make_error(ec::no_such_key);
+  }
   return fetch(atom::get_v, std::move(key));
 }
 
+expected<data> store::get_many(std::vector<data> keys) const {
+  BROKER_TRACE(BROKER_ARG(keys));
+  if (auto view = local_view(state_)) {
+    table result;
+    for (auto& key : keys)
+      if (auto i = view->find(key); i != view->end())
+        result.insert_or_assign(std::move(key), i->second);
+    return data{std::move(result)};
+  }
+  return fetch(atom::get_v, std::move(keys));
+}
+
 expected<data> store::put_unique(data key, data val,
                                  std::optional<timespan> expiry) {
   BROKER_TRACE(BROKER_ARG(key) << BROKER_ARG(val) << BROKER_ARG(expiry));
@@ -391,10 +510,27 @@ expected<data> store::get_index_from_value(data key, data index) const {
   return fetch(atom::get_v, std::move(key), std::move(index));
 }
 
+expected<data> store::query_value(data key, value_query op,
+                                  data arg) const {
+  return fetch(atom::get_v, std::move(key), op, std::move(arg));
+}
+
 expected<data> store::keys() const {
   return fetch(atom::get_v, atom::keys_v);
 }
 
+expected<data> store::range(data first, data last, size_t limit) const {
+  BROKER_TRACE(BROKER_ARG(first) << BROKER_ARG(last) << BROKER_ARG(limit));
+  return fetch(atom::get_v, atom::keys_v, std::move(first), std::move(last),
+               static_cast<count>(limit));
+}
+
+expected<data> store::keys_with_prefix(std::string prefix, size_t limit) const {
+  BROKER_TRACE(BROKER_ARG(prefix) << BROKER_ARG(limit));
+  return fetch(atom::get_v, atom::keys_v, std::move(prefix),
+               static_cast<count>(limit));
+}
+
 bool store::initialized() const noexcept {
   return !state_.expired();
 }
@@ -434,6 +570,36 @@ void store::subtract(data key, data value, std::optional<timespan> expiry) {
   });
 }
 
+data::type store::increment_init_type(const data& amount) noexcept {
+  switch (amount.get_type()) {
+    case data::type::count:
+      return data::type::count;
+    case data::type::integer:
+      return data::type::integer;
+    case data::type::real:
+      return data::type::real;
+    case data::type::timespan:
+      return data::type::timestamp;
+    default:
+      return data::type::none;
+  }
+}
+
+void store::apply(batch xs) {
+  if (xs.empty())
+    return;
+  with_state([&](state_impl& st) {
+    auto publisher = st.frontend_id();
+    auto& entries = xs.entries().entries;
+    for (auto& entry : entries)
+      std::visit([&publisher](auto& cmd) { cmd.publisher = publisher; },
+                 entry);
+    st.anon_send(atom::local_v,
+                 internal_command_variant{
+                   batch_command{std::move(entries), publisher}});
+  });
+}
+
 void store::clear() {
   with_state([&](state_impl& st) {
     st.anon_send(atom::local_v,
@@ -441,6 +607,18 @@ void store::clear() {
   });
 }
 
+void store::filter_events(std::vector<std::string> key_prefixes) {
+  with_state_ptr([&](detail::shared_store_state_ptr& st) {
+    vector xs;
+    xs.reserve(key_prefixes.size());
+    for (auto& prefix : key_prefixes)
+      xs.emplace_back(std::move(prefix));
+    auto frontend = dref(st).frontend;
+    caf::anon_send(frontend, atom::subscribe_v, atom::keys_v, std::move(st),
+                   std::move(xs));
+  });
+}
+
 bool store::await_idle(timespan timeout) {
   BROKER_TRACE(BROKER_ARG(timeout));
   bool result = false;
@@ -482,4 +660,65 @@ std::string to_string(const store::response& x) {
   return caf::deep_to_string(std::tie(x.answer, x.id));
 }
 
+// -- store::batch -------------------------------------------------------------
+
+store::batch::batch() = default;
+
+store::batch::batch(batch&&) noexcept = default;
+
+store::batch::batch(const batch& other) {
+  if (other.entries_)
+    entries_ = std::make_unique<internal::store_batch_entries>(*other.entries_);
+}
+
+store::batch& store::batch::operator=(batch&&) noexcept = default;
+
+store::batch& store::batch::operator=(const batch& other) {
+  if (this != &other) {
+    if (other.entries_)
+      entries_ =
+        std::make_unique<internal::store_batch_entries>(*other.entries_);
+    else
+      entries_.reset();
+  }
+  return *this;
+}
+
+store::batch::~batch() = default;
+
+size_t store::batch::size() const noexcept {
+  return entries_ ? entries_->entries.size() : 0;
+}
+
+internal::store_batch_entries& store::batch::entries() {
+  if (!entries_)
+    entries_ = std::make_unique<internal::store_batch_entries>();
+  return *entries_;
+}
+
+void store::batch::put(data key, data value, std::optional<timespan> expiry) {
+  entries().entries.emplace_back(
+    put_command{std::move(key), std::move(value), expiry, entity_id{}});
+}
+
+void store::batch::erase(data key) {
+  entries().entries.emplace_back(erase_command{std::move(key), entity_id{}});
+}
+
+void store::batch::clear() {
+  entries().entries.emplace_back(clear_command{entity_id{}});
+}
+
+void store::batch::add(data key, data value, data::type init_type,
+                       std::optional<timespan> expiry) {
+  entries().entries.emplace_back(add_command{std::move(key), std::move(value),
+                                             init_type, expiry, entity_id{}});
+}
+
+void store::batch::subtract(data key, data value,
+                            std::optional<timespan> expiry) {
+  entries().entries.emplace_back(
+    subtract_command{std::move(key), std::move(value), expiry, entity_id{}});
+}
+
 } // namespace broker
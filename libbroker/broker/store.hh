@@ -10,13 +10,22 @@
 #include "broker/message.hh"
 #include "broker/status.hh"
 #include "broker/timeout.hh"
+#include "broker/value_query.hh"
 #include "broker/worker.hh"
 
+#include <deque>
 #include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
+namespace broker::internal {
+
+struct store_batch_entries;
+struct store_request_batch;
+
+} // namespace broker::internal
+
 namespace broker {
 
 /// A key-value store (either a *master* or *clone*) that supports modifying
@@ -31,6 +40,100 @@ public:
     request_id id;
   };
 
+  /// Collects modifications for applying them to a store as a single unit.
+  /// The master applies all modifications of a batch in order within a single
+  /// backend transaction and forwards the results to its clones in a single
+  /// command.
+  class batch {
+  public:
+    batch();
+
+    batch(batch&&) noexcept;
+
+    batch(const batch&);
+
+    batch& operator=(batch&&) noexcept;
+
+    batch& operator=(const batch&);
+
+    ~batch();
+
+    /// Inserts or updates a value.
+    void put(data key, data value, std::optional<timespan> expiry = {});
+
+    /// Removes the value associated with a given key.
+    void erase(data key);
+
+    /// Empties out the store.
+    void clear();
+
+    /// Increments a value by a given amount.
+    void increment(data key, data amount, std::optional<timespan> expiry = {}) {
+      auto init_type = increment_init_type(amount);
+      add(std::move(key), std::move(amount), init_type, expiry);
+    }
+
+    /// Decrements a value by a given amount.
+    void decrement(data key, data amount, std::optional<timespan> expiry = {}) {
+      subtract(std::move(key), std::move(amount), expiry);
+    }
+
+    /// Appends a string to another one.
+    void append(data key, data str, std::optional<timespan> expiry = {}) {
+      add(std::move(key), std::move(str), data::type::string, expiry);
+    }
+
+    /// Inserts an index into a set.
+    void insert_into(data key, data index,
+                     std::optional<timespan> expiry = {}) {
+      add(std::move(key), std::move(index), data::type::set, expiry);
+    }
+
+    /// Inserts an index into a table.
+    void insert_into(data key, data index, data value,
+                     std::optional<timespan> expiry = {}) {
+      add(std::move(key), vector({std::move(index), std::move(value)}),
+          data::type::table, expiry);
+    }
+
+    /// Removes am index from a set or table.
+    void remove_from(data key, data index,
+                     std::optional<timespan> expiry = {}) {
+      subtract(std::move(key), std::move(index), expiry);
+    }
+
+    /// Appends a value to a vector.
+    void push(data key, data value, std::optional<timespan> expiry = {}) {
+      add(std::move(key), std::move(value), data::type::vector, expiry);
+    }
+
+    /// Removes the last value of a vector.
+    void pop(const data& key, std::optional<timespan> expiry = {}) {
+      subtract(key, key, expiry);
+    }
+
+    /// Returns the number of modifications in this batch.
+    size_t size() const noexcept;
+
+    /// Returns whether this batch contains no modifications.
+    bool empty() const noexcept {
+      return size() == 0;
+    }
+
+  private:
+    friend class store;
+
+    void add(data key, data value, data::type init_type,
+             std::optional<timespan> expiry);
+
+    void subtract(data key, data value, std::optional<timespan> expiry);
+
+    /// Returns the modifications, allocating the container if necessary.
+    internal::store_batch_entries& entries();
+
+    std::unique_ptr<internal::store_batch_entries> entries_;
+  };
+
   /// A utility to decouple store request from response processing.
   class proxy {
   public:
@@ -51,6 +154,12 @@ public:
     /// response.
     request_id get(data key);
 
+    /// Performs a request to retrieve multiple values at once.
+    /// @param keys The keys of the values to retrieve.
+    /// @returns A unique identifier for this request to correlate it with a
+    /// response.
+    request_id get_many(std::vector<data> keys);
+
     /// Inserts a value if the key does not already exist.
     /// @param key The key of the key-value pair.
     /// @param value The value of the key-value pair.
@@ -68,6 +177,14 @@ public:
     /// response.
     request_id get_index_from_value(data key, data index);
 
+    /// Evaluates a query on the value for a key at the store.
+    /// @param key The key of the value to query.
+    /// @param op The operation to evaluate.
+    /// @param arg The argument of the operation.
+    /// @returns A unique identifier for this request to correlate it with a
+    /// response.
+    request_id query_value(data key, value_query op, data arg = data{});
+
     /// Performs a request to retrieve a store's keys.
     /// @returns A unique identifier for this request to correlate it with a
     /// response.
@@ -84,14 +201,45 @@ public:
     /// @returns The next N responses in the proxy's mailbox.
     std::vector<response> receive(size_t n);
 
+    /// Consumes up to `max` responses, blocking until at least one response
+    /// arrives. Consumes all available responses if `max` is 0.
+    /// @note Flushes pending requests (see `pipeline`) before blocking.
+    std::vector<response> receive_many(size_t max = 0);
+
+    /// Enables pipelining: `exists` and `get` requests for a single key queue
+    /// up in the proxy until reaching `max_batch_size` pending requests or
+    /// until calling `flush` or `receive`. The store actor then processes all
+    /// pending requests at once and responds with a single batch. A batch
+    /// size of 0 disables pipelining (default).
+    /// @note The mailbox only signals the arrival of a batch. Hence, users
+    ///       should prefer `receive_many` over calling `receive` once per
+    ///       mailbox entry when pipelining.
+    void pipeline(size_t max_batch_size);
+
+    /// Sends all pending requests to the store.
+    void flush();
+
+    /// Returns the number of responses that arrived as part of a batch but
+    /// were not consumed yet.
+    size_t buffered() const noexcept {
+      return buffered_.size();
+    }
+
     /// Returns a globally unique identifier for the frontend actor.
     entity_id frontend_id() const noexcept;
 
   private:
+    /// Moves the responses from the next message in the mailbox to
+    /// `buffered_`, blocking until a message arrives.
+    void receive_batch();
+
     request_id id_ = 0;
     worker frontend_;
     worker proxy_;
     endpoint_id this_peer_;
+    size_t max_batch_size_ = 0;
+    std::shared_ptr<internal::store_request_batch> pending_;
+    std::deque<response> buffered_;
   };
 
   // -- friends ----------------------------------------------------------------
@@ -129,6 +277,12 @@ public:
   /// @returns The value under *key* or an error.
   expected<data> get(data key) const;
 
+  /// Retrieves multiple values with a single request.
+  /// @param keys The keys of the values to retrieve.
+  /// @returns A table that maps each key in *keys* that exists in the store to
+  ///          its value or an error.
+  expected<data> get_many(std::vector<data> keys) const;
+
   /// Inserts a value if the key does not already exist.
   /// @param key The key of the key-value pair.
   /// @param value The value of the key-value pair.
@@ -146,9 +300,37 @@ public:
   /// Always returns an error if the store does not have the key.
   expected<data> get_index_from_value(data key, data index) const;
 
+  /// Evaluates a query on the value for a key at the master or clone and
+  /// returns only the result, e.g., the size of a set or whether it contains
+  /// several elements. See @ref value_query for the supported operations.
+  /// @param key The key of the value to query.
+  /// @param op The operation to evaluate.
+  /// @param arg The argument of the operation.
+  /// @returns The result of the query, `no_such_key` if the store does not
+  ///          have the key, or `type_clash` if the operation does not apply to
+  ///          the value or the argument.
+  expected<data> query_value(data key, value_query op,
+                             data arg = data{}) const;
+
   /// Retrieves a copy of the store's current keys, returned as a set.
   expected<data> keys() const;
 
+  /// Retrieves keys in ascending order, starting at the first key that is not
+  /// less than `first` and stopping before `last`. To fetch large key sets in
+  /// pages, pass the last key of the previous page as `first` and skip it.
+  /// @param first The lower bound (inclusive).
+  /// @param last The upper bound (exclusive) or a default-constructed `data`
+  ///             for no upper bound.
+  /// @param limit The maximum number of keys or 0 for no limit.
+  /// @returns A vector with the selected keys.
+  expected<data> range(data first, data last, size_t limit) const;
+
+  /// Retrieves string keys that begin with `prefix` in ascending order.
+  /// @param prefix The common prefix of all selected keys.
+  /// @param limit The maximum number of keys or 0 for no limit.
+  /// @returns A vector with the selected keys.
+  expected<data> keys_with_prefix(std::string prefix, size_t limit = 0) const;
+
   /// Returns whether the store was fully initialized
   bool initialized() const noexcept;
 
@@ -185,25 +367,7 @@ public:
   /// @param value The amount to increment the value.
   /// @param expiry An optional new expiration time for *key*.
   void increment(data key, data amount, std::optional<timespan> expiry = {}) {
-    auto init_type = data::type::none;
-
-    switch (amount.get_type()) {
-      case data::type::count:
-        init_type = data::type::count;
-        break;
-      case data::type::integer:
-        init_type = data::type::integer;
-        break;
-      case data::type::real:
-        init_type = data::type::real;
-        break;
-      case data::type::timespan:
-        init_type = data::type::timestamp;
-        break;
-      default:
-        break;
-    }
-
+    auto init_type = increment_init_type(amount);
     add(std::move(key), std::move(amount), init_type, expiry);
   }
 
@@ -267,6 +431,20 @@ public:
     subtract(key, key, expiry);
   }
 
+  /// Applies all modifications of a batch as a single command.
+  /// @param xs The modifications to apply.
+  void apply(batch xs);
+
+  /// Restricts the events that the store actor behind this handle publishes on
+  /// the store events topic to string keys that begin with one of the given
+  /// prefixes. The store actor evaluates the prefixes before generating an
+  /// event. Passing an empty list publishes events for all keys again.
+  /// @note Copies of a store object share their filter. The store actor
+  ///       publishes events for the union of the filters of all store objects
+  ///       that called this function and drops the filter of a store object
+  ///       once it goes out of scope.
+  void filter_events(std::vector<std::string> key_prefixes);
+
   // --await-idle-start
   /// Blocks execution of the current thread until the frontend actor reached an
   /// IDLE state. On a master, this means that all clones have caught up with
@@ -323,6 +501,9 @@ private:
   /// @param expiry An optional new expiration time for *key*.
   void subtract(data key, data value, std::optional<timespan> expiry = {});
 
+  /// Returns the type of data to create when incrementing a non-existing key.
+  static data::type increment_init_type(const data& amount) noexcept;
+
   template <class F>
   void with_state(F f) const;
 
@@ -1,17 +1,22 @@
 #include "broker/store.hh"
 
 #include "broker/broker-test.test.hh"
+#include "broker/store_fixture.test.hh"
 
 #include <chrono>
+#include <map>
 #include <thread>
 #include <utility>
 
 #include "broker/backend.hh"
 #include "broker/backend_options.hh"
 #include "broker/data.hh"
+#include "broker/defaults.hh"
 #include "broker/endpoint.hh"
 #include "broker/error.hh"
+#include "broker/store_event.hh"
 #include "broker/internal/type_id.hh"
+#include "broker/internal_command.hh"
 
 using namespace broker;
 
@@ -79,6 +84,72 @@ TEST(master operations) {
   REQUIRE_EQUAL(value_of(ds->keys()), data(set{"foo"}));
 }
 
+TEST(value queries) {
+  endpoint ep;
+  auto ds = ep.attach_master("sinnoh", backend::memory);
+  REQUIRE(ds);
+  ds->put("xs", vector{1, 2, 3, 4});
+  ds->put("ys", set{1, 2, 3});
+  ds->put("zs", table{{"a", 3}, {"b", 1}, {"c", 2}});
+  MESSAGE("size");
+  CHECK_EQUAL(value_of(ds->query_value("xs", value_query::size)), data{4u});
+  CHECK_EQUAL(value_of(ds->query_value("ys", value_query::size)), data{3u});
+  CHECK_EQUAL(value_of(ds->query_value("zs", value_query::size)), data{3u});
+  MESSAGE("contains");
+  CHECK_EQUAL(value_of(ds->query_value("ys", value_query::contains,
+                                       vector{1, 5})),
+              data(vector{true, false}));
+  CHECK_EQUAL(value_of(ds->query_value("zs", value_query::contains,
+                                       vector{"c", "d"})),
+              data(vector{true, false}));
+  MESSAGE("slice");
+  CHECK_EQUAL(value_of(ds->query_value("xs", value_query::slice,
+                                       vector{1u, 3u})),
+              data(vector{2, 3}));
+  CHECK_EQUAL(value_of(ds->query_value("xs", value_query::slice,
+                                       vector{3u, 10u})),
+              data(vector{4}));
+  MESSAGE("top");
+  CHECK_EQUAL(value_of(ds->query_value("zs", value_query::top, 2u)),
+              data(vector{vector{"a", 3}, vector{"c", 2}}));
+  MESSAGE("errors");
+  CHECK_EQUAL(error_of(ds->query_value("ys", value_query::top, 2u)),
+              ec::type_clash);
+  CHECK_EQUAL(error_of(ds->query_value("none", value_query::size)),
+              ec::no_such_key);
+}
+
+TEST(sharded master operations) {
+  endpoint ep;
+  auto ds = ep.attach_sharded_master("kanto", backend::memory, 4);
+  REQUIRE(ds);
+  REQUIRE_EQUAL(ds->num_shards(), 4u);
+  CHECK_EQUAL(ds->shards()[2].name(), "kanto/2");
+  for (integer i = 0; i < 16; ++i)
+    ds->put(i, i * 2);
+  for (integer i = 0; i < 16; ++i)
+    CHECK_EQUAL(value_of(ds->get(i)), data{i * 2});
+  MESSAGE("each key lives on exactly one shard");
+  for (integer i = 0; i < 16; ++i) {
+    size_t hits = 0;
+    for (const auto& shard : ds->shards())
+      if (shard.exists(i) == data{true})
+        ++hits;
+    CHECK_EQUAL(hits, 1u);
+  }
+  MESSAGE("keys and ranges merge all shards");
+  auto all_keys = value_of(ds->keys());
+  REQUIRE(is<set>(all_keys));
+  CHECK_EQUAL(get<set>(all_keys).size(), 16u);
+  CHECK_EQUAL(value_of(ds->range(data{integer{3}}, data{}, 3)),
+              data(vector{integer{3}, integer{4}, integer{5}}));
+  MESSAGE("clear empties all shards");
+  ds->clear();
+  CHECK_EQUAL(value_of(ds->keys()), data(set{}));
+  MESSAGE("attaching zero shards fails");
+  CHECK(!ep.attach_sharded_master("johto", backend::memory, 0));
+}
+
 TEST(clone operations - same endpoint) {
   endpoint ep;
   auto m = ep.attach_master("vulcan", backend::memory);
@@ -129,3 +200,182 @@ TEST(proxy) {
   CAF_REQUIRE_EQUAL(key_resp.id, key_id);
   CAF_REQUIRE_EQUAL(value_of(key_resp.answer), data(set{"foo"}));
 }
+
+TEST(pipelined proxy) {
+  endpoint ep;
+  auto m = ep.attach_master("puneta", backend::memory);
+  REQUIRE(m);
+  auto proxy = store::proxy{*m};
+  proxy.pipeline(3);
+  m->put("foo", 42);
+  MESSAGE("requests queue up until reaching the batch size");
+  CHECK_EQUAL(proxy.get("foo"), 1u);
+  CHECK_EQUAL(proxy.exists("bar"), 2u);
+  CHECK_EQUAL(proxy.get("bar"), 3u);
+  MESSAGE("the store responds to all requests in one batch");
+  auto resps = proxy.receive_many();
+  REQUIRE_EQUAL(resps.size(), 3u);
+  CHECK_EQUAL(proxy.mailbox().size(), 0u);
+  CHECK_EQUAL(proxy.buffered(), 0u);
+  std::map<request_id, expected<data>> answers;
+  for (auto& resp : resps)
+    answers.emplace(resp.id, std::move(resp.answer));
+  CHECK_EQUAL(value_of(answers.at(1)), data{42});
+  CHECK_EQUAL(value_of(answers.at(2)), data{false});
+  CHECK_EQUAL(answers.at(3), error{ec::no_such_key});
+  MESSAGE("receive flushes pending requests and buffers the batch");
+  CHECK_EQUAL(proxy.exists("foo"), 4u);
+  CHECK_EQUAL(proxy.get("foo"), 5u);
+  CHECK_EQUAL(proxy.receive().id, 4u);
+  CHECK_EQUAL(proxy.buffered(), 1u);
+  CHECK_EQUAL(proxy.receive().id, 5u);
+  CHECK_EQUAL(proxy.buffered(), 0u);
+  MESSAGE("receive_many stops at the maximum");
+  for (int i = 0; i < 3; ++i)
+    proxy.get("foo");
+  CHECK_EQUAL(proxy.receive_many(2).size(), 2u);
+  CHECK_EQUAL(proxy.receive_many(2).size(), 1u);
+  MESSAGE("other requests bypass the pipeline");
+  auto key_id = proxy.keys();
+  auto key_resp = proxy.receive();
+  CHECK_EQUAL(key_resp.id, key_id);
+  CHECK_EQUAL(value_of(key_resp.answer), data(set{"foo"}));
+}
+
+FIXTURE_SCOPE(store_actor_settings, store_fixture)
+
+TEST(idle clones skip ticks until an update wakes them up) {
+  spawn_master({});
+  auto sleepy = spawn_clone('B');
+  auto eager = spawn_clone('C');
+  // Same as setting broker.store.idle-ticks to 1.
+  clone_state(eager).idle_ticks = 1;
+  pump();
+  REQUIRE(clone_state(sleepy).has_master());
+  REQUIRE(clone_state(eager).has_master());
+  tick();
+  MESSAGE("without pending work, a clone schedules its tick idle-ticks ahead");
+  CHECK(clone_state(sleepy).sleeping);
+  CHECK_EQUAL(clone_state(sleepy).scheduled_ticks,
+              defaults::store::idle_ticks);
+  CHECK(!clone_state(eager).sleeping);
+  CHECK_EQUAL(clone_state(eager).scheduled_ticks, 1u);
+  MESSAGE("an update wakes up the clone");
+  put("a", 1);
+  pump();
+  CHECK(!clone_state(sleepy).sleeping);
+  CHECK_EQUAL(read(sleepy, "a"), data{1});
+  MESSAGE("the clone falls asleep again after its next tick");
+  tick();
+  CHECK(clone_state(sleepy).sleeping);
+}
+
+TEST(idle clones hibernate after the configured time) {
+  using std::chrono::milliseconds;
+  spawn_master({});
+  auto hibernating = spawn_clone('B');
+  auto awake = spawn_clone('C');
+  // Same as setting broker.store.hibernate-after. The default disables
+  // hibernation.
+  clone_state(hibernating).hibernate_after = milliseconds(1);
+  pump();
+  MESSAGE("a clone hibernates once it slept for at least hibernate-after");
+  tick();
+  REQUIRE(clone_state(hibernating).sleeping);
+  CHECK(!clone_state(hibernating).hibernating);
+  std::this_thread::sleep_for(milliseconds(2));
+  for (size_t i = 0; i < defaults::store::idle_ticks; ++i)
+    tick();
+  CHECK(clone_state(hibernating).hibernating);
+  CHECK(clone_state(awake).sleeping);
+  CHECK(!clone_state(awake).hibernating);
+  MESSAGE("an update ends the hibernation");
+  put("a", 1);
+  pump();
+  CHECK(!clone_state(hibernating).hibernating);
+  CHECK_EQUAL(read(hibernating, "a"), data{1});
+}
+
+TEST(masters publish one event per write by default) {
+  spawn_master({});
+  put("a", 1);
+  put("b", 2);
+  pump();
+  REQUIRE_EQUAL(events.size(), 2u);
+  for (const auto& msg : events) {
+    auto content = get_data(msg).to_data();
+    CHECK(store_event::insert::make(content));
+  }
+}
+
+TEST(masters with batch events publish the events of a tick at once) {
+  spawn_master({});
+  // Same as setting broker.store.batch-events.
+  master_state().batch_events = true;
+  put("a", 1);
+  put("b", 2);
+  pump();
+  CHECK(events.empty());
+  tick();
+  REQUIRE_EQUAL(events.size(), 1u);
+  auto content = get_data(events[0]).to_data();
+  auto view = store_event::batch::make(content);
+  REQUIRE(view);
+  CHECK_EQUAL(view.store_id(), "foo");
+  CHECK_EQUAL(view.events().size(), 2u);
+}
+
+TEST(masters with on demand events skip events without subscribers) {
+  spawn_master({});
+  // Same as setting broker.store.on-demand-events.
+  master_state().on_demand_events = true;
+  MESSAGE("the master asks for subscribers on each tick");
+  master_state().wakeup();
+  tick();
+  CHECK(!master_state().has_event_subscribers);
+  put("a", 1);
+  pump();
+  CHECK(events.empty());
+  MESSAGE("the master publishes events again after a subscriber shows up");
+  event_subscribers = true;
+  master_state().wakeup();
+  tick();
+  CHECK(master_state().has_event_subscribers);
+  put("b", 2);
+  pump();
+  CHECK_EQUAL(events.size(), 1u);
+}
+
+TEST(masters with coalesced updates send one batch per tick) {
+  spawn_master({});
+  auto clone = spawn_clone('B');
+  pump();
+  MESSAGE("by default, the master forwards each write right away");
+  routed.clear();
+  put("a", 1);
+  put("a", 2);
+  pump();
+  CHECK_EQUAL(num_routed<put_command>(), 2u);
+  CHECK_EQUAL(read(clone, "a"), data{2});
+  MESSAGE("with coalesce-updates, the master merges writes until its tick");
+  // Same as setting broker.store.coalesce-updates.
+  master_state().coalesced.enabled(true);
+  routed.clear();
+  put("a", 3);
+  put("a", 4);
+  put("b", 5);
+  pump();
+  CHECK_EQUAL(num_routed<put_command>(), 0u);
+  CHECK_EQUAL(num_routed<batch_command>(), 0u);
+  CHECK_EQUAL(read(clone, "a"), data{2});
+  tick();
+  CHECK_EQUAL(num_routed<put_command>(), 0u);
+  REQUIRE_EQUAL(num_routed<batch_command>(), 1u);
+  for (const auto& msg : routed)
+    if (auto cmd = get_if<batch_command>(&get_command(msg).content))
+      CHECK_EQUAL(cmd->entries.size(), 2u);
+  CHECK_EQUAL(read(clone, "a"), data{4});
+  CHECK_EQUAL(read(clone, "b"), data{5});
+}
+
+FIXTURE_SCOPE_END()
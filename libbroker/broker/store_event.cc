@@ -11,6 +11,7 @@ constexpr const char* type_strings[] = {
   "update",
   "erase",
   "expire",
+  "batch",
 };
 
 bool is_entity_id(const vector& xs, size_t endpoint_index,
@@ -64,6 +65,14 @@ store_event::expire store_event::expire::make(const vector& xs) noexcept {
                   : nullptr};
 }
 
+store_event::batch store_event::batch::make(const vector& xs) noexcept {
+  return batch{xs.size() == 3
+                   && to<store_event::type>(xs[0]) == store_event::type::batch
+                   && is<std::string>(xs[1]) && is<vector>(xs[2])
+                 ? &xs
+                 : nullptr};
+}
+
 const char* to_string(store_event::type code) noexcept {
   return type_strings[static_cast<uint8_t>(code)];
 }
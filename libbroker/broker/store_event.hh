@@ -17,6 +17,7 @@ public:
     update,
     erase,
     expire,
+    batch,
   };
 
   /// A view into a ::data object representing an `insert` event.
@@ -260,6 +261,52 @@ public:
 
     const vector* xs_;
   };
+
+  /// A view into a ::data object representing a `batch` of events. Stores
+  /// only emit batches when setting `broker.store.batch-events` to `true`.
+  /// Broker encodes `batch` events as
+  /// ```
+  /// [
+  ///   "batch",
+  ///   store_id: string,
+  ///   events: vector
+  /// ]
+  /// ```
+  /// Each element of `events` is an `insert`, `update`, `erase` or `expire`
+  /// event in the order the store has produced them.
+  class batch {
+  public:
+    batch(const batch&) noexcept = default;
+
+    batch& operator=(const batch&) noexcept = default;
+
+    static batch make(const data& src) noexcept {
+      if (auto xs = get_if<vector>(src))
+        return make(*xs);
+      return batch{nullptr};
+    }
+
+    static batch make(const vector& xs) noexcept;
+
+    explicit operator bool() const noexcept {
+      return xs_ != nullptr;
+    }
+
+    const std::string& store_id() const {
+      return get<std::string>((*xs_)[1]);
+    }
+
+    const vector& events() const {
+      return get<vector>((*xs_)[2]);
+    }
+
+  private:
+    explicit batch(const vector* xs) noexcept : xs_(xs) {
+      // nop
+    }
+
+    const vector* xs_;
+  };
 };
 
 /// @relates store_event::type
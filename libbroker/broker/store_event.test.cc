@@ -150,4 +150,22 @@ TEST(erase events contain the key and optionally a publisher ID) {
   }
 }
 
+TEST(batch events contain a list of events) {
+  vector events{vector{"erase"s, "x"s, "foo"s, nil, nil},
+                vector{"insert"s, "x"s, "bar"s, "baz"s, nil, nil, nil}};
+  data x{vector{"batch"s, "x"s, events}};
+  auto view = store_event::batch::make(x);
+  REQUIRE(view);
+  CHECK_EQUAL(view.store_id(), "x"s);
+  REQUIRE_EQUAL(view.events().size(), 2u);
+  CHECK(store_event::erase::make(view.events()[0]));
+  CHECK(store_event::insert::make(view.events()[1]));
+  MESSAGE("make returns an invalid view for malformed data");
+  {
+    CHECK_INVALID(batch, "batch"s, "x"s);
+    CHECK_INVALID(batch, "batch"s, "x"s, "foo"s);
+    CHECK_INVALID(batch, "erase"s, "x"s, vector{});
+  }
+}
+
 FIXTURE_SCOPE_END()
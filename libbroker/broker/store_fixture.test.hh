@@ -0,0 +1,193 @@
+#pragma once
+
+#include "broker/broker-test.test.hh"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "broker/backend.hh"
+#include "broker/data.hh"
+#include "broker/detail/make_backend.hh"
+#include "broker/endpoint.hh"
+#include "broker/entity_id.hh"
+#include "broker/internal/clone_actor.hh"
+#include "broker/internal/configuration_access.hh"
+#include "broker/internal/core_actor.hh"
+#include "broker/internal/master_actor.hh"
+#include "broker/internal/native.hh"
+#include "broker/internal/type_id.hh"
+#include "broker/internal_command.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+/// Hosts a master and its clones for the store "foo". Instead of a core, the
+/// test routes the messages between the stores by calling `pump`.
+struct store_fixture : base_fixture {
+  using snapshot_map = std::unordered_map<broker::data, broker::data>;
+
+  caf::actor master;
+
+  std::vector<caf::actor> clones;
+
+  /// Stores all messages that `pump` routed.
+  std::vector<broker::command_message> routed;
+
+  /// Stores all events that the stores published.
+  std::vector<broker::data_message> events;
+
+  /// Answers the stores when they ask for local subscribers to their events.
+  bool event_subscribers = false;
+
+  /// Keeps the inputs of the stores open.
+  std::vector<caf::async::producer_resource<broker::command_message>> inputs;
+
+  /// Keeps the outputs of the stores open.
+  std::vector<caf::async::consumer_resource<broker::command_message>> outputs;
+
+  std::string master_topic = broker::topic{"foo"}
+                             / broker::topic::master_suffix();
+
+  store_fixture() : base_fixture(make_store_config()) {
+    // nop
+  }
+
+  explicit store_fixture(broker::configuration cfg)
+    : base_fixture(std::move(cfg)) {
+    // nop
+  }
+
+  ~store_fixture() {
+    for (auto& hdl : clones)
+      caf::anon_send_exit(hdl, caf::exit_reason::user_shutdown);
+    caf::anon_send_exit(master, caf::exit_reason::user_shutdown);
+    sched.run();
+  }
+
+  /// Returns a configuration with small snapshot chunks and a replay log.
+  static broker::configuration make_store_config() {
+    auto cfg = make_config();
+    auto& content = broker::internal::configuration_access{&cfg}.cfg().content;
+    caf::put(content, "broker.store.snapshot-chunk-size", 2);
+    caf::put(content, "broker.store.replay-log-size", 8);
+    return cfg;
+  }
+
+  broker::endpoint::clock* clock() {
+    using broker::internal::native;
+    return deref<broker::internal::core_actor>(native(ep.core())).state.clock;
+  }
+
+  void spawn_master(const snapshot_map& content) {
+    using namespace broker;
+    using caf::async::make_spsc_buffer_resource;
+    auto bp = detail::make_backend(backend::memory, {});
+    for (const auto& [key, value] : content)
+      bp->put(key, value, std::nullopt);
+    auto [con1, prod1] = make_spsc_buffer_resource<command_message>();
+    auto [con2, prod2] = make_spsc_buffer_resource<command_message>();
+    inputs.emplace_back(prod1);
+    outputs.emplace_back(con2);
+    master = sys.spawn<internal::master_actor_type>(
+      ids['A'], "foo", std::move(bp), caf::actor_cast<caf::actor>(self),
+      clock(), con1, prod2);
+    sched.run();
+  }
+
+  caf::actor spawn_clone(char id, std::string key_prefix = {}) {
+    using namespace broker;
+    using caf::async::make_spsc_buffer_resource;
+    auto [con1, prod1] = make_spsc_buffer_resource<command_message>();
+    auto [con2, prod2] = make_spsc_buffer_resource<command_message>();
+    inputs.emplace_back(prod1);
+    outputs.emplace_back(con2);
+    auto hdl = sys.spawn<internal::clone_actor_type>(
+      ids[id], "foo", caf::timespan{0}, std::move(key_prefix),
+      caf::actor_cast<caf::actor>(self), clock(), con1, prod2);
+    clones.emplace_back(hdl);
+    sched.run();
+    return hdl;
+  }
+
+  broker::internal::master_state& master_state() {
+    return deref<broker::internal::master_actor_type>(master).state;
+  }
+
+  broker::internal::clone_state& clone_state(const caf::actor& hdl) {
+    return deref<broker::internal::clone_actor_type>(hdl).state;
+  }
+
+  /// Writes to the master as a frontend would.
+  void put(broker::data key, broker::data value) {
+    using namespace broker;
+    caf::anon_send(master, internal::atom::local_v,
+                   internal_command_variant{put_command{
+                     std::move(key), std::move(value), std::nullopt,
+                     entity_id{}}});
+    sched.run();
+  }
+
+  /// Returns the value for `key` at the clone `hdl` or `nil`.
+  broker::data read(const caf::actor& hdl, const broker::data& key) {
+    if (auto val = clone_state(hdl).lookup(key))
+      return *val;
+    return broker::data{};
+  }
+
+  /// Counts the routed messages of type `T`.
+  template <class T>
+  size_t num_routed() {
+    return std::count_if(routed.begin(), routed.end(), [](const auto& msg) {
+      return std::holds_alternative<T>(get_command(msg).content);
+    });
+  }
+
+  /// Runs the ticks of the stores for one tick interval and routes their
+  /// messages afterwards.
+  void tick() {
+    run(master_state().tick_interval);
+    pump();
+  }
+
+  /// Delivers the messages of the stores to their receivers until the stores
+  /// fall silent.
+  void pump() {
+    using namespace broker;
+    namespace atom = internal::atom;
+    // Calls `wakeup` first, just like the observer for the store input.
+    auto deliver = [this](const command_message& msg, const endpoint_id* dst) {
+      routed.emplace_back(msg);
+      if (get_topic(msg) == master_topic) {
+        master_state().wakeup();
+        master_state().dispatch(msg);
+        return;
+      }
+      for (auto& hdl : clones) {
+        auto& state = clone_state(hdl);
+        if (dst == nullptr || state.id.endpoint == *dst) {
+          state.wakeup();
+          state.dispatch(msg);
+        }
+      }
+    };
+    for (auto done = false; !done;) {
+      sched.run();
+      self->receive(
+        [&](atom::publish, const command_message& msg) {
+          deliver(msg, nullptr);
+        },
+        [&](atom::publish, const command_message& msg, endpoint_id dst) {
+          deliver(msg, &dst);
+        },
+        [this](atom::publish, atom::local, const data_message& msg) {
+          events.emplace_back(msg);
+        },
+        [this](atom::get, atom::subscriptions, const topic&) {
+          return event_subscribers;
+        },
+        caf::after(timespan{0}) >> [&] { done = true; });
+    }
+  }
+};
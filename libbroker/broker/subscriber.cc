@@ -1,32 +1,67 @@
 #include "broker/subscriber.hh"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstddef>
+#include <deque>
 #include <future>
+#include <memory>
 #include <numeric>
 #include <utility>
 
 #include <caf/async/consumer.hpp>
+#include <caf/actor_system_config.hpp>
 #include <caf/async/spsc_buffer.hpp>
 #include <caf/event_based_actor.hpp>
 #include <caf/scheduled_actor.hpp>
 #include <caf/scoped_actor.hpp>
 #include <caf/send.hpp>
 #include <caf/stateful_actor.hpp>
+#include <caf/telemetry/counter.hpp>
+#include <caf/telemetry/gauge.hpp>
 
+#include "broker/config.hh"
+#include "broker/defaults.hh"
 #include "broker/detail/assert.hh"
 #include "broker/detail/flare.hh"
 #include "broker/endpoint.hh"
 #include "broker/filter_type.hh"
 #include "broker/internal/endpoint_access.hh"
 #include "broker/internal/logger.hh"
+#include "broker/internal/metric_factory.hh"
 #include "broker/internal/native.hh"
 #include "broker/internal/type_id.hh"
+#include "broker/zeek.hh"
+
+#ifdef BROKER_USE_SSE2
+#  include <emmintrin.h>
+#endif
 
 using broker::internal::native;
 
 namespace broker::detail {
 
+namespace {
+
+/// Hints the CPU that the caller is busy-waiting.
+void cpu_relax() noexcept {
+#ifdef BROKER_USE_SSE2
+  _mm_pause();
+#endif
+}
+
+/// Creates a buffer for a subscriber queue with given capacity.
+auto make_queue_resource(size_t capacity) {
+  // Signal demand to the core after consuming a quarter of the capacity.
+  using caf::async::make_spsc_buffer_resource;
+  return make_spsc_buffer_resource<data_message>(capacity,
+                                                 std::max(capacity / 4,
+                                                          size_t{1}));
+}
+
+} // namespace
+
 struct subscriber_queue : public caf::ref_counted, public caf::async::consumer {
 public:
   using buffer_type = caf::async::spsc_buffer<data_message>;
@@ -35,13 +70,44 @@ public:
 
   using guard_type = std::unique_lock<std::mutex>;
 
+  using int_counter = caf::telemetry::int_counter;
+
+  using int_gauge = caf::telemetry::int_gauge;
+
+  /// Configures the adaptive sizing of the queue.
+  struct resize_policy {
+    /// The queue never shrinks below this size.
+    size_t min_size;
+
+    /// The queue never grows beyond this size.
+    size_t max_size;
+
+    /// Receives the new buffers after resizing the queue.
+    caf::actor core;
+
+    /// Identifies the subscriber at the core.
+    std::shared_ptr<filter_type> filter;
+
+    /// Counts how often the queue grew.
+    int_counter* grows;
+
+    /// Counts how often the queue shrunk.
+    int_counter* shrinks;
+
+    /// Keeps track of the highest number of buffered messages.
+    int_gauge* high_water_mark;
+  };
+
   explicit subscriber_queue(buffer_ptr buf) : buf_(std::move(buf)) {
     // nop
   }
 
   ~subscriber_queue() override {
-    if (buf_)
-      buf_->cancel();
+    cancel();
+  }
+
+  void enable_resizing(resize_policy policy) {
+    policy_ = std::make_unique<resize_policy>(std::move(policy));
   }
 
   void on_producer_ready() override {
@@ -57,6 +123,8 @@ public:
   }
 
   void wait() {
+    if (spin_until_ready())
+      return;
     guard_type guard{mtx_};
     while (!ready_) {
       guard.unlock();
@@ -66,6 +134,8 @@ public:
   }
 
   bool wait_until(timestamp abs_timeout) {
+    if (spin_until_ready())
+      return true;
     guard_type guard{mtx_};
     while (!ready_) {
       guard.unlock();
@@ -93,6 +163,8 @@ public:
   void cancel() {
     if (buf_)
       buf_->cancel();
+    if (next_)
+      next_->cancel();
   }
 
   void extinguish() {
@@ -107,29 +179,68 @@ public:
     BROKER_TRACE(BROKER_ARG2("dst.size", dst.size()) << BROKER_ARG(num));
     BROKER_ASSERT(num > 0);
     BROKER_ASSERT(dst.size() < num);
+    auto f = [&dst](const data_message& val) { dst.push_back(val); };
+    return pull_with(num - dst.size(), f);
+  }
+
+  /// Calls `f` for up to `num` values without storing them in a buffer.
+  template <class F>
+  bool pull_with(size_t num, F& f) {
+    BROKER_ASSERT(num > 0);
+    // Deliver messages from previously unpacked batches first.
+    while (!unpacked_.empty() && num > 0) {
+      f(unpacked_.front());
+      unpacked_.pop_front();
+      --num;
+    }
+    if (num == 0)
+      return true;
     struct cb {
       subscriber_queue* qptr;
-      std::vector<data_message>* dst;
+      F* fn;
       void on_next(const data_message& val) {
-        dst->push_back(val);
+        // Skip messages that waited past their deadline.
+        if (val->expired())
+          return;
+        if (!qptr->unpack(val)) {
+          (*fn)(val);
+        } else if (!qptr->unpacked_.empty()) {
+          (*fn)(qptr->unpacked_.front());
+          qptr->unpacked_.pop_front();
+        }
       }
       void on_complete() {
-        qptr->extinguish();
+        // The core closes the previous buffer after resizing the queue.
+        if (!qptr->next_ && qptr->unpacked_.empty())
+          qptr->extinguish();
       }
       void on_error(const caf::error&) {
         qptr->extinguish();
       }
     };
     using caf::async::delay_errors;
-    cb consumer{this, &dst};
+    cb consumer{this, &f};
     if (buf_) {
-      auto [open, n] = buf_->pull(delay_errors, num - dst.size(), consumer);
+      if (policy_)
+        adapt(buf_->available());
+      auto [open, n] = buf_->pull(delay_errors, num, consumer);
       BROKER_DEBUG("got" << n << "messages from bounded buffer");
-      if (!open) {
+      if (!open && next_) {
+        BROKER_DEBUG("drained previous buffer, switch to resized buffer");
+        buf_ = std::move(next_);
+        if (buf_->available() > 0) {
+          guard_type guard{mtx_};
+          if (!ready_) {
+            ready_ = true;
+            fx_.fire();
+          }
+        }
+        return true;
+      } else if (!open) {
         BROKER_DEBUG("nothing left to pull, queue closed");
         buf_ = nullptr;
-        return false;
-      } else if (buf_->available() == 0) {
+        return !unpacked_.empty();
+      } else if (buf_->available() == 0 && unpacked_.empty()) {
         // Note: We always *must* acquire the lock on the buffer before
         // acquiring the lock on the subscriber to prevent deadlocks.
         guard_type buf_guard{buf_->mtx()};
@@ -149,12 +260,45 @@ public:
     }
   }
 
+  /// Moves the content of `msg` to `unpacked_` if `msg` is a transparent
+  /// batch, i.e., a batch that the sender created automatically.
+  /// @returns `true` if `msg` was a transparent batch, `false` otherwise.
+  bool unpack(const data_message& msg) {
+    if (zeek::Message::type(msg) != zeek::Message::Type::Batch)
+      return false;
+    zeek::Batch batch{msg};
+    if (!batch.valid() || !batch.transparent())
+      return false;
+    auto topic_str = msg->topic();
+    batch.for_each([this, topic_str](const auto& item) {
+      unpacked_.emplace_back(data_envelope::make(topic_str, item.raw()));
+    });
+    return true;
+  }
+
+  /// Busy-waits for a short while before the caller blocks on the flare.
+  /// Adapts the number of iterations to how often spinning succeeded before.
+  bool spin_until_ready() {
+    for (size_t i = 0; i < spin_limit_; ++i) {
+      if (ready_.load(std::memory_order_acquire)) {
+        spin_limit_ = std::min(spin_limit_ * 2, max_spin_limit);
+        return true;
+      }
+      cpu_relax();
+    }
+    spin_limit_ = std::max(spin_limit_ / 2, min_spin_limit);
+    return false;
+  }
+
   size_t capacity() const noexcept {
     return buf_ ? buf_->capacity() : size_t{0};
   }
 
   size_t available() const noexcept {
-    return buf_ ? buf_->available() : size_t{0};
+    auto result = buf_ ? buf_->available() : size_t{0};
+    if (next_)
+      result += next_->available();
+    return result + unpacked_.size();
   }
 
   friend void intrusive_ptr_add_ref(const subscriber_queue* ptr) noexcept {
@@ -175,8 +319,83 @@ private:
   /// Signals to users when data can be read or written.
   mutable detail::flare fx_;
 
-  /// Stores whether we have data available.
-  bool ready_ = false;
+  /// Stores whether we have data available. Writes require holding `mtx_`, but
+  /// `spin_until_ready` also reads the flag without the lock.
+  std::atomic<bool> ready_ = false;
+
+  static constexpr size_t min_spin_limit = 16;
+
+  static constexpr size_t max_spin_limit = 1024;
+
+  /// Stores how many iterations `spin_until_ready` may busy-wait.
+  size_t spin_limit_ = min_spin_limit;
+
+  /// Stores messages from transparent batches that we did not deliver yet.
+  std::deque<data_message> unpacked_;
+
+  /// Grows or shrinks the queue depending on how many messages were waiting
+  /// in the buffer when the user started to read from it.
+  void adapt(size_t backlog) {
+    if (backlog > high_water_mark_) {
+      high_water_mark_ = backlog;
+      auto val = static_cast<int64_t>(backlog);
+      if (policy_->high_water_mark->value() < val)
+        policy_->high_water_mark->value(val);
+    }
+    // Wait until the core switched to the new buffer before adapting again.
+    if (next_)
+      return;
+    auto cap = buf_->capacity();
+    if (backlog >= cap) {
+      idle_reads_ = 0;
+      if (++full_reads_ >= defaults::subscriber::grow_threshold
+          && cap < policy_->max_size) {
+        full_reads_ = 0;
+        policy_->grows->inc();
+        resize(std::min(cap * 2, policy_->max_size));
+      }
+      return;
+    }
+    full_reads_ = 0;
+    if (backlog > cap / 4) {
+      idle_reads_ = 0;
+      return;
+    }
+    if (++idle_reads_ >= defaults::subscriber::shrink_threshold
+        && cap > policy_->min_size) {
+      idle_reads_ = 0;
+      policy_->shrinks->inc();
+      resize(std::max(cap / 2, policy_->min_size));
+    }
+  }
+
+  /// Asks the core to replace the buffer with a new buffer of given size.
+  void resize(size_t new_size) {
+    BROKER_DEBUG("resize subscriber queue from" << buf_->capacity() << "to"
+                                                << new_size);
+    auto [con_res, prod_res] = make_queue_resource(new_size);
+    next_ = con_res.try_open();
+    BROKER_ASSERT(next_ != nullptr);
+    next_->set_consumer(caf::async::consumer_ptr{this});
+    caf::anon_send(policy_->core, atom::update_v, policy_->filter,
+                   std::move(prod_res));
+  }
+
+  /// Stores the replacement for `buf_` while resizing the queue. The core
+  /// closes `buf_` when switching to the new buffer.
+  buffer_ptr next_;
+
+  /// Configures adaptive sizing. Disabled if `nullptr`.
+  std::unique_ptr<resize_policy> policy_;
+
+  /// Stores the highest backlog of this queue so far.
+  size_t high_water_mark_ = 0;
+
+  /// Counts consecutive reads from a full buffer.
+  size_t full_reads_ = 0;
+
+  /// Counts consecutive reads from a mostly empty buffer.
+  size_t idle_reads_ = 0;
 };
 
 namespace {
@@ -215,16 +434,28 @@ subscriber::~subscriber() {
   reset();
 }
 
-subscriber subscriber::make(endpoint& ep, filter_type filter, size_t) {
+subscriber subscriber::make(endpoint& ep, filter_type filter,
+                            size_t queue_size) {
   BROKER_INFO("creating subscriber for topic(s)" << filter);
-  using caf::async::make_spsc_buffer_resource;
+  if (queue_size == 0)
+    queue_size = defaults::subscriber::queue_size;
   auto fptr = std::make_shared<filter_type>(std::move(filter));
-  auto [con_res, prod_res] = make_spsc_buffer_resource<data_message>();
+  auto [con_res, prod_res] = detail::make_queue_resource(queue_size);
   caf::anon_send(native(ep.core()), fptr, std::move(prod_res));
   auto buf = con_res.try_open();
   BROKER_ASSERT(buf != nullptr);
   auto qptr = caf::make_counted<detail::subscriber_queue>(buf);
   buf->set_consumer(qptr);
+  internal::endpoint_access access{&ep};
+  auto max_size = caf::get_or(access.cfg(), "broker.subscriber.max-queue-size",
+                              defaults::subscriber::max_queue_size);
+  if (max_size > queue_size) {
+    internal::metric_factory factory{access.sys()};
+    auto resizes = factory.core.subscriber_queue_resizes_instances();
+    auto hwm = factory.core.subscriber_queue_high_water_mark_instance();
+    qptr->enable_resizing({queue_size, max_size, native(ep.core()), fptr,
+                           resizes.grow, resizes.shrink, hwm});
+  }
   return subscriber{detail::make_opaque(std::move(qptr)), std::move(fptr),
                     ep.core()};
 }
@@ -284,6 +515,29 @@ std::vector<data_message> subscriber::poll() {
   return buf;
 }
 
+size_t subscriber::poll(std::vector<data_message>& out, size_t max) {
+  BROKER_TRACE(BROKER_ARG(max));
+  out.clear();
+  if (max > 0)
+    dptr(queue_)->pull(out, max);
+  BROKER_DEBUG("polled" << out.size() << "messages");
+  return out.size();
+}
+
+size_t subscriber::do_consume(size_t max, consume_fn fn, void* obj) {
+  BROKER_TRACE(BROKER_ARG(max));
+  size_t result = 0;
+  if (max > 0) {
+    auto f = [fn, obj, &result](const data_message& msg) {
+      fn(obj, msg);
+      ++result;
+    };
+    dptr(queue_)->pull_with(max, f);
+  }
+  BROKER_DEBUG("consumed" << result << "messages");
+  return result;
+}
+
 size_t subscriber::available() const noexcept {
   return dptr(queue_)->available();
 }
@@ -9,6 +9,8 @@
 #include "broker/worker.hh"
 
 #include <functional>
+#include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace broker {
@@ -47,6 +49,37 @@ public:
   /// Returns all currently available values without blocking.
   std::vector<data_message> poll();
 
+  /// Replaces the content of `out` with up to `max` currently available values
+  /// without blocking. Passing the same buffer on each call avoids allocating
+  /// a new vector per poll.
+  /// @returns the number of values in `out`.
+  size_t poll(std::vector<data_message>& out, size_t max);
+
+  /// Calls `f` for up to `max` currently available values without blocking
+  /// and without collecting the values in a buffer first.
+  /// @returns the number of consumed values.
+  template <class F>
+  size_t consume(size_t max, F&& f) {
+    using fn_type = std::remove_reference_t<F>;
+    auto fn = [](void* ptr, const data_message& msg) {
+      (*static_cast<fn_type*>(ptr))(msg);
+    };
+    auto* obj = const_cast<void*>(static_cast<const void*>(std::addressof(f)));
+    return do_consume(max, fn, obj);
+  }
+
+  /// Calls `f` with the topic and the value of up to `max` currently available
+  /// messages without blocking. The value is a @ref variant view into the
+  /// message, i.e., consumers only pay for the fields they actually read,
+  /// e.g., via `visit` or `visit_fields` (see `broker/variant_visit.hh`).
+  /// @returns the number of consumed values.
+  template <class F>
+  size_t consume_values(size_t max, F&& f) {
+    return consume(max, [&f](const data_message& msg) {
+      f(msg->topic(), msg->value());
+    });
+  }
+
   /// Pulls a single value out of the stream. Blocks the current thread until
   /// at least one value becomes available.
   data_message get();
@@ -137,6 +170,10 @@ private:
 
   void update_filter(topic x, bool add, bool block);
 
+  using consume_fn = void (*)(void*, const data_message&);
+
+  size_t do_consume(size_t max, consume_fn fn, void* obj);
+
   std::vector<data_message> do_get(size_t num, timestamp abs_timeout);
 
   void do_get(std::vector<data_message>& buf, size_t num,
@@ -15,6 +15,7 @@
 #include "broker/data.hh"
 #include "broker/endpoint.hh"
 #include "broker/filter_type.hh"
+#include "broker/format/bin.hh"
 #include "broker/internal/core_actor.hh"
 #include "broker/internal/native.hh"
 #include "broker/internal/type_id.hh"
@@ -87,4 +88,81 @@ TEST(subscribers receive data from remote publications) {
   CHECK_EQUAL(values(inputs), values(out_buf));
 }
 
+TEST(subscribers can drain values into caller-owned buffers) {
+  auto sub = earth.ep.make_subscriber({"foo"});
+  run();
+  bridge(earth, mars);
+  for (auto& msg : out_buf)
+    mars.ep.publish(msg);
+  run();
+  CHECK_EQUAL(sub.available(), 10u);
+  MESSAGE("poll into a buffer that already holds values");
+  std::vector<data_message> buf{make_data_message("bar", 42)};
+  CHECK_EQUAL(sub.poll(buf, 4), 4u);
+  CHECK_EQUAL(values(buf), values({out_buf.begin(), out_buf.begin() + 4}));
+  MESSAGE("consume values one by one");
+  std::vector<data_message> consumed;
+  auto fn = [&consumed](const data_message& msg) { consumed.push_back(msg); };
+  CHECK_EQUAL(sub.consume(2, fn), 2u);
+  CHECK_EQUAL(sub.consume(100, fn), 4u);
+  CHECK_EQUAL(values(consumed), values({out_buf.begin() + 4, out_buf.end()}));
+  CHECK_EQUAL(sub.available(), 0u);
+  CHECK_EQUAL(sub.consume(100, fn), 0u);
+  CHECK_EQUAL(sub.poll(buf, 100), 0u);
+  CHECK(buf.empty());
+}
+
+TEST(subscribers hand out views to the values of messages) {
+  auto sub = earth.ep.make_subscriber({"foo"});
+  run();
+  bridge(earth, mars);
+  for (auto& msg : out_buf)
+    mars.ep.publish(msg);
+  run();
+  std::vector<std::string> names;
+  std::vector<broker::data> inputs;
+  auto n = sub.consume_values(100, [&](std::string_view t, const variant& x) {
+    names.emplace_back(t);
+    inputs.emplace_back(x.to_data());
+  });
+  CHECK_EQUAL(n, 10u);
+  CHECK_EQUAL(names, topics(out_buf));
+  CHECK_EQUAL(inputs, values(out_buf));
+}
+
+TEST(subscribers receive messages from pre-encoded batches) {
+  auto sub = earth.ep.make_subscriber({"foo"});
+  run();
+  bridge(earth, mars);
+  std::vector<std::byte> batch;
+  for (auto& msg : out_buf) {
+    auto [payload, payload_size] = msg->raw_bytes();
+    format::bin::v1::encode_record(msg->topic(), payload, payload_size,
+                                   std::back_inserter(batch));
+  }
+  CHECK(!mars.ep.publish_encoded({batch.begin(), batch.end() - 1}));
+  CHECK(mars.ep.publish_encoded(std::move(batch)));
+  run();
+  auto inputs = sub.poll();
+  CHECK_EQUAL(topics(inputs), topics(out_buf));
+  CHECK_EQUAL(values(inputs), values(out_buf));
+}
+
+TEST(subscribers buffer no more messages than their queue size) {
+  auto sub = earth.ep.make_subscriber({"foo"}, 4);
+  run();
+  bridge(earth, mars);
+  for (auto& msg : out_buf)
+    mars.ep.publish(msg);
+  std::vector<data_message> inputs;
+  for (size_t round = 0; round < 10 && inputs.size() < out_buf.size();
+       ++round) {
+    run();
+    CHECK_LESS_EQUAL(sub.available(), 4u);
+    for (auto& msg : sub.poll())
+      inputs.emplace_back(msg);
+  }
+  CHECK_EQUAL(values(inputs), values(out_buf));
+}
+
 FIXTURE_SCOPE_END()
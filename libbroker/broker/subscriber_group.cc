@@ -0,0 +1,132 @@
+#include "broker/subscriber_group.hh"
+
+#include <algorithm>
+
+#include "broker/endpoint.hh"
+#include "broker/internal/logger.hh"
+
+namespace broker {
+
+namespace {
+
+filter_type merge_filters(const std::vector<filter_type>& filters) {
+  filter_type result;
+  for (auto& filter : filters)
+    for (auto& x : filter)
+      if (std::find(result.begin(), result.end(), x) == result.end())
+        result.emplace_back(x);
+  return result;
+}
+
+} // namespace
+
+// --- constructors and destructors --------------------------------------------
+
+subscriber_group::subscriber_group(subscriber impl,
+                                   std::vector<filter_type> filters)
+  : impl_(std::move(impl)) {
+  members_.reserve(filters.size());
+  for (auto& filter : filters) {
+    detail::topic_matcher matcher{filter};
+    members_.push_back(member{std::move(filter), std::move(matcher), true});
+  }
+}
+
+// --- factories ---------------------------------------------------------------
+
+subscriber_group subscriber_group::make(endpoint& ep,
+                                        std::vector<filter_type> filters,
+                                        size_t queue_size) {
+  BROKER_INFO("creating subscriber group for" << filters.size() << "filters");
+  auto impl = subscriber::make(ep, merge_filters(filters), queue_size);
+  return subscriber_group{std::move(impl), std::move(filters)};
+}
+
+// --- filter management -------------------------------------------------------
+
+subscriber_group::tag_type subscriber_group::add(filter_type filter,
+                                                 bool block) {
+  auto tag = members_.size();
+  BROKER_INFO("adding filter" << filter << "with tag" << tag);
+  for (auto& x : filter)
+    if (!has_topic(x, invalid_tag))
+      impl_.add_topic(x, block);
+  detail::topic_matcher matcher{filter};
+  members_.push_back(member{std::move(filter), std::move(matcher), true});
+  return tag;
+}
+
+void subscriber_group::remove(tag_type tag, bool block) {
+  if (tag >= members_.size() || !members_[tag].active)
+    return;
+  BROKER_INFO("removing filter with tag" << tag);
+  auto& mbr = members_[tag];
+  mbr.active = false;
+  for (auto& x : mbr.filter)
+    if (!has_topic(x, tag))
+      impl_.remove_topic(x, block);
+  mbr.filter.clear();
+  mbr.matcher = detail::topic_matcher{};
+}
+
+size_t subscriber_group::size() const noexcept {
+  auto is_active = [](const member& x) { return x.active; };
+  return static_cast<size_t>(
+    std::count_if(members_.begin(), members_.end(), is_active));
+}
+
+// --- access to values --------------------------------------------------------
+
+std::vector<subscriber_group::value_type> subscriber_group::poll() {
+  std::vector<value_type> result;
+  poll(result, std::numeric_limits<size_t>::max());
+  return result;
+}
+
+size_t subscriber_group::poll(std::vector<value_type>& out, size_t max) {
+  out.clear();
+  return consume(max, [&out](tag_type tag, const data_message& msg) {
+    out.push_back(value_type{tag, msg});
+  });
+}
+
+subscriber_group::value_type subscriber_group::get() {
+  for (;;) {
+    auto msg = impl_.get();
+    if (auto tag = tag_of(msg); tag != invalid_tag)
+      return value_type{tag, std::move(msg)};
+    BROKER_DEBUG("drop message for a removed filter:" << get_topic(msg));
+  }
+}
+
+// --- miscellaneous -----------------------------------------------------------
+
+void subscriber_group::reset() {
+  impl_.reset();
+  members_.clear();
+}
+
+// --- utility -----------------------------------------------------------------
+
+subscriber_group::tag_type
+subscriber_group::tag_of(const data_message& msg) const noexcept {
+  auto str = get_topic(msg);
+  for (size_t tag = 0; tag < members_.size(); ++tag)
+    if (members_[tag].active && members_[tag].matcher(str))
+      return tag;
+  return invalid_tag;
+}
+
+bool subscriber_group::has_topic(const topic& what,
+                                 tag_type except) const noexcept {
+  for (size_t tag = 0; tag < members_.size(); ++tag) {
+    auto& mbr = members_[tag];
+    if (tag != except && mbr.active
+        && std::find(mbr.filter.begin(), mbr.filter.end(), what)
+             != mbr.filter.end())
+      return true;
+  }
+  return false;
+}
+
+} // namespace broker
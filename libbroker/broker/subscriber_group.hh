@@ -0,0 +1,143 @@
+#pragma once
+
+#include "broker/defaults.hh"
+#include "broker/detail/native_socket.hh"
+#include "broker/detail/topic_matcher.hh"
+#include "broker/filter_type.hh"
+#include "broker/fwd.hh"
+#include "broker/message.hh"
+#include "broker/subscriber.hh"
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace broker {
+
+/// Multiplexes several topic filters over a single subscriber. All filters
+/// share one queue and one file descriptor, i.e., consumers with many
+/// subscriptions only need to watch a single wakeup source. Each message
+/// carries the tag of the first filter that matches its topic.
+class subscriber_group {
+public:
+  // --- friend declarations ---------------------------------------------------
+
+  friend class endpoint;
+
+  // -- member types -----------------------------------------------------------
+
+  /// Identifies a filter of the group.
+  using tag_type = size_t;
+
+  /// A message plus the tag of the filter it matched.
+  struct value_type {
+    tag_type tag;
+    data_message msg;
+  };
+
+  // -- constants --------------------------------------------------------------
+
+  /// Denotes an invalid tag.
+  static constexpr tag_type invalid_tag = std::numeric_limits<tag_type>::max();
+
+  // --- constructors and destructors ------------------------------------------
+
+  subscriber_group(subscriber_group&&) = default;
+
+  subscriber_group& operator=(subscriber_group&&) = default;
+
+  // --- factories -------------------------------------------------------------
+
+  /// Creates a group with an initial list of filters. The tag of each filter
+  /// is its position in `filters`.
+  static subscriber_group make(endpoint& ep, std::vector<filter_type> filters,
+                               size_t queue_size);
+
+  // --- filter management -----------------------------------------------------
+
+  /// Adds `filter` to the group.
+  /// @returns the tag for messages that match `filter`.
+  tag_type add(filter_type filter, bool block = false);
+
+  /// Removes the filter for `tag` from the group. The tags of all other
+  /// filters remain valid and the group never reuses `tag`.
+  void remove(tag_type tag, bool block = false);
+
+  /// Returns the number of filters in the group.
+  size_t size() const noexcept;
+
+  // --- access to values ------------------------------------------------------
+
+  /// Returns all currently available values without blocking.
+  std::vector<value_type> poll();
+
+  /// Replaces the content of `out` with up to `max` currently available values
+  /// without blocking.
+  /// @returns the number of values in `out`.
+  size_t poll(std::vector<value_type>& out, size_t max);
+
+  /// Calls `f` with the tag and the message for up to `max` currently
+  /// available values without blocking.
+  /// @returns the number of consumed values.
+  template <class F>
+  size_t consume(size_t max, F&& f) {
+    size_t result = 0;
+    impl_.consume(max, [this, &f, &result](const data_message& msg) {
+      if (auto tag = tag_of(msg); tag != invalid_tag) {
+        f(tag, msg);
+        ++result;
+      }
+    });
+    return result;
+  }
+
+  /// Pulls a single value out of the stream. Blocks the current thread until
+  /// at least one value becomes available.
+  value_type get();
+
+  // --- accessors -------------------------------------------------------------
+
+  /// Returns the amount of values than can be extracted immediately without
+  /// blocking. This may include messages for filters that the group has
+  /// removed in the meantime, which the group drops when reading them.
+  size_t available() const noexcept {
+    return impl_.available();
+  }
+
+  /// Returns a file handle for integrating this group into a `select` or
+  /// `poll` loop.
+  detail::native_socket fd() const noexcept {
+    return impl_.fd();
+  }
+
+  // --- miscellaneous ---------------------------------------------------------
+
+  /// @copydoc subscriber::reset
+  void reset();
+
+private:
+  struct member {
+    filter_type filter;
+    detail::topic_matcher matcher;
+    bool active;
+  };
+
+  subscriber_group(subscriber impl, std::vector<filter_type> filters);
+
+  /// Returns the tag of the first filter that matches the topic of `msg` or
+  /// `invalid_tag` if no filter matches.
+  tag_type tag_of(const data_message& msg) const noexcept;
+
+  /// Checks whether an active member other than `except` has `what` in its
+  /// filter.
+  bool has_topic(const topic& what, tag_type except) const noexcept;
+
+  /// Receives the messages for all filters.
+  subscriber impl_;
+
+  /// Stores all filters, indexed by their tag.
+  std::vector<member> members_;
+};
+
+} // namespace broker
@@ -0,0 +1,74 @@
+#include "broker/subscriber_group.hh"
+
+#include "broker/broker-test.test.hh"
+
+#include "broker/endpoint.hh"
+
+using namespace broker;
+
+namespace {
+
+struct fixture : net_fixture<base_fixture> {
+  using tag_type = subscriber_group::tag_type;
+
+  std::vector<std::pair<tag_type, data>>
+  tagged_values(const std::vector<subscriber_group::value_type>& xs) {
+    std::vector<std::pair<tag_type, data>> result;
+    for (auto& x : xs)
+      result.emplace_back(x.tag, get_data(x.msg).to_data());
+    return result;
+  }
+};
+
+} // namespace
+
+FIXTURE_SCOPE(subscriber_group_tests, fixture)
+
+TEST(groups tag messages with the first matching filter) {
+  auto grp = earth.ep.make_subscriber_group({{"foo"}, {"bar", "foo/baz"}});
+  run();
+  bridge(earth, mars);
+  mars.ep.publish(make_data_message("foo", 1));
+  mars.ep.publish(make_data_message("bar", 2));
+  mars.ep.publish(make_data_message("foo/baz", 3));
+  mars.ep.publish(make_data_message("qux", 4));
+  run();
+  CHECK_EQUAL(grp.size(), 2u);
+  CHECK_EQUAL(grp.available(), 3u);
+  using pair_list = std::vector<std::pair<tag_type, data>>;
+  CHECK(tagged_values(grp.poll())
+        == pair_list({{0, data{1}}, {1, data{2}}, {0, data{3}}}));
+}
+
+TEST(groups support adding and removing filters) {
+  auto grp = earth.ep.make_subscriber_group({{"foo"}});
+  run();
+  bridge(earth, mars);
+  auto tag = grp.add({"bar"});
+  CHECK_EQUAL(tag, 1u);
+  run();
+  mars.ep.publish(make_data_message("foo", 1));
+  mars.ep.publish(make_data_message("bar", 2));
+  run();
+  std::vector<subscriber_group::value_type> buf;
+  CHECK_EQUAL(grp.poll(buf, 10), 2u);
+  MESSAGE("removing a filter drops its messages");
+  mars.ep.publish(make_data_message("bar", 3));
+  run();
+  grp.remove(tag);
+  run();
+  mars.ep.publish(make_data_message("bar", 4));
+  mars.ep.publish(make_data_message("foo", 5));
+  run();
+  CHECK_EQUAL(grp.size(), 1u);
+  std::vector<std::pair<tag_type, data>> consumed;
+  grp.consume(10, [&consumed](tag_type tag, const data_message& msg) {
+    consumed.emplace_back(tag, get_data(msg).to_data());
+  });
+  using pair_list = std::vector<std::pair<tag_type, data>>;
+  CHECK(consumed == pair_list({{0, data{5}}}));
+  MESSAGE("the group never reuses tags");
+  CHECK_EQUAL(grp.add({"bar"}), 2u);
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+#include "broker/data.hh"
+#include "broker/detail/filesystem.hh"
+#include "broker/message.hh"
+
+/// Provides a unique path for a directory that the code under test creates on
+/// its own and removes the directory with all of its files afterwards.
+struct temp_directory_fixture {
+  std::string path = broker::detail::make_temp_file_name();
+
+  temp_directory_fixture() {
+    // Remove the file from make_temp_file_name. The code under test creates
+    // its directory on its own.
+    broker::detail::remove(path);
+  }
+
+  ~temp_directory_fixture() {
+    broker::detail::remove_all(path);
+  }
+};
+
+/// Creates a data message with `n` as content.
+inline broker::node_message make_msg(std::string topic, broker::count n) {
+  return broker::node_message{
+    broker::make_data_message(std::move(topic), broker::data{n})};
+}
+
+/// @copydoc make_msg
+inline broker::node_message make_msg(broker::count n) {
+  return make_msg("foo/bar", n);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace broker {
+
+/// Selects an operation that a data store evaluates on a stored value in order
+/// to return only the result instead of the full value.
+enum class value_query : uint8_t {
+  /// Returns the number of elements in a vector, set or table or the length
+  /// of a string as `count`. Ignores the argument.
+  size,
+  /// Takes a vector of elements as argument and returns a vector with one
+  /// boolean per element that indicates whether a set contains the element, a
+  /// table contains the element as key or a vector contains the element.
+  contains,
+  /// Takes a vector `[first, last]` of indexes as argument and returns the
+  /// elements of a vector in the half-open range `[first, last)`. Clips the
+  /// range to the size of the vector.
+  slice,
+  /// Takes a `count` N as argument and returns the N entries of a table with
+  /// the largest values as vector of `[key, value]` pairs, in descending order
+  /// of their value.
+  top,
+};
+
+/// @relates value_query
+constexpr std::string_view to_string(value_query x) noexcept {
+  switch (x) {
+    case value_query::size:
+      return "size";
+    case value_query::contains:
+      return "contains";
+    case value_query::slice:
+      return "slice";
+    case value_query::top:
+      return "top";
+    default:
+      return "???";
+  }
+}
+
+/// @relates value_query
+template <class Inspector>
+bool inspect(Inspector& f, value_query& x) {
+  auto get = [&] { return static_cast<uint8_t>(x); };
+  auto set = [&](uint8_t val) {
+    if (val <= static_cast<uint8_t>(value_query::top)) {
+      x = static_cast<value_query>(val);
+      return true;
+    } else {
+      return false;
+    }
+  };
+  return f.apply(get, set);
+}
+
+} // namespace broker
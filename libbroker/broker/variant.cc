@@ -26,27 +26,19 @@ using const_byte_pointer = const std::byte*;
 
 namespace {
 
-template <class Container>
-struct container_storage {
-  broker::detail::monotonic_buffer_resource resource;
-  Container container;
-  container_storage()
-    : container(typename Container::allocator_type{&resource}) {}
-};
-
 const variant_data::set* empty_set_instance() {
-  static container_storage<variant_data::set> instance;
-  return &instance.container;
+  static const variant_data::set instance;
+  return &instance;
 }
 
 const variant_data::table* empty_table_instance() {
-  static container_storage<variant_data::table> instance;
-  return &instance.container;
+  static const variant_data::table instance;
+  return &instance;
 }
 
 const variant_data::list* empty_vector_instance() {
-  static container_storage<variant_data::list> instance;
-  return &instance.container;
+  static const variant_data::list instance;
+  return &instance;
 }
 
 } // namespace
@@ -63,28 +55,28 @@ data variant::to_data() const {
   return raw_->to_data();
 }
 
-variant_set variant::to_set() const noexcept {
+variant_set variant::to_set() const {
   using detail_t = variant_data::set*;
   if (auto ptr = std::get_if<detail_t>(&stl_value()))
     return variant_set{*ptr, envelope_};
   return variant_set{detail::empty_set_instance(), nullptr};
 }
 
-variant_table variant::to_table() const noexcept {
+variant_table variant::to_table() const {
   using detail_t = variant_data::table*;
   if (auto ptr = std::get_if<detail_t>(&stl_value()))
     return variant_table{*ptr, envelope_};
   return variant_table{detail::empty_table_instance(), nullptr};
 }
 
-variant_list variant::to_list() const noexcept {
+variant_list variant::to_list() const {
   using detail_t = variant_data::list*;
   if (auto ptr = std::get_if<detail_t>(&stl_value()))
     return variant_list{*ptr, envelope_};
   return variant_list{detail::empty_vector_instance(), nullptr};
 }
 
-variant_list variant::to_vector() const noexcept {
+variant_list variant::to_vector() const {
   return to_list();
 }
 
@@ -256,18 +256,18 @@ public:
 
   /// Returns the contained values as a @ref variant_set or an empty set if this
   /// object does not contain a set.
-  variant_set to_set() const noexcept;
+  variant_set to_set() const;
 
   /// Returns the contained values as a @ref variant_table or an empty table if
   /// this object does not contain a table.
-  variant_table to_table() const noexcept;
+  variant_table to_table() const;
 
   /// Returns the contained values as a @ref variant_list or an empty list if
   /// this object does not contain a list.
-  variant_list to_list() const noexcept;
+  variant_list to_list() const;
 
   /// Alias for @ref to_list.
-  variant_list to_vector() const noexcept;
+  variant_list to_vector() const;
 
   // -- accessors --------------------------------------------------------------
 
@@ -277,8 +277,8 @@ public:
   }
 
   /// Returns a reference to the `std::variant` stored in this object.
-  const auto& stl_value() const noexcept {
-    return raw_->value;
+  const auto& stl_value() const {
+    return raw_->stl_value();
   }
 
   /// Returns a shared pointer to the @ref envelope that owns the stored data.
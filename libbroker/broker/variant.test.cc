@@ -15,6 +15,7 @@
 #include "broker/variant_list.hh"
 #include "broker/variant_set.hh"
 #include "broker/variant_table.hh"
+#include "broker/variant_visit.hh"
 
 #include <caf/detail/append_hex.hpp>
 
@@ -396,6 +397,100 @@ TEST(deep copies) {
   CHECK_DEEP_COPY_ROUNDTRIP(vector({1, 2, 3}));
   CHECK_DEEP_COPY_ROUNDTRIP(set({1, 2, 3}));
   CHECK_DEEP_COPY_ROUNDTRIP(table({{"a", 1}, {"b", 2}, {"c", 3}}));
+  // Containers with mixed types exercise the ordering across types.
+  CHECK_DEEP_COPY_ROUNDTRIP(set({1, "a"s, 2.5, 3u, vector{1, 2}, set{}}));
+  CHECK_DEEP_COPY_ROUNDTRIP(table({{1, "a"s}, {"b"s, 2}, {vector{3}, set{4}}}));
+  CHECK_DEEP_COPY_ROUNDTRIP(vector({vector{}, set{1}, table{{2, 3}}}));
+}
+
+TEST(nested lists in envelopes decode on first access) {
+  auto value = data{vector{1, vector{2, "foo"s}, vector{set{3, 4}}}};
+  auto env = data_envelope::make("test"s, value);
+  REQUIRE(env != nullptr);
+  auto xs = env->value().to_list();
+  REQUIRE_EQ(xs.size(), 3u);
+  auto i = xs.begin();
+  CHECK_EQ(i->to_integer(), 1);
+  ++i;
+  CHECK_EQ(i->to_list().size(), 2u);
+  CHECK_EQ(i->to_data(), data{vector{2, "foo"s}});
+  ++i;
+  CHECK_EQ(i->to_data(), data{vector{set{3, 4}}});
+  CHECK_EQ(env->value().to_data(), value);
+}
+
+TEST(visitors receive views instead of copies) {
+  auto env = data_envelope::make("test"s,
+                                 data{vector{"foo"s, count{42}, vector{1, 2}}});
+  REQUIRE(env != nullptr);
+  auto xs = env->value().to_list();
+  REQUIRE_EQ(xs.size(), 3u);
+  auto kind = [](const auto& val) -> std::string {
+    using val_type = std::decay_t<decltype(val)>;
+    if constexpr (std::is_same_v<val_type, std::string_view>)
+      return "string_view";
+    else if constexpr (std::is_same_v<val_type, count>)
+      return "count";
+    else if constexpr (std::is_same_v<val_type, variant_list>)
+      return "variant_list";
+    else
+      return "other";
+  };
+  CHECK_EQ(visit(kind, xs[0]), "string_view");
+  CHECK_EQ(visit(kind, xs[1]), "count");
+  CHECK_EQ(visit(kind, xs[2]), "variant_list");
+}
+
+TEST(visit_fields extracts typed fields from lists) {
+  auto env = data_envelope::make("test"s,
+                                 data{vector{"foo"s, count{42}, vector{1, 2}}});
+  REQUIRE(env != nullptr);
+  auto xs = env->value().to_list();
+  auto called = false;
+  auto ok = visit_fields<std::string_view, count, variant_list>(
+    xs, [&called](std::string_view str, count num, const variant_list& ys) {
+      called = true;
+      CHECK_EQ(str, "foo"sv);
+      CHECK_EQ(num, 42u);
+      CHECK_EQ(ys.size(), 2u);
+    });
+  CHECK(ok);
+  CHECK(called);
+  MESSAGE("variant matches any field");
+  ok = visit_fields<variant, count, variant>(
+    xs, [](const variant& x, count, const variant& y) {
+      CHECK(x.is_string());
+      CHECK(y.is_list());
+    });
+  CHECK(ok);
+  MESSAGE("mismatched types or sizes never call the function");
+  auto fail = [](auto&&...) { FAIL("unexpected call"); };
+  CHECK(!(visit_fields<count, count, variant_list>(xs, fail)));
+  CHECK(!(visit_fields<std::string_view, count>(xs, fail)));
+}
+
+TEST(copy_to extracts homogeneous lists in bulk) {
+  auto env = data_envelope::make("test"s,
+                                 data{vector{vector{1u, 2u, 3u},
+                                             vector{"a"s, "b"s},
+                                             vector{1u, "b"s}, vector{}}});
+  REQUIRE(env != nullptr);
+  auto xs = env->value().to_list();
+  REQUIRE_EQ(xs.size(), 4u);
+  std::vector<count> counts;
+  CHECK(xs[0].to_list().all_of<count>());
+  CHECK(xs[0].to_list().copy_to(counts));
+  CHECK_EQ(counts, std::vector<count>({1, 2, 3}));
+  std::vector<std::string_view> strs;
+  CHECK(xs[1].to_list().copy_to(strs));
+  CHECK_EQ(strs, std::vector<std::string_view>({"a"sv, "b"sv}));
+  MESSAGE("lists with mixed types fail");
+  CHECK(!xs[2].to_list().all_of<count>());
+  CHECK(!xs[2].to_list().copy_to(counts));
+  MESSAGE("empty lists match any type");
+  CHECK(xs[3].to_list().all_of<count>());
+  CHECK(xs[3].to_list().copy_to(counts));
+  CHECK(counts.empty());
 }
 
 CAF_TEST_FIXTURE_SCOPE_END()
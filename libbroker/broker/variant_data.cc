@@ -7,7 +7,9 @@
 #include <caf/detail/ieee_754.hpp>
 #include <caf/detail/network_order.hpp>
 
+#include <algorithm>
 #include <cstring>
+#include <memory>
 
 namespace broker {
 
@@ -94,6 +96,25 @@ const variant_data* variant_data::nil() noexcept {
   return &nil_instance;
 }
 
+variant_data::set::const_iterator
+variant_data::set::find(const variant_data& key) const {
+  auto i = std::lower_bound(begin(), end(), key);
+  if (i != end() && !(key < *i))
+    return i;
+  return end();
+}
+
+variant_data::table::const_iterator
+variant_data::table::find(const variant_data& key) const {
+  auto i = std::lower_bound(begin(), end(), key,
+                            [](const key_value_pair& x, const variant_data& y) {
+                              return x.first < y;
+                            });
+  if (i != end() && !(key < i->first))
+    return i;
+  return end();
+}
+
 data variant_data::to_data() const {
   auto f = [](const auto& val) -> broker::data {
     using val_type = std::decay_t<decltype(val)>;
@@ -102,14 +123,17 @@ data variant_data::to_data() const {
     } else if constexpr (std::is_same_v<enum_value_view, val_type>) {
       return broker::data{enum_value{std::string{val.name}}};
     } else if constexpr (std::is_same_v<variant_data::set*, val_type>) {
+      // Note: sets and tables store their elements sorted. Hence, passing
+      //       end() as hint inserts each element in amortized constant time
+      //       instead of searching the tree for the insert position.
       broker::set result;
       for (const auto& x : *val)
-        result.emplace(x.to_data());
+        result.emplace_hint(result.end(), x.to_data());
       return broker::data{std::move(result)};
     } else if constexpr (std::is_same_v<variant_data::table*, val_type>) {
       broker::table result;
       for (const auto& [key, val] : *val)
-        result.emplace(key.to_data(), val.to_data());
+        result.emplace_hint(result.end(), key.to_data(), val.to_data());
       return broker::data{std::move(result)};
     } else if constexpr (std::is_same_v<variant_data::list*, val_type>) {
       broker::vector result;
@@ -121,7 +145,7 @@ data variant_data::to_data() const {
       return broker::data{val};
     }
   };
-  return std::visit(f, value);
+  return std::visit(f, stl_value());
 }
 
 namespace {
@@ -159,11 +183,140 @@ ptrdiff_t ssizeof() {
   return static_cast<ptrdiff_t>(sizeof(T));
 }
 
+/// Skips over a string or enum value.
+bool skip_string(const_byte_pointer& pos, const_byte_pointer end) {
+  size_t size = 0;
+  if (!format::bin::v1::read_varbyte(pos, end, size))
+    return false;
+  if (end - pos < static_cast<ptrdiff_t>(size))
+    return false;
+  pos += size;
+  return true;
+}
+
+/// Skips over a fixed-size value.
+bool skip_bytes(const_byte_pointer& pos, const_byte_pointer end, size_t n) {
+  if (end - pos < static_cast<ptrdiff_t>(n))
+    return false;
+  pos += n;
+  return true;
+}
+
+/// Validates the structure of an encoded value and advances `pos` past it
+/// without decoding. Sets `has_assoc` if the value contains a set or table.
+bool skip(const_byte_pointer& pos, const_byte_pointer end, bool& has_assoc) {
+  if (pos == end)
+    return false;
+  switch (static_cast<variant_tag>(*pos++)) {
+    case variant_tag::none:
+      return true;
+    case variant_tag::boolean:
+      return skip_bytes(pos, end, 1);
+    case variant_tag::count:
+    case variant_tag::integer:
+    case variant_tag::real:
+    case variant_tag::timestamp:
+    case variant_tag::timespan:
+      return skip_bytes(pos, end, sizeof(uint64_t));
+    case variant_tag::string:
+    case variant_tag::enum_value:
+      return skip_string(pos, end);
+    case variant_tag::address:
+      return skip_bytes(pos, end, address::num_bytes);
+    case variant_tag::subnet:
+      return skip_bytes(pos, end, address::num_bytes + 1);
+    case variant_tag::port: {
+      if (!skip_bytes(pos, end, 3))
+        return false;
+      return static_cast<uint8_t>(pos[-1]) <= 3;
+    }
+    case variant_tag::set:
+    case variant_tag::table:
+    case variant_tag::list: {
+      auto tag = static_cast<variant_tag>(pos[-1]);
+      size_t size = 0;
+      if (!format::bin::v1::read_varbyte(pos, end, size))
+        return false;
+      // Each element needs at least one byte.
+      if (size > static_cast<size_t>(end - pos))
+        return false;
+      if (tag != variant_tag::list)
+        has_assoc = true;
+      if (tag == variant_tag::table)
+        size *= 2;
+      for (size_t i = 0; i < size; ++i)
+        if (!skip(pos, end, has_assoc))
+          return false;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+/// Allocates `size` default-constructed objects in `buf`.
+template <class T>
+T* make_array(detail::monotonic_buffer_resource& buf, size_t size) {
+  if (size == 0)
+    return nullptr;
+  mbr_allocator<T> allocator{&buf};
+  auto result = allocator.allocate(size);
+  std::uninitialized_value_construct_n(result, size);
+  return result;
+}
+
+/// Sorts `[first, last)` and returns whether all elements are unique. Senders
+/// encode sets and tables in sorted order, so we usually only need to check.
+template <class T, class Less>
+bool sort_unique(T* first, T* last, Less less) {
+  auto out_of_order = [&less](const T& x, const T& y) { return !less(x, y); };
+  if (std::adjacent_find(first, last, out_of_order) == last)
+    return true;
+  std::sort(first, last, less);
+  return std::adjacent_find(first, last, out_of_order) == last;
+}
+
+/// Orders key-value pairs by their key.
+struct key_less {
+  bool operator()(const variant_data::key_value_pair& x,
+                  const variant_data::key_value_pair& y) const {
+    return x.first < y.first;
+  }
+};
+
 } // namespace
 
 std::pair<bool, const std::byte*>
 variant_data::parse_shallow(detail::monotonic_buffer_resource& buf,
                             const std::byte* pos, const std::byte* end) {
+  return parse_impl(buf, nullptr, pos, end);
+}
+
+std::pair<bool, const std::byte*>
+variant_data::parse_lazy(lazy_context& ctx, const std::byte* pos,
+                         const std::byte* end) {
+  return parse_impl(*ctx.buf, &ctx, pos, end);
+}
+
+void variant_data::materialize() const {
+  std::lock_guard<std::mutex> guard{lazy->ctx->mtx};
+  if (lazy->done.load(std::memory_order_relaxed))
+    return;
+  // The elements passed validation when creating this object. Hence, parsing
+  // cannot fail at this point.
+  auto& buf = *lazy->ctx->buf;
+  auto elements = make_array<variant_data>(buf, lazy->size);
+  auto pos = lazy->first;
+  for (size_t i = 0; i < lazy->size; ++i)
+    pos = elements[i].parse_impl(buf, lazy->ctx, pos, lazy->last).second;
+  std::get<list*>(value)->assign(elements, lazy->size);
+  lazy->done.store(true, std::memory_order_release);
+}
+
+std::pair<bool, const std::byte*>
+variant_data::parse_impl(detail::monotonic_buffer_resource& buf,
+                         lazy_context* ctx, const std::byte* pos,
+                         const std::byte* end) {
   if (pos == end)
     return {false, end};
   switch (static_cast<variant_tag>(*pos++)) {
@@ -258,63 +411,79 @@ variant_data::parse_shallow(detail::monotonic_buffer_resource& buf,
       size_t size = 0;
       if (!format::bin::v1::read_varbyte(pos, end, size))
         return {false, pos};
-      using set_allocator = mbr_allocator<variant_data>;
-      using set_type = variant_data::set;
-      mbr_allocator<set_type> allocator{&buf};
-      auto res = new (allocator.allocate(1)) set_type(set_allocator{&buf});
+      // Each element needs at least one byte.
+      if (size > static_cast<size_t>(end - pos))
+        return {false, pos};
+      // Note: sorting requires comparing the elements, so there is no point in
+      //       decoding any of them lazily.
+      auto elements = make_array<variant_data>(buf, size);
       for (size_t i = 0; i < size; ++i) {
-        auto tmp = variant_data{};
-        auto [ok, next] = tmp.parse_shallow(buf, pos, end);
+        auto [ok, next] = elements[i].parse_impl(buf, nullptr, pos, end);
         if (!ok)
           return {false, pos};
-        auto [_, added] = res->emplace(std::move(tmp));
-        if (!added)
-          return {false, pos};
         pos = next;
       }
-      value = res;
+      if (!sort_unique(elements, elements + size, less{}))
+        return {false, pos};
+      value = detail::new_instance<set>(buf, elements, size);
       return {true, pos};
     }
     case variant_tag::table: {
       size_t size = 0;
       if (!format::bin::v1::read_varbyte(pos, end, size))
         return {false, pos};
-      using table_allocator = variant_data::table_allocator;
-      using table_type = variant_data::table;
-      mbr_allocator<table_type> allocator{&buf};
-      auto res = new (allocator.allocate(1)) table_type(table_allocator{&buf});
+      // Each entry needs at least two bytes.
+      if (size > static_cast<size_t>(end - pos) / 2)
+        return {false, pos};
+      auto entries = make_array<key_value_pair>(buf, size);
       for (size_t i = 0; i < size; ++i) {
-        auto key = variant_data{};
-        if (auto [ok, next] = key.parse_shallow(buf, pos, end); ok)
+        auto& [key, val] = entries[i];
+        if (auto [ok, next] = key.parse_impl(buf, nullptr, pos, end); ok)
           pos = next;
         else
           return {false, pos};
-        auto val = variant_data{};
-        if (auto [ok, next] = val.parse_shallow(buf, pos, end); ok)
+        if (auto [ok, next] = val.parse_impl(buf, ctx, pos, end); ok)
           pos = next;
         else
           return {false, pos};
-        auto [_, added] = res->emplace(std::move(key), std::move(val));
-        if (!added)
-          return {false, pos};
       }
-      value = res;
+      if (!sort_unique(entries, entries + size, key_less{}))
+        return {false, pos};
+      value = detail::new_instance<table>(buf, entries, size);
       return {true, pos};
     }
     case variant_tag::list: {
       size_t size = 0;
       if (!format::bin::v1::read_varbyte(pos, end, size))
         return {false, pos};
-      using vec_allocator = mbr_allocator<variant_data>;
-      using vec_type = variant_data::list;
-      mbr_allocator<vec_type> allocator{&buf};
-      auto vec = new (allocator.allocate(1)) vec_type(vec_allocator{&buf});
+      // Each element needs at least one byte.
+      if (size > static_cast<size_t>(end - pos))
+        return {false, pos};
+      auto vec = detail::new_instance<list>(buf);
+      if (ctx != nullptr) {
+        // Only validate the elements for now and decode them on first access.
+        auto first = pos;
+        auto has_assoc = false;
+        for (size_t i = 0; i < size; ++i)
+          if (!skip(pos, end, has_assoc))
+            return {false, pos};
+        if (!has_assoc) {
+          mbr_allocator<lazy_state> state_allocator{&buf};
+          lazy = new (state_allocator.allocate(1))
+            lazy_state{first, pos, size, ctx, {false}};
+          value = vec;
+          return {true, pos};
+        }
+        pos = first;
+      }
+      auto elements = make_array<variant_data>(buf, size);
       for (size_t i = 0; i < size; ++i) {
-        auto [ok, next] = vec->emplace_back().parse_shallow(buf, pos, end);
+        auto [ok, next] = elements[i].parse_impl(buf, ctx, pos, end);
         if (!ok)
           return {false, pos};
         pos = next;
       }
+      vec->assign(elements, size);
       value = vec;
       return {true, pos};
     }
@@ -337,19 +506,67 @@ bool operator==(const variant_data& lhs, const variant_data& rhs) {
   return visit_if_same_type(eq_predicate{}, lhs, rhs);
 }
 
-bool operator<(const variant_data& lhs, const variant_data& rhs) {
-  if (lhs.value.index() != rhs.value.index())
-    return lhs.value.index() < rhs.value.index();
+namespace {
+
+int compare(const variant_data& lhs, const variant_data& rhs);
+
+template <class T>
+int compare_values(const T& x, const T& y) {
+  if (x < y)
+    return -1;
+  return y < x ? 1 : 0;
+}
+
+int compare_values(std::string_view x, std::string_view y) {
+  auto res = x.compare(y);
+  return res < 0 ? -1 : (res > 0 ? 1 : 0);
+}
+
+int compare_values(const variant_data& x, const variant_data& y) {
+  return compare(x, y);
+}
+
+int compare_values(const variant_data::key_value_pair& x,
+                   const variant_data::key_value_pair& y) {
+  if (auto res = compare(x.first, y.first); res != 0)
+    return res;
+  return compare(x.second, y.second);
+}
+
+// Compares two sequences lexicographically, visiting each element once.
+template <class Container>
+int compare_sequences(const Container& xs, const Container& ys) {
+  auto i = xs.begin();
+  auto j = ys.begin();
+  for (; i != xs.end() && j != ys.end(); ++i, ++j)
+    if (auto res = compare_values(*i, *j); res != 0)
+      return res;
+  if (i != xs.end())
+    return 1;
+  return j != ys.end() ? -1 : 0;
+}
+
+int compare(const variant_data& lhs, const variant_data& rhs) {
+  const auto& lval = lhs.stl_value();
+  const auto& rval = rhs.stl_value();
+  if (lval.index() != rval.index())
+    return lval.index() < rval.index() ? -1 : 1;
   return std::visit(
-    [&rhs](const auto& x) -> bool {
+    [&rval](const auto& x) -> int {
       using T = std::decay_t<decltype(x)>;
       if constexpr (std::is_pointer_v<T>) {
-        return *x < *std::get<T>(rhs.value);
+        return compare_sequences(*x, **std::get_if<T>(&rval));
       } else {
-        return x < std::get<T>(rhs.value);
+        return compare_values(x, *std::get_if<T>(&rval));
       }
     },
-    lhs.value);
+    lval);
+}
+
+} // namespace
+
+bool operator<(const variant_data& lhs, const variant_data& rhs) {
+  return compare(lhs, rhs) < 0;
 }
 
 } // namespace broker
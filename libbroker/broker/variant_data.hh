@@ -1,6 +1,7 @@
 #pragma once
 
 #include "broker/address.hh"
+#include "broker/detail/flat_array.hh"
 #include "broker/detail/monotonic_buffer_resource.hh"
 #include "broker/enum_value.hh"
 #include "broker/fwd.hh"
@@ -10,9 +11,10 @@
 
 #include "broker/detail/type_traits.hh"
 
-#include <list>
-#include <map>
-#include <set>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <variant>
 
 namespace broker {
 
@@ -40,19 +42,33 @@ public:
   template <class T>
   using allocator_t = detail::monotonic_buffer_resource::allocator<T>;
 
-  using list = std::list<variant_data, allocator_t<variant_data>>;
+  /// A sequence of values in contiguous storage.
+  using list = detail::flat_array<variant_data>;
 
   using list_iterator = list::const_iterator;
 
-  using set = std::set<variant_data, less, allocator_t<variant_data>>;
+  /// A set of unique values, stored as a sorted array.
+  class set : public detail::flat_array<variant_data> {
+  public:
+    using flat_array::flat_array;
+
+    /// Returns an iterator to the element that is equal to `key` or `end()`.
+    const_iterator find(const variant_data& key) const;
+  };
 
   using set_iterator = set::const_iterator;
 
-  using key_value_pair = std::pair<const variant_data, variant_data>;
+  using key_value_pair = std::pair<variant_data, variant_data>;
 
-  using table_allocator = allocator_t<key_value_pair>;
+  /// A map with unique keys, stored as an array of key-value pairs that is
+  /// sorted by key.
+  class table : public detail::flat_array<key_value_pair> {
+  public:
+    using flat_array::flat_array;
 
-  using table = std::map<variant_data, variant_data, less, table_allocator>;
+    /// Returns an iterator to the entry for `key` or `end()`.
+    const_iterator find(const variant_data& key) const;
+  };
 
   using table_iterator = table::const_iterator;
 
@@ -61,6 +77,38 @@ public:
                  subnet, port, timestamp, timespan, enum_value_view, set*,
                  table*, list*>;
 
+  /// Shared state for decoding lists on demand. The owner of the memory
+  /// resource also owns the context.
+  struct lazy_context {
+    explicit lazy_context(detail::monotonic_buffer_resource* buf) : buf(buf) {
+      // nop
+    }
+
+    /// Provides memory for decoded elements.
+    detail::monotonic_buffer_resource* buf;
+
+    /// Serializes decoding, since the memory resource is not thread-safe.
+    std::mutex mtx;
+  };
+
+  /// Refers to the encoded elements of a list that has not been decoded yet.
+  struct lazy_state {
+    /// Points to the first encoded element.
+    const std::byte* first;
+
+    /// Points one past the last encoded element.
+    const std::byte* last;
+
+    /// Stores the number of elements.
+    size_t size;
+
+    /// Points to the shared context for decoding.
+    lazy_context* ctx;
+
+    /// Stores whether the elements are available in the list.
+    std::atomic<bool> done;
+  };
+
   // -- static factories -------------------------------------------------------
 
   /// Singleton for empty data.
@@ -78,8 +126,12 @@ public:
   /// Converts this object to a @ref broker::data object. Performs a deep copy.
   data to_data() const;
 
-  /// Returns a reference to the `std::variant` stored in this object.
-  const auto& stl_value() const noexcept {
+  /// Returns a reference to the `std::variant` stored in this object. Decodes
+  /// the elements of a lazy list on first access.
+  /// @throws std::bad_alloc if decoding a lazy list runs out of memory.
+  const auto& stl_value() const {
+    if (lazy != nullptr && !lazy->done.load(std::memory_order_acquire))
+      materialize();
     return value;
   }
 
@@ -95,9 +147,29 @@ public:
     return parse_shallow(buf, bytes, bytes + num_bytes);
   }
 
+  /// Like `parse_shallow`, but only validates lists instead of decoding their
+  /// elements right away. Lists decode their elements on first access via
+  /// `stl_value`, using the memory resource of `ctx`. Lists that contain sets
+  /// or tables are always decoded immediately, because checking the elements
+  /// of sets and tables for uniqueness requires decoding them.
+  /// @pre `ctx` and the memory it refers to outlive this object.
+  std::pair<bool, const std::byte*> parse_lazy(lazy_context& ctx,
+                                               const std::byte* pos,
+                                               const std::byte* end);
+
   // -- member variables -------------------------------------------------------
 
   stl_type value;
+
+  /// Non-null if this object holds a lazy list.
+  lazy_state* lazy = nullptr;
+
+private:
+  std::pair<bool, const std::byte*>
+  parse_impl(detail::monotonic_buffer_resource& buf, lazy_context* ctx,
+             const std::byte* pos, const std::byte* end);
+
+  void materialize() const;
 };
 
 // -- free functions -----------------------------------------------------------
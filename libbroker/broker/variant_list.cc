@@ -8,8 +8,7 @@ namespace broker {
 
 data variant_list::to_data() const {
   vector items;
-  for (auto&& x : *this)
-    items.emplace_back(x.to_data());
+  convert(*this, items);
   return data{std::move(items)};
 }
 
@@ -44,7 +43,9 @@ void convert(const variant_list& what, vector& out) {
   if (what.empty())
     return;
   out.reserve(what.size());
-  for (const auto& x : what)
+  // Note: iterating the raw values skips the reference counting for the
+  //       envelope that the iterators of the list perform on each access.
+  for (const auto& x : *what.raw())
     out.emplace_back(x.to_data());
 }
 
@@ -5,7 +5,10 @@
 #include "broker/variant.hh"
 #include "broker/variant_data.hh"
 
+#include <algorithm>
 #include <iterator>
+#include <variant>
+#include <vector>
 
 namespace broker {
 
@@ -149,6 +152,42 @@ public:
     return result;
   }
 
+  // -- bulk access ------------------------------------------------------------
+
+  /// Checks whether all elements of the list have type `T`, i.e., one of the
+  /// types of `variant_data::stl_type` such as `count` or `std::string_view`.
+  /// Returns `true` for empty lists.
+  template <class T>
+  bool all_of() const {
+    if (values_ == nullptr)
+      return true;
+    return std::all_of(values_->begin(), values_->end(), [](const auto& x) {
+      return std::holds_alternative<T>(x.stl_value());
+    });
+  }
+
+  /// Copies all elements to `out` if all elements have type `T`. Unlike
+  /// iterating the list, this accesses the elements directly instead of
+  /// creating a @ref variant for each element.
+  /// @returns `false` if the list contains an element with a different type.
+  ///          In this case, the content of `out` is unspecified.
+  /// @note the values of `std::string_view` and `enum_value_view` elements
+  ///       remain valid only as long as the list or its envelope exists.
+  template <class T>
+  bool copy_to(std::vector<T>& out) const {
+    out.clear();
+    if (values_ == nullptr)
+      return true;
+    out.reserve(values_->size());
+    for (const auto& x : *values_) {
+      auto* val = std::get_if<T>(&x.stl_value());
+      if (val == nullptr)
+        return false;
+      out.push_back(*val);
+    }
+    return true;
+  }
+
   // -- properties -------------------------------------------------------------
 
   /// Returns a raw pointer to the managed object.
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "broker/data.hh"
+#include "broker/detail/type_traits.hh"
+#include "broker/variant.hh"
+#include "broker/variant_list.hh"
+#include "broker/variant_set.hh"
+#include "broker/variant_table.hh"
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace broker {
+
+/// Calls `f` with the value of `x`. Unlike converting `x` to @ref data first,
+/// this never copies strings or containers: `f` receives strings as
+/// `std::string_view`, enum values as @ref enum_value_view and containers as
+/// @ref variant_set, @ref variant_table or @ref variant_list.
+template <class Visitor>
+decltype(auto) visit(Visitor&& f, const variant& x) {
+  return std::visit(
+    [&f, &x](auto val) -> decltype(auto) {
+      using val_type = decltype(val);
+      if constexpr (std::is_same_v<val_type, variant_data::set*>)
+        return f(x.to_set());
+      else if constexpr (std::is_same_v<val_type, variant_data::table*>)
+        return f(x.to_table());
+      else if constexpr (std::is_same_v<val_type, variant_data::list*>)
+        return f(x.to_list());
+      else
+        return f(val);
+    },
+    x.stl_value());
+}
+
+namespace detail {
+
+/// Evaluates to `true` if `T` is either @ref variant or one of the types that
+/// @ref visit passes to its visitor.
+template <class T>
+inline constexpr bool is_view_type_v =
+  std::is_same_v<T, variant>
+  || is_one_of_v<T, none, boolean, count, integer, real, std::string_view,
+                 address, subnet, port, timestamp, timespan, enum_value_view,
+                 variant_set, variant_table, variant_list>;
+
+} // namespace detail
+
+/// Checks whether `x` holds a value of type `T`. Always returns `true` if `T`
+/// is @ref variant.
+template <class T>
+bool holds_view(const variant& x) noexcept {
+  static_assert(detail::is_view_type_v<T>,
+                "T is neither a variant nor a view type");
+  if constexpr (std::is_same_v<T, variant>)
+    return true;
+  else
+    return x.get_tag() == detail::data_tag_oracle<T>::value;
+}
+
+/// Retrieves the value of `x` as `T`, where `T` is either @ref variant or one
+/// of the types that @ref visit passes to its visitor.
+/// @pre `holds_view<T>(x)`
+template <class T>
+T get_view(const variant& x) {
+  static_assert(detail::is_view_type_v<T>,
+                "T is neither a variant nor a view type");
+  if constexpr (std::is_same_v<T, variant>) {
+    return x;
+  } else if constexpr (std::is_same_v<T, variant_set>) {
+    return x.to_set();
+  } else if constexpr (std::is_same_v<T, variant_table>) {
+    return x.to_table();
+  } else if constexpr (std::is_same_v<T, variant_list>) {
+    return x.to_list();
+  } else {
+    return *std::get_if<T>(&x.stl_value());
+  }
+}
+
+namespace detail {
+
+template <class... Ts, class F, size_t... Is>
+bool visit_fields_impl(const std::array<variant, sizeof...(Ts)>& xs, F& f,
+                       std::index_sequence<Is...>) {
+  if (!(holds_view<Ts>(xs[Is]) && ...))
+    return false;
+  f(get_view<Ts>(xs[Is])...);
+  return true;
+}
+
+} // namespace detail
+
+/// Calls `f` with the elements of `xs` if `xs` has exactly one element per
+/// type in `Ts` and each element has the type at the same position. A type of
+/// @ref variant in `Ts` matches any element. Allows consumers to extract the
+/// fields of an event without converting it to @ref data, e.g.:
+///
+/// ~~~
+/// visit_fields<std::string_view, count>(get_data(msg).to_list(),
+///                                       [](std::string_view name, count n) {
+///                                         // ...
+///                                       });
+/// ~~~
+///
+/// @returns `true` if `f` was called, `false` otherwise.
+template <class... Ts, class F>
+bool visit_fields(const variant_list& xs, F&& f) {
+  if (xs.size() != sizeof...(Ts))
+    return false;
+  return detail::visit_fields_impl<Ts...>(xs.take<sizeof...(Ts)>(), f,
+                                          std::index_sequence_for<Ts...>{});
+}
+
+} // namespace broker
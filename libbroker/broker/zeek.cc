@@ -1,13 +1,143 @@
 #include "broker/zeek.hh"
 
+#include "broker/format/bin.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
 namespace broker::zeek {
 
+namespace {
+
+/// Appends `value` in varbyte encoding to `out`.
+void append_varbyte(std::string& out, uint64_t value) {
+  while (value > 0x7f) {
+    out += static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  out += static_cast<char>(value);
+}
+
+/// Reads a varbyte-encoded value from `[first, last)`.
+bool read_varbyte(const char*& first, const char* last, uint64_t& result) {
+  result = 0;
+  for (int shift = 0; first != last && shift < 64; shift += 7) {
+    auto byte = static_cast<uint8_t>(*first++);
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+/// Maps signed integers to unsigned integers such that values with a small
+/// magnitude have a short varbyte encoding.
+uint64_t zigzag_encode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1)
+         ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t zigzag_decode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/// Calls `f` for each of the `n` varbyte-encoded values in `codes`, stopping
+/// at the first call that returns `false`.
+/// @returns `true` if `codes` contains exactly `n` values and `f` never
+///          returned `false`.
+template <class F>
+bool for_each_code(std::string_view codes, size_t n, F&& f) {
+  auto first = codes.data();
+  auto last = first + codes.size();
+  for (size_t i = 0; i < n; ++i) {
+    uint64_t code = 0;
+    if (!read_varbyte(first, last, code) || !f(code))
+      return false;
+  }
+  return first == last;
+}
+
+/// Copies the elements of `xs` to a vector for random access.
+std::vector<variant> to_vector(const variant_list& xs) {
+  std::vector<variant> result;
+  result.reserve(xs.size());
+  for (auto&& x : xs)
+    result.emplace_back(x);
+  return result;
+}
+
+/// Checks whether `x` is a valid column with string values.
+bool is_string_column(const Column& x) {
+  return x.valid() && (x.value_type() == variant_tag::string || x.empty());
+}
+
+/// Reads fields of a Zeek message from its binary encoding.
+class header_reader {
+public:
+  header_reader(const std::byte* bytes, size_t size)
+    : pos_(bytes), end_(bytes + size) {
+    // nop
+  }
+
+  /// Reads the tag of the next value and checks whether it is `tag`.
+  bool read_tag(variant_tag tag) {
+    if (pos_ == end_ || static_cast<variant_tag>(*pos_) != tag)
+      return false;
+    ++pos_;
+    return true;
+  }
+
+  /// Reads the tag and size of a list.
+  bool read_list(size_t& size) {
+    return read_tag(variant_tag::list)
+           && format::bin::v1::read_varbyte(pos_, end_, size);
+  }
+
+  bool read_count(count& result) {
+    if (!read_tag(variant_tag::count) || end_ - pos_ < 8)
+      return false;
+    uint64_t tmp = 0;
+    memcpy(&tmp, pos_, sizeof(tmp));
+    pos_ += sizeof(tmp);
+    result = format::bin::v1::from_network_order(tmp);
+    return true;
+  }
+
+  /// Reads a string or enum value, which share the same encoding.
+  bool read_name(variant_tag tag, std::string_view& result) {
+    size_t len = 0;
+    if (!read_tag(tag) || !format::bin::v1::read_varbyte(pos_, end_, len)
+        || static_cast<size_t>(end_ - pos_) < len)
+      return false;
+    result = std::string_view{reinterpret_cast<const char*>(pos_), len};
+    pos_ += len;
+    return true;
+  }
+
+private:
+  const std::byte* pos_;
+  const std::byte* end_;
+};
+
+} // namespace
+
 Message::~Message() {}
 
 void Message::init(Type sub_type, const list_builder& content) {
-  data_ = list_builder{}
+  // The outer list has a fixed layout. Hence, we can compute its size up front
+  // and copy `content` into the final buffer without re-allocating.
+  using detail::builder_access;
+  auto type_field = static_cast<count>(sub_type);
+  list_builder outer;
+  outer.reserve(builder_access::size_hint(ProtocolVersion)
+                + builder_access::size_hint(type_field)
+                + builder_access::size_hint(content));
+  data_ = std::move(outer)
             .add(ProtocolVersion)
-            .add(static_cast<count>(sub_type))
+            .add(type_field)
             .add(content)
             .build();
 }
@@ -46,6 +176,14 @@ Batch::Batch(variant elements) : Message(std::move(elements)) {
         if (!append(zeek::Batch{item}))
           return;
         break;
+      case Message::Type::LogWriteBatch:
+        if (!append(zeek::LogWriteBatch{item}))
+          return;
+        break;
+      case Message::Type::CompactEvent:
+        if (!append(zeek::CompactEvent{item}))
+          return;
+        break;
       default:
         return;
     }
@@ -63,4 +201,389 @@ Batch BatchBuilder::build() {
   return result;
 }
 
+Batch BatchBuilder::build_transparent() {
+  auto result = Batch{list_builder{}
+                        .add(ProtocolVersion)
+                        .add(static_cast<count>(Message::Type::Batch))
+                        .add(inner_)
+                        .add(true)
+                        .build()};
+  inner_.reset();
+  return result;
+}
+
+std::optional<LogWriteBatch> BatchBuilder::build_log_writes() {
+  if (inner_.empty())
+    return std::nullopt;
+  auto items = list_builder{inner_};
+  std::optional<enum_value> stream_id;
+  std::optional<enum_value> writer_id;
+  ColumnBuilder paths;
+  ColumnBuilder serial_data;
+  for (auto&& item : std::move(items).build().to_list()) {
+    LogWrite msg{item};
+    if (!msg.valid())
+      return std::nullopt;
+    if (!stream_id) {
+      stream_id = enum_value{std::string{msg.stream_id().name}};
+      writer_id = enum_value{std::string{msg.writer_id().name}};
+    } else if (msg.stream_id() != *stream_id
+               || msg.writer_id() != *writer_id) {
+      return std::nullopt;
+    }
+    paths.add(std::string{msg.path_str()});
+    serial_data.add(std::string{msg.serial_data_str()});
+  }
+  inner_.reset();
+  return LogWriteBatch{*stream_id, *writer_id, paths.build(),
+                       serial_data.build()};
+}
+
+bool Column::valid() const {
+  if (!data_.is_list())
+    return false;
+  auto&& fields = data_.to_list();
+  if (fields.size() < min_fields)
+    return false;
+  auto [enc, tag, num, values] = fields.take<min_fields>();
+  if (!enc.is_count() || !tag.is_count() || !num.is_count()
+      || tag.to_count() > static_cast<count>(variant_tag::list))
+    return false;
+  auto n = num.to_count();
+  auto type = static_cast<variant_tag>(tag.to_count());
+  auto all_have_type = [type](const variant_list& xs) {
+    if (type == variant_tag::none)
+      return true;
+    for (auto&& x : xs)
+      if (x.get_tag() != type)
+        return false;
+    return true;
+  };
+  auto codes = fields.at(codes_index);
+  switch (enc.to_count()) {
+    case Plain: {
+      if (!values.is_list())
+        return false;
+      auto&& xs = values.to_list();
+      return xs.size() == n && all_have_type(xs);
+    }
+    case Dictionary: {
+      if (!values.is_list() || !codes.is_string())
+        return false;
+      auto&& dict = values.to_list();
+      return all_have_type(dict)
+             && for_each_code(codes.to_string(), n,
+                              [m = dict.size()](uint64_t x) { return x < m; });
+    }
+    case Delta: {
+      if (type != variant_tag::timestamp || !values.is_timestamp()
+          || !codes.is_string())
+        return false;
+      return for_each_code(codes.to_string(), n > 0 ? n - 1 : 0,
+                           [](uint64_t) { return true; });
+    }
+    default:
+      return false;
+  }
+}
+
+std::vector<data> Column::decode() const {
+  std::vector<data> result;
+  auto n = size();
+  result.reserve(n);
+  switch (encoding()) {
+    case Plain:
+      for (auto&& x : field(values_index).to_list())
+        result.emplace_back(x.to_data());
+      break;
+    case Dictionary: {
+      auto dict = to_vector(field(values_index).to_list());
+      for_each_code(field(codes_index).to_string(), n, [&](uint64_t x) {
+        result.emplace_back(dict[x].to_data());
+        return true;
+      });
+      break;
+    }
+    case Delta: {
+      if (n == 0)
+        break;
+      auto ts = field(values_index).to_timestamp();
+      result.emplace_back(ts);
+      for_each_code(field(codes_index).to_string(), n - 1, [&](uint64_t x) {
+        ts += timespan{zigzag_decode(x)};
+        result.emplace_back(ts);
+        return true;
+      });
+      break;
+    }
+  }
+  return result;
+}
+
+std::vector<std::string_view> Column::strings() const {
+  std::vector<std::string_view> result;
+  auto n = size();
+  result.reserve(n);
+  if (encoding() == Dictionary) {
+    auto dict = to_vector(field(values_index).to_list());
+    for_each_code(field(codes_index).to_string(), n, [&](uint64_t x) {
+      result.emplace_back(dict[x].to_string());
+      return true;
+    });
+  } else {
+    for (auto&& x : field(values_index).to_list())
+      result.emplace_back(x.to_string());
+  }
+  return result;
+}
+
+Column ColumnBuilder::build() {
+  auto values = std::move(values_);
+  values_.clear();
+  auto type = variant_tag::none;
+  if (!values.empty()) {
+    type = values.front().get_tag();
+    auto same_type = [type](const data& x) { return x.get_tag() == type; };
+    if (!std::all_of(values.begin(), values.end(), same_type))
+      type = variant_tag::none;
+  }
+  auto header = [&values, type](Column::Encoding encoding) {
+    return list_builder{}
+      .add(static_cast<count>(encoding))
+      .add(static_cast<count>(type))
+      .add(static_cast<count>(values.size()));
+  };
+  switch (type) {
+    case variant_tag::string:
+    case variant_tag::address:
+    case variant_tag::enum_value: {
+      std::unordered_map<data, count> positions;
+      list_builder dict;
+      std::string codes;
+      for (const auto& x : values) {
+        auto [i, added] = positions.emplace(x, positions.size());
+        if (added)
+          dict.add(x);
+        append_varbyte(codes, i->second);
+      }
+      // Only pay for the indirection if the column contains duplicates.
+      if (positions.size() < values.size())
+        return Column{header(Column::Dictionary).add(dict).add(codes).build()};
+      break;
+    }
+    case variant_tag::timestamp: {
+      auto first = get<timestamp>(values.front());
+      auto prev = first;
+      std::string codes;
+      for (size_t i = 1; i < values.size(); ++i) {
+        auto ts = get<timestamp>(values[i]);
+        append_varbyte(codes, zigzag_encode((ts - prev).count()));
+        prev = ts;
+      }
+      return Column{header(Column::Delta).add(first).add(codes).build()};
+    }
+    default:
+      break;
+  }
+  list_builder xs;
+  for (const auto& x : values)
+    xs.add(x);
+  return Column{header(Column::Plain).add(xs).build()};
+}
+
+bool LogWriteBatch::valid() const {
+  if (!validate_outer_fields(Type::LogWriteBatch))
+    return false;
+  auto&& fields = sub_fields();
+  if (fields.size() < min_fields || !fields[stream_id_index].is_enum_value()
+      || !fields[writer_id_index].is_enum_value())
+    return false;
+  auto paths = Column{fields[path_index]};
+  auto serial_data = Column{fields[serial_data_index]};
+  return is_string_column(paths) && is_string_column(serial_data)
+         && paths.size() == serial_data.size();
+}
+
+std::vector<zeek::LogWrite> LogWriteBatch::unpack() const {
+  auto stream = enum_value{std::string{stream_id().name}};
+  auto writer = enum_value{std::string{writer_id().name}};
+  auto path_strs = paths().strings();
+  auto serial_strs = serial_data().strings();
+  std::vector<zeek::LogWrite> result;
+  result.reserve(path_strs.size());
+  for (size_t i = 0; i < path_strs.size(); ++i)
+    result.emplace_back(stream, writer, path_strs[i], serial_strs[i]);
+  return result;
+}
+
+bool EventSchema::matches(const variant_list& args) const {
+  if (args.size() != signature.size())
+    return false;
+  auto tag = signature.begin();
+  for (const auto& arg : args) {
+    if (*tag != variant_tag::none && arg.get_tag() != *tag)
+      return false;
+    ++tag;
+  }
+  return true;
+}
+
+std::optional<count> EventRegistry::add(std::string name,
+                                        std::vector<variant_tag> signature) {
+  if (auto id = id_of(name)) {
+    if (schemas_[*id].signature != signature)
+      return std::nullopt;
+    return id;
+  }
+  auto id = static_cast<count>(schemas_.size());
+  auto& schema = schemas_.emplace_back(
+    EventSchema{std::move(name), std::move(signature)});
+  ids_.emplace(schema.name, id);
+  return id;
+}
+
+std::optional<count> EventRegistry::id_of(std::string_view name) const {
+  if (auto i = ids_.find(name); i != ids_.end())
+    return i->second;
+  return std::nullopt;
+}
+
+std::optional<CompactEvent> EventRegistry::compact(const Event& ev) const {
+  auto id = id_of(ev.name());
+  if (!id)
+    return std::nullopt;
+  auto args = ev.args();
+  if (!schemas_[*id].matches(args))
+    return std::nullopt;
+  if (auto meta = ev.metadata(); !meta.empty())
+    return CompactEvent{*id, args, meta.raw()};
+  return CompactEvent{*id, args};
+}
+
+const EventSchema* EventRegistry::resolve(const CompactEvent& ev) const {
+  if (auto* schema = find(ev.id()); schema && schema->matches(ev.args()))
+    return schema;
+  return nullptr;
+}
+
+std::optional<Event> EventRegistry::expand(const CompactEvent& ev) const {
+  auto* schema = resolve(ev);
+  if (!schema)
+    return std::nullopt;
+  list_builder content;
+  content.add(schema->name).add(ev.args());
+  if (auto meta = ev.metadata(); !meta.empty())
+    content.add(meta.raw());
+  return Event{list_builder{}
+                 .add(ProtocolVersion)
+                 .add(static_cast<count>(Message::Type::Event))
+                 .add(content)
+                 .build()};
+}
+
+data EventRegistry::to_data() const {
+  vector result;
+  result.reserve(schemas_.size());
+  for (const auto& schema : schemas_) {
+    vector tags;
+    tags.reserve(schema.signature.size());
+    for (auto tag : schema.signature)
+      tags.emplace_back(static_cast<count>(tag));
+    result.emplace_back(vector{data{schema.name}, data{std::move(tags)}});
+  }
+  return data{std::move(result)};
+}
+
+std::optional<EventRegistry> EventRegistry::from_data(const variant& x) {
+  if (!x.is_list())
+    return std::nullopt;
+  EventRegistry result;
+  for (const auto& entry : x.to_list()) {
+    auto&& fields = entry.to_list();
+    if (fields.size() != 2 || !fields.at(0).is_string()
+        || !fields.at(1).is_list())
+      return std::nullopt;
+    std::vector<variant_tag> signature;
+    for (const auto& tag : fields.at(1).to_list()) {
+      if (!tag.is_count()
+          || tag.to_count() > static_cast<count>(variant_tag::list))
+        return std::nullopt;
+      signature.push_back(static_cast<variant_tag>(tag.to_count()));
+    }
+    // Duplicate names would shift the IDs of all following entries.
+    auto name = fields.at(0).to_string();
+    if (result.id_of(name))
+      return std::nullopt;
+    result.add(std::string{name}, std::move(signature));
+  }
+  return result;
+}
+
+MessageHeader peek_header(const std::byte* bytes, size_t size) {
+  header_reader in{bytes, size};
+  size_t num_fields = 0;
+  count version = 0;
+  count tag = 0;
+  size_t num_sub_fields = 0;
+  if (!in.read_list(num_fields)
+      || num_fields < Message::num_top_level_fields || !in.read_count(version)
+      || version != ProtocolVersion || !in.read_count(tag)
+      || tag == Message::Type::Invalid || tag > Message::max_tag
+      || !in.read_list(num_sub_fields))
+    return {};
+  MessageHeader result;
+  auto type = static_cast<Message::Type>(tag);
+  switch (type) {
+    case Message::Type::Event:
+    case Message::Type::IdentifierUpdate:
+      if (num_sub_fields < 2 || !in.read_name(variant_tag::string, result.name))
+        return {};
+      break;
+    case Message::Type::LogCreate:
+    case Message::Type::LogWrite:
+    case Message::Type::LogWriteBatch:
+      if (num_sub_fields < 1
+          || !in.read_name(variant_tag::enum_value, result.name))
+        return {};
+      break;
+    default:
+      break;
+  }
+  result.type = type;
+  return result;
+}
+
+MessageHeader peek_header(const data_message& msg) {
+  if (auto [bytes, size] = msg->raw_bytes(); bytes != nullptr)
+    return peek_header(bytes, size);
+  // Messages that wrap a view into another message have no bytes of their
+  // own. Hence, we need to look at the decoded value.
+  auto&& outer = get_data(msg).to_list();
+  auto type = Message::type(msg);
+  if (type == Message::Type::Invalid
+      || outer.at(Message::version_index).to_count() != ProtocolVersion)
+    return {};
+  auto first = outer.at(Message::content_index).to_list().at(0);
+  MessageHeader result;
+  switch (type) {
+    case Message::Type::Event:
+    case Message::Type::IdentifierUpdate:
+      if (!first.is_string())
+        return {};
+      result.name = first.to_string();
+      break;
+    case Message::Type::LogCreate:
+    case Message::Type::LogWrite:
+    case Message::Type::LogWriteBatch:
+      if (!first.is_enum_value())
+        return {};
+      result.name = first.to_enum_value().name;
+      break;
+    default:
+      break;
+  }
+  result.type = type;
+  return result;
+}
+
 } // namespace broker::zeek
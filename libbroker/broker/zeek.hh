@@ -1,8 +1,13 @@
 #pragma once
 
 #include <cstddef>
+#include <deque>
 #include <iterator>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "broker/builder.hh"
 #include "broker/data.hh"
@@ -10,6 +15,7 @@
 #include "broker/message.hh"
 #include "broker/variant.hh"
 #include "broker/variant_list.hh"
+#include "broker/variant_tag.hh"
 
 namespace broker::zeek {
 
@@ -51,7 +57,9 @@ public:
     LogWrite = 3,
     IdentifierUpdate = 4,
     Batch = 5,
-    MAX = Batch,
+    LogWriteBatch = 6,
+    CompactEvent = 7,
+    MAX = CompactEvent,
   };
 
   static constexpr auto max_tag = static_cast<count>(Type::MAX);
@@ -509,9 +517,312 @@ public:
   }
 };
 
+/// A Zeek event that refers to its name by an ID from an @ref EventRegistry.
+/// Senders and receivers must agree on the registry.
+class CompactEvent : public Message {
+public:
+  /// The index of the event ID field.
+  static constexpr size_t id_index = 0;
+
+  /// The index of the event arguments field.
+  static constexpr size_t args_index = 1;
+
+  /// The index of the optional metadata field. Same layout as for events.
+  static constexpr size_t metadata_index = 2;
+
+  /// The minimum number of fields in a valid compact event.
+  static constexpr size_t min_fields = 2;
+
+  template <class Args>
+  CompactEvent(count id, const Args& args) {
+    init(Type::CompactEvent, list_builder{}.add(id).add(args));
+  }
+
+  template <class Args, class Meta>
+  CompactEvent(count id, const Args& args, const Meta& meta) {
+    init(Type::CompactEvent, list_builder{}.add(id).add(args).add(meta));
+  }
+
+  explicit CompactEvent(variant msg) : Message(std::move(msg)) {}
+
+  explicit CompactEvent(const data_message& msg)
+    : Message(broker::get_data(msg)) {}
+
+  count id() const {
+    auto&& fields = sub_fields();
+    return fields[id_index].to_count();
+  }
+
+  variant_list args() const {
+    auto&& fields = sub_fields();
+    return fields[args_index].to_list();
+  }
+
+  MetadataWrapper metadata() const {
+    auto&& fields = sub_fields();
+    if (fields.size() > metadata_index)
+      return MetadataWrapper{fields[metadata_index].to_list()};
+    return MetadataWrapper{};
+  }
+
+  bool valid() const {
+    if (!validate_outer_fields(Type::CompactEvent))
+      return false;
+
+    auto&& fields = sub_fields();
+    return fields.size() >= min_fields && fields[id_index].is_count()
+           && fields[args_index].is_list();
+  }
+};
+
+/// Describes an event with a fixed argument signature.
+struct EventSchema {
+  /// The name of the event.
+  std::string name;
+
+  /// The types of the arguments. A `none` entry accepts any type.
+  std::vector<variant_tag> signature;
+
+  /// Checks whether `args` matches the signature.
+  bool matches(const variant_list& args) const;
+};
+
+/// Maps event names to small IDs for sending events as @ref CompactEvent.
+/// Peers that exchange a small set of events at high rates agree on one
+/// registry per link, e.g., by sending the output of `to_data` to the peer.
+/// Receivers then dispatch compact events with a single array lookup instead
+/// of comparing event names.
+class EventRegistry {
+public:
+  /// Registers a schema for `name`.
+  /// @returns the ID for `name` or `std::nullopt` if the registry already
+  ///          contains a schema for `name` with a different signature.
+  std::optional<count> add(std::string name,
+                           std::vector<variant_tag> signature);
+
+  /// Returns the schema for `id` or `nullptr` if `id` is unknown.
+  const EventSchema* find(count id) const noexcept {
+    return id < schemas_.size() ? &schemas_[id] : nullptr;
+  }
+
+  /// Returns the ID for `name` if the registry contains a schema for it.
+  std::optional<count> id_of(std::string_view name) const;
+
+  size_t size() const noexcept {
+    return schemas_.size();
+  }
+
+  bool empty() const noexcept {
+    return schemas_.empty();
+  }
+
+  /// Converts `ev` to a compact event. Keeps the metadata of `ev`.
+  /// @returns the compact event or `std::nullopt` if the registry has no
+  ///          schema for the event or if the arguments do not match it.
+  std::optional<CompactEvent> compact(const Event& ev) const;
+
+  /// Returns the schema for `ev` or `nullptr` if the registry has no schema
+  /// for the ID of `ev` or if the arguments do not match the schema.
+  const EventSchema* resolve(const CompactEvent& ev) const;
+
+  /// Converts `ev` back to a regular event.
+  std::optional<Event> expand(const CompactEvent& ev) const;
+
+  /// Serializes all schemas as a list of `[name, [tag...]]` entries, ordered
+  /// by ID.
+  data to_data() const;
+
+  /// Restores a registry from the output of `to_data`.
+  static std::optional<EventRegistry> from_data(const variant& x);
+
+private:
+  /// Stores the schemas, indexed by ID. We use a deque, because `ids_` refers
+  /// to the names and a deque never relocates its elements when growing.
+  std::deque<EventSchema> schemas_;
+
+  std::unordered_map<std::string_view, count> ids_;
+};
+
+/// A column of a columnar message. All values in a column share the same type
+/// and the encoding depends on that type: strings, enum values and addresses
+/// use dictionary encoding if the column contains duplicates, timestamps use
+/// delta encoding and all other types use plain encoding.
+class Column {
+public:
+  enum Encoding {
+    Plain = 0,
+    Dictionary = 1,
+    Delta = 2,
+  };
+
+  /// The index of the encoding field.
+  static constexpr size_t encoding_index = 0;
+
+  /// The index of the type field. Stores the @ref variant_tag of all values
+  /// or `none` for columns with values of different types.
+  static constexpr size_t type_index = 1;
+
+  /// The index of the size field.
+  static constexpr size_t size_index = 2;
+
+  /// The index of the values field. Stores all values for plain encoding,
+  /// the distinct values for dictionary encoding and the first value for
+  /// delta encoding.
+  static constexpr size_t values_index = 3;
+
+  /// The index of the codes field, a string with varbyte-encoded positions in
+  /// the dictionary (dictionary encoding) or zigzag-encoded differences to the
+  /// previous timestamp in nanoseconds (delta encoding).
+  static constexpr size_t codes_index = 4;
+
+  /// The minimum number of fields in a valid column.
+  static constexpr size_t min_fields = 4;
+
+  Column() = default;
+
+  explicit Column(variant x) : data_(std::move(x)) {}
+
+  Encoding encoding() const {
+    return static_cast<Encoding>(field(encoding_index).to_count());
+  }
+
+  variant_tag value_type() const {
+    return static_cast<variant_tag>(field(type_index).to_count());
+  }
+
+  size_t size() const {
+    return field(size_index).to_count();
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  /// Decodes all values of the column.
+  /// @pre `valid()`
+  std::vector<data> decode() const;
+
+  /// Decodes all values of a string column without copying the strings. The
+  /// views remain valid as long as the column or its message exists.
+  /// @pre `valid() && value_type() == variant_tag::string`
+  std::vector<std::string_view> strings() const;
+
+  /// Returns the underlying data as-is.
+  const variant& raw() const noexcept {
+    return data_;
+  }
+
+  bool valid() const;
+
+private:
+  variant field(size_t index) const {
+    return data_.to_list().at(index);
+  }
+
+  variant data_;
+};
+
+/// Builds a @ref Column by selecting the most compact encoding for the values.
+class ColumnBuilder {
+public:
+  void add(data value) {
+    values_.emplace_back(std::move(value));
+  }
+
+  size_t size() const noexcept {
+    return values_.size();
+  }
+
+  bool empty() const noexcept {
+    return values_.empty();
+  }
+
+  /// Encodes all values and resets the builder.
+  Column build();
+
+private:
+  std::vector<data> values_;
+};
+
+/// A columnar batch of log writes for the same stream and writer. Stores the
+/// stream and writer only once, the paths as dictionary-encoded column and the
+/// serialized log records in a second column. Consumers decode each column
+/// only when accessing it.
+class LogWriteBatch : public Message {
+public:
+  /// The index of the stream ID field.
+  static constexpr size_t stream_id_index = 0;
+
+  /// The index of the writer ID field.
+  static constexpr size_t writer_id_index = 1;
+
+  /// The index of the path column.
+  static constexpr size_t path_index = 2;
+
+  /// The index of the serial data column.
+  static constexpr size_t serial_data_index = 3;
+
+  /// The minimum number of fields in a valid log-write batch.
+  static constexpr size_t min_fields = 4;
+
+  LogWriteBatch(const enum_value& stream_id, const enum_value& writer_id,
+                const Column& paths, const Column& serial_data) {
+    init(Message::Type::LogWriteBatch, list_builder{} //
+                                         .add(stream_id)
+                                         .add(writer_id)
+                                         .add(paths.raw())
+                                         .add(serial_data.raw()));
+  }
+
+  explicit LogWriteBatch(variant msg) : Message(std::move(msg)) {}
+
+  explicit LogWriteBatch(const data_message& msg)
+    : LogWriteBatch(broker::get_data(msg)) {}
+
+  enum_value_view stream_id() const {
+    auto&& fields = sub_fields();
+    return fields[stream_id_index].to_enum_value();
+  }
+
+  enum_value_view writer_id() const {
+    auto&& fields = sub_fields();
+    return fields[writer_id_index].to_enum_value();
+  }
+
+  /// Returns the number of log writes in the batch.
+  size_t size() const {
+    return paths().size();
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  Column paths() const {
+    auto&& fields = sub_fields();
+    return Column{fields[path_index]};
+  }
+
+  Column serial_data() const {
+    auto&& fields = sub_fields();
+    return Column{fields[serial_data_index]};
+  }
+
+  /// Converts the batch back to individual log writes.
+  /// @pre `valid()`
+  std::vector<zeek::LogWrite> unpack() const;
+
+  bool valid() const;
+};
+
 /// A batch of other messages.
 class Batch : public Message {
 public:
+  /// The index of the optional field that marks a batch as transparent.
+  /// Receivers that understand the field deliver the messages of transparent
+  /// batches individually, while others simply see a regular batch.
+  static constexpr size_t transparent_index = 3;
+
   explicit Batch(variant msg);
 
   explicit Batch(const data_message& msg) : Batch(broker::get_data(msg)) {}
@@ -528,6 +839,12 @@ public:
     return impl_ != nullptr;
   }
 
+  /// Checks whether the sender created this batch only to reduce per-message
+  /// overhead, i.e., whether receivers should unpack it transparently.
+  bool transparent() const {
+    return data_.to_list().at(transparent_index).to_boolean();
+  }
+
   template <class F>
   auto for_each(F&& f) {
     if (!impl_)
@@ -548,7 +865,8 @@ private:
   using VarMsg =
     std::variant<broker::zeek::Event, broker::zeek::LogCreate,
                  broker::zeek::LogWrite, broker::zeek::IdentifierUpdate,
-                 broker::zeek::Batch>;
+                 broker::zeek::Batch, broker::zeek::LogWriteBatch,
+                 broker::zeek::CompactEvent>;
 
   using Content = std::vector<VarMsg>;
 
@@ -567,6 +885,16 @@ public:
 
   Batch build();
 
+  /// Like `build`, but marks the batch as transparent (see
+  /// `Batch::transparent`).
+  Batch build_transparent();
+
+  /// Packs all messages into a columnar batch and resets the builder.
+  /// @returns the batch or `std::nullopt` if the builder contains messages
+  ///          other than log writes for a single stream and writer. In the
+  ///          latter case, the builder remains unchanged.
+  std::optional<LogWriteBatch> build_log_writes();
+
 private:
   list_builder inner_;
 };
@@ -604,9 +932,38 @@ auto visit_as_message(F&& f, const broker::data_message& msg) {
       Batch tmp{msg};
       return do_visit(tmp);
     }
+    case Message::Type::LogWriteBatch: {
+      LogWriteBatch tmp{msg};
+      return do_visit(tmp);
+    }
+    case Message::Type::CompactEvent: {
+      CompactEvent tmp{msg};
+      return do_visit(tmp);
+    }
   }
 }
 
+/// Summarizes a Zeek message without decoding it.
+struct MessageHeader {
+  /// The type of the message or `Message::Type::Invalid` if the input does not
+  /// start with the header of a Zeek message.
+  Message::Type type = Message::Type::Invalid;
+
+  /// The event name for events, the identifier name for identifier updates
+  /// and the stream ID for log messages. Empty for batches and compact events.
+  /// Points into the input of `peek_header`.
+  std::string_view name;
+};
+
+/// Reads the type and name of a Zeek message directly from its binary
+/// encoding, i.e., without parsing the message. Only checks the fields that
+/// make up the header. Hence, a valid header does not imply a valid message.
+MessageHeader peek_header(const std::byte* bytes, size_t size);
+
+/// Reads the type and name of a Zeek message from the serialized payload of
+/// `msg` if available, falling back to the decoded value otherwise.
+MessageHeader peek_header(const data_message& msg);
+
 } // namespace broker::zeek
 
 namespace broker {
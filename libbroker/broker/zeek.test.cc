@@ -5,9 +5,15 @@
 
 #include "broker/broker-test.test.hh"
 
+#include <chrono>
+#include <iterator>
+#include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include "broker/data.hh"
+#include "broker/format/bin.hh"
 #include "broker/time.hh"
 
 using namespace broker;
@@ -71,3 +77,153 @@ TEST(event_ts_bad_type) {
   zeek::Event ev("test", vector{}, md);
   CHECK(!ev.valid());
 }
+
+TEST(log_write_batch) {
+  zeek::BatchBuilder builder;
+  for (size_t i = 0; i < 10; ++i)
+    builder.add(zeek::LogWrite{enum_value{"Conn::LOG"},
+                               enum_value{"Log::WRITER_ASCII"},
+                               i % 2 == 0 ? "conn" : "conn-summary",
+                               "row-" + std::to_string(i)});
+  auto batch = builder.build_log_writes();
+  REQUIRE(batch);
+  REQUIRE(batch->valid());
+  CHECK(builder.empty());
+  CHECK_EQUAL(zeek::Message::type(batch->raw()),
+              zeek::Message::Type::LogWriteBatch);
+  CHECK(batch->stream_id() == enum_value{"Conn::LOG"});
+  CHECK(batch->writer_id() == enum_value{"Log::WRITER_ASCII"});
+  CHECK_EQUAL(batch->size(), 10u);
+  CHECK_EQUAL(batch->paths().encoding(), zeek::Column::Dictionary);
+  CHECK_EQUAL(batch->serial_data().encoding(), zeek::Column::Plain);
+  auto writes = batch->unpack();
+  REQUIRE_EQUAL(writes.size(), 10u);
+  CHECK_EQUAL(writes[3].path_str(), "conn-summary");
+  CHECK_EQUAL(writes[3].serial_data_str(), "row-3");
+}
+
+TEST(log_write_batch_requires_a_single_stream) {
+  zeek::BatchBuilder builder;
+  builder.add(zeek::LogWrite{enum_value{"Conn::LOG"}, enum_value{"Log::W"},
+                             "conn", "x"});
+  builder.add(zeek::LogWrite{enum_value{"DNS::LOG"}, enum_value{"Log::W"},
+                             "dns", "y"});
+  CHECK(!builder.build_log_writes());
+  CHECK(!builder.empty());
+}
+
+TEST(column_encodings) {
+  MESSAGE("timestamps use delta encoding");
+  auto t0 = broker::timestamp{1700000000s};
+  std::vector<data> xs;
+  for (int i = 0; i < 10; ++i)
+    xs.emplace_back(t0 + std::chrono::milliseconds(i % 3 == 0 ? -i : i));
+  zeek::ColumnBuilder builder;
+  for (auto& x : xs)
+    builder.add(x);
+  auto col = builder.build();
+  REQUIRE(col.valid());
+  CHECK(builder.empty());
+  CHECK_EQUAL(col.encoding(), zeek::Column::Delta);
+  CHECK(col.value_type() == variant_tag::timestamp);
+  CHECK_EQUAL(col.decode(), xs);
+  MESSAGE("unique strings use plain encoding");
+  builder.add("a");
+  builder.add("b");
+  col = builder.build();
+  REQUIRE(col.valid());
+  CHECK_EQUAL(col.encoding(), zeek::Column::Plain);
+  CHECK(col.strings() == (std::vector<std::string_view>{"a", "b"}));
+  MESSAGE("mixed types use plain encoding");
+  builder.add(1);
+  builder.add("a");
+  col = builder.build();
+  REQUIRE(col.valid());
+  CHECK(col.value_type() == variant_tag::none);
+  CHECK_EQUAL(col.decode(), (std::vector<data>{data{1}, data{"a"}}));
+}
+
+namespace {
+
+std::vector<std::byte> encode_message(const zeek::Message& msg) {
+  std::vector<std::byte> buf;
+  format::bin::v1::encode(msg.raw(), std::back_inserter(buf));
+  return buf;
+}
+
+} // namespace
+
+TEST(peek_header) {
+  MESSAGE("events and identifier updates provide their name");
+  auto buf = encode_message(zeek::Event{"ping", vector{1, "a"}});
+  auto hdr = zeek::peek_header(buf.data(), buf.size());
+  CHECK_EQUAL(hdr.type, zeek::Message::Type::Event);
+  CHECK_EQUAL(hdr.name, "ping");
+  buf = encode_message(zeek::IdentifierUpdate{"foo", data{42}});
+  hdr = zeek::peek_header(buf.data(), buf.size());
+  CHECK_EQUAL(hdr.type, zeek::Message::Type::IdentifierUpdate);
+  CHECK_EQUAL(hdr.name, "foo");
+  MESSAGE("log writes provide their stream ID");
+  buf = encode_message(zeek::LogWrite{enum_value{"Conn::LOG"},
+                                      enum_value{"Log::WRITER_ASCII"}, "conn",
+                                      "row"});
+  hdr = zeek::peek_header(buf.data(), buf.size());
+  CHECK_EQUAL(hdr.type, zeek::Message::Type::LogWrite);
+  CHECK_EQUAL(hdr.name, "Conn::LOG");
+  MESSAGE("truncated input and other data produce an invalid header");
+  buf = encode_message(zeek::Event{"ping", vector{}});
+  for (size_t n = 0; n < buf.size() - 2; ++n)
+    CHECK_EQUAL(zeek::peek_header(buf.data(), n).type,
+                zeek::Message::Type::Invalid);
+  std::vector<std::byte> other;
+  format::bin::v1::encode(data{vector{1, 2, 3}}, std::back_inserter(other));
+  CHECK_EQUAL(zeek::peek_header(other.data(), other.size()).type,
+              zeek::Message::Type::Invalid);
+  MESSAGE("data messages without own bytes use the decoded value");
+  zeek::Event ev{"pong", vector{}};
+  hdr = zeek::peek_header(data_envelope::make("foo"sv, ev.raw()));
+  CHECK_EQUAL(hdr.type, zeek::Message::Type::Event);
+  CHECK_EQUAL(hdr.name, "pong");
+}
+
+TEST(event_registry) {
+  zeek::EventRegistry registry;
+  auto ping = registry.add("ping", {variant_tag::count, variant_tag::string});
+  auto any = registry.add("any", {variant_tag::none});
+  REQUIRE(ping);
+  REQUIRE(any);
+  CHECK_EQUAL(*ping, 0u);
+  CHECK_EQUAL(*any, 1u);
+  MESSAGE("registering a name again returns the same ID");
+  CHECK_EQUAL(registry.add("ping", {variant_tag::count, variant_tag::string}),
+              ping);
+  CHECK(!registry.add("ping", {variant_tag::count}));
+  MESSAGE("events with matching arguments become compact events");
+  zeek::Event ev{"ping", vector{42u, "a"}, broker::timestamp{12s}};
+  auto cev = registry.compact(ev);
+  REQUIRE(cev);
+  REQUIRE(cev->valid());
+  CHECK_EQUAL(cev->id(), *ping);
+  CHECK_EQUAL(cev->args().size(), 2u);
+  auto* schema = registry.resolve(*cev);
+  REQUIRE(schema);
+  CHECK_EQUAL(schema->name, "ping");
+  auto expanded = registry.expand(*cev);
+  REQUIRE(expanded);
+  REQUIRE(expanded->valid());
+  CHECK_EQUAL(expanded->name(), "ping");
+  CHECK_EQUAL(expanded->args().size(), 2u);
+  CHECK_EQUAL(expanded->ts(), broker::timestamp{12s});
+  CHECK(registry.compact(zeek::Event{"any", vector{"str"}}));
+  MESSAGE("unknown events and mismatched arguments stay regular events");
+  CHECK(!registry.compact(zeek::Event{"pong", vector{}}));
+  CHECK(!registry.compact(zeek::Event{"ping", vector{"a", 42u}}));
+  CHECK(!registry.resolve(zeek::CompactEvent{23u, vector{}}));
+  MESSAGE("registries survive a round trip through data");
+  auto msg = make_data_message("registry", registry.to_data());
+  auto copy = zeek::EventRegistry::from_data(get_data(msg));
+  REQUIRE(copy);
+  CHECK_EQUAL(copy->size(), 2u);
+  CHECK_EQUAL(copy->id_of("any"), any);
+  CHECK(copy->resolve(*cev));
+}
@@ -0,0 +1,355 @@
+// Counts the heap allocations per published data message at each stage of the
+// message path. The program replaces the global `operator new` with a counting
+// version. Hence, the numbers include all allocations of the process while
+// measuring a stage, including the ones by the actor system in the background.
+// Running many messages per stage amortizes this noise.
+
+#include "broker/configuration.hh"
+#include "broker/data.hh"
+#include "broker/data_envelope.hh"
+#include "broker/endpoint.hh"
+#include "broker/envelope.hh"
+#include "broker/internal/wire_format.hh"
+#include "broker/message.hh"
+#include "broker/subscriber.hh"
+#include "broker/time.hh"
+#include "broker/topic.hh"
+#include "broker/zeek.hh"
+
+#include <caf/byte_buffer.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace broker;
+using namespace std::literals;
+
+namespace {
+
+/// Counts all calls to `operator new` in this process.
+std::atomic<size_t> alloc_count{0};
+
+/// Counts the bytes of all calls to `operator new` in this process.
+std::atomic<size_t> alloc_bytes{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (auto ptr = malloc(size > 0 ? size : 1))
+    return ptr;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+namespace {
+
+constexpr std::string_view topic_str = "/benchmark/allocations";
+
+struct parameters {
+  uint64_t message_count = 10'000;
+  std::string output_format = "text";
+  std::string write_budget;
+  std::string check_budget;
+  double tolerance = 0.1;
+};
+
+void add_options(configuration& cfg, parameters& ps) {
+  cfg.add_option(&ps.message_count, "message-count,m",
+                 "number of messages per stage and message type");
+  cfg.add_option(&ps.output_format, "output-format",
+                 "print results as 'text' or 'json'");
+  cfg.add_option(&ps.write_budget, "write-budget",
+                 "stores the measured allocations as budget in a file");
+  cfg.add_option(&ps.check_budget, "check-budget",
+                 "compares the measured allocations to a budget file and "
+                 "fails on regressions");
+  cfg.add_option(&ps.tolerance, "tolerance",
+                 "accepted relative increase over the budget (default: 0.1)");
+}
+
+/// Captures the allocation counters at a point in time.
+struct alloc_snapshot {
+  size_t count;
+  size_t bytes;
+
+  static alloc_snapshot now() {
+    return {alloc_count.load(), alloc_bytes.load()};
+  }
+};
+
+/// Stores the allocations per message for a single stage and message type.
+struct stage_result {
+  std::string stage;
+  std::string type;
+  double allocations = 0;
+  double bytes = 0;
+};
+
+/// Creates the messages for one of the representative message types.
+using factory = std::function<data_message(size_t)>;
+
+std::vector<std::pair<std::string, factory>> message_types() {
+  return {
+    {"count",
+     [](size_t i) {
+       return make_data_message(topic{std::string{topic_str}},
+                                data{count{i}});
+     }},
+    {"string-1k",
+     [](size_t) {
+       return make_data_message(topic{std::string{topic_str}},
+                                data{std::string(1'000, 'x')});
+     }},
+    {"event",
+     [](size_t i) {
+       zeek::Event ev{"benchmark",
+                      vector{count{i}, std::string(100, 'x'), broker::now()}};
+       return data_envelope::make(topic_str, ev.raw());
+     }},
+    {"batch-16",
+     [](size_t i) {
+       zeek::BatchBuilder builder;
+       for (size_t j = 0; j < 16; ++j)
+         builder.add(zeek::Event{"benchmark",
+                                 vector{count{i}, std::string(100, 'x')}});
+       return data_envelope::make(topic_str, builder.build().raw());
+     }},
+  };
+}
+
+class harness {
+public:
+  explicit harness(const parameters& ps) : ps_(ps) {
+    // nop
+  }
+
+  const std::vector<stage_result>& results() const noexcept {
+    return results_;
+  }
+
+  /// Runs all stages for all message types.
+  void run(configuration cfg) {
+    endpoint ep1{std::move(cfg)};
+    endpoint ep2;
+    auto port = ep2.listen("127.0.0.1", 0);
+    if (port == 0 || !ep1.peer("127.0.0.1", port)) {
+      std::cerr << "*** failed to connect the endpoints\n";
+      abort();
+    }
+    // Note: subscribing locally first would satisfy the await right away.
+    auto remote = ep2.make_subscriber({topic{std::string{topic_str}}});
+    if (!ep1.await_filter_entry(topic{std::string{topic_str}})) {
+      std::cerr << "*** subscriptions failed to propagate\n";
+      abort();
+    }
+    auto local = ep1.make_subscriber({topic{std::string{topic_str}}});
+    for (auto& [name, make] : message_types()) {
+      // Create the inputs up front to exclude them from the measurements.
+      std::vector<data_message> msgs;
+      for (size_t i = 0; i < ps_.message_count; ++i)
+        msgs.emplace_back(make(i));
+      measure("create", name, [&] {
+        for (size_t i = 0; i < ps_.message_count; ++i)
+          make(i);
+      });
+      // Serializing and deserializing is what peers do for each message.
+      broker::internal::wire_format::v1::trait trait;
+      std::vector<caf::byte_buffer> bufs;
+      bufs.resize(msgs.size());
+      measure("peer-write", name, [&] {
+        for (size_t i = 0; i < msgs.size(); ++i)
+          if (!trait.convert(msgs[i], bufs[i]))
+            abort();
+      });
+      measure("peer-read", name, [&] {
+        for (auto& buf : bufs) {
+          envelope_ptr msg;
+          if (!trait.convert(buf, msg))
+            abort();
+        }
+      });
+      measure("subscriber-decode", name, [&] {
+        for (auto& msg : msgs)
+          get_data(msg).to_data();
+      });
+      // End-to-end: both subscribers receive all messages. The local
+      // subscriber shares the path up to the core with the remote one.
+      measure("end-to-end", name, [&] {
+        for (auto& msg : msgs)
+          ep1.publish(msg);
+        receive(local, msgs.size());
+        receive(remote, msgs.size());
+      });
+    }
+  }
+
+private:
+  template <class F>
+  void measure(std::string_view stage, const std::string& type, F fn) {
+    auto before = alloc_snapshot::now();
+    fn();
+    auto after = alloc_snapshot::now();
+    auto n = static_cast<double>(ps_.message_count);
+    stage_result res;
+    res.stage = stage;
+    res.type = type;
+    res.allocations = static_cast<double>(after.count - before.count) / n;
+    res.bytes = static_cast<double>(after.bytes - before.bytes) / n;
+    results_.emplace_back(std::move(res));
+  }
+
+  void receive(subscriber& sub, size_t num) {
+    std::vector<data_message> buf;
+    buf.reserve(128);
+    size_t received = 0;
+    while (received < num) {
+      if (!sub.wait_for(10s)) {
+        std::cerr << "*** timed out while waiting for messages\n";
+        abort();
+      }
+      buf.clear();
+      received += sub.poll(buf, 128);
+    }
+  }
+
+  const parameters& ps_;
+  std::vector<stage_result> results_;
+};
+
+// -- output -------------------------------------------------------------------
+
+void print_text(const std::vector<stage_result>& xs) {
+  std::cout << "allocations per message:\n";
+  for (const auto& x : xs)
+    std::cout << "  " << x.stage << " (" << x.type << "): " << x.allocations
+              << " allocations, " << x.bytes << " bytes\n";
+}
+
+void print_json(const std::vector<stage_result>& xs) {
+  std::cout << "[";
+  for (size_t i = 0; i < xs.size(); ++i) {
+    const auto& x = xs[i];
+    std::cout << (i == 0 ? "\n  " : ",\n  ") << "{\"stage\": \"" << x.stage
+              << "\", \"type\": \"" << x.type
+              << "\", \"allocations\": " << x.allocations
+              << ", \"bytes\": " << x.bytes << "}";
+  }
+  std::cout << "\n]" << std::endl;
+}
+
+// -- budgets ------------------------------------------------------------------
+
+// The budget file has one line per stage and message type in the format
+// `<stage> <type> <allocations per message>`.
+
+bool write_budget(const std::string& path,
+                  const std::vector<stage_result>& xs) {
+  std::ofstream out{path};
+  for (const auto& x : xs)
+    out << x.stage << ' ' << x.type << ' ' << x.allocations << '\n';
+  return static_cast<bool>(out);
+}
+
+/// Returns `false` if any stage exceeds its budget.
+bool check_budget(const std::string& path, double tolerance,
+                  const std::vector<stage_result>& xs) {
+  std::ifstream in{path};
+  if (!in) {
+    std::cerr << "*** unable to open budget file: " << path << '\n';
+    return false;
+  }
+  std::map<std::pair<std::string, std::string>, double> budget;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields{line};
+    std::string stage;
+    std::string type;
+    double allocations = 0;
+    if (fields >> stage >> type >> allocations)
+      budget[{stage, type}] = allocations;
+  }
+  auto result = true;
+  for (const auto& x : xs) {
+    auto i = budget.find({x.stage, x.type});
+    if (i == budget.end())
+      continue;
+    // The absolute slack prevents failures for stages with (almost) no
+    // allocations, where background noise dominates.
+    auto limit = i->second * (1.0 + tolerance) + 0.5;
+    if (x.allocations > limit) {
+      std::cerr << "*** regression in " << x.stage << " (" << x.type
+                << "): " << x.allocations << " allocations per message, "
+                << "budget: " << i->second << '\n';
+      result = false;
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+// -- main ---------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+  parameters params;
+  configuration cfg{skip_init};
+  add_options(cfg, params);
+  try {
+    cfg.init(argc, argv);
+  } catch (std::exception& ex) {
+    std::cerr << ex.what() << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (cfg.cli_helptext_printed())
+    return EXIT_SUCCESS;
+  if (cfg.remainder().size() > 0) {
+    std::cerr << "*** too many arguments (did not expect any)\n\n";
+    return EXIT_FAILURE;
+  }
+  const auto& fmt = params.output_format;
+  if (fmt != "text" && fmt != "json") {
+    std::cerr << "*** invalid output format: " << fmt << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (params.message_count == 0) {
+    std::cerr << "*** message-count must be greater than 0\n\n";
+    return EXIT_FAILURE;
+  }
+  harness h{params};
+  h.run(std::move(cfg));
+  if (fmt == "text")
+    print_text(h.results());
+  else
+    print_json(h.results());
+  if (!params.write_budget.empty()
+      && !write_budget(params.write_budget, h.results())) {
+    std::cerr << "*** unable to write budget file: " << params.write_budget
+              << '\n';
+    return EXIT_FAILURE;
+  }
+  if (!params.check_budget.empty()
+      && !check_budget(params.check_budget, params.tolerance, h.results()))
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
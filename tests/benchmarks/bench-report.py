@@ -0,0 +1,268 @@
+#!/usr/bin/env python3
+"""Runs the benchmark suites with fixed parameters and compares the results to
+a baseline.
+
+The report is a JSON file with the format:
+
+    {
+      "format": 1,
+      "version": "<Broker version>",
+      "created": "<ISO 8601 timestamp>",
+      "host": "<host name>",
+      "suites": {
+        "<suite>": {
+          "<metric>": {"value": <number>, "unit": "<unit>", "better": "lower"}
+        }
+      }
+    }
+
+The field "better" is either "lower" or "higher". When passing a baseline, the
+script exits with status 1 if any metric got worse by more than the threshold.
+"""
+
+import argparse, datetime, json, os, platform, statistics, subprocess, sys
+
+# Bump this number when changing the report format in an incompatible way.
+REPORT_FORMAT = 1
+
+# -- suites -------------------------------------------------------------------
+
+def get(obj, path):
+    """Returns the value at a dot-separated path."""
+    for key in path.split('.'):
+        obj = obj[key]
+    return obj
+
+class Standalone:
+    """A benchmark program with its own CLI that prints a JSON result."""
+
+    def __init__(self, exe, args, metrics):
+        self.exe = exe
+        self.args = args
+        # List of (name, extractor, unit, better).
+        self.metrics = metrics
+
+    def run(self, path, repetitions):
+        samples = {}
+        for _ in range(repetitions):
+            result = json.loads(run([path] + self.args))
+            # Programs with sweep support print a list of results.
+            if isinstance(result, list):
+                result = result[0]
+            for name, extract, unit, better in self.metrics:
+                samples.setdefault(name, (unit, better, []))[2].append(
+                    extract(result))
+        return {name: metric(statistics.median(xs), unit, better)
+                for name, (unit, better, xs) in samples.items()}
+
+class GoogleBenchmark:
+    """A benchmark program based on Google Benchmark."""
+
+    def __init__(self, exe):
+        self.exe = exe
+
+    def run(self, path, repetitions):
+        output = run([path, '--benchmark_format=json',
+                      '--benchmark_repetitions=%d' % repetitions,
+                      '--benchmark_report_aggregates_only=true'])
+        scale = {'ns': 1, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+        result = {}
+        for x in json.loads(output)['benchmarks']:
+            if x.get('run_type') == 'aggregate' \
+               and x.get('aggregate_name') != 'median':
+                continue
+            name = x.get('run_name', x['name'])
+            ns = x['cpu_time'] * scale[x.get('time_unit', 'ns')]
+            result[name] = metric(ns, 'ns', 'lower')
+        return result
+
+class PythonScript:
+    """The benchmarks for the Python bindings."""
+
+    exe = 'python/bindings.py'
+
+    def run(self, path, repetitions):
+        samples = {}
+        for _ in range(repetitions):
+            result = json.loads(run([sys.executable, path,
+                                     '--output-format=json']))
+            for name, rate in result['pubsub'].items():
+                samples.setdefault(name, ('msg/s', 'higher', []))[2].append(
+                    rate)
+            for name, x in result['conversion'].items():
+                for key in ('from_py_ns', 'to_py_ns'):
+                    samples.setdefault('%s.%s' % (name, key),
+                                       ('ns', 'lower', []))[2].append(x[key])
+            for name, x in result['gil'].items():
+                samples.setdefault(name + '.max_gap_ms',
+                                   ('ms', 'lower', []))[2].append(
+                                       x['max_gap_ms'])
+        return {name: metric(statistics.median(xs), unit, better)
+                for name, (unit, better, xs) in samples.items()}
+
+def metric(value, unit, better):
+    return {'value': value, 'unit': unit, 'better': better}
+
+def higher(path, unit):
+    return (path, lambda x: get(x, path), unit, 'higher')
+
+def lower(path, unit):
+    return (path, lambda x: get(x, path), unit, 'lower')
+
+SUITES = {
+    'fan-out': Standalone(
+        'broker-fan-out-benchmark',
+        ['--output-format=json', '--peer-count=10', '--message-count=100000',
+         '--payload-size=100'],
+        [higher('publish_rate', 'msg/s'),
+         ('min_subscriber_rate', lambda x: min(x['subscriber_rates']),
+          'msg/s', 'higher'),
+         lower('latency_us.p50', 'us'),
+         lower('latency_us.p99', 'us'),
+         lower('allocations_per_message', 'allocs')]),
+    'store': Standalone(
+        'broker-store-benchmark',
+        ['--output-format=json', '--clone-count=4', '--store-size=10000',
+         '--write-count=10000'],
+        [higher('fill_rate', 'writes/s'),
+         higher('write_rate', 'writes/s'),
+         higher('replication_rate', 'writes/s'),
+         lower('sync_ms.p50', 'ms'),
+         lower('lag_ms.p99', 'ms')]),
+    'web-socket': Standalone(
+        'broker-web-socket-benchmark',
+        ['--output-format=json', '--client-count=4', '--message-count=10000',
+         '--direction=both'],
+        [lower('json_ns.encode', 'ns'),
+         lower('json_ns.decode', 'ns'),
+         higher('publish.frames_per_second', 'frames/s'),
+         lower('publish.latency_us.p99', 'us'),
+         higher('subscribe.frames_per_second', 'frames/s'),
+         lower('subscribe.latency_us.p99', 'us')]),
+    'connector': Standalone(
+        'broker-connector-benchmark',
+        ['--output-format=json', '--peer-count=20', '--restarts=1'],
+        [('full_mesh_ms', lambda x: x['rounds'][0]['full_mesh_ms'], 'ms',
+          'lower'),
+         ('latency_ms.p99', lambda x: x['rounds'][0]['latency_ms']['p99'],
+          'ms', 'lower'),
+         ('reconnect_ms', lambda x: x['rounds'][1]['full_mesh_ms'], 'ms',
+          'lower'),
+         ('connector_cpu_ms',
+          lambda x: x['rounds'][0]['cpu_ms']['connectors'], 'ms', 'lower')]),
+    'connector-tls': Standalone(
+        'broker-connector-benchmark',
+        ['--output-format=json', '--peer-count=20', '--restarts=1', '--tls'],
+        [('full_mesh_ms', lambda x: x['rounds'][0]['full_mesh_ms'], 'ms',
+          'lower'),
+         ('latency_ms.p99', lambda x: x['rounds'][0]['latency_ms']['p99'],
+          'ms', 'lower')]),
+    'python': PythonScript(),
+    'dispatch': GoogleBenchmark('broker-dispatch-benchmark'),
+    'routing-table': GoogleBenchmark('broker-routing-table-benchmark'),
+    'serialization': GoogleBenchmark('broker-serialization-benchmark'),
+    'store-backend': GoogleBenchmark('broker-store-backend-benchmark'),
+}
+
+def run(cmd):
+    proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                          universal_newlines=True)
+    if proc.returncode != 0:
+        raise RuntimeError('%s failed:\n%s' % (cmd[0], proc.stderr))
+    return proc.stdout
+
+# -- comparing ----------------------------------------------------------------
+
+def compare(baseline, report, threshold):
+    """Prints the relative change per metric and returns the regressions."""
+    regressions = []
+    for suite, metrics in sorted(report['suites'].items()):
+        base_metrics = baseline['suites'].get(suite)
+        if base_metrics is None:
+            print('%s: not in baseline' % suite)
+            continue
+        for name, x in sorted(metrics.items()):
+            base = base_metrics.get(name)
+            if base is None or base['value'] == 0:
+                continue
+            change = (x['value'] - base['value']) / base['value']
+            worse = change > threshold if x['better'] == 'lower' \
+                    else change < -threshold
+            label = 'REGRESSION' if worse else 'ok'
+            print('%s/%s: %g -> %g %s (%+.1f%%) %s'
+                  % (suite, name, base['value'], x['value'], x['unit'],
+                     change * 100, label))
+            if worse:
+                regressions.append('%s/%s' % (suite, name))
+    return regressions
+
+# -- main ---------------------------------------------------------------------
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--bin-dir', required=True,
+                        help='directory with the benchmark programs')
+    parser.add_argument('--python-path', default='',
+                        help='directory with the Python bindings, enables '
+                             'the python suite')
+    parser.add_argument('--version', default='unknown',
+                        help='Broker version for the report')
+    parser.add_argument('--output', default='bench-report.json',
+                        help='file for storing the results')
+    parser.add_argument('--baseline', default='',
+                        help='report of a previous run for comparing')
+    parser.add_argument('--threshold', type=float, default=0.1,
+                        help='accepted relative change before reporting a '
+                             'regression (default: 0.1)')
+    parser.add_argument('--repetitions', type=int, default=3,
+                        help='runs per suite, the report uses the median')
+    parser.add_argument('--suites', default='',
+                        help='comma-separated list of suites (default: all)')
+    args = parser.parse_args()
+    names = args.suites.split(',') if args.suites else sorted(SUITES)
+    report = {
+        'format': REPORT_FORMAT,
+        'version': args.version,
+        'created': datetime.datetime.now().isoformat(timespec='seconds'),
+        'host': platform.node(),
+        'suites': {},
+    }
+    for name in names:
+        suite = SUITES.get(name)
+        if suite is None:
+            sys.stderr.write('*** unknown suite: %s\n' % name)
+            return 2
+        if isinstance(suite, PythonScript):
+            if not args.python_path:
+                print('%s: skipped (no --python-path)' % name)
+                continue
+            path = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                suite.exe)
+            os.environ['PYTHONPATH'] = args.python_path
+        else:
+            path = os.path.join(args.bin_dir, suite.exe)
+        if not os.path.isfile(path):
+            print('%s: skipped (%s not found)' % (name, suite.exe))
+            continue
+        print('%s: running ...' % name, flush=True)
+        report['suites'][name] = suite.run(path, args.repetitions)
+    with open(args.output, 'w') as f:
+        json.dump(report, f, indent=2, sort_keys=True)
+        f.write('\n')
+    print('results written to %s' % args.output)
+    if not args.baseline:
+        return 0
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    if baseline.get('format') != REPORT_FORMAT:
+        sys.stderr.write('*** baseline has an incompatible format\n')
+        return 2
+    regressions = compare(baseline, report, args.threshold)
+    if regressions:
+        sys.stderr.write('*** %d regression(s): %s\n'
+                         % (len(regressions), ', '.join(regressions)))
+        return 1
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
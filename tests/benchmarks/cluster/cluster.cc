@@ -1,56 +1,66 @@
+#include <algorithm>
 #include <atomic>
 #include <chrono>
-#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <optional>
+#include <set>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <vector>
 
-#include <caf/actor_system.hpp>
 #include <caf/actor_system_config.hpp>
-#include <caf/after.hpp>
-#include <caf/attach_stream_sink.hpp>
-#include <caf/attach_stream_source.hpp>
-#include <caf/event_based_actor.hpp>
-#include <caf/scoped_actor.hpp>
+#include <caf/deep_to_string.hpp>
 #include <caf/settings.hpp>
-#include <caf/stateful_actor.hpp>
 #include <caf/string_algorithms.hpp>
 #include <caf/term.hpp>
+#include <caf/uri.hpp>
 
+#include "broker/config.hh"
 #include "broker/configuration.hh"
 #include "broker/detail/filesystem.hh"
 #include "broker/endpoint.hh"
 #include "broker/fwd.hh"
-#include "broker/internal/generator_file_reader.hh"
-#include "broker/internal/generator_file_writer.hh"
-#include "broker/internal/native.hh"
+#include "broker/internal/flight_recorder.hh"
 #include "broker/internal/type_id.hh"
+#include "broker/message.hh"
 #include "broker/subscriber.hh"
+#include "broker/time.hh"
+#include "broker/variant_visit.hh"
+
+#ifndef BROKER_WINDOWS
+#  include <sys/resource.h>
+#endif
 
-using broker::internal::native;
-using caf::actor_system_config;
 using caf::expected;
-using caf::get;
 using caf::get_if;
-using caf::holds_alternative;
 using std::string;
 using std::chrono::duration_cast;
 
 using string_list = std::vector<string>;
 
-namespace atom = broker::internal::atom;
-
 // -- global constants and type aliases ----------------------------------------
 
 namespace {
 
 using fractional_seconds = std::chrono::duration<double>;
 
+using clock_type = std::chrono::steady_clock;
+
 constexpr size_t max_nodes = 500;
 
+/// Identifies the messages that carry a timestamp for measuring latency.
+constexpr std::string_view probe_tag = "broker.benchmark.probe";
+
 struct quoted {
-  caf::string_view str;
+  std::string_view str;
 };
 
 } // namespace
@@ -75,8 +85,8 @@ int print_impl(std::ostream& ostr, const string& x) {
   return 0;
 }
 
-int print_impl(std::ostream& ostr, const caf::string_view& x) {
-  ostr.write(x.data(), x.size());
+int print_impl(std::ostream& ostr, std::string_view x) {
+  ostr.write(x.data(), static_cast<std::streamsize>(x.size()));
   return 0;
 }
 
@@ -98,13 +108,18 @@ int print_impl(std::ostream& ostr, const caf::term& x) {
 
 template <class T>
 int print_impl(std::ostream& ostr, const T& x) {
-  return print_impl(ostr, caf::deep_to_string(x));
+  if constexpr (std::is_arithmetic_v<T>) {
+    ostr << x;
+    return 0;
+  } else {
+    return print_impl(ostr, caf::deep_to_string(x));
+  }
 }
 
 template <class... Ts>
 void println(std::ostream& ostr, Ts&&... xs) {
   std::unique_lock<std::mutex> guard{ostream_mtx};
-  std::initializer_list<int>{print_impl(ostr, std::forward<Ts>(xs))...};
+  (print_impl(ostr, std::forward<Ts>(xs)), ...);
   ostr << caf::term::reset_endl;
 }
 
@@ -143,7 +158,7 @@ namespace verbose {
 
 namespace {
 
-std::atomic<bool> is_enabled;
+bool is_enabled;
 
 } // namespace
 
@@ -160,55 +175,66 @@ void println(Ts&&... xs) {
 
 } // namespace verbose
 
-// -- utility functions --------------------------------------------------------
+// -- configuration setup ------------------------------------------------------
 
 namespace {
 
-std::string trim(std::string x) {
-  auto predicate = [](int ch) { return !std::isspace(ch); };
-  x.erase(x.begin(), std::find_if(x.begin(), x.end(), predicate));
-  x.erase(std::find_if(x.rbegin(), x.rend(), predicate).base(), x.end());
-  return x;
+struct parameters {
+  string cluster_config_file;
+  string mode = "benchmark";
+  string_list excluded_nodes;
+  bool json = false;
+  uint64_t probe_interval = 100;
+  uint64_t timeout = 60;
+};
+
+void add_options(broker::configuration& cfg, parameters& ps) {
+  cfg.add_option(&ps.cluster_config_file, "cluster-config-file,c",
+                 "path to the cluster configuration file ('-' for STDIN)");
+  cfg.add_option(&ps.mode, "mode",
+                 "one of: benchmark (default) or dump-stats (print stats for "
+                 "recording files)");
+  cfg.add_option(&verbose::is_enabled, "verbose,v", "enable verbose output");
+  cfg.add_option(&ps.excluded_nodes, "excluded-nodes,e",
+                 "excludes given nodes from the setup");
+  cfg.add_option(&ps.json, "json", "print the results as JSON");
+  cfg.add_option(&ps.probe_interval, "probe-interval",
+                 "replace every n-th published message with a timestamp for "
+                 "measuring latency (0 = no latency measurement)");
+  cfg.add_option(&ps.timeout, "timeout",
+                 "maximum number of seconds to wait for all messages");
 }
 
+using broker::detail::is_file;
+
 } // namespace
 
-// -- configuration setup ------------------------------------------------------
+// -- data structures for the cluster setup ------------------------------------
 
-namespace {
+using inputs_by_node_map = std::map<std::string, size_t>;
 
-struct config : actor_system_config {
-  config() {
-    opt_group{custom_options_, "global"}
-      .add<std::string>("cluster-config-file,c",
-                        "path to the cluster configuration file")
-      .add<string>(
-        "mode",
-        "one of: benchmark (default), dump-stats (print stats for generator "
-        "files), generate-config (create a config for given recording), or "
-        "shrink-generator-file (reduce entries in a .dat file)")
-      .add<bool>("verbose,v", "enable verbose output")
-      .add<string_list>("excluded-nodes,e",
-                        "excludes given nodes from the setup");
-    set("caf.scheduler.max-threads", 1);
-    set("caf.logger.file.verbosity", "quiet");
-  }
+/// Collects the measurements for a single node.
+struct node_stats {
+  /// Stores how many messages this node has published.
+  size_t sent = 0;
 
-  string usage() {
-    return custom_options_.help_text(true);
-  }
-};
+  /// Stores how many messages this node has received.
+  size_t received = 0;
 
-using broker::detail::is_directory;
-using broker::detail::is_file;
-using broker::detail::read;
-using broker::detail::readlines;
+  /// Stores how long the node took to publish all of its messages.
+  caf::timespan send_time{0};
 
-} // namespace
+  /// Stores how long the node took to receive all of its messages, measured
+  /// from the start of the benchmark.
+  caf::timespan receive_time{0};
 
-// -- data structures for the cluster setup ------------------------------------
+  /// Stores the maximum number of messages that were waiting in the buffer of
+  /// the subscriber.
+  size_t peak_backlog = 0;
 
-using inputs_by_node_map = std::map<std::string, size_t>;
+  /// Stores the latency of all received probes.
+  std::vector<broker::timespan> latencies;
+};
 
 /// A node in the Broker publish/subscribe layer.
 struct node {
@@ -224,8 +250,14 @@ struct node {
   /// Stores the topics we subscribe to at startup.
   std::vector<std::string> topics;
 
-  /// Optionally stores a path to a generator file.
-  std::string generator_file;
+  /// Optionally stores a path to a file from the flight recorder.
+  std::string recording_file;
+
+  /// Optionally stores a topic for publishing generated messages.
+  std::string publish_topic;
+
+  /// Stores the size of generated messages in bytes.
+  size_t payload_size = 64;
 
   /// Stores how many messages we expect on this node during measurement.
   size_t num_inputs = 0;
@@ -233,8 +265,8 @@ struct node {
   /// Stores whether this node disables forwarding of subscriptions.
   bool disable_forwarding = true;
 
-  /// Stores how many messages we produce using the gernerator file. If `none`,
-  /// we produce the number of messages in the generator file.
+  /// Stores how many messages we produce using the recording. If `none`, we
+  /// produce the number of messages in the recording.
   std::optional<size_t> num_outputs;
 
   /// Stores parent nodes in the pub/sub topology.
@@ -244,28 +276,33 @@ struct node {
   /// connect to at startup.
   std::vector<node*> right;
 
-  /// Points to an actor that manages the Broker endpoint.
-  caf::actor mgr;
-
   /// Stores how many inputs we receive per node.
   inputs_by_node_map inputs_by_node;
 
   /// Stores the CAF log level for this node.
   std::string log_verbosity = "quiet";
+
+  /// Points to the Broker endpoint of this node.
+  std::unique_ptr<broker::endpoint> ep;
+
+  /// Receives the messages for this node if it is a receiver.
+  std::optional<broker::subscriber> sub;
+
+  /// Stores the data messages from the recording file.
+  std::vector<broker::data_message> messages;
+
+  /// Stores the measurements for this node.
+  node_stats stats;
 };
 
 bool is_sender(const node& x) {
-  return !x.generator_file.empty();
+  return !x.recording_file.empty() || !x.publish_topic.empty();
 }
 
 bool is_receiver(const node& x) {
   return x.num_inputs > 0;
 }
 
-bool is_sender_and_receiver(const node& x) {
-  return is_sender(x) && is_receiver(x);
-}
-
 std::vector<broker::topic> topics(const node& x) {
   std::vector<broker::topic> result;
   for (auto& t : x.topics)
@@ -304,15 +341,28 @@ expected<node> make_node(const string& name, const caf::settings& parameters) {
   SET_FIELD(id, mandatory);
   SET_FIELD(peers, optional);
   SET_FIELD(topics, mandatory);
-  SET_FIELD(generator_file, optional);
+  SET_FIELD(recording_file, optional);
+  SET_FIELD(publish_topic, optional);
+  SET_FIELD(payload_size, optional);
   SET_FIELD(num_inputs, optional);
   SET_FIELD(disable_forwarding, optional);
   SET_FIELD(num_outputs, optional);
   SET_FIELD(inputs_by_node, optional);
   SET_FIELD(log_verbosity, optional);
-  if (!result.generator_file.empty() && !is_file(result.generator_file))
+  if (caf::get_if(&parameters, "generator-file") != nullptr)
+    return make_error(caf::sec::invalid_argument, result.name,
+                      "generator files are no longer supported, "
+                      "use recording-file instead");
+  if (!result.recording_file.empty() && !is_file(result.recording_file))
     return make_error(caf::sec::invalid_argument, result.name,
-                      "generator file does not exist", result.generator_file);
+                      "recording file does not exist", result.recording_file);
+  if (!result.recording_file.empty() && !result.publish_topic.empty())
+    return make_error(caf::sec::invalid_argument, result.name,
+                      "recording-file and publish-topic are mutually "
+                      "exclusive");
+  if (!result.publish_topic.empty() && !result.num_outputs)
+    return make_error(caf::sec::invalid_argument, result.name,
+                      "publish-topic requires num-outputs");
   if (!result.inputs_by_node.empty()) {
     auto plus = [](size_t n, const inputs_by_node_map::value_type& kvp) {
       return n + kvp.second;
@@ -326,355 +376,380 @@ expected<node> make_node(const string& name, const caf::settings& parameters) {
   return result;
 }
 
-struct node_manager_state {
-  node* this_node = nullptr;
-  union {
-    broker::endpoint ep;
-  };
-  broker::internal::generator_file_reader_ptr generator;
-  std::vector<caf::actor> children;
+// -- utility functions --------------------------------------------------------
 
-  node_manager_state() {
-    // nop
-  }
+/// Splits the authority of `x` into host and port.
+std::pair<std::string, uint16_t> host_and_port(const caf::uri& x) {
+  const auto& authority = x.authority();
+  auto host = to_string(authority);
+  if (auto sep = host.find_last_of(':');
+      sep != std::string::npos && host.find(']', sep) == std::string::npos)
+    host.erase(sep);
+  if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+    host = host.substr(1, host.size() - 2);
+  return {std::move(host), authority.port};
+}
 
-  ~node_manager_state() {
-    if (this_node != nullptr)
-      ep.~endpoint();
+/// Loads all data messages from a flight recorder capture.
+/// @returns the number of skipped command messages.
+expected<size_t> load_recording(const std::string& fname,
+                                std::vector<broker::data_message>& out) {
+  auto msgs = broker::internal::flight_recorder::load(fname);
+  if (!msgs)
+    return caf::make_error(caf::sec::cannot_open_file, fname);
+  size_t skipped = 0;
+  for (auto& msg : *msgs) {
+    if (get_type(msg) == broker::envelope_type::data)
+      out.emplace_back(msg->as_data());
+    else
+      ++skipped;
   }
+  return skipped;
+}
 
-  void init(node* this_node_ptr) {
-    BROKER_ASSERT(this_node_ptr != nullptr);
-    this_node = this_node_ptr;
-    broker::broker_options opts;
-    opts.disable_forwarding = this_node_ptr->disable_forwarding;
-    opts.disable_ssl = true;
-    opts.ignore_broker_conf = true; // Make sure no one messes with our setup.
-    broker::configuration cfg{opts};
-    cfg.set("caf.middleman.workers", uint64_t{0u});
-    cfg.set("caf.logger.file.path", this_node->name + ".log");
-    cfg.set("caf.logger.file.verbosity", this_node->log_verbosity);
-    new (&ep) broker::endpoint(std::move(cfg));
-  }
-};
+broker::data_message make_probe(std::string_view topic_str) {
+  broker::vector xs;
+  xs.emplace_back(std::string{probe_tag});
+  xs.emplace_back(broker::now());
+  return broker::make_data_message(broker::topic{std::string{topic_str}},
+                                   broker::data{std::move(xs)});
+}
 
-using node_manager_actor = caf::stateful_actor<node_manager_state>;
+/// Returns the timestamp of a probe or `nullopt` if `msg` is no probe.
+std::optional<broker::timestamp> probe_time(const broker::data_message& msg) {
+  auto val = msg->value();
+  if (!val.is_list())
+    return std::nullopt;
+  std::optional<broker::timestamp> result;
+  broker::visit_fields<std::string_view, broker::timestamp>(
+    val.to_list(), [&result](std::string_view tag, broker::timestamp ts) {
+      if (tag == probe_tag)
+        result = ts;
+    });
+  return result;
+}
 
-struct generator_state {
-  static inline const char* name = "broker.benchmark.generator";
-};
+size_t max_rss_kb() {
+#ifndef BROKER_WINDOWS
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    return static_cast<size_t>(usage.ru_maxrss);
+#endif
+  return 0;
+}
 
-void generator(caf::stateful_actor<generator_state>* self, node* this_node,
-               caf::actor core,
-               broker::internal::generator_file_reader_ptr ptr) {
-  using generator_ptr = broker::internal::generator_file_reader_ptr;
-  using value_type = broker::node_message::value_type;
-  if (this_node->num_outputs != caf::none) {
-    struct state {
-      generator_ptr gptr;
-      size_t remaining;
-      size_t pushed = 0;
-    };
-    attach_stream_source(
-      self, core,
-      [&](state& st) {
-        // Take ownership of `ptr`.
-        st.gptr = std::move(ptr);
-        st.remaining = *this_node->num_outputs;
-      },
-      [=](state& st, caf::downstream<value_type>& out, size_t hint) {
-        if (st.gptr == nullptr)
-          return;
-        auto n = std::min(hint, st.remaining);
-        for (size_t i = 0; i < n; ++i) {
-          if (st.gptr->at_end())
-            st.gptr->rewind();
-          value_type x;
-          if (auto err = st.gptr->read(x)) {
-            err::println("error while parsing ", this_node->generator_file,
-                         ": ", to_string(err));
-            st.gptr = nullptr;
-            st.remaining = 0;
-            return;
-          }
-          out.push(std::move(x));
-        }
-        st.remaining -= n;
-        if (st.pushed / 1000 != (st.pushed + n) / 1000)
-          verbose::println(this_node->name, " pushed ", st.pushed + n,
-                           " messages");
-        st.pushed += n;
-      },
-      [](const state& st) { return st.remaining == 0; });
-  } else {
-    struct state {
-      generator_ptr gptr;
-      size_t pushed = 0;
-    };
-    auto done = [](const state& st) {
-      // We are done when gptr becomes null as result of an error or when
-      // reacing the end of the generator file.
-      return st.gptr == nullptr || st.gptr->at_end();
-    };
-    attach_stream_source(
-      self, core,
-      [&](state& st) {
-        // Take ownership of `ptr`.
-        st.gptr = std::move(ptr);
-      },
-      [=](state& st, caf::downstream<value_type>& out, size_t hint) {
-        size_t n = 0;
-        for (; n < hint; ++n) {
-          if (done(st))
-            break;
-          value_type x;
-          if (auto err = st.gptr->read(x)) {
-            err::println("error while parsing ", this_node->generator_file,
-                         ": ", to_string(err));
-            st.gptr = nullptr;
-            break;
-          }
-          out.push(std::move(x));
-        }
-        // Make some noise every 1k messages or when done.
-        if (done(st) || st.pushed / 1000 != (st.pushed + n) / 1000)
-          verbose::println(this_node->name, " pushed ", st.pushed + n,
-                           " messages");
-        st.pushed += n;
-      },
-      done);
-  }
+// -- benchmark logic ----------------------------------------------------------
+
+void init(node& x) {
+  broker::broker_options opts;
+  opts.disable_forwarding = x.disable_forwarding;
+  opts.disable_ssl = true;
+  opts.ignore_broker_conf = true; // Make sure no one messes with our setup.
+  broker::configuration cfg{opts};
+  cfg.set("caf.logger.file.path", x.name + ".log");
+  cfg.set("caf.logger.file.verbosity", x.log_verbosity);
+  x.ep = std::make_unique<broker::endpoint>(std::move(cfg));
+  // Make sure we subscribe to all topics locally *before* we initiate peering.
+  // Otherwise, we get a race on the topics and can "loose" initial messages.
+  if (is_receiver(x))
+    x.sub.emplace(x.ep->make_subscriber(topics(x)));
 }
 
-void run_send_mode(node_manager_actor* self, caf::actor observer) {
-  auto this_node = self->state.this_node;
-  verbose::println(this_node->name, " starts publishing");
-  auto t0 = std::chrono::steady_clock::now();
-  auto g = self->spawn(generator, this_node, native(self->state.ep.core()),
-                       std::move(self->state.generator));
-  g->attach_functor([this_node, t0, observer]() mutable {
-    auto t1 = std::chrono::steady_clock::now();
-    anon_send(observer, atom::ok_v, atom::write_v, this_node->name,
-              duration_cast<caf::timespan>(t1 - t0));
-  });
+bool listen(node& x) {
+  if (x.id.scheme() != "tcp")
+    return true;
+  auto [host, port] = host_and_port(x.id);
+  verbose::println(x.name, " starts listening at ", host, ":", port);
+  auto actual = x.ep->listen(host, port);
+  if (actual != port) {
+    err::println(x.name, " opened port ", actual, " instead of ", port);
+    return false;
+  }
+  return true;
 }
 
-struct consumer_state {
-  consumer_state(caf::event_based_actor* self) : self(self) {
-    start = std::chrono::steady_clock::now();
+bool connect(node& x) {
+  for (const auto* peer : x.right) {
+    auto [host, port] = host_and_port(peer->id);
+    verbose::println(x.name, " starts peering to ", host, ":", port, " (",
+                     peer->name, ")");
+    // Try to connect up to 5 times per peer before giving up.
+    auto connected = false;
+    for (int i = 1; !connected && i <= 5; ++i) {
+      if (x.ep->peer(host, port, broker::timeout::seconds(1))) {
+        verbose::println(x.name, " successfully peered to ", peer->name);
+        connected = true;
+      } else if (i == 5) {
+        err::println(x.name, " failed to peer to ", peer->name,
+                     " on the 5th try");
+        return false;
+      } else {
+        verbose::println(x.name, " failed to peer to ", peer->name,
+                         " (try again)");
+      }
+    }
   }
+  return true;
+}
 
-  ~consumer_state() {
-    if (received > this_node->num_inputs)
-      warn::println(this_node->name, " received ", received,
-                    " messages but only expected ", this_node->num_inputs);
+bool load(node& x) {
+  if (x.recording_file.empty())
+    return true;
+  auto skipped = load_recording(x.recording_file, x.messages);
+  if (!skipped) {
+    err::println("unable to load ", x.recording_file, ": ", skipped.error());
+    return false;
+  }
+  if (*skipped > 0)
+    verbose::println(x.name, " skips ", *skipped,
+                     " command messages from its recording");
+  if (x.messages.empty()) {
+    err::println(x.recording_file, " contains no data messages");
+    return false;
   }
+  return true;
+}
 
-  void handle_messages(size_t n) {
-    // Make some noise every 1k messages.
-    if (received / 1000 != (received + n) / 1000)
-      verbose::println(this_node->name, " got ", received + n, " messages");
-    // Inform the observer when reaching the node's limit.
-    auto limit = this_node->num_inputs;
-    if (received < limit && received + n >= limit) {
-      auto stop = std::chrono::steady_clock::now();
-      anon_send(observer, atom::ok_v, atom::read_v, this_node->name,
-                duration_cast<caf::timespan>(stop - start));
-      verbose::println(this_node->name, " reached its limit");
+/// Waits until the filter of `x` contains all subscriptions of other nodes
+/// that match any of the topics `x` publishes to. Otherwise, `x` may start
+/// publishing before remote subscriptions become visible and the receivers
+/// never reach their limit.
+void await_subscriptions(node& x, const std::vector<node>& nodes) {
+  std::set<std::string> published;
+  if (!x.publish_topic.empty())
+    published.emplace(x.publish_topic);
+  for (const auto& msg : x.messages)
+    published.emplace(msg->topic());
+  std::set<std::string> pending;
+  for (const auto& other : nodes) {
+    if (&other == &x || !is_receiver(other))
+      continue;
+    for (const auto& sub : other.topics) {
+      auto matches = [&sub](const std::string& str) {
+        return caf::starts_with(str, sub);
+      };
+      if (std::any_of(published.begin(), published.end(), matches))
+        pending.emplace(sub);
     }
-    received += n;
   }
+  for (const auto& what : pending)
+    if (!x.ep->await_filter_entry(broker::topic{what}))
+      warn::println(x.name, " did not see a subscription to ", what);
+}
 
-  template <class T>
-  void attach_sink(caf::stream<T> in, caf::actor observer) {
-    if (++connected_streams == 2) {
-      self->send(observer, atom::ack_v);
-      verbose::println(this_node->name, " waits for messages");
+void run_sender(node& x, size_t probe_interval) {
+  verbose::println(x.name, " starts publishing");
+  auto n = x.num_outputs ? *x.num_outputs : x.messages.size();
+  auto t0 = clock_type::now();
+  size_t pushed = 0;
+  auto next = [&x, probe_interval, &pushed] {
+    broker::data_message msg;
+    if (x.messages.empty()) {
+      msg = broker::make_data_message(broker::topic{x.publish_topic},
+                                      broker::data{std::string(x.payload_size,
+                                                               'x')});
+    } else {
+      // Loop through the recording if it contains less entries than we need.
+      msg = x.messages[pushed % x.messages.size()];
     }
-    attach_stream_sink(
-      self, in,
-      [](caf::unit_t&) {
-        // nop
-      },
-      [=](caf::unit_t&, std::vector<T>& xs) { handle_messages(xs.size()); },
-      [=](caf::unit_t&, const caf::error& err) {
-        verbose::println(this_node->name, " stops receiving ",
-                         caf::type_name_v<T>);
-      });
+    if (probe_interval > 0 && pushed % probe_interval == 0)
+      msg = make_probe(msg->topic());
+    return msg;
+  };
+  auto worker = x.ep->publish_all(
+    [] {
+      // Init: nop.
+    },
+    [&](std::deque<broker::data_message>& out, size_t hint) {
+      auto num = std::min(hint, n - pushed);
+      for (size_t i = 0; i < num; ++i) {
+        out.emplace_back(next());
+        ++pushed;
+      }
+      // Make some noise every 1k messages.
+      if ((pushed - num) / 1000 != pushed / 1000)
+        verbose::println(x.name, " pushed ", pushed, " messages");
+    },
+    [&] { return pushed == n; });
+  x.ep->wait_for(worker);
+  x.stats.sent = n;
+  x.stats.send_time = duration_cast<caf::timespan>(clock_type::now() - t0);
+  verbose::println(x.name, " is done publishing");
+}
+
+void run_receiver(node& x, clock_type::time_point t0,
+                  clock_type::time_point deadline) {
+  verbose::println(x.name, " waits for messages");
+  auto& st = x.stats;
+  std::vector<broker::data_message> buf;
+  while (st.received < x.num_inputs) {
+    st.peak_backlog = std::max(st.peak_backlog, x.sub->available());
+    if (x.sub->poll(buf, x.num_inputs - st.received) == 0) {
+      if (clock_type::now() >= deadline) {
+        warn::println(x.name, " timed out after receiving ", st.received,
+                      " of ", x.num_inputs, " messages");
+        return;
+      }
+      buf = x.sub->get(1, std::chrono::milliseconds(100));
+    }
+    auto ts = broker::now();
+    for (const auto& msg : buf)
+      if (auto sent_at = probe_time(msg))
+        st.latencies.emplace_back(ts - *sent_at);
+    // Make some noise every 1k messages.
+    if (st.received / 1000 != (st.received + buf.size()) / 1000)
+      verbose::println(x.name, " got ", st.received + buf.size(), " messages");
+    st.received += buf.size();
   }
+  st.receive_time = duration_cast<caf::timespan>(clock_type::now() - t0);
+  verbose::println(x.name, " reached its limit");
+}
 
-  size_t received = 0;
-  node* this_node;
-  caf::event_based_actor* self;
-  size_t connected_streams = 0;
-  std::chrono::steady_clock::time_point start;
-  caf::actor observer;
+// -- result reporting ---------------------------------------------------------
 
-  static inline const char* name = "broker.benchmark.consumer";
-};
+double to_seconds(caf::timespan x) {
+  return duration_cast<fractional_seconds>(x).count();
+}
 
-caf::behavior consumer(caf::stateful_actor<consumer_state>* self,
-                       node* this_node, caf::actor core, caf::actor observer) {
-  self->state.this_node = this_node;
-  self->state.observer = observer;
-  self->send(self * core, atom::join_v, topics(*this_node));
-  self->send(self * core, atom::join_v, atom::data_store_v, topics(*this_node));
-  if (!verbose::enabled())
-    return {
-      [=](caf::stream<broker::data_message> in) {
-        self->state.attach_sink(in, observer);
-      },
-      [=](caf::stream<broker::command_message> in) {
-        self->state.attach_sink(in, observer);
-      },
-    };
-  size_t last_printed_count = 0;
-  return {
-    [=](caf::stream<broker::data_message> in) {
-      self->state.attach_sink(in, observer);
-    },
-    [=](caf::stream<broker::command_message> in) {
-      self->state.attach_sink(in, observer);
-    },
-    caf::after(std::chrono::seconds(1)) >>
-      [=]() mutable {
-        if (last_printed_count != self->state.received) {
-          verbose::println(this_node->name,
-                           " received nothing for 1s, last count: ",
-                           self->state.received);
-          last_printed_count = self->state.received;
-        }
-      },
-  };
+double rate(size_t n, caf::timespan t) {
+  auto secs = to_seconds(t);
+  return secs > 0 ? static_cast<double>(n) / secs : 0.0;
 }
 
-void run_receive_mode(node_manager_actor* self, caf::actor observer) {
-  auto this_node = self->state.this_node;
-  auto core = native(self->state.ep.core());
-  auto c = self->spawn(consumer, this_node, core, observer);
-  self->state.children.emplace_back(c);
+double to_ms(broker::timespan x) {
+  using fractional_ms = std::chrono::duration<double, std::milli>;
+  return duration_cast<fractional_ms>(x).count();
 }
 
-// Using to_string on the host directly can result in surrounding quotes if the
-// host type is stored as a string.
-std::string host_to_string(const caf::uri::host_type& x) {
-  auto f = [](const auto& inner) -> std::string {
-    using inner_type = std::decay_t<decltype(inner)>;
-    if constexpr (std::is_same_v<inner_type, std::string>)
-      return inner;
-    else
-      return to_string(inner);
-  };
-  return caf::visit(f, x);
+/// Returns the latency at percentile `p`.
+/// @pre `xs` is sorted and not empty
+broker::timespan percentile(const std::vector<broker::timespan>& xs,
+                            double p) {
+  auto index = static_cast<size_t>(p * static_cast<double>(xs.size() - 1));
+  return xs[index];
 }
 
-caf::error try_connect(broker::endpoint& ep, broker::status_subscriber& ss,
-                       const node* this_node, const node* peer) {
-  const auto& authority = peer->id.authority();
-  auto host = host_to_string(authority.host);
-  ep.peer(host, authority.port, broker::timeout::seconds(1));
-  for (;;) {
-    auto ss_res = ss.get();
-    using namespace broker;
-    if (holds_alternative<none>(ss_res))
-      continue;
-    if (auto err = get_if<error>(&ss_res))
-      return internal::native(*err);
-    BROKER_ASSERT(holds_alternative<status>(ss_res));
-    auto& ss_stat = get<status>(ss_res);
-    auto code = ss_stat.code();
-    if (code == sc::unspecified)
-      continue;
-    if (code == sc::peer_removed || code == sc::peer_lost)
-      return caf::make_error(caf::sec::runtime_error, this_node->name,
-                             "lost connection to a peer");
-    BROKER_ASSERT(code == sc::peer_added);
-    if (auto ctx = ss_stat.context<endpoint_info>()) {
-      auto& net = ctx->network;
-      if (net && net->address == host && net->port == authority.port)
-        return caf::none;
+std::string json_escape(std::string_view str) {
+  std::string result;
+  for (auto ch : str) {
+    if (ch == '"' || ch == '\\')
+      result += '\\';
+    result += ch;
+  }
+  return result;
+}
+
+void print_text(std::vector<node>& nodes, caf::timespan runtime) {
+  for (auto& x : nodes) {
+    auto& st = x.stats;
+    if (is_sender(x))
+      out::println(x.name, " (sending): ",
+                   duration_cast<fractional_seconds>(st.send_time), ", ",
+                   rate(st.sent, st.send_time), " msg/s");
+    if (is_receiver(x)) {
+      out::println(x.name, " (receiving): ",
+                   duration_cast<fractional_seconds>(st.receive_time), ", ",
+                   rate(st.received, st.receive_time), " msg/s");
+      if (!st.latencies.empty())
+        out::println(x.name, " (latency): p50 ",
+                     to_ms(percentile(st.latencies, 0.5)), "ms, p90 ",
+                     to_ms(percentile(st.latencies, 0.9)), "ms, p99 ",
+                     to_ms(percentile(st.latencies, 0.99)), "ms, max ",
+                     to_ms(st.latencies.back()), "ms");
     }
   }
+  out::println("system: ", duration_cast<fractional_seconds>(runtime), ", ",
+               max_rss_kb(), " KiB max RSS");
 }
 
-caf::behavior node_manager(node_manager_actor* self, node* this_node) {
-  self->state.init(this_node);
-  // Make sure we subscribe to all topics locally *before* we initiate peering.
-  // Otherwise, we get a race on the topics and can "loose" initial messages.
-  // Despite its name, endpoint::forward does not force any forwarding. It only
-  // makes sure that the topic is in our local filter.
-  if (is_receiver(*this_node))
-    self->state.ep.forward(topics(*this_node));
-  return {
-    [=](atom::init) -> caf::result<atom::ok> {
-      // Open up the ports and start peering.
-      auto& st = self->state;
-      if (this_node->id.scheme() == "tcp") {
-        auto& authority = this_node->id.authority();
-        auto addr = host_to_string(authority.host);
-        verbose::println(this_node->name, " starts listening at ", addr, ":",
-                         authority.port);
-        auto port = st.ep.listen(addr, authority.port);
-        if (port != authority.port) {
-          err::println(this_node->name, " opened port ", port, " instead of ",
-                       authority.port);
-          return make_error(caf::sec::runtime_error, this_node->name,
-                            "listening failed");
-        }
-      }
-      // Connect to all peers and wait for handshake success.
-      if (!this_node->right.empty()) {
-        auto ss = st.ep.make_status_subscriber(true);
-        for (const auto* peer : this_node->right) {
-          verbose::println(this_node->name, " starts peering to ",
-                           peer->id.authority(), " (", peer->name, ")");
-          // Try to connect up to 5 times per peer before giving up.
-          auto connected = false;
-          for (int i = 1; !connected && i <= 5; ++i) {
-            if (auto err = try_connect(st.ep, ss, this_node, peer)) {
-              if (i == 5) {
-                err::println(this_node->name,
-                             " received an error while trying to peer to ",
-                             peer->name, " on the 5th try: ", err);
-                return std::move(err);
-              } else {
-                verbose::println(this_node->name,
-                                 " received an error while trying to peer to ",
-                                 peer->name, " (try again): ", err);
-              }
-            } else {
-              verbose::println(this_node->name, " successfully peered to ",
-                               peer->id, " (", peer->name, ")");
-              connected = true;
-            }
-          }
-        }
-      }
-      if (is_sender(*this_node)) {
-        using broker::internal::make_generator_file_reader;
-        st.generator = make_generator_file_reader(this_node->generator_file);
-        if (st.generator == nullptr)
-          return make_error(caf::sec::cannot_open_file,
-                            this_node->generator_file);
-      }
-      verbose::println(this_node->name, " up and running");
-      return atom::ok_v;
-    },
-    [=](atom::read, caf::actor observer) { run_receive_mode(self, observer); },
-    [=](atom::write, caf::actor observer) { run_send_mode(self, observer); },
-    [=](atom::shutdown) -> caf::result<atom::ok> {
-      for (auto& child : self->state.children)
-        self->send_exit(child, caf::exit_reason::user_shutdown);
-      // Tell broker to shutdown. This is a blocking function call.
-      self->state.ep.shutdown();
-      verbose::println(this_node->name, " down");
-      return atom::ok_v;
-    },
+void print_json(std::vector<node>& nodes, caf::timespan runtime,
+                bool complete) {
+  std::string str;
+  auto add = [&str](auto&&... xs) {
+    auto f = [&str](const auto& x) {
+      using x_type = std::decay_t<decltype(x)>;
+      if constexpr (std::is_arithmetic_v<x_type>)
+        str += std::to_string(x);
+      else
+        str += x;
+    };
+    (f(xs), ...);
   };
+  add("{\n  \"system\": {\"runtime\": ", to_seconds(runtime),
+      ", \"max-rss-kb\": ", max_rss_kb(),
+      ", \"complete\": ", complete ? "true" : "false", "},\n");
+  add("  \"nodes\": {");
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    auto& x = nodes[i];
+    auto& st = x.stats;
+    add(i == 0 ? "\n" : ",\n", "    \"", json_escape(x.name), "\": {");
+    add("\"sent\": ", st.sent, ", \"send-time\": ", to_seconds(st.send_time),
+        ", \"send-rate\": ", rate(st.sent, st.send_time));
+    add(", \"expected\": ", x.num_inputs, ", \"received\": ", st.received,
+        ", \"receive-time\": ", to_seconds(st.receive_time),
+        ", \"receive-rate\": ", rate(st.received, st.receive_time),
+        ", \"peak-backlog\": ", st.peak_backlog);
+    if (!st.latencies.empty())
+      add(", \"latency-ms\": {\"samples\": ", st.latencies.size(),
+          ", \"p50\": ", to_ms(percentile(st.latencies, 0.5)),
+          ", \"p90\": ", to_ms(percentile(st.latencies, 0.9)),
+          ", \"p99\": ", to_ms(percentile(st.latencies, 0.99)),
+          ", \"max\": ", to_ms(st.latencies.back()), "}");
+    add("}");
+  }
+  add("\n  }\n}");
+  out::println(str);
 }
 
-void launch(caf::actor_system& sys, node& x) {
-  x.mgr = sys.spawn<caf::detached>(node_manager, &x);
+/// Runs the benchmark for a fully configured set of nodes.
+int run_benchmark(std::vector<node>& nodes, const parameters& params) {
+  // Spin up all endpoints and open up the ports before starting to peer.
+  for (auto& x : nodes)
+    init(x);
+  for (auto& x : nodes)
+    if (!listen(x))
+      return EXIT_FAILURE;
+  for (auto& x : nodes)
+    if (!connect(x) || !load(x))
+      return EXIT_FAILURE;
+  verbose::println("wait for subscriptions to propagate");
+  for (auto& x : nodes)
+    if (is_sender(x))
+      await_subscriptions(x, nodes);
+  verbose::println("all nodes are up and running, run benchmark");
+  // Start the actual benchmark by spinning up all receivers and senders.
+  auto t0 = clock_type::now();
+  auto deadline = t0 + std::chrono::seconds(params.timeout);
+  std::vector<std::thread> threads;
+  for (auto& x : nodes) {
+    if (is_receiver(x))
+      threads.emplace_back(
+        [&x, t0, deadline] { run_receiver(x, t0, deadline); });
+    if (is_sender(x))
+      threads.emplace_back([&x, &params] {
+        run_sender(x, static_cast<size_t>(params.probe_interval));
+      });
+  }
+  for (auto& hdl : threads)
+    hdl.join();
+  auto runtime = duration_cast<caf::timespan>(clock_type::now() - t0);
+  auto complete = std::all_of(nodes.begin(), nodes.end(), [](const node& x) {
+    return x.stats.received >= x.num_inputs;
+  });
+  for (auto& x : nodes)
+    std::sort(x.stats.latencies.begin(), x.stats.latencies.end());
+  if (params.json)
+    print_json(nodes, runtime, complete);
+  else
+    print_text(nodes, runtime);
+  // Shutdown all endpoints.
+  verbose::println("shut down all nodes");
+  for (auto& x : nodes) {
+    x.sub.reset();
+    x.ep->shutdown();
+  }
+  verbose::println("all nodes done, bye 👋");
+  return complete ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 // -- utility functions --------------------------------------------------------
@@ -738,7 +813,7 @@ bool verify_node_tree(std::vector<node>& nodes) {
   }
   // Sanity check: there must at least one sender.
   if (std::none_of(nodes.begin(), nodes.end(), is_sender)) {
-    err::println("no node has a generator file for publishing data");
+    err::println("no node has a recording file or topic for publishing data");
     return false;
   }
   // Sanity check: each nodes must send and/or receive.
@@ -753,308 +828,63 @@ bool verify_node_tree(std::vector<node>& nodes) {
   return true;
 }
 
-int generate_config(string_list directories) {
-  constexpr const char* required_files[] = {
-    "/id.txt", "/messages.dat", "/peers.txt", "/topics.txt", "/broker.conf",
-  };
-  // Make sure we always produce a stable config file that does not depend on
-  // argument ordering.
-  std::sort(directories.begin(), directories.end());
-  // Remove trailing slashes to make working with the directories easier.
-  verbose::println("scan ", directories.size(), " directories");
-  for (auto& directory : directories) {
-    while (caf::ends_with(directory, "/"))
-      directory.pop_back();
-    if (!is_directory(directory)) {
-      err::println('\"', directory, "\" is not a directory");
-      return EXIT_FAILURE;
-    }
-  }
-  // Use the directory name as node name and read directory contents.
-  verbose::println("read recorded files and build node tree");
-  std::map<std::string, std::string> node_to_handle;
-  std::map<std::string, std::string> handle_to_node;
-  std::vector<node> nodes;
-  verbose::println("first pass: extract IDs, config and subscriptions");
-  for (const auto& directory : directories) {
-    verbose::println("scan ", directory);
-    for (auto fname : required_files) {
-      auto fpath = directory + fname;
-      if (!is_file(fpath)) {
-        err::println("missing file: ", fpath);
-        return EXIT_FAILURE;
+int dump_stats(const caf::settings& cluster_config) {
+  std::vector<string> file_names;
+  std::function<void(const caf::settings&)> read_file_names;
+  read_file_names = [&](const caf::settings& xs) {
+    for (const auto& kvp : xs) {
+      if (auto fname = get_if<string>(&kvp.second);
+          fname && kvp.first == "recording-file") {
+        file_names.emplace_back(*fname);
+      } else if (auto submap = get_if<caf::settings>(&kvp.second)) {
+        read_file_names(*submap);
       }
     }
-    verbose::println("extract the node name and check uniqueness");
-    std::string name;
-    auto sep = directory.find_last_of('/');
-    if (sep != std::string::npos)
-      name = directory.substr(sep + 1);
-    else
-      name = directory;
-    if (node_by_name(nodes, name) != nullptr) {
-      err::println("node name \"", name, "\" appears twice");
-      return EXIT_FAILURE;
-    }
-    nodes.emplace_back();
-    auto& node = nodes.back();
-    node.name = name;
-    verbose::println("read id.txt and make sure it contains a unique ID");
-    auto handle = trim(read(directory + "/id.txt"));
-    if (handle.empty()) {
-      err::println("empty file: ", directory + "/id.txt");
-      return EXIT_FAILURE;
-    }
-    auto predicate = [&](const std::pair<const std::string, std::string>& x) {
-      return x.second == handle;
-    };
-    if (handle_to_node.count(handle) != 0) {
-      err::println("node ID: ", handle, " appears twice");
-      return EXIT_FAILURE;
-    }
-    node_to_handle.emplace(name, handle);
-    handle_to_node.emplace(handle, name);
-    // Set various node fields.
-    auto to_set = [](std::vector<std::string>&& xs) {
-      return std::set<std::string>{std::make_move_iterator(xs.begin()),
-                                   std::make_move_iterator(xs.end())};
-    };
-    node.generator_file = directory + "/messages.dat";
-    node.peers = to_set(readlines(directory + "/peers.txt", false));
-    verbose::println("read and de-duplicate topics from topics.txt");
-    node.topics = readlines(directory + "/topics.txt", false);
-    std::sort(node.topics.begin(), node.topics.end());
-    auto e = std::unique(node.topics.begin(), node.topics.end());
-    if (e != node.topics.end())
-      node.topics.erase(e, node.topics.end());
-    verbose::println("fetch config parameters for this node from broker.conf");
-    auto conf_file = directory + "/broker.conf";
-    if (auto conf = actor_system_config::parse_config_file(conf_file.c_str())) {
-      // Older versions of Broker use 'broker.forward' as config parameter.
-      if (auto val = caf::get_if<bool>(std::addressof(*conf), "broker.forward"))
-        node.disable_forwarding = !*val;
-      else
-        node.disable_forwarding =
-          caf::get_or(*conf, "broker.disable-forwarding", false);
-    } else {
-      err::println("unable to parse ", quoted{conf_file}, ": ",
-                   to_string(conf.error()));
-      return EXIT_FAILURE;
-    }
-  }
-  verbose::println("second pass: resolve all peer handles");
-  for (auto& node : nodes) {
-    // Currently, node.peers contains CAF node IDs. Now that we computed unique
-    // names for each peer, we replace the cryptic IDs with the names.
-    std::set<std::string> peer_names;
-    for (auto& peer : node.peers) {
-      if (handle_to_node.count(peer) == 0) {
-        err::println("missing data: cannot resolve peer ID ", peer);
-        return EXIT_FAILURE;
-      }
-      auto peer_name = handle_to_node[peer];
-      if (peer_name == node.name) {
-        err::println("corrupted data: ", peer, " cannot peer with itself");
-        return EXIT_FAILURE;
-      }
-      peer_names.emplace(std::move(peer_name));
-    }
-    std::swap(node.peers, peer_names);
-  }
-  verbose::println("reconstruct node tree");
-  if (!build_node_tree(nodes))
-    return EXIT_FAILURE;
-  // Compute for each node how many messages it produces per topic.
-  verbose::println("read generator files and compute outputs per node",
-                   " (may take a while)");
-  using output_map = std::map<std::string, size_t>;
-  std::map<std::string, output_map> outputs;
-  for (const auto& node : nodes) {
-    auto gptr =
-      broker::internal::make_generator_file_reader(node.generator_file);
-    if (gptr == nullptr) {
-      err::println("unable to open generator file: ", node.generator_file);
-      return EXIT_FAILURE;
-    }
-    auto& out = outputs[node.name];
-    broker::internal::generator_file_reader::value_type value;
-    while (!gptr->at_end()) {
-      if (auto err = gptr->read(value)) {
-        err::println("error while reading generator file ", node.generator_file,
-                     ": ", err);
-        return EXIT_FAILURE;
-      }
-      out[get_topic(value).string()] += 1;
-    }
-  }
-  // Now we compute the inputs at each node.
-  using filter = std::vector<std::string>;
-  auto concat_filters = [](const filter& x, const filter& y) {
-    filter result;
-    std::set_intersection(x.begin(), x.end(), y.begin(), y.end(),
-                          std::back_inserter(result));
-    return result;
-  };
-  auto step = [](node& src, node& dst, const output_map& out, const filter& f) {
-    using caf::starts_with;
-    size_t num_inputs = 0;
-    for (auto& kvp : out) {
-      auto matches = [&](const string& x) { return starts_with(kvp.first, x); };
-      if (std::any_of(f.begin(), f.end(), matches))
-        num_inputs += kvp.second;
-    }
-    if (num_inputs > 0) {
-      dst.num_inputs += num_inputs;
-      dst.inputs_by_node[src.name] += num_inputs;
-    }
-  };
-  using walk_fun = std::function<std::vector<node*>(const node&)>;
-  walk_fun walk_left = [](const node& n) { return n.left; };
-  walk_fun walk_right = [](const node& n) { return n.right; };
-  using traverse_t = void(node&, node&, const output_map&, const filter&,
-                          walk_fun);
-  std::function<traverse_t> traverse;
-  traverse = [&](node& src, node& dst, const output_map& out, const filter& f,
-                 walk_fun walk) {
-    step(src, dst, out, f);
-    if (dst.disable_forwarding)
-      return;
-    // TODO: take TTL counter into consideration
-    for (auto peer : walk(dst)) {
-      auto f_peer = concat_filters(f, peer->topics);
-      if (!f_peer.empty())
-        traverse(src, *peer, out, f, walk);
-    }
   };
-  for (auto& node : nodes) {
-    const auto& out = outputs[node.name];
-    step(node, node, out, node.topics);
-    for (auto peer : node.left)
-      traverse(node, *peer, out, peer->topics, walk_left);
-    for (auto peer : node.right)
-      traverse(node, *peer, out, peer->topics, walk_right);
+  if (auto nodes = get_if<caf::settings>(&cluster_config, "nodes"))
+    read_file_names(*nodes);
+  if (file_names.empty()) {
+    err::println("no recording files found in config");
+    return EXIT_FAILURE;
   }
-  verbose::println("compute inputs per node");
-  // Finally, we need to assign IDs. We simply use localhost with increasing
-  // port number for any node with incoming connections.
-  verbose::println("generate IDs for all nodes");
-  uint16_t port = 8000;
-  for (auto& node : nodes) {
-    std::string uri_str;
-    if (node.left.empty()) {
-      uri_str += "local:";
-      uri_str += node.name;
-    } else {
-      uri_str += "tcp://127.0.0.1:";
-      uri_str += std::to_string(port++);
+  for (const auto& file_name : file_names) {
+    auto msgs = broker::internal::flight_recorder::load(file_name);
+    if (!msgs) {
+      err::println("unable to load recording file: ", file_name);
+      continue;
     }
-    if (auto err = caf::parse(uri_str, node.id)) {
-      err::println("generated invalid URI ID: \"", uri_str, "\"");
-      return EXIT_FAILURE;
+    size_t data_entries = 0;
+    size_t command_entries = 0;
+    std::map<std::string, size_t> entries_by_topic;
+    for (const auto& msg : *msgs) {
+      if (get_type(msg) == broker::envelope_type::data)
+        ++data_entries;
+      else
+        ++command_entries;
+      entries_by_topic[std::string{msg->topic()}] += 1;
     }
-  }
-  // Print generated config and return.
-  verbose::println("done 🎉");
-  auto print_field = [&](const char* name, const auto& xs) {
-    if (xs.empty())
-      return;
-    out::println("    ", name, " = [");
-    for (const auto& x : xs)
-      out::println("      ", quoted{x}, ",");
-    out::println("    ]");
-  };
-  out::println("nodes {");
-  for (const auto& node : nodes) {
-    out::println("  ", node.name, " {");
-    out::println("    id = <", node.id, ">");
-    if (node.num_inputs > 0) {
-      out::println("    num-inputs = ", node.num_inputs);
-      out::println("    inputs-by-node {");
-      for (auto& kvp : node.inputs_by_node)
-        out::println("      ", kvp.first, " = ", kvp.second);
-      out::println("    }");
+    out::println(file_name);
+    out::println("├── entries: ", msgs->size());
+    out::println("|   ├── data-entries: ", data_entries);
+    out::println("|   └── command-entries: ", command_entries);
+    out::println("└── topics:");
+    if (!entries_by_topic.empty()) {
+      auto i = entries_by_topic.begin();
+      auto e = std::prev(entries_by_topic.end());
+      for (; i != e; ++i)
+        out::println("    ├── ", i->first, " (", i->second, ")");
+      out::println("    └── ", i->first, " (", i->second, ")");
     }
-    out::println("    disable_forwarding = ", node.disable_forwarding);
-    print_field("topics", node.topics);
-    print_field("peers", node.peers);
-    if (!node.generator_file.empty() && !outputs[node.name].empty())
-      out::println("    generator-file = ", quoted{node.generator_file});
-    out::println("  }");
   }
-  out::println("}");
   return EXIT_SUCCESS;
 }
 
-int shrink_generator_file(const string& in_file, const string& out_file,
-                          size_t new_size) {
-  if (!broker::detail::is_file(in_file)) {
-    err::println("input file ", in_file, " not found");
-    return EXIT_FAILURE;
-  }
-  if (broker::detail::is_file(out_file)) {
-    err::println("output file ", out_file, " already exists");
-    return EXIT_FAILURE;
-  }
-  auto gptr = broker::internal::make_generator_file_reader(in_file);
-  if (gptr == nullptr) {
-    err::println("unable to open ", in_file, " as generator file");
-    return EXIT_FAILURE;
-  }
-  auto out = fopen(out_file.c_str(), "w");
-  if (out == nullptr) {
-    err::println("unable to open ", out_file, " for writing");
-    return EXIT_FAILURE;
-  }
-  using format = broker::internal::generator_file_writer::format;
-  auto out_guard = caf::detail::make_scope_guard([out] { fclose(out); });
-  auto header = format::header();
-  if (fwrite(header.data(), 1, header.size(), out) != header.size()) {
-    err::println("unable to write to ", out_file);
-    return EXIT_FAILURE;
-  }
-  int return_code = EXIT_SUCCESS;
-  using value_type = broker::internal::generator_file_reader::value_type;
-  using bytes = caf::span<const caf::byte>;
-  auto f = [&, i{size_t{0}}](value_type* val, bytes chunk) mutable {
-    if (fwrite(chunk.data(), 1, chunk.size(), out) != chunk.size()) {
-      err::println("unable to write to ", out_file);
-      return_code = EXIT_FAILURE;
-      return false;
-    }
-    if (val && ++i == new_size)
-      return false;
-    return true;
-  };
-  if (auto err = gptr->read_raw(f)) {
-    err::println("error while reading the generator file ", to_string(err));
-    return EXIT_FAILURE;
-  }
-  return return_code;
-}
-
-int shrink_generator_file(string_list args) {
-  if (args.size() != 3) {
-    err::println("invalid arguments to shrink-generator-file mode");
-    err::println("expected three positional arguments: INPUT OUTPUT NEW_SIZE");
-    return EXIT_FAILURE;
-  }
-  size_t new_size;
-  try {
-    new_size = std::stoul(args[2]);
-  } catch (std::exception& ex) {
-    err::println("unable to parse NEW_SIZE argument: ", ex.what());
-    err::println("expected three positional arguments: INPUT OUTPUT NEW_SIZE");
-    return EXIT_FAILURE;
-  }
-  return shrink_generator_file(args[0], args[1], new_size);
-}
-
 // -- main ---------------------------------------------------------------------
 
 void print_peering_node(const std::string& prefix, const node& x, bool is_last,
                         std::set<std::string>& printed_nodes) {
-  caf::string_view first_prefix;
-  caf::string_view inner_prefix;
+  std::string_view first_prefix;
+  std::string_view inner_prefix;
   auto print_topics = [&] {
     if (printed_nodes.count(x.name) != 0) {
       verbose::println(prefix, inner_prefix, "│   └── (see above)");
@@ -1094,152 +924,73 @@ void print_peering_node(const std::string& prefix, const node& x, bool is_last,
                        printed_nodes);
 }
 
-enum program_mode_t {
-  invalid_mode,
-  benchmark_mode,
-  dump_stats_mode,
-  generate_config_mode,
-  shrink_generator_file_mode,
-};
-
-program_mode_t get_mode(const config& cfg) {
-  auto mode_str = get_if<std::string>(&cfg, "mode");
-  if (!mode_str || *mode_str == "benchmark")
-    return benchmark_mode;
-  else if (*mode_str == "dump-stats")
-    return dump_stats_mode;
-  else if (*mode_str == "generate-config")
-    return generate_config_mode;
-  else if (*mode_str == "shrink-generator-file")
-    return shrink_generator_file_mode;
-  else
-    return invalid_mode;
-}
-
 int main(int argc, char** argv) {
-  broker::configuration::init_global_state();
-  // Read CAF configuration.
-  config cfg;
-  if (auto err = cfg.parse(argc, argv)) {
-    err::println("unable to parse CAF config: ", to_string(err));
+  // Read CLI options.
+  broker::configuration cfg{broker::skip_init};
+  parameters params;
+  add_options(cfg, params);
+  try {
+    cfg.init(argc, argv);
+  } catch (std::exception& ex) {
+    err::println("unable to parse CLI options: ", ex.what());
     return EXIT_FAILURE;
   }
   // Exit for `--help` etc.
-  if (cfg.cli_helptext_printed)
+  if (cfg.cli_helptext_printed())
     return EXIT_SUCCESS;
-  // Enable global flags and fetch mode of operation.
-  if (get_or(cfg, "verbose", false))
-    verbose::is_enabled = true;
-  auto mode = get_mode(cfg);
-  if (mode == invalid_mode) {
+  if (params.mode != "benchmark" && params.mode != "dump-stats") {
     err::println("invalid mode");
     return EXIT_FAILURE;
   }
-  // Dispatch to modes that don't read a cluster config.
-  if (mode == generate_config_mode)
-    return generate_config(cfg.remainder);
-  else if (mode == shrink_generator_file_mode)
-    return shrink_generator_file(cfg.remainder);
   // Read cluster config.
-  auto excluded_nodes = get_or(cfg, "excluded-nodes", string_list{});
   auto is_excluded = [&](const string& node_name) {
-    auto e = excluded_nodes.end();
-    return std::find(excluded_nodes.begin(), e, node_name) != e;
+    const auto& xs = params.excluded_nodes;
+    return std::find(xs.begin(), xs.end(), node_name) != xs.end();
   };
   caf::settings cluster_config;
-  if (auto path = get_if<string>(&cfg, "cluster-config-file")) {
-    if (*path == "-") {
-      if (auto file_content = config::parse_config(std::cin)) {
-        cluster_config = std::move(*file_content);
-      } else {
-        err::println("unable to parse cluster config from STDIN");
-        return EXIT_FAILURE;
-      }
-    } else if (auto file_content = config::parse_config_file(path->c_str())) {
+  if (params.cluster_config_file.empty()) {
+    err::println("cluster-config-file missing (see --help)");
+    return EXIT_FAILURE;
+  } else if (params.cluster_config_file == "-") {
+    if (auto file_content = caf::actor_system_config::parse_config(std::cin)) {
       cluster_config = std::move(*file_content);
     } else {
-      err::println("unable to parse cluster config file: ",
-                   to_string(file_content.error()));
+      err::println("unable to parse cluster config from STDIN");
       return EXIT_FAILURE;
     }
+  } else if (auto file_content = caf::actor_system_config::parse_config_file(
+               params.cluster_config_file.c_str())) {
+    cluster_config = std::move(*file_content);
   } else {
-    err::println("cluster-config-file missing");
-    out::println();
-    out::println(cfg.usage());
+    err::println("unable to parse cluster config file: ",
+                 to_string(file_content.error()));
     return EXIT_FAILURE;
   }
   // Check for dump-stats mode.
-  if (mode == dump_stats_mode) {
-    std::vector<string> file_names;
-    std::function<void(const caf::settings&)> read_file_names;
-    read_file_names = [&](const caf::settings& xs) {
-      for (const auto& kvp : xs) {
-        if (kvp.first == "generator-file"
-            && holds_alternative<string>(kvp.second)) {
-          file_names.emplace_back(get<string>(kvp.second));
-        } else if (auto submap = get_if<caf::settings>(&kvp.second)) {
-          read_file_names(*submap);
-        }
-      }
-    };
-    read_file_names(cluster_config["nodes"].as_dictionary());
-    if (file_names.empty()) {
-      err::println("no generator files found in config");
-      return EXIT_FAILURE;
-    }
-    for (const auto& file_name : file_names) {
-      auto gptr = broker::internal::make_generator_file_reader(file_name);
-      if (gptr == nullptr) {
-        err::println("unable to open generator file: ", file_name);
+  if (params.mode == "dump-stats")
+    return dump_stats(cluster_config);
+  // Generate nodes from cluster config.
+  std::vector<node> nodes;
+  if (auto node_configs = get_if<caf::settings>(&cluster_config, "nodes")) {
+    for (auto& kvp : *node_configs) {
+      if (is_excluded(kvp.first))
         continue;
+      auto node_config = get_if<caf::settings>(&kvp.second);
+      if (!node_config) {
+        err::println("invalid config for node '", kvp.first, "'");
+        return EXIT_FAILURE;
       }
-      size_t total_entries = 0;
-      size_t data_entries = 0;
-      size_t command_entries = 0;
-      std::map<broker::topic, size_t> entries_by_topic;
-      broker::node_message_content x;
-      while (!gptr->at_end()) {
-        if (auto err = gptr->read(x)) {
-          err::println("error while parsing ", file_name, ": ", to_string(err));
-          return EXIT_FAILURE;
-        }
-        ++total_entries;
-        if (is_data_message(x))
-          ++data_entries;
-        else
-          ++command_entries;
-        entries_by_topic[get_topic(x)] += 1;
-      }
-      out::println(file_name);
-      out::println("├── entries: ", total_entries);
-      out::println("|   ├── data-entries: ", data_entries);
-      out::println("|   └── command-entries: ", command_entries);
-      out::println("└── topics:");
-      if (!entries_by_topic.empty()) {
-        auto i = entries_by_topic.begin();
-        auto e = std::prev(entries_by_topic.end());
-        for (; i != e; ++i)
-          out::println("    ├── ", i->first.string(), " (", i->second, ")");
-        out::println("    └── ", i->first.string(), " (", i->second, ")");
+      if (auto x = make_node(kvp.first, *node_config)) {
+        nodes.emplace_back(std::move(*x));
+      } else {
+        err::println("invalid config for node '", kvp.first,
+                     "': ", to_string(x.error()));
+        return EXIT_FAILURE;
       }
     }
-    return EXIT_SUCCESS;
-  }
-  // Generate nodes from cluster config.
-  std::vector<node> nodes;
-  for (auto& kvp : cluster_config["nodes"].as_dictionary()) {
-    if (is_excluded(kvp.first))
-      continue;
-    if (auto x = make_node(kvp.first, kvp.second.as_dictionary())) {
-      nodes.emplace_back(std::move(*x));
-    } else {
-      err::println("invalid config for node '", kvp.first,
-                   "': ", to_string(x.error()));
-      return EXIT_FAILURE;
-    }
   }
   // Fix settings when running only a partial setup.
-  if (!excluded_nodes.empty()) {
+  if (!params.excluded_nodes.empty()) {
     if (nodes.empty()) {
       err::println("no nodes left after applying node filter");
       return EXIT_FAILURE;
@@ -1294,77 +1045,5 @@ int main(int argc, char** argv) {
     }
   }
   // Get rollin'.
-  caf::actor_system sys{cfg};
-  for (auto& x : nodes)
-    launch(sys, x);
-  caf::scoped_actor self{sys};
-  auto wait_for_ack_messages = [&](size_t num) {
-    size_t i = 0;
-    self->receive_for(i, num)(
-      [](atom::ack) {
-        // All is well.
-      },
-      [&](caf::error& err) { throw std::move(err); });
-  };
-  auto wait_for_ok_messages = [&](size_t num) {
-    size_t i = 0;
-    self->receive_for(i, num)(
-      [](atom::ok) {
-        // All is well.
-      },
-      [](atom::ok, atom::write, const std::string& node_name,
-         caf::timespan runtime) {
-        out::println(node_name, " (sending): ",
-                     duration_cast<fractional_seconds>(runtime));
-      },
-      [](atom::ok, atom::read, const std::string& node_name,
-         caf::timespan runtime) {
-        out::println(node_name, " (receiving): ",
-                     duration_cast<fractional_seconds>(runtime));
-      },
-      [&](caf::error& err) { throw std::move(err); });
-  };
-  try {
-    // Initialize all nodes.
-    for (auto& x : nodes)
-      self->send(x.mgr, atom::init_v);
-    wait_for_ok_messages(nodes.size());
-    verbose::println("all nodes are up and running, run benchmark");
-    // First, we spin up all readers to make sure they receive published data.
-    size_t receiver_acks = 0;
-    for (auto& x : nodes)
-      if (is_receiver(x)) {
-        self->send(x.mgr, atom::read_v, self);
-        ++receiver_acks;
-      }
-    wait_for_ack_messages(receiver_acks);
-    // Start actual benchmark by spinning up all senders.
-    auto t0 = std::chrono::steady_clock::now();
-    for (auto& x : nodes)
-      if (is_sender(x))
-        self->send(x.mgr, atom::write_v, self);
-    auto ok_count = [](size_t interim, const node& x) {
-      return interim + (is_sender_and_receiver(x) ? 2 : 1);
-    };
-    wait_for_ok_messages(
-      std::accumulate(nodes.begin(), nodes.end(), size_t{0}, ok_count));
-    auto t1 = std::chrono::steady_clock::now();
-    out::println("system: ", duration_cast<fractional_seconds>(t1 - t0));
-    // Shutdown all endpoints.
-    verbose::println("shut down all nodes");
-    for (auto& x : nodes)
-      self->send(x.mgr, atom::shutdown_v);
-    wait_for_ok_messages(nodes.size());
-    for (auto& x : nodes)
-      self->send_exit(x.mgr, caf::exit_reason::user_shutdown);
-    for (auto& x : nodes) {
-      self->wait_for(x.mgr);
-      x.mgr = nullptr;
-    }
-    verbose::println("all nodes done, bye 👋");
-    return EXIT_SUCCESS;
-  } catch (caf::error err) {
-    err::println("fatal error: ", to_string(err));
-    abort();
-  }
+  return run_benchmark(nodes, params);
 }
@@ -0,0 +1,545 @@
+// Measures how quickly a single node accepts many peerings. One listener
+// accepts connections from N endpoints that all try to peer at the same time.
+// Afterwards, the program restarts the listener a couple of times and measures
+// how long it takes until all endpoints have reconnected.
+
+#include "broker/configuration.hh"
+#include "broker/defaults.hh"
+#include "broker/endpoint.hh"
+#include "broker/endpoint_id.hh"
+#include "broker/time.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#  include <dirent.h>
+#  include <fstream>
+#endif
+
+using namespace broker;
+using namespace std::literals;
+
+namespace {
+
+/// Maximum time for establishing all peerings of a single round.
+constexpr timespan round_timeout = 60s;
+
+struct parameters {
+  uint64_t peer_count = 50;
+  uint64_t restarts = 3;
+  uint64_t retry_interval = 1;
+  uint64_t max_pending_handshakes = defaults::max_pending_handshakes;
+  uint64_t scheduler_threads = 2;
+  bool mesh = false;
+  bool tls = false;
+  std::string certificate;
+  std::string key;
+  std::string cafile;
+  std::string output_format = "text";
+  std::vector<std::string> peer_counts;
+  bool verbose = false;
+};
+
+void add_options(configuration& cfg, parameters& ps) {
+  cfg.add_option(&ps.peer_count, "peer-count,n",
+                 "number of endpoints that connect to the listener");
+  cfg.add_option(&ps.restarts, "restarts,r",
+                 "number of times the program restarts the listener");
+  cfg.add_option(&ps.retry_interval, "retry-interval",
+                 "seconds between connection attempts of the endpoints");
+  cfg.add_option(&ps.max_pending_handshakes, "max-pending-handshakes",
+                 "limit for concurrent handshakes per endpoint (0 = none)");
+  cfg.add_option(&ps.scheduler_threads, "scheduler-threads",
+                 "number of scheduler threads per endpoint");
+  cfg.add_option(&ps.mesh, "mesh",
+                 "connect all endpoints with each other instead of only with "
+                 "the listener");
+  cfg.add_option(&ps.tls, "tls", "enables SSL for all peerings");
+  cfg.add_option(&ps.certificate, "certificate",
+                 "path to the certificate for authenticated SSL");
+  cfg.add_option(&ps.key, "key", "path to the private key of the certificate");
+  cfg.add_option(&ps.cafile, "cafile",
+                 "path to the CA file for verifying the certificates");
+  cfg.add_option(&ps.output_format, "output-format",
+                 "print results as 'text' or 'json'");
+  cfg.add_option(&ps.peer_counts, "sweep-peer-counts",
+                 "runs the benchmark once per peer count in the list");
+  cfg.add_option(&ps.verbose, "verbose", "enables more console output");
+}
+
+template <class... Ts>
+void verbose_println(const parameters& ps, Ts&&... xs) {
+  if (!ps.verbose)
+    return;
+  (std::clog << ... << xs);
+  std::clog << '\n';
+}
+
+/// Creates the configuration for a new endpoint.
+configuration make_endpoint_config(const parameters& ps) {
+  broker_options opts;
+  opts.disable_ssl = !ps.tls;
+  opts.ignore_broker_conf = true;
+  opts.max_pending_handshakes = ps.max_pending_handshakes;
+  configuration cfg{opts};
+  cfg.set("caf.scheduler.max-threads", ps.scheduler_threads);
+  if (!ps.certificate.empty()) {
+    cfg.openssl_certificate(ps.certificate);
+    cfg.openssl_key(ps.key);
+    cfg.openssl_cafile(ps.cafile);
+  }
+  return cfg;
+}
+
+/// Creates a new endpoint that listens on `port`. Retries for a couple of
+/// times, because the OS may not release the port of a previous listener
+/// right away.
+std::unique_ptr<endpoint> make_listener(const parameters& ps, uint16_t& port) {
+  for (int attempt = 0; attempt < 50; ++attempt) {
+    auto ep = std::make_unique<endpoint>(make_endpoint_config(ps));
+    if (auto actual = ep->listen("127.0.0.1", port); actual != 0) {
+      port = actual;
+      return ep;
+    }
+    std::this_thread::sleep_for(100ms);
+  }
+  std::cerr << "*** failed to listen on port " << port << '\n';
+  abort();
+}
+
+// -- measuring ----------------------------------------------------------------
+
+/// Collects the times at which endpoints report a new peer.
+class collector {
+public:
+  explicit collector(size_t num_slots) : times_(num_slots) {
+    // nop
+  }
+
+  /// Returns a callback for `await_peer` that stores the current time in the
+  /// slot at `index`.
+  std::function<void(bool)> slot(size_t index) {
+    return [this, index](bool ok) {
+      auto ts = broker::now();
+      std::unique_lock<std::mutex> guard{mtx_};
+      if (ok)
+        times_[index] = ts;
+      else
+        failed_ = true;
+      if (++done_ == times_.size())
+        cv_.notify_all();
+    };
+  }
+
+  /// Blocks until all slots have been filled.
+  /// @returns `false` if any endpoint failed to connect.
+  bool wait() {
+    std::unique_lock<std::mutex> guard{mtx_};
+    cv_.wait(guard, [this] { return done_ == times_.size(); });
+    return !failed_;
+  }
+
+  const std::vector<timestamp>& times() const noexcept {
+    return times_;
+  }
+
+private:
+  std::vector<timestamp> times_;
+  size_t done_ = 0;
+  bool failed_ = false;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
+
+/// Accumulates the CPU time of all connector threads in this process. The
+/// endpoints name these threads `broker.conn`. Reading the CPU time per thread
+/// requires the `/proc` file system. On other platforms, all values remain 0.
+class connector_cpu {
+public:
+  /// Updates the CPU time of all connector threads.
+  /// @returns the IDs of connector threads that did not exist at the previous
+  ///          call.
+  std::vector<std::string> sample() {
+    std::vector<std::string> result;
+#ifdef __linux__
+    auto dir = opendir("/proc/self/task");
+    if (dir == nullptr)
+      return result;
+    while (auto entry = readdir(dir)) {
+      std::string tid = entry->d_name;
+      if (tid == "." || tid == "..")
+        continue;
+      auto base = "/proc/self/task/" + tid;
+      std::string comm;
+      if (std::ifstream in{base + "/comm"}; !std::getline(in, comm)
+                                            || comm != "broker.conn")
+        continue;
+      // The fields 14 and 15 are utime and stime. Since the thread name may
+      // contain spaces, we start parsing after the closing parenthesis.
+      std::string line;
+      if (std::ifstream in{base + "/stat"}; !std::getline(in, line))
+        continue;
+      auto pos = line.rfind(')');
+      if (pos == std::string::npos)
+        continue;
+      std::istringstream fields{line.substr(pos + 1)};
+      std::string skipped;
+      for (int i = 3; i < 14; ++i)
+        fields >> skipped;
+      uint64_t utime = 0;
+      uint64_t stime = 0;
+      if (!(fields >> utime >> stime))
+        continue;
+      if (ticks_.count(tid) == 0)
+        result.emplace_back(tid);
+      ticks_[tid] = utime + stime;
+    }
+    closedir(dir);
+#endif
+    return result;
+  }
+
+  /// Returns the accumulated CPU time of all connector threads, including
+  /// threads that terminated since sampling them.
+  timespan total() const {
+    uint64_t sum = 0;
+    for (auto& [tid, ticks] : ticks_)
+      sum += ticks;
+    return to_timespan(sum);
+  }
+
+  /// Returns the accumulated CPU time of the given threads.
+  timespan total(const std::vector<std::string>& tids) const {
+    uint64_t sum = 0;
+    for (auto& tid : tids)
+      if (auto i = ticks_.find(tid); i != ticks_.end())
+        sum += i->second;
+    return to_timespan(sum);
+  }
+
+private:
+  static timespan to_timespan(uint64_t ticks) {
+    auto ticks_per_second = static_cast<uint64_t>(sysconf(_SC_CLK_TCK));
+    return timespan{1s} * ticks / ticks_per_second;
+  }
+
+  std::map<std::string, uint64_t> ticks_;
+};
+
+/// Returns the CPU time of the entire process.
+timespan process_cpu() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  auto to_timespan = [](const timeval& tv) {
+    return timespan{std::chrono::seconds{tv.tv_sec}}
+           + timespan{std::chrono::microseconds{tv.tv_usec}};
+  };
+  return to_timespan(usage.ru_utime) + to_timespan(usage.ru_stime);
+}
+
+/// Summarizes a single round, i.e., the initial connection storm or a restart
+/// of the listener.
+struct round_result {
+  size_t round = 0;
+  size_t connections = 0;
+  timespan latency_p50{0};
+  timespan latency_p99{0};
+  timespan latency_max{0};
+  timespan full_mesh{0};
+  timespan connector_cpu{0};
+  timespan listener_cpu{0};
+  timespan process_cpu{0};
+};
+
+/// Summarizes a single run of the benchmark.
+struct run_result {
+  uint64_t peer_count = 0;
+  bool mesh = false;
+  bool tls = false;
+  std::vector<round_result> rounds;
+};
+
+/// Returns the element at percentile `p`.
+/// @pre `xs` is sorted
+timespan percentile(const std::vector<timespan>& xs, double p) {
+  if (xs.empty())
+    return timespan{0};
+  return xs[static_cast<size_t>(p * static_cast<double>(xs.size() - 1))];
+}
+
+// -- actual program logic -----------------------------------------------------
+
+/// Bundles the state for measuring a single round.
+class round_recorder {
+public:
+  round_recorder(connector_cpu& cpu, size_t round)
+    : cpu_(cpu), round_(round) {
+    cpu_.sample();
+    cpu_t0_ = cpu_.total();
+    process_t0_ = process_cpu();
+  }
+
+  /// Marks the beginning of the peering at `index`.
+  void start(size_t index, timestamp ts) {
+    if (starts_.size() <= index)
+      starts_.resize(index + 1);
+    starts_[index] = ts;
+  }
+
+  /// Computes the results after all peerings of this round are established.
+  round_result finish(const collector& peerings,
+                      const std::vector<std::string>& listener_tids,
+                      timespan listener_cpu_t0) {
+    cpu_.sample();
+    round_result result;
+    result.round = round_;
+    result.connections = starts_.size();
+    result.connector_cpu = cpu_.total() - cpu_t0_;
+    result.listener_cpu = cpu_.total(listener_tids) - listener_cpu_t0;
+    result.process_cpu = process_cpu() - process_t0_;
+    std::vector<timespan> latencies;
+    auto first = *std::min_element(starts_.begin(), starts_.end());
+    auto last = first;
+    for (size_t i = 0; i < starts_.size(); ++i) {
+      auto ts = peerings.times()[i];
+      latencies.emplace_back(ts - starts_[i]);
+      last = std::max(last, ts);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    result.latency_p50 = percentile(latencies, 0.5);
+    result.latency_p99 = percentile(latencies, 0.99);
+    result.latency_max = percentile(latencies, 1.0);
+    result.full_mesh = last - first;
+    return result;
+  }
+
+private:
+  connector_cpu& cpu_;
+  size_t round_;
+  timespan cpu_t0_;
+  timespan process_t0_;
+  std::vector<timestamp> starts_;
+};
+
+run_result run_once(const parameters& ps) {
+  run_result result;
+  result.peer_count = ps.peer_count;
+  result.mesh = ps.mesh;
+  result.tls = ps.tls;
+  auto retry = timeout::seconds{ps.retry_interval};
+  connector_cpu cpu;
+  cpu.sample();
+  // Create all endpoints up front to exclude the startup from the results.
+  uint16_t listener_port = 0;
+  auto listener = make_listener(ps, listener_port);
+  auto listener_tids = cpu.sample();
+  std::vector<std::unique_ptr<endpoint>> peers;
+  std::vector<uint16_t> ports;
+  for (size_t i = 0; i < ps.peer_count; ++i) {
+    peers.emplace_back(std::make_unique<endpoint>(make_endpoint_config(ps)));
+    if (ps.mesh) {
+      ports.emplace_back(peers.back()->listen("127.0.0.1", 0));
+      if (ports.back() == 0) {
+        std::cerr << "*** endpoint " << i << " failed to listen\n";
+        abort();
+      }
+    }
+  }
+  verbose_println(ps, "created ", ps.peer_count + 1, " endpoints");
+  // Round 0: all endpoints connect at the same time. In mesh mode, each
+  // endpoint also connects to all endpoints with a lower index.
+  {
+    round_recorder rec{cpu, 0};
+    auto listener_cpu_t0 = cpu.total(listener_tids);
+    size_t num_peerings = ps.peer_count;
+    if (ps.mesh)
+      num_peerings += ps.peer_count * (ps.peer_count - 1) / 2;
+    collector peerings{num_peerings};
+    size_t index = 0;
+    auto add = [&](endpoint& src, endpoint& dst, uint16_t port) {
+      src.await_peer(dst.node_id(), peerings.slot(index), round_timeout);
+      rec.start(index++, broker::now());
+      src.peer_nosync("127.0.0.1", port, retry);
+    };
+    for (size_t i = 0; i < peers.size(); ++i) {
+      add(*peers[i], *listener, listener_port);
+      if (ps.mesh)
+        for (size_t j = 0; j < i; ++j)
+          add(*peers[i], *peers[j], ports[j]);
+    }
+    if (!peerings.wait()) {
+      std::cerr << "*** failed to establish all peerings\n";
+      abort();
+    }
+    result.rounds.emplace_back(
+      rec.finish(peerings, listener_tids, listener_cpu_t0));
+    verbose_println(ps, "all endpoints connected");
+  }
+  // Restart the listener and wait until all endpoints have reconnected.
+  for (size_t round = 1; round <= ps.restarts; ++round) {
+    round_recorder rec{cpu, round};
+    listener.reset();
+    listener = make_listener(ps, listener_port);
+    listener_tids = cpu.sample();
+    auto listener_cpu_t0 = cpu.total(listener_tids);
+    collector peerings{peers.size()};
+    auto t0 = broker::now();
+    for (size_t i = 0; i < peers.size(); ++i) {
+      peers[i]->await_peer(listener->node_id(), peerings.slot(i),
+                           round_timeout);
+      rec.start(i, t0);
+    }
+    if (!peerings.wait()) {
+      std::cerr << "*** failed to reconnect after restart " << round << '\n';
+      abort();
+    }
+    result.rounds.emplace_back(
+      rec.finish(peerings, listener_tids, listener_cpu_t0));
+    verbose_println(ps, "all endpoints reconnected after restart ", round);
+  }
+  return result;
+}
+
+// -- output -------------------------------------------------------------------
+
+double to_ms(timespan x) {
+  using fractional_ms = std::chrono::duration<double, std::milli>;
+  return std::chrono::duration_cast<fractional_ms>(x).count();
+}
+
+void print_text(const run_result& x) {
+  std::cout << "peers: " << x.peer_count << ", topology: "
+            << (x.mesh ? "mesh" : "star")
+            << ", transport: " << (x.tls ? "tls" : "plain") << '\n';
+  for (const auto& r : x.rounds) {
+    std::cout << "  " << (r.round == 0 ? "initial" : "restart ");
+    if (r.round > 0)
+      std::cout << r.round;
+    std::cout << ": " << r.connections << " connections, full mesh after "
+              << to_ms(r.full_mesh) << "ms\n"
+              << "    handshake latency: p50 " << to_ms(r.latency_p50)
+              << "ms, p99 " << to_ms(r.latency_p99) << "ms, max "
+              << to_ms(r.latency_max) << "ms\n"
+              << "    CPU: connectors " << to_ms(r.connector_cpu)
+              << "ms, listener connector " << to_ms(r.listener_cpu)
+              << "ms, process " << to_ms(r.process_cpu) << "ms\n";
+  }
+}
+
+std::string to_json(const run_result& x) {
+  std::ostringstream str;
+  str << "{\"peers\": " << x.peer_count << ", \"topology\": \""
+      << (x.mesh ? "mesh" : "star") << "\", \"transport\": \""
+      << (x.tls ? "tls" : "plain") << "\", \"rounds\": [";
+  for (size_t i = 0; i < x.rounds.size(); ++i) {
+    const auto& r = x.rounds[i];
+    str << (i == 0 ? "" : ", ") << "{\"round\": " << r.round
+        << ", \"connections\": " << r.connections
+        << ", \"full_mesh_ms\": " << to_ms(r.full_mesh)
+        << ", \"latency_ms\": {\"p50\": " << to_ms(r.latency_p50)
+        << ", \"p99\": " << to_ms(r.latency_p99)
+        << ", \"max\": " << to_ms(r.latency_max) << "}"
+        << ", \"cpu_ms\": {\"connectors\": " << to_ms(r.connector_cpu)
+        << ", \"listener\": " << to_ms(r.listener_cpu)
+        << ", \"process\": " << to_ms(r.process_cpu) << "}}";
+  }
+  str << "]}";
+  return str.str();
+}
+
+// -- main ---------------------------------------------------------------------
+
+bool parse_list(const std::vector<std::string>& strs, uint64_t fallback,
+                std::vector<uint64_t>& result) {
+  if (strs.empty()) {
+    result.push_back(fallback);
+    return true;
+  }
+  // Accept lists as well as comma-separated values.
+  try {
+    for (const auto& str : strs) {
+      std::istringstream in{str};
+      std::string item;
+      while (std::getline(in, item, ','))
+        result.push_back(std::stoull(item));
+    }
+  } catch (std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  parameters params;
+  configuration cfg{skip_init};
+  add_options(cfg, params);
+  try {
+    cfg.init(argc, argv);
+  } catch (std::exception& ex) {
+    std::cerr << ex.what() << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (cfg.cli_helptext_printed())
+    return EXIT_SUCCESS;
+  if (cfg.remainder().size() > 0) {
+    std::cerr << "*** too many arguments (did not expect any)\n\n";
+    return EXIT_FAILURE;
+  }
+  const auto& fmt = params.output_format;
+  if (fmt != "text" && fmt != "json") {
+    std::cerr << "*** invalid output format: " << fmt << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (params.certificate.empty() != params.key.empty()) {
+    std::cerr << "*** certificate and key require each other\n\n";
+    return EXIT_FAILURE;
+  }
+  if (!params.certificate.empty())
+    params.tls = true;
+  std::vector<uint64_t> peer_counts;
+  if (!parse_list(params.peer_counts, params.peer_count, peer_counts)) {
+    std::cerr << "*** invalid sweep parameters\n\n";
+    return EXIT_FAILURE;
+  }
+  if (std::find(peer_counts.begin(), peer_counts.end(), 0)
+      != peer_counts.end()) {
+    std::cerr << "*** peer-count must be greater than 0\n\n";
+    return EXIT_FAILURE;
+  }
+  std::vector<run_result> results;
+  for (auto peer_count : peer_counts) {
+    auto ps = params;
+    ps.peer_count = peer_count;
+    results.emplace_back(run_once(ps));
+    if (fmt == "text")
+      print_text(results.back());
+  }
+  if (fmt == "json") {
+    std::string str = "[";
+    for (size_t i = 0; i < results.size(); ++i) {
+      str += i == 0 ? "\n  " : ",\n  ";
+      str += to_json(results[i]);
+    }
+    str += "\n]";
+    std::cout << str << std::endl;
+  }
+}
@@ -0,0 +1,302 @@
+#include "broker/data.hh"
+#include "broker/detail/prefix_matcher.hh"
+#include "broker/detail/radix_tree.hh"
+#include "broker/detail/subscription_index.hh"
+#include "broker/internal/routed_message.hh"
+#include "broker/message.hh"
+#include "broker/topic.hh"
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using broker::data_message;
+using broker::filter_type;
+using broker::topic;
+using broker::detail::prefix_matcher;
+using broker::detail::radix_tree;
+using broker::detail::subscription_index;
+using broker::internal::destination_mask;
+
+namespace {
+
+/// Number of distinct topics that the publishers use.
+constexpr size_t num_topics = 1024;
+
+/// Number of messages per iteration, cycling through the published topics.
+constexpr size_t num_messages = 256;
+
+/// Generates topics with `depth` levels, e.g., `/t17/l1/l2` for depth 3, and
+/// filters that subscribe to prefixes of these topics at a random level.
+class workload {
+public:
+  workload(size_t depth, size_t filter_size, size_t num_filters)
+    : rng_(0xB7E57) {
+    for (size_t i = 0; i < num_topics; ++i)
+      topics_.emplace_back(make_topic(i, depth));
+    std::uniform_int_distribution<size_t> topic_dis{0, num_topics - 1};
+    std::uniform_int_distribution<size_t> level_dis{1, depth};
+    for (size_t i = 0; i < num_filters; ++i) {
+      filter_type filter;
+      for (size_t j = 0; j < filter_size; ++j)
+        filter.emplace_back(make_topic(topic_dis(rng_), level_dis(rng_)));
+      filters_.emplace_back(std::move(filter));
+    }
+    for (size_t i = 0; i < num_messages; ++i) {
+      const auto& str = topics_[topic_dis(rng_)];
+      msgs_.emplace_back(broker::make_data_message(topic{str}, broker::data{}));
+    }
+  }
+
+  const std::vector<std::string>& topics() const noexcept {
+    return topics_;
+  }
+
+  const std::vector<filter_type>& filters() const noexcept {
+    return filters_;
+  }
+
+  const std::vector<data_message>& messages() const noexcept {
+    return msgs_;
+  }
+
+private:
+  static std::string make_topic(size_t index, size_t depth) {
+    auto result = "/t" + std::to_string(index);
+    for (size_t level = 1; level < depth; ++level) {
+      result += "/l";
+      result += std::to_string(level);
+    }
+    return result;
+  }
+
+  std::minstd_rand rng_;
+  std::vector<std::string> topics_;
+  std::vector<filter_type> filters_;
+  std::vector<data_message> msgs_;
+};
+
+/// Reports the throughput and the time per message.
+void set_counters(benchmark::State& state) {
+  using benchmark::Counter;
+  auto n = static_cast<double>(num_messages);
+  state.counters["messages"] = Counter(n, Counter::kIsIterationInvariantRate);
+  state.counters["per_message"] =
+    Counter(n, Counter::kIsIterationInvariantRate | Counter::kInvert);
+}
+
+void filter_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"filter_size", "depth"});
+  for (int64_t filter_size : {1, 10, 100, 1'000})
+    for (int64_t depth : {1, 3, 6})
+      b->Args({filter_size, depth});
+}
+
+void fan_out_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"peers", "filter_size"});
+  for (int64_t peers : {1, 10, 100, 500})
+    for (int64_t filter_size : {1, 10, 100})
+      b->Args({peers, filter_size});
+}
+
+void route_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"peers", "subscribers"});
+  for (int64_t peers : {1, 10, 100})
+    for (int64_t subscribers : {1, 10, 100})
+      b->Args({peers, subscribers});
+}
+
+} // namespace
+
+// -- filter matching ----------------------------------------------------------
+
+// Checks a single filter by scanning all of its entries.
+void filter_match_prefix_matcher(benchmark::State& state) {
+  workload wl{static_cast<size_t>(state.range(1)),
+              static_cast<size_t>(state.range(0)), 1};
+  const auto& filter = wl.filters().front();
+  prefix_matcher f;
+  for (auto _ : state) {
+    size_t hits = 0;
+    for (const auto& msg : wl.messages())
+      hits += f(filter, msg->topic()) ? 1 : 0;
+    benchmark::DoNotOptimize(hits);
+  }
+  set_counters(state);
+}
+
+BENCHMARK(filter_match_prefix_matcher)->Apply(filter_args);
+
+// Checks a single filter by collecting all matching entries of a radix tree.
+void filter_match_radix_tree_prefix_of(benchmark::State& state) {
+  workload wl{static_cast<size_t>(state.range(1)),
+              static_cast<size_t>(state.range(0)), 1};
+  radix_tree<int> tree;
+  for (const auto& x : wl.filters().front())
+    tree.insert({x.string(), 0});
+  std::string key;
+  for (auto _ : state) {
+    size_t hits = 0;
+    for (const auto& msg : wl.messages()) {
+      key = msg->topic();
+      hits += tree.prefix_of(key).empty() ? 0 : 1;
+    }
+    benchmark::DoNotOptimize(hits);
+  }
+  set_counters(state);
+}
+
+BENCHMARK(filter_match_radix_tree_prefix_of)->Apply(filter_args);
+
+// Checks a single filter by visiting all matching entries of a radix tree
+// without allocating.
+void filter_match_radix_tree_for_each(benchmark::State& state) {
+  workload wl{static_cast<size_t>(state.range(1)),
+              static_cast<size_t>(state.range(0)), 1};
+  radix_tree<int> tree;
+  for (const auto& x : wl.filters().front())
+    tree.insert({x.string(), 0});
+  std::string key;
+  for (auto _ : state) {
+    size_t hits = 0;
+    for (const auto& msg : wl.messages()) {
+      key = msg->topic();
+      auto found = false;
+      tree.for_each_prefix_of(key, [&found](const auto&) { found = true; });
+      hits += found ? 1 : 0;
+    }
+    benchmark::DoNotOptimize(hits);
+  }
+  set_counters(state);
+}
+
+BENCHMARK(filter_match_radix_tree_for_each)->Apply(filter_args);
+
+// Checks a single filter through the index that the core uses.
+void filter_match_subscription_index(benchmark::State& state) {
+  workload wl{static_cast<size_t>(state.range(1)),
+              static_cast<size_t>(state.range(0)), 1};
+  subscription_index index;
+  index.add(wl.filters().front());
+  for (auto _ : state) {
+    size_t hits = 0;
+    for (const auto& msg : wl.messages())
+      hits += index.has_match(msg->topic()) ? 1 : 0;
+    benchmark::DoNotOptimize(hits);
+  }
+  set_counters(state);
+}
+
+BENCHMARK(filter_match_subscription_index)->Apply(filter_args);
+
+// -- per-peer fan-out ---------------------------------------------------------
+
+// Selects the receiving peers by checking the filter of each peer.
+void fan_out_prefix_matcher(benchmark::State& state) {
+  workload wl{3, static_cast<size_t>(state.range(1)),
+              static_cast<size_t>(state.range(0))};
+  prefix_matcher f;
+  for (auto _ : state) {
+    for (const auto& msg : wl.messages()) {
+      destination_mask mask;
+      for (size_t i = 0; i < wl.filters().size(); ++i)
+        if (f(wl.filters()[i], msg->topic()))
+          mask.set(i);
+      benchmark::DoNotOptimize(mask);
+    }
+  }
+  set_counters(state);
+}
+
+BENCHMARK(fan_out_prefix_matcher)->Apply(fan_out_args);
+
+// Selects the receiving peers with a single lookup in the index.
+void fan_out_subscription_index(benchmark::State& state) {
+  workload wl{3, static_cast<size_t>(state.range(1)),
+              static_cast<size_t>(state.range(0))};
+  subscription_index index;
+  for (const auto& filter : wl.filters())
+    index.add(filter);
+  subscription_index::handle_list hdls;
+  for (auto _ : state) {
+    for (const auto& msg : wl.messages()) {
+      destination_mask mask;
+      hdls.clear();
+      index.match(msg->topic(), hdls);
+      for (auto hdl : hdls)
+        mask.set(hdl);
+      benchmark::DoNotOptimize(mask);
+    }
+  }
+  set_counters(state);
+}
+
+BENCHMARK(fan_out_subscription_index)->Apply(fan_out_args);
+
+// Like fan_out_subscription_index, but uses the cached results by topic ID,
+// i.e., the code path for recurring topics in the core.
+void fan_out_subscription_index_cached(benchmark::State& state) {
+  workload wl{3, static_cast<size_t>(state.range(1)),
+              static_cast<size_t>(state.range(0))};
+  subscription_index index;
+  for (const auto& filter : wl.filters())
+    index.add(filter);
+  for (auto _ : state) {
+    for (const auto& msg : wl.messages()) {
+      destination_mask mask;
+      for (auto hdl : index.match(msg->topic_id(), msg->topic()))
+        mask.set(hdl);
+      benchmark::DoNotOptimize(mask);
+    }
+  }
+  set_counters(state);
+}
+
+BENCHMARK(fan_out_subscription_index_cached)->Apply(fan_out_args);
+
+// -- routing and local delivery -----------------------------------------------
+
+// Mirrors `core_actor_state::route` followed by handing each message to the
+// buffers of the selected local subscribers.
+void route_and_deliver(benchmark::State& state) {
+  auto num_peers = static_cast<size_t>(state.range(0));
+  auto num_subscribers = static_cast<size_t>(state.range(1));
+  workload wl{3, 10, num_peers + num_subscribers};
+  subscription_index peers;
+  subscription_index locals;
+  for (size_t i = 0; i < num_peers; ++i)
+    peers.add(wl.filters()[i]);
+  for (size_t i = 0; i < num_subscribers; ++i)
+    locals.add(wl.filters()[num_peers + i]);
+  std::vector<std::vector<data_message>> buffers;
+  buffers.resize(num_subscribers);
+  size_t delivered = 0;
+  for (auto _ : state) {
+    for (const auto& msg : wl.messages()) {
+      broker::internal::routed_message result{msg, {}, {}};
+      for (auto hdl : locals.match(msg->topic_id(), msg->topic()))
+        result.locals.set(hdl);
+      for (auto hdl : peers.match(msg->topic_id(), msg->topic()))
+        result.peers.set(hdl);
+      for (size_t i = 0; i < num_subscribers; ++i) {
+        if (result.locals.test(i)) {
+          buffers[i].emplace_back(result.msg->as_data());
+          ++delivered;
+        }
+      }
+      benchmark::DoNotOptimize(result);
+    }
+    for (auto& buf : buffers)
+      buf.clear();
+  }
+  set_counters(state);
+  state.counters["deliveries_per_message"] =
+    static_cast<double>(delivered)
+    / static_cast<double>(state.iterations() * num_messages);
+}
+
+BENCHMARK(route_and_deliver)->Apply(route_args);
@@ -1,16 +1,27 @@
 #include "broker/configuration.hh"
 #include "broker/endpoint.hh"
 #include "broker/message.hh"
+#include "broker/variant_list.hh"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <iostream>
+#include <new>
+#include <numeric>
+#include <optional>
 #include <random>
+#include <sstream>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #ifndef BROKER_WINDOWS
 #  include <cstdio>
+#  include <sys/resource.h>
 #  include <unistd.h>
 #endif
 
@@ -95,9 +106,37 @@ struct parameters {
   uint64_t message_count = default_message_count;
   uint64_t payload_size = default_payload_size;
   uint64_t seed = std::random_device{}();
+  uint64_t sample_interval = 1;
   bool naive_publish = false;
+  std::string output_format = "none";
+  std::vector<std::string> peer_counts;
+  std::vector<std::string> payload_sizes;
 };
 
+// -- allocation counting ------------------------------------------------------
+
+namespace {
+
+/// Counts all calls to `operator new` in this process.
+std::atomic<size_t> alloc_count{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  if (auto ptr = malloc(size > 0 ? size : 1))
+    return ptr;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
 // -- I/O utility --------------------------------------------------------------
 
 namespace {
@@ -187,6 +226,14 @@ void add_options(configuration& cfg, parameters& ps) {
                  "enables more console output");
   cfg.add_option(&ps.naive_publish, "naive-publish",
                  "publish data via endpoint::publish instead of publish_all");
+  cfg.add_option(&ps.sample_interval, "sample-interval",
+                 "measure the latency of every n-th message");
+  cfg.add_option(&ps.output_format, "output-format",
+                 "print results as 'text', 'csv' or 'json' (default: none)");
+  cfg.add_option(&ps.peer_counts, "sweep-peer-counts",
+                 "runs the benchmark once per peer count in the list");
+  cfg.add_option(&ps.payload_sizes, "sweep-payload-sizes",
+                 "runs the benchmark once per payload size in the list");
 }
 
 struct generator {
@@ -199,8 +246,11 @@ struct generator {
   std::minstd_rand rng;
 
   data_message next() {
-    return make_data_message("/benchmark/fan-out"s,
-                             data{random_string(rng, params.payload_size)});
+    // The timestamp allows subscribers to compute the latency.
+    vector xs;
+    xs.emplace_back(broker::now());
+    xs.emplace_back(random_string(rng, params.payload_size));
+    return make_data_message("/benchmark/fan-out"s, data{std::move(xs)});
   }
 };
 
@@ -232,10 +282,42 @@ struct padded_id {
   char padding[BROKER_CONSTRUCTIVE_INTERFERENCE_SIZE - sizeof(endpoint_id)];
 };
 
+/// Collects the measurements of a single subscriber.
+struct subscriber_stats {
+  size_t received = 0;
+  timestamp done;
+  std::vector<timespan> latencies;
+};
+
+/// Summarizes a single run of the benchmark.
+struct run_result {
+  uint64_t peer_count = 0;
+  uint64_t message_count = 0;
+  uint64_t payload_size = 0;
+  double runtime = 0;
+  double publish_rate = 0;
+  std::vector<double> subscriber_rates;
+  timespan p50{0};
+  timespan p99{0};
+  timespan p999{0};
+  size_t max_rss_kb = 0;
+  double allocations_per_message = 0;
+};
+
+size_t max_rss_kb() {
+#ifndef BROKER_WINDOWS
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    return static_cast<size_t>(usage.ru_maxrss);
+#endif
+  return 0;
+}
+
 // -- actual program logic -----------------------------------------------------
 
-void run_subscriber(barrier* sync, padded_id* id_slot, uint16_t port,
-                    parameters ps, size_t index) {
+void run_subscriber(barrier* sync, padded_id* id_slot,
+                    subscriber_stats* stats, uint16_t port, parameters ps,
+                    size_t index) {
   barrier worker_sync{2};
   endpoint ep;
   id_slot->id = ep.node_id();
@@ -245,11 +327,19 @@ void run_subscriber(barrier* sync, padded_id* id_slot, uint16_t port,
     [] {
       // Init: nop.
     },
-    [&worker_sync, ps, index, n = 0u, &ep](const data_message&) mutable {
+    [&worker_sync, stats, ps, index, n = 0u, &ep](
+      const data_message& msg) mutable {
       ++n;
+      if (ps.sample_interval > 0 && n % ps.sample_interval == 0) {
+        auto xs = msg->value().to_list();
+        if (xs.size() == 2 && xs[0].is_timestamp())
+          stats->latencies.emplace_back(broker::now() - xs[0].to_timestamp());
+      }
       if (index == 0 && n % 1000 == 0)
         verbose::println("subscriber 1 received ", n, " items ...");
       if (n == ps.message_count) {
+        stats->received = n;
+        stats->done = broker::now();
         verbose::println("Broker endpoint ", ep.node_id(),
                          " is done receiving");
         worker_sync.arrive_and_wait();
@@ -294,23 +384,15 @@ void run_publisher(endpoint& ep, parameters ps) {
   }
 }
 
-int main(int argc, char** argv) {
-  // Parse CLI / config file.
-  configuration cfg{skip_init};
-  parameters params;
-  add_options(cfg, params);
-  try {
-    cfg.init(argc, argv);
-  } catch (std::exception& ex) {
-    std::cerr << ex.what() << "\n\n";
-    return EXIT_FAILURE;
-  }
-  if (cfg.cli_helptext_printed())
-    return EXIT_SUCCESS;
-  if (cfg.remainder().size() > 0) {
-    std::cerr << "*** too many arguments (did not expect any)\n\n";
-    return EXIT_FAILURE;
-  }
+/// Returns the element at percentile `p`.
+/// @pre `xs` is sorted
+timespan percentile(const std::vector<timespan>& xs, double p) {
+  if (xs.empty())
+    return timespan{0};
+  return xs[static_cast<size_t>(p * static_cast<double>(xs.size() - 1))];
+}
+
+run_result run_once(configuration cfg, parameters params) {
   // Spin up the "main" endpoint.
   endpoint ep{std::move(cfg)};
   auto port = ep.listen();
@@ -319,25 +401,226 @@ int main(int argc, char** argv) {
   barrier sync{static_cast<ptrdiff_t>(params.peer_count + 1)};
   std::vector<padded_id> ls;
   ls.resize(params.peer_count);
+  std::vector<subscriber_stats> stats;
+  stats.resize(params.peer_count);
   std::vector<std::thread> threads;
   threads.resize(params.peer_count);
   for (size_t i = 0; i < params.peer_count; ++i)
-    threads[i] = std::thread{run_subscriber, &sync, &ls[i], port, params, i};
+    threads[i] = std::thread{run_subscriber, &sync, &ls[i], &stats[i], port,
+                             params, i};
   sync.arrive_and_wait();
   verbose::println("started ", params.peer_count, " subscriber endpoints");
   // Wait for all peers to complete their handshake.
   for (auto& x : ls) {
     if (!ep.await_peer(x.id)) {
       std::cerr << "*** peers failed to connect\n";
-      return EXIT_FAILURE;
+      abort();
     }
   }
   verbose::println("received all ", params.peer_count, " handshakes -> run!");
   // Light, camera, action!
+  auto allocs_before = alloc_count.load();
+  auto t0 = broker::now();
   run_publisher(ep, params);
+  auto t1 = broker::now();
   // Tear down.
   verbose::println("tear down -> wait for ", params.peer_count, " threads");
   for (auto& thread : threads)
     thread.join();
-  verbose::println("all threads have terminated, bye");
+  verbose::println("all threads have terminated");
+  // Compute the results.
+  using fractional_seconds = std::chrono::duration<double>;
+  auto to_seconds = [](timespan x) {
+    return std::chrono::duration_cast<fractional_seconds>(x).count();
+  };
+  auto msgs = static_cast<double>(params.message_count);
+  run_result result;
+  result.peer_count = params.peer_count;
+  result.message_count = params.message_count;
+  result.payload_size = params.payload_size;
+  result.publish_rate = msgs / to_seconds(t1 - t0);
+  std::vector<timespan> latencies;
+  auto last = t1;
+  for (auto& x : stats) {
+    last = std::max(last, x.done);
+    result.subscriber_rates.emplace_back(static_cast<double>(x.received)
+                                         / to_seconds(x.done - t0));
+    latencies.insert(latencies.end(), x.latencies.begin(), x.latencies.end());
+  }
+  result.runtime = to_seconds(last - t0);
+  std::sort(latencies.begin(), latencies.end());
+  result.p50 = percentile(latencies, 0.5);
+  result.p99 = percentile(latencies, 0.99);
+  result.p999 = percentile(latencies, 0.999);
+  result.max_rss_kb = max_rss_kb();
+  result.allocations_per_message =
+    static_cast<double>(alloc_count.load() - allocs_before) / msgs;
+  return result;
+}
+
+// -- output -------------------------------------------------------------------
+
+double to_us(timespan x) {
+  using fractional_us = std::chrono::duration<double, std::micro>;
+  return std::chrono::duration_cast<fractional_us>(x).count();
+}
+
+double min_rate(const run_result& x) {
+  const auto& xs = x.subscriber_rates;
+  return xs.empty() ? 0.0 : *std::min_element(xs.begin(), xs.end());
+}
+
+double avg_rate(const run_result& x) {
+  const auto& xs = x.subscriber_rates;
+  if (xs.empty())
+    return 0.0;
+  return std::accumulate(xs.begin(), xs.end(), 0.0)
+         / static_cast<double>(xs.size());
+}
+
+void print_text(const run_result& x) {
+  out::println("peers: ", x.peer_count, ", messages: ", x.message_count,
+               ", payload size: ", x.payload_size);
+  out::println("  runtime: ", x.runtime, "s, publish rate: ", x.publish_rate,
+               " msg/s");
+  out::println("  subscriber rate: min ", min_rate(x), " msg/s, avg ",
+               avg_rate(x), " msg/s");
+  out::println("  latency: p50 ", to_us(x.p50), "us, p99 ", to_us(x.p99),
+               "us, p999 ", to_us(x.p999), "us");
+  out::println("  max RSS: ", x.max_rss_kb, " KiB, allocations: ",
+               x.allocations_per_message, " per message");
+}
+
+void print_csv_header() {
+  out::println("peers,messages,payload_size,runtime,publish_rate,"
+               "min_subscriber_rate,avg_subscriber_rate,p50_us,p99_us,p999_us,"
+               "max_rss_kb,allocations_per_message");
+}
+
+void print_csv(const run_result& x) {
+  out::println(x.peer_count, ',', x.message_count, ',', x.payload_size, ',',
+               x.runtime, ',', x.publish_rate, ',', min_rate(x), ',',
+               avg_rate(x), ',', to_us(x.p50), ',', to_us(x.p99), ',',
+               to_us(x.p999), ',', x.max_rss_kb, ',',
+               x.allocations_per_message);
+}
+
+std::string to_json(const run_result& x) {
+  std::ostringstream str;
+  str << "{\"peers\": " << x.peer_count
+      << ", \"messages\": " << x.message_count
+      << ", \"payload_size\": " << x.payload_size
+      << ", \"runtime\": " << x.runtime
+      << ", \"publish_rate\": " << x.publish_rate
+      << ", \"subscriber_rates\": [";
+  for (size_t i = 0; i < x.subscriber_rates.size(); ++i) {
+    if (i > 0)
+      str << ", ";
+    str << x.subscriber_rates[i];
+  }
+  str << "], \"latency_us\": {\"p50\": " << to_us(x.p50)
+      << ", \"p99\": " << to_us(x.p99) << ", \"p999\": " << to_us(x.p999)
+      << "}, \"max_rss_kb\": " << x.max_rss_kb
+      << ", \"allocations_per_message\": " << x.allocations_per_message
+      << "}";
+  return str.str();
+}
+
+// -- main ---------------------------------------------------------------------
+
+/// Parses the CLI arguments into a new configuration.
+std::optional<configuration> make_config(int argc, char** argv,
+                                         parameters& params) {
+  configuration cfg{skip_init};
+  add_options(cfg, params);
+  try {
+    cfg.init(argc, argv);
+  } catch (std::exception& ex) {
+    std::cerr << ex.what() << "\n\n";
+    return std::nullopt;
+  }
+  return {std::move(cfg)};
+}
+
+bool parse_list(const std::vector<std::string>& strs, uint64_t fallback,
+                std::vector<uint64_t>& result) {
+  if (strs.empty()) {
+    result.push_back(fallback);
+    return true;
+  }
+  // Accept lists as well as comma-separated values.
+  try {
+    for (const auto& str : strs) {
+      std::istringstream in{str};
+      std::string item;
+      while (std::getline(in, item, ','))
+        result.push_back(std::stoull(item));
+    }
+  } catch (std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  // Parse CLI / config file.
+  parameters params;
+  auto cfg = make_config(argc, argv, params);
+  if (!cfg)
+    return EXIT_FAILURE;
+  if (cfg->cli_helptext_printed())
+    return EXIT_SUCCESS;
+  if (cfg->remainder().size() > 0) {
+    std::cerr << "*** too many arguments (did not expect any)\n\n";
+    return EXIT_FAILURE;
+  }
+  const auto& fmt = params.output_format;
+  if (fmt != "none" && fmt != "text" && fmt != "csv" && fmt != "json") {
+    std::cerr << "*** invalid output format: " << fmt << "\n\n";
+    return EXIT_FAILURE;
+  }
+  std::vector<uint64_t> peer_counts;
+  std::vector<uint64_t> payload_sizes;
+  if (!parse_list(params.peer_counts, params.peer_count, peer_counts)
+      || !parse_list(params.payload_sizes, params.payload_size,
+                     payload_sizes)) {
+    std::cerr << "*** invalid sweep parameters\n\n";
+    return EXIT_FAILURE;
+  }
+  // Run the benchmark once per combination of the sweep parameters.
+  std::vector<run_result> results;
+  for (auto peer_count : peer_counts) {
+    for (auto payload_size : payload_sizes) {
+      auto ps = params;
+      ps.peer_count = peer_count;
+      ps.payload_size = payload_size;
+      verbose::println("run with ", peer_count, " peers and a payload size of ",
+                       payload_size);
+      run_result res;
+      if (results.empty()) {
+        res = run_once(std::move(*cfg), ps);
+      } else {
+        // Each endpoint needs its own configuration.
+        parameters tmp;
+        res = run_once(std::move(*make_config(argc, argv, tmp)), ps);
+      }
+      if (fmt == "text")
+        print_text(res);
+      results.emplace_back(std::move(res));
+    }
+  }
+  if (fmt == "csv") {
+    print_csv_header();
+    for (const auto& x : results)
+      print_csv(x);
+  } else if (fmt == "json") {
+    std::string str = "[";
+    for (size_t i = 0; i < results.size(); ++i) {
+      str += i == 0 ? "\n  " : ",\n  ";
+      str += to_json(results[i]);
+    }
+    str += "\n]";
+    out::println(str);
+  }
+  verbose::println("all runs done, bye");
 }
@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""Microbenchmarks for the Python bindings.
+
+Measures the publish/subscribe throughput from Python, the cost of converting
+common types between Python values and broker.Data, and how long blocking
+calls hold the GIL.
+"""
+
+import argparse, datetime, ipaddress, json, statistics, sys, threading, time
+import timeit
+
+import broker
+
+TOPIC = '/benchmark/python'
+
+# -- publish/subscribe throughput ---------------------------------------------
+
+PAYLOADS = {
+    'count': lambda i: broker.Count(i),
+    'string-100': lambda i: 'x' * 100,
+    'vector-10': lambda i: [broker.Count(i), 'x' * 10, 3.14, True,
+                            ipaddress.ip_address('10.0.0.1'),
+                            broker.Count(i), 'y' * 10, 2.71, False,
+                            ipaddress.ip_address('10.0.0.2')],
+}
+
+def pubsub(message_count, make, batch_size):
+    """Publishes messages on one endpoint and receives them on a peered
+    endpoint from a second Python thread. Returns messages per second."""
+    with broker.Endpoint() as ep1, \
+         broker.Endpoint() as ep2, \
+         ep2.make_subscriber(TOPIC, qsize=1000) as sub:
+        port = ep2.listen('127.0.0.1', 0)
+        if not ep1.peer('127.0.0.1', port, 1.0):
+            raise RuntimeError('failed to peer the endpoints')
+        ep1.await_peer(ep2.node_id())
+        received = [0, None]
+        def consume():
+            deadline = time.perf_counter() + 60
+            while received[0] < message_count:
+                if time.perf_counter() > deadline:
+                    raise RuntimeError('timed out while receiving')
+                msgs = sub.get(min(100, message_count - received[0]), 0.1)
+                received[0] += len(msgs)
+            received[1] = time.perf_counter()
+        consumer = threading.Thread(target=consume)
+        consumer.start()
+        msgs = [make(i) for i in range(message_count)]
+        t0 = time.perf_counter()
+        if batch_size <= 1:
+            for msg in msgs:
+                ep1.publish(TOPIC, msg)
+        else:
+            for i in range(0, message_count, batch_size):
+                ep1.publish_batch(*[(TOPIC, msg)
+                                    for msg in msgs[i:i + batch_size]])
+        consumer.join()
+        return message_count / (received[1] - t0)
+
+# -- data conversion ----------------------------------------------------------
+
+def conversion_cases():
+    ts = datetime.datetime(2024, 1, 1, tzinfo=broker.utc)
+    return {
+        'bool': True,
+        'integer': -42,
+        'count': broker.Count(42),
+        'real': 3.14,
+        'string-100': 'x' * 100,
+        'address': ipaddress.ip_address('192.168.0.1'),
+        'subnet': ipaddress.ip_network('10.0.0.0/8'),
+        'port': broker.Port(80, broker.Port.TCP),
+        'timestamp': ts,
+        'timespan': datetime.timedelta(seconds=1.5),
+        'vector-10': list(range(10)),
+        'set-10': set(range(10)),
+        'table-10': {str(i): i for i in range(10)},
+        'nested': [{'id': i, 'tags': {'a', 'b'}, 'ts': ts} for i in range(5)],
+    }
+
+def per_call_ns(fn):
+    """Returns the median time of a call to fn in nanoseconds."""
+    timer = timeit.Timer(fn)
+    number, _ = timer.autorange()
+    runs = timer.repeat(repeat=5, number=number)
+    return statistics.median(runs) / number * 1e9
+
+def conversions():
+    result = {}
+    for name, x in conversion_cases().items():
+        d = broker.Data(x)
+        result[name] = {
+            'from_py_ns': per_call_ns(lambda: broker.Data(x)),
+            'to_py_ns': per_call_ns(lambda: broker.Data.to_py(d)),
+        }
+    return result
+
+# -- GIL hold times -----------------------------------------------------------
+
+class Ticker:
+    """Runs a Python thread that wakes up every millisecond. The largest gap
+    between two wakeups while running a call tells how long the call kept
+    other Python threads from running."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.max_gap = 0
+        self.done = False
+        self.thread = threading.Thread(target=self.run)
+        self.thread.start()
+
+    def run(self):
+        last = time.perf_counter()
+        while not self.done:
+            time.sleep(0.001)
+            now = time.perf_counter()
+            with self.lock:
+                self.max_gap = max(self.max_gap, now - last)
+            last = now
+
+    def measure(self, fn):
+        """Returns the duration of fn() and the largest gap in seconds."""
+        # Give the ticker a chance to run before resetting its state.
+        time.sleep(0.01)
+        with self.lock:
+            self.max_gap = 0
+        t0 = time.perf_counter()
+        fn()
+        duration = time.perf_counter() - t0
+        time.sleep(0.01)
+        with self.lock:
+            return duration, self.max_gap
+
+    def stop(self):
+        self.done = True
+        self.thread.join()
+
+def gil_hold_times(timeout):
+    result = {}
+    ticker = Ticker()
+    try:
+        with broker.Endpoint() as ep1, \
+             broker.Endpoint() as ep2, \
+             broker.Endpoint() as ep3, \
+             ep1.make_subscriber(TOPIC) as sub:
+            port = ep2.listen('127.0.0.1', 0)
+            master = ep2.attach_master('benchmark', broker.Backend.Memory)
+            master.put('key', 'value')
+            calls = {
+                'subscriber.get(timeout)': lambda: sub.get(timeout),
+                'subscriber.get(num, timeout)': lambda: sub.get(10, timeout),
+                'endpoint.peer': lambda: ep1.peer('127.0.0.1', port, 1.0),
+                'store.get': lambda: master.get('key'),
+                'store.await_idle': lambda: master.await_idle(timeout),
+                'endpoint.await_peer(timeout)':
+                    lambda: ep2.await_peer(ep3.node_id(), timeout),
+            }
+            for name, fn in calls.items():
+                duration, gap = ticker.measure(fn)
+                result[name] = {'call_ms': duration * 1e3,
+                                'max_gap_ms': gap * 1e3}
+    finally:
+        ticker.stop()
+    return result
+
+# -- main ---------------------------------------------------------------------
+
+def print_text(res):
+    print('publish/subscribe throughput:')
+    for name, rate in res['pubsub'].items():
+        print('  %s: %.0f msg/s' % (name, rate))
+    print('data conversion:')
+    for name, x in res['conversion'].items():
+        print('  %s: from_py %.0fns, to_py %.0fns'
+              % (name, x['from_py_ns'], x['to_py_ns']))
+    print('GIL hold times (largest stall of other Python threads):')
+    for name, x in res['gil'].items():
+        print('  %s: stalled %.1fms of %.1fms'
+              % (name, x['max_gap_ms'], x['call_ms']))
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--message-count', type=int, default=10000,
+                        help='number of messages per throughput run')
+    parser.add_argument('--batch-size', type=int, default=100,
+                        help='messages per publish_batch call')
+    parser.add_argument('--timeout', type=float, default=0.2,
+                        help='seconds for blocking calls that time out')
+    parser.add_argument('--output-format', default='text',
+                        choices=['text', 'json'],
+                        help="print results as 'text' or 'json'")
+    args = parser.parse_args()
+    res = {'pubsub': {}, 'conversion': {}, 'gil': {}}
+    for name, make in PAYLOADS.items():
+        res['pubsub']['publish/' + name] = pubsub(args.message_count, make, 1)
+        res['pubsub']['publish_batch/' + name] = pubsub(args.message_count,
+                                                        make, args.batch_size)
+    res['conversion'] = conversions()
+    res['gil'] = gil_hold_times(args.timeout)
+    if args.output_format == 'json':
+        print(json.dumps(res, indent=2))
+    else:
+        print_text(res)
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
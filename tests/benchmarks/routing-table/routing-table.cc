@@ -5,8 +5,12 @@
 #include <benchmark/benchmark.h>
 
 #include <atomic>
+#include <deque>
 #include <limits>
+#include <map>
 #include <random>
+#include <set>
+#include <utility>
 
 using broker::endpoint_id;
 using broker::vector_timestamp;
@@ -388,3 +392,232 @@ BENCH_SETUP(sorted_linear_routing_table, shortest_path)
 // BENCH_SETUP(sorted_linear_routing_table, generate_paths_10)
 // BENCH_SETUP(sorted_linear_routing_table, erase_front)
 // BENCH_SETUP(sorted_linear_routing_table, erase_back)
+
+// -- scaled topologies --------------------------------------------------------
+
+// The benchmarks above only cover small, synthetic tables. The following
+// benchmarks generate topologies with up to 10,000 nodes from the perspective
+// of a single node (node 0) and fill its routing table with one path to each
+// node per direct neighbor, i.e., with the paths this node would learn from
+// the routing updates of its neighbors:
+//
+// - tree: each node connects to its parent with a fan-out of 4.
+// - mesh: nodes form a ring and each node adds two random connections.
+// - multi-site: sites of 50 nodes, each forming a ring with random chords, that
+//   connect to other sites via two border nodes per site.
+
+namespace {
+
+enum class topology_kind : int64_t { tree, mesh, multi_site };
+
+struct scaled_topology {
+  // IDs by node index. The node at index 0 represents this node.
+  std::vector<endpoint_id> ids;
+
+  // IDs of the direct neighbors of this node.
+  std::vector<endpoint_id> neighbors;
+
+  // All paths to other nodes in the order we add them to the routing table.
+  std::vector<std::pair<endpoint_id, path_type>> updates;
+
+  // A pre-filled routing table.
+  broker::alm::routing_table tbl;
+};
+
+using graph_type = std::vector<std::vector<size_t>>;
+
+graph_type make_graph(topology_kind kind, size_t n, std::minstd_rand& rng) {
+  std::set<std::pair<size_t, size_t>> edges;
+  auto connect = [&edges](size_t x, size_t y) {
+    if (x != y)
+      edges.emplace(std::min(x, y), std::max(x, y));
+  };
+  auto random_node = [&rng](size_t first, size_t last) {
+    return std::uniform_int_distribution<size_t>{first, last - 1}(rng);
+  };
+  switch (kind) {
+    case topology_kind::tree:
+      for (size_t i = 1; i < n; ++i)
+        connect(i, (i - 1) / 4);
+      break;
+    case topology_kind::mesh:
+      for (size_t i = 0; i < n; ++i) {
+        connect(i, (i + 1) % n);
+        connect(i, random_node(0, n));
+        connect(i, random_node(0, n));
+      }
+      break;
+    case topology_kind::multi_site: {
+      constexpr size_t site_size = 50;
+      auto sites = std::max(n / site_size, size_t{1});
+      for (size_t site = 0; site < sites; ++site) {
+        auto first = site * site_size;
+        auto last = site + 1 == sites ? n : first + site_size;
+        for (auto i = first; i < last; ++i) {
+          connect(i, i + 1 < last ? i + 1 : first);
+          connect(i, random_node(first, last));
+        }
+        // Border nodes connect to the next site and to a random site.
+        if (sites > 1) {
+          auto next = ((site + 1) % sites) * site_size;
+          connect(first, next + 1);
+          connect(first + 1, random_node(0, sites) * site_size);
+        }
+      }
+      break;
+    }
+  }
+  graph_type result(n);
+  for (auto [x, y] : edges) {
+    result[x].emplace_back(y);
+    result[y].emplace_back(x);
+  }
+  return result;
+}
+
+scaled_topology make_scaled_topology(topology_kind kind, size_t n) {
+  scaled_topology result;
+  id_generator g;
+  for (size_t i = 0; i < n; ++i)
+    result.ids.emplace_back(g.next());
+  auto graph = make_graph(kind, n, g.rng);
+  // Run a BFS from each direct neighbor that bypasses this node.
+  std::vector<size_t> parents;
+  std::deque<size_t> pending;
+  constexpr auto unvisited = std::numeric_limits<size_t>::max();
+  for (auto hop : graph[0]) {
+    result.neighbors.emplace_back(result.ids[hop]);
+    parents.assign(n, unvisited);
+    parents[0] = 0;
+    parents[hop] = hop;
+    pending.assign({hop});
+    while (!pending.empty()) {
+      auto x = pending.front();
+      pending.pop_front();
+      for (auto y : graph[x]) {
+        if (parents[y] == unvisited) {
+          parents[y] = x;
+          pending.emplace_back(y);
+        }
+      }
+    }
+    for (size_t i = 1; i < n; ++i) {
+      if (parents[i] == unvisited)
+        continue;
+      path_type path;
+      for (auto j = i; j != hop; j = parents[j])
+        path.emplace_back(result.ids[j]);
+      path.emplace_back(result.ids[hop]);
+      std::reverse(path.begin(), path.end());
+      result.updates.emplace_back(result.ids[i], std::move(path));
+    }
+  }
+  // Simulate a random arrival order of the updates.
+  std::shuffle(result.updates.begin(), result.updates.end(), g.rng);
+  for (const auto& [peer, path] : result.updates)
+    broker::alm::add_or_update_path(result.tbl, peer, path,
+                                    vector_timestamp(path.size()));
+  return result;
+}
+
+const scaled_topology& get_scaled_topology(const benchmark::State& state) {
+  static std::map<std::pair<int64_t, int64_t>, scaled_topology> cache;
+  auto key = std::make_pair(state.range(0), state.range(1));
+  auto i = cache.find(key);
+  if (i == cache.end()) {
+    auto kind = static_cast<topology_kind>(key.first);
+    auto n = static_cast<size_t>(key.second);
+    i = cache.emplace(key, make_scaled_topology(kind, n)).first;
+  }
+  return i->second;
+}
+
+// Approximates the heap memory of a routing table.
+size_t memory_usage(const broker::alm::routing_table& tbl) {
+  using row_type = broker::alm::routing_table_row;
+  // Each node in an unordered_map stores the value plus a pointer to the next.
+  auto result = tbl.bucket_count() * sizeof(void*)
+                + tbl.size() * (sizeof(void*) + sizeof(endpoint_id)
+                                + sizeof(row_type));
+  for (const auto& [peer, row] : tbl) {
+    const auto& paths = row.versioned_paths;
+    using versioned_path_type = row_type::versioned_path_type;
+    result += paths.capacity() * sizeof(versioned_path_type);
+    for (const auto& [path, ts] : paths)
+      result += path.capacity() * sizeof(endpoint_id)
+                + ts.capacity() * sizeof(broker::lamport_timestamp);
+  }
+  return result;
+}
+
+void scaled_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"topology", "nodes"});
+  for (auto kind : {topology_kind::tree, topology_kind::mesh,
+                    topology_kind::multi_site})
+    for (int64_t n : {100, 1'000, 10'000})
+      b->Args({static_cast<int64_t>(kind), n});
+}
+
+} // namespace
+
+// Measures processing all updates for filling an empty routing table and
+// reports the (approximated) memory per peer.
+void scaled_add_or_update_path(benchmark::State& state) {
+  const auto& topo = get_scaled_topology(state);
+  for (auto _ : state) {
+    broker::alm::routing_table tbl;
+    for (const auto& [peer, path] : topo.updates)
+      broker::alm::add_or_update_path(tbl, peer, path,
+                                      vector_timestamp(path.size()));
+    benchmark::ClobberMemory();
+    benchmark::DoNotOptimize(tbl);
+  }
+  auto peers = static_cast<double>(topo.tbl.size());
+  state.counters["paths"] = static_cast<double>(topo.updates.size());
+  state.counters["bytes_per_peer"] = memory_usage(topo.tbl) / peers;
+  state.counters["updates"] = benchmark::Counter(
+    static_cast<double>(topo.updates.size()), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(scaled_add_or_update_path)
+  ->Apply(scaled_args)
+  ->Unit(benchmark::kMicrosecond);
+
+// Measures lookups for random peers.
+void scaled_shortest_path(benchmark::State& state) {
+  const auto& topo = get_scaled_topology(state);
+  std::vector<endpoint_id> peers(topo.ids.begin() + 1, topo.ids.end());
+  std::shuffle(peers.begin(), peers.end(), std::minstd_rand{0xB7E57});
+  size_t index = 0;
+  for (auto _ : state) {
+    auto sp = broker::alm::shortest_path(topo.tbl, peers[index]);
+    benchmark::DoNotOptimize(sp);
+    assert(sp != nullptr);
+    if (++index == peers.size())
+      index = 0;
+  }
+}
+
+BENCHMARK(scaled_shortest_path)->Apply(scaled_args);
+
+// Measures removing a direct neighbor, including all peers that become
+// unreachable as a result.
+void scaled_erase_neighbor(benchmark::State& state) {
+  const auto& topo = get_scaled_topology(state);
+  const auto& neighbor = topo.neighbors.front();
+  size_t unreachables = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto cpy = topo.tbl;
+    unreachables = 0;
+    state.ResumeTiming();
+    broker::alm::erase(cpy, neighbor, [&](auto&&...) { ++unreachables; });
+    benchmark::ClobberMemory();
+    benchmark::DoNotOptimize(cpy);
+  }
+  state.counters["unreachables"] = static_cast<double>(unreachables);
+}
+
+BENCHMARK(scaled_erase_neighbor)
+  ->Apply(scaled_args)
+  ->Unit(benchmark::kMicrosecond);
@@ -1,17 +1,30 @@
 #include "generator.hh"
 
 #include "broker/alm/multipath.hh"
+#include "broker/builder.hh"
+#include "broker/data_envelope.hh"
+#include "broker/detail/monotonic_buffer_resource.hh"
 #include "broker/endpoint.hh"
+#include "broker/envelope.hh"
 #include "broker/format/json.hh"
 #include "broker/fwd.hh"
 #include "broker/internal/wire_format.hh"
 #include "broker/message.hh"
+#include "broker/variant.hh"
+#include "broker/variant_data.hh"
+#include "broker/zeek.hh"
 
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
 #include <limits>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 using namespace broker;
 using namespace std::literals;
@@ -85,6 +98,88 @@ public:
   char_buffer json_buf;
 };
 
+/// Generates Zeek messages with a payload of roughly `state.range(0)` bytes.
+/// Each argument of the generated event is a string with `field_size` bytes.
+class payloads : public benchmark::Fixture {
+public:
+  static constexpr size_t field_size = 32;
+
+  static constexpr std::string_view topic_str = "/micro/benchmark";
+
+  using benchmark::Fixture::SetUp;
+
+  void SetUp(const benchmark::State& state) override {
+    generator g;
+    auto num_bytes = static_cast<size_t>(state.range(0));
+    num_fields = std::max(num_bytes / field_size, size_t{1});
+    strings.clear();
+    counts.clear();
+    args.clear();
+    for (size_t i = 0; i < num_fields; ++i) {
+      strings.emplace_back(g.next_string(field_size));
+      counts.emplace_back(g.next_count());
+      args.emplace_back(strings.back());
+    }
+    serial_data = g.next_string(num_bytes);
+    event = data_envelope::make(topic_str,
+                                zeek::Event{"benchmark", args}.raw());
+    zeek::BatchBuilder builder;
+    for (size_t i = 0; i < num_fields; ++i)
+      builder.add(zeek::Event{"benchmark", vector{strings[i]}});
+    batch = data_envelope::make(topic_str, builder.build().raw());
+    auto [bytes, size] = event->raw_bytes();
+    payload.assign(bytes, bytes + size);
+    arena.resize(payload.size() * 4 + 256);
+    frame.clear();
+    broker::internal::wire_format::v1::trait trait;
+    if (!trait.convert(event->with(g.next_endpoint_id(), dst, 16), frame))
+      throw std::logic_error("serialization failed");
+  }
+
+  /// Reports the throughput in bytes of encoded payload.
+  void set_bytes_processed(benchmark::State& state) {
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations())
+                            * static_cast<int64_t>(payload.size()));
+  }
+
+  // Dummy node ID for a receiver.
+  endpoint_id dst;
+
+  // Number of arguments in `event` and number of entries in `batch`.
+  size_t num_fields = 0;
+
+  // Raw input values for the builders.
+  std::vector<std::string> strings;
+
+  // Raw input values for the builders.
+  std::vector<count> counts;
+
+  // Same content as `strings`, but as a broker::vector.
+  vector args;
+
+  // Value for the serial data of log writes with `state.range(0)` bytes.
+  std::string serial_data;
+
+  // A single event with `num_fields` arguments.
+  data_message event;
+
+  // A batch of `num_fields` events with one argument each.
+  data_message batch;
+
+  // The encoded payload of `event`.
+  std::vector<std::byte> payload;
+
+  // Scratch memory for parsing `payload`.
+  std::vector<std::byte> arena;
+
+  // The serialized version of `event` in Broker's wire format.
+  byte_buffer frame;
+};
+
+void payload_sizes(benchmark::internal::Benchmark* b) {
+  b->ArgName("bytes")->RangeMultiplier(8)->Range(64, 64 << 10);
+}
+
 } // namespace
 
 // -- saving and loading data messages -----------------------------------------
@@ -132,3 +227,156 @@ BENCHMARK_DEFINE_F(serialization, load_json)(benchmark::State& state) {
 }
 
 BENCHMARK_REGISTER_F(serialization, load_json)->DenseRange(0, 2, 1);
+
+// -- parsing payloads as on the receive path ----------------------------------
+
+BENCHMARK_DEFINE_F(payloads, parse_shallow)(benchmark::State& state) {
+  for (auto _ : state) {
+    detail::monotonic_buffer_resource buf{arena.data(), arena.size()};
+    variant_data root;
+    auto [ok, pos] = root.parse_shallow(buf, payload.data(), payload.size());
+    if (!ok)
+      throw std::logic_error("parse_shallow failed");
+    benchmark::DoNotOptimize(pos);
+  }
+  set_bytes_processed(state);
+}
+
+BENCHMARK_REGISTER_F(payloads, parse_shallow)->Apply(payload_sizes);
+
+BENCHMARK_DEFINE_F(payloads, data_envelope_deserialize)
+(benchmark::State& state) {
+  for (auto _ : state) {
+    auto res = data_envelope::deserialize(endpoint_id::nil(), dst, 16,
+                                          topic_str, payload.data(),
+                                          payload.size());
+    if (!res)
+      throw std::logic_error("deserialization failed");
+    benchmark::DoNotOptimize(res);
+  }
+  set_bytes_processed(state);
+}
+
+BENCHMARK_REGISTER_F(payloads, data_envelope_deserialize)
+  ->Apply(payload_sizes);
+
+BENCHMARK_DEFINE_F(payloads, envelope_deserialize)(benchmark::State& state) {
+  auto bytes = reinterpret_cast<const std::byte*>(frame.data());
+  for (auto _ : state) {
+    auto res = envelope::deserialize(bytes, frame.size());
+    if (!res)
+      throw std::logic_error("deserialization failed");
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations())
+                          * static_cast<int64_t>(frame.size()));
+}
+
+BENCHMARK_REGISTER_F(payloads, envelope_deserialize)->Apply(payload_sizes);
+
+// -- encoding values with builders --------------------------------------------
+
+BENCHMARK_DEFINE_F(payloads, list_builder)(benchmark::State& state) {
+  for (auto _ : state) {
+    list_builder builder;
+    for (const auto& str : strings)
+      builder.add(str);
+    benchmark::DoNotOptimize(builder.bytes());
+  }
+  set_bytes_processed(state);
+}
+
+BENCHMARK_REGISTER_F(payloads, list_builder)->Apply(payload_sizes);
+
+BENCHMARK_DEFINE_F(payloads, table_builder)(benchmark::State& state) {
+  for (auto _ : state) {
+    table_builder builder;
+    for (size_t i = 0; i < num_fields; ++i)
+      builder.add(counts[i], strings[i]);
+    benchmark::DoNotOptimize(builder.bytes());
+  }
+  set_bytes_processed(state);
+}
+
+BENCHMARK_REGISTER_F(payloads, table_builder)->Apply(payload_sizes);
+
+BENCHMARK_DEFINE_F(payloads, variant_to_data)(benchmark::State& state) {
+  auto val = event->value();
+  for (auto _ : state) {
+    auto res = val.to_data();
+    benchmark::DoNotOptimize(res);
+  }
+  set_bytes_processed(state);
+}
+
+BENCHMARK_REGISTER_F(payloads, variant_to_data)->Apply(payload_sizes);
+
+// -- constructing and decoding Zeek messages ----------------------------------
+
+BENCHMARK_DEFINE_F(payloads, zeek_event_make)(benchmark::State& state) {
+  for (auto _ : state) {
+    list_builder xs;
+    for (const auto& str : strings)
+      xs.add(str);
+    zeek::Event ev{"benchmark", xs};
+    benchmark::DoNotOptimize(ev);
+  }
+  set_bytes_processed(state);
+}
+
+BENCHMARK_REGISTER_F(payloads, zeek_event_make)->Apply(payload_sizes);
+
+BENCHMARK_DEFINE_F(payloads, zeek_event_decode)(benchmark::State& state) {
+  for (auto _ : state) {
+    zeek::Event ev{event};
+    if (!ev.valid())
+      throw std::logic_error("invalid event");
+    size_t total = ev.name().size();
+    for (const auto& x : ev.args())
+      total += x.to_string().size();
+    benchmark::DoNotOptimize(total);
+  }
+  set_bytes_processed(state);
+}
+
+BENCHMARK_REGISTER_F(payloads, zeek_event_decode)->Apply(payload_sizes);
+
+BENCHMARK_DEFINE_F(payloads, zeek_log_write_make)(benchmark::State& state) {
+  enum_value stream_id{"Log::BENCHMARK"};
+  enum_value writer_id{"Log::WRITER_ASCII"};
+  for (auto _ : state) {
+    zeek::LogWrite msg{stream_id, writer_id, "benchmark", serial_data};
+    benchmark::DoNotOptimize(msg);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations())
+                          * static_cast<int64_t>(serial_data.size()));
+}
+
+BENCHMARK_REGISTER_F(payloads, zeek_log_write_make)->Apply(payload_sizes);
+
+BENCHMARK_DEFINE_F(payloads, zeek_batch_make)(benchmark::State& state) {
+  for (auto _ : state) {
+    zeek::BatchBuilder builder;
+    for (const auto& str : strings)
+      builder.add(zeek::Event{"benchmark", vector{str}});
+    auto res = builder.build();
+    benchmark::DoNotOptimize(res);
+  }
+  set_bytes_processed(state);
+}
+
+BENCHMARK_REGISTER_F(payloads, zeek_batch_make)->Apply(payload_sizes);
+
+BENCHMARK_DEFINE_F(payloads, zeek_batch_decode)(benchmark::State& state) {
+  for (auto _ : state) {
+    zeek::Batch res{batch};
+    if (res.size() != num_fields)
+      throw std::logic_error("invalid batch");
+    size_t total = 0;
+    res.for_each([&total](const auto& x) { total += x.valid() ? 1 : 0; });
+    benchmark::DoNotOptimize(total);
+  }
+  set_bytes_processed(state);
+}
+
+BENCHMARK_REGISTER_F(payloads, zeek_batch_decode)->Apply(payload_sizes);
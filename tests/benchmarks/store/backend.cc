@@ -0,0 +1,208 @@
+#include "broker/backend.hh"
+#include "broker/backend_options.hh"
+#include "broker/data.hh"
+#include "broker/detail/abstract_backend.hh"
+#include "broker/detail/filesystem.hh"
+#include "broker/detail/make_backend.hh"
+#include "broker/time.hh"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace broker;
+using namespace std::literals;
+
+namespace {
+
+/// Number of bytes per value.
+constexpr size_t value_size = 64;
+
+/// Creates a backend of the given type with `num_entries` entries and removes
+/// its files when going out of scope.
+class test_backend {
+public:
+  test_backend(backend type, size_t num_entries)
+    : path_(detail::make_temp_file_name()) {
+    backend_options opts;
+    if (type != backend::memory)
+      opts["path"] = path_;
+    impl_ = detail::make_backend(type, std::move(opts));
+    if (!impl_)
+      throw std::runtime_error("failed to create backend");
+    std::minstd_rand rng{0xB7E57};
+    std::uniform_int_distribution<size_t> dis{0, num_entries - 1};
+    for (size_t i = 0; i < num_entries; ++i)
+      keys_.emplace_back("key-" + std::to_string(i));
+    for (size_t i = 0; i < std::min(num_entries, size_t{1024}); ++i)
+      order_.emplace_back(dis(rng));
+    value_ = std::string(value_size, 'x');
+    fill({});
+  }
+
+  test_backend(const test_backend&) = delete;
+
+  test_backend& operator=(const test_backend&) = delete;
+
+  ~test_backend() {
+    impl_.reset();
+    detail::remove_all(path_);
+  }
+
+  detail::abstract_backend* operator->() noexcept {
+    return impl_.get();
+  }
+
+  /// Returns the key for the `n`-th operation. Cycles through a random
+  /// permutation of a subset of the keys.
+  const data& key_at(size_t n) const noexcept {
+    return keys_[order_[n % order_.size()]];
+  }
+
+  const std::vector<data>& keys() const noexcept {
+    return keys_;
+  }
+
+  const data& value() const noexcept {
+    return value_;
+  }
+
+  /// Inserts all keys into the backend within a single transaction.
+  void fill(std::optional<timestamp> expiry) {
+    if (!impl_->begin_transaction())
+      throw std::runtime_error("failed to begin a transaction");
+    for (const auto& key : keys_)
+      if (!impl_->put(key, value_, expiry))
+        throw std::runtime_error("failed to fill the backend");
+    if (!impl_->commit_transaction())
+      throw std::runtime_error("failed to commit a transaction");
+  }
+
+private:
+  std::string path_;
+  std::unique_ptr<detail::abstract_backend> impl_;
+  std::vector<data> keys_;
+  std::vector<size_t> order_;
+  data value_;
+};
+
+/// Reports the throughput in operations per second.
+void set_counters(benchmark::State& state) {
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void store_sizes(benchmark::internal::Benchmark* b) {
+  b->ArgName("entries")->RangeMultiplier(10)->Range(1'000, 100'000);
+}
+
+} // namespace
+
+// -- modifiers ----------------------------------------------------------------
+
+// Overwrites existing entries.
+template <backend Type>
+void backend_put(benchmark::State& state) {
+  test_backend uut{Type, static_cast<size_t>(state.range(0))};
+  size_t n = 0;
+  for (auto _ : state) {
+    auto res = uut->put(uut.key_at(n++), uut.value());
+    benchmark::DoNotOptimize(res);
+  }
+  set_counters(state);
+}
+
+BENCHMARK_TEMPLATE(backend_put, backend::memory)->Apply(store_sizes);
+BENCHMARK_TEMPLATE(backend_put, backend::sqlite)->Apply(store_sizes);
+BENCHMARK_TEMPLATE(backend_put, backend::mmap)->Apply(store_sizes);
+
+// Removes entries, re-inserting all keys once the store runs empty.
+template <backend Type>
+void backend_erase(benchmark::State& state) {
+  test_backend uut{Type, static_cast<size_t>(state.range(0))};
+  size_t n = 0;
+  for (auto _ : state) {
+    if (n == uut.keys().size()) {
+      state.PauseTiming();
+      uut.fill({});
+      n = 0;
+      state.ResumeTiming();
+    }
+    auto res = uut->erase(uut.keys()[n++]);
+    benchmark::DoNotOptimize(res);
+  }
+  set_counters(state);
+}
+
+BENCHMARK_TEMPLATE(backend_erase, backend::memory)->Apply(store_sizes);
+BENCHMARK_TEMPLATE(backend_erase, backend::sqlite)->Apply(store_sizes);
+BENCHMARK_TEMPLATE(backend_erase, backend::mmap)->Apply(store_sizes);
+
+// Removes expired entries, re-inserting all keys once the store runs empty.
+template <backend Type>
+void backend_expire(benchmark::State& state) {
+  test_backend uut{Type, static_cast<size_t>(state.range(0))};
+  auto t0 = broker::now();
+  uut.fill(t0);
+  auto t1 = t0 + 1s;
+  size_t n = 0;
+  for (auto _ : state) {
+    if (n == uut.keys().size()) {
+      state.PauseTiming();
+      uut.fill(t0);
+      n = 0;
+      state.ResumeTiming();
+    }
+    auto res = uut->expire(uut.keys()[n++], t1);
+    if (!res || !*res)
+      throw std::logic_error("failed to expire an entry");
+  }
+  set_counters(state);
+}
+
+BENCHMARK_TEMPLATE(backend_expire, backend::memory)->Apply(store_sizes);
+BENCHMARK_TEMPLATE(backend_expire, backend::sqlite)->Apply(store_sizes);
+BENCHMARK_TEMPLATE(backend_expire, backend::mmap)->Apply(store_sizes);
+
+// -- inspectors ---------------------------------------------------------------
+
+// Looks up existing entries.
+template <backend Type>
+void backend_get(benchmark::State& state) {
+  test_backend uut{Type, static_cast<size_t>(state.range(0))};
+  size_t n = 0;
+  for (auto _ : state) {
+    auto res = uut->get(uut.key_at(n++));
+    benchmark::DoNotOptimize(res);
+  }
+  set_counters(state);
+}
+
+BENCHMARK_TEMPLATE(backend_get, backend::memory)->Apply(store_sizes);
+BENCHMARK_TEMPLATE(backend_get, backend::sqlite)->Apply(store_sizes);
+BENCHMARK_TEMPLATE(backend_get, backend::mmap)->Apply(store_sizes);
+
+// Materializes the full content of the store, i.e., the first step of
+// sending a snapshot to a clone.
+template <backend Type>
+void backend_snapshot(benchmark::State& state) {
+  test_backend uut{Type, static_cast<size_t>(state.range(0))};
+  for (auto _ : state) {
+    auto res = uut->snapshot();
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations())
+                          * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(backend_snapshot, backend::memory)->Apply(store_sizes);
+BENCHMARK_TEMPLATE(backend_snapshot, backend::sqlite)->Apply(store_sizes);
+BENCHMARK_TEMPLATE(backend_snapshot, backend::mmap)->Apply(store_sizes);
@@ -0,0 +1,470 @@
+#include "broker/backend.hh"
+#include "broker/backend_options.hh"
+#include "broker/configuration.hh"
+#include "broker/detail/filesystem.hh"
+#include "broker/endpoint.hh"
+#include "broker/store.hh"
+#include "broker/store_event.hh"
+#include "broker/subscriber.hh"
+#include "broker/topic.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace broker;
+using namespace std::literals;
+
+namespace {
+
+constexpr std::string_view store_name = "benchmark";
+
+/// Marks the end of the initial content of the master.
+constexpr std::string_view sentinel_key = "sentinel";
+
+/// Carries a timestamp for measuring the replication lag.
+constexpr std::string_view probe_key = "probe";
+
+/// Marks the end of the write phase.
+constexpr std::string_view done_key = "done";
+
+struct parameters {
+  std::string backend_type = "memory";
+  uint64_t clone_count = 10;
+  uint64_t store_size = 10'000;
+  uint64_t write_count = 10'000;
+  uint64_t value_size = 100;
+  uint64_t probe_interval = 100;
+  std::string output_format = "text";
+  std::vector<std::string> clone_counts;
+  std::vector<std::string> store_sizes;
+  bool verbose = false;
+};
+
+void add_options(configuration& cfg, parameters& ps) {
+  cfg.add_option(&ps.backend_type, "backend",
+                 "backend of the master: 'memory', 'sqlite' or 'mmap'");
+  cfg.add_option(&ps.clone_count, "clone-count,c", "number of clones");
+  cfg.add_option(&ps.store_size, "store-size,s",
+                 "number of entries in the store before attaching the clones");
+  cfg.add_option(&ps.write_count, "write-count,w",
+                 "number of writes after the clones are in sync");
+  cfg.add_option(&ps.value_size, "value-size", "bytes per value");
+  cfg.add_option(&ps.probe_interval, "probe-interval",
+                 "measure the replication lag for every n-th write");
+  cfg.add_option(&ps.output_format, "output-format",
+                 "print results as 'text' or 'json'");
+  cfg.add_option(&ps.clone_counts, "sweep-clone-counts",
+                 "runs the benchmark once per clone count in the list");
+  cfg.add_option(&ps.store_sizes, "sweep-store-sizes",
+                 "runs the benchmark once per store size in the list");
+  cfg.add_option(&ps.verbose, "verbose", "enables more console output");
+}
+
+std::mutex cout_mtx;
+
+template <class... Ts>
+void verbose_println(const parameters& ps, Ts&&... xs) {
+  if (!ps.verbose)
+    return;
+  std::unique_lock<std::mutex> guard{cout_mtx};
+  (std::clog << ... << xs);
+  std::clog << '\n';
+}
+
+class barrier {
+public:
+  explicit barrier(size_t num_threads) : num_threads_(num_threads) {
+    // nop
+  }
+
+  void arrive_and_wait() {
+    std::unique_lock<std::mutex> guard{mx_};
+    if (++count_ == num_threads_) {
+      cv_.notify_all();
+      return;
+    }
+    cv_.wait(guard, [this] { return count_ == num_threads_; });
+  }
+
+private:
+  size_t num_threads_;
+  size_t count_ = 0;
+  std::mutex mx_;
+  std::condition_variable cv_;
+};
+
+/// Removes the files of a backend when going out of scope.
+struct temp_path {
+  std::string str = detail::make_temp_file_name();
+
+  ~temp_path() {
+    detail::remove_all(str);
+  }
+};
+
+/// Collects the measurements of a single clone.
+struct clone_stats {
+  bool synced = false;
+  timespan sync_time{0};
+  timestamp done;
+  std::vector<timespan> lags;
+};
+
+/// Summarizes a single run of the benchmark.
+struct run_result {
+  uint64_t clone_count = 0;
+  uint64_t store_size = 0;
+  uint64_t write_count = 0;
+  double fill_rate = 0;
+  timespan sync_p50{0};
+  timespan sync_max{0};
+  double write_rate = 0;
+  double replication_rate = 0;
+  double min_clone_rate = 0;
+  timespan lag_p50{0};
+  timespan lag_p99{0};
+  timespan lag_max{0};
+};
+
+/// Points `key` and `value` to the fields of insert and update events.
+/// @returns `false` if `x` is neither an insert nor an update event.
+bool key_and_value(const data& x, const data*& key, const data*& value) {
+  if (auto ev = store_event::insert::make(x)) {
+    key = &ev.key();
+    value = &ev.value();
+    return true;
+  }
+  if (auto ev = store_event::update::make(x)) {
+    key = &ev.key();
+    value = &ev.value();
+    return true;
+  }
+  return false;
+}
+
+bool is_string(const data& x, std::string_view str) {
+  auto ptr = get_if<std::string>(x);
+  return ptr != nullptr && *ptr == str;
+}
+
+// -- actual program logic -----------------------------------------------------
+
+/// Attaches a clone, waits for it to receive the initial content of the master
+/// and then measures the lag of the probes until receiving the done marker.
+/// Keeps the clone alive until the master became idle.
+void run_clone(barrier* synced, barrier* finished, clone_stats* stats,
+               uint16_t port, const parameters& ps, size_t index) {
+  endpoint ep;
+  auto sub = ep.make_subscriber(
+    {topic::store_events() / topic{std::string{store_name}}});
+  if (!ep.peer("localhost", port)) {
+    std::cerr << "*** clone " << index << " failed to peer with the master\n";
+    abort();
+  }
+  auto t0 = broker::now();
+  auto ds = ep.attach_clone(std::string{store_name});
+  if (!ds) {
+    std::cerr << "*** clone " << index << " failed to attach\n";
+    abort();
+  }
+  const data* key = nullptr;
+  const data* value = nullptr;
+  // Phase 1: wait for the snapshot.
+  while (!stats->synced) {
+    auto msg = sub.get(10s);
+    if (!msg) {
+      std::cerr << "*** clone " << index << " timed out while syncing\n";
+      abort();
+    }
+    auto ev = get_data(*msg).to_data();
+    if (key_and_value(ev, key, value) && is_string(*key, sentinel_key)) {
+      stats->sync_time = broker::now() - t0;
+      stats->synced = true;
+    }
+  }
+  verbose_println(ps, "clone ", index, " in sync after ",
+                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                    stats->sync_time)
+                    .count(),
+                  "ms");
+  synced->arrive_and_wait();
+  // Phase 2: observe the writes.
+  for (;;) {
+    auto msg = sub.get(30s);
+    if (!msg) {
+      std::cerr << "*** clone " << index << " timed out while replicating\n";
+      abort();
+    }
+    auto ev = get_data(*msg).to_data();
+    if (!key_and_value(ev, key, value))
+      continue;
+    if (is_string(*key, probe_key)) {
+      if (auto ts = get_if<timestamp>(*value))
+        stats->lags.emplace_back(broker::now() - *ts);
+    } else if (is_string(*key, done_key)) {
+      stats->done = broker::now();
+      break;
+    }
+  }
+  finished->arrive_and_wait();
+}
+
+/// Returns the element at percentile `p`.
+/// @pre `xs` is sorted
+timespan percentile(const std::vector<timespan>& xs, double p) {
+  if (xs.empty())
+    return timespan{0};
+  return xs[static_cast<size_t>(p * static_cast<double>(xs.size() - 1))];
+}
+
+double to_seconds(timespan x) {
+  using fractional_seconds = std::chrono::duration<double>;
+  return std::chrono::duration_cast<fractional_seconds>(x).count();
+}
+
+run_result run_once(configuration cfg, const parameters& ps,
+                    backend backend_type) {
+  // Note: declared before the endpoint in order to remove the files only after
+  //       the master has closed them.
+  temp_path path;
+  endpoint ep{std::move(cfg)};
+  auto port = ep.listen();
+  backend_options opts;
+  if (backend_type != backend::memory)
+    opts["path"] = path.str;
+  auto ds = ep.attach_master(std::string{store_name}, backend_type,
+                             std::move(opts));
+  if (!ds) {
+    std::cerr << "*** failed to attach the master\n";
+    abort();
+  }
+  run_result result;
+  result.clone_count = ps.clone_count;
+  result.store_size = ps.store_size;
+  result.write_count = ps.write_count;
+  // Fill the master.
+  auto value = data{std::string(ps.value_size, 'x')};
+  auto t0 = broker::now();
+  for (size_t i = 0; i < ps.store_size; ++i)
+    ds->put("key-" + std::to_string(i), value);
+  ds->put(std::string{sentinel_key}, true);
+  if (!ds->await_idle()) {
+    std::cerr << "*** master failed to become idle after filling the store\n";
+    abort();
+  }
+  result.fill_rate = static_cast<double>(ps.store_size)
+                     / to_seconds(broker::now() - t0);
+  verbose_println(ps, "filled master with ", ps.store_size, " entries");
+  // Attach the clones and wait until all of them received the snapshot.
+  barrier synced{ps.clone_count + 1};
+  barrier finished{ps.clone_count + 1};
+  std::vector<clone_stats> stats;
+  stats.resize(ps.clone_count);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < ps.clone_count; ++i)
+    threads.emplace_back(run_clone, &synced, &finished, &stats[i], port,
+                         std::cref(ps), i);
+  synced.arrive_and_wait();
+  std::vector<timespan> sync_times;
+  for (auto& x : stats)
+    sync_times.emplace_back(x.sync_time);
+  std::sort(sync_times.begin(), sync_times.end());
+  result.sync_p50 = percentile(sync_times, 0.5);
+  result.sync_max = percentile(sync_times, 1.0);
+  verbose_println(ps, "all clones in sync -> run!");
+  // Overwrite existing entries, putting a probe every n-th write.
+  auto t1 = broker::now();
+  for (size_t i = 0; i < ps.write_count; ++i) {
+    if (ps.probe_interval > 0 && i % ps.probe_interval == 0)
+      ds->put(std::string{probe_key}, broker::now());
+    else
+      ds->put("key-" + std::to_string(i % std::max(ps.store_size,
+                                                   uint64_t{1})),
+              value);
+  }
+  ds->put(std::string{done_key}, true);
+  auto t2 = broker::now();
+  if (!ds->await_idle())
+    std::cerr << "*** master failed to become idle after the writes\n";
+  auto t3 = broker::now();
+  finished.arrive_and_wait();
+  for (auto& hdl : threads)
+    hdl.join();
+
+  // Compute the results.
+  auto writes = static_cast<double>(ps.write_count);
+  result.write_rate = writes / to_seconds(t2 - t1);
+  result.replication_rate = writes / to_seconds(t3 - t1);
+  std::vector<timespan> lags;
+  auto last = t1;
+  for (auto& x : stats) {
+    last = std::max(last, x.done);
+    lags.insert(lags.end(), x.lags.begin(), x.lags.end());
+  }
+  if (!stats.empty())
+    result.min_clone_rate = writes / to_seconds(last - t1);
+  std::sort(lags.begin(), lags.end());
+  result.lag_p50 = percentile(lags, 0.5);
+  result.lag_p99 = percentile(lags, 0.99);
+  result.lag_max = percentile(lags, 1.0);
+  return result;
+}
+
+// -- output -------------------------------------------------------------------
+
+double to_ms(timespan x) {
+  using fractional_ms = std::chrono::duration<double, std::milli>;
+  return std::chrono::duration_cast<fractional_ms>(x).count();
+}
+
+void print_text(const run_result& x) {
+  std::cout << "clones: " << x.clone_count << ", store size: " << x.store_size
+            << ", writes: " << x.write_count << '\n'
+            << "  fill rate: " << x.fill_rate << " writes/s\n"
+            << "  snapshot sync: p50 " << to_ms(x.sync_p50) << "ms, max "
+            << to_ms(x.sync_max) << "ms\n"
+            << "  write rate: " << x.write_rate << " writes/s, replication "
+            << "rate: " << x.replication_rate << " writes/s, slowest clone: "
+            << x.min_clone_rate << " writes/s\n"
+            << "  replication lag: p50 " << to_ms(x.lag_p50) << "ms, p99 "
+            << to_ms(x.lag_p99) << "ms, max " << to_ms(x.lag_max) << "ms\n";
+}
+
+std::string to_json(const run_result& x) {
+  std::ostringstream str;
+  str << "{\"clones\": " << x.clone_count
+      << ", \"store_size\": " << x.store_size
+      << ", \"writes\": " << x.write_count
+      << ", \"fill_rate\": " << x.fill_rate
+      << ", \"sync_ms\": {\"p50\": " << to_ms(x.sync_p50)
+      << ", \"max\": " << to_ms(x.sync_max) << "}"
+      << ", \"write_rate\": " << x.write_rate
+      << ", \"replication_rate\": " << x.replication_rate
+      << ", \"min_clone_rate\": " << x.min_clone_rate
+      << ", \"lag_ms\": {\"p50\": " << to_ms(x.lag_p50)
+      << ", \"p99\": " << to_ms(x.lag_p99) << ", \"max\": " << to_ms(x.lag_max)
+      << "}}";
+  return str.str();
+}
+
+// -- main ---------------------------------------------------------------------
+
+/// Parses the CLI arguments into a new configuration.
+std::optional<configuration> make_config(int argc, char** argv,
+                                         parameters& params) {
+  configuration cfg{skip_init};
+  add_options(cfg, params);
+  try {
+    cfg.init(argc, argv);
+  } catch (std::exception& ex) {
+    std::cerr << ex.what() << "\n\n";
+    return std::nullopt;
+  }
+  return {std::move(cfg)};
+}
+
+bool parse_list(const std::vector<std::string>& strs, uint64_t fallback,
+                std::vector<uint64_t>& result) {
+  if (strs.empty()) {
+    result.push_back(fallback);
+    return true;
+  }
+  // Accept lists as well as comma-separated values.
+  try {
+    for (const auto& str : strs) {
+      std::istringstream in{str};
+      std::string item;
+      while (std::getline(in, item, ','))
+        result.push_back(std::stoull(item));
+    }
+  } catch (std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+bool parse_backend(const std::string& str, backend& result) {
+  for (auto x : {backend::memory, backend::sqlite, backend::mmap}) {
+    if (str == to_string(x)) {
+      result = x;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  parameters params;
+  auto cfg = make_config(argc, argv, params);
+  if (!cfg)
+    return EXIT_FAILURE;
+  if (cfg->cli_helptext_printed())
+    return EXIT_SUCCESS;
+  if (cfg->remainder().size() > 0) {
+    std::cerr << "*** too many arguments (did not expect any)\n\n";
+    return EXIT_FAILURE;
+  }
+  const auto& fmt = params.output_format;
+  if (fmt != "text" && fmt != "json") {
+    std::cerr << "*** invalid output format: " << fmt << "\n\n";
+    return EXIT_FAILURE;
+  }
+  auto backend_type = backend::memory;
+  if (!parse_backend(params.backend_type, backend_type)) {
+    std::cerr << "*** invalid backend: " << params.backend_type << "\n\n";
+    return EXIT_FAILURE;
+  }
+  std::vector<uint64_t> clone_counts;
+  std::vector<uint64_t> store_sizes;
+  if (!parse_list(params.clone_counts, params.clone_count, clone_counts)
+      || !parse_list(params.store_sizes, params.store_size, store_sizes)) {
+    std::cerr << "*** invalid sweep parameters\n\n";
+    return EXIT_FAILURE;
+  }
+  // Run the benchmark once per combination of the sweep parameters.
+  std::vector<run_result> results;
+  for (auto clone_count : clone_counts) {
+    for (auto store_size : store_sizes) {
+      auto ps = params;
+      ps.clone_count = clone_count;
+      ps.store_size = store_size;
+      run_result res;
+      if (results.empty()) {
+        res = run_once(std::move(*cfg), ps, backend_type);
+      } else {
+        // Each endpoint needs its own configuration.
+        parameters tmp;
+        res = run_once(std::move(*make_config(argc, argv, tmp)), ps,
+                       backend_type);
+      }
+      if (fmt == "text")
+        print_text(res);
+      results.emplace_back(std::move(res));
+    }
+  }
+  if (fmt == "json") {
+    std::string str = "[";
+    for (size_t i = 0; i < results.size(); ++i) {
+      str += i == 0 ? "\n  " : ",\n  ";
+      str += to_json(results[i]);
+    }
+    str += "\n]";
+    std::cout << str << std::endl;
+  }
+}
@@ -0,0 +1,604 @@
+#include "broker/configuration.hh"
+#include "broker/data.hh"
+#include "broker/endpoint.hh"
+#include "broker/envelope.hh"
+#include "broker/format/json.hh"
+#include "broker/message.hh"
+#include "broker/subscriber.hh"
+#include "broker/time.hh"
+#include "broker/topic.hh"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef BROKER_WINDOWS
+#  include <netdb.h>
+#  include <sys/socket.h>
+#  include <sys/types.h>
+#  include <unistd.h>
+#endif // BROKER_WINDOWS
+
+using namespace broker;
+using namespace std::literals;
+
+namespace {
+
+constexpr std::string_view publish_topic = "/benchmark/ws/publish";
+
+constexpr std::string_view subscribe_topic = "/benchmark/ws/subscribe";
+
+struct parameters {
+  uint64_t client_count = 10;
+  uint64_t message_count = 10'000;
+  uint64_t payload_size = 100;
+  double rate = 10'000;
+  std::string direction = "both";
+  std::string output_format = "text";
+  bool verbose = false;
+};
+
+void add_options(configuration& cfg, parameters& ps) {
+  cfg.add_option(&ps.client_count, "client-count,c",
+                 "number of WebSocket clients");
+  cfg.add_option(&ps.message_count, "message-count,m",
+                 "number of messages per client and direction");
+  cfg.add_option(&ps.payload_size, "payload-size,s", "bytes per message");
+  cfg.add_option(&ps.rate, "rate,r",
+                 "messages per second and publisher (0 = maximum rate)");
+  cfg.add_option(&ps.direction, "direction",
+                 "runs 'publish', 'subscribe' or 'both' directions");
+  cfg.add_option(&ps.output_format, "output-format",
+                 "print results as 'text' or 'json'");
+  cfg.add_option(&ps.verbose, "verbose", "enables more console output");
+}
+
+std::mutex cout_mtx;
+
+template <class... Ts>
+void verbose_println(const parameters& ps, Ts&&... xs) {
+  if (!ps.verbose)
+    return;
+  std::unique_lock<std::mutex> guard{cout_mtx};
+  (std::clog << ... << xs);
+  std::clog << '\n';
+}
+
+/// Returns the current time as nanoseconds since the epoch. Messages carry
+/// their creation time as count, which keeps parsing on the clients trivial.
+count now_ns() {
+  return static_cast<count>(broker::now().time_since_epoch().count());
+}
+
+std::string make_payload(size_t size) {
+  return std::string(size, 'x');
+}
+
+/// Renders a data message in the JSON format of the WebSocket API.
+std::string make_json(std::string_view topic_str, count ts,
+                      const std::string& payload) {
+  std::string result;
+  result += R"_({"type":"data-message","topic":")_";
+  result += topic_str;
+  result += R"_(","@data-type":"vector","data":[)_";
+  result += R"_({"@data-type":"count","data":)_";
+  result += std::to_string(ts);
+  result += R"_(},{"@data-type":"string","data":")_";
+  result += payload;
+  result += R"_("}]})_";
+  return result;
+}
+
+/// Extracts the timestamp from a message rendered by Broker. Returns 0 if the
+/// text contains no timestamp (e.g., for error messages).
+count parse_ts(const std::string& str) {
+  constexpr std::string_view prefix = R"_("@data-type":"count","data":)_";
+  auto pos = str.find(prefix);
+  if (pos == std::string::npos)
+    return 0;
+  return std::strtoull(str.c_str() + pos + prefix.size(), nullptr, 10);
+}
+
+/// A minimal WebSocket client that exchanges JSON messages with Broker, i.e.,
+/// that mimics a client such as a Python script using the WebSocket API.
+class web_socket_client {
+public:
+  web_socket_client() : engine_(std::random_device{}()) {
+    // nop
+  }
+
+  web_socket_client(const web_socket_client&) = delete;
+
+  web_socket_client& operator=(const web_socket_client&) = delete;
+
+  ~web_socket_client() {
+#ifndef BROKER_WINDOWS
+    if (fd_ != -1)
+      close(fd_);
+#endif
+  }
+
+  /// Connects to Broker at `host:port` and performs the WebSocket handshake
+  /// as well as Broker's handshake for subscribing to `filter`.
+  bool connect(const std::string& host, uint16_t port,
+               const std::vector<std::string_view>& filter) {
+#ifdef BROKER_WINDOWS
+    std::cerr << "*** WebSocket clients are not supported on Windows\n";
+    return false;
+#else
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addrs = nullptr;
+    auto port_str = std::to_string(port);
+    if (getaddrinfo(host.c_str(), port_str.c_str(), &hints, &addrs) != 0)
+      return false;
+    for (auto addr = addrs; addr != nullptr; addr = addr->ai_next) {
+      fd_ = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+      if (fd_ == -1)
+        continue;
+      if (::connect(fd_, addr->ai_addr, addr->ai_addrlen) == 0)
+        break;
+      close(fd_);
+      fd_ = -1;
+    }
+    freeaddrinfo(addrs);
+    if (fd_ == -1)
+      return false;
+    // Upgrade the connection. The server does not check the key, so we use
+    // the sample nonce from RFC 6455.
+    auto request = "GET /v1/messages/json HTTP/1.1\r\n"
+                   "Host: "
+                   + host + ":" + port_str
+                   + "\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                     "Sec-WebSocket-Version: 13\r\n\r\n";
+    if (!write_all(request.data(), request.size()))
+      return false;
+    std::string response;
+    while (response.find("\r\n\r\n") == std::string::npos) {
+      char ch;
+      if (recv(fd_, &ch, 1, 0) != 1)
+        return false;
+      response += ch;
+    }
+    if (response.compare(0, 12, "HTTP/1.1 101") != 0) {
+      std::cerr << "*** WebSocket handshake failed: "
+                << response.substr(0, response.find('\r')) << '\n';
+      return false;
+    }
+    // Broker expects the list of subscriptions first and responds with an
+    // ACK message.
+    std::string subs = "[";
+    for (size_t i = 0; i < filter.size(); ++i) {
+      if (i > 0)
+        subs += ',';
+      subs += '"';
+      subs += filter[i];
+      subs += '"';
+    }
+    subs += ']';
+    if (!send_text(subs))
+      return false;
+    std::string ack;
+    if (!read_frame(ack) || ack.find("\"ack\"") == std::string::npos) {
+      std::cerr << "*** Broker handshake failed: " << ack << '\n';
+      return false;
+    }
+    return true;
+#endif
+  }
+
+  /// Sends `payload` in a single text frame.
+  bool send_text(std::string_view payload) {
+    buf_.clear();
+    buf_.push_back(static_cast<char>(0x81)); // FIN + text frame.
+    auto len = static_cast<uint64_t>(payload.size());
+    if (len < 126) {
+      buf_.push_back(static_cast<char>(0x80 | len));
+    } else if (len <= 0xFFFF) {
+      buf_.push_back(static_cast<char>(0x80 | 126));
+      for (int shift = 8; shift >= 0; shift -= 8)
+        buf_.push_back(static_cast<char>((len >> shift) & 0xFF));
+    } else {
+      buf_.push_back(static_cast<char>(0x80 | 127));
+      for (int shift = 56; shift >= 0; shift -= 8)
+        buf_.push_back(static_cast<char>((len >> shift) & 0xFF));
+    }
+    // Clients must mask all frames.
+    std::array<char, 4> mask;
+    for (auto& x : mask)
+      x = static_cast<char>(engine_() & 0xFF);
+    buf_.insert(buf_.end(), mask.begin(), mask.end());
+    for (size_t i = 0; i < payload.size(); ++i)
+      buf_.push_back(static_cast<char>(payload[i] ^ mask[i % 4]));
+    return write_all(buf_.data(), buf_.size());
+  }
+
+  /// Reads a single, unmasked frame from the server.
+  /// @returns `false` if the server closed the connection.
+  bool read_frame(std::string& payload) {
+    unsigned char hdr[2];
+    if (!read_all(reinterpret_cast<char*>(hdr), 2))
+      return false;
+    uint64_t len = hdr[1] & 0x7F;
+    if (len >= 126) {
+      unsigned char ext[8];
+      auto ext_size = len == 126 ? size_t{2} : size_t{8};
+      if (!read_all(reinterpret_cast<char*>(ext), ext_size))
+        return false;
+      len = 0;
+      for (size_t i = 0; i < ext_size; ++i)
+        len = (len << 8) | ext[i];
+    }
+    payload.resize(len);
+    // Opcode 0x8 signals a close frame.
+    return read_all(payload.data(), payload.size()) && (hdr[0] & 0x0F) != 0x8;
+  }
+
+private:
+  bool write_all(const char* data, size_t size) {
+#ifdef BROKER_WINDOWS
+    return false;
+#else
+    while (size > 0) {
+      auto res = send(fd_, data, size, 0);
+      if (res <= 0)
+        return false;
+      data += res;
+      size -= static_cast<size_t>(res);
+    }
+    return true;
+#endif
+  }
+
+  bool read_all(char* data, size_t size) {
+#ifdef BROKER_WINDOWS
+    return false;
+#else
+    while (size > 0) {
+      auto res = recv(fd_, data, size, 0);
+      if (res <= 0)
+        return false;
+      data += res;
+      size -= static_cast<size_t>(res);
+    }
+    return true;
+#endif
+  }
+
+  int fd_ = -1;
+  std::minstd_rand engine_;
+  std::vector<char> buf_;
+};
+
+/// Sends messages at a fixed rate or as fast as possible if `rate` is 0.
+class pacer {
+public:
+  using clock_type = std::chrono::steady_clock;
+
+  explicit pacer(double rate) {
+    if (rate > 0)
+      interval_ = std::chrono::duration_cast<clock_type::duration>(
+        std::chrono::duration<double>(1.0 / rate));
+  }
+
+  void wait() {
+    if (interval_.count() == 0)
+      return;
+    next_ += interval_;
+    std::this_thread::sleep_until(next_);
+  }
+
+private:
+  clock_type::duration interval_{0};
+  clock_type::time_point next_ = clock_type::now();
+};
+
+/// Summarizes a single direction.
+struct direction_result {
+  uint64_t messages = 0;
+  double runtime = 0;
+  double frames_per_second = 0;
+  timespan p50{0};
+  timespan p99{0};
+  timespan max{0};
+};
+
+/// Summarizes a single run of the benchmark.
+struct run_result {
+  uint64_t client_count = 0;
+  uint64_t payload_size = 0;
+  double rate = 0;
+  double encode_ns = 0;
+  double decode_ns = 0;
+  std::optional<direction_result> publish;
+  std::optional<direction_result> subscribe;
+};
+
+/// Returns the element at percentile `p`.
+/// @pre `xs` is sorted
+timespan percentile(const std::vector<timespan>& xs, double p) {
+  if (xs.empty())
+    return timespan{0};
+  return xs[static_cast<size_t>(p * static_cast<double>(xs.size() - 1))];
+}
+
+double to_seconds(timespan x) {
+  using fractional_seconds = std::chrono::duration<double>;
+  return std::chrono::duration_cast<fractional_seconds>(x).count();
+}
+
+direction_result make_result(std::vector<timespan>& latencies,
+                             timespan runtime) {
+  direction_result result;
+  result.messages = latencies.size();
+  result.runtime = to_seconds(runtime);
+  result.frames_per_second = static_cast<double>(latencies.size())
+                             / result.runtime;
+  std::sort(latencies.begin(), latencies.end());
+  result.p50 = percentile(latencies, 0.5);
+  result.p99 = percentile(latencies, 0.99);
+  result.max = percentile(latencies, 1.0);
+  return result;
+}
+
+// -- actual program logic -----------------------------------------------------
+
+/// Measures the cost of rendering a message as JSON (subscribe direction) and
+/// of parsing a message from JSON (publish direction) on the server.
+void measure_json(const parameters& ps, run_result& result) {
+  constexpr size_t num_iterations = 10'000;
+  auto payload = make_payload(ps.payload_size);
+  auto msg = make_data_message(topic{std::string{subscribe_topic}},
+                               data{vector{now_ns(), payload}});
+  std::string str;
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num_iterations; ++i) {
+    str.clear();
+    format::json::v1::encode(msg, std::back_inserter(str));
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num_iterations; ++i) {
+    if (!envelope::deserialize_json(str.data(), str.size())) {
+      std::cerr << "*** failed to parse: " << str << '\n';
+      abort();
+    }
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  auto per_msg = [](auto x) {
+    using fractional_ns = std::chrono::duration<double, std::nano>;
+    return std::chrono::duration_cast<fractional_ns>(x).count()
+           / static_cast<double>(num_iterations);
+  };
+  result.encode_ns = per_msg(t1 - t0);
+  result.decode_ns = per_msg(t2 - t1);
+}
+
+std::vector<std::unique_ptr<web_socket_client>>
+connect_clients(uint16_t port, const parameters& ps,
+                const std::vector<std::string_view>& filter) {
+  std::vector<std::unique_ptr<web_socket_client>> result;
+  for (size_t i = 0; i < ps.client_count; ++i) {
+    auto client = std::make_unique<web_socket_client>();
+    if (!client->connect("localhost", port, filter)) {
+      std::cerr << "*** client " << i << " failed to connect\n";
+      abort();
+    }
+    result.emplace_back(std::move(client));
+  }
+  verbose_println(ps, "connected ", ps.client_count, " clients");
+  return result;
+}
+
+/// The clients publish to a subscriber on the endpoint.
+direction_result run_publish(endpoint& ep, uint16_t port,
+                             const parameters& ps) {
+  auto sub = ep.make_subscriber({topic{std::string{publish_topic}}});
+  auto clients = connect_clients(port, ps, {});
+  auto t0 = broker::now();
+  std::vector<std::thread> threads;
+  for (auto& client : clients) {
+    threads.emplace_back([&ps, ptr = client.get()] {
+      auto payload = make_payload(ps.payload_size);
+      pacer p{ps.rate};
+      for (size_t i = 0; i < ps.message_count; ++i) {
+        p.wait();
+        if (!ptr->send_text(make_json(publish_topic, now_ns(), payload))) {
+          std::cerr << "*** lost WebSocket connection\n";
+          abort();
+        }
+      }
+    });
+  }
+  auto total = ps.client_count * ps.message_count;
+  std::vector<timespan> latencies;
+  latencies.reserve(total);
+  while (latencies.size() < total) {
+    auto msgs = sub.get(std::min(size_t{128}, total - latencies.size()), 10s);
+    if (msgs.empty()) {
+      std::cerr << "*** timed out after receiving " << latencies.size()
+                << " messages\n";
+      abort();
+    }
+    auto now = now_ns();
+    for (auto& msg : msgs) {
+      auto xs = msg->value().to_list();
+      if (xs.size() == 2 && xs[0].is_count())
+        latencies.emplace_back(static_cast<timespan::rep>(now
+                                                          - xs[0].to_count()));
+    }
+  }
+  auto runtime = broker::now() - t0;
+  for (auto& hdl : threads)
+    hdl.join();
+  return make_result(latencies, runtime);
+}
+
+/// The endpoint publishes to all clients.
+direction_result run_subscribe(endpoint& ep, uint16_t port,
+                               const parameters& ps) {
+  auto clients = connect_clients(port, ps, {subscribe_topic});
+  if (!ep.await_filter_entry(topic{std::string{subscribe_topic}})) {
+    std::cerr << "*** clients failed to subscribe\n";
+    abort();
+  }
+  auto t0 = broker::now();
+  std::vector<std::vector<timespan>> latencies;
+  latencies.resize(clients.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < clients.size(); ++i) {
+    threads.emplace_back([&ps, ptr = clients[i].get(), out = &latencies[i]] {
+      std::string frame;
+      out->reserve(ps.message_count);
+      while (out->size() < ps.message_count) {
+        if (!ptr->read_frame(frame)) {
+          std::cerr << "*** lost WebSocket connection\n";
+          abort();
+        }
+        auto now = now_ns();
+        if (auto ts = parse_ts(frame); ts != 0)
+          out->emplace_back(static_cast<timespan::rep>(now - ts));
+      }
+    });
+  }
+  auto payload = make_payload(ps.payload_size);
+  pacer p{ps.rate};
+  for (size_t i = 0; i < ps.message_count; ++i) {
+    p.wait();
+    ep.publish(topic{std::string{subscribe_topic}},
+               data{vector{now_ns(), payload}});
+  }
+  for (auto& hdl : threads)
+    hdl.join();
+  auto runtime = broker::now() - t0;
+  std::vector<timespan> all;
+  for (auto& xs : latencies)
+    all.insert(all.end(), xs.begin(), xs.end());
+  return make_result(all, runtime);
+}
+
+run_result run(configuration cfg, const parameters& ps) {
+  run_result result;
+  result.client_count = ps.client_count;
+  result.payload_size = ps.payload_size;
+  result.rate = ps.rate;
+  measure_json(ps, result);
+  endpoint ep{std::move(cfg)};
+  error err;
+  auto port = ep.web_socket_listen("127.0.0.1", 0, &err);
+  if (port == 0) {
+    std::cerr << "*** failed to open a WebSocket port: " << to_string(err)
+              << '\n';
+    abort();
+  }
+  if (ps.direction != "subscribe")
+    result.publish = run_publish(ep, port, ps);
+  if (ps.direction != "publish")
+    result.subscribe = run_subscribe(ep, port, ps);
+  return result;
+}
+
+// -- output -------------------------------------------------------------------
+
+double to_us(timespan x) {
+  using fractional_us = std::chrono::duration<double, std::micro>;
+  return std::chrono::duration_cast<fractional_us>(x).count();
+}
+
+void print_text(std::string_view name, const direction_result& x) {
+  std::cout << "  " << name << ": " << x.messages << " messages in "
+            << x.runtime << "s, " << x.frames_per_second << " frames/s\n"
+            << "    latency: p50 " << to_us(x.p50) << "us, p99 "
+            << to_us(x.p99) << "us, max " << to_us(x.max) << "us\n";
+}
+
+void print_text(const run_result& x) {
+  std::cout << "clients: " << x.client_count
+            << ", payload size: " << x.payload_size << ", rate: " << x.rate
+            << " msg/s\n"
+            << "  JSON encode: " << x.encode_ns << "ns/msg, decode: "
+            << x.decode_ns << "ns/msg\n";
+  if (x.publish)
+    print_text("publish", *x.publish);
+  if (x.subscribe)
+    print_text("subscribe", *x.subscribe);
+}
+
+std::string to_json(const direction_result& x) {
+  std::ostringstream str;
+  str << "{\"messages\": " << x.messages << ", \"runtime\": " << x.runtime
+      << ", \"frames_per_second\": " << x.frames_per_second
+      << ", \"latency_us\": {\"p50\": " << to_us(x.p50)
+      << ", \"p99\": " << to_us(x.p99) << ", \"max\": " << to_us(x.max)
+      << "}}";
+  return str.str();
+}
+
+std::string to_json(const run_result& x) {
+  std::ostringstream str;
+  str << "{\"clients\": " << x.client_count
+      << ", \"payload_size\": " << x.payload_size << ", \"rate\": " << x.rate
+      << ", \"json_ns\": {\"encode\": " << x.encode_ns
+      << ", \"decode\": " << x.decode_ns << "}";
+  if (x.publish)
+    str << ", \"publish\": " << to_json(*x.publish);
+  if (x.subscribe)
+    str << ", \"subscribe\": " << to_json(*x.subscribe);
+  str << "}";
+  return str.str();
+}
+
+} // namespace
+
+// -- main ---------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+  parameters params;
+  configuration cfg{skip_init};
+  add_options(cfg, params);
+  try {
+    cfg.init(argc, argv);
+  } catch (std::exception& ex) {
+    std::cerr << ex.what() << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (cfg.cli_helptext_printed())
+    return EXIT_SUCCESS;
+  if (cfg.remainder().size() > 0) {
+    std::cerr << "*** too many arguments (did not expect any)\n\n";
+    return EXIT_FAILURE;
+  }
+  const auto& fmt = params.output_format;
+  if (fmt != "text" && fmt != "json") {
+    std::cerr << "*** invalid output format: " << fmt << "\n\n";
+    return EXIT_FAILURE;
+  }
+  const auto& dir = params.direction;
+  if (dir != "publish" && dir != "subscribe" && dir != "both") {
+    std::cerr << "*** invalid direction: " << dir << "\n\n";
+    return EXIT_FAILURE;
+  }
+  auto res = run(std::move(cfg), params);
+  if (fmt == "text")
+    print_text(res);
+  else
+    std::cout << to_json(res) << std::endl;
+}
@@ -0,0 +1,115 @@
+# @TEST-GROUP: web-socket
+#
+# @TEST-PORT: BROKER_WEB_SOCKET_PORT
+#
+# @TEST-EXEC: btest-bg-run node "broker-node --config-file=../node.cfg"
+# @TEST-EXEC: btest-bg-run recv "python3 ../recv.py >recv.out"
+# @TEST-EXEC: $SCRIPTS/wait-for-file recv/ready 15 || (btest-bg-wait -k 1 && false)
+#
+# @TEST-EXEC: btest-bg-run send "python3 ../send.py >send.out"
+#
+# @TEST-EXEC: $SCRIPTS/wait-for-file recv/done 30 || (btest-bg-wait -k 1 && false)
+# @TEST-EXEC: btest-diff recv/recv.out
+# @TEST-EXEC: btest-diff send/send.out
+#
+# @TEST-EXEC: btest-bg-wait -k 1
+
+@TEST-START-FILE node.cfg
+
+broker {
+  disable-ssl = true
+}
+topics = ["/test"]
+verbose = true
+
+@TEST-END-FILE
+
+@TEST-START-FILE recv.py
+
+import asyncio, websockets, os, time, json, sys
+
+ws_port = os.environ['BROKER_WEB_SOCKET_PORT'].split('/')[0]
+
+ws_url = f'ws://localhost:{ws_port}/v1/messages/bin'
+
+async def do_run():
+    # Try up to 30 times.
+    connected  = False
+    for i in range(30):
+        try:
+            ws = await websockets.connect(ws_url)
+            connected  = True
+            # send filter and wait for ack
+            await ws.send('["/test"]')
+            ack = json.loads(await ws.recv())
+            print(f'ack: {ack["type"]}')
+            # tell btest to start the sender now
+            with open('ready', 'w') as f:
+                f.write('ready')
+            # the first data message must arrive in a binary frame
+            msg = await ws.recv()
+            if not isinstance(msg, bytes):
+                print(f'expected a binary frame, got: {msg}')
+                sys.exit(1)
+            topic_len = int.from_bytes(msg[35:37], 'big')
+            print(f'type: {msg[32]}')
+            print(f'topic: {msg[37:37 + topic_len].decode()}')
+            print(f'payload: {msg[37 + topic_len:].hex()}')
+            # tell btest we're done
+            with open('done', 'w') as f:
+                f.write('done')
+            await ws.close()
+            sys.exit()
+        except:
+            if not connected:
+                print(f'failed to connect to {ws_url}, try again', file=sys.stderr)
+                time.sleep(1)
+            else:
+                sys.exit()
+
+loop = asyncio.get_event_loop()
+loop.run_until_complete(do_run())
+
+@TEST-END-FILE
+
+@TEST-START-FILE send.py
+
+import asyncio, websockets, os, json, sys
+
+ws_port = os.environ['BROKER_WEB_SOCKET_PORT'].split('/')[0]
+
+json_url = f'ws://localhost:{ws_port}/v1/messages/json'
+
+bin_url = f'ws://localhost:{ws_port}/v1/messages/bin'
+
+# Renders a data message with a string value in Broker's native format.
+def native_message(topic, value):
+    result = bytes(32) # sender and receiver ID
+    result += bytes([1]) # message type
+    result += (20).to_bytes(2, 'big') # TTL
+    result += len(topic).to_bytes(2, 'big') + topic.encode()
+    result += bytes([5, len(value)]) + value.encode() # string tag + varbyte
+    return result
+
+async def do_run():
+    # The JSON endpoint treats all frames as JSON, even if they look like a
+    # native message.
+    async with websockets.connect(json_url) as ws:
+        await ws.send('[]')
+        await ws.recv() # wait for ACK
+        await ws.send('\0' + native_message('/test', 'Hello JSON!').decode())
+        err = json.loads(await ws.recv())
+        want = 'input #1 contained malformed JSON'
+        if err['context'].startswith(want):
+            err['context'] = want
+        print(json.dumps(err, sort_keys=True, indent=2))
+    # Clients on the binary endpoint may send native messages.
+    async with websockets.connect(bin_url) as ws:
+        await ws.send('[]')
+        await ws.recv() # wait for ACK
+        await ws.send(native_message('/test', 'Hello Broker!'))
+
+loop = asyncio.get_event_loop()
+loop.run_until_complete(do_run())
+
+@TEST-END-FILE
@@ -0,0 +1,57 @@
+
+import asyncio
+import unittest
+
+import broker
+import broker.aio
+
+class TestAsyncSubscriber(unittest.TestCase):
+    def test_get(self):
+        async def run(ep, sub):
+            asub = broker.aio.AsyncSubscriber(sub)
+            loop = asyncio.get_running_loop()
+            # Publish only after the coroutine started waiting.
+            loop.call_later(0.1, ep.publish, "/test", "ping")
+            msg = await asyncio.wait_for(asub.get(), 5.0)
+            self.assertEqual(msg, ("/test", "ping"))
+        with broker.Endpoint() as ep, \
+             ep.make_subscriber("/test") as sub:
+            asyncio.run(run(ep, sub))
+
+    def test_get_many_and_iteration(self):
+        async def run(ep, sub):
+            asub = broker.aio.AsyncSubscriber(sub)
+            for i in range(3):
+                ep.publish("/test", broker.Count(i))
+            msgs = []
+            while len(msgs) < 2:
+                msgs += await asyncio.wait_for(asub.get_many(2 - len(msgs)),
+                                               5.0)
+            self.assertEqual([d for (t, d) in msgs],
+                             [broker.Count(0), broker.Count(1)])
+            async for (t, d) in asub:
+                self.assertEqual(d, broker.Count(2))
+                break
+        with broker.Endpoint() as ep, \
+             ep.make_subscriber("/test") as sub:
+            asyncio.run(run(ep, sub))
+
+class TestAsyncStore(unittest.TestCase):
+    def test_get_put(self):
+        async def run(store):
+            astore = broker.aio.AsyncStore(store)
+            await astore.put("a", 1)
+            await astore.put("b", "two")
+            await astore.await_idle()
+            # Concurrent lookups share a single request.
+            values = await asyncio.gather(astore.get("a"), astore.get("b"),
+                                          astore.get("c"))
+            self.assertEqual(values, [1, "two", None])
+            self.assertEqual(await astore.get_many(["a", "b"]),
+                             {"a": 1, "b": "two"})
+        with broker.Endpoint() as ep, \
+             ep.attach_master("test", broker.Backend.Memory) as store:
+            asyncio.run(run(store))
+
+if __name__ == '__main__':
+    unittest.main(verbosity=3)
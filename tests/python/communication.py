@@ -2,6 +2,7 @@
 import unittest
 import multiprocessing
 import sys
+import threading
 import time
 import ipaddress
 
@@ -105,6 +106,35 @@ class TestCommunication(unittest.TestCase):
                 # 'tuple' object does not support item assignment
                 tuple_data[3] = 'd'
 
+    def test_view_messages(self):
+        with broker.Endpoint() as ep1, \
+             broker.Endpoint() as ep2, \
+             ep1.make_view_subscriber("/test") as s1:
+
+            port = ep1.listen("127.0.0.1", 0)
+            ep2.peer("127.0.0.1", port, 1.0)
+
+            msg = ("/test/1", ("payload", {"a": 1, "b": (2, 3)}, set([4])))
+            ep2.publish(*msg)
+
+            topic, view = s1.get()
+            self.assertEqual(topic, "/test/1")
+            self.assertEqual(len(view), 3)
+            self.assertEqual(view[0], "payload")
+            self.assertEqual(view[-1].to_py(), set([4]))
+            self.assertEqual(len(view[1]), 2)
+            self.assertEqual(view[1]["a"], 1)
+            self.assertEqual(list(view[1]["b"]), [2, 3])
+            self.assertEqual(sorted(view[1]), ["a", "b"])
+            self.assertIn("a", view[1])
+            self.assertIn(4, view[2])
+            self.assertEqual(bytes(memoryview(view.view(0))), b"payload")
+            self.assertEqual(view.to_py(), msg[1])
+            with self.assertRaises(IndexError):
+                view[3]
+            with self.assertRaises(KeyError):
+                view[1]["c"]
+
     def test_publisher(self):
         with broker.Endpoint() as ep1, \
              broker.Endpoint() as ep2, \
@@ -180,5 +210,19 @@ class TestCommunication(unittest.TestCase):
 
             pass
 
+    def test_blocking_get_releases_gil(self):
+        with broker.Endpoint() as ep1, \
+             ep1.make_subscriber("/test") as s1:
+            # The publishing thread only gets to run if get() releases the GIL
+            # while waiting.
+            def publish():
+                time.sleep(0.1)
+                ep1.publish("/test", "ping")
+            t = threading.Thread(target=publish)
+            t.start()
+            msg = s1.get(5.0)
+            t.join()
+            self.assertEqual(msg, ("/test", "ping"))
+
 if __name__ == '__main__':
     unittest.main(verbosity=3)
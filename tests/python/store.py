@@ -81,6 +81,28 @@ class TestStore(unittest.TestCase):
             self.assertEqual(x, "value")
             self.assertEqual(m.name(), "test")
 
+    def test_value_queries(self):
+        with broker.Endpoint() as ep1, \
+             ep1.attach_master("test", broker.Backend.Memory) as m:
+
+            m.put("set", {1, 2, 3})
+            m.put("vec", [10, 20, 30, 40])
+            m.put("table", {"a": 3, "b": 1, "c": 2})
+
+            Q = broker.ValueQuery
+            self.assertEqual(m.query_value("set", Q.Size), 3)
+            self.assertEqual(m.query_value("table", Q.Size), 3)
+            self.assertEqual(m.query_value("set", Q.Contains, (1, 5)),
+                             (True, False))
+            self.assertEqual(m.query_value("table", Q.Contains, ("b", "x")),
+                             (True, False))
+            self.assertEqual(m.query_value("vec", Q.Slice, (1, 3)), (20, 30))
+            self.assertEqual(m.query_value("vec", Q.Slice, (3, 10)), (40,))
+            self.assertEqual(m.query_value("table", Q.Top, 2),
+                             (("a", 3), ("c", 2)))
+            self.assertEqual(m.query_value("set", Q.Top, 2), None)
+            self.assertEqual(m.query_value("missing", Q.Size), None)
+
     def test_from_master(self):
         def impl(m, c1, c2):
             v1 = "A"
@@ -286,5 +308,32 @@ class TestStore(unittest.TestCase):
 
         run_tri_setup(self, impl)
 
+    def test_partial_clone(self):
+        with broker.Endpoint() as ep0, \
+             broker.Endpoint() as ep1, \
+             ep0.attach_master("test", broker.Backend.Memory) as m, \
+             ep1.attach_clone("test", key_prefix="net/") as c1:
+
+            m.put("net/a", 1)
+            m.put("other", 2)
+
+            port = ep0.listen("127.0.0.1", 0)
+            self.assertTrue(ep1.peer("127.0.0.1", port))
+            ep0.await_peer(ep1.node_id())
+            ep1.await_peer(ep0.node_id())
+            self.assertTrue(c1.await_idle())
+
+            # Updates of other keys don't reach the clone's copy.
+            m.put("net/b", 3)
+            m.put(42, 4)
+            c1.put("rest", 5)
+            await_idle(self, m, c1)
+
+            self.assertEqual(c1.keys(), {"net/a", "net/b"})
+            self.assertEqual(c1.get("net/b"), 3)
+            self.assertEqual(c1.get("other"), None)
+            self.assertEqual(m.get("rest"), 5)
+            self.assertEqual(m.keys(), {"net/a", "net/b", "other", 42, "rest"})
+
 if __name__ == '__main__':
     unittest.main(verbosity=3)
@@ -72,6 +72,42 @@ class TestCommunication(unittest.TestCase):
             self.assertEqual(metadata_dict[NetworkTimestamp], self.dt)
             self.assertEqual(metadata_dict[broker.Count(1234)], "custom")
 
+class TestLogWriteColumns(unittest.TestCase):
+
+    @staticmethod
+    def log_write(stream, path, serial_data):
+        # Mirrors the layout of broker::zeek::LogWrite.
+        return (broker.Count(1), broker.Count(3),
+                (broker.Enum(stream), broker.Enum("Log::WRITER_ASCII"), path,
+                 serial_data))
+
+    def test_columns(self):
+        with broker.Endpoint() as ep, \
+             ep.make_view_subscriber("/test") as s:
+            ep.publish("/test", self.log_write("Conn::LOG", "conn", b"\x01"))
+            ep.publish("/test", self.log_write("Conn::LOG", "conn2", b"\x02\x03"))
+            msgs = s.get(2, 5.0)
+            self.assertEqual(len(msgs), 2)
+            cols = broker.zeek.log_write_columns([d for (t, d) in msgs])
+            self.assertEqual(cols["stream_id"], "Conn::LOG")
+            self.assertEqual(cols["writer_id"], "Log::WRITER_ASCII")
+            self.assertEqual(cols["size"], 2)
+            values, offsets = cols["path"]
+            self.assertEqual(values, b"connconn2")
+            self.assertEqual(list(memoryview(offsets).cast("q")), [0, 4, 9])
+            values, offsets = cols["serial_data"]
+            self.assertEqual(values, b"\x01\x02\x03")
+            self.assertEqual(list(memoryview(offsets).cast("q")), [0, 1, 3])
+
+    def test_mixed_streams(self):
+        with broker.Endpoint() as ep, \
+             ep.make_view_subscriber("/test") as s:
+            ep.publish("/test", self.log_write("Conn::LOG", "conn", b""))
+            ep.publish("/test", self.log_write("DNS::LOG", "dns", b""))
+            msgs = s.get(2, 5.0)
+            with self.assertRaises(ValueError):
+                broker.zeek.log_write_columns([d for (t, d) in msgs])
+
 
 if __name__ == '__main__':
     unittest.main(verbosity=3)